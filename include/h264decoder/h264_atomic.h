@@ -0,0 +1,111 @@
+#ifndef _H_H264_ATOMIC_H_
+#define _H_H264_ATOMIC_H_
+
+#include <stdint.h>
+
+/**
+ * Atomic access to the state shared by the threads
+ *
+ * The slice threads, the frame threads, the reconstruction workers and the NALU pipeline share counters, indices and flags which one thread writes and the others
+ * read without holding a mutex. These helpers are the only place where such an access is made. They wrap the __atomic builtins of GCC and Clang: a plain or
+ * volatile access does not order the memory around it, so there is no fallback and the decoder does not build with a compiler without the builtins.
+ *
+ * A thread which sleeps on a condition variable until another thread advances a value, and is woken only if the other thread sees it waiting, uses the
+ * sequentially consistent pair: the sleeping thread stores its waiting flag before it loads the value, and the advancing thread stores the value before it loads
+ * the flag, so at least one of them sees the store of the other.
+ */
+
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "the decoder threads need the __atomic builtins of GCC or Clang"
+#endif
+
+/**
+ * @brief load an int32 which other threads write, without ordering the other memory
+ *
+ * @param p the value
+ * @return int32_t the value
+ */
+static inline int32_t load_shared_i32(const int32_t* p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+
+/**
+ * @brief store an int32 which other threads read, without ordering the other memory
+ *
+ * @param p the value
+ * @param value the new value
+ */
+static inline void store_shared_i32(int32_t* p, int32_t value) { __atomic_store_n(p, value, __ATOMIC_RELAXED); }
+
+/**
+ * @brief set bits of a word which other threads modify, without ordering the other memory
+ *
+ * @param p the word
+ * @param mask the bits to set
+ */
+static inline void set_shared_bits(uint32_t* p, uint32_t mask) { __atomic_fetch_or(p, mask, __ATOMIC_RELAXED); }
+
+/**
+ * @brief clear bits of a word which other threads modify, without ordering the other memory
+ *
+ * @param p the word
+ * @param mask the bits to clear
+ */
+static inline void clear_shared_bits(uint32_t* p, uint32_t mask) { __atomic_fetch_and(p, ~mask, __ATOMIC_RELAXED); }
+
+/**
+ * @brief add to a counter which other threads add to, without ordering the other memory
+ *
+ * @param p the counter
+ * @param value the addend
+ * @return uint32_t the counter before the addition
+ */
+static inline uint32_t fetch_add_shared_u32(uint32_t* p, uint32_t value) { return __atomic_fetch_add(p, value, __ATOMIC_RELAXED); }
+
+/**
+ * @brief load an int32 published by store_release_i32(), the memory written by the publishing thread before the store is visible after the load
+ *
+ * @param p the value
+ * @return int32_t the value
+ */
+static inline int32_t load_acquire_i32(const int32_t* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+/**
+ * @brief publish an int32, the memory written before the store is visible to a thread which loads the value by load_acquire_i32()
+ *
+ * @param p the value
+ * @param value the new value
+ */
+static inline void store_release_i32(int32_t* p, int32_t value) { __atomic_store_n(p, value, __ATOMIC_RELEASE); }
+
+/**
+ * @brief load an int32 in the single total order of the sequentially consistent accesses
+ *
+ * @param p the value
+ * @return int32_t the value
+ */
+static inline int32_t load_seq_cst_i32(const int32_t* p) { return __atomic_load_n(p, __ATOMIC_SEQ_CST); }
+
+/**
+ * @brief store an int32 in the single total order of the sequentially consistent accesses
+ *
+ * @param p the value
+ * @param value the new value
+ */
+static inline void store_seq_cst_i32(int32_t* p, int32_t value) { __atomic_store_n(p, value, __ATOMIC_SEQ_CST); }
+
+/**
+ * @brief load a uint32 in the single total order of the sequentially consistent accesses
+ *
+ * @param p the value
+ * @return uint32_t the value
+ */
+static inline uint32_t load_seq_cst_u32(const uint32_t* p) { return __atomic_load_n(p, __ATOMIC_SEQ_CST); }
+
+/**
+ * @brief store a uint32 in the single total order of the sequentially consistent accesses
+ *
+ * @param p the value
+ * @param value the new value
+ */
+static inline void store_seq_cst_u32(uint32_t* p, uint32_t value) { __atomic_store_n(p, value, __ATOMIC_SEQ_CST); }
+
+#endif
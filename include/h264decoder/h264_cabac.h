@@ -25,26 +25,9 @@
  * specified in clause 9.3.1.
  */
 
-typedef struct {
-    /* probability state index */
-    int32_t pStateIdx[H264_MAX_CONTEXT_INDEX];
-
-    /* the value of the most probable symbol*/
-    int32_t valMPS[H264_MAX_CONTEXT_INDEX];
-
-    int32_t codIRange;
-    int32_t codIOffset;
-} CABAC;
-
 /**
- * @brief get the singleton cabac object
- *
- * @return CABAC* the singleton cabac
- */
-CABAC* get_singleton_cabac();
-
-/**
- * @brief initialize context variable when starting the parsing of the slice data of a slice in clause 7.3.4
+ * @brief initialize context variable when starting the parsing of the slice data of a slice in clause 7.3.4. the states are copied from the tables derived once
+ * for all the values of SliceQPY
  *
  * @see 7.3.4 Slice data syntax
  * @see 9.3.1.1 Initialization process for context variables
@@ -168,14 +151,14 @@ int cabac_end_of_slice_flag(RBSPReader* rbsp_reader, CABAC* cabac, int32_t* out_
  * @return int 0 on success, negative value on error
  */
 int cabac_mb_type(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t* out_syntax_element);
-int cabac_mb_type_for_SI_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t maxBinIdxCtx,
+int cabac_mb_type_for_SI_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr,
                                 int32_t ctxIdxOffset, int32_t* out_syntax_element);
-int cabac_mb_type_for_I_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t maxBinIdxCtx,
+int cabac_mb_type_for_I_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr,
+                               int32_t ctxIdxOffset, int32_t* out_syntax_element);
+int cabac_mb_type_for_B_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr,
                                int32_t ctxIdxOffset, int32_t* out_syntax_element);
-int cabac_mb_type_for_B_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, int32_t CurrMbAddr, int32_t maxBinIdxCtx, int32_t ctxIdxOffset,
-                               int32_t* out_syntax_element);
-int cabac_mb_type_for_P_SP_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, int32_t CurrMbAddr, int32_t maxBinIdxCtx, int32_t ctxIdxOffset,
-                                  int32_t* out_syntax_element);
+int cabac_mb_type_for_P_SP_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr,
+                                  int32_t ctxIdxOffset, int32_t* out_syntax_element);
 
 /**
  * @brief decode sub_mb_type
@@ -197,6 +180,46 @@ int cabac_sub_mb_type(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* pictu
 int cabac_sub_mb_type_for_B_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t* out_syntax_element);
 int cabac_sub_mb_type_for_P_SP_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t* out_syntax_element);
 
+/**
+ * @brief decode ref_idx_l0 or ref_idx_l1, the neighbouring partitions are read from the motion data cache of the macroblock, see init_mv_cache()
+ *
+ * @see 7.3.5.1 Macroblock prediction syntax
+ * @see 7.3.5.2 Sub-macroblock prediction syntax
+ * @see 9.3.3.1.1.6 Derivation process of ctxIdxInc for the syntax elements ref_idx_l0 and ref_idx_l1
+ * @see Table 9-34 – Syntax elements and associated types of binarization, maxBinIdxCtx, and ctxIdxOffset
+ *
+ * @param rbsp_reader the RBSPReader
+ * @param cabac the cabac
+ * @param picture the FrameOrField data
+ * @param list 0 for ref_idx_l0, 1 for ref_idx_l1
+ * @param x4 the horizontal index of the upper-left 4x4 block of the partition in the macroblock
+ * @param y4 the vertical index of the upper-left 4x4 block of the partition in the macroblock
+ * @param out_syntax_element output parameter. the syntax element value
+ * @return int 0 on success, negative value on error
+ */
+int cabac_ref_idx(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, int32_t list, int32_t x4, int32_t y4, int32_t* out_syntax_element);
+
+/**
+ * @brief decode a component of mvd_l0 or mvd_l1, the neighbouring partitions are read from the motion data cache of the macroblock, see init_mv_cache()
+ *
+ * @see 7.3.5.1 Macroblock prediction syntax
+ * @see 7.3.5.2 Sub-macroblock prediction syntax
+ * @see 9.3.2.3 Concatenated unary/ k-th order Exp-Golomb (UEGk) binarization process
+ * @see 9.3.3.1.1.7 Derivation process of ctxIdxInc for the syntax elements mvd_l0 and mvd_l1
+ * @see Table 9-34 – Syntax elements and associated types of binarization, maxBinIdxCtx, and ctxIdxOffset
+ *
+ * @param rbsp_reader the RBSPReader
+ * @param cabac the cabac
+ * @param picture the FrameOrField data
+ * @param list 0 for mvd_l0, 1 for mvd_l1
+ * @param compIdx 0 for the horizontal component, 1 for the vertical component
+ * @param x4 the horizontal index of the upper-left 4x4 block of the partition in the macroblock
+ * @param y4 the vertical index of the upper-left 4x4 block of the partition in the macroblock
+ * @param out_syntax_element output parameter. the syntax element value
+ * @return int 0 on success, negative value on error
+ */
+int cabac_mvd(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, int32_t list, int32_t compIdx, int32_t x4, int32_t y4, int32_t* out_syntax_element);
+
 /**
  * @brief decode transform_size_8x8_flag
  *
@@ -308,15 +331,81 @@ int cabac_intra_chroma_pred_mode(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrF
  * @param picture the FrameOrField data
  * @param slice_header the slice header
  * @param CurrMbAddr the current macroblock address
- * @param ctxBlockCat the context block categories
- * @param xBlkIdx the x block index
- * @param iCbCr the index of Cb or Cr
+ * @param ctxBlockCat the context block category of Table 9-42
+ * @param xBlkIdx the index of the 4x4 or 8x8 block, see derivation_for_ctxIdxInc_coded_block_flag()
+ * @param iCbCr the chroma component of ctxBlockCat 3 and 4, -1 otherwise
  * @param out_syntax_element output parameter. the syntax element value
  * @return int 0 on success, negative value on error 
  */
 int cabac_coded_block_flag(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t ctxBlockCat, int32_t xBlkIdx,
                            int32_t iCbCr, int32_t* out_syntax_element);
 
+/**
+ * @brief decode significant_coeff_flag
+ *
+ * @see 9.3.3.1.3 Assignment process of ctxIdxInc for syntax elements significant_coeff_flag, last_significant_coeff_flag, and coeff_abs_level_minus1
+ * @see Table 9-34 – Syntax elements and associated types of binarization, maxBinIdxCtx, and ctxIdxOffset
+ * @see Table 9-43 – Mapping of scanning position to ctxIdxInc for ctxBlockCat = = 5, 9, or 13
+ *
+ * @param rbsp_reader the RBSPReader
+ * @param cabac the cabac
+ * @param ctxBlockCat the context block category of Table 9-42
+ * @param is_field 1 for the blocks of a field or of a field macroblock, 0 for the frame coded blocks
+ * @param levelListIdx the index of the coefficient in the list of the transform coefficient levels
+ * @param NumC8x8 the number of the 8x8 chroma blocks, used when ctxBlockCat is equal to 3
+ * @param out_syntax_element output parameter. the syntax element value
+ * @return int 0 on success, negative value on error
+ */
+int cabac_significant_coeff_flag(RBSPReader* rbsp_reader, CABAC* cabac, int32_t ctxBlockCat, int32_t is_field, int32_t levelListIdx, int32_t NumC8x8,
+                                 int32_t* out_syntax_element);
+
+/**
+ * @brief decode last_significant_coeff_flag
+ *
+ * @see 9.3.3.1.3 Assignment process of ctxIdxInc for syntax elements significant_coeff_flag, last_significant_coeff_flag, and coeff_abs_level_minus1
+ * @see Table 9-34 – Syntax elements and associated types of binarization, maxBinIdxCtx, and ctxIdxOffset
+ * @see Table 9-43 – Mapping of scanning position to ctxIdxInc for ctxBlockCat = = 5, 9, or 13
+ *
+ * @param rbsp_reader the RBSPReader
+ * @param cabac the cabac
+ * @param ctxBlockCat the context block category of Table 9-42
+ * @param is_field 1 for the blocks of a field or of a field macroblock, 0 for the frame coded blocks
+ * @param levelListIdx the index of the coefficient in the list of the transform coefficient levels
+ * @param NumC8x8 the number of the 8x8 chroma blocks, used when ctxBlockCat is equal to 3
+ * @param out_syntax_element output parameter. the syntax element value
+ * @return int 0 on success, negative value on error
+ */
+int cabac_last_significant_coeff_flag(RBSPReader* rbsp_reader, CABAC* cabac, int32_t ctxBlockCat, int32_t is_field, int32_t levelListIdx, int32_t NumC8x8,
+                                      int32_t* out_syntax_element);
+
+/**
+ * @brief decode coeff_abs_level_minus1
+ *
+ * @see 9.3.2.3 Concatenated unary/ k-th order Exp-Golomb (UEGk) binarization process
+ * @see 9.3.3.1.3 Assignment process of ctxIdxInc for syntax elements significant_coeff_flag, last_significant_coeff_flag, and coeff_abs_level_minus1
+ * @see Table 9-34 – Syntax elements and associated types of binarization, maxBinIdxCtx, and ctxIdxOffset
+ *
+ * @param rbsp_reader the RBSPReader
+ * @param cabac the cabac
+ * @param ctxBlockCat the context block category of Table 9-42
+ * @param numDecodAbsLevelEq1 the number of the coeff_abs_level_minus1 equal to 0 decoded before in the block
+ * @param numDecodAbsLevelGt1 the number of the coeff_abs_level_minus1 greater than 0 decoded before in the block
+ * @param out_syntax_element output parameter. the syntax element value
+ * @return int 0 on success, negative value on error
+ */
+int cabac_coeff_abs_level_minus1(RBSPReader* rbsp_reader, CABAC* cabac, int32_t ctxBlockCat, int32_t numDecodAbsLevelEq1, int32_t numDecodAbsLevelGt1,
+                                 int32_t* out_syntax_element);
+
+/**
+ * @brief decode coeff_sign_flag in bypass mode
+ *
+ * @param rbsp_reader the RBSPReader
+ * @param cabac the cabac
+ * @param out_syntax_element output parameter. the syntax element value, 1 for a negative level
+ * @return int 0 on success, negative value on error
+ */
+int cabac_coeff_sign_flag(RBSPReader* rbsp_reader, CABAC* cabac, int32_t* out_syntax_element);
+
 /**
  * @brief decode binary value
  * @see 9.3.3.2 Arithmetic decoding process
@@ -483,9 +572,9 @@ int derivation_for_ctxIdxInc_intra_chroma_pred_mode(FrameOrField* picture, Slice
  * @param picture the FrameOrField data
  * @param slice_header the slice header
  * @param CurrMbAddr the current macroblock address
- * @param ctxBlockCat the context block categories
- * @param xBlkIdx the x block index
- * @param iCbCr the index of Cb or Cr
+ * @param ctxBlockCat the context block category of Table 9-42
+ * @param xBlkIdx the index of the 4x4 or 8x8 block, see derivation_for_ctxIdxInc_coded_block_flag()
+ * @param iCbCr the chroma component of ctxBlockCat 3 and 4, -1 otherwise
  * @param out_ctxIdxInc output parameter. the ctxIdxInc
  * @return int 0 on success, negative value on error
  */
@@ -505,4 +594,31 @@ int derivation_for_ctxIdxInc_coded_block_flag(FrameOrField* picture, SliceHeader
  */
 int derivation_for_ctxIdxInc_transform_size_8x8_flag(FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t ctxIdxOffset, int32_t* out_ctxIdxInc);
 
+/**
+ * @brief Derivation process of ctxIdxInc for the syntax elements ref_idx_l0 and ref_idx_l1
+ * @see 9.3.3.1.1.6 Derivation process of ctxIdxInc for the syntax elements ref_idx_l0 and ref_idx_l1
+ *
+ * @param picture the FrameOrField data
+ * @param list 0 for ref_idx_l0, 1 for ref_idx_l1
+ * @param x4 the horizontal index of the upper-left 4x4 block of the partition in the macroblock
+ * @param y4 the vertical index of the upper-left 4x4 block of the partition in the macroblock
+ * @param out_ctxIdxInc output parameter. the ctxIdxInc
+ * @return int 0 on success, negative value on error
+ */
+int derivation_for_ctxIdxInc_ref_idx(FrameOrField* picture, int32_t list, int32_t x4, int32_t y4, int32_t* out_ctxIdxInc);
+
+/**
+ * @brief Derivation process of ctxIdxInc for the syntax elements mvd_l0 and mvd_l1
+ * @see 9.3.3.1.1.7 Derivation process of ctxIdxInc for the syntax elements mvd_l0 and mvd_l1
+ *
+ * @param picture the FrameOrField data
+ * @param list 0 for mvd_l0, 1 for mvd_l1
+ * @param compIdx 0 for the horizontal component, 1 for the vertical component
+ * @param x4 the horizontal index of the upper-left 4x4 block of the partition in the macroblock
+ * @param y4 the vertical index of the upper-left 4x4 block of the partition in the macroblock
+ * @param out_ctxIdxInc output parameter. the ctxIdxInc
+ * @return int 0 on success, negative value on error
+ */
+int derivation_for_ctxIdxInc_mvd(FrameOrField* picture, int32_t list, int32_t compIdx, int32_t x4, int32_t y4, int32_t* out_ctxIdxInc);
+
 #endif
\ No newline at end of file
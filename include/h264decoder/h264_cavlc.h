@@ -3,6 +3,37 @@
 
 #include <stdint.h>
 
+#include "h264_defs.h"
+#include "h264_error.h"
+#include "h264_rbsp.h"
 
+/**
+ * Context-adaptive variable length coding, CAVLC
+ *
+ * @see 9.2 CAVLC parsing process for transform coefficient levels
+ * @see 7.3.5.3.2 Residual block CAVLC syntax
+ *
+ * This process is invoked when parsing syntax elements with descriptor equal to ce(v) in clause 7.3.5.3.2 and when entropy_coding_mode_flag is equal to 0.
+ *
+ * The code words of coeff_token, total_zeros and run_before are decoded with two-level lookup tables: the first level is indexed by the number of leading zero bits of the
+ * code word, the second level is indexed by the bits following the first 1 bit. level_prefix is decoded with the count-leading-zeros instruction.
+ */
 
-#endif
\ No newline at end of file
+/**
+ * @brief residual block CAVLC
+ * @see 7.3.5.3.2 Residual block CAVLC syntax
+ * @see 7.4.5.3.2 Residual block CAVLC semantics
+ * @see 9.2 CAVLC parsing process for transform coefficient levels
+ *
+ * @param rbsp_reader the RBSPReader
+ * @param nC the nC as specified in clause 9.2.1. -1 for the chroma DC of ChromaArrayType 1, -2 for the chroma DC of ChromaArrayType 2
+ * @param coeffLevel output parameter. the coefficient levels, it has maxNumCoeff elements
+ * @param startIdx the start index
+ * @param endIdx the end index
+ * @param maxNumCoeff the max number of coeff
+ * @param out_TotalCoeff output parameter. the TotalCoeff( coeff_token ), the caller stores it for the nC derivation of the following blocks
+ * @return int 0 on success, negative value on error
+ */
+int residual_block_cavlc(RBSPReader* rbsp_reader, int32_t nC, int32_t* coeffLevel, int32_t startIdx, int32_t endIdx, int32_t maxNumCoeff, int32_t* out_TotalCoeff);
+
+#endif
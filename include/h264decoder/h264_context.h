@@ -6,9 +6,19 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "h264_deblock.h"
+#include "h264_deblock_thread.h"
+#include "h264_dpb.h"
 #include "h264_error.h"
+#include "h264_frame.h"
+#include "h264_frame_thread.h"
+#include "h264_memory.h"
 #include "h264_nalu.h"
 #include "h264_picture.h"
+#include "h264_poc.h"
+#include "h264_reconstruct.h"
+#include "h264_ref_list.h"
+#include "h264_slice_thread.h"
 
 /**
  * @brief H.264 Context
@@ -23,12 +33,31 @@ typedef struct {
 
     uint8_t last_slice_nal_unit_type; /*the last slice NALU type, it's used for parsing auxiliary slices(IdrPicFlag)*/
 
-    Picture *gop[H264_MAX_DPB_FRAMES]; /* group of pictures */
-    int gop_curr_index;                /* the gop current picture index */
-    Picture *current_picture;          /* the current picture, it MUST be in the gop array*/
+    PicturePool picture_pool; /* the pool of the pictures allocated for the active sps */
+    Picture *current_picture; /* the current picture, it MUST be in the picture pool*/
+    int32_t flushing;         /* flush_context() has output the decoded pictures, the ones which did not fit the output queue are queued as it empties */
+    DecodedPictureBuffer dpb; /* the reference pictures and the pictures waiting for the output */
+    PicOrderCntState poc_state; /* the picture order count state of the previous pictures */
+    RefPicListCache ref_list_cache; /* the initial reference picture lists shared by the slices of the current frame or field */
+    RefPicLists ref_lists;          /* the reference picture lists of the current slice */
+
+    FrameDelivery *frame_delivery;   /* the frames handed to the application */
+    FRAME_POOL_POLICY pool_policy;   /* the behaviour when the application holds every free picture of the pool */
+    int64_t next_pts;                /* the timestamps of the next access unit, H264_NO_TIMESTAMP if none is set */
+    int64_t next_dts;
 
     SliceHeader *current_slice_header; /* the current slice header */
     SliceHeader *prev_slice_header;    /* the previous slice header*/
+    MacroBlockScratch *mb_scratch;     /* the macroblock scratch which the decoding thread decodes the slices with */
+
+    DeblockFuncs deblock_funcs;    /* the deblocking filter kernels selected for the CPU */
+    int32_t deblock_bit_depths[2]; /* BitDepthY and BitDepthC of the kernels of deblock_funcs */
+    DeblockThread *deblock_thread; /* the row-lagged deblocking worker, 0 if the pictures are deblocked by the decoding thread */
+    FrameThreads *frame_threads;   /* the workers decoding the slice data of several pictures at once, 0 if the decoding thread decodes it */
+    SliceThreads *slice_threads;   /* the workers decoding the slices of a picture at once, 0 if the decoding thread decodes them one by one */
+    Reconstructor *reconstructor;  /* the reconstruction stage of the pictures, 0 if the context only parses the slices, see H264_RECONSTRUCT_PARSE_ONLY */
+
+    MemoryBudget memory; /* the budget which the pictures of the pool are charged to, a child of the budget of the decoder group of the context */
 } H264Context;
 
 /**
@@ -39,7 +68,7 @@ typedef struct {
 H264Context *create_context();
 
 /**
- * @brief free the H264Context
+ * @brief free the H264Context. the frames which the application holds stay valid, their pictures are freed when they are released
  * the parameter context pointer becomes an invalid pointer after this free_context() was invoked
  *
  * @param context the H264Context pointer
@@ -47,15 +76,155 @@ H264Context *create_context();
 void free_context(H264Context *context);
 
 /**
- * @brief get the picture from context
+ * @brief enable or disable the deblocking of the pictures on a worker thread trailing the reconstruction by one macroblock row, the decoded samples are identical
+ * either way. it MUST NOT be invoked while a picture is being decoded
+ *
+ * @param context the H264 context pointer
+ * @param enabled 1 to run the deblocking filter on the worker thread, 0 to run it on the decoding thread
+ * @return int 0 on success, negative value on error
+ */
+int set_deblock_thread_enabled(H264Context *context, int enabled);
+
+/**
+ * @brief set the number of the worker threads decoding the slice data, each worker decodes a picture while the later pictures wait only for the rows of their
+ * reference pictures which they read. the decoded pictures are identical to the single-threaded decoding. the pictures in flight are decoded before the workers
+ * change, it SHOULD be invoked between the access units
+ *
+ * @param context the H264 context pointer
+ * @param thread_count 0 or 1 to decode the slice data on the decoding thread, up to H264_MAX_FRAME_THREADS
+ * @return int 0 on success, negative value on error
+ */
+int set_frame_threads(H264Context *context, int32_t thread_count);
+
+/**
+ * @brief set the number of the worker threads decoding the slices of a picture concurrently, the decoded pictures are identical to the single-threaded decoding.
+ * the pictures decoded by the frame threads are decoded slice by slice by their frame thread. the queued slices are decoded before the workers change
  *
  * @param context the H264 context pointer
- * @param is_new_picture the picture is a new picture or not
+ * @param thread_count 0 or 1 to decode the slices one by one, up to H264_MAX_SLICE_THREADS
+ * @return int 0 on success, negative value on error
+ */
+int set_slice_threads(H264Context *context, int32_t thread_count);
+
+/**
+ * @brief set the number of the threads reconstructing the samples of the pictures. the slices are parsed into per-macroblock records, which the threads reconstruct
+ * as a wavefront of macroblock rows while the later macroblocks are parsed, and each frame or field is deblocked and padded before it is marked. the samples are
+ * identical for any number of threads, see h264_reconstruct.h for the formats which are reconstructed. the pictures decoded by the frame threads are reconstructed
+ * row by row by their frame thread instead. a context reconstructs the samples on the decoding thread until it is invoked. it MUST NOT be invoked while a picture
+ * is being decoded
+ *
+ * @param context the H264 context pointer
+ * @param thread_count 1 to reconstruct the samples on the decoding thread, up to H264_MAX_RECONSTRUCT_THREADS, or H264_RECONSTRUCT_PARSE_ONLY to only parse
+ * the slices into the macroblock state
+ * @return int 0 on success, negative value on error
+ */
+int set_reconstruction_threads(H264Context *context, int32_t thread_count);
+
+/**
+ * @brief set the border around the luma planes of the decoded pictures, the chroma borders are scaled by SubWidthC. the pictures are reallocated with the border
+ * when the next picture is decoded
+ *
+ * @param context the H264 context pointer
+ * @param border the border in luma samples, H264_MC_LUMA_BORDER to H264_PLANE_MAX_BORDER, H264_PLANE_BORDER by default
+ * @return int 0 on success, negative value on error
+ */
+int set_picture_border(H264Context *context, int32_t border);
+
+/**
+ * @brief get the picture from context. for a new picture, the previous picture is marked and stored in the DPB, the pictures are output as the reordering
+ * allows, the gaps in frame_num are filled, and the picture is taken from the picture pool unless the slice starts the second field of the previous picture.
+ * the picture order count of the new frame or field is derived
+ *
+ * @param context the H264 context pointer
+ * @param is_new_picture the picture is a new picture or not, the current slice header is the first slice of the new picture
  * @param out_picture output parameter. the picture
  * @return int 0 on success, negative value on error
  */
 int get_picture_from_context(H264Context *context, int is_new_picture, Picture **out_picture);
 
+/**
+ * @brief finish the current picture and output all the decoded pictures, at the end of the stream. the output pictures are taken by get_output_picture()
+ *
+ * @param context the H264 context pointer
+ * @return int 0 on success, negative value on error
+ */
+int flush_context(H264Context *context);
+
+/**
+ * @brief set the behaviour of the decoder when the pictures of the pool are held by the frames of the application
+ *
+ * @param context the H264 context pointer
+ * @param policy FRAME_POOL_FAIL, FRAME_POOL_GROW or FRAME_POOL_BLOCK
+ * @return int 0 on success, negative value on error
+ */
+int set_frame_pool_policy(H264Context *context, FRAME_POOL_POLICY policy);
+
+/**
+ * @brief set the cap of the memory of the pictures of the context: their sample planes, macroblock metadata and scratch. a picture which does not fit is not
+ * allocated, the pool stops growing and the decoding fails or blocks by the pool policy with ERR_MEMORY_BUDGET_EXCEEDED instead of
+ * ERR_PICTURE_POOL_EXHAUSTED, so the frames held by the application beyond the pictures which fit are refused. it may be invoked while decoding
+ *
+ * @param context the H264 context pointer
+ * @param limit the cap in bytes, 0 for none
+ * @return int 0 on success, negative value on error. ERR_MEMORY_BUDGET_EXCEEDED if the pictures of the context take more memory, or the limit does not fit the
+ * budget of the decoder group
+ */
+int set_memory_limit(H264Context *context, size_t limit);
+
+/**
+ * @brief get the current and the peak bytes of the pictures of the context by category
+ *
+ * @param context the H264 context pointer
+ * @param usage output parameter. the counters
+ */
+void get_memory_usage(H264Context *context, MemoryUsage *usage);
+
+/**
+ * @brief check whether the next picture would wait for the application: the pool has no idle picture and no room for another one, and the frames of the
+ * application hold pictures. a caller decoding many streams on shared threads defers the stream instead of blocking, see h264_decoder_group.h
+ *
+ * @param context the H264 context pointer
+ * @return int 1 if the next picture waits for the application to release a frame, 0 otherwise
+ */
+int is_waiting_for_frames(H264Context *context);
+
+/**
+ * @brief set the timestamps of the next access unit, the picture started by its first slice carries them to its frame
+ *
+ * @param context the H264 context pointer
+ * @param pts the presentation timestamp
+ * @param dts the decoding timestamp
+ */
+void set_access_unit_timestamps(H264Context *context, int64_t pts, int64_t dts);
+
+/**
+ * @brief receive the next decoded frame in the output order without copying its samples. the frame holds the picture until the application releases it by
+ * release_frame(), which may be invoked on any thread, also after the context is freed
+ *
+ * @param context the H264 context pointer
+ * @param frame output parameter. the frame handle
+ * @return int 0 on success, negative value on error. ERR_NO_FRAME if no frame is output
+ */
+int receive_frame(H264Context *context, DecodedFrame *frame);
+
+/**
+ * @brief take the next decoded picture in the output order. a picture is output as soon as max_num_reorder_frames of the stream allows, the pictures of
+ * pic_order_cnt_type 2 or max_num_reorder_frames equal to 0 are output when the next picture starts. the poc of Picture::frame is PicOrderCnt( ) of the picture and
+ * Picture::output_latency the number of the pictures started between its decoding and its output
+ *
+ * @param context the H264 context pointer
+ * @return Picture* the picture, 0 if no picture is output. the caller MUST return it by release_output_picture()
+ */
+Picture *get_output_picture(H264Context *context);
+
+/**
+ * @brief return the output picture to the picture pool
+ *
+ * @param context the H264 context pointer
+ * @param picture the picture taken by get_output_picture()
+ */
+void release_output_picture(H264Context *context, Picture *picture);
+
 /**
  * @brief get the current slice header
  *
@@ -75,6 +244,21 @@ void get_slice_header(H264Context *context, SliceHeader **out_header);
  */
 int parse_nalu(const uint8_t *nalu_start, const uint8_t *nalu_end, H264Context *context, void **nalu);
 
+/**
+ * @brief decode the slice whose header is parsed: start or continue its picture, construct the reference picture lists and decode the slice data, or queue it
+ * to the frame or slice threads
+ *
+ * @param context the H264 context pointer
+ * @param slice_header the current slice header of the context, referring to the active parameter sets of the context
+ * @param is_first_VCL_NAL 1 if the slice is the first VCL NAL unit of a primary coded picture
+ * @param rbsp_buffer the RBSP of the slice. if the threads take it over, it is exchanged with the buffer of the previous slice of the thread job, which may be 0
+ * @param rbsp_capacity the capacity of rbsp_buffer, exchanged with it
+ * @param rbsp_reader the reader positioned after the slice header
+ * @return int 0 on success, negative value on error
+ */
+int decode_slice_nalu(H264Context *context, SliceHeader *slice_header, int is_first_VCL_NAL, uint8_t **rbsp_buffer, size_t *rbsp_capacity,
+                      RBSPReader *rbsp_reader);
+
 /**
  * @brief add sps to the context
  *
@@ -0,0 +1,20 @@
+#ifndef _H_H264_CPU_H_
+#define _H_H264_CPU_H_
+
+#include <stdint.h>
+
+/**
+ * the instruction set extensions used by the SIMD kernels
+ */
+#define H264_CPU_SSE2 0x01
+#define H264_CPU_SSSE3 0x02
+#define H264_CPU_AVX2 0x04
+
+/**
+ * @brief get the instruction set extensions supported by the CPU and the operating system
+ *
+ * @return int32_t the H264_CPU_XXX flags, 0 if none is supported or the platform is not x86
+ */
+int32_t get_cpu_flags();
+
+#endif
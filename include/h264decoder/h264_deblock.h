@@ -0,0 +1,158 @@
+#ifndef _H_H264_DEBLOCK_H_
+#define _H_H264_DEBLOCK_H_
+
+#include <stdint.h>
+
+#include "h264_defs.h"
+#include "h264_error.h"
+#include "h264_picture.h"
+
+/**
+ * Deblocking filter
+ *
+ * @see 8.7 Deblocking filter process
+ *
+ * The macroblocks are filtered in the order of the macroblock addresses. For every macroblock the boundary filtering strength bS of all the 4x4 block edges, 2
+ * directions of 4 edges of 4 segments, is derived in one pass by DeblockFuncs::boundary_strength from DeblockCache, which holds the non-zero coefficient mask, the
+ * motion vectors and the reference pictures of the 16 blocks of the macroblock and of the blocks left of and above it at the offsets of MV_CACHE_IDX(). The reference
+ * indices are mapped to the identifiers of the reference pictures, so the comparison of 8.7.2.1 does not depend on the list or the slice of the reference index.
+ *
+ * The edges are filtered by the kernels of DeblockFuncs, which are selected by init_deblock_funcs() according to the bit depths and the instruction set extensions
+ * of the CPU. A kernel filters a whole edge of a macroblock, 16 luma samples or 8 chroma samples, the segments of bS equal to 0 are marked by a negative tC0. The
+ * scalar kernels of the bit depths 8 to 14 are instantiated from one template, the SIMD kernels are used for the bit depth 8 only. For the bit depths greater than
+ * 8, pix points to uint16_t samples, alpha and beta are scaled to the bit depth and tC0 is the value of Table 8-17, which the kernels scale.
+ */
+
+/**
+ * @brief the filtering of an edge with bS less than 4
+ * @see 8.7.2.3 Filtering process for edges with bS less than 4
+ *
+ * @param pix the sample q0 of the first line across the edge
+ * @param stride the row stride in samples
+ * @param alpha the threshold alpha of Table 8-16
+ * @param beta the threshold beta of Table 8-16
+ * @param tc0 tC0 of Table 8-17 of the 4 segments of the edge, 4 luma or 2 chroma lines each. the lines of a negative tC0 are not filtered
+ */
+typedef void (*deblock_func)(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta, const int8_t tc0[4]);
+
+/**
+ * @brief the filtering of an edge with bS equal to 4
+ * @see 8.7.2.4 Filtering process for edges for bS equal to 4
+ */
+typedef void (*deblock_intra_func)(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta);
+
+/**
+ * @brief the motion data and the non-zero coefficient mask of the 4x4 blocks of a macroblock and of its neighbouring blocks, indexed like MvCache
+ */
+typedef struct {
+    /* mvL0 and mvL1, 0 if predFlagLX is 0 */
+    int16_t mv[2][H264_MV_CACHE_SIZE][2];
+    /* the identifiers of the reference pictures of list 0 and list 1, -1 if predFlagLX is 0 */
+    int8_t ref[2][H264_MV_CACHE_SIZE];
+    /* 1 if the block, or the 8x8 block containing it for transform_size_8x8_flag equal to 1, contains non-zero transform coefficient levels */
+    uint8_t nnz[H264_MV_CACHE_SIZE];
+} DeblockCache;
+
+/**
+ * @brief derive bS of the edges of an inter macroblock from the coefficients and the motion data, the intra macroblocks are handled by the caller
+ * @see 8.7.2.1 Derivation process for the luma content dependent boundary filtering strength
+ *
+ * @param cache the motion data of the macroblock and its neighbours
+ * @param mvy_limit the minimum vertical motion vector difference of bS equal to 1, 4 for the frame macroblocks and 2 for the field macroblocks
+ * @param bS the output, indexed by the direction ( 0 for the vertical edges ), the edge and the segment. the values are 0, 1 or 2
+ */
+typedef void (*boundary_strength_func)(const DeblockCache* cache, int32_t mvy_limit, uint8_t bS[2][4][4]);
+
+/**
+ * @brief the deblocking filter function table, the kernels are indexed by the edge direction, 0 for the vertical edges and 1 for the horizontal edges
+ */
+typedef struct {
+    /* the luma edges of 16 samples */
+    deblock_func luma[2];
+    deblock_intra_func luma_intra[2];
+    /* the Cb and Cr edges of 8 samples with chromaStyleFilteringFlag equal to 1 */
+    deblock_func chroma[2];
+    deblock_intra_func chroma_intra[2];
+    /* the Cb and Cr edges of 16 samples of ChromaArrayType equal to 3, filtered like the luma edges at the chroma bit depth */
+    deblock_func chroma444[2];
+    deblock_intra_func chroma444_intra[2];
+    boundary_strength_func boundary_strength;
+} DeblockFuncs;
+
+/**
+ * @brief initialize the deblocking filter function table
+ *
+ * @param funcs the function table
+ * @param BitDepthY the bit depth of the luma samples, 8 to 14
+ * @param BitDepthC the bit depth of the chroma samples, 8 to 14
+ * @param cpu_flags the H264_CPU_XXX flags, the scalar kernels are used if it is 0
+ */
+void init_deblock_funcs(DeblockFuncs* funcs, int32_t BitDepthY, int32_t BitDepthC, int32_t cpu_flags);
+
+/**
+ * @brief replace the SIMD kernels of the function table for the instruction set extensions
+ *
+ * @param funcs the function table initialized with the scalar kernels
+ * @param cpu_flags the H264_CPU_XXX flags
+ */
+void init_deblock_funcs_x86(DeblockFuncs* funcs, int32_t cpu_flags);
+
+/**
+ * @brief the decoded samples of a frame or field which the deblocking filter works on in place
+ */
+typedef struct {
+    /* the sample ( 0, 0 ) of the luma, Cb and Cr planes, uint16_t samples for the bit depths greater than 8 */
+    uint8_t* planes[3];
+    /* the row strides in samples */
+    int32_t strides[3];
+    /* the geometry of the active SPS */
+    int32_t PicWidthInMbs;
+    int32_t ChromaArrayType;
+    /* the bit depths of the function table */
+    int32_t BitDepthY;
+    int32_t BitDepthC;
+} DeblockPlanes;
+
+/**
+ * @brief set the planes of the deblocking filter to the sample planes of the frame or field
+ *
+ * @param planes the planes of the deblocking filter
+ * @param ff the frame or field, its sample planes are allocated
+ * @param sps the active sps
+ */
+void init_deblock_planes(DeblockPlanes* planes, const FrameOrField* ff, const SPS* sps);
+
+/**
+ * @brief Deblocking filter process of a macroblock
+ * @see 8.7 Deblocking filter process
+ *
+ * @param funcs the function table
+ * @param picture the frame or field, the macroblock and the macroblocks left of and above it are decoded
+ * @param planes the samples of the frame or field
+ * @param CurrMbAddr the address of the macroblock
+ * @return int 0 on success, negative value on error
+ */
+int deblock_macroblock(const DeblockFuncs* funcs, FrameOrField* picture, const DeblockPlanes* planes, int32_t CurrMbAddr);
+
+/**
+ * @brief Deblocking filter process of the macroblocks of a macroblock row, the rows above are filtered already
+ *
+ * @param funcs the function table
+ * @param picture the frame or field
+ * @param planes the samples of the frame or field
+ * @param mb_row the macroblock row
+ * @return int 0 on success, negative value on error
+ */
+int deblock_macroblock_row(const DeblockFuncs* funcs, FrameOrField* picture, const DeblockPlanes* planes, int32_t mb_row);
+
+/**
+ * @brief Deblocking filter process of all the macroblocks of a decoded frame or field
+ *
+ * @param funcs the function table
+ * @param picture the frame or field
+ * @param planes the samples of the frame or field
+ * @return int 0 on success, negative value on error
+ */
+int deblock_picture(const DeblockFuncs* funcs, FrameOrField* picture, const DeblockPlanes* planes);
+
+#endif
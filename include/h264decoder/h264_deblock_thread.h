@@ -0,0 +1,91 @@
+#ifndef _H_H264_DEBLOCK_THREAD_H_
+#define _H_H264_DEBLOCK_THREAD_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "h264_deblock.h"
+#include "h264_error.h"
+#include "h264_picture.h"
+
+/**
+ * Row-lagged deblocking stage
+ *
+ * The deblocking filter of a frame or field runs on a worker thread while the macroblocks are reconstructed. The reconstruction reports the number of the leading
+ * macroblock rows which are reconstructed completely, and the worker filters macroblock row r once row r + 1 is reconstructed: the intra prediction of row r + 1 reads
+ * the unfiltered samples of the bottom line of row r, which the vertical edges of row r modify, and the filtering of row r only modifies the samples of rows r - 1 and
+ * r. The rows are filtered in the same order and by the same kernels as deblock_picture(), so the samples are identical with and without the worker thread.
+ */
+
+/**
+ * @brief the deblocking worker thread and the progress counters of the picture being filtered
+ */
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    /* signaled when a counter changes or a picture is started */
+    pthread_cond_t cond;
+
+    const DeblockFuncs* funcs;
+    FrameOrField* picture; /* the picture being filtered, 0 if the worker is idle */
+    DeblockPlanes planes;
+    int32_t PicHeightInMbs;
+
+    int32_t reconstructed_rows; /* the number of the leading macroblock rows which are reconstructed */
+    int32_t deblocked_rows;     /* the number of the leading macroblock rows which are filtered */
+    int err_code;               /* the first error of the picture */
+    int32_t quit;
+} DeblockThread;
+
+/**
+ * @brief create the deblocking worker thread
+ *
+ * @param funcs the function table, it MUST outlive the thread
+ * @return DeblockThread* the thread, return 0 if the creation fails
+ */
+DeblockThread* create_deblock_thread(const DeblockFuncs* funcs);
+
+/**
+ * @brief stop and join the deblocking worker thread, the picture being filtered is abandoned
+ * the parameter thread pointer becomes an invalid pointer after this free_deblock_thread() was invoked
+ *
+ * @param thread the thread
+ */
+void free_deblock_thread(DeblockThread* thread);
+
+/**
+ * @brief start the deblocking of a frame or field before its first macroblock is reconstructed, the previous picture MUST be finished
+ *
+ * @param thread the thread
+ * @param picture the frame or field, the slice parameters and the macroblock state stay valid until finish_deblock_picture()
+ * @param planes the samples of the frame or field
+ * @return int 0 on success, negative value on error
+ */
+int start_deblock_picture(DeblockThread* thread, FrameOrField* picture, const DeblockPlanes* planes);
+
+/**
+ * @brief report the progress of the reconstruction, the worker filters the rows up to rows - 2
+ *
+ * @param thread the thread
+ * @param rows the number of the leading macroblock rows which are reconstructed, the smaller values than the reported ones are ignored
+ */
+void report_reconstructed_rows(DeblockThread* thread, int32_t rows);
+
+/**
+ * @brief get the number of the leading macroblock rows which are filtered. the bottom lines of the last filtered row are modified by the filtering of the row below
+ * it, so the samples of the rows above it are final
+ *
+ * @param thread the thread
+ * @return int32_t the number of the filtered rows
+ */
+int32_t get_deblocked_rows(DeblockThread* thread);
+
+/**
+ * @brief mark all the rows reconstructed and wait until the worker filters the whole picture
+ *
+ * @param thread the thread
+ * @return int 0 on success, negative value on error of the deblocking of a macroblock
+ */
+int finish_deblock_picture(DeblockThread* thread);
+
+#endif
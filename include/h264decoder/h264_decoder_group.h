@@ -0,0 +1,215 @@
+#ifndef _H_H264_DECODER_GROUP_H_
+#define _H_H264_DECODER_GROUP_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "h264_context.h"
+#include "h264_error.h"
+#include "h264_frame.h"
+#include "h264_memory.h"
+#include "h264_picture.h"
+
+/**
+ * Decoding many streams on one pool of workers
+ *
+ * A decoder group decodes the streams of its members on a fixed number of worker threads, so the number of the threads follows the number of the cores rather
+ * than the number of the streams. Each member stream has its own H264 context, a queue of the submitted packets and a queue of the output frames. A stream which
+ * has a packet to decode and room for its frames is runnable and waits in the run queue of the group; a worker takes the stream at the head of the run queue,
+ * decodes one packet, moves the output frames of the context to the output queue, and puts the stream back at the tail if it is still runnable. A stream is decoded
+ * by one worker at a time, and the streams take turns packet by packet, so a busy stream does not delay the others by more than one packet each.
+ *
+ * The contexts of the members share what does not change while decoding: the kernel and the entropy decoding tables are read-only and shared by all the contexts
+ * of the process, and the pictures which a member frees, when its geometry changes or when it is removed, go to the shared picture pool of the group, from which
+ * the members of the same geometry take them before they allocate pictures. The members decode and reconstruct the pictures on the worker which decodes their
+ * packet, they have no threads of their own.
+ *
+ * The memory of the pictures is charged to the budget of the member context, which is a child of the budget of the group, and the idle pictures of the shared
+ * pool are charged to the group. A stream added with a memory limit reserves it from the limit of the group, so a stream which does not fit is refused when it is
+ * added instead of failing the streams decoding already. When the budget of a stream has no room for its next picture while the application holds its frames,
+ * the stream is deferred until the application receives a frame, so its output queue is as deep as the budget allows. The idle pictures of the shared pool are
+ * freed when the members need their room.
+ *
+ * The functions of a stream are invoked by one application thread at a time, and the functions of different streams may be invoked concurrently.
+ */
+
+/* the maximum number of the worker threads of a group */
+#define H264_MAX_GROUP_THREADS 64
+/* the number of the packets which may be queued to a stream */
+#define H264_GROUP_INPUT_DEPTH 8
+/* the number of the frames which may be waiting in the output queue of a stream */
+#define H264_GROUP_OUTPUT_DEPTH 8
+
+struct DecoderGroup;
+
+/**
+ * @brief a packet queued to a stream, the data is copied into the buffer of the slot which is kept for the later packets
+ */
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    int64_t pts;
+    int64_t dts;
+} GroupPacket;
+
+/**
+ * @brief a member stream of the group
+ */
+typedef struct GroupStream {
+    struct DecoderGroup* group;
+    /* the context decoding the stream, only used by the worker decoding the stream */
+    H264Context* context;
+
+    /* the packets, written by the application and read by the worker. the packet counts are guarded by the mutex of the group */
+    GroupPacket packets[H264_GROUP_INPUT_DEPTH];
+    uint32_t submitted_packets;
+    uint32_t decoded_packets;
+
+    /* the output frames, written by the worker and taken by the application. the frame counts are guarded by the mutex of the group */
+    DecodedFrame frames[H264_GROUP_OUTPUT_DEPTH];
+    uint32_t output_frames;
+    uint32_t received_frames;
+    /* the context may have frames which did not fit the output queue */
+    int32_t frames_pending;
+
+    /* the application has ended the stream, and the worker has flushed the context after the last packet */
+    int32_t ended;
+    int32_t flushed;
+    /* the stream is in the run queue or decoded by a worker */
+    int32_t scheduled;
+    /* the stream is being removed, it is not scheduled any more */
+    int32_t removed;
+    /* the budget has no room for the next picture of the stream until the application releases a frame, the packets wait until a frame is received */
+    int32_t starved;
+    /* the first error of the decoding, the decoding goes on with the next NALU */
+    int err_code;
+
+    /* the next stream of the run queue */
+    struct GroupStream* next;
+    /* signaled when the worker has decoded a packet of the stream */
+    pthread_cond_t progress;
+} GroupStream;
+
+/**
+ * @brief the workers, the run queue and the state shared by the members
+ */
+typedef struct DecoderGroup {
+    pthread_t threads[H264_MAX_GROUP_THREADS];
+    int32_t thread_count;
+
+    pthread_mutex_t mutex;
+    /* signaled when a stream is queued or the workers quit */
+    pthread_cond_t work;
+    /* the runnable streams in the order in which they are decoded */
+    GroupStream* run_head;
+    GroupStream* run_tail;
+
+    /* the pictures freed by the members */
+    SharedPicturePool pictures;
+    int32_t quit;
+
+    /* the budget of the members and of the shared pool, and the memory limit of the streams added next */
+    MemoryBudget memory;
+    size_t stream_memory_limit;
+} DecoderGroup;
+
+/**
+ * @brief create the group and start its workers
+ *
+ * @param thread_count the number of the worker threads, 1 to H264_MAX_GROUP_THREADS
+ * @return DecoderGroup* the group, return 0 if the creation fails
+ */
+DecoderGroup* create_decoder_group(int32_t thread_count);
+
+/**
+ * @brief stop the workers and free the group, the streams MUST be removed before
+ * the parameter group pointer becomes an invalid pointer after this free_decoder_group() was invoked
+ *
+ * @param group the group
+ */
+void free_decoder_group(DecoderGroup* group);
+
+/**
+ * @brief set the cap of the memory of the group, the pictures of its members and of the shared pool. the idle pictures of the shared pool are freed if they do
+ * not fit
+ *
+ * @param group the group
+ * @param limit the cap in bytes, 0 for none
+ * @return int 0 on success, negative value on error. ERR_MEMORY_BUDGET_EXCEEDED if the members take more memory or reserve more
+ */
+int set_group_memory_limit(DecoderGroup* group, size_t limit);
+
+/**
+ * @brief set the memory limit of the streams added next, see set_memory_limit(). the limit of a stream is reserved from the limit of the group
+ *
+ * @param group the group
+ * @param limit the cap in bytes, 0 for none
+ */
+void set_group_stream_memory_limit(DecoderGroup* group, size_t limit);
+
+/**
+ * @brief get the current and the peak bytes of the group by category
+ *
+ * @param group the group
+ * @param usage output parameter. the counters
+ */
+void get_group_memory_usage(DecoderGroup* group, MemoryUsage* usage);
+
+/**
+ * @brief add a stream to the group
+ *
+ * @param group the group
+ * @return GroupStream* the stream, return 0 if the creation fails or the group has no room for the memory limit of the stream
+ */
+GroupStream* add_group_stream(DecoderGroup* group);
+
+/**
+ * @brief remove the stream from the group, the packets which are not decoded and the frames which are not received are dropped. the frames received by the
+ * application stay valid until they are released
+ * the parameter stream pointer becomes an invalid pointer after this remove_group_stream() was invoked
+ *
+ * @param stream the stream
+ */
+void remove_group_stream(GroupStream* stream);
+
+/**
+ * @brief queue a packet of the byte stream to the stream, the packet holds whole NALUs with their start codes, usually an access unit. the data is copied
+ *
+ * @param stream the stream
+ * @param data the packet
+ * @param size the size of the packet in bytes
+ * @param pts the presentation timestamp of the access unit started in the packet, H264_NO_TIMESTAMP if none
+ * @param dts the decoding timestamp
+ * @return int 0 on success, negative value on error. ERR_STREAM_QUEUE_FULL if H264_GROUP_INPUT_DEPTH packets are waiting, the frames are to be received first
+ */
+int submit_group_packet(GroupStream* stream, const uint8_t* data, size_t size, int64_t pts, int64_t dts);
+
+/**
+ * @brief end the stream, every decoded frame is output once the queued packets are decoded
+ *
+ * @param stream the stream
+ * @return int 0 on success, negative value on error
+ */
+int end_group_stream(GroupStream* stream);
+
+/**
+ * @brief receive the next frame of the stream in the output order, see receive_frame()
+ *
+ * @param stream the stream
+ * @param frame output parameter. the frame handle, the application releases it by release_frame()
+ * @param wait 1 to wait until the queued packets output a frame
+ * @return int 0 on success, negative value on error. ERR_NO_FRAME if no frame is output and, when waiting, no packet is waiting to be decoded or the stream waits
+ * for the application to release frames. ERR_EOS once all the frames of the ended stream are received
+ */
+int receive_group_frame(GroupStream* stream, DecodedFrame* frame, int wait);
+
+/**
+ * @brief get the first error of the decoding of the stream
+ *
+ * @param stream the stream
+ * @return int 0 if every NALU is decoded, the negative error code of the first NALU which failed otherwise
+ */
+int get_group_stream_error(GroupStream* stream);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef _H_H264_DEFS_H_
 #define _H_H264_DEFS_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -92,6 +93,24 @@
 /* the invalid SPS id indicating the SPS which is not used yet */
 #define H264_INVALID_SPS_ID 0xFFFFFFFF
 
+/**
+ * @brief the bit layout of MacroBlock::coded_block_flags, one bit per transform block which has non-zero transform coefficient levels
+ * @see 7.4.5.3.3 Residual block CABAC semantics
+ *
+ * bits 0 to 15 are the luma 4x4 blocks indexed by luma4x4BlkIdx, an 8x8 luma block sets the four bits of its 4x4 blocks.
+ * bits 16 to 23 are the Cb 4x4 AC blocks and bits 24 to 31 are the Cr 4x4 AC blocks indexed by chroma4x4BlkIdx, ChromaArrayType equal to 1 or 2.
+ */
+#define H264_CBF_LUMA_MASK 0x0000FFFFu
+#define H264_CBF_CB_SHIFT 16
+#define H264_CBF_CR_SHIFT 24
+
+/**
+ * @brief the bit layout of MacroBlock::coded_block_flags_dc
+ */
+#define H264_CBF_DC_LUMA 0x01u
+#define H264_CBF_DC_CB 0x02u
+#define H264_CBF_DC_CR 0x04u
+
 /**
  * @brief the H.264 Macroblock part prediction mode
  *
@@ -248,6 +267,7 @@ typedef enum MB_TYPE_NAME {
     B_L1_4x4,     /* 11 */
     B_Bi_4x4,     /* 12 */
 
+    MB_TYPE_NAME_NUM, /* the number of the macroblock type names */
 } MB_TYPE_NAME;
 
 typedef enum NALU_PRIORITY { HIGHEST = 3, HIGH = 2, LOW = 1, DISPOSABLE = 0 } NALU_PRIORITY;
@@ -338,85 +358,43 @@ typedef enum PICTURE_CODED_TYPE {
 } PICTURE_CODED_TYPE;
 
 /**
- * @brief macroblock types for I slices
+ * @brief the properties of a macroblock type or a sub-macroblock type, indexed by MB_TYPE_NAME
  * @see Table 7-11 – Macroblock types for I slices
- */
-typedef struct MB_TYPE_FOR_I_SLICES {
-    int32_t mb_type;
-    MB_TYPE_NAME mb_type_name;
-    int32_t transform_size_8x8_flag;
-    H264_MB_PART_PRED_MODE MbPartPredMode;
-    int32_t Intra16x16PredMode;
-    int32_t CodedBlockPatternChroma;
-    int32_t CodedBlockPatternLuma;
-} MB_TYPE_FOR_I_SLICES;
-
-/**
- * @brief Macroblock type with value 0 for SI slices
  * @see Table 7-12 – Macroblock type with value 0 for SI slices
- */
-typedef struct MB_TYPE_FOR_SI_SLICES {
-    int32_t mb_type;
-    MB_TYPE_NAME mb_type_name;
-    H264_MB_PART_PRED_MODE MbPartPredMode;
-    int32_t Intra16x16PredMode;
-    int32_t CodedBlockPatternChroma;
-    int32_t CodedBlockPatternLuma;
-} MB_TYPE_FOR_SI_SLICES;
-
-/**
- * @brief Macroblock type values 0 to 4 for P and SP slices
  * @see Table 7-13 – Macroblock type values 0 to 4 for P and SP slices
- */
-typedef struct MB_TYPE_FOR_P_SP_SLICES {
-    int32_t mb_type;
-    MB_TYPE_NAME mb_type_name;
-    int32_t NumMbPart;
-    H264_MB_PART_PRED_MODE MbPartPredMode0;
-    H264_MB_PART_PRED_MODE MbPartPredMode1;
-    int32_t MbPartWidth;
-    int32_t MbPartHeight;
-} MB_TYPE_FOR_P_SP_SLICES;
-
-/**
- * @brief Macroblock type values 0 to 22 for B slices
  * @see Table 7-14 – Macroblock type values 0 to 22 for B slices
- */
-typedef struct MB_TYPE_FOR_B_SLICES {
-    int32_t mb_type;
-    MB_TYPE_NAME mb_type_name;
-    int32_t NumMbPart;
-    H264_MB_PART_PRED_MODE MbPartPredMode0;
-    H264_MB_PART_PRED_MODE MbPartPredMode1;
-    int32_t MbPartWidth;
-    int32_t MbPartHeight;
-} MB_TYPE_FOR_B_SLICES;
-
-/**
- * @brief Sub-macroblock types in P macroblocks
  * @see Table 7-17 – Sub-macroblock types in P macroblocks
- */
-typedef struct SUB_MB_TYPE_IN_P_MB {
-    int32_t sub_mb_type;
-    MB_TYPE_NAME sub_mb_type_name;
-    int32_t NumSubMbPart;
-    H264_MB_PART_PRED_MODE SubMbPredMode;
-    int32_t SubMbPartWidth;
-    int32_t SubMbPartHeight;
-} SUB_MB_TYPE_IN_P_MB;
-
-/**
- * @brief Sub-macroblock types in B macroblocks
  * @see Table 7-18 – Sub-macroblock types in B macroblocks
  */
-typedef struct SUB_MB_TYPE_IN_B_MB {
-    int32_t sub_mb_type;
-    MB_TYPE_NAME sub_mb_type_name;
-    int32_t NumSubMbPart;
-    H264_MB_PART_PRED_MODE SubMbPredMode;
-    int32_t SubMbPartWidth;
-    int32_t SubMbPartHeight;
-} SUB_MB_TYPE_IN_B_MB;
+typedef struct MB_TYPE_INFO {
+    /* mb_type or sub_mb_type in the table of the slice type */
+    int8_t mb_type;
+    /* NumMbPart( mb_type ) or NumSubMbPart( sub_mb_type ), -1 for na */
+    int8_t NumMbPart;
+    /* MbPartWidth( mb_type ) or SubMbPartWidth( sub_mb_type ), 0 for the intra macroblock types */
+    int8_t MbPartWidth;
+    /* MbPartHeight( mb_type ) or SubMbPartHeight( sub_mb_type ), 0 for the intra macroblock types */
+    int8_t MbPartHeight;
+    /* MbPartPredMode( mb_type, 0 ) or SubMbPredMode( sub_mb_type ), H264_MB_PART_PRED_MODE */
+    uint8_t MbPartPredMode0;
+    /* MbPartPredMode( mb_type, 1 ), H264_MB_PART_PRED_MODE */
+    uint8_t MbPartPredMode1;
+    /* Intra16x16PredMode, -1 for na */
+    int8_t Intra16x16PredMode;
+    /* CodedBlockPatternChroma of Intra_16x16, 0 for the other macroblock types */
+    int8_t CodedBlockPatternChroma;
+    /* CodedBlockPatternLuma of Intra_16x16, 0 for the other macroblock types */
+    int8_t CodedBlockPatternLuma;
+    /* 1 for the sub-macroblock types of Table 7-17 and Table 7-18 */
+    uint8_t is_sub_mb_type;
+    /**
+     * the upper-left luma sample location of the partitions, indexed by mbPartIdx or subMbPartIdx
+     * InverseRasterScan( mbPartIdx, MbPartWidth( mb_type ), MbPartHeight( mb_type ), 16, 0 or 1 ) for the macroblock types
+     * InverseRasterScan( subMbPartIdx, SubMbPartWidth( sub_mb_type ), SubMbPartHeight( sub_mb_type ), 8, 0 or 1 ) for the sub-macroblock types
+     */
+    uint8_t part_x[4];
+    uint8_t part_y[4];
+} MB_TYPE_INFO;
 
 /**
  * @brief the NALU free function pointer
@@ -680,6 +658,12 @@ typedef struct {
      * otherwise (separate_colour_plane_flag is equal to 1), ChromaArrayType is set equal to 0.
      */
     uint32_t ChromaArrayType;
+
+    /**
+     * the maximum number of frames in the DPB, MaxDpbFrames = Min( MaxDpbMbs / ( PicWidthInMbs * FrameHeightInMbs ), 16 )
+     * MaxDpbMbs is specified in Table A-1 – Level limits. when max_dec_frame_buffering is present, it is the DPB size instead.
+     */
+    uint32_t MaxDpbFrames;
 } SPS;
 
 /* @see 7.3.2.2 Picture parameter set RBSP syntax */
@@ -745,6 +729,10 @@ typedef struct {
     /********************** the following data members are not in the PPS H.264 bit stream ************************/
     int32_t* mapUnitToSliceGroupMap;
 
+    /* LevelScale4x4( m, i, j ) and LevelScale8x8( m, i, j ) of the scaling lists, indexed by [ list ][ m ][ i * N + j ], see derivation_for_level_scale() */
+    int32_t LevelScale4x4[6][6][16];
+    int32_t LevelScale8x8[6][6][64];
+
 } PPS;
 
 /**
@@ -847,6 +835,27 @@ typedef struct {
     /* end for slice_type %5 == 1*/
 } PredWeightTable;
 
+/**
+ * @brief the weights of the weighted sample prediction derived once per slice, see derivation_for_explicit_weights() and derivation_for_implicit_weights()
+ * @see 8.4.2.3 Weighted sample prediction process
+ */
+typedef struct {
+    /* 0 default, 1 explicit, 2 implicit. weighted_pred_flag for P and SP slices, weighted_bipred_idc for B slices */
+    int32_t weighted_mode;
+
+    /* logWD of luma, Cb and Cr */
+    int32_t logWD[3];
+    /* the explicit weights w0, w1 and offsets o0, o1 of list 0 and 1 indexed by refIdxLXWP, for luma, Cb and Cr. the offsets are scaled to the bit depth */
+    int16_t w[2][H264_MAX_REFS][3];
+    int16_t o[2][H264_MAX_REFS][3];
+
+    /**
+     * the implicit weight w1 indexed by refIdxL0 and refIdxL1, w0 = 64 - w1, logWD is 5 and the offsets are 0. the table 0 is used for the frame and field pictures and
+     * the frame macroblocks, the tables 1 and 2 for the top and bottom field macroblocks of a MBAFF frame
+     */
+    int16_t implicit_w1[3][H264_MAX_REFS][H264_MAX_REFS];
+} PredWeights;
+
 /**
  * @brief Decoded Reference picture marking
  * @see 7.3.3.3 Decoded reference picture marking syntax
@@ -1031,6 +1040,9 @@ typedef struct {
     /* QSY = 26 + pic_init_qs_minus26 + slice_qs_delta */
     int32_t QSY;
 
+    /* the weights of the weighted sample prediction of this slice */
+    PredWeights pred_weights;
+
     /* map unit to slice group map */
     int32_t* mapUnitToSliceGroupMap;
     /* macroblock to slice group map*/
@@ -1043,40 +1055,163 @@ typedef struct {
 
 } SliceHeader;
 
+/**
+ * @brief the macroblock metadata which stays alive for the whole picture, it is read by the neighbouring macroblocks, the deblocking filter and the later pictures.
+ *
+ * the record is kept within 64 bytes so that a neighbour lookup touches one cache line. the transform coefficient levels, the PCM samples and the syntax elements which are
+ * only used while the macroblock is decoded are in MacroBlockScratch. slice_id, mb_skip_flag, mb_field_decoding_flag, the macroblock type name and QPY are in the
+ * parallel arrays of FrameOrField.
+ */
 typedef struct {
-    int32_t mb_type;
-    int32_t slice_id;
-    int32_t mb_field_decoding_flag;
-    int32_t mb_skip_flag;
-    int32_t transform_size_8x8_flag;
-    int32_t coded_block_pattern;
-    int32_t mb_qp_delta;
-    int32_t intra_chroma_pred_mode;
+    /* TotalCoeff( coeff_token ) of the luma, Cb and Cr 4x4 blocks, 4 bits per block indexed by the 4x4 block index, used by the nC derivation of clause 9.2.1.
+     * the value 16 is saturated to 15, it gives the same nC table selection because nC is greater than or equal to 8 in both cases */
+    uint64_t total_coeff[3];
+
+    /* Intra4x4PredMode of the 4x4 luma blocks, 4 bits per block indexed by luma4x4BlkIdx. Intra8x8PredMode is stored in the 4 blocks of the 8x8 block */
+    uint64_t intra_pred_modes;
+
+    /* the non-zero transform block mask, see H264_CBF_LUMA_MASK. it is written once by the residual parsing */
+    uint32_t coded_block_flags;
+    /* the Cb (bits 0 to 15) and Cr (bits 16 to 31) 4x4 blocks mask for ChromaArrayType equal to 3 */
+    uint32_t coded_block_flags_444;
+
+    /* the revised mb_type, see revise_slice_type_mb_type() */
+    uint8_t mb_type;
+    /* H264_MB_PART_PRED_MODE */
+    uint8_t mb_pred_type;
+    uint8_t transform_size_8x8_flag;
+    uint8_t coded_block_pattern;
+    uint8_t CodedBlockPatternLuma;
+    uint8_t CodedBlockPatternChroma;
+    uint8_t intra_chroma_pred_mode;
+    uint8_t constrained_intra_pred_flag;
+    /* the DC blocks mask, see H264_CBF_DC_LUMA */
+    uint8_t coded_block_flags_dc;
+    /* MB_TYPE_NAME of the sub-macroblocks */
+    uint8_t sub_mb_type_name[4];
 
-    H264_MB_PART_PRED_MODE mb_pred_type;
+    int8_t mb_qp_delta;
+} MacroBlock;
 
-    MB_TYPE_NAME mb_type_name;
+/**
+ * @brief the scaled transform coefficients of the macroblock, the input of the inverse transforms
+ * @see 8.5 Transform coefficient decoding process and picture construction process prior to deblocking filter process
+ *
+ * the coefficients d[ i ][ j ] of a block are in raster order, i * N + j. the 4x4 blocks are stored in raster block order, so the blocks of a 4-sample row of the
+ * macroblock are consecutive and the blocks of the whole row are transformed by one call.
+ */
+typedef struct {
+    /* the 16 luma 4x4 blocks in raster block order, or the 4 luma 8x8 blocks when transform_size_8x8_flag is equal to 1 */
+    int16_t luma[256];
+    /* the Cb and Cr 4x4 blocks in raster block order, 4 blocks for ChromaArrayType equal to 1 and 8 blocks for ChromaArrayType equal to 2. the blocks of
+     * ChromaArrayType equal to 3 have the layout of the luma blocks */
+    int16_t chroma[2][256];
+
+    /* the blocks with non-zero coefficients, bit n for the n-th block in raster block order */
+    uint16_t luma_nz;
+    /* the blocks with a non-zero AC coefficient, the other blocks in luma_nz have the DC coefficient only */
+    uint16_t luma_ac;
+    uint16_t chroma_nz[2];
+    uint16_t chroma_ac[2];
+} TransformCoeffs;
 
-    int32_t CodedBlockPatternLuma;
-    int32_t CodedBlockPatternChroma;
-    int32_t constrained_intra_pred_flag;
+/**
+ * @brief the scaled transform coefficients of the bit depths greater than 8, the fields are the ones of TransformCoeffs
+ */
+typedef struct {
+    int32_t luma[256];
+    int32_t chroma[2][256];
+
+    uint16_t luma_nz;
+    uint16_t luma_ac;
+    uint16_t chroma_nz[2];
+    uint16_t chroma_ac[2];
+} TransformCoeffs16;
+
+/* the cache entry of a neighbouring partition which is not available, or of a partition of the current macroblock which is not decoded yet */
+#define H264_MV_CACHE_NA (-2)
+
+/* the number of the entries of MvCache, 8 entries per row for the row above the macroblock and the 4 rows of the macroblock */
+#define H264_MV_CACHE_SIZE 40
 
+/**
+ * @brief the index of the 4x4 block ( x4, y4 ) in MvCache, x4 in -1..4 and y4 in -1..3 are relative to the upper-left 4x4 block of the macroblock.
+ * the neighbouring partitions A, B, C and D of the block at index idx are at idx - 1, idx - 8, idx - 8 + predPartWidth / 4 and idx - 9
+ */
+#define MV_CACHE_IDX(x4, y4) (9 + (y4) * 8 + (x4))
+
+/**
+ * @brief the motion vectors and the reference indices of the macroblock being decoded and of its neighbouring 4x4 blocks
+ * @see 8.4.1.3.2 Derivation process for motion data of neighbouring partitions
+ *
+ * the column left of the macroblock and the row above it are loaded once per macroblock, the vertical motion vector components and the reference indices of the
+ * neighbouring macroblocks are already scaled for the frame or field macroblock in MBAFF frames. the entries of the macroblock are H264_MV_CACHE_NA until the partition is
+ * decoded, and the entries right of the macroblock stay H264_MV_CACHE_NA, so the partition C which is not available falls back to D by one compare.
+ */
+typedef struct {
+    /* mvL0 and mvL1 */
+    int16_t mv[2][H264_MV_CACHE_SIZE][2];
+    /* refIdxL0 and refIdxL1, -1 if predFlagLX is 0 or the macroblock is intra, H264_MV_CACHE_NA if the partition is not available */
+    int8_t ref[2][H264_MV_CACHE_SIZE];
+    /* the absolute values of the components of mvd_l0 and mvd_l1, used by the ctxIdxInc derivation of mvd */
+    uint8_t mvd[2][H264_MV_CACHE_SIZE][2];
+    /* 1 for the blocks of B_Skip, B_Direct_16x16 and B_Direct_8x8, used by the ctxIdxInc derivation of ref_idx */
+    uint8_t direct[H264_MV_CACHE_SIZE];
+} MvCache;
+
+/**
+ * @brief the CABAC decoding engine of the slice being decoded
+ * @see 9.3.1 Initialization process
+ */
+typedef struct {
+    /* probability state index */
+    int32_t pStateIdx[H264_MAX_CONTEXT_INDEX];
+
+    /* the value of the most probable symbol*/
+    int32_t valMPS[H264_MAX_CONTEXT_INDEX];
+
+    int32_t codIRange;
+    int32_t codIOffset;
+} CABAC;
+
+/**
+ * @brief the data of the macroblock being decoded, it is reused by every macroblock
+ */
+typedef struct {
     uint32_t pcm_sample_luma[256];
     uint32_t pcm_sample_chroma[512];
 
-    int32_t     prev_intra4x4_pred_mode_flag[16];
-    int32_t     rem_intra4x4_pred_mode[16];
+    int32_t prev_intra4x4_pred_mode_flag[16];
+    int32_t rem_intra4x4_pred_mode[16];
 
-    int32_t     prev_intra8x8_pred_mode_flag[4];
-    int32_t     rem_intra8x8_pred_mode[4];
+    int32_t prev_intra8x8_pred_mode_flag[4];
+    int32_t rem_intra8x8_pred_mode[4];
 
-    int32_t     i16x16DClevel[16];
-    int32_t     i16x16AClevel[16][16];
-    int32_t     level4x4[16][16];
-    int32_t     level8x8[4][64];
+    /* the levels of residual_luma(), indexed by the colour component. the Cb and Cr levels are used for ChromaArrayType equal to 3 only */
+    int32_t i16x16DClevel[3][16];
+    int32_t i16x16AClevel[3][16][16];
+    int32_t level4x4[3][16][16];
+    int32_t level8x8[3][4][64];
 
-    MB_TYPE_NAME sub_mb_type_name[4];
-} MacroBlock;
+    int32_t ChromaDCLevel[2][8];
+    int32_t ChromaACLevel[2][8][15];
+
+    /* the levels above after the inverse scanning and scaling, see scaling_for_residual() */
+    TransformCoeffs coeffs;
+    /* the scaled coefficients of the bit depths greater than 8, scaling_for_residual() fills one of coeffs and coeffs16 */
+    TransformCoeffs16 coeffs16;
+
+    /* ref_idx_l0 and ref_idx_l1 of the macroblock partitions or the sub-macroblocks, indexed by mbPartIdx */
+    int32_t ref_idx[2][4];
+    /* mvd_l0 and mvd_l1, indexed by mbPartIdx, subMbPartIdx and compIdx */
+    int32_t mvd[2][4][4][2];
+
+    /* the motion data of the macroblock and its neighbours, see init_mv_cache() */
+    MvCache mv_cache;
+
+    /* the decoding engine of the slice, every thread decoding slice data has its own scratch and so its own engine */
+    CABAC cabac;
+} MacroBlockScratch;
 
 /**
  * @brief the default value for scaling lists
@@ -0,0 +1,143 @@
+#ifndef _H_H264_DPB_H_
+#define _H_H264_DPB_H_
+
+#include <stdint.h>
+
+#include "h264_defs.h"
+#include "h264_error.h"
+#include "h264_picture.h"
+
+/**
+ * Decoded picture buffer
+ *
+ * @see 8.2.5 Decoded reference picture marking process
+ * @see C.4 Bitstream conformance
+ *
+ * The DPB holds the frame stores of the decoded frames, complementary field pairs and non-paired fields which are marked as used for reference or wait for the
+ * output. Every stored picture is retained by the DPB and released to the picture pool as soon as both of its fields are unused for reference and it is not
+ * needed for the output, so the pool holds only the pictures the stream refers to.
+ *
+ * The marking is kept per field in Picture::ref_marking, a frame has both fields marked. After a picture is decoded, decoded_reference_picture_marking() marks
+ * it by the sliding window or by the memory management control operations of its slice header, then store_picture_in_dpb() removes the unused frame stores and
+ * stores the picture. The gaps in frame_num are filled with the non-existing frames by fill_frame_num_gap() before the decoding of the next picture starts.
+ *
+ * The pictures are output by the bumping process in the order of their picture order counts. output_pictures() outputs a picture as soon as more pictures wait
+ * for the output than max_num_reorder_frames allows, so the streams without reordering, pic_order_cnt_type 2 or max_num_reorder_frames equal to 0, output
+ * every picture when it is decoded. The output pictures wait in the output queue until the application takes them by get_output_picture_from_dpb().
+ */
+
+/**
+ * @brief the decoded picture buffer
+ */
+typedef struct {
+    /* the frame stores in decoding order, one more for the decoded picture stored before the bumping process empties a frame store */
+    Picture* frames[H264_MAX_DPB_FRAMES + 1];
+    /* the number of the frame stores in use */
+    int32_t size;
+    /* the number of the frame stores of the active sps, see get_dpb_frame_count() */
+    int32_t capacity;
+    /* Max( max_num_ref_frames, 1 ) of the active sps */
+    int32_t max_num_ref_frames;
+    /* MaxFrameNum of the active sps */
+    int32_t MaxFrameNum;
+    /* MaxLongTermFrameIdx, -1 for "no long-term frame indices" */
+    int32_t MaxLongTermFrameIdx;
+    /* PrevRefFrameNum, frame_num of the previous reference picture, 0 after an IDR picture or memory_management_control_operation equal to 5 */
+    int32_t PrevRefFrameNum;
+
+    /* the number of the pictures which may precede a picture in the decoding order and follow it in the output order. max_num_reorder_frames of the active sps,
+     * 0 for pic_order_cnt_type 2 */
+    int32_t max_num_reorder_frames;
+    /* the output pictures in the output order, each of them is retained by the queue until the application takes it */
+    Picture* output_queue[H264_MAX_DPB_FRAMES];
+    int32_t output_head;
+    int32_t output_count;
+    /* the number of the pictures whose decoding started, the decode_index of the next picture */
+    uint32_t decode_count;
+} DecodedPictureBuffer;
+
+/**
+ * @brief set the parameters of the active sps, it is invoked at the start of every picture. the stored frame stores are kept
+ *
+ * @param dpb the DPB
+ * @param sps the active sps
+ */
+void init_dpb(DecodedPictureBuffer* dpb, SPS* sps);
+
+/**
+ * @brief check whether the slice starts the second field of the picture, the two fields are decoded into the same frame store
+ * @see 3.30 complementary non-reference field pair
+ * @see 3.31 complementary reference field pair
+ *
+ * @param first the previously decoded picture
+ * @param header the header of the first slice of the next picture
+ * @return int 1 if the slice starts the second field of the picture, 0 otherwise
+ */
+int is_second_field_of_picture(const Picture* first, const SliceHeader* header);
+
+/**
+ * @brief Decoded reference picture marking process of the decoded frame or field
+ * @see 8.2.5.1 Sequence of operations for decoded reference picture marking process
+ *
+ * @param dpb the DPB
+ * @param picture the picture, the frame or field of the slice header is decoded
+ * @param header a slice header of the decoded frame or field
+ * @return int 0 on success, negative value on error
+ */
+int decoded_reference_picture_marking(DecodedPictureBuffer* dpb, Picture* picture, SliceHeader* header);
+
+/**
+ * @brief release the frame stores which are unused for reference and not needed for the output, then store the picture if it is used for reference or needed
+ * for the output and not stored yet. the DPB may hold one frame store more than its capacity until output_pictures() is invoked
+ *
+ * @param dpb the DPB
+ * @param pool the picture pool
+ * @param picture the decoded picture
+ * @return int 0 on success, negative value on error
+ */
+int store_picture_in_dpb(DecodedPictureBuffer* dpb, PicturePool* pool, Picture* picture);
+
+/**
+ * @brief Decoding process for gaps in frame_num, the non-existing frames are marked by the sliding window and stored
+ * @see 8.2.5.2 Decoding process for gaps in frame_num
+ *
+ * @param dpb the DPB
+ * @param pool the picture pool
+ * @param sps the active sps
+ * @param header the header of the first slice of the picture following the gap
+ * @return int 0 on success, negative value on error
+ */
+int fill_frame_num_gap(DecodedPictureBuffer* dpb, PicturePool* pool, SPS* sps, SliceHeader* header);
+
+/**
+ * @brief "bumping" process, output the pictures with the smallest picture order count until no more pictures wait for the output than max_num_reorder_frames
+ * and the frame stores fit the capacity. the oldest short-term reference frame is dropped if the reference frames alone exceed the capacity
+ * @see C.4.5.3 The "bumping" process
+ *
+ * @param dpb the DPB
+ * @param pool the picture pool
+ * @param flush 1 to output all the pictures waiting for the output, at the end of the stream, an IDR picture or memory_management_control_operation equal to 5
+ * @return int 0 on success, negative value on error. ERR_DPB_FULL if the frame stores exceed the capacity since the output queue is full
+ */
+int output_pictures(DecodedPictureBuffer* dpb, PicturePool* pool, int flush);
+
+/**
+ * @brief take the next picture from the output queue, the caller holds the picture and releases it to the picture pool by release_picture()
+ *
+ * @param dpb the DPB
+ * @return Picture* the picture, 0 if no picture is output
+ */
+Picture* get_output_picture_from_dpb(DecodedPictureBuffer* dpb);
+
+/**
+ * @brief mark all the reference pictures as unused for reference and empty the DPB, the pictures waiting for the output are output unless
+ * no_output_of_prior_pics_flag is 1
+ * @see C.4.4 Removal of pictures from the DPB before possible insertion of the current picture
+ *
+ * @param dpb the DPB
+ * @param pool the picture pool
+ * @param no_output_of_prior_pics_flag no_output_of_prior_pics_flag of the IDR picture
+ */
+void flush_dpb(DecodedPictureBuffer* dpb, PicturePool* pool, int no_output_of_prior_pics_flag);
+
+#endif
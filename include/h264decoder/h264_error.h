@@ -124,4 +124,34 @@
 /* invalid context block category */
 #define ERR_CTX_BLOCK_CATEGORY (-2041)
 
+/* invalid CAVLC code word of coeff_token, total_zeros or run_before */
+#define ERR_CAVLC_INVALID_CODE (-2042)
+
+/* invalid CAVLC level_prefix */
+#define ERR_CAVLC_INVALID_LEVEL_PREFIX (-2043)
+
+/* the CAVLC coefficients exceed the block */
+#define ERR_CAVLC_COEFF_OVERFLOW (-2044)
+
+/* the reference index exceeds the reference picture list */
+#define ERR_INVALID_REF_IDX (-2045)
+
+/* the co-located picture of the direct prediction is not available */
+#define ERR_NO_COLOCATED_PICTURE (-2046)
+
+/* all the pictures of the picture pool are in use */
+#define ERR_PICTURE_POOL_EXHAUSTED (-2047)
+
+/* the decoded picture buffer has no frame store for the picture */
+#define ERR_DPB_FULL (-2048)
+
+/* no decoded frame is output */
+#define ERR_NO_FRAME (-2049)
+
+/* the input queue of the stream is full */
+#define ERR_STREAM_QUEUE_FULL (-2050)
+
+/* the allocation exceeds the memory budget of the context or of its decoder group */
+#define ERR_MEMORY_BUDGET_EXCEEDED (-2051)
+
 #endif
\ No newline at end of file
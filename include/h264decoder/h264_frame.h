@@ -0,0 +1,159 @@
+#ifndef _H_H264_FRAME_H_
+#define _H_H264_FRAME_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "h264_error.h"
+#include "h264_picture.h"
+
+/**
+ * Zero-copy frame delivery
+ *
+ * The output pictures are handed to the application as frame handles which point to the sample planes of the pictures of the pool, the samples are never
+ * copied. A picture counts the handles of the application in Picture::frame_ref_count and holds one reference of the pool for all of them. The handles are
+ * duplicated by ref_frame() and released by release_frame() on any thread; when the last handle of a picture is released, the picture is queued for the
+ * decoding thread, which returns it to the pool before it takes the next picture, so the pool itself is only used by the decoding thread.
+ *
+ * If the pool has no free picture since the application holds the frames, the decoder fails, grows the pool or blocks until the application releases a frame,
+ * as FRAME_POOL_POLICY selects.
+ *
+ * The frames may outlive the context. When the context is freed while the application holds frames, the delivery is closed instead of freed: the pictures of
+ * the held frames leave the pool, and the last release_frame() of each picture frees it, and the last one of all frees the delivery.
+ */
+
+/**
+ * @brief the behaviour of the decoder when every picture of the pool is in use
+ */
+typedef enum FRAME_POOL_POLICY {
+    FRAME_POOL_FAIL = 0,  /* the decoding of the picture fails with ERR_PICTURE_POOL_EXHAUSTED, or ERR_MEMORY_BUDGET_EXCEEDED if no picture fits the budget */
+    FRAME_POOL_GROW = 1,  /* the pool grows up to H264_MAX_POOL_PICTURES pictures or the memory budget, then the decoding fails */
+    FRAME_POOL_BLOCK = 2, /* the decoding waits until the application releases a frame, it fails if the application holds no frame */
+} FRAME_POOL_POLICY;
+
+/**
+ * @brief the frames held by the application and the pictures whose frames are released
+ */
+typedef struct FrameDelivery {
+    pthread_mutex_t mutex;
+    /* signaled when the last handle of a picture is released */
+    pthread_cond_t released;
+
+    /* the pictures whose last handle is released, they are returned to the pool by the decoding thread */
+    Picture* released_pictures[H264_MAX_POOL_PICTURES];
+    int32_t released_count;
+    /* the number of the pictures held by the application */
+    int32_t held_count;
+    /* the context is freed, the held pictures are freed by their last release_frame() and the delivery by the last one of all */
+    int32_t is_closed;
+} FrameDelivery;
+
+/**
+ * @brief a decoded frame handed to the application, the planes point to the samples of the picture which stay valid until the handle is released
+ */
+typedef struct DecodedFrame {
+    /* the Y, Cb and Cr planes, or the 3 colour planes for separate_colour_plane_flag equal to 1. the Cb and Cr planes are not present for chroma_format_idc 0 */
+    SamplePlane planes[3];
+    int32_t plane_count;
+    uint32_t chroma_format_idc;
+    uint32_t BitDepthY;
+    uint32_t BitDepthC;
+
+    /* the cropping rectangle in luma samples */
+    int32_t crop_left;
+    int32_t crop_top;
+    int32_t crop_width;
+    int32_t crop_height;
+
+    /* PicOrderCnt( ) of the frame or field */
+    int32_t poc;
+    /* the timestamps of the access unit, H264_NO_TIMESTAMP if the application has set none */
+    int64_t pts;
+    int64_t dts;
+    /* the index of the picture in the decoding order and the number of the pictures started between its decoding and its output */
+    uint32_t decode_index;
+    int32_t output_latency;
+
+    /* the picture holding the samples and the delivery it returns to, 0 for an empty handle */
+    Picture* picture;
+    FrameDelivery* delivery;
+} DecodedFrame;
+
+/**
+ * @brief create the frame delivery
+ *
+ * @return FrameDelivery* the frame delivery, return 0 if the creation fails
+ */
+FrameDelivery* create_frame_delivery();
+
+/**
+ * @brief free the frame delivery, the application MUST have released all of its frames and the released pictures MUST be taken
+ * the parameter delivery pointer becomes an invalid pointer after this free_frame_delivery() was invoked
+ *
+ * @param delivery the frame delivery
+ */
+void free_frame_delivery(FrameDelivery* delivery);
+
+/**
+ * @brief close the frame delivery of a freed context. the pictures held by the application are detached from the pool, the delivery frees them when their
+ * last frames are released and then frees itself, it is freed at once if the application holds no frame. it is invoked on the decoding thread, and the pool
+ * is freed after it
+ * the parameter delivery pointer becomes an invalid pointer for the context after this close_frame_delivery() was invoked
+ *
+ * @param delivery the frame delivery
+ * @param pool the picture pool of the frames
+ */
+void close_frame_delivery(FrameDelivery* delivery, PicturePool* pool);
+
+/**
+ * @brief hand the output picture to the application, the handle takes over the reference of the pool which the caller holds
+ *
+ * @param delivery the frame delivery
+ * @param picture the output picture
+ * @param frame output parameter. the frame handle
+ */
+void attach_frame(FrameDelivery* delivery, Picture* picture, DecodedFrame* frame);
+
+/**
+ * @brief take the pictures whose frames are released by the application, the caller returns them to the pool
+ *
+ * @param delivery the frame delivery
+ * @param pictures output parameter. the pictures, H264_MAX_POOL_PICTURES entries
+ * @return int32_t the number of the pictures
+ */
+int32_t take_released_pictures(FrameDelivery* delivery, Picture** pictures);
+
+/**
+ * @brief wait until the application releases a frame
+ *
+ * @param delivery the frame delivery
+ * @return int 1 if a picture is released, 0 if the application holds no frame to wait for
+ */
+int wait_for_released_picture(FrameDelivery* delivery);
+
+/**
+ * @brief check whether the application holds frames
+ *
+ * @param delivery the frame delivery
+ * @return int 1 if the application holds a frame, 0 otherwise
+ */
+int has_held_frames(FrameDelivery* delivery);
+
+/**
+ * @brief duplicate the frame handle, both handles MUST be released. it may be invoked on any thread
+ *
+ * @param dst output parameter. the new handle
+ * @param src the frame handle
+ * @return int 0 on success, negative value on error
+ */
+int ref_frame(DecodedFrame* dst, const DecodedFrame* src);
+
+/**
+ * @brief release the frame handle, the picture is recycled when its last handle is released, or freed if the context is freed. it may be invoked on any
+ * thread, the handle is emptied
+ *
+ * @param frame the frame handle
+ */
+void release_frame(DecodedFrame* frame);
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef _H_H264_FRAME_THREAD_H_
+#define _H_H264_FRAME_THREAD_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "h264_dpb.h"
+#include "h264_error.h"
+#include "h264_nalu.h"
+#include "h264_picture.h"
+#include "h264_rbsp.h"
+#include "h264_reconstruct.h"
+
+/**
+ * Frame-threaded decoding
+ *
+ * Several pictures are decoded at once by a pool of worker threads. The decoding thread parses the slice headers, starts the pictures, constructs the reference
+ * picture lists, marks the pictures and outputs them in the decoding order as the single-threaded decoder does, and queues the slice data of every picture as a
+ * picture job. A worker takes the oldest picture job which no worker decodes and decodes its slices in the decoding order, so the jobs of the earlier pictures
+ * always make progress and a worker waiting for them never deadlocks.
+ *
+ * The worker publishes the progress of the picture in FrameOrField::decoded_mb_rows, the number of the leading macroblock rows which are decoded, for the frame and
+ * for both fields of the picture whatever its coded structure is. The direct prediction of a macroblock of a later picture waits for the row of the co-located
+ * macroblock. The pictures are decoded by the same processes in the same order as on a single thread, so the decoded pictures are identical.
+ *
+ * With the reconstruction of h264_reconstruct.h, the worker also reconstructs the samples of the picture: every macroblock row is reconstructed once it is parsed,
+ * deblocked once the row below it is reconstructed and padded once the deblocking of the row below it is done, see reconstruct_parsed_rows(), and a row is decoded
+ * only when its samples are final. The motion compensation of a macroblock waits until the rows of its reference pictures which it reads are decoded, see
+ * wait_for_macroblock_references(). Every worker has its own reconstruction and deblocking kernels, selected for the bit depths of the pictures which it decodes.
+ *
+ * The progress is published row by row while the slices of the frame or field are decoded in raster order. The frames and fields with several slice groups or
+ * with the slices in arbitrary order publish their progress when they are decoded completely, the decoding thread queues the end of every frame or field to the
+ * job of its picture, see queue_frame_or_field_end().
+ */
+
+/* the maximum number of the worker threads and of the pictures in flight */
+#define H264_MAX_FRAME_THREADS 16
+
+/**
+ * @brief the slice data of a slice, queued to the picture job. the job owns the copy of the slice header with its slice group maps and the RBSP of the slice
+ */
+typedef struct SliceJob {
+    SliceHeader header;
+    /* 1 for the end of the frame or field of header, which has no slice data: its remaining rows are reconstructed and it is decoded completely */
+    int32_t is_end;
+    /* the RBSP of the slice NALU, the reader is positioned at the slice data. the buffer is kept when the slice is decoded and handed back for the next slice */
+    uint8_t* rbsp_buffer;
+    size_t rbsp_capacity;
+    RBSPReader reader;
+    /* the reference picture lists of the slice, see construct_ref_pic_lists() */
+    RefPicLists ref_lists;
+
+    struct SliceJob* next;
+} SliceJob;
+
+/**
+ * @brief the decoding of a picture, the first field and the second field of a complementary field pair are decoded by the same job
+ */
+typedef struct {
+    Picture* picture;
+    /* the slices waiting for the worker in the decoding order */
+    SliceJob* first_slice;
+    SliceJob* last_slice;
+
+    /* no more slices are queued */
+    uint8_t is_closed;
+    /* a worker decodes the job */
+    uint8_t is_taken;
+    /* all the slices of the closed job are decoded */
+    uint8_t is_done;
+    /* the number of the queued slices which are not decoded yet */
+    int32_t pending_slices;
+    /* the first error of the slices of the picture */
+    int err_code;
+
+    /* the frame stores of the DPB when the picture is started, they hold every reference picture of the job and are retained until the job is retired */
+    Picture* refs[H264_MAX_DPB_FRAMES + 1];
+    int32_t ref_count;
+} PictureJob;
+
+/**
+ * @brief a worker thread, the macroblock scratch which it decodes the slices with and the kernels which it reconstructs and deblocks the frames and fields of its
+ * pictures with
+ */
+typedef struct {
+    struct FrameThreads* threads;
+    pthread_t thread;
+    MacroBlockScratch* scratch;
+    Reconstructor* reconstructor;
+    /* the deblocking filter kernels of deblock_bit_depths, the luma and the chroma bit depth */
+    DeblockFuncs deblock_funcs;
+    int32_t deblock_bit_depths[2];
+} FrameWorker;
+
+/**
+ * @brief the worker threads and the picture jobs in flight
+ */
+typedef struct FrameThreads {
+    FrameWorker workers[H264_MAX_FRAME_THREADS];
+    int32_t thread_count;
+
+    pthread_mutex_t mutex;
+    /* signaled when a job is started, a slice is queued, a job is closed or the workers quit */
+    pthread_cond_t work;
+    /* signaled when the progress of a picture changes or a job is done */
+    pthread_cond_t progress;
+
+    /* the jobs in the decoding order, a ring of thread_count jobs starting at job_head */
+    PictureJob jobs[H264_MAX_FRAME_THREADS];
+    int32_t job_head;
+    int32_t job_count;
+    /* the decoded slice jobs, they are reused by the next slices so that the slice jobs and their RBSP buffers are not allocated per slice */
+    SliceJob* free_slices;
+
+    /* the first error of the retired jobs which is not taken by take_frame_thread_error() yet */
+    int err_code;
+    int32_t quit;
+} FrameThreads;
+
+/**
+ * @brief create the worker threads
+ *
+ * @param thread_count the number of the worker threads, 1 to H264_MAX_FRAME_THREADS. as many pictures are decoded at once
+ * @return FrameThreads* the threads, return 0 if the creation fails
+ */
+FrameThreads* create_frame_threads(int32_t thread_count);
+
+/**
+ * @brief finish the jobs in flight, stop and join the worker threads
+ * the parameter threads pointer becomes an invalid pointer after this free_frame_threads() was invoked
+ *
+ * @param threads the threads
+ * @param pool the picture pool which the pictures of the jobs are from
+ */
+void free_frame_threads(FrameThreads* threads, PicturePool* pool);
+
+/**
+ * @brief start the job of a new picture, the DPB holds its reference pictures. if thread_count pictures are in flight, it waits for the oldest one and retires it
+ *
+ * @param threads the threads
+ * @param pool the picture pool
+ * @param dpb the DPB, its frame stores are retained by the job
+ * @param picture the picture, its progress is reset
+ * @return int 0 on success, negative value on error
+ */
+int start_picture_job(FrameThreads* threads, PicturePool* pool, const DecodedPictureBuffer* dpb, Picture* picture);
+
+/**
+ * @brief queue a slice to the job of the picture
+ *
+ * @param threads the threads
+ * @param picture the picture, the newest job which is not closed
+ * @param header the slice header, the slice job takes over its slice group maps
+ * @param rbsp_buffer the RBSP of the slice NALU. on success the slice job takes it over and hands back the buffer of its previous slice, 0 if it has none
+ * @param rbsp_capacity the capacity of rbsp_buffer, exchanged with it
+ * @param reader the reader positioned at the slice data
+ * @param ref_lists the reference picture lists of the slice
+ * @return int 0 on success, negative value on error
+ */
+int queue_slice_job(FrameThreads* threads, Picture* picture, SliceHeader* header, uint8_t** rbsp_buffer, size_t* rbsp_capacity, const RBSPReader* reader,
+                    const RefPicLists* ref_lists);
+
+/**
+ * @brief queue the end of the frame or field of the slice header to the job of the picture, once the slices queued before it are decoded the worker reconstructs
+ * the rows of the frame or field which are not reconstructed yet and publishes it as decoded completely
+ *
+ * @param threads the threads
+ * @param picture the picture, the newest job which is not closed
+ * @param header the header of a slice of the frame or field, its slice group maps stay with the caller
+ * @return int 0 on success, negative value on error
+ */
+int queue_frame_or_field_end(FrameThreads* threads, Picture* picture, const SliceHeader* header);
+
+/**
+ * @brief close the job of the picture, the worker finishes it once the queued slices are decoded
+ *
+ * @param threads the threads
+ * @param picture the picture
+ */
+void close_picture_job(FrameThreads* threads, Picture* picture);
+
+/**
+ * @brief retire the done jobs and wait until at most max_jobs jobs are in flight, the pictures retained by the retired jobs are released. the jobs MUST be closed
+ * except the newest one if max_jobs is not 0
+ *
+ * @param threads the threads
+ * @param pool the picture pool
+ * @param max_jobs the number of the jobs which may stay in flight
+ */
+void retire_picture_jobs(FrameThreads* threads, PicturePool* pool, int32_t max_jobs);
+
+/**
+ * @brief take the first error of the slices decoded by the workers since the previous invocation
+ *
+ * @param threads the threads
+ * @return int 0 if no slice failed, the error of the slice otherwise
+ */
+int take_frame_thread_error(FrameThreads* threads);
+
+/**
+ * @brief wait until the slices queued to the picture are decoded, the picture is decoded completely once its job is closed
+ *
+ * @param threads the threads
+ * @param picture the picture
+ */
+void wait_for_picture(FrameThreads* threads, Picture* picture);
+
+/**
+ * @brief wait until all the queued slices are decoded, so that the workers do not refer to the parameter sets any more
+ *
+ * @param threads the threads
+ */
+void wait_for_queued_slices(FrameThreads* threads);
+
+/**
+ * @brief wait until the leading rows of the frame or field are decoded
+ *
+ * @param threads the threads
+ * @param ff the frame or field, the frame or a field of a picture decoded before the current one
+ * @param rows the number of the leading macroblock rows of the frame or field
+ */
+void wait_for_decoded_mb_rows(FrameThreads* threads, const FrameOrField* ff, int32_t rows);
+
+/**
+ * @brief wait until the reference pictures of the macroblock are decoded down to the rows which its motion compensation reads. a 4x4 block reads the rows down
+ * to its bottom line displaced by its vertical motion vector, with 3 more lines for the 6-tap interpolation filter, the blocks reading the border below the
+ * picture wait for the whole reference picture
+ * @see 8.4.2.2 Fractional sample interpolation process
+ *
+ * @param ff the frame or field being reconstructed by a worker, it is not a MBAFF frame
+ * @param ref_lists the reference picture lists of the slice of the macroblock
+ * @param PicWidthInMbs the width of the pictures in macroblocks
+ * @param CurrMbAddr the macroblock being reconstructed
+ */
+void wait_for_macroblock_references(const FrameOrField* ff, const RefPicLists* ref_lists, int32_t PicWidthInMbs, int32_t CurrMbAddr);
+
+/**
+ * @brief publish the progress of the frame or field being decoded by a worker when the last macroblock of a row, or of a macroblock pair row of a MBAFF frame,
+ * is decoded. the rows of a reconstructed frame or field are reconstructed first, and the rows whose samples are final are published
+ *
+ * @param ff the frame or field
+ * @param header the slice header
+ * @param CurrMbAddr the decoded macroblock
+ */
+void report_decoded_macroblock(FrameOrField* ff, const SliceHeader* header, int32_t CurrMbAddr);
+
+#endif
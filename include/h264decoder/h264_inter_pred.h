@@ -0,0 +1,254 @@
+#ifndef _H_H264_INTER_PRED_H_
+#define _H_H264_INTER_PRED_H_
+
+#include <stdint.h>
+
+#include "h264_defs.h"
+#include "h264_error.h"
+
+/**
+ * Inter prediction
+ *
+ * @see 8.4.2.2 Fractional sample interpolation process
+ *
+ * The reference planes are padded: the samples outside of the picture repeat the nearest edge sample, see pad_reference_plane(). mc_luma() and mc_chroma() move
+ * the integer sample position of a block that lies entirely in the border to the inner edge of the border, where the padded samples give the same prediction as the
+ * clipping of equations 8-228 and 8-230 to 8-231, so the kernels run without bounds checks for any motion vector.
+ *
+ * The kernels are selected by init_inter_pred_funcs() according to the bit depth and the instruction set extensions of the CPU, every entry of the function table
+ * has a scalar reference implementation. The quarter sample positions are produced by averaging two of the full sample, half sample and centre planes. The scalar
+ * kernels of the bit depths 8 to 14 are instantiated from one template, the SIMD kernels are used for the bit depth 8 only. For the bit depths greater than 8, the
+ * sample pointers of the kernels and of weighted_sample_prediction() point to uint16_t samples and the planes are given to the functions with the suffix 16.
+ *
+ * @see 8.4.2.3 Weighted sample prediction process
+ *
+ * The weights are derived once per slice into PredWeights, the implicit weights for every pair of reference indices. The weighting kernels work in place on the
+ * interpolated prediction of list 0 and combine it with the prediction of list 1, the weighting, rounding, offset and clipping are done in one pass.
+ */
+
+/* the border of the luma reference planes in samples, every MC kernel reads within it */
+#define H264_MC_LUMA_BORDER 32
+/* the border of the chroma reference planes in samples */
+#define H264_MC_CHROMA_BORDER 16
+
+/**
+ * @brief the motion compensation kernel of the block width selected by the table index
+ *
+ * @param dst the upper-left sample of the predicted block
+ * @param dst_stride the row stride of dst in samples
+ * @param src the reference sample at the integer position of the block
+ * @param src_stride the row stride of src in samples
+ * @param height the block height in samples
+ */
+typedef void (*mc_func)(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height);
+
+/**
+ * @brief the chroma motion compensation kernel
+ *
+ * @param xFrac xFracC, the horizontal eighth sample offset
+ * @param yFrac yFracC, the vertical eighth sample offset
+ */
+typedef void (*mc_chroma_func)(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height, int32_t xFrac, int32_t yFrac);
+
+/**
+ * @brief the explicit weighted sample prediction of one prediction in place, equation 8-270
+ *
+ * @param dst the prediction of the block, predPartLX
+ * @param stride the row stride of dst in samples
+ * @param height the block height in samples
+ * @param logWD the weight denominator
+ * @param w the weight
+ * @param o the offset scaled to the bit depth
+ */
+typedef void (*weight_func)(uint8_t* dst, int32_t stride, int32_t height, int32_t logWD, int32_t w, int32_t o);
+
+/**
+ * @brief the weighted bi-prediction of equation 8-272 in place
+ *
+ * @param dst the prediction of list 0 of the block, predPartL0, and the output
+ * @param dst_stride the row stride of dst in samples
+ * @param src the prediction of list 1 of the block, predPartL1
+ * @param src_stride the row stride of src in samples
+ * @param height the block height in samples
+ * @param logWD the weight denominator
+ * @param w0 the weight of list 0
+ * @param w1 the weight of list 1
+ * @param o the rounded mean of the offsets, ( o0 + o1 + 1 ) >> 1
+ */
+typedef void (*biweight_func)(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height, int32_t logWD, int32_t w0, int32_t w1, int32_t o);
+
+/**
+ * @brief the inter prediction function table, the luma entries are indexed by the block width 16, 8 and 4, the chroma entries by the width 8, 4 and 2, the entries
+ * shared by luma and chroma by the width 16, 8, 4 and 2
+ */
+typedef struct {
+    /* the full sample position */
+    mc_func copy[3];
+    /* dst = ( dst + src + 1 ) >> 1, the quarter sample positions and the default bi-prediction of equation 8-269 */
+    mc_func avg[4];
+    /* the half sample b of equation 8-243 */
+    mc_func luma_h6[3];
+    /* the half sample h of equation 8-244 */
+    mc_func luma_v6[3];
+    /* the centre half sample j of equation 8-247 */
+    mc_func luma_hv6[3];
+    /* the chroma sample of equation 8-266 */
+    mc_chroma_func chroma[3];
+    /* the explicit weighted prediction of one list */
+    weight_func weight[4];
+    /* the explicit and implicit weighted bi-prediction */
+    biweight_func biweight[4];
+} InterPredFuncs;
+
+/**
+ * @brief initialize the inter prediction function table
+ *
+ * @param funcs the function table
+ * @param BitDepth the bit depth of the samples, 8 to 14
+ * @param cpu_flags the H264_CPU_XXX flags, the scalar kernels are used if it is 0
+ */
+void init_inter_pred_funcs(InterPredFuncs* funcs, int32_t BitDepth, int32_t cpu_flags);
+
+/**
+ * @brief replace the SIMD kernels of the function table for the instruction set extensions
+ *
+ * @param funcs the function table initialized with the scalar kernels
+ * @param cpu_flags the H264_CPU_XXX flags
+ */
+void init_inter_pred_funcs_x86(InterPredFuncs* funcs, int32_t cpu_flags);
+
+/**
+ * @brief fill the border of the plane with the nearest edge samples
+ *
+ * @param plane the sample ( 0, 0 ) of the plane
+ * @param stride the row stride in samples
+ * @param width the width of the picture in samples
+ * @param height the height of the picture in samples
+ * @param border the border in samples on every side
+ */
+void pad_reference_plane(uint8_t* plane, int32_t stride, int32_t width, int32_t height, int32_t border);
+
+/**
+ * @brief pad_reference_plane() of the bit depths greater than 8
+ */
+void pad_reference_plane16(uint16_t* plane, int32_t stride, int32_t width, int32_t height, int32_t border);
+
+/**
+ * @brief fill the left and right border of the lines [ first_line, end_line ) of the plane, and the border above and below once the first and the last line are
+ * padded, so the plane is padded line range by line range as its samples become final
+ *
+ * @param plane the sample ( 0, 0 ) of the plane
+ * @param stride the row stride in samples
+ * @param width the width of the picture in samples
+ * @param height the height of the picture in samples
+ * @param border the border in samples on every side
+ * @param first_line the first line to pad
+ * @param end_line the line after the last line to pad
+ */
+void pad_reference_lines(uint8_t* plane, int32_t stride, int32_t width, int32_t height, int32_t border, int32_t first_line, int32_t end_line);
+
+/**
+ * @brief pad_reference_lines() of the bit depths greater than 8
+ */
+void pad_reference_lines16(uint16_t* plane, int32_t stride, int32_t width, int32_t height, int32_t border, int32_t first_line, int32_t end_line);
+
+/**
+ * @brief Luma sample interpolation process of a 16x16 to 4x4 block
+ * @see 8.4.2.2.1 Luma sample interpolation process
+ *
+ * @param funcs the function table
+ * @param dst the upper-left sample of the predicted block
+ * @param dst_stride the row stride of dst in samples
+ * @param ref the sample ( 0, 0 ) of the padded reference plane, the border is at least H264_MC_LUMA_BORDER
+ * @param ref_stride the row stride of ref in samples
+ * @param PicWidthInSamplesL the width of the reference picture
+ * @param PicHeightInSamplesL the height of the reference picture
+ * @param xAL the horizontal luma location of the block
+ * @param yAL the vertical luma location of the block
+ * @param mvLX the luma motion vector in quarter samples
+ * @param width the block width, 16, 8 or 4
+ * @param height the block height, 16, 8 or 4
+ */
+void mc_luma(const InterPredFuncs* funcs, uint8_t* dst, int32_t dst_stride, const uint8_t* ref, int32_t ref_stride, int32_t PicWidthInSamplesL, int32_t PicHeightInSamplesL,
+             int32_t xAL, int32_t yAL, const int16_t mvLX[2], int32_t width, int32_t height);
+
+/**
+ * @brief mc_luma() of the bit depths greater than 8
+ */
+void mc_luma16(const InterPredFuncs* funcs, uint16_t* dst, int32_t dst_stride, const uint16_t* ref, int32_t ref_stride, int32_t PicWidthInSamplesL,
+               int32_t PicHeightInSamplesL, int32_t xAL, int32_t yAL, const int16_t mvLX[2], int32_t width, int32_t height);
+
+/**
+ * @brief Chroma sample interpolation process of a block
+ * @see 8.4.2.2.2 Chroma sample interpolation process
+ *
+ * @param funcs the function table
+ * @param dst the upper-left sample of the predicted block
+ * @param dst_stride the row stride of dst in samples
+ * @param ref the sample ( 0, 0 ) of the padded reference plane, the border is at least H264_MC_CHROMA_BORDER
+ * @param ref_stride the row stride of ref in samples
+ * @param PicWidthInSamplesC the width of the reference picture
+ * @param PicHeightInSamplesC the height of the reference picture
+ * @param xAC the horizontal chroma location of the block, xAL / SubWidthC
+ * @param yAC the vertical chroma location of the block, yAL / SubHeightC
+ * @param mvCLX the chroma motion vector, see 8.4.1.4
+ * @param SubHeightC 2 for ChromaArrayType equal to 1, 1 for ChromaArrayType equal to 2
+ * @param width the block width, 8, 4 or 2
+ * @param height the block height
+ */
+void mc_chroma(const InterPredFuncs* funcs, uint8_t* dst, int32_t dst_stride, const uint8_t* ref, int32_t ref_stride, int32_t PicWidthInSamplesC, int32_t PicHeightInSamplesC,
+               int32_t xAC, int32_t yAC, const int16_t mvCLX[2], int32_t SubHeightC, int32_t width, int32_t height);
+
+/**
+ * @brief mc_chroma() of the bit depths greater than 8
+ */
+void mc_chroma16(const InterPredFuncs* funcs, uint16_t* dst, int32_t dst_stride, const uint16_t* ref, int32_t ref_stride, int32_t PicWidthInSamplesC,
+                 int32_t PicHeightInSamplesC, int32_t xAC, int32_t yAC, const int16_t mvCLX[2], int32_t SubHeightC, int32_t width, int32_t height);
+
+/**
+ * @brief derive the weighting mode and the explicit weights of the slice from the prediction weight table
+ * @see 8.4.2.3 Weighted sample prediction process
+ * @see 8.4.3 Derivation process for prediction weights
+ *
+ * @param header the slice header with the sps and pps set, the result is in header->pred_weights
+ */
+void derivation_for_explicit_weights(SliceHeader* header);
+
+/**
+ * @brief derive the implicit weights of every pair of reference indices of a B slice with weighted_bipred_idc equal to 2
+ * @see 8.4.3 Derivation process for prediction weights
+ *
+ * @param weights the weights of the slice
+ * @param table 0 for the frame and field pictures and the frame macroblocks, 1 and 2 for the top and bottom field macroblocks of a MBAFF frame
+ * @param currPicOrField the PicOrderCnt( ) of the current picture, or of the field of the current picture with the parity of the field macroblocks
+ * @param poc_l0 the PicOrderCnt( ) of the entries of RefPicList0, or of the fields of the entries for the tables 1 and 2
+ * @param long_term_l0 the entries of RefPicList0 which are long-term reference pictures
+ * @param num_l0 the number of entries of RefPicList0, at most H264_MAX_REFS
+ * @param poc_l1 the PicOrderCnt( ) of the entries of RefPicList1
+ * @param long_term_l1 the entries of RefPicList1 which are long-term reference pictures
+ * @param num_l1 the number of entries of RefPicList1, at most H264_MAX_REFS
+ */
+void derivation_for_implicit_weights(PredWeights* weights, int32_t table, int32_t currPicOrField, const int32_t* poc_l0, const uint8_t* long_term_l0, int32_t num_l0,
+                                     const int32_t* poc_l1, const uint8_t* long_term_l1, int32_t num_l1);
+
+/**
+ * @brief Weighted sample prediction process of a block of one colour component
+ * @see 8.4.2.3 Weighted sample prediction process
+ *
+ * @param funcs the function table
+ * @param weights the weights of the slice
+ * @param table the implicit weight table, see derivation_for_implicit_weights(). for the tables 1 and 2 the explicit weights are indexed by refIdxLX >> 1
+ * @param iCx 0 for luma, 1 for Cb and 2 for Cr
+ * @param refIdxL0 the reference index of list 0, negative if predFlagL0 is 0
+ * @param refIdxL1 the reference index of list 1, negative if predFlagL1 is 0
+ * @param dst the prediction of list 0, or of list 1 if predFlagL0 is 0, and the output predPartLX
+ * @param dst_stride the row stride of dst in samples
+ * @param predPartL1 the prediction of list 1 if both predFlagL0 and predFlagL1 are 1
+ * @param pred_stride the row stride of predPartL1 in samples
+ * @param width the block width, 16, 8, 4 or 2
+ * @param height the block height
+ */
+void weighted_sample_prediction(const InterPredFuncs* funcs, const PredWeights* weights, int32_t table, int32_t iCx, int32_t refIdxL0, int32_t refIdxL1, uint8_t* dst,
+                                int32_t dst_stride, const uint8_t* predPartL1, int32_t pred_stride, int32_t width, int32_t height);
+
+#endif
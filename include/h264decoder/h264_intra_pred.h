@@ -0,0 +1,180 @@
+#ifndef _H_H264_INTRA_PRED_H_
+#define _H_H264_INTRA_PRED_H_
+
+#include <stdint.h>
+
+#include "h264_defs.h"
+#include "h264_error.h"
+#include "h264_picture.h"
+
+/**
+ * Intra prediction
+ *
+ * @see 8.3 Intra prediction process
+ *
+ * The prediction kernels write the predicted samples of a block to dst with the row stride. The neighbouring samples p[ x, y ] of the block are gathered into
+ * IntraPredSamples by the caller, the kernels read them only and do not check the availability required by the prediction mode, a conforming bitstream only uses
+ * the modes whose samples are available.
+ *
+ * The kernels are selected by init_intra_pred_funcs() according to the bit depth and the instruction set extensions of the CPU, every entry of the function table
+ * has a scalar reference implementation. The scalar kernels of the bit depths 8 to 14 are instantiated from one template, the SIMD kernels are used for the bit depth
+ * 8 only. For the bit depths greater than 8, dst points to uint16_t samples and the samples are IntraPredSamples16.
+ */
+
+/**
+ * @brief Intra4x4PredMode and Intra8x8PredMode
+ * @see Table 8-2 – Specification of Intra4x4PredMode[ luma4x4BlkIdx ] and associated names
+ * @see Table 8-3 – Specification of Intra8x8PredMode[ luma8x8BlkIdx ] and associated names
+ */
+typedef enum INTRA_NXN_PRED_MODE {
+    Intra_NxN_Vertical = 0,
+    Intra_NxN_Horizontal = 1,
+    Intra_NxN_DC = 2,
+    Intra_NxN_Diagonal_Down_Left = 3,
+    Intra_NxN_Diagonal_Down_Right = 4,
+    Intra_NxN_Vertical_Right = 5,
+    Intra_NxN_Horizontal_Down = 6,
+    Intra_NxN_Vertical_Left = 7,
+    Intra_NxN_Horizontal_Up = 8,
+} INTRA_NXN_PRED_MODE;
+
+/**
+ * @brief Intra16x16PredMode
+ * @see Table 8-4 – Specification of Intra16x16PredMode and associated names
+ */
+typedef enum INTRA_16X16_PRED_MODE {
+    Intra_16x16_Vertical = 0,
+    Intra_16x16_Horizontal = 1,
+    Intra_16x16_DC = 2,
+    Intra_16x16_Plane = 3,
+} INTRA_16X16_PRED_MODE;
+
+/**
+ * @brief intra_chroma_pred_mode
+ * @see Table 8-5 – Specification of Intra chroma prediction modes and associated names
+ */
+typedef enum INTRA_CHROMA_PRED_MODE {
+    Intra_Chroma_DC = 0,
+    Intra_Chroma_Horizontal = 1,
+    Intra_Chroma_Vertical = 2,
+    Intra_Chroma_Plane = 3,
+} INTRA_CHROMA_PRED_MODE;
+
+/**
+ * the availability of the neighbouring samples, the bits of IntraPredSamples::available
+ */
+#define H264_INTRA_AVAIL_LEFT 0x01      /* p[ -1, y ] */
+#define H264_INTRA_AVAIL_TOP 0x02       /* p[ x, -1 ], x = 0..N-1 */
+#define H264_INTRA_AVAIL_TOP_RIGHT 0x04 /* p[ x, -1 ], x = N..2N-1 of the 4x4 and 8x8 blocks */
+#define H264_INTRA_AVAIL_TOP_LEFT 0x08  /* p[ -1, -1 ] */
+
+/**
+ * @brief the neighbouring samples of the block to be predicted
+ */
+typedef struct {
+    /* p[ x, -1 ], x = 0..15. the 4x4 and 8x8 blocks use the samples above right as well */
+    uint8_t top[16];
+    /* p[ -1, y ], y = 0..15 */
+    uint8_t left[16];
+    /* p[ -1, -1 ] */
+    uint8_t top_left;
+    /* the H264_INTRA_AVAIL_XXX flags */
+    uint8_t available;
+} IntraPredSamples;
+
+/**
+ * @brief the neighbouring samples of the block to be predicted of the bit depths greater than 8, the fields are the ones of IntraPredSamples
+ */
+typedef struct {
+    uint16_t top[16];
+    uint16_t left[16];
+    uint16_t top_left;
+    uint8_t available;
+} IntraPredSamples16;
+
+/**
+ * @brief the intra prediction kernel
+ *
+ * @param dst the upper-left sample of the block, uint16_t samples for the bit depths greater than 8
+ * @param stride the row stride of dst in samples
+ * @param samples the neighbouring samples of the block, IntraPredSamples16 for the bit depths greater than 8
+ */
+typedef void (*intra_pred_func)(uint8_t* dst, int32_t stride, const IntraPredSamples* samples);
+
+/**
+ * @brief the intra prediction function table
+ */
+typedef struct {
+    /* Intra_4x4, indexed by Intra4x4PredMode */
+    intra_pred_func pred4x4[9];
+    /* Intra_8x8, indexed by Intra8x8PredMode. the samples are filtered by intra8x8_filter_reference_samples() */
+    intra_pred_func pred8x8[9];
+    /* Intra_16x16, indexed by Intra16x16PredMode */
+    intra_pred_func pred16x16[4];
+    /* the chroma samples of ChromaArrayType 1 (8x8) and 2 (8x16), indexed by [ ChromaArrayType - 1 ][ intra_chroma_pred_mode ] */
+    intra_pred_func pred_chroma[2][4];
+} IntraPredFuncs;
+
+/**
+ * @brief initialize the intra prediction function table
+ *
+ * @param funcs the function table
+ * @param BitDepth the bit depth of the samples, 8 to 14
+ * @param cpu_flags the H264_CPU_XXX flags, the scalar kernels are used if it is 0
+ */
+void init_intra_pred_funcs(IntraPredFuncs* funcs, int32_t BitDepth, int32_t cpu_flags);
+
+/**
+ * @brief replace the SIMD kernels of the function table for the instruction set extensions
+ *
+ * @param funcs the function table initialized with the scalar kernels
+ * @param cpu_flags the H264_CPU_XXX flags
+ */
+void init_intra_pred_funcs_x86(IntraPredFuncs* funcs, int32_t cpu_flags);
+
+/**
+ * @brief substitute the samples above right of the 4x4 or 8x8 block when they are not available
+ * @see 8.3.1.2 Intra_4x4 sample prediction
+ * @see 8.3.2.2 Intra_8x8 sample prediction
+ *
+ * When samples p[ x, -1 ], with x = N..2N-1, are marked as "not available for Intra_NxN prediction" and p[ N-1, -1 ] is available, the sample value of p[ N-1, -1 ] is
+ * substituted for them.
+ *
+ * @param samples the neighbouring samples
+ * @param N the block size, 4 or 8
+ */
+void intra_pred_substitute_top_right(IntraPredSamples* samples, int32_t N);
+
+/**
+ * @brief intra_pred_substitute_top_right() of the bit depths greater than 8
+ */
+void intra_pred_substitute_top_right16(IntraPredSamples16* samples, int32_t N);
+
+/**
+ * @brief Reference sample filtering process for Intra_8x8 sample prediction
+ * @see 8.3.2.2.1 Reference sample filtering process for Intra_8x8 sample prediction
+ *
+ * @param samples the neighbouring samples p[ x, y ], the top right samples are substituted already
+ * @param out_filtered output parameter. the filtered samples p'[ x, y ]
+ */
+void intra8x8_filter_reference_samples(const IntraPredSamples* samples, IntraPredSamples* out_filtered);
+
+/**
+ * @brief intra8x8_filter_reference_samples() of the bit depths greater than 8
+ */
+void intra8x8_filter_reference_samples16(const IntraPredSamples16* samples, IntraPredSamples16* out_filtered);
+
+/**
+ * @brief Derivation process for Intra4x4PredMode and Intra8x8PredMode of the macroblock. the modes are derived from prev_intraNxN_pred_mode_flag and
+ * rem_intraNxN_pred_mode of the macroblock scratch and stored in MacroBlock::intra_pred_modes
+ * @see 8.3.1.1 Derivation process for Intra4x4PredMode
+ * @see 8.3.2.1 Derivation process for Intra8x8PredMode
+ *
+ * @param picture pointer to the FrameOrField
+ * @param header pointer to the slice header
+ * @param CurrMbAddr the current macroblock address
+ * @return int 0 on success, negative value on error
+ */
+int derivation_for_intra_nxn_pred_modes(FrameOrField* picture, SliceHeader* header, int32_t CurrMbAddr);
+
+#endif
@@ -39,7 +39,7 @@ void inverse_macroblock_scanning_process(int32_t mbAddr, int32_t PicWidthInSampl
  * @param out_y output parameter. the y location
  * @return int 0 on success, negative value on error
  */
-inline int inverse_macroblock_partition_scanning_process(int32_t mbPartIdx, MB_TYPE_NAME mb_type, int32_t* out_x, int32_t* out_y);
+int inverse_macroblock_partition_scanning_process(int32_t mbPartIdx, MB_TYPE_NAME mb_type, int32_t* out_x, int32_t* out_y);
 
 /**
  * @brief Inverse sub-macroblock partition scanning process
@@ -59,7 +59,7 @@ inline int inverse_macroblock_partition_scanning_process(int32_t mbPartIdx, MB_T
  * @param out_y output parameter. the y location
  * @return int 0 on success, negative value on error
  */
-inline int inverse_sub_macroblock_partition_scanning_process(MB_TYPE_NAME mb_type, MB_TYPE_NAME sub_mb_type_of_mbPartIdx, int32_t subMbPartIdx, int32_t* out_x, int32_t* out_y);
+int inverse_sub_macroblock_partition_scanning_process(MB_TYPE_NAME mb_type, MB_TYPE_NAME sub_mb_type_of_mbPartIdx, int32_t subMbPartIdx, int32_t* out_x, int32_t* out_y);
 
 /**
  * @brief Inverse 4x4 luma block scanning process
@@ -74,7 +74,7 @@ inline int inverse_sub_macroblock_partition_scanning_process(MB_TYPE_NAME mb_typ
  * @param out_x output parameter. the x location
  * @param out_y output parameter. the y location
  */
-inline void inverse_4x4_luma_block_scanning_process(int32_t luma4x4BlkIdx, int32_t* out_x, int32_t* out_y);
+void inverse_4x4_luma_block_scanning_process(int32_t luma4x4BlkIdx, int32_t* out_x, int32_t* out_y);
 
 /**
  * @brief Inverse 4x4 Cb or Cr block scanning process for ChromaArrayType equal to 3
@@ -86,7 +86,7 @@ inline void inverse_4x4_luma_block_scanning_process(int32_t luma4x4BlkIdx, int32
  * @param out_x output parameter. the x location
  * @param out_y output parameter. the y location
  */
-inline void inverse_4x4_Cb_Cr_block_scanning_process(int32_t cbcr4x4BlkIdx, int32_t* out_x, int32_t* out_y);
+void inverse_4x4_Cb_Cr_block_scanning_process(int32_t cbcr4x4BlkIdx, int32_t* out_x, int32_t* out_y);
 
 /**
  * @brief Inverse 8x8 luma block scanning process
@@ -101,7 +101,7 @@ inline void inverse_4x4_Cb_Cr_block_scanning_process(int32_t cbcr4x4BlkIdx, int3
  * @param out_x output parameter. the x location
  * @param out_y output parameter. the y location
  */
-inline void inverse_8x8_luma_block_scanning_process(int32_t luma8x8BlkIdx, int32_t* out_x, int32_t* out_y);
+void inverse_8x8_luma_block_scanning_process(int32_t luma8x8BlkIdx, int32_t* out_x, int32_t* out_y);
 
 /**
  * @brief Inverse 8x8 Cb or Cr block scanning process for ChromaArrayType equal to 3
@@ -113,7 +113,7 @@ inline void inverse_8x8_luma_block_scanning_process(int32_t luma8x8BlkIdx, int32
  * @param out_x output parameter. the x location
  * @param out_y output parameter. the y location
  */
-inline void inverse_8x8_Cb_Cr_block_scanning_process(int32_t cbcr8x8BlkIdx, int32_t* out_x, int32_t* out_y);
+void inverse_8x8_Cb_Cr_block_scanning_process(int32_t cbcr8x8BlkIdx, int32_t* out_x, int32_t* out_y);
 
 /**
  * @brief Inverse 4x4 chroma block scanning process
@@ -128,7 +128,7 @@ inline void inverse_8x8_Cb_Cr_block_scanning_process(int32_t cbcr8x8BlkIdx, int3
  * @param out_x output parameter. the x location
  * @param out_y output parameter. the y location
  */
-inline void inverse_4x4_chroma_block_scanning_process(int32_t chroma4x4BlkIdx, int32_t* out_x, int32_t* out_y);
+void inverse_4x4_chroma_block_scanning_process(int32_t chroma4x4BlkIdx, int32_t* out_x, int32_t* out_y);
 
 /**
  * @brief Derivation process of the availability for macroblock addresses
@@ -149,7 +149,7 @@ inline void inverse_4x4_chroma_block_scanning_process(int32_t chroma4x4BlkIdx, i
  * @param CurrMbAddr_slice_id the id of the slice which the macroblock with address CurrMbAddr belongs to
  * @return int 0: false, 1: true
  */
-inline int is_available_of_macroblock(int32_t mbAddr, int32_t mbAddr_slice_id, int32_t CurrMbAddr, int32_t CurrMbAddr_slice_id);
+int is_available_of_macroblock(int32_t mbAddr, int32_t mbAddr_slice_id, int32_t CurrMbAddr, int32_t CurrMbAddr_slice_id);
 
 /**
  * @brief Derivation process for neighbouring macroblock addresses and their availability
@@ -173,12 +173,12 @@ inline int is_available_of_macroblock(int32_t mbAddr, int32_t mbAddr_slice_id, i
  * @param out_mbAddrC output parameter. the address and availability status of the macroblock above-right of the current macroblock,
  * @param out_mbAddrD output parameter. the address and availability status of the macroblock above-left of the current macroblock.
  */
-inline void neighbouring_mb_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrA, int32_t* out_mbAddrB, int32_t* out_mbAddrC,
+void neighbouring_mb_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrA, int32_t* out_mbAddrB, int32_t* out_mbAddrC,
                                                  int32_t* out_mbAddrD);
-inline void neighbouring_mb_A_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrA);
-inline void neighbouring_mb_B_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrB);
-inline void neighbouring_mb_C_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrC);
-inline void neighbouring_mb_D_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrD);
+void neighbouring_mb_A_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrA);
+void neighbouring_mb_B_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrB);
+void neighbouring_mb_C_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrC);
+void neighbouring_mb_D_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrD);
 
 /**
  * @brief Derivation process for neighbouring macroblock addresses and their availability in MBAFF frames
@@ -196,12 +196,12 @@ inline void neighbouring_mb_D_address_availability(int32_t CurrMbAddr, int32_t P
  * @param out_mbAddrC output parameter. the address and availability status of the top macroblock of the macroblock pair above-right of the current macroblock pair
  * @param out_mbAddrD output parameter. the address and availability status of the top macroblock of the macroblock pair above-left of the current macroblock pair
  */
-inline void neighbouring_mb_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrA, int32_t* out_mbAddrB,
+void neighbouring_mb_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrA, int32_t* out_mbAddrB,
                                                                 int32_t* out_mbAddrC, int32_t* out_mbAddrD);
-inline void neighbouring_mb_A_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrA);
-inline void neighbouring_mb_B_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrB);
-inline void neighbouring_mb_C_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrC);
-inline void neighbouring_mb_D_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrD);
+void neighbouring_mb_A_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrA);
+void neighbouring_mb_B_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrB);
+void neighbouring_mb_C_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrC);
+void neighbouring_mb_D_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrD);
 
 /**
  * @brief Derivation process for neighbouring macroblocks
@@ -216,14 +216,14 @@ inline void neighbouring_mb_D_address_availability_in_MBAFF_frame(int32_t CurrMb
  * @param currMbFrameFlag whether the current macroblock is a frame macroblock. this parameter is used when MbaffFrameFlag is 1
  * @param PicWidthInMbs the picture width in macroblocks
  * @param mb_slice_ids the macroblock slices id array
- * @param mb_frame_flags the macroblock frame flags array. this parameter is used when MbaffFrameFlag is 1
+ * @param mb_field_flags the mb_field_decoding_flag bitset of the macroblocks. this parameter is used when MbaffFrameFlag is 1
  * @param is_chroma is chroma
  * @param MbWidthC the macroblock chroma width. it is used when is_chroma is true
  * @param MbHeightC the macroblock chroma height. it is used when is_chroma is true
  * @param out_mbAddrA output parameter. the left macroblock address
  * @param out_mbAddrB output parameter. the upper macroblock address
  */
-void neighbouring_macroblocks(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags,
+void neighbouring_macroblocks(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags,
                               int32_t is_chroma, int32_t MbWidthC, int32_t MbHeightC, int32_t* out_mbAddrA, int32_t* out_mbAddrB);
 
 /**
@@ -244,14 +244,14 @@ void neighbouring_macroblocks(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_
  * @param currMbFrameFlag whether the current macroblock is a frame macroblock. this parameter is used when MbaffFrameFlag is 1
  * @param PicWidthInMbs the picture width in macroblocks
  * @param mb_slice_ids the macroblock slices id array
- * @param mb_frame_flags the macroblock frame flags array. this parameter is used when MbaffFrameFlag is 1
+ * @param mb_field_flags the mb_field_decoding_flag bitset of the macroblocks. this parameter is used when MbaffFrameFlag is 1
  * @param luma8x8BlkIdx the 8x8 luma block index
  * @param out_mbAddrA output parameter. the left macroblock address
  * @param out_luma8x8BlkIdxA output parameter. the 8x8 luma block index to the left of the 8x8 block with index luma8x8BlkIdx
  * @param out_mbAddrB output parameter. the upper macroblock address
  * @param out_luma8x8BlkIdxB output parameter. the 8x8 luma block index above the 8x8 block with index luma8x8BlkIdx
  */
-void neighbouring_8x8_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags,
+void neighbouring_8x8_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags,
                                  int32_t luma8x8BlkIdx, int32_t* out_mbAddrA, int32_t* out_luma8x8BlkIdxA, int32_t* out_mbAddrB, int32_t* out_luma8x8BlkIdxB);
 
 /**
@@ -267,7 +267,7 @@ void neighbouring_8x8_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int
  * @param MbWidthC the macroblock chroma width
  * @param MbHeightC the macroblock chroma height
  * @param mb_slice_ids the macroblock slices id array
- * @param mb_frame_flags the macroblock frame flags array. this parameter is used when MbaffFrameFlag is 1
+ * @param mb_field_flags the mb_field_decoding_flag bitset of the macroblocks. this parameter is used when MbaffFrameFlag is 1
  * @param cbcr8x8BlkIdx the 8x8 Cb or Cr block index
  * @param out_mbAddrA output parameter. the left macroblock address
  * @param out_cbcr8x8BlkIdxA output parameter. the 8x8 Cb or Cr block index to the left of the 8x8 block with index cbcr8x8BlkIdx
@@ -275,7 +275,7 @@ void neighbouring_8x8_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int
  * @param out_cbcr8x8BlkIdxB output parameter. the 8x8 Cb or Cr block index above the 8x8 block with index cbcr8x8BlkIdx
  */
 void neighbouring_8x8_chroma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t MbWidthC, int32_t MbHeightC,
-                                   int32_t* mb_slice_ids, int32_t* mb_frame_flags, int32_t cbcr8x8BlkIdx, int32_t* out_mbAddrA, int32_t* out_cbcr8x8BlkIdxA, int32_t* out_mbAddrB,
+                                   int32_t* mb_slice_ids, uint32_t* mb_field_flags, int32_t cbcr8x8BlkIdx, int32_t* out_mbAddrA, int32_t* out_cbcr8x8BlkIdxA, int32_t* out_mbAddrB,
                                    int32_t* out_cbcr8x8BlkIdxB);
 
 /**
@@ -295,14 +295,14 @@ void neighbouring_8x8_chroma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, i
  * @param currMbFrameFlag whether the current macroblock is a frame macroblock. this parameter is used when MbaffFrameFlag is 1
  * @param PicWidthInMbs the picture width in macroblocks
  * @param mb_slice_ids the macroblock slices id array
- * @param mb_frame_flags the macroblock frame flags array. this parameter is used when MbaffFrameFlag is 1
+ * @param mb_field_flags the mb_field_decoding_flag bitset of the macroblocks. this parameter is used when MbaffFrameFlag is 1
  * @param luma4x4BlkIdx the 4x4 luma block index
  * @param out_mbAddrA output parameter. the left macroblock address
  * @param out_luma4x4BlkIdxA output parameter. the 4x4 luma block index to the left of the 4x4 block with index luma4x4BlkIdx
  * @param out_mbAddrB output parameter. the upper macroblock address
  * @param out_luma4x4BlkIdxB output parameter. the 4x4 luma block index above the 4x4 block with index luma4x4BlkIdx
  */
-void neighbouring_4x4_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags,
+void neighbouring_4x4_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags,
                                  int32_t luma4x4BlkIdx, int32_t* out_mbAddrA, int32_t* out_luma4x4BlkIdxA, int32_t* out_mbAddrB, int32_t* out_luma4x4BlkIdxB);
 
 /**
@@ -326,7 +326,7 @@ void neighbouring_4x4_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int
  * @param MbWidthC the macroblock chroma width
  * @param MbHeightC the macroblock chroma height
  * @param mb_slice_ids the macroblock slices id array
- * @param mb_frame_flags the macroblock frame flags array. this parameter is used when MbaffFrameFlag is 1
+ * @param mb_field_flags the mb_field_decoding_flag bitset of the macroblocks. this parameter is used when MbaffFrameFlag is 1
  * @param chroma4x4BlkIdx the 4x4 chroma block index
  * @param out_mbAddrA output parameter. the left macroblock address
  * @param out_chroma4x4BlkIdxA output parameter. the 4x4 chroma block index to the left of the 4x4 block with index chroma4x4BlkIdx
@@ -334,7 +334,7 @@ void neighbouring_4x4_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int
  * @param out_chroma4x4BlkIdxB output parameter. the 4x4 chroma block index above the 4x4 block with index chroma4x4BlkIdx
  */
 void neighbouring_4x4_chroma_block_ChromaArrayType_12(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t MbWidthC,
-                                                      int32_t MbHeightC, int32_t* mb_slice_ids, int32_t* mb_frame_flags, int32_t chroma4x4BlkIdx, int32_t* out_mbAddrA,
+                                                      int32_t MbHeightC, int32_t* mb_slice_ids, uint32_t* mb_field_flags, int32_t chroma4x4BlkIdx, int32_t* out_mbAddrA,
                                                       int32_t* out_chroma4x4BlkIdxA, int32_t* out_mbAddrB, int32_t* out_chroma4x4BlkIdxB);
 
 /**
@@ -354,7 +354,7 @@ void neighbouring_4x4_chroma_block_ChromaArrayType_12(int32_t MbaffFrameFlag, in
  * @param MbWidthC the macroblock chroma width
  * @param MbHeightC the macroblock chroma height
  * @param mb_slice_ids the macroblock slices id array
- * @param mb_frame_flags the macroblock frame flags array. this parameter is used when MbaffFrameFlag is 1
+ * @param mb_field_flags the mb_field_decoding_flag bitset of the macroblocks. this parameter is used when MbaffFrameFlag is 1
  * @param chroma4x4BlkIdx the 4x4 chroma block index
  * @param out_mbAddrA output parameter. the left macroblock address
  * @param out_chroma4x4BlkIdxA output parameter. the 4x4 chroma block index to the left of the 4x4 block with index chroma4x4BlkIdx
@@ -362,7 +362,7 @@ void neighbouring_4x4_chroma_block_ChromaArrayType_12(int32_t MbaffFrameFlag, in
  * @param out_chroma4x4BlkIdxB output parameter. the 4x4 chroma block index above the 4x4 block with index chroma4x4BlkIdx
  */
 void neighbouring_4x4_chroma_block_ChromaArrayType_3(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t MbWidthC,
-                                                     int32_t MbHeightC, int32_t* mb_slice_ids, int32_t* mb_frame_flags, int32_t chroma4x4BlkIdx, int32_t* out_mbAddrA,
+                                                     int32_t MbHeightC, int32_t* mb_slice_ids, uint32_t* mb_field_flags, int32_t chroma4x4BlkIdx, int32_t* out_mbAddrA,
                                                      int32_t* out_chroma4x4BlkIdxA, int32_t* out_mbAddrB, int32_t* out_chroma4x4BlkIdxB);
 
 /**
@@ -387,7 +387,7 @@ void neighbouring_4x4_chroma_block_ChromaArrayType_3(int32_t MbaffFrameFlag, int
  * @param currMbFrameFlag whether the current macroblock is a frame macroblock. this parameter is used when MbaffFrameFlag is 1
  * @param PicWidthInMbs the picture width in macroblocks
  * @param mb_slice_ids the macroblock slices id array
- * @param mb_frame_flags the macroblock frame flags array. this parameter is used when MbaffFrameFlag is 1
+ * @param mb_field_flags the mb_field_decoding_flag bitset of the macroblocks. this parameter is used when MbaffFrameFlag is 1
  * @param mbPartIdx the macroblock partition index
  * @param currSubMbType the current sub-macroblock type
  * @param subMbPartIdx the sub-macroblock partition index
@@ -406,7 +406,7 @@ void neighbouring_4x4_chroma_block_ChromaArrayType_3(int32_t MbaffFrameFlag, int
  * @param out_subMbPartIdxD output parameter. sub-macroblock partition index
  * @return int 0 on success, negative value on error
  */
-int neighbouring_partitions_pre(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags,
+int neighbouring_partitions_pre(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags,
                             int32_t mbPartIdx, MB_TYPE_NAME currSubMbType, int32_t subMbPartIdx, MB_TYPE_NAME subMbPartType, int32_t* out_mbAddrA, int32_t* out_mbPartIdxA,
                             int32_t* out_subMbPartIdxA, int32_t* out_mbAddrB, int32_t* out_mbPartIdxB, int32_t* out_subMbPartIdxB, int32_t* out_mbAddrC, int32_t* out_mbPartIdxC,
                             int32_t* out_subMbPartIdxC, int32_t* out_mbAddrD, int32_t* out_mbPartIdxD, int32_t* out_subMbPartIdxD);
@@ -428,7 +428,7 @@ int neighbouring_partitions_post();
  * @param currMbFrameFlag whether the current macroblock is a frame macroblock. this parameter is used when MbaffFrameFlag is 1
  * @param PicWidthInMbs the picture width in macroblocks
  * @param mb_slice_ids the macroblock slices id array
- * @param mb_frame_flags the macroblock frame flags array. this parameter is used when MbaffFrameFlag is 1
+ * @param mb_field_flags the mb_field_decoding_flag bitset of the macroblocks. this parameter is used when MbaffFrameFlag is 1
  * @param xN input x location relative to the upper left corner of the current macroblock
  * @param yN input y location relative to the upper left corner of the current macroblock
  * @param maxW maximum values of the location components xN and xW
@@ -438,7 +438,7 @@ int neighbouring_partitions_post();
  * @param out_xW output parameter. the location xN expressed relative to the upper-left corner of the macroblock out_mbAddrN
  * @param out_yW output parameter. the location yN expressed relative to the upper-left corner of the macroblock out_mbAddrN
  */
-void neighbouring_locations(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags, int32_t xN,
+void neighbouring_locations(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags, int32_t xN,
                             int32_t yN, int32_t maxW, int32_t maxH, RELATIVE_LOCATION_TYPE* out_mbAddrN_type, int32_t* out_mbAddrN, int32_t* out_xW, int32_t* out_yW);
 
 /**
@@ -478,7 +478,7 @@ void neighbouring_locations_in_frame_non_MBAFF_frame(int32_t CurrMbAddr, int32_t
  * @param currMbFrameFlag whether the current macroblock is a frame macroblock.
  * @param PicWidthInMbs the picture width in macroblocks
  * @param mb_slice_ids the macroblock slices id array
- * @param mb_frame_flags the macroblock frame flags array.
+ * @param mb_field_flags the macroblock frame flags array.
  * @param xN input x location relative to the upper left corner of the current macroblock
  * @param yN input y location relative to the upper left corner of the current macroblock
  * @param maxW max width
@@ -488,7 +488,7 @@ void neighbouring_locations_in_frame_non_MBAFF_frame(int32_t CurrMbAddr, int32_t
  * @param out_xW output parameter. the location xN expressed relative to the upper-left corner of the macroblock out_mbAddrN
  * @param out_yW output parameter. the location yN expressed relative to the upper-left corner of the macroblock out_mbAddrN
  */
-void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags, int32_t xN,
+void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags, int32_t xN,
                                            int32_t yN, int32_t maxW, int32_t maxH, RELATIVE_LOCATION_TYPE* out_mbAddrN_type, int32_t* out_mbAddrN, int32_t* out_xW,
                                            int32_t* out_yW);
 
@@ -508,7 +508,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
  * @param yP the y location relative to the upper-left luma sample of a macroblock
  * @param out_luma4x4BlkIdx output parameter. the 4x4 luma block index
  */
-inline void derivate_4x4_luma_block_indices(int32_t xP, int32_t yP, int32_t* out_luma4x4BlkIdx);
+void derivate_4x4_luma_block_indices(int32_t xP, int32_t yP, int32_t* out_luma4x4BlkIdx);
 
 /**
  * @brief Derivation process for 4x4 chroma block indices
@@ -524,7 +524,7 @@ inline void derivate_4x4_luma_block_indices(int32_t xP, int32_t yP, int32_t* out
  * @param yP the y location relative to the upper-left chroma sample of a macroblock
  * @param out_chroma4x4BlkIdx output parameter. the 4x4 chroma block index
  */
-inline void derivate_4x4_chroma_block_indices(int32_t xP, int32_t yP, int32_t* out_chroma4x4BlkIdx);
+void derivate_4x4_chroma_block_indices(int32_t xP, int32_t yP, int32_t* out_chroma4x4BlkIdx);
 
 /**
  * @brief Derivation process for 8x8 luma block indices
@@ -539,7 +539,7 @@ inline void derivate_4x4_chroma_block_indices(int32_t xP, int32_t yP, int32_t* o
  * @param yP the y location relative to the upper-left luma sample of a macroblock
  * @param out_luma8x8BlkIdx output parameter. the 8x8 luma block index
  */
-inline void derivate_8x8_luma_block_indices(int32_t xP, int32_t yP, int32_t* out_luma8x8BlkIdx);
+void derivate_8x8_luma_block_indices(int32_t xP, int32_t yP, int32_t* out_luma8x8BlkIdx);
 
 /**
  * @brief Derivation process for macroblock and sub-macroblock partition indices
@@ -562,6 +562,6 @@ inline void derivate_8x8_luma_block_indices(int32_t xP, int32_t yP, int32_t* out
  * @param out_subMbPartIdx output parameter. the sub-macroblock partition index
  * @return int 0 on success, negative value on error
  */
-inline int derivate_mb_submb_partition_indices(int32_t xP, int32_t yP, MB_TYPE_NAME mbType, MB_TYPE_NAME* subMbType, int32_t* out_mbPartIdx, int32_t* out_subMbPartIdx);
+int derivate_mb_submb_partition_indices(int32_t xP, int32_t yP, MB_TYPE_NAME mbType, MB_TYPE_NAME* subMbType, int32_t* out_mbPartIdx, int32_t* out_subMbPartIdx);
 
 #endif
\ No newline at end of file
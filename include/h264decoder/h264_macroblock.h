@@ -6,8 +6,83 @@
 #include "h264_cabac.h"
 #include "h264_defs.h"
 #include "h264_error.h"
+#include "h264_picture.h"
+#include "h264_rbsp.h"
 
-struct FrameOrField;
+/**
+ * @brief check whether the macroblock is coded in an Intra macroblock prediction mode, I_PCM included
+ *
+ * @param mb the macroblock
+ * @return int32_t 1 for intra, 0 for inter
+ */
+static inline int32_t mb_is_intra(const MacroBlock* mb) { return mb->mb_pred_type <= Intra_16x16; }
+
+/**
+ * @brief check whether the luma 4x4 block contains non-zero transform coefficient levels. the 8x8 block containing the 4x4 block is checked when
+ * transform_size_8x8_flag is 1
+ * @see 8.7.2.1 Derivation process for the luma content dependent boundary filtering strength
+ *
+ * @param mb the macroblock
+ * @param luma4x4BlkIdx the luma 4x4 block index
+ * @return int32_t 1 if the block has non-zero coefficients, otherwise 0
+ */
+static inline int32_t mb_luma4x4_has_coeff(const MacroBlock* mb, int32_t luma4x4BlkIdx) { return (int32_t)((mb->coded_block_flags >> luma4x4BlkIdx) & 1u); }
+
+/**
+ * @brief check whether any of the luma blocks of the macroblock contains non-zero transform coefficient levels
+ *
+ * @param mb the macroblock
+ * @return int32_t 1 if any luma block has non-zero coefficients, otherwise 0
+ */
+static inline int32_t mb_luma_has_coeff(const MacroBlock* mb) { return (mb->coded_block_flags & H264_CBF_LUMA_MASK) != 0; }
+
+/**
+ * @brief get TotalCoeff( coeff_token ) of the 4x4 block, 16 is saturated to 15
+ * @see 9.2.1 Parsing process for total number of non-zero transform coefficient levels and number of trailing ones
+ *
+ * @param mb the macroblock
+ * @param iComp the colour component, 0 for luma, 1 for Cb, 2 for Cr
+ * @param blkIdx the 4x4 block index
+ * @return int32_t the TotalCoeff( coeff_token )
+ */
+static inline int32_t mb_total_coeff(const MacroBlock* mb, int32_t iComp, int32_t blkIdx) { return (int32_t)((mb->total_coeff[iComp] >> (blkIdx * 4)) & 0xF); }
+
+/**
+ * @brief get Intra4x4PredMode of the 4x4 luma block, or Intra8x8PredMode of the 8x8 luma block containing it
+ * @see 8.3.1.1 Derivation process for Intra4x4PredMode
+ *
+ * @param mb the macroblock
+ * @param luma4x4BlkIdx the 4x4 luma block index
+ * @return int32_t the prediction mode
+ */
+static inline int32_t mb_intra_nxn_pred_mode(const MacroBlock* mb, int32_t luma4x4BlkIdx) { return (int32_t)((mb->intra_pred_modes >> (luma4x4BlkIdx * 4)) & 0xF); }
+
+/**
+ * @brief the properties of the macroblock types and the sub-macroblock types, indexed by MB_TYPE_NAME
+ */
+extern const MB_TYPE_INFO g_mb_type_info[MB_TYPE_NAME_NUM];
+
+/**
+ * @brief get the properties of the macroblock type or the sub-macroblock type
+ *
+ * @param mb_type_name the macroblock type name or the sub-macroblock type name
+ * @return const MB_TYPE_INFO* the properties
+ */
+static inline const MB_TYPE_INFO* get_mb_type_info(MB_TYPE_NAME mb_type_name) { return &g_mb_type_info[mb_type_name]; }
+
+/**
+ * @brief get the macroblock type name of mb_type in the macroblock type table of the slice type
+ * @see Table 7-11 – Macroblock types for I slices
+ * @see Table 7-12 – Macroblock type with value 0 for SI slices
+ * @see Table 7-13 – Macroblock type values 0 to 4 for P and SP slices
+ * @see Table 7-14 – Macroblock type values 0 to 22 for B slices
+ *
+ * @param slice_type the revised slice type, see revise_slice_type_mb_type()
+ * @param mb_type the revised macroblock type
+ * @param out_mb_type_name output parameter. the macroblock type name
+ * @return int 0 on success, negative value on error
+ */
+int get_mb_type_name(int32_t slice_type, int32_t mb_type, MB_TYPE_NAME* out_mb_type_name);
 
 /**
  * @brief get the macroblock partition width
@@ -18,7 +93,7 @@ struct FrameOrField;
  * @param out_width output parameter. the partition width
  * @return int 0 on success, negative value on error
  */
-inline int MbPartWidth(MB_TYPE_NAME mb_type, int32_t* out_width);
+int MbPartWidth(MB_TYPE_NAME mb_type, int32_t* out_width);
 
 /**
  * @brief get the macroblock partition height
@@ -29,7 +104,7 @@ inline int MbPartWidth(MB_TYPE_NAME mb_type, int32_t* out_width);
  * @param out_height output parameter. the partition height
  * @return int 0 on success, negative value on error
  */
-inline int MbPartHeight(MB_TYPE_NAME mb_type, int32_t* out_height);
+int MbPartHeight(MB_TYPE_NAME mb_type, int32_t* out_height);
 
 /**
  * @brief get the macroblock partition width and height
@@ -41,7 +116,7 @@ inline int MbPartHeight(MB_TYPE_NAME mb_type, int32_t* out_height);
  * @param out_height output parameter. the partition height
  * @return int 0 on success, negative value on error
  */
-inline int MbPartWidthHeight(MB_TYPE_NAME mb_type, int32_t* out_width, int32_t* out_height);
+int MbPartWidthHeight(MB_TYPE_NAME mb_type, int32_t* out_width, int32_t* out_height);
 
 /**
  * @brief get the sub-macroblock partition width
@@ -52,7 +127,7 @@ inline int MbPartWidthHeight(MB_TYPE_NAME mb_type, int32_t* out_width, int32_t*
  * @param out_width output parameter. the partition width
  * @return int 0 on success, negative value on error
  */
-inline int SubMbPartWidth(MB_TYPE_NAME mb_type, int32_t* out_width);
+int SubMbPartWidth(MB_TYPE_NAME mb_type, int32_t* out_width);
 
 /**
  * @brief get the sub-macroblock partition height
@@ -63,7 +138,7 @@ inline int SubMbPartWidth(MB_TYPE_NAME mb_type, int32_t* out_width);
  * @param out_height output parameter. the partition height
  * @return int 0 on success, negative value on error
  */
-inline int SubMbPartHeight(MB_TYPE_NAME mb_type, int32_t* out_height);
+int SubMbPartHeight(MB_TYPE_NAME mb_type, int32_t* out_height);
 
 /**
  * @brief get the sub-macroblock partition width and height
@@ -75,7 +150,7 @@ inline int SubMbPartHeight(MB_TYPE_NAME mb_type, int32_t* out_height);
  * @param out_height output parameter. the partition height
  * @return int 0 on success, negative value on error
  */
-inline int SubMbPartWidthHeight(MB_TYPE_NAME mb_type, int32_t* out_width, int32_t* out_height);
+int SubMbPartWidthHeight(MB_TYPE_NAME mb_type, int32_t* out_width, int32_t* out_height);
 
 /**
  * @brief get the macroblock or sub macroblock partition width and height
@@ -160,6 +235,21 @@ int revise_slice_type_mb_type(int32_t slice_type, int32_t mb_type, int32_t* revi
  */
 int mb_pred(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t NumMbPart);
 
+/**
+ * @brief sub-macroblock prediction, the sub-macroblock types are stored in the macroblock, ref_idx and mvd in the macroblock scratch
+ * @see 7.3.5.2 Sub-macroblock prediction syntax
+ * @see 7.4.5.2 Sub-macroblock prediction semantics
+ *
+ * @param rbsp_reader the RBSPReader
+ * @param picture pointer to the FrameOrField
+ * @param mb the macroblock
+ * @param slice_header pointer to the slice header
+ * @param cabac pointer to the CABAC
+ * @param CurrMbAddr the current macroblock address
+ * @return int 0 on success, negative value on error
+ */
+int sub_mb_pred(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr);
+
 /**
  * @brief residual data
  * @see 7.3.5.3 Residual data syntax
@@ -189,30 +279,36 @@ int residual(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, Sli
  * @param slice_header pointer to the slice header
  * @param cabac pointer to the CABAC
  * @param CurrMbAddr the current macroblock address
+ * @param iComp the colour component of the levels, 0 for luma, 1 for Cb and 2 for Cr of ChromaArrayType equal to 3
  * @param startIdx the start index
  * @param endIdx the end index
  * @return int 0 on success, negative value on error
  */
-int residual_luma(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t startIdx, int32_t endIdx);
+int residual_luma(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t iComp, int32_t startIdx,
+                  int32_t endIdx);
 
 /**
- * @brief residual block cabac
+ * @brief parse the coefficient levels of a residual block with CABAC. coded_block_flag is coded with the non-zero block masks of the neighbouring blocks, which
+ * the caller sets as soon as each block is parsed
  * @see 7.3.5.3.3 Residual block CABAC syntax
  * @see 7.4.5.3.3 Residual block CABAC semantics
- * 
+ *
  * @param rbsp_reader the RBSPReader
  * @param picture pointer to the FrameOrField
- * @param mb the macroblock
  * @param slice_header pointer to the slice header
  * @param cabac pointer to the CABAC
  * @param CurrMbAddr the current macroblock address
- * @param coeffLevel the coefficient level
+ * @param ctxBlockCat the context block category of Table 9-42
+ * @param blkIdx the index of the 4x4 or 8x8 block of ctxBlockCat, 0 for the DC blocks
+ * @param iCbCr the chroma component of ctxBlockCat 3 and 4, -1 otherwise
+ * @param coeffLevel output parameter. the coefficient levels
  * @param startIdx the start index
  * @param endIdx the end index
  * @param maxNumCoeff the max number of coeff
+ * @param out_TotalCoeff output parameter. the number of non-zero coefficient levels
  * @return int 0 on success, negative value on error
  */
-int residual_block_cabac(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t* coeffLevel,
-                         int32_t startIdx, int32_t endIdx, int32_t maxNumCoeff);
+int residual_block_cabac(RBSPReader* rbsp_reader, FrameOrField* picture, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t ctxBlockCat, int32_t blkIdx,
+                         int32_t iCbCr, int32_t* coeffLevel, int32_t startIdx, int32_t endIdx, int32_t maxNumCoeff, int32_t* out_TotalCoeff);
 
 #endif
\ No newline at end of file
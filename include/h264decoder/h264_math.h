@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "h264_atomic.h"
+
 #define codec_max(a, b) (((a) > (b)) ? (a) : (b))
 #define codec_min(a, b) (((a) < (b)) ? (a) : (b))
 #define clip3(lower, upper, val) (((val) < (lower)) ? (lower) : (((val) > (upper)) ? (upper) : (val)))
@@ -10,6 +12,47 @@
 int int_log2(uint32_t v);
 int int_ceil_log2(uint32_t v);
 
+/**
+ * @brief count the leading zero bits of a 32-bit value, the count-leading-zeros instruction is used when the compiler supports it
+ *
+ * @param v the value
+ * @return int the number of leading zero bits, 32 if v is 0
+ */
+static inline int count_leading_zeros(uint32_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return v ? __builtin_clz(v) : 32;
+#else
+    return v ? 31 - int_log2(v) : 32;
+#endif
+}
+
+/**
+ * @brief get a bit of the bitset. the slice threads decoding concurrently read the state of the neighbouring macroblocks of each other to derive their
+ * availability, see h264_slice_thread.h, so the word is loaded atomically
+ *
+ * @param bits the bitset, 32 bits per word
+ * @param idx the bit index
+ * @return int32_t the bit value, 0 or 1
+ */
+static inline int32_t bitset_get(const uint32_t* bits, int32_t idx) { return (int32_t)((uint32_t)load_shared_i32((const int32_t*)&bits[idx >> 5]) >> (idx & 31) & 1u); }
+
+/**
+ * @brief set a bit of the bitset. a word holds the bits of the macroblocks of several slices which the slice threads decode concurrently, so the bit is set by an
+ * atomic read-modify-write
+ *
+ * @param bits the bitset, 32 bits per word
+ * @param idx the bit index
+ * @param value the bit value, 0 or 1
+ */
+static inline void bitset_set(uint32_t* bits, int32_t idx, int32_t value) {
+    uint32_t mask = 1u << (idx & 31);
+    if (value) {
+        set_shared_bits(&bits[idx >> 5], mask);
+    } else {
+        clear_shared_bits(&bits[idx >> 5], mask);
+    }
+}
+
 /**
  * @brief convert the macroblock address or block index to the upper-left location (x or y) of the picture
  *
@@ -20,6 +63,6 @@ int int_ceil_log2(uint32_t v);
  * @param is_y 0 for x, 1 for y
  * @return int32_t the position, x on is_y==0, y on is_y==1
  */
-inline int32_t InverseRasterScan(int32_t index, int32_t sub_width, int32_t sub_height, int32_t width, int32_t is_y);
+int32_t InverseRasterScan(int32_t index, int32_t sub_width, int32_t sub_height, int32_t width, int32_t is_y);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#ifndef _H_H264_MEMORY_H_
+#define _H_H264_MEMORY_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "h264_error.h"
+
+/**
+ * Memory budgets
+ *
+ * A memory budget counts the bytes of the large allocations of the decoder by category and may cap them. The pictures of a picture pool charge their sample planes,
+ * their macroblock arrays and their scratch to the budget of the pool before they allocate them, and a charge which exceeds the limit is refused with
+ * ERR_MEMORY_BUDGET_EXCEEDED, so the decoder fails the allocation before it asks the system for the memory.
+ *
+ * The budgets form a tree, the budget of a context is the child of the budget of its decoder group. A charge is counted by the budget and by all of its ancestors.
+ * A child with a limit reserves the limit from its parent: the limits of the children and the bytes charged to the parent by the children without a limit and by the
+ * parent itself do not exceed the limit of the parent, so a child is refused only by its own limit and a new child is refused if its limit does not fit. The
+ * budgets of a tree are locked by the mutex of the root.
+ */
+
+/**
+ * @brief the categories of the counted allocations
+ */
+typedef enum MEMORY_CATEGORY {
+    MEMORY_FRAME_BUFFERS = 0, /* the sample planes of the pictures */
+    MEMORY_MB_METADATA = 1,   /* the macroblock arrays, the motion data and the slice tables of the frames and fields */
+    MEMORY_SCRATCH = 2,       /* the residual records of the reconstruction stage */
+} MEMORY_CATEGORY;
+
+/* the number of the categories */
+#define H264_MEMORY_CATEGORIES 3
+
+/**
+ * @brief the limit and the counters of a budget
+ */
+typedef struct MemoryBudget {
+    /* the budget which the charges are counted by too, 0 for a root */
+    struct MemoryBudget* parent;
+    /* locks the counters of the budgets of the tree, only the mutex of the root is used */
+    pthread_mutex_t mutex;
+
+    /* the cap of the bytes charged to the budget and its children, 0 for none */
+    size_t limit;
+    /* the limits of the children, reserved from the limit */
+    size_t reserved;
+    /* the bytes charged to the budget by itself and by the children without a limit, they are checked against limit - reserved */
+    size_t unreserved;
+
+    /* the bytes charged to the budget and its children, in total and by category, and their maximum */
+    size_t total;
+    size_t peak_total;
+    size_t current[H264_MEMORY_CATEGORIES];
+    size_t peak[H264_MEMORY_CATEGORIES];
+    /* the number of the refused charges */
+    uint32_t refused;
+} MemoryBudget;
+
+/**
+ * @brief a snapshot of the counters of a budget
+ */
+typedef struct {
+    size_t limit;
+    size_t total;
+    size_t peak_total;
+    size_t current[H264_MEMORY_CATEGORIES];
+    size_t peak[H264_MEMORY_CATEGORIES];
+    uint32_t refused;
+} MemoryUsage;
+
+/**
+ * @brief initialize a budget without a limit
+ *
+ * @param budget the budget
+ * @param parent the parent budget, 0 for a root
+ * @return int 0 on success, negative value on error
+ */
+int init_memory_budget(MemoryBudget* budget, MemoryBudget* parent);
+
+/**
+ * @brief free the budget and return its limit to the parent, nothing MUST be charged to it or to its children
+ *
+ * @param budget the budget
+ */
+void free_memory_budget(MemoryBudget* budget);
+
+/**
+ * @brief move the budget under another parent, nothing MUST be charged to it, and it MUST have no limit and no children
+ *
+ * @param budget the budget
+ * @param parent the new parent budget, 0 for a root
+ * @return int 0 on success, negative value on error
+ */
+int set_memory_budget_parent(MemoryBudget* budget, MemoryBudget* parent);
+
+/**
+ * @brief set the limit of the budget, a limit is reserved from the parent. it may be invoked while the budget is charged
+ *
+ * @param budget the budget
+ * @param limit the cap in bytes, 0 for none
+ * @return int 0 on success, negative value on error. ERR_MEMORY_BUDGET_EXCEEDED if the budget is charged more than the limit, or the limit does not fit the
+ * limit of the parent
+ */
+int set_memory_budget_limit(MemoryBudget* budget, size_t limit);
+
+/**
+ * @brief charge an allocation to the budget before it is made
+ *
+ * @param budget the budget, 0 for an allocation which is not counted
+ * @param category the category of the allocation
+ * @param size the size of the allocation in bytes
+ * @return int 0 on success, negative value on error. ERR_MEMORY_BUDGET_EXCEEDED if the charge exceeds the limit of the budget or of an ancestor, nothing is charged
+ */
+int charge_memory(MemoryBudget* budget, MEMORY_CATEGORY category, size_t size);
+
+/**
+ * @brief return the charge of a freed allocation to the budget
+ *
+ * @param budget the budget, 0 for an allocation which is not counted
+ * @param category the category of the allocation
+ * @param size the size of the allocation in bytes
+ */
+void uncharge_memory(MemoryBudget* budget, MEMORY_CATEGORY category, size_t size);
+
+/**
+ * @brief the bytes which a charge to the budget may add without being refused
+ *
+ * @param budget the budget, 0 for the allocations which are not counted
+ * @return size_t the bytes, SIZE_MAX if neither the budget nor an ancestor checks the charge
+ */
+size_t get_memory_room(MemoryBudget* budget);
+
+/**
+ * @brief read the counters of the budget
+ *
+ * @param budget the budget
+ * @param usage output parameter. the counters
+ */
+void get_memory_budget_usage(MemoryBudget* budget, MemoryUsage* usage);
+
+#endif
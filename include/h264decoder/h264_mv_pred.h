@@ -0,0 +1,48 @@
+#ifndef _H_H264_MV_PRED_H_
+#define _H_H264_MV_PRED_H_
+
+#include <stdint.h>
+
+#include "h264_defs.h"
+#include "h264_error.h"
+#include "h264_picture.h"
+
+/**
+ * Motion vector prediction
+ *
+ * @see 8.4.1 Derivation process for motion vector components and reference indices
+ *
+ * The motion vectors and the reference indices are stored per 4x4 block in the arrays mvs and ref_idxs of FrameOrField. The motion data of the neighbouring 4x4 blocks is
+ * loaded once per macroblock into MvCache by init_mv_cache(), the neighbouring partitions A, B, C and D of every partition are then fixed offsets from the index of the
+ * partition in the cache, see MV_CACHE_IDX(). The derived motion data of every partition is written into the cache, so the later partitions of the macroblock find it
+ * at the same offsets, and the 16 blocks of the macroblock are stored to the picture when the macroblock is done.
+ *
+ * The parsing of ref_idx and mvd writes the parsed values into the cache too, the ctxIdxInc derivations of CABAC read the neighbouring partitions from it.
+ */
+
+/**
+ * @brief load the motion data of the 4x4 blocks left of the macroblock, above it, above-left and above-right of it into the cache, the blocks of the macroblock are not
+ * available. it is invoked before the prediction syntax of the macroblock is parsed
+ * @see 8.4.1.3.2 Derivation process for motion data of neighbouring partitions
+ *
+ * @param picture the frame or field
+ * @param slice_header the slice header
+ * @param CurrMbAddr the current macroblock address
+ */
+void init_mv_cache(FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr);
+
+/**
+ * @brief Derivation process for motion vector components and reference indices of all the partitions of the macroblock, the motion data is stored to the picture
+ * @see 8.4.1 Derivation process for motion vector components and reference indices
+ *
+ * The macroblock type, the sub-macroblock types, ref_idx and mvd are read from the macroblock, the picture and the macroblock scratch. For the intra macroblocks the
+ * reference indices are set to -1.
+ *
+ * @param picture the frame or field
+ * @param slice_header the slice header
+ * @param CurrMbAddr the current macroblock address
+ * @return int 0 on success, negative value on error
+ */
+int derivation_for_motion_vectors(FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr);
+
+#endif
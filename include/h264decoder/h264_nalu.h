@@ -26,6 +26,17 @@ char* stringify_nalu_type(uint8_t nalu_type);
  */
 void free_nalu(void* nalu);
 
+/**
+ * @brief parse the NAL unit header, and the size of its extension for the prefix NAL units and the coded slice extensions
+ * @see 7.3.1 NAL unit syntax
+ *
+ * @param nalu_start the NALU start position(inclusive)
+ * @param nalu_end the NALU end position(exclusive)
+ * @param header output parameter, the NAL unit header
+ * @return int the size of the NAL unit header in bytes, negative value on error
+ */
+int nal_unit_header(const uint8_t* nalu_start, const uint8_t* nalu_end, NALUHeader* header);
+
 /**
  * @brief check if there is more rbsp data
  * @see 7.2 Specification of syntax functions, categories, and descriptors
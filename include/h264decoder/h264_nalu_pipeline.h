@@ -0,0 +1,110 @@
+#ifndef _H_H264_NALU_PIPELINE_H_
+#define _H_H264_NALU_PIPELINE_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "h264_context.h"
+#include "h264_error.h"
+#include "h264_nalu.h"
+#include "h264_stream.h"
+
+/**
+ * Parsing ahead of the decoding
+ *
+ * A parsing thread scans the byte stream for the start codes, extracts the RBSP of every NALU and parses the NAL unit header, the parameter sets and the slice
+ * headers, while the decoding thread decodes the NALUs parsed before. The NALUs are handed over in a bounded ring of descriptors with one producer and one
+ * consumer: the parsing thread publishes a descriptor by advancing the head and the decoding thread releases it by advancing the tail, both without a lock, and a
+ * thread only takes the mutex to sleep when the ring is full or empty. The descriptors are allocated with the ring and their RBSP buffers are kept for the later
+ * NALUs, so nothing is allocated per NALU once the buffers fit the largest NALU.
+ *
+ * The parsing thread keeps the parameter sets and the slice header state of its own parsing context, which decodes nothing. A parameter set is parsed once for
+ * the parsing context and once for the decoding context, and the decoding thread installs its copy when it reaches the descriptor, so the decoding context has the
+ * same parameter sets for a slice as the parsing thread had when it parsed the slice header. The slice header is rebound to the parameter sets of the decoding
+ * context by their identifiers before the slice is decoded.
+ */
+
+/* the number of the descriptors of the ring, a power of 2 */
+#define H264_NALU_PIPELINE_DEPTH 16
+
+/**
+ * @brief a NALU parsed ahead of its decoding
+ */
+typedef struct {
+    /* the NALU in the byte stream */
+    const uint8_t* nalu_start;
+    const uint8_t* nalu_end;
+    NALUHeader nalu_header;
+
+    /* the RBSP of the NALU and its reader, positioned after the slice header for a slice. the buffer is kept for the later NALUs of the descriptor, unless the frame
+     * or slice threads take it over with the slice */
+    uint8_t* rbsp_buffer;
+    size_t rbsp_capacity;
+    RBSPReader reader;
+
+    /* the slice header of a slice, the decoding thread takes over its slice group maps */
+    SliceHeader header;
+    /* 1 if the slice is the first VCL NAL unit of a primary coded picture, it starts an access unit */
+    int32_t first_VCL_NAL;
+    /* the SPS or PPS parsed for the decoding context, the decoding thread takes it over */
+    void* parameter_set;
+
+    /* the error of the parsing, it is reported by the decoding of the NALU */
+    int err_code;
+    /* 1 for the descriptor after the last NALU of the stream */
+    int32_t end_of_stream;
+} NaluDescriptor;
+
+/**
+ * @brief the parsing thread and the ring of the descriptors
+ */
+typedef struct NaluPipeline {
+    H264BitStream stream;
+    /* the parameter sets and the slice headers of the parsing thread */
+    H264Context* parse_context;
+
+    NaluDescriptor descriptors[H264_NALU_PIPELINE_DEPTH];
+    /* the number of the descriptors published by the parsing thread and released by the decoding thread, each written atomically by its own thread */
+    uint32_t head;
+    uint32_t tail;
+    /* the thread waiting for a free or a published descriptor, written atomically under the mutex */
+    int32_t producer_waiting;
+    int32_t consumer_waiting;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    /* signaled when a descriptor is released while the parsing thread waits, or the thread quits */
+    pthread_cond_t not_full;
+    /* signaled when a descriptor is published while the decoding thread waits */
+    pthread_cond_t not_empty;
+    int32_t quit;
+} NaluPipeline;
+
+/**
+ * @brief create the ring and start the parsing thread on the byte stream
+ *
+ * @param data the byte stream, it MUST stay valid until the pipeline is freed
+ * @param size the size of the byte stream in bytes
+ * @return NaluPipeline* the pipeline, return 0 if the creation fails
+ */
+NaluPipeline* create_nalu_pipeline(uint8_t* data, size_t size);
+
+/**
+ * @brief stop the parsing thread and free the descriptors which are not decoded
+ * the parameter pipeline pointer becomes an invalid pointer after this free_nalu_pipeline() was invoked
+ *
+ * @param pipeline the pipeline
+ */
+void free_nalu_pipeline(NaluPipeline* pipeline);
+
+/**
+ * @brief decode the next NALU of the stream, waiting for the parsing thread if it is not parsed yet. the parameter sets are added to the context and the end of
+ * sequence and end of stream NALUs flush it, as parse_nalu() with add_sps_to_context() and add_pps_to_context() would
+ *
+ * @param pipeline the pipeline
+ * @param context the H264 context decoding the stream
+ * @return int 0 on success, ERR_EOS after the last NALU, other negative value on the error of the NALU
+ */
+int decode_next_nalu(NaluPipeline* pipeline, H264Context* context);
+
+#endif
@@ -1,42 +1,330 @@
 #ifndef _H_H264_PICTURE_H_
 #define _H_H264_PICTURE_H_
 
+#include <pthread.h>
 #include <stdint.h>
 
 #include "h264_defs.h"
 #include "h264_error.h"
-#include "h264_macroblock.h"
 #include "h264_math.h"
+#include "h264_memory.h"
 #include "h264_nalu.h"
+#include "h264_rbsp.h"
 
+struct FrameOrField;
+struct FrameThreads;
+struct Picture;
+struct ResidualStore;
+
+/**
+ * @brief the marking of a field for the reference
+ * @see 8.2.5 Decoded reference picture marking process
+ */
+typedef enum REF_PIC_MARKING {
+    REF_PIC_UNUSED = 0,     /* unused for reference */
+    REF_PIC_SHORT_TERM = 1, /* used for short-term reference */
+    REF_PIC_LONG_TERM = 2   /* used for long-term reference */
+} REF_PIC_MARKING;
+
+/* the alignment of the sample ( 0, 0 ) and of the rows of the sample planes in bytes, a row of a macroblock starts at a cache line for any SIMD load width */
+#define H264_PLANE_ALIGN 64
+/* the default border around the luma planes in samples, the chroma borders are scaled by SubWidthC. it is at least H264_MC_LUMA_BORDER */
+#define H264_PLANE_BORDER 32
+/* the largest border around the luma planes in samples */
+#define H264_PLANE_MAX_BORDER 256
+
+/* FrameOrField::decoded_mb_rows of a frame or field which is decoded completely, the pictures decoded by the decoding thread have it from the start */
+#define H264_ALL_MB_ROWS INT32_MAX
+
+/**
+ * @brief the layout of a sample plane of a frame or field, the samples are owned by the picture. the layout is kept for the lifetime of the picture in the pool, so
+ * the output may reference the planes instead of copying them
+ */
+typedef struct {
+    /* the sample ( 0, 0 ), H264_PLANE_ALIGN aligned for the frames. uint16_t samples if bytes_per_sample is 2, 0 if the plane is not present */
+    uint8_t* data;
+    /* the row stride in samples, stride * bytes_per_sample is a multiple of H264_PLANE_ALIGN */
+    int32_t stride;
+    /* the width and the height of the frame or field in samples */
+    int32_t width;
+    int32_t height;
+    /* the border in samples on every side, the samples of the border are valid after pad_frame_or_field() */
+    int32_t border;
+    /* 1 for the bit depth 8 and 2 for the bit depths greater than 8 */
+    int32_t bytes_per_sample;
+} SamplePlane;
+
+/**
+ * @brief an entry of a reference picture list
+ */
+typedef struct {
+    /* the reference frame or field, it identifies the reference picture. 0 for the entries which are not set */
+    struct FrameOrField* ff;
+    /* PicOrderCnt( ) of the reference frame or field */
+    int32_t poc;
+    /* 1 for a long-term reference picture */
+    uint8_t long_term;
+} RefPicEntry;
+
+/**
+ * @brief RefPicList0 and RefPicList1 of a slice, they are kept for the whole picture since the temporal direct prediction of the later pictures and the deblocking filter
+ * look up the reference pictures referred by the reference indices of the macroblocks
+ */
+typedef struct {
+    RefPicEntry entries[2][H264_MAX_REFS];
+    /* num_ref_idx_l0_active_minus1 + 1 and num_ref_idx_l1_active_minus1 + 1 */
+    int32_t num[2];
+} RefPicLists;
+
+/**
+ * @brief the parameters of a slice read by the deblocking filter, it filters the edges of a macroblock with the parameters of the slice containing the macroblock
+ * @see 8.7 Deblocking filter process
+ */
 typedef struct {
+    /* disable_deblocking_filter_idc */
+    uint8_t disable_deblocking_filter_idc;
+    /* 1 for SP and SI slices, their macroblocks are filtered as the intra macroblocks */
+    uint8_t is_switching_slice;
+    /* FilterOffsetA and FilterOffsetB, equations 7-32 and 7-33 */
+    int8_t FilterOffsetA;
+    int8_t FilterOffsetB;
+    /* chroma_qp_index_offset and second_chroma_qp_index_offset */
+    int8_t chroma_qp_index_offset[2];
+    /* field_pic_flag and MbaffFrameFlag, they are equal for all the slices of a picture */
+    uint8_t field_pic_flag;
+    uint8_t MbaffFrameFlag;
+} SliceDeblockParams;
+
+typedef struct FrameOrField {
     /* the coded type */
     PICTURE_CODED_TYPE coded_type;
 
+    /**
+     * the per-macroblock metadata read by the neighbour derivations, the deblocking filter and the motion vector prediction, stored as parallel narrow arrays of
+     * mb_list_len entries. they are carved from the single allocation mb_meta_buffer.
+     */
+    uint8_t* mb_meta_buffer;
+
+    /* the number of the slice which the macroblock belongs to in decoding order, -1 if the macroblock is not decoded yet */
     int32_t* mb_slice_ids;
-    int mb_slice_ids_len;
+    /* mb_field_decoding_flag of the macroblocks, one bit per macroblock, see bitset_get() */
+    uint32_t* mb_field_flags;
+    /* mb_skip_flag of the macroblocks */
+    uint8_t* mb_skip_flags;
+    /* MB_TYPE_NAME of the macroblocks */
+    uint8_t* mb_type_names;
+    /* QPY of the macroblocks */
+    int8_t* mb_qps;
+
+    /* QPY,PRED of the next macroblock in decoding order, it is SliceQPY at the start of the slice */
+    int32_t QPY_pred;
+
+    /**
+     * the motion data of the 4x4 blocks, 16 blocks per macroblock in raster order within the macroblock, carved from the single allocation mv_buffer.
+     * the blocks of the intra macroblocks have the reference index -1 and the motion vector 0
+     */
+    uint8_t* mv_buffer;
+    /* mvL0 and mvL1, one int16 pair per block */
+    int16_t* mvs[2];
+    /* refIdxL0 and refIdxL1, -1 if predFlagLX is 0 */
+    int8_t* ref_idxs[2];
+    /* the absolute values of the components of mvd_l0 and mvd_l1 clipped to 255, read by the CABAC ctxIdxInc derivation of mvd */
+    uint8_t* mvds[2];
+
+    /* the reference picture lists of the slices, indexed by the slice number of mb_slice_ids */
+    RefPicLists* slice_ref_lists;
+    int32_t slice_ref_lists_capacity;
+    /* the deblocking filter parameters of the slices, indexed by the slice number of mb_slice_ids, the capacity is slice_ref_lists_capacity */
+    SliceDeblockParams* slice_deblock_params;
+    /* the number of the slices of the frame or field started so far, the current slice is slice_count - 1 */
+    int32_t slice_count;
 
-    int32_t* mb_frame_flags;
-    int mb_frame_flags_len;
+    /* the identifier of the frame or field which is unique within the picture pool, the deblocking filter compares the reference pictures by it */
+    int32_t ref_pic_id;
+
+    /* PicOrderCnt( ) of the frame or field */
+    int32_t poc;
+    /* the picture which the frame or field belongs to */
+    struct Picture* parent;
 
     MacroBlock* mb_list;
     int mb_list_len;
+    /* the address of the macroblock which the next slice starts at if the slices are decoded in raster order, -1 once a slice starts elsewhere */
     int current_mb;
 
+    /* the number of the leading macroblock rows of the frame or field which are decoded, in the rows of the frame or field. it is published by the frame threads,
+     * see h264_frame_thread.h, and is H264_ALL_MB_ROWS for the pictures decoded by the decoding thread */
+    int32_t decoded_mb_rows;
+    /* the arrays of slice_ref_lists replaced when it grows, the frame threads of the later pictures may still read the lists of the co-located macroblocks from
+     * them. they are freed when the frame or field is reset */
+    RefPicLists* retired_ref_lists[32];
+    int32_t retired_ref_lists_count;
+    size_t retired_ref_lists_size;
+
+    /* the coefficient levels and PCM samples of the macroblock being decoded, in the scratch of the thread decoding the slice. it is attached by slice_data()
+     * while the slice is decoded and is 0 otherwise, every decoding thread owns one scratch */
+    MacroBlockScratch* mb_scratch;
+    /* the residual records of the macroblocks for the reconstruction stage, see h264_reconstruct.h. 0 until the frame or field is first reconstructed */
+    struct ResidualStore* residuals;
+
+    /**
+     * the Y, Cb and Cr planes, or the 3 colour planes for separate_colour_plane_flag equal to 1. the Cb and Cr planes are not present for chroma_format_idc equal to 0.
+     * the fields view the alternate rows of the frame, the top field starts at row 0 and the bottom field at row 1 of the frame
+     */
+    SamplePlane planes[3];
+    /* the number of the present planes, 0 if the samples are not allocated */
+    int32_t plane_count;
+
+    /* the bytes of the allocations of the frame or field charged to the memory budget of the picture by category, see charge_frame_or_field() */
+    size_t memory[H264_MEMORY_CATEGORIES];
 } FrameOrField;
 
 /**
- * @brief the picture
+ * @brief the picture, a frame store of the DPB holding a frame, a complementary field pair or a non-paired field
  */
-typedef struct {
+typedef struct Picture {
     /* the picture coded type */
     PICTURE_CODED_TYPE coded_type;
 
+    /**
+     * the number of the holders of the picture: the decoder while the picture is decoded, the DPB while it is stored and the output queue or the application
+     * after it is output. the picture returns to the pool when the last holder releases it, see release_picture()
+     */
+    int32_t ref_count;
+    /* the slot of the picture in the pool and the generation of the pool geometry which the picture is allocated for */
+    int32_t pool_index;
+    int32_t pool_generation;
+
+    /* the fields decoded so far, bit 0 for the top field and bit 1 for the bottom field, 3 for a frame */
+    uint8_t decoded_fields;
+    /* nal_ref_idc is not equal to 0 for the slices of the picture */
+    uint8_t is_reference;
+    /* IdrPicFlag of the picture */
+    uint8_t is_idr;
+    /* the picture has memory_management_control_operation equal to 5 */
+    uint8_t has_mmco5;
+    /* a frame inferred for a gap in frame_num, it has no decoded samples and is not referred by the inter prediction */
+    uint8_t non_existing;
+    /* the picture is stored in the DPB */
+    uint8_t in_dpb;
+    /* the picture is waiting for the output */
+    uint8_t needed_for_output;
+    /* the marking of the top and the bottom field, REF_PIC_MARKING, both fields have the marking of the frame */
+    uint8_t ref_marking[2];
+
+    /* the index of the picture in the decoding order */
+    uint32_t decode_index;
+    /* the decode-to-output latency, the number of the pictures whose decoding started after the picture before it was output. -1 until it is output */
+    int32_t output_latency;
+
+    /* the sample format and the cropping rectangle in luma samples of the sps which the picture is decoded with, see init_picture_format() */
+    uint32_t chroma_format_idc;
+    uint32_t BitDepthY;
+    uint32_t BitDepthC;
+    int32_t crop_left;
+    int32_t crop_top;
+    int32_t crop_width;
+    int32_t crop_height;
+    /* the presentation and decoding timestamps of the access unit, H264_NO_TIMESTAMP if the application has set none */
+    int64_t pts;
+    int64_t dts;
+    /* the number of the frame handles of the application holding the picture, guarded by the mutex of the frame delivery, see h264_frame.h */
+    int32_t frame_ref_count;
+    /* the frame threads decoding the picture, 0 if it is decoded by the decoding thread, see h264_frame_thread.h */
+    struct FrameThreads* threads;
+
+    /* FrameNum, frame_num of the picture. 0 after memory_management_control_operation equal to 5 */
+    int32_t FrameNum;
+    /* LongTermFrameIdx of the fields marked as used for long-term reference */
+    int32_t LongTermFrameIdx;
+    /* FrameNumWrap, and PicNum and LongTermPicNum of the top and the bottom field, or of the frame in both entries, for the frame or field whose reference picture
+     * lists are constructed last, see h264_ref_list.h */
+    int32_t FrameNumWrap;
+    int32_t PicNum[2];
+    int32_t LongTermPicNum[2];
+
     FrameOrField* frame;
     FrameOrField* top_field;
     FrameOrField* bottom_field;
+
+    /* the single allocation of the sample planes of the frame and of the fields, sample_buffer is the H264_PLANE_ALIGN aligned start of sample_alloc */
+    void* sample_alloc;
+    uint8_t* sample_buffer;
+    size_t sample_buffer_size;
+
+    /* the budget which the allocations of the picture and of its frame and fields are charged to, 0 if they are not counted */
+    MemoryBudget* budget;
 } Picture;
 
+/**
+ * @brief the number of the frame stores of the DPB for the SPS, Max( MaxDpbFrames, max_num_ref_frames ) so that the streams exceeding the DPB size of the level
+ * still decode
+ *
+ * @param sps the active sps
+ * @return int32_t the number of the frame stores, 1 to H264_MAX_DPB_FRAMES
+ */
+static inline int32_t get_dpb_frame_count(const SPS* sps) {
+    return (int32_t)codec_min(codec_max(codec_max(sps->MaxDpbFrames, sps->max_num_ref_frames), 1), H264_MAX_DPB_FRAMES);
+}
+
+/* the timestamp of a picture whose access unit has no timestamp */
+#define H264_NO_TIMESTAMP INT64_MIN
+
+/* the maximum number of the pictures of the pool: the frame stores of the DPB, the current picture and the output pictures not released by the application */
+#define H264_MAX_POOL_PICTURES (2 * H264_MAX_DPB_FRAMES + 1)
+
+/* the maximum number of the idle pictures kept by a shared picture pool */
+#define H264_MAX_SHARED_PICTURES 64
+
+/**
+ * @brief the idle pictures shared by the picture pools of several contexts, see h264_decoder_group.h. a picture pool hands the pictures which it would free to the
+ * shared pool, and takes a picture of the same geometry from it before it allocates one, so the sample planes and the macroblock arrays move between the streams
+ * instead of being freed and allocated again. the idle pictures are charged to the budget of the shared pool, and they are freed when the budget has no room
+ * for them or when a picture pool needs their room
+ */
+typedef struct SharedPicturePool {
+    pthread_mutex_t mutex;
+    Picture* pictures[H264_MAX_SHARED_PICTURES];
+    int32_t count;
+    /* the budget which the idle pictures are charged to, 0 if they are not counted */
+    MemoryBudget* budget;
+} SharedPicturePool;
+
+/**
+ * @brief the pool of the pictures, the pictures are allocated on demand for the geometry of the active SPS and recycled when they are released. the pool holds
+ * no more pictures than the decoding of the stream has needed at once, up to the frame stores of the DPB, the current picture and as many output pictures as
+ * the DPB has frame stores
+ */
+typedef struct {
+    /* the pictures indexed by their slots, 0 for the slots which are not allocated */
+    Picture* pictures[H264_MAX_POOL_PICTURES];
+    /* the number of the usable slots, twice the DPB size of the active SPS + 1 */
+    int size;
+    /* the generation of the geometry, the pictures of the previous generations are freed when they are released */
+    int32_t generation;
+
+    /* the geometry which the pictures are allocated for */
+    uint32_t PicWidthInMbs;
+    uint32_t FrameHeightInMbs;
+    uint8_t frame_mbs_only_flag;
+    uint32_t chroma_format_idc;
+    uint8_t separate_colour_plane_flag;
+    uint32_t BitDepthY;
+    uint32_t BitDepthC;
+    int32_t border;
+
+    /* the border of the luma planes set by set_picture_pool_border(), the pictures are reallocated with it when the pool is initialized next. 0 for H264_PLANE_BORDER */
+    int32_t requested_border;
+
+    /* the pool which the pictures are handed to instead of being freed, and taken from before they are allocated. 0 if the pool is not shared */
+    SharedPicturePool* shared;
+
+    /* the budget which the pictures are charged to, 0 if they are not counted. a picture which does not fit it is not allocated */
+    MemoryBudget* budget;
+    /* the bytes of the largest picture of the geometry charged so far, 0 until a picture is allocated */
+    size_t picture_memory;
+} PicturePool;
+
 /**
  * @brief create a frame or field
  * 
@@ -45,16 +333,55 @@ typedef struct {
 FrameOrField* create_frame_or_field();
 
 /**
- * @brief initialize the frame or field
+ * @brief allocate the macroblock arrays of the frame or field, the arrays are reallocated only if PicSizeInMbs differs from the allocated size
+ *
+ * @param ff pointer to FrameOrField
+ * @param PicSizeInMbs the number of macroblocks of the frame or field
+ * @return int 0 on success, negative value on error
+ */
+int alloc_frame_or_field(FrameOrField* ff, int32_t PicSizeInMbs);
+
+/**
+ * @brief charge an allocation of the frame or field to the memory budget of its picture before it is made, the charges are returned when the frame or field is
+ * freed or reallocated
+ *
+ * @param ff pointer to FrameOrField
+ * @param category the category of the allocation
+ * @param size the size of the allocation in bytes
+ * @return int 0 on success, negative value on error. ERR_MEMORY_BUDGET_EXCEEDED if the budget has no room for it
+ */
+int charge_frame_or_field(FrameOrField* ff, MEMORY_CATEGORY category, size_t size);
+
+/**
+ * @brief return the charge of an allocation of the frame or field which is freed before the frame or field
+ *
+ * @param ff pointer to FrameOrField
+ * @param category the category of the allocation
+ * @param size the size of the allocation in bytes
+ */
+void uncharge_frame_or_field(FrameOrField* ff, MEMORY_CATEGORY category, size_t size);
+
+/**
+ * @brief initialize the frame or field for decoding a slice, the slice gets the next slice number, its deblocking filter parameters and a copy of its reference
+ * picture lists
  * 
  * @param ff pointer to FrameOrField 
  * @param slice_header pointer to the slice header
+ * @param ref_lists the reference picture lists of the slice
  * @return int 0 on success, negative value on error
  */
-int init_frame_or_field(FrameOrField* ff, SliceHeader* slice_header);
+int init_frame_or_field(FrameOrField* ff, SliceHeader* slice_header, const RefPicLists* ref_lists);
 
 /**
- * @brief reset frame of field
+ * @brief get the reference picture lists of the slice which the frame or field is decoding
+ *
+ * @param ff pointer to FrameOrField
+ * @return RefPicLists* the reference picture lists of the current slice
+ */
+static inline RefPicLists* get_current_ref_lists(FrameOrField* ff) { return &ff->slice_ref_lists[ff->slice_count - 1]; }
+
+/**
+ * @brief reset frame of field for decoding a new picture, only the state read before it is written is reset, the arrays are kept
  * 
  * @param ff pointer to FrameOrField 
  */
@@ -75,7 +402,53 @@ void free_frame_or_field(FrameOrField* ff);
 Picture* create_picture();
 
 /**
- * @brief reset the picture
+ * @brief fill the borders of the sample planes of the frame or field with the nearest edge samples, it is invoked after the frame or field is deblocked so that it
+ * is referred by the motion compensation without bounds checks. the frame and the fields share the samples, so only the frame or field referred by the later
+ * pictures in its coded structure is padded
+ *
+ * @param ff pointer to FrameOrField
+ */
+void pad_frame_or_field(FrameOrField* ff);
+
+/**
+ * @brief pad_frame_or_field() of the macroblock rows [ first_row, end_row ) whose samples are final, the borders above and below are filled with the first and
+ * the last row
+ *
+ * @param ff pointer to FrameOrField
+ * @param first_row the first macroblock row to pad
+ * @param end_row the macroblock row after the last row to pad
+ */
+void pad_frame_or_field_rows(FrameOrField* ff, int32_t first_row, int32_t end_row);
+
+/**
+ * @brief allocate the frame and the fields of the picture for the geometry of the SPS, the sample planes of the frame and of the fields share one allocation
+ *
+ * @param picture the picture
+ * @param sps the sps
+ * @param border the border of the luma planes in samples, H264_MC_LUMA_BORDER to H264_PLANE_MAX_BORDER
+ * @return int 0 on success, negative value on error
+ */
+int alloc_picture(Picture* picture, SPS* sps, int32_t border);
+
+/**
+ * @brief set the sample format and the cropping rectangle of the picture from the sps it is decoded with
+ * @see 7.4.2.1.1 Sequence parameter set data semantics, frame_crop_left_offset
+ *
+ * @param picture the picture
+ * @param sps the active sps
+ */
+void init_picture_format(Picture* picture, const SPS* sps);
+
+/**
+ * @brief add a slot to the pool for the pictures exceeding its size, the slots are kept until the geometry of the pictures changes
+ *
+ * @param pool the picture pool
+ * @return int 0 on success, negative value on error. ERR_PICTURE_POOL_EXHAUSTED if the pool has H264_MAX_POOL_PICTURES slots
+ */
+int grow_picture_pool(PicturePool* pool);
+
+/**
+ * @brief reset the picture for decoding a new picture, the allocated frame and fields are kept
  *
  * @param picture the picture
  */
@@ -88,6 +461,101 @@ void reset_picture(Picture* picture);
  */
 void free_picture(Picture* picture);
 
+/**
+ * @brief initialize the picture pool for the SPS. if the geometry changes, the idle pictures are freed and the pictures in use are freed when they are released.
+ * the idle pictures of the slots beyond the size for the SPS are freed
+ *
+ * @param pool the picture pool
+ * @param sps the active sps
+ * @return int 0 on success, negative value on error
+ */
+int init_picture_pool(PicturePool* pool, SPS* sps);
+
+/**
+ * @brief set the border around the luma planes of the pictures of the pool, the larger borders allow the motion compensation kernels which read further outside of
+ * the picture. it takes effect when the pool is initialized next, the pictures are reallocated then
+ *
+ * @param pool the picture pool
+ * @param border the border in luma samples, H264_MC_LUMA_BORDER to H264_PLANE_MAX_BORDER
+ * @return int 0 on success, negative value on error
+ */
+int set_picture_pool_border(PicturePool* pool, int32_t border);
+
+/**
+ * @brief get an idle picture from the picture pool, or allocate one in a free slot. the picture is reset for decoding a new picture and its reference count is 1
+ *
+ * @param pool the picture pool
+ * @param sps the active sps, the pictures are allocated for it
+ * @param out_picture output parameter. the picture
+ * @return int 0 on success, negative value on error. ERR_PICTURE_POOL_EXHAUSTED if all the pictures are in use, ERR_MEMORY_BUDGET_EXCEEDED if a free slot has no
+ * picture and the budget of the pool has no room for one
+ */
+int get_picture_from_pool(PicturePool* pool, SPS* sps, Picture** out_picture);
+
+/**
+ * @brief check whether get_picture_from_pool() would get a picture: the pool has an idle picture, or a free slot and room in its budget for a picture as large as
+ * the largest one of the geometry. the idle pictures of the shared pool are freed if their room is needed
+ *
+ * @param pool the picture pool
+ * @param can_grow 1 if the pool may grow by a slot, see grow_picture_pool()
+ * @return int 1 if the pool has room for a picture, 0 otherwise
+ */
+int has_picture_pool_room(PicturePool* pool, int can_grow);
+
+/**
+ * @brief add a holder of the picture
+ *
+ * @param picture the picture
+ */
+static inline void retain_picture(Picture* picture) { picture->ref_count++; }
+
+/**
+ * @brief take the picture out of the pool without releasing it, its charges are returned to the budget of the pool. the caller frees it by free_picture()
+ *
+ * @param pool the picture pool
+ * @param picture the picture of the pool
+ */
+void detach_pool_picture(PicturePool* pool, Picture* picture);
+
+/**
+ * @brief remove a holder of the picture, the picture becomes idle in the pool when the last holder releases it, or it is freed if it is allocated for a previous
+ * geometry of the pool
+ *
+ * @param pool the picture pool which the picture is from
+ * @param picture the picture
+ */
+void release_picture(PicturePool* pool, Picture* picture);
+
+/**
+ * @brief free the pictures of the picture pool
+ *
+ * @param pool the picture pool
+ */
+void free_picture_pool(PicturePool* pool);
+
+/**
+ * @brief initialize the shared picture pool
+ *
+ * @param shared the shared picture pool
+ * @return int 0 on success, negative value on error
+ */
+int init_shared_picture_pool(SharedPicturePool* shared);
+
+/**
+ * @brief free the idle pictures of the shared picture pool, so that their room in the budget is taken by the pictures in use
+ *
+ * @param shared the shared picture pool, 0 if the pool is not shared
+ * @return int32_t the number of the freed pictures
+ */
+int32_t trim_shared_picture_pool(SharedPicturePool* shared);
+
+/**
+ * @brief free the idle pictures of the shared picture pool, the picture pools sharing it MUST be freed before
+ *
+ * @param shared the shared picture pool
+ */
+void free_shared_picture_pool(SharedPicturePool* shared);
+
 /**
  * @brief Detection of the first VCL NAL unit of a primary coded picture
  * @see 7.4.1.2.4 Detection of the first VCL NAL unit of a primary coded picture
@@ -99,16 +567,26 @@ void free_picture(Picture* picture);
 int detect_first_VCL_NAL_of_primary_coded_picture(SliceHeader* current, SliceHeader* prev);
 
 /**
- * @brief decode a slice
+ * @brief set the coded type and the decoded fields of the picture by the slice which starts or continues it, before its slice data is decoded
+ *
+ * @param picture the picture
+ * @param header the slice header
+ */
+void set_picture_structure(Picture* picture, const SliceHeader* header);
+
+/**
+ * @brief decode a slice into the frame or field of the picture, the structure of the picture is set by set_picture_structure() before
  * @see 7.3.4 Slice data syntax
  * @see 7.4.4 Slice data semantics
  *
  * @param picture the picture
+ * @param scratch the macroblock scratch of the decoding thread
  * @param rbsp_reader the RBSP reader
  * @param header the slice header
+ * @param ref_lists the reference picture lists of the slice, see construct_ref_pic_lists()
  * @return int 0 on success, negative value on error
  */
-int decode_slice(Picture* picture, RBSPReader* rbsp_reader, SliceHeader* header);
+int decode_slice(Picture* picture, MacroBlockScratch* scratch, RBSPReader* rbsp_reader, SliceHeader* header, const RefPicLists* ref_lists);
 
 /**
  * @brief decode the slice data
@@ -116,10 +594,11 @@ int decode_slice(Picture* picture, RBSPReader* rbsp_reader, SliceHeader* header)
  * @see 7.4.4 Slice data semantics
  * 
  * @param ff pointer to FrameOrField
+ * @param scratch the macroblock scratch of the decoding thread, it is attached to the frame or field only while the slice is decoded
  * @param rbsp_reader the RBSP reader
  * @param header the slice header
  * @return int 0 on success, negative value on error
  */
-int slice_data(FrameOrField* ff, RBSPReader* rbsp_reader, SliceHeader* header);
+int slice_data(FrameOrField* ff, MacroBlockScratch* scratch, RBSPReader* rbsp_reader, SliceHeader* header);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef _H_H264_POC_H_
+#define _H_H264_POC_H_
+
+#include <stdint.h>
+
+#include "h264_defs.h"
+#include "h264_error.h"
+#include "h264_picture.h"
+
+/**
+ * Picture order count
+ *
+ * @see 8.2.1 Decoding process for picture order count
+ *
+ * The picture order counts are derived when the decoding of a frame or field starts, decode_picture_order_count() sets TopFieldOrderCnt and BottomFieldOrderCnt
+ * of the picture to the poc of its fields and PicOrderCnt( ) of the frame to the poc of the frame. After the frame or field is marked,
+ * update_picture_order_count() applies memory_management_control_operation equal to 5 to the counts and keeps the values the next picture is derived from.
+ */
+
+/**
+ * @brief the state of the picture order count derivation carried from a picture to the next ones
+ */
+typedef struct {
+    /* prevPicOrderCntMsb and prevPicOrderCntLsb of the previous reference picture, pic_order_cnt_type 0 */
+    int32_t prevPicOrderCntMsb;
+    int32_t prevPicOrderCntLsb;
+    /* FrameNumOffset and frame_num of the previous picture, pic_order_cnt_type 1 and 2 */
+    int32_t prevFrameNumOffset;
+    int32_t prevFrameNum;
+
+    /* PicOrderCntMsb and FrameNumOffset of the frame or field being decoded */
+    int32_t PicOrderCntMsb;
+    int32_t FrameNumOffset;
+} PicOrderCntState;
+
+/**
+ * @brief Decoding process for picture order count of the frame or field starting with the slice header
+ * @see 8.2.1.1 Decoding process for picture order count type 0
+ * @see 8.2.1.2 Decoding process for picture order count type 1
+ * @see 8.2.1.3 Decoding process for picture order count type 2
+ *
+ * @param state the picture order count state
+ * @param sps the active sps
+ * @param header the header of the first slice of the frame or field
+ * @param picture the picture the frame or field is decoded into, the first field is decoded already for the second field
+ * @return int 0 on success, negative value on error
+ */
+int decode_picture_order_count(PicOrderCntState* state, SPS* sps, SliceHeader* header, Picture* picture);
+
+/**
+ * @brief update the state after the frame or field is decoded and marked. for memory_management_control_operation equal to 5, the counts of the picture are
+ * reduced by tempPicOrderCnt, the
+ * picture starts the picture order counts of the following pictures as an IDR picture
+ * @see 8.2.1 Decoding process for picture order count
+ *
+ * @param state the picture order count state
+ * @param sps the active sps
+ * @param header a slice header of the decoded frame or field
+ * @param picture the picture
+ */
+void update_picture_order_count(PicOrderCntState* state, SPS* sps, SliceHeader* header, Picture* picture);
+
+#endif
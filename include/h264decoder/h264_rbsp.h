@@ -43,6 +43,24 @@ int extract_nalu_rbsp(const uint8_t* nalu, size_t nalu_len, uint8_t* rbsp);
  */
 int extract_nalu_rbsp_simple(const uint8_t* nalu, size_t nalu_len, uint8_t* rbsp);
 
+/**
+ * @brief exchange two RBSP buffers with their capacities. a thread job takes the buffer of its slice this way and hands back the one of its previous slice, so
+ * the buffers are not allocated per slice
+ *
+ * @param buffer in/out parameter. the first buffer
+ * @param capacity in/out parameter. the capacity of the first buffer
+ * @param other_buffer in/out parameter. the second buffer
+ * @param other_capacity in/out parameter. the capacity of the second buffer
+ */
+static inline void swap_rbsp_buffers(uint8_t** buffer, size_t* capacity, uint8_t** other_buffer, size_t* other_capacity) {
+    uint8_t* swapped_buffer = *buffer;
+    size_t swapped_capacity = *capacity;
+    *buffer = *other_buffer;
+    *capacity = *other_capacity;
+    *other_buffer = swapped_buffer;
+    *other_capacity = swapped_capacity;
+}
+
 /**
  * @brief The RBSP bits reader from a specified buffer
  * @see ITU-T H.264 9 Parsing process and 7.2 Specification of syntax functions, categories, and descriptors
@@ -180,4 +198,13 @@ int32_t read_me(RBSPReader* reader, int32_t ChromaArrayType, H264_MB_PART_PRED_M
  */
 uint8_t peek_u1(RBSPReader* reader);
 
+/**
+ * @brief Peek n bits value without moving the reader position. The bits beyond the end of the reader are read as 0
+ *
+ * @param reader the RBSPReader
+ * @param n n bits, it must be in the range of 1 to 25
+ * @return uint32_t
+ */
+uint32_t peek_u(RBSPReader* reader, int n);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,265 @@
+#ifndef _H_H264_RECONSTRUCT_H_
+#define _H_H264_RECONSTRUCT_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "h264_deblock.h"
+#include "h264_deblock_thread.h"
+#include "h264_error.h"
+#include "h264_inter_pred.h"
+#include "h264_intra_pred.h"
+#include "h264_picture.h"
+#include "h264_transform.h"
+
+/**
+ * Two-stage decoding: entropy decoding and wavefront reconstruction
+ *
+ * @see 8.5 Transform coefficient decoding process and picture construction process prior to deblocking filter process
+ *
+ * The entropy stage is slice_data(): it parses the macroblocks and derives their types, prediction modes, reference indices and motion vectors into the
+ * per-macroblock arrays of the frame or field, and the scaled coefficients of every macroblock into MacroBlockScratch. When the frame or field is reconstructed, the
+ * entropy stage packs the coefficients of the macroblock into a compact residual record before the scratch is reused by the next macroblock, see
+ * pack_macroblock_residual(): only the blocks with non-zero coefficients are kept, and the blocks with the DC coefficient only keep one coefficient. The records are
+ * appended to one buffer per frame or field which the slice threads share, and each packed macroblock is published to the reconstruction stage.
+ *
+ * The reconstruction stage predicts every macroblock by the intra prediction or the motion compensation, adds the residual of its record, and hands the rows to
+ * the deblocking filter. The macroblock ( x, y ) reads the reconstructed samples of the macroblocks ( x - 1, y ), ( x - 1, y - 1 ), ( x, y - 1 ) and
+ * ( x + 1, y - 1 ) only, so the rows are reconstructed as a wavefront: each worker takes the next macroblock row and reconstructs the macroblock x once it is packed
+ * and the row above is reconstructed up to x + 1, so row y + 1 trails row y by two macroblocks. The workers start with the first slice of the frame or field and
+ * follow the entropy stage while the later macroblocks are parsed, the entropy stage wakes them at the end of every macroblock row and every slice. Once all the
+ * slices are parsed, the macroblocks which no slice packed count as packed and are left as they are. The samples are identical for any number of workers. With
+ * one thread, the decoding thread reconstructs the frame or field once its slices are parsed.
+ *
+ * The frame threads of h264_frame_thread.h reconstruct the frames and fields of their pictures themselves instead, see reconstruct_parsed_rows(): the worker which
+ * parses the slices reconstructs every macroblock row once its last macroblock is parsed, deblocks the row above it and pads the rows whose samples are final, which
+ * the later pictures then refer to. The motion compensation of a macroblock waits until its reference pictures are final down to the rows which it reads.
+ *
+ * The reconstruction is instantiated per sample size from h264_reconstruct_template.h, the kernels are selected for the bit depth of the active SPS. It covers the
+ * frames and field pictures of ChromaArrayType 0 to 3 with equal luma and chroma bit depths of 8 to 14, the Cb and Cr samples of ChromaArrayType equal to 3 are
+ * predicted and transformed like the luma samples. The frames and fields of the other formats, the MBAFF frames and the macroblocks of the SP and SI slices are left
+ * unreconstructed, their macroblock state is decoded as without the reconstruction.
+ */
+
+/* the maximum number of the worker threads */
+#define H264_MAX_RECONSTRUCT_THREADS 16
+
+/* the thread count of set_reconstruction_threads() which only parses the slices into the macroblock state, the samples of the pictures are not reconstructed */
+#define H264_RECONSTRUCT_PARSE_ONLY 0
+
+/* the number of the slices of a chunk of ResidualStore::slice_chunks */
+#define H264_RECONSTRUCT_SLICE_CHUNK 64
+
+/**
+ * @brief the residual record of a macroblock. the packed coefficients of the blocks in nz order are at offset in ResidualStore::coeffs: 16 coefficients for a 4x4
+ * block and 64 for an 8x8 block with a non-zero AC coefficient, 1 coefficient for a block with the DC coefficient only. the record of a I_PCM macroblock has no blocks
+ * and its 256 luma and 2 * MbWidthC * MbHeightC chroma samples are at offset
+ */
+typedef struct {
+    uint32_t offset;
+    /* the masks of TransformCoeffs */
+    uint16_t luma_nz;
+    uint16_t luma_ac;
+    uint16_t chroma_nz[2];
+    uint16_t chroma_ac[2];
+} MbResidual;
+
+/**
+ * @brief the state of a slice which the reconstruction reads, copied when the slice is started
+ */
+typedef struct {
+    RefPicLists ref_lists;
+    /* the weights of the weighted sample prediction, the implicit weights are derived from ref_lists */
+    PredWeights weights;
+    /* 1 for the SP and SI slices, whose macroblocks are not reconstructed */
+    int32_t is_switching_slice;
+} ReconstructSlice;
+
+/**
+ * @brief the residual records of a frame or field and the per-slice state the reconstruction reads, shared by the views of the slice threads
+ */
+typedef struct ResidualStore {
+    /* the records indexed by the macroblock address */
+    MbResidual* records;
+    /* 1 once the macroblock is packed, published by the entropy stage to the workers */
+    int32_t* mb_ready;
+    /* the packed coefficients and PCM samples, int16_t entries for the bit depth 8 and int32_t entries for the greater bit depths. the buffer is reserved for the
+     * largest macroblocks and only the used part is touched */
+    void* coeffs;
+    /* the used entries of coeffs, advanced atomically by the slice threads */
+    uint32_t used;
+    uint32_t capacity;
+    int32_t mb_count;
+    /* the entries reserved per macroblock, 256 + 2 * MbWidthC * MbHeightC, and the size of an entry in bytes */
+    int32_t mb_entries;
+    int32_t entry_size;
+    /* the chroma format of the records, the Cb and Cr blocks of ChromaArrayType equal to 3 have the size of the luma blocks */
+    int32_t ChromaArrayType;
+
+    /* the slices indexed by the slice number of mb_slice_ids, in chunks of H264_RECONSTRUCT_SLICE_CHUNK slices which are allocated once and never move, so the
+     * workers read the started slices while the later slices are started */
+    ReconstructSlice** slice_chunks;
+    int32_t slice_chunk_count;
+
+    /* the reconstructor whose workers reconstruct the frame or field while it is parsed, 0 if it is reconstructed once it is parsed */
+    struct Reconstructor* reconstructor;
+    /* the kernels of the frame thread which decodes the frame or field and reconstructs its rows as they are parsed, see reconstruct_parsed_rows() */
+    struct Reconstructor* row_reconstructor;
+    const DeblockFuncs* row_deblock_funcs;
+    /* the leading macroblock rows which are reconstructed, deblocked and padded by reconstruct_parsed_rows() */
+    int32_t reconstructed_rows;
+    int32_t deblocked_rows;
+    int32_t padded_rows;
+    /* the macroblocks of the frame or field being decoded are packed, it is cleared when the frame or field is reset */
+    int32_t active;
+} ResidualStore;
+
+/**
+ * @brief a frame or field being reconstructed by the workers
+ */
+typedef struct {
+    FrameOrField* ff;
+    int32_t PicWidthInMbs;
+    int32_t PicHeightInMbs;
+    /* the parity of the field being reconstructed, -1 for a frame, 0 for a top field and 1 for a bottom field */
+    int32_t field_parity;
+    /* the chroma format of the active SPS, MbWidthC and MbHeightC are 0 for ChromaArrayType equal to 0 */
+    int32_t ChromaArrayType;
+    int32_t MbWidthC;
+    int32_t MbHeightC;
+
+    /* the deblocking worker which the reconstructed rows are reported to, 0 if the picture is deblocked once it is reconstructed */
+    DeblockThread* deblock_thread;
+} ReconstructJob;
+
+/**
+ * @brief the kernels and the wavefront workers
+ */
+typedef struct Reconstructor {
+    /* the kernels of BitDepth */
+    TransformFuncs transform_funcs;
+    IntraPredFuncs intra_funcs;
+    InterPredFuncs inter_funcs;
+    int32_t BitDepth;
+
+    /* the workers, none if the decoding thread reconstructs the pictures */
+    pthread_t threads[H264_MAX_RECONSTRUCT_THREADS];
+    int32_t thread_count;
+
+    pthread_mutex_t mutex;
+    /* signaled when a job is started or the workers quit */
+    pthread_cond_t work;
+    /* signaled when a row progresses or the entropy stage packs macroblocks while a worker waits for them, or the last row is reconstructed */
+    pthread_cond_t progress;
+
+    /* the job, its ff is 0 if no frame or field is reconstructed */
+    ReconstructJob job;
+    /* all the slices of the job are parsed, the macroblocks which are not packed are not waited for */
+    int32_t parsed;
+    /* the number of the reconstructed macroblocks of each row of the job, written atomically by the worker of the row */
+    int32_t* row_progress;
+    int32_t row_progress_capacity;
+    /* the next row which no worker reconstructs, and the number of the reconstructed rows */
+    int32_t next_row;
+    int32_t done_rows;
+    /* the number of the workers waiting for the progress of a row or for a macroblock to be packed */
+    int32_t waiters;
+
+    /* the first error of the job */
+    int err_code;
+    int32_t quit;
+} Reconstructor;
+
+/**
+ * @brief create the reconstruction kernels and the workers
+ *
+ * @param thread_count 1 to reconstruct the pictures on the decoding thread, up to H264_MAX_RECONSTRUCT_THREADS workers
+ * @return Reconstructor* the reconstructor, return 0 if the creation fails
+ */
+Reconstructor* create_reconstructor(int32_t thread_count);
+
+/**
+ * @brief stop and join the workers
+ * the parameter reconstructor pointer becomes an invalid pointer after this free_reconstructor() was invoked
+ *
+ * @param reconstructor the reconstructor
+ */
+void free_reconstructor(Reconstructor* reconstructor);
+
+/**
+ * @brief let the entropy stage pack the macroblocks of the frame or field into residual records, the store is allocated once for the size and the format of the
+ * frame or field. it is invoked before the slices of the frame or field are decoded, the frames and fields which are not reconstructed are not packed. the
+ * kernels are selected for the bit depth of the sps, and with worker threads the wavefront of the frame or field is started, see reconstruct_frame_or_field()
+ *
+ * @param reconstructor the reconstructor, the job of the previous frame or field is finished
+ * @param ff the frame or field, its macroblock arrays are allocated
+ * @param header the slice header
+ * @return int 0 on success, negative value on error
+ */
+int start_residual_records(Reconstructor* reconstructor, FrameOrField* ff, const SliceHeader* header);
+
+/**
+ * @brief keep the state of the slice which the reconstruction reads: its reference picture lists, the weights of the weighted sample prediction, whose implicit
+ * weights are derived from the reference picture lists, and its slice type. it is invoked before the macroblocks of the slice are decoded
+ *
+ * @param ff the frame or field, its macroblocks are packed
+ * @param slice_num the slice number
+ * @param header the slice header
+ * @param ref_lists the reference picture lists of the slice
+ * @return int 0 on success, negative value on error
+ */
+int store_reconstruct_slice(FrameOrField* ff, int32_t slice_num, const SliceHeader* header, const RefPicLists* ref_lists);
+
+/**
+ * @brief pack the scaled coefficients or the PCM samples of the decoded macroblock into its residual record and publish it to the workers, which are woken at the
+ * end of a macroblock row
+ *
+ * @param ff the frame or field, or the view of a slice thread
+ * @param CurrMbAddr the decoded macroblock
+ */
+void pack_macroblock_residual(FrameOrField* ff, int32_t CurrMbAddr);
+
+/**
+ * @brief wake the workers waiting for the macroblocks of the slice which is parsed
+ *
+ * @param ff the frame or field, or the view of a slice thread
+ */
+void report_packed_slice(FrameOrField* ff);
+
+/**
+ * @brief free the residual store
+ *
+ * @param store the store
+ */
+void free_residual_store(ResidualStore* store);
+
+/**
+ * @brief reconstruct, deblock and pad the frame or field whose slices are decoded. the workers finish the wavefront started by start_residual_records(), and the
+ * deblocking worker takes the rows reconstructed so far. it does nothing if the macroblocks of the frame or field are not packed
+ *
+ * @param reconstructor the reconstructor
+ * @param ff the frame or field
+ * @param sps the active sps
+ * @param deblock_funcs the deblocking filter kernels
+ * @param deblock_thread the deblocking worker, 0 to deblock the frame or field on the calling thread
+ * @return int 0 on success, negative value on error
+ */
+int reconstruct_frame_or_field(Reconstructor* reconstructor, FrameOrField* ff, const SPS* sps, const DeblockFuncs* deblock_funcs, DeblockThread* deblock_thread);
+
+/**
+ * @brief reconstruct the parsed macroblock rows of the frame or field on the thread which parses its slices in raster order. a row is deblocked once the row below
+ * it is reconstructed, whose intra prediction reads its unfiltered bottom line, and the rows above the last deblocked row are final and padded. on a frame thread
+ * the motion compensation of a macroblock waits for the rows of its reference pictures, see wait_for_macroblock_references(). the macroblocks which no slice
+ * packed are left as they are
+ *
+ * @param reconstructor the kernels, they are selected for the bit depth of the sps
+ * @param deblock_funcs the deblocking filter kernels of the bit depths of the sps
+ * @param ff the frame or field, its macroblocks are packed
+ * @param sps the active sps
+ * @param rows the number of the leading macroblock rows which are parsed, the frame or field is finished if it covers all the rows
+ * @param final_rows output parameter. the number of the leading macroblock rows which are reconstructed, deblocked and padded completely
+ * @return int 0 on success, the first error of the macroblocks or of the deblocking otherwise
+ */
+int reconstruct_parsed_rows(Reconstructor* reconstructor, const DeblockFuncs* deblock_funcs, FrameOrField* ff, const SPS* sps, int32_t rows, int32_t* final_rows);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef _H_H264_REF_LIST_H_
+#define _H_H264_REF_LIST_H_
+
+#include <stdint.h>
+
+#include "h264_defs.h"
+#include "h264_dpb.h"
+#include "h264_error.h"
+#include "h264_picture.h"
+
+/**
+ * Reference picture list construction
+ *
+ * @see 8.2.4 Decoding process for reference picture lists construction
+ *
+ * The initial reference picture lists depend only on the frame or field being decoded and on the marking of the DPB, which does not change until the picture is
+ * decoded, so the slices of a frame or field share them. The first P or SP slice and the first B slice of a frame or field derive the picture numbers of the
+ * frame stores and build the initial lists into the RefPicListCache, the later slices copy them. Every slice then truncates the copy to its
+ * num_ref_idx_lX_active_minus1 + 1 entries and applies its own ref_pic_list_modification( ).
+ *
+ * The picture numbers FrameNumWrap, PicNum and LongTermPicNum are kept in the frame stores, see Picture::PicNum, they are valid for the frame or field which the
+ * cache is built for.
+ */
+
+/**
+ * @brief the initial reference picture lists of the frame or field being decoded
+ */
+typedef struct {
+    /* the lists are built for the frame or field: decode_index of the picture and 3 for a frame, 1 for a top field and 2 for a bottom field. structure is 0 until
+     * the first build */
+    uint32_t decode_index;
+    int32_t structure;
+
+    /* CurrPicNum and MaxPicNum of the frame or field, see 7.4.3 */
+    int32_t CurrPicNum;
+    int32_t MaxPicNum;
+
+    /* the initial RefPicList0 of the P and SP slices, built by the first of them */
+    uint8_t has_p_list;
+    RefPicEntry p_list[H264_MAX_REFS];
+    int32_t p_count;
+
+    /* the initial RefPicList0 and RefPicList1 of the B slices, built by the first of them */
+    uint8_t has_b_lists;
+    RefPicEntry b_lists[2][H264_MAX_REFS];
+    int32_t b_count[2];
+
+    /* the number of the initial lists built, the slices reusing the lists of the cache do not count */
+    uint32_t init_count;
+} RefPicListCache;
+
+/**
+ * @brief drop the initial lists of the cache, the next slice builds them again
+ *
+ * @param cache the cache
+ */
+void reset_ref_pic_list_cache(RefPicListCache* cache);
+
+/**
+ * @brief construct RefPicList0 and RefPicList1 of the slice, the initial lists are built once per frame or field and kept in the cache
+ * @see 8.2.4.1 Decoding process for picture numbers
+ * @see 8.2.4.2 Initialisation process for reference picture lists
+ * @see 8.2.4.3 Modification process for reference picture lists
+ *
+ * @param cache the initial lists of the frame or field
+ * @param dpb the DPB holding the reference pictures, the frame store of the first field of the picture is stored already when the second field is decoded
+ * @param picture the current picture
+ * @param header the slice header
+ * @param lists output parameter. the reference picture lists of the slice with num_ref_idx_lX_active_minus1 + 1 entries, the entries without a reference
+ * picture are 0
+ * @return int 0 on success, negative value on error
+ */
+int construct_ref_pic_lists(RefPicListCache* cache, DecodedPictureBuffer* dpb, const Picture* picture, const SliceHeader* header, RefPicLists* lists);
+
+#endif
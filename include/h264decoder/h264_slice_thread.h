@@ -0,0 +1,123 @@
+#ifndef _H_H264_SLICE_THREAD_H_
+#define _H_H264_SLICE_THREAD_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "h264_error.h"
+#include "h264_nalu.h"
+#include "h264_picture.h"
+#include "h264_rbsp.h"
+
+/**
+ * Slice-parallel decoding
+ *
+ * The slices of a picture are decoded at once by a pool of worker threads. The slices are entropy-independent: the CABAC and CAVLC contexts, the intra prediction
+ * modes and the motion vector predictors of a macroblock are derived only from the neighbouring macroblocks of the same slice, see 6.4.9. So every slice task
+ * has its own bit reader, its own decoding engine and its own macroblock scratch, and the decoding thread assigns the slice numbers and the reference picture
+ * lists in the decoding order before the slice data is queued.
+ *
+ * A slice still reads the slice numbers and the field decoding flags of the neighbouring macroblocks of the other slices to find that they are not available,
+ * those per-macroblock words are accessed atomically, see load_shared_i32() and bitset_set(). The deblocking filter and the later pictures cross the slice
+ * boundaries, so a picture is finished, deblocked and referred to only once all its slices are decoded, see wait_for_slice_tasks(). The decoded pictures are
+ * identical to the single-threaded decoding.
+ *
+ * The pictures decoded by the frame threads are decoded slice by slice by their frame thread, see h264_frame_thread.h.
+ */
+
+/* the maximum number of the worker threads */
+#define H264_MAX_SLICE_THREADS 16
+
+/**
+ * @brief the slice data of a slice, decoded by a worker. the task owns the copy of the slice header with its slice group maps and the RBSP of the slice
+ */
+typedef struct SliceTask {
+    /**
+     * the frame or field as the slice decodes it: it shares the per-macroblock arrays of the frame or field, and has QPY,PRED and the slice number of the slice
+     */
+    FrameOrField view;
+    /* the macroblock scratch of the worker decoding the task, see slice_data() */
+    MacroBlockScratch scratch;
+
+    SliceHeader header;
+    /* the RBSP of the slice NALU, the reader is positioned at the slice data. the buffer is kept when the task is decoded and handed back for the next slice */
+    uint8_t* rbsp_buffer;
+    size_t rbsp_capacity;
+    RBSPReader reader;
+
+    struct SliceTask* next;
+} SliceTask;
+
+/**
+ * @brief the worker threads and the queued slices
+ */
+typedef struct SliceThreads {
+    pthread_t threads[H264_MAX_SLICE_THREADS];
+    int32_t thread_count;
+
+    pthread_mutex_t mutex;
+    /* signaled when a slice is queued or the workers quit */
+    pthread_cond_t work;
+    /* signaled when the last queued slice is decoded */
+    pthread_cond_t done;
+
+    /* the slices waiting for a worker in the decoding order */
+    SliceTask* first_task;
+    SliceTask* last_task;
+    /* the number of the queued slices which are not decoded yet */
+    int32_t pending_tasks;
+    /* the decoded tasks, they are reused by the next slices so that the macroblock scratch and the RBSP buffer are not allocated per slice */
+    SliceTask* free_tasks;
+
+    /* the first error of the decoded slices which is not taken by take_slice_thread_error() yet */
+    int err_code;
+    int32_t quit;
+} SliceThreads;
+
+/**
+ * @brief create the worker threads
+ *
+ * @param thread_count the number of the worker threads, 1 to H264_MAX_SLICE_THREADS
+ * @return SliceThreads* the threads, return 0 if the creation fails
+ */
+SliceThreads* create_slice_threads(int32_t thread_count);
+
+/**
+ * @brief decode the queued slices, stop and join the worker threads
+ * the parameter threads pointer becomes an invalid pointer after this free_slice_threads() was invoked
+ *
+ * @param threads the threads
+ */
+void free_slice_threads(SliceThreads* threads);
+
+/**
+ * @brief start the slice in the frame or field of the picture as decode_slice() does, and queue its slice data to the workers
+ *
+ * @param threads the threads
+ * @param picture the picture, its structure is set by set_picture_structure()
+ * @param header the slice header, the task takes over its slice group maps on success
+ * @param rbsp_buffer the RBSP of the slice NALU. on success the task takes it over and hands back the buffer of the previous slice of the task, 0 if it has none
+ * @param rbsp_capacity the capacity of rbsp_buffer, exchanged with it
+ * @param reader the reader positioned at the slice data
+ * @param ref_lists the reference picture lists of the slice
+ * @return int 0 on success, negative value on error
+ */
+int queue_slice_task(SliceThreads* threads, Picture* picture, SliceHeader* header, uint8_t** rbsp_buffer, size_t* rbsp_capacity, const RBSPReader* reader,
+                     const RefPicLists* ref_lists);
+
+/**
+ * @brief wait until all the queued slices are decoded
+ *
+ * @param threads the threads
+ */
+void wait_for_slice_tasks(SliceThreads* threads);
+
+/**
+ * @brief take the first error of the slices decoded by the workers since the previous invocation
+ *
+ * @param threads the threads
+ * @return int 0 if no slice failed, the error of the slice otherwise
+ */
+int take_slice_thread_error(SliceThreads* threads);
+
+#endif
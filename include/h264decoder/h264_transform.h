@@ -0,0 +1,187 @@
+#ifndef _H_H264_TRANSFORM_H_
+#define _H_H264_TRANSFORM_H_
+
+#include <stdint.h>
+
+#include "h264_defs.h"
+#include "h264_error.h"
+#include "h264_picture.h"
+
+/**
+ * Transform coefficient decoding
+ *
+ * @see 8.5 Transform coefficient decoding process and picture construction process prior to deblocking filter process
+ *
+ * scaling_for_residual() turns the levels parsed by residual() into the scaled coefficients of TransformCoeffs: the inverse scanning, the Intra16x16 and chroma DC
+ * transforms and the scaling are done in one pass, the blocks without coefficients are only cleared. The inverse transform kernels then add the residual to the
+ * predicted samples with the row stride and clip the result to the bit depth.
+ *
+ * The kernels are selected by init_transform_funcs() according to the bit depth and the instruction set extensions of the CPU, every entry of the function table
+ * has a scalar reference implementation. The multi-block kernels transform a row of horizontally adjacent blocks whose coefficients are consecutive, the entries
+ * are 0 if the CPU has no faster version than the single block kernel. The scalar kernels of the bit depths 8 to 14 are instantiated from one template, the SIMD
+ * kernels are used for the bit depth 8 only. For the bit depths greater than 8, the samples are uint16_t and the coefficients are int32_t of TransformCoeffs16.
+ */
+
+/**
+ * @brief the inverse transform kernel, the residual of the coefficients d[ i ][ j ] is added to the predicted samples
+ *
+ * @param dst the upper-left sample of the block, uint16_t samples for the bit depths greater than 8
+ * @param stride the row stride of dst in samples
+ * @param coeffs the scaled coefficients of the blocks, raster order, int32_t coefficients for the bit depths greater than 8
+ */
+typedef void (*transform_add_func)(uint8_t* dst, int32_t stride, const int16_t* coeffs);
+
+/**
+ * @brief the inverse transform function table
+ */
+typedef struct {
+    /* one 4x4 block */
+    transform_add_func idct4x4_add;
+    /* one 4x4 block with d[ 0 ][ 0 ] as the only non-zero coefficient */
+    transform_add_func idct4x4_dc_add;
+    /* two 4x4 blocks, 8x4 samples */
+    transform_add_func idct4x4_add2;
+    /* four 4x4 blocks, 16x4 samples */
+    transform_add_func idct4x4_add4;
+    /* one 8x8 block */
+    transform_add_func idct8x8_add;
+    /* one 8x8 block with d[ 0 ][ 0 ] as the only non-zero coefficient */
+    transform_add_func idct8x8_dc_add;
+    /* two 8x8 blocks, 16x8 samples */
+    transform_add_func idct8x8_add2;
+} TransformFuncs;
+
+/**
+ * @brief the 4x4 and 8x8 inverse scanning tables, the raster index i * N + j of the coefficient c[ i ][ j ] indexed by the scan index
+ * @see Table 8-13 – Specification of mapping of idx to cij for zig-zag and field scan
+ * @see Table 8-14 – Specification of mapping of idx to cij for 8x8 luma zig-zag and field scan
+ */
+extern const uint8_t g_zigzag_scan_4x4[16];
+extern const uint8_t g_field_scan_4x4[16];
+extern const uint8_t g_zigzag_scan_8x8[64];
+extern const uint8_t g_field_scan_8x8[64];
+
+/**
+ * @brief initialize the inverse transform function table
+ *
+ * @param funcs the function table
+ * @param BitDepth the bit depth of the samples, 8 to 14
+ * @param cpu_flags the H264_CPU_XXX flags, the scalar kernels are used if it is 0
+ */
+void init_transform_funcs(TransformFuncs* funcs, int32_t BitDepth, int32_t cpu_flags);
+
+/**
+ * @brief replace the SIMD kernels of the function table for the instruction set extensions
+ *
+ * @param funcs the function table initialized with the scalar kernels
+ * @param cpu_flags the H264_CPU_XXX flags
+ */
+void init_transform_funcs_x86(TransformFuncs* funcs, int32_t cpu_flags);
+
+/**
+ * @brief Derivation process for scaling functions, LevelScale4x4 and LevelScale8x8 of the scaling lists of the PPS
+ * @see 8.5.9 Derivation process for scaling functions
+ *
+ * @param pps pointer to the PPS, ScalingList4x4 and ScalingList8x8 are the lists used for the picture
+ */
+void derivation_for_level_scale(PPS* pps);
+
+/**
+ * @brief Derivation process for chroma quantisation parameters, QP'C of Cb or Cr
+ * @see 8.5.8 Derivation process for chroma quantisation parameters
+ *
+ * @param QPY the luma quantisation parameter of the macroblock
+ * @param qPOffset chroma_qp_index_offset for Cb, second_chroma_qp_index_offset for Cr
+ * @param QpBdOffsetC the chroma quantisation parameter range offset, QPC is returned for 0
+ * @return int32_t QP'C
+ */
+int32_t derivation_for_chroma_qp(int32_t QPY, int32_t qPOffset, int32_t QpBdOffsetC);
+
+/**
+ * @brief inverse scanning and scaling of the transform coefficient levels of the macroblock into MacroBlockScratch::coeffs, or MacroBlockScratch::coeffs16 if the
+ * luma or chroma bit depth is greater than 8
+ * @see 8.5.6 Inverse scanning process for 4x4 transform coefficients and scaling lists
+ * @see 8.5.7 Inverse scanning process for 8x8 transform coefficients and scaling lists
+ * @see 8.5.10 Scaling and transformation process for DC transform coefficients for Intra_16x16 macroblock type
+ * @see 8.5.11 Specification of transform decoding process for chroma samples
+ * @see 8.5.12.1 Scaling process for residual 4x4 blocks
+ * @see 8.5.13.1 Scaling process for residual 8x8 blocks
+ *
+ * @param picture pointer to the FrameOrField
+ * @param header pointer to the slice header
+ * @param CurrMbAddr the current macroblock address
+ * @return int 0 on success, negative value on error
+ */
+int scaling_for_residual(FrameOrField* picture, SliceHeader* header, int32_t CurrMbAddr);
+
+/**
+ * @brief add the luma residual of the macroblock to the predicted samples, the rows of blocks are transformed by the multi-block kernels
+ * @see 8.5.12 Scaling and transformation process for residual 4x4 blocks
+ * @see 8.5.13 Scaling and transformation process for residual 8x8 blocks
+ *
+ * @param funcs the function table
+ * @param coeffs the scaled coefficients
+ * @param iComp the colour component, 0 for luma, 1 and 2 for the Cb and Cr blocks of ChromaArrayType equal to 3 which have the layout of the luma blocks
+ * @param transform_size_8x8_flag 1 if the luma blocks are 8x8 blocks
+ * @param dst the upper-left sample of the macroblock in the plane of the colour component
+ * @param stride the row stride of dst in samples
+ */
+void transform_add_luma(const TransformFuncs* funcs, const TransformCoeffs* coeffs, int32_t iComp, int32_t transform_size_8x8_flag, uint8_t* dst, int32_t stride);
+
+/**
+ * @brief add the residual of one luma 4x4 block to the predicted samples, used by Intra_4x4 where each block is predicted from the previous ones
+ *
+ * @param funcs the function table
+ * @param coeffs the scaled coefficients
+ * @param iComp the colour component, see transform_add_luma()
+ * @param blkIdx the 4x4 block index in raster block order
+ * @param dst the upper-left sample of the block
+ * @param stride the row stride of dst in samples
+ */
+void transform_add_luma4x4(const TransformFuncs* funcs, const TransformCoeffs* coeffs, int32_t iComp, int32_t blkIdx, uint8_t* dst, int32_t stride);
+
+/**
+ * @brief add the residual of one luma 8x8 block to the predicted samples, used by Intra_8x8
+ *
+ * @param funcs the function table
+ * @param coeffs the scaled coefficients
+ * @param iComp the colour component, see transform_add_luma()
+ * @param luma8x8BlkIdx the 8x8 block index
+ * @param dst the upper-left sample of the block
+ * @param stride the row stride of dst in samples
+ */
+void transform_add_luma8x8(const TransformFuncs* funcs, const TransformCoeffs* coeffs, int32_t iComp, int32_t luma8x8BlkIdx, uint8_t* dst, int32_t stride);
+
+/**
+ * @brief add the residual of the Cb or Cr samples of the macroblock to the predicted samples
+ *
+ * @param funcs the function table
+ * @param coeffs the scaled coefficients
+ * @param iCbCr 0 for Cb, 1 for Cr
+ * @param MbHeightC the height of the chroma macroblock, 8 or 16
+ * @param dst the upper-left chroma sample of the macroblock
+ * @param stride the row stride of dst in samples
+ */
+void transform_add_chroma(const TransformFuncs* funcs, const TransformCoeffs* coeffs, int32_t iCbCr, int32_t MbHeightC, uint8_t* dst, int32_t stride);
+
+/**
+ * @brief transform_add_luma() of the bit depths greater than 8
+ */
+void transform_add_luma16(const TransformFuncs* funcs, const TransformCoeffs16* coeffs, int32_t iComp, int32_t transform_size_8x8_flag, uint16_t* dst, int32_t stride);
+
+/**
+ * @brief transform_add_luma4x4() of the bit depths greater than 8
+ */
+void transform_add_luma4x416(const TransformFuncs* funcs, const TransformCoeffs16* coeffs, int32_t iComp, int32_t blkIdx, uint16_t* dst, int32_t stride);
+
+/**
+ * @brief transform_add_luma8x8() of the bit depths greater than 8
+ */
+void transform_add_luma8x816(const TransformFuncs* funcs, const TransformCoeffs16* coeffs, int32_t iComp, int32_t luma8x8BlkIdx, uint16_t* dst, int32_t stride);
+
+/**
+ * @brief transform_add_chroma() of the bit depths greater than 8
+ */
+void transform_add_chroma16(const TransformFuncs* funcs, const TransformCoeffs16* coeffs, int32_t iCbCr, int32_t MbHeightC, uint16_t* dst, int32_t stride);
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * the sample and coefficient types of one bit depth, included before every instantiation of a template with BIT_DEPTH defined. it has no include guard, every
+ * inclusion redefines the macros for the current BIT_DEPTH.
+ *
+ * the samples of the bit depth 8 are uint8_t and the transform coefficients are int16_t, the samples of the bit depths 9 to 14 are uint16_t and the coefficients are
+ * int32_t, see 8.5.12.1 for the range of the scaled coefficients. the function tables are shared by all the bit depths: the sample pointers of the kernels are the
+ * addresses of the samples of their bit depth and the strides are in samples.
+ *
+ * FUNCC( name ) is the kernel name of the bit depth, name_10_c for BIT_DEPTH 10. FUNC16( name ) is the name of the functions which only depend on the sample size,
+ * name for the bit depth 8 and name16 for the bit depths greater than 8.
+ */
+
+#ifndef BIT_DEPTH
+#error "BIT_DEPTH must be defined before the template is included"
+#endif
+
+#undef pixel
+#undef dctcoef
+#undef PIXEL_MAX
+#undef PIXEL_HALF
+#undef CLIP1
+#undef FUNCC
+#undef FUNC16
+#undef IntraPredSamplesT
+#undef TransformCoeffsT
+
+#define H264_TEMPLATE_CAT3_(a, b, c) a##_##b##_##c
+#define H264_TEMPLATE_CAT3(a, b, c) H264_TEMPLATE_CAT3_(a, b, c)
+
+#if BIT_DEPTH == 8
+#define pixel uint8_t
+#define dctcoef int16_t
+#define FUNC16(name) name
+#define IntraPredSamplesT IntraPredSamples
+#define TransformCoeffsT TransformCoeffs
+#else
+#define pixel uint16_t
+#define dctcoef int32_t
+#define FUNC16(name) name##16
+#define IntraPredSamplesT IntraPredSamples16
+#define TransformCoeffsT TransformCoeffs16
+#endif
+
+#define FUNCC(name) H264_TEMPLATE_CAT3(name, BIT_DEPTH, c)
+
+/* ( 1 << BitDepth ) - 1 and 1 << ( BitDepth - 1 ) */
+#define PIXEL_MAX ((1 << BIT_DEPTH) - 1)
+#define PIXEL_HALF (1 << (BIT_DEPTH - 1))
+
+/* Clip1Y( x ) and Clip1C( x ) */
+#define CLIP1(val) clip3(0, PIXEL_MAX, (val))
+
+/* the functions of FUNC16( name ) are instantiated once per sample size, by the bit depths 8 and 9 */
+#undef SAMPLE_FUNCS_INSTANCE
+#define SAMPLE_FUNCS_INSTANCE (BIT_DEPTH == 8 || BIT_DEPTH == 9)
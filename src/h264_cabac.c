@@ -1,5 +1,9 @@
 #include "h264decoder/h264_cabac.h"
 
+#include <pthread.h>
+
+#include "h264decoder/h264_locations_neighbours.h"
+#include "h264decoder/h264_macroblock.h"
 #include "h264decoder/h264_math.h"
 
 /* @see Table 9-12 – Values of variables m and n for ctxIdx from 0 to 10 */
@@ -409,9 +413,46 @@ static const int32_t transIdxMPS[64] = {1,  2,  3,  4,  5,  6,  7,  8,  9,  10,
  * coeff_abs_level_minus1 */
 static const int32_t g_coded_block_flag_ctxIdxBlockCatOffset[14] = {0, 4, 8, 12, 16, 0, 0, 4, 8, 4, 0, 4, 8, 8};
 
-static CABAC g_cabac_instance;
+/**
+ * @brief ctxIdxOffset + ctxIdxBlockCatOffset of significant_coeff_flag, indexed by frame coded (0) or field coded (1) blocks and ctxBlockCat
+ * @see Table 9-34 – Syntax elements and associated types of binarization, maxBinIdxCtx, and ctxIdxOffset
+ * @see Table 9-40 – Assignment of ctxIdxBlockCatOffset to ctxBlockCat for syntax elements coded_block_flag, significant_coeff_flag, last_significant_coeff_flag, and
+ * coeff_abs_level_minus1
+ */
+static const int32_t g_significant_coeff_flag_ctxIdxBase[2][14] = {
+    {105 + 0, 105 + 15, 105 + 29, 105 + 44, 105 + 47, 402, 484 + 0, 484 + 15, 484 + 29, 660, 528 + 0, 528 + 15, 528 + 29, 718},
+    {277 + 0, 277 + 15, 277 + 29, 277 + 44, 277 + 47, 436, 776 + 0, 776 + 15, 776 + 29, 675, 820 + 0, 820 + 15, 820 + 29, 733},
+};
+
+/* ctxIdxOffset + ctxIdxBlockCatOffset of last_significant_coeff_flag, indexed like g_significant_coeff_flag_ctxIdxBase */
+static const int32_t g_last_significant_coeff_flag_ctxIdxBase[2][14] = {
+    {166 + 0, 166 + 15, 166 + 29, 166 + 44, 166 + 47, 417, 572 + 0, 572 + 15, 572 + 29, 690, 616 + 0, 616 + 15, 616 + 29, 748},
+    {338 + 0, 338 + 15, 338 + 29, 338 + 44, 338 + 47, 451, 864 + 0, 864 + 15, 864 + 29, 699, 908 + 0, 908 + 15, 908 + 29, 757},
+};
+
+/* ctxIdxOffset + ctxIdxBlockCatOffset of coeff_abs_level_minus1, indexed by ctxBlockCat */
+static const int32_t g_coeff_abs_level_minus1_ctxIdxBase[14] = {227 + 0, 227 + 10, 227 + 20, 227 + 30, 227 + 39, 426, 952 + 0,
+                                                                 952 + 10, 952 + 20, 708, 982 + 0, 982 + 10, 982 + 20, 766};
+
+/* @see Table 9-43 – Mapping of scanning position to ctxIdxInc for ctxBlockCat = = 5, 9, or 13. significant_coeff_flag of frame coded (0) and field coded (1) blocks */
+static const uint8_t g_significant_coeff_flag_ctxIdxInc_8x8[2][63] = {
+    {0,  1,  2,  3,  4,  5,  5,  4,  4,  3,  3,  4,  4,  4,  5,  5,  4,  4,  4,  4,  3,  3,  6,  7,  7,  7,  8,  9,  10, 9,  8,  7,
+     7,  6,  11, 12, 13, 11, 6,  7,  8,  9,  14, 10, 9,  8,  6,  11, 12, 13, 11, 6,  9,  14, 10, 9,  11, 12, 13, 11, 14, 10, 12},
+    {0, 1,  1,  2,  2,  3,  3,  4,  5,  6,  7,  7,  7,  8,  4,  5,  6,  9,  10, 10, 8,  11, 12, 11, 9,  9,  10, 10, 8,  11, 12, 11,
+     9, 9,  10, 10, 8,  11, 12, 11, 9,  9,  10, 10, 8,  13, 13, 9,  9,  10, 10, 8,  13, 13, 9,  9,  10, 10, 14, 14, 14, 14, 14},
+};
 
-CABAC* get_singleton_cabac() { return &g_cabac_instance; }
+/* @see Table 9-43 – Mapping of scanning position to ctxIdxInc for ctxBlockCat = = 5, 9, or 13. last_significant_coeff_flag */
+static const uint8_t g_last_significant_coeff_flag_ctxIdxInc_8x8[63] = {0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+                                                                        3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7, 8, 8, 8};
+
+/* the number of the tables of the initial context states: the I and SI slices, then cabac_init_idc 0 to 2 of the other slices */
+#define CABAC_INIT_TYPES 4
+
+/* pStateIdx << 1 | valMPS of every context after the initialization, for every init type and SliceQPY. it is derived once and only read afterwards, so all the
+ * contexts and the threads of the process share it */
+static uint8_t g_cabac_init_states[CABAC_INIT_TYPES][52][H264_MAX_CONTEXT_INDEX];
+static pthread_once_t g_cabac_init_once = PTHREAD_ONCE_INIT;
 
 int cabac_retrieve_m_n(int32_t ctxIdx, uint32_t slice_type, uint32_t cabac_init_idc, int8_t* m_out, int8_t* n_out) {
     if (ctxIdx < 0 || ctxIdx >= H264_MAX_CONTEXT_INDEX) {
@@ -586,34 +627,54 @@ int cabac_retrieve_m_n(int32_t ctxIdx, uint32_t slice_type, uint32_t cabac_init_
     return ERR_OK;
 }
 
+/**
+ * @brief derive the initial context states of all the init types and the values of SliceQPY
+ * @see 9.3.1.1 Initialization process for context variables
+ */
+static void derive_cabac_init_states(void) {
+    int8_t m = 0;
+    int8_t n = 0;
+
+    for (int32_t init_type = 0; init_type < CABAC_INIT_TYPES; ++init_type) {
+        /* the I and SI slices only use the contexts whose m and n do not depend on cabac_init_idc */
+        uint32_t slice_type = init_type == 0 ? SLICE_TYPE_I : SLICE_TYPE_P;
+        uint32_t cabac_init_idc = init_type == 0 ? 0 : (uint32_t)init_type - 1;
+
+        for (int32_t ctxIdx = 0; ctxIdx < H264_MAX_CONTEXT_INDEX; ++ctxIdx) {
+            if (cabac_retrieve_m_n(ctxIdx, slice_type, cabac_init_idc, &m, &n) != ERR_OK) {
+                /* when ctxIdx is 276, the function cabac_retrieve_m_n return value is not ERR_OK, the context is not used by DecodeDecision */
+                continue;
+            }
+
+            for (int32_t SliceQPY = 0; SliceQPY < 52; ++SliceQPY) {
+                int32_t preCtxState = clip3(1, 126, ((m * SliceQPY) >> 4) + n);
+                if (preCtxState <= 63) {
+                    g_cabac_init_states[init_type][SliceQPY][ctxIdx] = (uint8_t)((63 - preCtxState) << 1);
+                } else {
+                    g_cabac_init_states[init_type][SliceQPY][ctxIdx] = (uint8_t)(((preCtxState - 64) << 1) | 1);
+                }
+            }
+        }
+    }
+}
+
 int cabac_init_context_variables(CABAC* cabac, uint32_t slice_type, uint32_t cabac_init_idc, int32_t SliceQPY) {
     /* @see 9.3.1.1 Initialization process for context variables*/
 
-    int err_code = ERR_OK;
+    int32_t is_intra_slice = slice_type % 5 == SLICE_TYPE_I || slice_type % 5 == SLICE_TYPE_SI;
+    if (!is_intra_slice && cabac_init_idc > 2) {
+        return ERR_INVALID_PARAM;
+    }
 
-    int8_t m = 0;
-    int8_t n = 0;
+    pthread_once(&g_cabac_init_once, derive_cabac_init_states);
 
+    const uint8_t* states = g_cabac_init_states[is_intra_slice ? 0 : cabac_init_idc + 1][clip3(0, 51, SliceQPY)];
     for (int32_t ctxIdx = 0; ctxIdx < H264_MAX_CONTEXT_INDEX; ++ctxIdx) {
-        err_code = cabac_retrieve_m_n(ctxIdx, slice_type, cabac_init_idc, &m, &n);
-        if (err_code == ERR_OK) {
-            int32_t tmp = ((m * clip3(0, 51, SliceQPY)) >> 4) + n;
-            int32_t preCtxState = clip3(1, 126, tmp);
-
-            if (preCtxState <= 63) {
-                cabac->pStateIdx[ctxIdx] = 63 - preCtxState;
-                cabac->valMPS[ctxIdx] = 0;
-            } else {
-                cabac->pStateIdx[ctxIdx] = preCtxState - 64;
-                cabac->valMPS[ctxIdx] = 1;
-            }
-        } else {
-            /* do nothing */
-            /* when ctxIdx is 276, the function cabac_retrieve_m_n return value is not ERR_OK */
-        }
+        cabac->pStateIdx[ctxIdx] = states[ctxIdx] >> 1;
+        cabac->valMPS[ctxIdx] = states[ctxIdx] & 1;
     }
 
-    return err_code;
+    return ERR_OK;
 }
 
 /* 9.3.1.2 Initialization process for the arithmetic decoding engine */
@@ -1147,8 +1208,9 @@ int cabac_coded_block_pattern(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrFiel
 int cabac_coded_block_flag(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t ctxBlockCat, int32_t xBlkIdx,
                            int32_t iCbCr, int32_t* out_syntax_element) {
     int err_code = ERR_OK;
-    int32_t maxBinIdxCtx = 0;
     int32_t ctxIdxOffset = 0;
+    int32_t ctxIdxInc = 0;
+    int32_t binVal = 0;
 
     /* Table 9-34 – Syntax elements and associated types of binarization, maxBinIdxCtx, and ctxIdxOffset */
     /* Table 9-40 – Assignment of ctxIdxBlockCatOffset to ctxBlockCat for syntax elements coded_block_flag, significant_coeff_flag, last_significant_coeff_flag, and
@@ -1174,7 +1236,9 @@ int cabac_coded_block_flag(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField*
     /* maxBinIdxCtx: 0 */
     /* ctxIdxOffset: 1012 */
 
-    if (ctxBlockCat < 5) {
+    if (ctxBlockCat < 0) {
+        return ERR_CTX_BLOCK_CATEGORY;
+    } else if (ctxBlockCat < 5) {
         ctxIdxOffset = 85;
     } else if (ctxBlockCat > 5 && ctxBlockCat < 9) {
         ctxIdxOffset = 460;
@@ -1188,9 +1252,140 @@ int cabac_coded_block_flag(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField*
 
     int32_t ctxIdxBlockCatOffset = g_coded_block_flag_ctxIdxBlockCatOffset[ctxBlockCat];
 
+    /* 9.3.3.1.1.9 Derivation process of ctxIdxInc for the syntax element coded_block_flag */
+    err_code = derivation_for_ctxIdxInc_coded_block_flag(picture, slice_header, CurrMbAddr, ctxBlockCat, xBlkIdx, iCbCr, &ctxIdxInc);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    err_code = DecodeBin(rbsp_reader, cabac, 0, ctxIdxOffset + ctxIdxBlockCatOffset + ctxIdxInc, &binVal);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    *out_syntax_element = binVal;
+
     return ERR_OK;
 }
 
+/**
+ * @brief the ctxIdxInc of significant_coeff_flag and last_significant_coeff_flag
+ * @see 9.3.3.1.3 Assignment process of ctxIdxInc for syntax elements significant_coeff_flag, last_significant_coeff_flag, and coeff_abs_level_minus1
+ *
+ * @param ctxBlockCat the context block category
+ * @param is_field 1 for the field coded blocks, 0 for the frame coded blocks
+ * @param is_last 1 for last_significant_coeff_flag, 0 for significant_coeff_flag
+ * @param levelListIdx the index of the list of the transform coefficient levels
+ * @param NumC8x8 the number of the 8x8 chroma blocks, used by the chroma DC blocks only
+ * @return int32_t the ctxIdxInc
+ */
+static int32_t significant_coeff_ctxIdxInc(int32_t ctxBlockCat, int32_t is_field, int32_t is_last, int32_t levelListIdx, int32_t NumC8x8) {
+    if (ctxBlockCat == 3) {
+        return codec_min(levelListIdx / NumC8x8, 2);
+    } else if (ctxBlockCat == 5 || ctxBlockCat == 9 || ctxBlockCat == 13) {
+        /* Table 9-43, levelListIdx is in the range of 0 to 62 */
+        return is_last ? g_last_significant_coeff_flag_ctxIdxInc_8x8[levelListIdx] : g_significant_coeff_flag_ctxIdxInc_8x8[is_field][levelListIdx];
+    }
+
+    return levelListIdx;
+}
+
+int cabac_significant_coeff_flag(RBSPReader* rbsp_reader, CABAC* cabac, int32_t ctxBlockCat, int32_t is_field, int32_t levelListIdx, int32_t NumC8x8,
+                                 int32_t* out_syntax_element) {
+    /* Type of binarization: FL, cMax=1, maxBinIdxCtx: 0, ctxIdxOffset: Table 9-34 by ctxBlockCat and the frame or field coded blocks */
+    if (ctxBlockCat < 0 || ctxBlockCat > 13) {
+        return ERR_CTX_BLOCK_CATEGORY;
+    }
+
+    int32_t ctxIdx = g_significant_coeff_flag_ctxIdxBase[is_field][ctxBlockCat] + significant_coeff_ctxIdxInc(ctxBlockCat, is_field, 0, levelListIdx, NumC8x8);
+    return DecodeBin(rbsp_reader, cabac, 0, ctxIdx, out_syntax_element);
+}
+
+int cabac_last_significant_coeff_flag(RBSPReader* rbsp_reader, CABAC* cabac, int32_t ctxBlockCat, int32_t is_field, int32_t levelListIdx, int32_t NumC8x8,
+                                      int32_t* out_syntax_element) {
+    /* Type of binarization: FL, cMax=1, maxBinIdxCtx: 0, ctxIdxOffset: Table 9-34 by ctxBlockCat and the frame or field coded blocks */
+    if (ctxBlockCat < 0 || ctxBlockCat > 13) {
+        return ERR_CTX_BLOCK_CATEGORY;
+    }
+
+    int32_t ctxIdx = g_last_significant_coeff_flag_ctxIdxBase[is_field][ctxBlockCat] + significant_coeff_ctxIdxInc(ctxBlockCat, is_field, 1, levelListIdx, NumC8x8);
+    return DecodeBin(rbsp_reader, cabac, 0, ctxIdx, out_syntax_element);
+}
+
+int cabac_coeff_abs_level_minus1(RBSPReader* rbsp_reader, CABAC* cabac, int32_t ctxBlockCat, int32_t numDecodAbsLevelEq1, int32_t numDecodAbsLevelGt1,
+                                 int32_t* out_syntax_element) {
+    int err_code = ERR_OK;
+
+    int32_t binVal = 0;
+    int32_t prefix = 0;
+
+    /* Type of binarization: UEG0 with signedValFlag = 0 and uCoff = 14, maxBinIdxCtx: prefix 1, ctxIdxOffset: prefix by ctxBlockCat in Table 9-34 */
+    if (ctxBlockCat < 0 || ctxBlockCat > 13) {
+        return ERR_CTX_BLOCK_CATEGORY;
+    }
+
+    int32_t ctxIdxBase = g_coeff_abs_level_minus1_ctxIdxBase[ctxBlockCat];
+    int32_t uCoff = 14;
+
+    /* 9.3.3.1.3: binIdx 0 uses ( ( numDecodAbsLevelGt1 != 0 ) ? 0 : Min( 4, 1 + numDecodAbsLevelEq1 ) ), the other bins of the prefix use
+     * 5 + Min( 4 − ( ( ctxBlockCat = = 3 ) ? 1 : 0 ), numDecodAbsLevelGt1 ) */
+    int32_t ctxIdxInc = numDecodAbsLevelGt1 != 0 ? 0 : codec_min(4, 1 + numDecodAbsLevelEq1);
+    err_code = DecodeBin(rbsp_reader, cabac, 0, ctxIdxBase + ctxIdxInc, &binVal);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    ctxIdxInc = 5 + codec_min(4 - (ctxBlockCat == 3), numDecodAbsLevelGt1);
+    while (binVal) {
+        ++prefix;
+        if (prefix >= uCoff) {
+            break;
+        }
+
+        err_code = DecodeBin(rbsp_reader, cabac, 0, ctxIdxBase + ctxIdxInc, &binVal);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    int32_t value = prefix;
+
+    /* the Exp-Golomb suffix of order 0 in bypass mode */
+    if (prefix >= uCoff) {
+        int32_t k = 0;
+        for (;;) {
+            err_code = DecodeBypass(rbsp_reader, cabac, &binVal);
+            if (err_code < 0) {
+                return err_code;
+            }
+            if (!binVal) {
+                break;
+            }
+
+            value += 1 << k;
+            if (++k > 24) {
+                return ERR_DECODE_BYPASS;
+            }
+        }
+
+        while (k--) {
+            err_code = DecodeBypass(rbsp_reader, cabac, &binVal);
+            if (err_code < 0) {
+                return err_code;
+            }
+            value += binVal << k;
+        }
+    }
+
+    *out_syntax_element = value;
+    return ERR_OK;
+}
+
+int cabac_coeff_sign_flag(RBSPReader* rbsp_reader, CABAC* cabac, int32_t* out_syntax_element) {
+    /* Type of binarization: FL, cMax=1, decoded in bypass mode */
+    return DecodeBypass(rbsp_reader, cabac, out_syntax_element);
+}
+
 int DecodeBin(RBSPReader* rbsp_reader, CABAC* cabac, int32_t bypassFlag, int32_t ctxIdx, int32_t* bin_val) {
     if (bypassFlag) {
         return DecodeBypass(rbsp_reader, cabac, bin_val);
@@ -1231,6 +1426,8 @@ int DecodeTerminate(RBSPReader* rbsp_reader, CABAC* cabac, int32_t* bin_val) {
 
         RenormD(rbsp_reader, cabac);
     }
+
+    return ERR_OK;
 }
 
 int RenormD(RBSPReader* rbsp_reader, CABAC* cabac) {
@@ -1296,19 +1493,19 @@ int derivation_for_ctxIdxInc_mb_skip_flag(FrameOrField* picture, SliceHeader* sl
     int32_t is_chroma = 0;
 
     /* 6.4.11.1 Derivation process for neighbouring macroblocks */
-    neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, picture->mb_slice_ids,
-                             picture->mb_frame_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
+    neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !bitset_get(picture->mb_field_flags, CurrMbAddr), sps->PicWidthInMbs, picture->mb_slice_ids,
+                             picture->mb_field_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
 
     int32_t condTermFlagA = 0;
     int32_t condTermFlagB = 0;
 
-    if (mbAddrA < 0 || picture->mb_list[mbAddrA].mb_skip_flag == 1) {
+    if (mbAddrA < 0 || picture->mb_skip_flags[mbAddrA] == 1) {
         condTermFlagA = 0;
     } else {
         condTermFlagA = 1;
     }
 
-    if (mbAddrB < 0 || picture->mb_list[mbAddrB].mb_skip_flag == 1) {
+    if (mbAddrB < 0 || picture->mb_skip_flags[mbAddrB] == 1) {
         condTermFlagB = 0;
     } else {
         condTermFlagB = 1;
@@ -1334,27 +1531,21 @@ int derivation_for_ctxIdxInc_mb_field_decoding_flag(FrameOrField* picture, Slice
     int32_t mbAddrB = 0;
 
     /* 6.4.10 Derivation process for neighbouring macroblock addresses and their availability in MBAFF frames */
-    err_code = neighbouring_mb_A_address_availability_in_MBAFF_frame(CurrMbAddr, sps->PicWidthInMbs, picture->mb_slice_ids, &mbAddrA);
-    if (err_code < 0) {
-        return err_code;
-    }
+    neighbouring_mb_A_address_availability_in_MBAFF_frame(CurrMbAddr, sps->PicWidthInMbs, picture->mb_slice_ids, &mbAddrA);
 
     /* 6.4.10 Derivation process for neighbouring macroblock addresses and their availability in MBAFF frames */
-    err_code = neighbouring_mb_B_address_availability_in_MBAFF_frame(CurrMbAddr, sps->PicWidthInMbs, picture->mb_slice_ids, &mbAddrB);
-    if (err_code < 0) {
-        return err_code;
-    }
+    neighbouring_mb_B_address_availability_in_MBAFF_frame(CurrMbAddr, sps->PicWidthInMbs, picture->mb_slice_ids, &mbAddrB);
 
     int32_t condTermFlagA = 0;
     int32_t condTermFlagB = 0;
 
-    if (mbAddrA < 0 || picture->mb_list[mbAddrA].mb_field_decoding_flag == 0) {
+    if (mbAddrA < 0 || bitset_get(picture->mb_field_flags, mbAddrA) == 0) {
         condTermFlagA = 0;
     } else {
         condTermFlagA = 1;
     }
 
-    if (mbAddrB < 0 || picture->mb_list[mbAddrB].mb_field_decoding_flag == 0) {
+    if (mbAddrB < 0 || bitset_get(picture->mb_field_flags, mbAddrB) == 0) {
         condTermFlagB = 0;
     } else {
         condTermFlagB = 1;
@@ -1377,21 +1568,21 @@ int derivation_for_ctxIdxInc_mb_type(FrameOrField* picture, SliceHeader* slice_h
     int32_t is_chroma = 0;
 
     /* 6.4.11.1 Derivation process for neighbouring macroblocks */
-    neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, picture->mb_slice_ids,
-                             picture->mb_frame_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
+    neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !bitset_get(picture->mb_field_flags, CurrMbAddr), sps->PicWidthInMbs, picture->mb_slice_ids,
+                             picture->mb_field_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
 
     int32_t condTermFlagA = 0;
     int32_t condTermFlagB = 0;
 
-    if (mbAddrA < 0 || (ctxIdxOffset == 0 && picture->mb_list[mbAddrA].mb_type_name == SI_SI) || (ctxIdxOffset == 3 && picture->mb_list[mbAddrA].mb_type_name == I_NxN) ||
-        (ctxIdxOffset == 27 && (picture->mb_list[mbAddrA].mb_type_name == B_Skip || picture->mb_list[mbAddrA].mb_type_name == B_Direct_16x16))) {
+    if (mbAddrA < 0 || (ctxIdxOffset == 0 && picture->mb_type_names[mbAddrA] == SI_SI) || (ctxIdxOffset == 3 && picture->mb_type_names[mbAddrA] == I_NxN) ||
+        (ctxIdxOffset == 27 && (picture->mb_type_names[mbAddrA] == B_Skip || picture->mb_type_names[mbAddrA] == B_Direct_16x16))) {
         condTermFlagA = 0;
     } else {
         condTermFlagA = 1;
     }
 
-    if (mbAddrB < 0 || (ctxIdxOffset == 0 && picture->mb_list[mbAddrB].mb_type_name == SI_SI) || (ctxIdxOffset == 3 && picture->mb_list[mbAddrB].mb_type_name == I_NxN) ||
-        (ctxIdxOffset == 27 && (picture->mb_list[mbAddrB].mb_type_name == B_Skip || picture->mb_list[mbAddrB].mb_type_name == B_Direct_16x16))) {
+    if (mbAddrB < 0 || (ctxIdxOffset == 0 && picture->mb_type_names[mbAddrB] == SI_SI) || (ctxIdxOffset == 3 && picture->mb_type_names[mbAddrB] == I_NxN) ||
+        (ctxIdxOffset == 27 && (picture->mb_type_names[mbAddrB] == B_Skip || picture->mb_type_names[mbAddrB] == B_Direct_16x16))) {
         condTermFlagB = 0;
     } else {
         condTermFlagB = 1;
@@ -1417,14 +1608,14 @@ int derivation_for_ctxIdxInc_coded_block_pattern(FrameOrField* picture, SliceHea
         int32_t luma8x8BlkIdxB = 0;
 
         /* 6.4.11.2 Derivation process for neighbouring 8x8 luma block */
-        neighbouring_8x8_luma_block(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, picture->mb_slice_ids,
-                                    picture->mb_frame_flags, binIdx, &mbAddrA, &luma8x8BlkIdxA, &mbAddrB, &luma8x8BlkIdxB);
+        neighbouring_8x8_luma_block(slice_header->MbaffFrameFlag, CurrMbAddr, !bitset_get(picture->mb_field_flags, CurrMbAddr), sps->PicWidthInMbs, picture->mb_slice_ids,
+                                    picture->mb_field_flags, binIdx, &mbAddrA, &luma8x8BlkIdxA, &mbAddrB, &luma8x8BlkIdxB);
 
         int32_t condTermFlagA = 0;
         int32_t condTermFlagB = 0;
 
-        if (mbAddrA < 0 || picture->mb_list[mbAddrA].mb_type_name == I_PCM ||
-            (mbAddrA != CurrMbAddr && (picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip) &&
+        if (mbAddrA < 0 || picture->mb_type_names[mbAddrA] == I_PCM ||
+            (mbAddrA != CurrMbAddr && (picture->mb_type_names[mbAddrA] != P_Skip && picture->mb_type_names[mbAddrA] != B_Skip) &&
              ((picture->mb_list[mbAddrA].CodedBlockPatternLuma >> luma8x8BlkIdxA) & 1) != 0) ||
             (mbAddrA == CurrMbAddr && ((binValues >> luma8x8BlkIdxA) & 0x01) != 0)) {
             condTermFlagA = 0;
@@ -1432,8 +1623,8 @@ int derivation_for_ctxIdxInc_coded_block_pattern(FrameOrField* picture, SliceHea
             condTermFlagA = 1;
         }
 
-        if (mbAddrB < 0 || picture->mb_list[mbAddrB].mb_type_name == I_PCM ||
-            (mbAddrB != CurrMbAddr && (picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip) &&
+        if (mbAddrB < 0 || picture->mb_type_names[mbAddrB] == I_PCM ||
+            (mbAddrB != CurrMbAddr && (picture->mb_type_names[mbAddrB] != P_Skip && picture->mb_type_names[mbAddrB] != B_Skip) &&
              ((picture->mb_list[mbAddrB].CodedBlockPatternLuma >> luma8x8BlkIdxB) & 1) != 0) ||
             (mbAddrB == CurrMbAddr && ((binValues >> luma8x8BlkIdxB) & 0x01) != 0)) {
             condTermFlagB = 0;
@@ -1449,24 +1640,24 @@ int derivation_for_ctxIdxInc_coded_block_pattern(FrameOrField* picture, SliceHea
         int32_t is_chroma = 0;
 
         /* 6.4.11.1 Derivation process for neighbouring macroblocks */
-        neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, picture->mb_slice_ids,
-                                 picture->mb_frame_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
+        neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !bitset_get(picture->mb_field_flags, CurrMbAddr), sps->PicWidthInMbs, picture->mb_slice_ids,
+                                 picture->mb_field_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
 
         int32_t condTermFlagA = 0;
         int32_t condTermFlagB = 0;
 
-        if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name == I_PCM) {
+        if (mbAddrA >= 0 && picture->mb_type_names[mbAddrA] == I_PCM) {
             condTermFlagA = 1;
-        } else if (mbAddrA < 0 || picture->mb_list[mbAddrA].mb_type_name == P_Skip || picture->mb_list[mbAddrA].mb_type_name == B_Skip ||
+        } else if (mbAddrA < 0 || picture->mb_type_names[mbAddrA] == P_Skip || picture->mb_type_names[mbAddrA] == B_Skip ||
                    (binIdx == 0 && picture->mb_list[mbAddrA].CodedBlockPatternChroma == 0) || (binIdx == 1 && picture->mb_list[mbAddrA].CodedBlockPatternChroma != 2)) {
             condTermFlagA = 0;
         } else {
             condTermFlagA = 1;
         }
 
-        if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name == I_PCM) {
+        if (mbAddrB >= 0 && picture->mb_type_names[mbAddrB] == I_PCM) {
             condTermFlagB = 1;
-        } else if (mbAddrB < 0 || picture->mb_list[mbAddrB].mb_type_name == P_Skip || picture->mb_list[mbAddrB].mb_type_name == B_Skip ||
+        } else if (mbAddrB < 0 || picture->mb_type_names[mbAddrB] == P_Skip || picture->mb_type_names[mbAddrB] == B_Skip ||
                    (binIdx == 0 && picture->mb_list[mbAddrB].CodedBlockPatternChroma == 0) || (binIdx == 1 && picture->mb_list[mbAddrB].CodedBlockPatternChroma != 2)) {
             condTermFlagB = 0;
         } else {
@@ -1493,8 +1684,8 @@ int derivation_for_ctxIdxInc_mb_qp_delta(FrameOrField* picture, SliceHeader* sli
         prevMbAddr = -1;
     }
 
-    if (prevMbAddr < 0 || picture->mb_list[prevMbAddr].mb_type_name == P_Skip || picture->mb_list[prevMbAddr].mb_type_name == B_Skip ||
-        picture->mb_list[prevMbAddr].mb_type_name == I_PCM ||
+    if (prevMbAddr < 0 || picture->mb_type_names[prevMbAddr] == P_Skip || picture->mb_type_names[prevMbAddr] == B_Skip ||
+        picture->mb_type_names[prevMbAddr] == I_PCM ||
         (picture->mb_list[prevMbAddr].mb_pred_type != Intra_16x16 && picture->mb_list[prevMbAddr].CodedBlockPatternLuma == 0 &&
          picture->mb_list[prevMbAddr].CodedBlockPatternChroma == 0) ||
         picture->mb_list[prevMbAddr].mb_qp_delta == 0) {
@@ -1519,15 +1710,15 @@ int derivation_for_ctxIdxInc_intra_chroma_pred_mode(FrameOrField* picture, Slice
     int32_t is_chroma = 0;
 
     /* 6.4.11.1 Derivation process for neighbouring macroblocks */
-    neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, picture->mb_slice_ids,
-                             picture->mb_frame_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
+    neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !bitset_get(picture->mb_field_flags, CurrMbAddr), sps->PicWidthInMbs, picture->mb_slice_ids,
+                             picture->mb_field_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
 
     int32_t condTermFlagA = 0;
     int32_t condTermFlagB = 0;
 
     if (mbAddrA < 0 ||
         (picture->mb_list[mbAddrA].mb_pred_type == Pred_L0 || picture->mb_list[mbAddrA].mb_pred_type == Pred_L1 || picture->mb_list[mbAddrA].mb_pred_type == BiPred) ||
-        picture->mb_list[mbAddrA].mb_type_name == I_PCM || picture->mb_list[mbAddrA].intra_chroma_pred_mode == 0) {
+        picture->mb_type_names[mbAddrA] == I_PCM || picture->mb_list[mbAddrA].intra_chroma_pred_mode == 0) {
         condTermFlagA = 0;
     } else {
         condTermFlagA = 1;
@@ -1535,7 +1726,7 @@ int derivation_for_ctxIdxInc_intra_chroma_pred_mode(FrameOrField* picture, Slice
 
     if (mbAddrB < 0 ||
         (picture->mb_list[mbAddrB].mb_pred_type == Pred_L0 || picture->mb_list[mbAddrB].mb_pred_type == Pred_L1 || picture->mb_list[mbAddrB].mb_pred_type == BiPred) ||
-        picture->mb_list[mbAddrB].mb_type_name == I_PCM || picture->mb_list[mbAddrB].intra_chroma_pred_mode == 0) {
+        picture->mb_type_names[mbAddrB] == I_PCM || picture->mb_list[mbAddrB].intra_chroma_pred_mode == 0) {
         condTermFlagB = 0;
     } else {
         condTermFlagB = 1;
@@ -1546,6 +1737,42 @@ int derivation_for_ctxIdxInc_intra_chroma_pred_mode(FrameOrField* picture, Slice
     return ERR_OK;
 }
 
+/**
+ * @brief the condTermFlagN of the syntax element coded_block_flag
+ * @see 9.3.3.1.1.9 Derivation process of ctxIdxInc for the syntax element coded_block_flag
+ *
+ * @param picture the FrameOrField data
+ * @param slice_header the slice header
+ * @param CurrMbAddr the current macroblock address
+ * @param mbAddrN the neighbouring macroblock address, negative value if it is not available
+ * @param coded_block_flagN the coded_block_flag of the transform block transBlockN, 0 if transBlockN is not available
+ * @return int32_t the condTermFlagN
+ */
+static int32_t coded_block_flag_condTermFlagN(FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t mbAddrN, uint32_t coded_block_flagN) {
+    const MacroBlock* curr_mb = &picture->mb_list[CurrMbAddr];
+
+    if (mbAddrN < 0) {
+        /**
+         * – mbAddrN is not available and the current macroblock is coded in Inter prediction mode, condTermFlagN is set equal to 0
+         * – mbAddrN is not available and the current macroblock is coded in Intra prediction mode, condTermFlagN is set equal to 1
+         */
+        return mb_is_intra(curr_mb);
+    }
+
+    /* the macroblock mbAddrN is available and coded in Inter prediction mode, constrained_intra_pred_flag is equal to 1, the current macroblock is coded in Intra prediction
+     * mode, and slice data partitioning is in use (nal_unit_type is in the range of 2 through 4, inclusive). */
+    if (slice_header->pps->constrained_intra_pred_flag && mb_is_intra(curr_mb) && !mb_is_intra(&picture->mb_list[mbAddrN]) &&
+        slice_header->nalu_header.nal_unit_type >= 2 && slice_header->nalu_header.nal_unit_type <= 4) {
+        return 0;
+    }
+
+    /**
+     * the masks of P_Skip, B_Skip and the macroblocks without coded residual are 0, so the transform block which is not available gives 0. the masks of I_PCM are all
+     * ones, so I_PCM gives 1.
+     */
+    return (int32_t)(coded_block_flagN & 1u);
+}
+
 /* 9.3.3.1.1.9 Derivation process of ctxIdxInc for the syntax element coded_block_flag */
 int derivation_for_ctxIdxInc_coded_block_flag(FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t ctxBlockCat, int32_t xBlkIdx, int32_t iCbCr,
                                               int32_t* out_ctxIdxInc) {
@@ -1562,319 +1789,106 @@ int derivation_for_ctxIdxInc_coded_block_flag(FrameOrField* picture, SliceHeader
      *  – Otherwise (ctxBlockCat is equal to 13), cr8x8BlkIdx.
      *
      * Output of this process is ctxIdxInc( ctxBlockCat ).
+     *
+     * The transform block transBlockN is looked up in the non-zero block masks of the macroblock mbAddrN which are written once by the residual parsing, a transform block
+     * which is not available has the bit 0.
      */
 
-    int err_code = ERR_OK;
-    int32_t mbAddrA = 0;
-    int32_t mbAddrB = 0;
-    int32_t transBlockA = -1;
-    int32_t transBlockB = -1;
-
     SPS* sps = slice_header->sps;
-    PPS* pps = slice_header->pps;
-
-    if (ctxBlockCat == 0 || ctxBlockCat == 6 || ctxBlockCat == 10) { /* If ctxBlockCat is equal to 0, 6, or 10, no additional input. */
+    MacroBlock* mb_list = picture->mb_list;
+
+    int32_t mbAddrA = -1;
+    int32_t mbAddrB = -1;
+    int32_t blkIdxA = 0;
+    int32_t blkIdxB = 0;
+    uint32_t coded_block_flagA = 0;
+    uint32_t coded_block_flagB = 0;
+
+    int32_t currMbFrameFlag = !bitset_get(picture->mb_field_flags, CurrMbAddr);
+
+    if (ctxBlockCat == 0 || ctxBlockCat == 3 || ctxBlockCat == 6 || ctxBlockCat == 10) {
+        /**
+         * – If ctxBlockCat is equal to 0, the luma DC block of macroblock mbAddrN is assigned to transBlockN.
+         * – Otherwise, if ctxBlockCat is equal to 3 the chroma DC block of chroma component iCbCr of macroblock mbAddrN is assigned to transBlockN.
+         * – Otherwise, if ctxBlockCat is equal to 6, the Cb DC block of macroblock mbAddrN is assigned to transBlockN.
+         * – Otherwise (ctxBlockCat is equal to 10), the Cr DC block of macroblock mbAddrN is assigned to transBlockN.
+         */
         int32_t is_chroma = (iCbCr < 0) ? 0 : 1;
-
-        /* 6.4.11.1 Derivation process for neighbouring macroblocks */
-        neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, picture->mb_slice_ids,
-                                 picture->mb_frame_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
-
-        if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_pred_type == Intra_16x16) {
-            /**
-             * – If ctxBlockCat is equal to 0, the luma DC block of macroblock mbAddrN is assigned to transBlockN.
-             * – Otherwise, if ctxBlockCat is equal to 6, the Cb DC block of macroblock mbAddrN is assigned to transBlockN.
-             * – Otherwise (ctxBlockCat is equal to 10), the Cr DC block of macroblock mbAddrN is assigned to transBlockN.
-             */
-
-            /* TODO */
-            transBlockA = 1;
-        } else {
-            transBlockA = -1; /* not available */
+        uint32_t dc_shift = 0;
+        if (ctxBlockCat == 3) {
+            dc_shift = 1 + (uint32_t)iCbCr;
+        } else if (ctxBlockCat == 6) {
+            dc_shift = 1;
+        } else if (ctxBlockCat == 10) {
+            dc_shift = 2;
         }
 
-        if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_pred_type == Intra_16x16) {
-            /**
-             * – If ctxBlockCat is equal to 0, the luma DC block of macroblock mbAddrN is assigned to transBlockN.
-             * – Otherwise, if ctxBlockCat is equal to 6, the Cb DC block of macroblock mbAddrN is assigned to transBlockN.
-             * – Otherwise (ctxBlockCat is equal to 10), the Cr DC block of macroblock mbAddrN is assigned to transBlockN.
-             */
-
-            /* TODO */
-            transBlockB = 1;
-        } else {
-            transBlockB = -1; /* not available */
-        }
-    } else if (ctxBlockCat == 1 || ctxBlockCat == 2) { /* Otherwise, if ctxBlockCat is equal to 1 or 2, luma4x4BlkIdx. */
-
-        int32_t luma4x4BlkIdx = xBlkIdx;
-        int32_t luma4x4BlkIdxA = 0;
-        int32_t luma4x4BlkIdxB = 0;
-        /* 6.4.11.4 Derivation process for neighbouring 4x4 luma blocks */
-        neighbouring_4x4_luma_block(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, picture->mb_slice_ids,
-                                    picture->mb_frame_flags, luma4x4BlkIdx, &mbAddrA, &luma4x4BlkIdxA, &mbAddrB, &luma4x4BlkIdxB);
-
-        if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrA].mb_type_name != I_PCM && ((picture->mb_list[mbAddrA].CodedBlockPatternLuma >> (luma4x4BlkIdxA >> 2)) & 1) != 0 &&
-            picture->mb_list[mbAddrA].transform_size_8x8_flag == 0) {
-            /* TODO */
-            transBlockA = 1;
-        } else if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-                   ((picture->mb_list[mbAddrA].CodedBlockPatternLuma >> (luma4x4BlkIdxA >> 2)) & 1) != 0 && picture->mb_list[mbAddrA].transform_size_8x8_flag == 1) {
-            /* TODO */
-            transBlockA = 1;
-        } else {
-            transBlockA = -1;
-        }
-
-        if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrB].mb_type_name != I_PCM && ((picture->mb_list[mbAddrB].CodedBlockPatternLuma >> (luma4x4BlkIdxA >> 2)) & 1) != 0 &&
-            picture->mb_list[mbAddrB].transform_size_8x8_flag == 0) {
-            /* TODO */
-            transBlockB = 1;
-        } else if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-                   ((picture->mb_list[mbAddrB].CodedBlockPatternLuma >> (luma4x4BlkIdxA >> 2)) & 1) != 0 && picture->mb_list[mbAddrB].transform_size_8x8_flag == 1) {
-            /* TODO */
-            transBlockB = 1;
-        } else {
-            transBlockB = -1;
-        }
-    } else if (ctxBlockCat == 3) { /* Otherwise, if ctxBlockCat is equal to 3, the chroma component index iCbCr. */
-        int32_t is_chroma = (iCbCr < 0) ? 0 : 1;
-
         /* 6.4.11.1 Derivation process for neighbouring macroblocks */
-        neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, picture->mb_slice_ids,
-                                 picture->mb_frame_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
-
-        if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrA].mb_type_name != I_PCM && picture->mb_list[mbAddrA].CodedBlockPatternChroma != 0) {
-            /* TODO */
-            transBlockA = 1;
-        } else {
-            transBlockA = -1;
-        }
+        neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, sps->PicWidthInMbs, picture->mb_slice_ids, picture->mb_field_flags, is_chroma,
+                                 sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
 
-        if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrB].mb_type_name != I_PCM && picture->mb_list[mbAddrB].CodedBlockPatternChroma != 0) {
-            /* TODO */
-            transBlockB = 1;
-        } else {
-            transBlockB = -1;
-        }
-    } else if (ctxBlockCat == 4) { /* Otherwise, if ctxBlockCat is equal to 4, chroma4x4BlkIdx and the chroma component index iCbCr. */
-        int32_t chroma4x4BlkIdx = xBlkIdx;
-        int32_t chroma4x4BlkIdxA = 0;
-        int32_t chroma4x4BlkIdxB = 0;
-
-        /* 6.4.11.5 Derivation process for neighbouring 4x4 chroma blocks */
-        neighbouring_4x4_chroma_block_ChromaArrayType_12(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs,
-                                                         sps->MbWidthC, sps->MbHeightC, picture->mb_slice_ids, picture->mb_frame_flags, chroma4x4BlkIdx, &mbAddrA,
-                                                         &chroma4x4BlkIdxA, &mbAddrB, &chroma4x4BlkIdxB);
-
-        if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrA].mb_type_name != I_PCM && picture->mb_list[mbAddrA].CodedBlockPatternChroma == 2) {
-            /* TODO */
-            transBlockA = 1;
-        } else {
-            transBlockA = -1;
+        if (mbAddrA >= 0) {
+            coded_block_flagA = mb_list[mbAddrA].coded_block_flags_dc >> dc_shift;
         }
-
-        if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrB].mb_type_name != I_PCM && picture->mb_list[mbAddrB].CodedBlockPatternChroma == 2) {
-            /* TODO */
-            transBlockB = 1;
-        } else {
-            transBlockB = -1;
+        if (mbAddrB >= 0) {
+            coded_block_flagB = mb_list[mbAddrB].coded_block_flags_dc >> dc_shift;
         }
-    } else if (ctxBlockCat == 5) { /* Otherwise, if ctxBlockCat is equal to 5, luma8x8BlkIdx. */
-        int32_t luma8x8BlkIdx = xBlkIdx;
-
-        int32_t luma8x8BlkIdxA = 0;
-        int32_t luma8x8BlkIdxB = 0;
-        int32_t is_chroma = 0;
+    } else if (ctxBlockCat == 1 || ctxBlockCat == 2 || ctxBlockCat == 7 || ctxBlockCat == 8 || ctxBlockCat == 11 || ctxBlockCat == 12) {
+        /* the 4x4 block luma4x4BlkIdxN, cb4x4BlkIdxN or cr4x4BlkIdxN, or the 8x8 block containing it when transform_size_8x8_flag is equal to 1 */
 
-        /* 6.4.11.2 Derivation process for neighbouring 8x8 luma block */
-        neighbouring_8x8_luma_block(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, picture->mb_slice_ids,
-                                    picture->mb_frame_flags, luma8x8BlkIdx, &mbAddrA, &luma8x8BlkIdxA, &mbAddrB, &luma8x8BlkIdxB);
-
-        if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrA].mb_type_name != I_PCM && ((picture->mb_list[mbAddrA].CodedBlockPatternLuma >> luma8x8BlkIdx) & 1) != 0 &&
-            picture->mb_list[mbAddrA].transform_size_8x8_flag == 1) {
-            /* TODO */
-            transBlockA = 1;
-        } else {
-            transBlockA = -1;
-        }
+        /* 6.4.11.4 Derivation process for neighbouring 4x4 luma blocks, 6.4.11.6 for Cb and Cr with ChromaArrayType equal to 3 */
+        neighbouring_4x4_luma_block(slice_header->MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, sps->PicWidthInMbs, picture->mb_slice_ids, picture->mb_field_flags, xBlkIdx,
+                                    &mbAddrA, &blkIdxA, &mbAddrB, &blkIdxB);
 
-        if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrB].mb_type_name != I_PCM && ((picture->mb_list[mbAddrB].CodedBlockPatternLuma >> luma8x8BlkIdx) & 1) != 0 &&
-            picture->mb_list[mbAddrB].transform_size_8x8_flag == 1) {
-            /* TODO */
-            transBlockB = 1;
+        if (ctxBlockCat <= 2) {
+            if (mbAddrA >= 0) {
+                coded_block_flagA = mb_list[mbAddrA].coded_block_flags >> blkIdxA;
+            }
+            if (mbAddrB >= 0) {
+                coded_block_flagB = mb_list[mbAddrB].coded_block_flags >> blkIdxB;
+            }
         } else {
-            transBlockB = -1;
+            int32_t shift = (ctxBlockCat <= 8) ? 0 : 16;
+            if (mbAddrA >= 0) {
+                coded_block_flagA = mb_list[mbAddrA].coded_block_flags_444 >> (shift + blkIdxA);
+            }
+            if (mbAddrB >= 0) {
+                coded_block_flagB = mb_list[mbAddrB].coded_block_flags_444 >> (shift + blkIdxB);
+            }
         }
-    } else if (ctxBlockCat == 7 || ctxBlockCat == 8) { /* Otherwise, if ctxBlockCat is equal to 7 or 8, cb4x4BlkIdx. */
-        int32_t cb4x4BlkIdx = xBlkIdx;
-        int32_t cb4x4BlkIdxA = 0;
-        int32_t cb4x4BlkIdxB = 0;
+    } else if (ctxBlockCat == 4) {
+        /* the chroma4x4BlkIdxN of chroma component iCbCr */
 
         /* 6.4.11.5 Derivation process for neighbouring 4x4 chroma blocks */
-        neighbouring_4x4_chroma_block_ChromaArrayType_12(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs,
-                                                         sps->MbWidthC, sps->MbHeightC, picture->mb_slice_ids, picture->mb_frame_flags, cb4x4BlkIdx, &mbAddrA, &cb4x4BlkIdxA,
-                                                         &mbAddrB, &cb4x4BlkIdxB);
-
-        if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrA].mb_type_name != I_PCM && ((picture->mb_list[mbAddrA].CodedBlockPatternLuma >> (cb4x4BlkIdxA >> 2)) & 1) != 0 &&
-            picture->mb_list[mbAddrA].transform_size_8x8_flag == 0) {
-            /* TODO */
-            transBlockA = 1;
-        } else if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-                   ((picture->mb_list[mbAddrA].CodedBlockPatternLuma >> (cb4x4BlkIdxA >> 2)) & 1) != 0 && picture->mb_list[mbAddrA].transform_size_8x8_flag == 1) {
-            /* TODO */
-            transBlockA = 1;
-        } else {
-            transBlockA = -1;
-        }
-
-        if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrB].mb_type_name != I_PCM && ((picture->mb_list[mbAddrB].CodedBlockPatternLuma >> (cb4x4BlkIdxA >> 2)) & 1) != 0 &&
-            picture->mb_list[mbAddrB].transform_size_8x8_flag == 0) {
-            /* TODO */
-            transBlockB = 1;
-        } else if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-                   ((picture->mb_list[mbAddrB].CodedBlockPatternLuma >> (cb4x4BlkIdxA >> 2)) & 1) != 0 && picture->mb_list[mbAddrB].transform_size_8x8_flag == 1) {
-            /* TODO */
-            transBlockB = 1;
-        } else {
-            transBlockB = -1;
-        }
-    } else if (ctxBlockCat == 9) { /* Otherwise, if ctxBlockCat is equal to 9, cb8x8BlkIdx. */
-        int32_t cb8x8BlkIdx = xBlkIdx;
-        int32_t cb8x8BlkIdxA = 0;
-        int32_t cb8x8BlkIdxB = 0;
-
-        /* 6.4.11.3 Derivation process for neighbouring 8x8 chroma blocks for ChromaArrayType equal to 3 */
-        neighbouring_8x8_chroma_block(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, sps->MbWidthC,
-                                      sps->MbHeightC, picture->mb_slice_ids, picture->mb_frame_flags, cb8x8BlkIdx, &mbAddrA, &cb8x8BlkIdxA, &mbAddrB, &cb8x8BlkIdxB);
-
-        if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrA].mb_type_name != I_PCM && ((picture->mb_list[mbAddrA].CodedBlockPatternLuma >> cb8x8BlkIdx) & 1) != 0 &&
-            picture->mb_list[mbAddrA].transform_size_8x8_flag == 1) {
-            /* TODO */
-            transBlockA = 1;
-        } else {
-            transBlockA = -1;
-        }
+        neighbouring_4x4_chroma_block_ChromaArrayType_12(slice_header->MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, sps->PicWidthInMbs, sps->MbWidthC, sps->MbHeightC,
+                                                         picture->mb_slice_ids, picture->mb_field_flags, xBlkIdx, &mbAddrA, &blkIdxA, &mbAddrB, &blkIdxB);
 
-        if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrB].mb_type_name != I_PCM && ((picture->mb_list[mbAddrB].CodedBlockPatternLuma >> cb8x8BlkIdx) & 1) != 0 &&
-            picture->mb_list[mbAddrB].transform_size_8x8_flag == 1) {
-            /* TODO */
-            transBlockB = 1;
-        } else {
-            transBlockB = -1;
+        int32_t shift = iCbCr ? H264_CBF_CR_SHIFT : H264_CBF_CB_SHIFT;
+        if (mbAddrA >= 0) {
+            coded_block_flagA = mb_list[mbAddrA].coded_block_flags >> (shift + blkIdxA);
+        }
+        if (mbAddrB >= 0) {
+            coded_block_flagB = mb_list[mbAddrB].coded_block_flags >> (shift + blkIdxB);
         }
-    } else if (ctxBlockCat == 11 || ctxBlockCat == 12) { /* Otherwise, if ctxBlockCat is equal to 11 or 12, cr4x4BlkIdx. */
+    } else { /* ctxBlockCat is equal to 5, 9 or 13 */
+        /* the 8x8 block luma8x8BlkIdxN, cb8x8BlkIdxN or cr8x8BlkIdxN, it is available only when transform_size_8x8_flag of mbAddrN is equal to 1 */
 
-        int32_t cr4x4BlkIdx = xBlkIdx;
-        int32_t cr4x4BlkIdxA = 0;
-        int32_t cr4x4BlkIdxB = 0;
+        /* 6.4.11.2 Derivation process for neighbouring 8x8 luma block */
+        neighbouring_8x8_luma_block(slice_header->MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, sps->PicWidthInMbs, picture->mb_slice_ids, picture->mb_field_flags, xBlkIdx,
+                                    &mbAddrA, &blkIdxA, &mbAddrB, &blkIdxB);
 
-        /* 6.4.11.5 Derivation process for neighbouring 4x4 chroma blocks */
-        neighbouring_4x4_chroma_block_ChromaArrayType_12(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs,
-                                                         sps->MbWidthC, sps->MbHeightC, picture->mb_slice_ids, picture->mb_frame_flags, cr4x4BlkIdx, &mbAddrA, &cr4x4BlkIdxA,
-                                                         &mbAddrB, &cr4x4BlkIdxB);
-
-        if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrA].mb_type_name != I_PCM && ((picture->mb_list[mbAddrA].CodedBlockPatternLuma >> (cr4x4BlkIdxA >> 2)) & 1) != 0 &&
-            picture->mb_list[mbAddrA].transform_size_8x8_flag == 0) {
-            /*TODO*/
-            transBlockA = 1;
-        } else if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-                   ((picture->mb_list[mbAddrA].CodedBlockPatternLuma >> (cr4x4BlkIdxA >> 2)) & 1) != 0 && picture->mb_list[mbAddrA].transform_size_8x8_flag == 1) {
-            /*TODO*/
-            transBlockA = 1;
-        } else {
-            transBlockA = -1;
-        }
-
-        if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrB].mb_type_name != I_PCM && ((picture->mb_list[mbAddrB].CodedBlockPatternLuma >> (cr4x4BlkIdxA >> 2)) & 1) != 0 &&
-            picture->mb_list[mbAddrB].transform_size_8x8_flag == 0) {
-            /*TODO*/
-            transBlockB = 1;
-        } else if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-                   ((picture->mb_list[mbAddrB].CodedBlockPatternLuma >> (cr4x4BlkIdxA >> 2)) & 1) != 0 && picture->mb_list[mbAddrB].transform_size_8x8_flag == 1) {
-            /*TODO*/
-            transBlockB = 1;
-        } else {
-            transBlockB = -1;
-        }
-    } else { /* Otherwise (ctxBlockCat is equal to 13), cr8x8BlkIdx.*/
-        int32_t cr8x8BlkIdx = xBlkIdx;
-        int32_t cr8x8BlkIdxA = 0;
-        int32_t cr8x8BlkIdxB = 0;
-
-        /* 6.4.11.3 Derivation process for neighbouring 8x8 chroma blocks for ChromaArrayType equal to 3 */
-        neighbouring_8x8_chroma_block(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, sps->MbWidthC,
-                                      sps->MbHeightC, picture->mb_slice_ids, picture->mb_frame_flags, cr8x8BlkIdx, &mbAddrA, &cr8x8BlkIdxA, &mbAddrB, &cr8x8BlkIdxB);
-
-        if (mbAddrA >= 0 && picture->mb_list[mbAddrA].mb_type_name != P_Skip && picture->mb_list[mbAddrA].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrA].mb_type_name != I_PCM && ((picture->mb_list[mbAddrA].CodedBlockPatternLuma >> cr8x8BlkIdx) & 1) != 0 &&
-            picture->mb_list[mbAddrA].transform_size_8x8_flag == 1) {
-            /* TODO */
-            transBlockA = 1;
-        } else {
-            transBlockA = -1;
+        if (mbAddrA >= 0 && (mb_list[mbAddrA].transform_size_8x8_flag || picture->mb_type_names[mbAddrA] == I_PCM)) {
+            coded_block_flagA = (ctxBlockCat == 5) ? mb_list[mbAddrA].coded_block_flags >> (blkIdxA * 4)
+                                                   : mb_list[mbAddrA].coded_block_flags_444 >> ((ctxBlockCat == 9 ? 0 : 16) + blkIdxA * 4);
         }
-
-        if (mbAddrB >= 0 && picture->mb_list[mbAddrB].mb_type_name != P_Skip && picture->mb_list[mbAddrB].mb_type_name != B_Skip &&
-            picture->mb_list[mbAddrB].mb_type_name != I_PCM && ((picture->mb_list[mbAddrB].CodedBlockPatternLuma >> cr8x8BlkIdx) & 1) != 0 &&
-            picture->mb_list[mbAddrB].transform_size_8x8_flag == 1) {
-            /* TODO */
-            transBlockB = 1;
-        } else {
-            transBlockB = -1;
+        if (mbAddrB >= 0 && (mb_list[mbAddrB].transform_size_8x8_flag || picture->mb_type_names[mbAddrB] == I_PCM)) {
+            coded_block_flagB = (ctxBlockCat == 5) ? mb_list[mbAddrB].coded_block_flags >> (blkIdxB * 4)
+                                                   : mb_list[mbAddrB].coded_block_flags_444 >> ((ctxBlockCat == 9 ? 0 : 16) + blkIdxB * 4);
         }
     }
 
-    int32_t condTermFlagA = 0;
-    int32_t condTermFlagB = 0;
-
-    if ((mbAddrA < 0 &&
-         (picture->mb_list[mbAddrA].mb_pred_type == Pred_L0 || picture->mb_list[mbAddrA].mb_pred_type == Pred_L1 || picture->mb_list[mbAddrA].mb_pred_type == BiPred)) ||
-        (mbAddrA >= 0 && transBlockB == -1 && picture->mb_list[mbAddrA].mb_pred_type != I_PCM) ||
-        ((picture->mb_list[mbAddrA].mb_pred_type == Pred_L0 || picture->mb_list[mbAddrA].mb_pred_type == Pred_L1 || picture->mb_list[mbAddrA].mb_pred_type == BiPred) &&
-         picture->mb_list[CurrMbAddr].constrained_intra_pred_flag == 1 && mbAddrA >= 0 &&
-         (picture->mb_list[mbAddrA].mb_pred_type == Pred_L0 || picture->mb_list[mbAddrA].mb_pred_type == Pred_L1 || picture->mb_list[mbAddrA].mb_pred_type == BiPred) &&
-         (slice_header->nalu_header.nal_unit_type >= 2 && slice_header->nalu_header.nal_unit_type <= 4))) {
-        condTermFlagA = 0;
-    } else if (mbAddrA < 0 &&
-                   (picture->mb_list[mbAddrA].mb_pred_type == Pred_L0 || picture->mb_list[mbAddrA].mb_pred_type == Pred_L1 || picture->mb_list[mbAddrA].mb_pred_type == BiPred) ||
-               picture->mb_list[mbAddrA].mb_type_name == I_PCM) {
-        condTermFlagA = 1;
-    } else {
-        /*TODO*/
-        condTermFlagA = 0;
-    }
-
-    if ((mbAddrB < 0 &&
-         (picture->mb_list[mbAddrB].mb_pred_type == Pred_L0 || picture->mb_list[mbAddrB].mb_pred_type == Pred_L1 || picture->mb_list[mbAddrB].mb_pred_type == BiPred)) ||
-        (mbAddrB >= 0 && transBlockB == -1 && picture->mb_list[mbAddrB].mb_pred_type != I_PCM) ||
-        ((picture->mb_list[mbAddrB].mb_pred_type == Pred_L0 || picture->mb_list[mbAddrB].mb_pred_type == Pred_L1 || picture->mb_list[mbAddrB].mb_pred_type == BiPred) &&
-         picture->mb_list[CurrMbAddr].constrained_intra_pred_flag == 1 && mbAddrB >= 0 &&
-         (picture->mb_list[mbAddrB].mb_pred_type == Pred_L0 || picture->mb_list[mbAddrB].mb_pred_type == Pred_L1 || picture->mb_list[mbAddrB].mb_pred_type == BiPred) &&
-         (slice_header->nalu_header.nal_unit_type >= 2 && slice_header->nalu_header.nal_unit_type <= 4))) {
-        condTermFlagB = 0;
-    } else if (mbAddrB < 0 &&
-                   (picture->mb_list[mbAddrB].mb_pred_type == Pred_L0 || picture->mb_list[mbAddrB].mb_pred_type == Pred_L1 || picture->mb_list[mbAddrB].mb_pred_type == BiPred) ||
-               picture->mb_list[mbAddrB].mb_type_name == I_PCM) {
-        condTermFlagB = 1;
-    } else {
-        /*TODO*/
-        condTermFlagB = 0;
-    }
+    int32_t condTermFlagA = coded_block_flag_condTermFlagN(picture, slice_header, CurrMbAddr, mbAddrA, coded_block_flagA);
+    int32_t condTermFlagB = coded_block_flag_condTermFlagN(picture, slice_header, CurrMbAddr, mbAddrB, coded_block_flagB);
 
     *out_ctxIdxInc = condTermFlagA + 2 * condTermFlagB;
 
@@ -1893,8 +1907,8 @@ int derivation_for_ctxIdxInc_transform_size_8x8_flag(FrameOrField* picture, Slic
     int32_t is_chroma = 0;
 
     /* 6.4.11.1 Derivation process for neighbouring macroblocks */
-    neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !picture->mb_list[CurrMbAddr].mb_field_decoding_flag, sps->PicWidthInMbs, picture->mb_slice_ids,
-                             picture->mb_frame_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
+    neighbouring_macroblocks(slice_header->MbaffFrameFlag, CurrMbAddr, !bitset_get(picture->mb_field_flags, CurrMbAddr), sps->PicWidthInMbs, picture->mb_slice_ids,
+                             picture->mb_field_flags, is_chroma, sps->MbWidthC, sps->MbHeightC, &mbAddrA, &mbAddrB);
 
     int32_t condTermFlagA = 0;
     int32_t condTermFlagB = 0;
@@ -1915,6 +1929,41 @@ int derivation_for_ctxIdxInc_transform_size_8x8_flag(FrameOrField* picture, Slic
     return ERR_OK;
 }
 
+/* 9.3.3.1.1.6 Derivation process of ctxIdxInc for the syntax elements ref_idx_l0 and ref_idx_l1 */
+int derivation_for_ctxIdxInc_ref_idx(FrameOrField* picture, int32_t list, int32_t x4, int32_t y4, int32_t* out_ctxIdxInc) {
+    const MvCache* cache = &picture->mb_scratch->mv_cache;
+    int32_t idxA = MV_CACHE_IDX(x4, y4) - 1;
+    int32_t idxB = MV_CACHE_IDX(x4, y4) - 8;
+
+    /* condTermFlagN is 0 if N is not available, intra, P_Skip, predicted in the direct mode, does not use the list or refIdxZeroFlagN is 1. the reference indices of the
+     * neighbouring macroblocks are scaled in the cache, refIdx > 1 of a field macroblock seen from a frame macroblock is refIdx / 2 > 0 */
+    int32_t condTermFlagA = !cache->direct[idxA] && cache->ref[list][idxA] > 0;
+    int32_t condTermFlagB = !cache->direct[idxB] && cache->ref[list][idxB] > 0;
+
+    *out_ctxIdxInc = condTermFlagA + 2 * condTermFlagB;
+    return ERR_OK;
+}
+
+/* 9.3.3.1.1.7 Derivation process of ctxIdxInc for the syntax elements mvd_l0 and mvd_l1 */
+int derivation_for_ctxIdxInc_mvd(FrameOrField* picture, int32_t list, int32_t compIdx, int32_t x4, int32_t y4, int32_t* out_ctxIdxInc) {
+    const MvCache* cache = &picture->mb_scratch->mv_cache;
+    int32_t idxA = MV_CACHE_IDX(x4, y4) - 1;
+    int32_t idxB = MV_CACHE_IDX(x4, y4) - 8;
+
+    /* absMvdCompN is 0 for the partitions which are not available, intra, skipped, direct or do not use the list, their cache entries are 0 */
+    int32_t absMvdComp = cache->mvd[list][idxA][compIdx] + cache->mvd[list][idxB][compIdx];
+
+    if (absMvdComp < 3) {
+        *out_ctxIdxInc = 0;
+    } else if (absMvdComp > 32) {
+        *out_ctxIdxInc = 2;
+    } else {
+        *out_ctxIdxInc = 1;
+    }
+
+    return ERR_OK;
+}
+
 int cabac_mb_type(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t* out_syntax_element) {
     uint32_t slice_type = slice_header->slice_type % 5;
 
@@ -1924,24 +1973,20 @@ int cabac_mb_type(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture,
 
     if (slice_type == SLICE_TYPE_I) {
         /* Type of binarization: as specified in clause 9.3.2.5, maxBinIdxCtx: 6, ctxIdxOffset: 3*/
-        int32_t maxBinIdxCtx = 6;
         int32_t ctxIdxOffset = 3;
-        return cabac_mb_type_for_I_slices(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, maxBinIdxCtx, ctxIdxOffset, out_syntax_element);
+        return cabac_mb_type_for_I_slices(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, ctxIdxOffset, out_syntax_element);
     } else if (slice_type == SLICE_TYPE_SI) {
         /* Type of binarization: prefix and suffix as specified in clause 9.3.2.5, maxBinIdxCtx: (prefix:0, suffix:6), ctxIdxOffset: (prefix: 0, suffix: 3)*/
-        int32_t maxBinIdxCtx = 6;
         int32_t ctxIdxOffset = 3;
-        return cabac_mb_type_for_SI_slices(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, maxBinIdxCtx, ctxIdxOffset, out_syntax_element);
+        return cabac_mb_type_for_SI_slices(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, ctxIdxOffset, out_syntax_element);
     } else if (slice_type == SLICE_TYPE_B) {
         /* Type of binarization: prefix and suffix as specified in clause 9.3.2.5, maxBinIdxCtx: (prefix:3, suffix:5), ctxIdxOffset: (prefix: 27, suffix: 32)*/
-        int32_t maxBinIdxCtx = -1;
-        int32_t ctxIdxOffset = -1;
-        return cabac_mb_type_for_B_slices(rbsp_reader, cabac, picture, CurrMbAddr, maxBinIdxCtx, ctxIdxOffset, out_syntax_element);
+        int32_t ctxIdxOffset = 27;
+        return cabac_mb_type_for_B_slices(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, ctxIdxOffset, out_syntax_element);
     } else if (slice_type == SLICE_TYPE_P || slice_type == SLICE_TYPE_SP) {
         /* Type of binarization: prefix and suffix as specified in clause 9.3.2.5, maxBinIdxCtx: (prefix:2, suffix:5), ctxIdxOffset: (prefix: 14, suffix: 17)*/
-        int32_t maxBinIdxCtx = -1;
-        int32_t ctxIdxOffset = -1;
-        return cabac_mb_type_for_P_SP_slices(rbsp_reader, cabac, picture, CurrMbAddr, maxBinIdxCtx, ctxIdxOffset, out_syntax_element);
+        int32_t ctxIdxOffset = 14;
+        return cabac_mb_type_for_P_SP_slices(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, ctxIdxOffset, out_syntax_element);
     } else {
         return ERR_INVALID_SLICE_TYPE;
     }
@@ -2100,7 +2145,7 @@ static int cabac_mb_type_for_I_slices_binIdx3_start(RBSPReader* rbsp_reader, CAB
 }
 
 /* Table 9-36 – Binarization for macroblock types in I slices */
-int cabac_mb_type_for_I_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t maxBinIdxCtx,
+int cabac_mb_type_for_I_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr,
                                int32_t ctxIdxOffset, int32_t* out_syntax_element) {
     int err_code = ERR_OK;
 
@@ -2152,18 +2197,11 @@ int cabac_mb_type_for_I_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrFie
         }
     }
 
-    if (*out_syntax_element == 25) {
-        err_code = cabac_init_arithmetic_decoding_engine(rbsp_reader, cabac);
-        if (err_code < 0) {
-            return err_code;
-        }
-    }
-
     return ERR_OK;
 }
 
 /* 9.3.2.5 Binarization process for macroblock type and sub-macroblock type */
-int cabac_mb_type_for_SI_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t maxBinIdxCtx,
+int cabac_mb_type_for_SI_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr,
                                 int32_t ctxIdxOffset, int32_t* out_syntax_element) {
     int err_code = ERR_OK;
     int32_t ctxIdxInc = 0;
@@ -2194,10 +2232,9 @@ int cabac_mb_type_for_SI_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrFi
     } else {
         /* Table 9-34 – Syntax elements and associated types of binarization, maxBinIdxCtx, and ctxIdxOffset */
         /* Type of binarization: as specified in clause 9.3.2.5, maxBinIdxCtx: 6, ctxIdxOffset: 3*/
-        maxBinIdxCtx = 6;
         ctxIdxOffset = 3;
 
-        err_code = cabac_mb_type_for_I_slices(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, maxBinIdxCtx, ctxIdxOffset, out_syntax_element);
+        err_code = cabac_mb_type_for_I_slices(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, ctxIdxOffset, out_syntax_element);
         if (err_code < 0) {
             return err_code;
         }
@@ -2208,16 +2245,219 @@ int cabac_mb_type_for_SI_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrFi
     return ERR_OK;
 }
 
-int cabac_mb_type_for_B_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, int32_t CurrMbAddr, int32_t maxBinIdxCtx, int32_t ctxIdxOffset,
-                               int32_t* out_syntax_element) {
-    /*TODO*/
-    return ERR_NOT_IMPL;
+/**
+ * @brief decode the suffix of mb_type in P, SP and B slices, the bin string of Table 9-36 with the ctxIdxInc of the suffix in Table 9-39
+ *
+ * @param rbsp_reader pointer to the RBSPReader
+ * @param cabac pointer to the CABAC
+ * @param ctxIdxOffset 17 for P and SP slices, 32 for B slices
+ * @param out_syntax_element the mb_type of Table 7-11
+ * @return int 0 on success, negative value on error
+ */
+static int cabac_mb_type_intra_suffix(RBSPReader* rbsp_reader, CABAC* cabac, int32_t ctxIdxOffset, int32_t* out_syntax_element) {
+    int err_code = ERR_OK;
+
+    int32_t bypassFlag = 0;
+    int32_t binVal = 0;
+    int32_t luma = 0;
+    int32_t chroma = 0;
+    int32_t pred_mode = 0;
+
+    /* Table 9-39 */
+    /* ctxIdxOffset   |                  binIdx                                 */
+    /* ctxIdxOffset   |   0  |  1  | 2 | 3 |          4            | >=5 */
+    /* 17, 32         |   0  | 276 | 1 | 2 | 2,3(clause 9.3.3.1.2) |  3  */
+    err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset, &binVal); /* binIdx = 0 */
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    if (binVal == 0) {
+        *out_syntax_element = 0; /* 0 (I_NxN) */
+        return ERR_OK;
+    }
+
+    err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, 276, &binVal); /* binIdx = 1 */
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    if (binVal == 1) {
+        *out_syntax_element = 25; /* 25 (I_PCM) */
+        return ERR_OK;
+    }
+
+    err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + 1, &luma); /* binIdx = 2 */
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + 2, &chroma); /* binIdx = 3 */
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* Table 9-41 – Specification of ctxIdxInc for specific values of ctxIdxOffset and binIdx */
+    /* 17, 32 | binIdx 4 | (b3 != 0) ? 2 : 3 */
+    if (chroma != 0) {
+        err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + 2, &binVal); /* binIdx = 4 */
+        if (err_code < 0) {
+            return err_code;
+        }
+        chroma += binVal;
+    }
+
+    for (int32_t i = 0; i < 2; ++i) {
+        err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + 3, &binVal);
+        if (err_code < 0) {
+            return err_code;
+        }
+        pred_mode = (pred_mode << 1) | binVal;
+    }
+
+    /* Table 7-11: I_16x16_<Intra16x16PredMode>_<CodedBlockPatternChroma>_<CodedBlockPatternLuma != 0> */
+    *out_syntax_element = 1 + pred_mode + 4 * chroma + 12 * luma;
+
+    return ERR_OK;
+}
+
+/* Table 9-37 – Binarization for macroblock types in P, SP, and B slices */
+int cabac_mb_type_for_B_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr,
+                               int32_t ctxIdxOffset, int32_t* out_syntax_element) {
+    int err_code = ERR_OK;
+
+    int32_t ctxIdxInc = 0;
+    int32_t bypassFlag = 0;
+    int32_t binVal = 0;
+    int32_t bins = 0;
+
+    /* Table 9-39 */
+    /* ctxIdxOffset   |                  binIdx                                   */
+    /* ctxIdxOffset   |            0            | 1 |          2           | >=3 */
+    /* 27             | 0,1,2(clause 9.3.3.1.1.3) | 3 | 4,5(clause 9.3.3.1.2) |  5  */
+
+    /* 9.3.3.1.1.3 Derivation process of ctxIdxInc for the syntax element mb_type */
+    err_code = derivation_for_ctxIdxInc_mb_type(picture, slice_header, CurrMbAddr, ctxIdxOffset, &ctxIdxInc);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + ctxIdxInc, &binVal); /* binIdx = 0 */
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    if (binVal == 0) {
+        *out_syntax_element = 0; /* 0 (B_Direct_16x16) */
+        return ERR_OK;
+    }
+
+    err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + 3, &binVal); /* binIdx = 1 */
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* Table 9-41 – Specification of ctxIdxInc for specific values of ctxIdxOffset and binIdx */
+    /* 27 | binIdx 2 | (b1 != 0) ? 5 : 4 */
+    if (binVal == 0) {
+        err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + 4, &binVal); /* binIdx = 2 */
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        *out_syntax_element = 1 + binVal; /* 1 (B_L0_16x16), 2 (B_L1_16x16) */
+        return ERR_OK;
+    }
+
+    /* binIdx 2 to 5 */
+    for (int32_t i = 0; i < 4; ++i) {
+        err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + 5, &binVal);
+        if (err_code < 0) {
+            return err_code;
+        }
+        bins = (bins << 1) | binVal;
+    }
+
+    if (bins < 8) {
+        *out_syntax_element = 3 + bins; /* 3 (B_Bi_16x16) to 10 (B_L1_L0_16x8): 1 1 0 b3 b4 b5 */
+    } else if (bins == 13) {
+        /* prefix 1 1 1 1 0 1 and the suffix of Table 9-36 for the mb_type in B slices minus 23 */
+        /* Type of binarization: maxBinIdxCtx: 5, ctxIdxOffset: 32 */
+        ctxIdxOffset = 32;
+        err_code = cabac_mb_type_intra_suffix(rbsp_reader, cabac, ctxIdxOffset, out_syntax_element);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        *out_syntax_element += 23;
+    } else if (bins == 14) {
+        *out_syntax_element = 11; /* 11 (B_L1_L0_8x16) */
+    } else if (bins == 15) {
+        *out_syntax_element = 22; /* 22 (B_8x8) */
+    } else {
+        /* binIdx 6: 12 (B_L0_Bi_16x8) to 21 (B_Bi_Bi_8x16), 1 1 1 b3 b4 b5 b6 */
+        err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + 5, &binVal);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        *out_syntax_element = ((bins << 1) | binVal) - 4;
+    }
+
+    return ERR_OK;
 }
 
-int cabac_mb_type_for_P_SP_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, int32_t CurrMbAddr, int32_t maxBinIdxCtx, int32_t ctxIdxOffset,
-                                  int32_t* out_syntax_element) {
-    /*TODO*/
-    return ERR_NOT_IMPL;
+/* Table 9-37 – Binarization for macroblock types in P, SP, and B slices */
+int cabac_mb_type_for_P_SP_slices(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr,
+                                  int32_t ctxIdxOffset, int32_t* out_syntax_element) {
+    int err_code = ERR_OK;
+
+    int32_t bypassFlag = 0;
+    int32_t binIdx0Val = 0;
+    int32_t binIdx1Val = 0;
+    int32_t binIdx2Val = 0;
+
+    /* Table 9-39 */
+    /* ctxIdxOffset   |                  binIdx                  */
+    /* ctxIdxOffset   |   0  | 1  |            2          | >=3 */
+    /* 14             |   0  | 1  | 2,3(clause 9.3.3.1.2) | na  */
+    err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset, &binIdx0Val); /* binIdx = 0 */
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    if (binIdx0Val == 1) {
+        /* prefix 1 and the suffix of Table 9-36 for the mb_type in P and SP slices minus 5 */
+        /* Type of binarization: maxBinIdxCtx: 5, ctxIdxOffset: 17 */
+        ctxIdxOffset = 17;
+        err_code = cabac_mb_type_intra_suffix(rbsp_reader, cabac, ctxIdxOffset, out_syntax_element);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        *out_syntax_element += 5;
+        return ERR_OK;
+    }
+
+    err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + 1, &binIdx1Val); /* binIdx = 1 */
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* Table 9-41 – Specification of ctxIdxInc for specific values of ctxIdxOffset and binIdx */
+    /* 14 | binIdx 2 | (b1 != 1) ? 2 : 3 */
+    err_code = DecodeBin(rbsp_reader, cabac, bypassFlag, ctxIdxOffset + (binIdx1Val != 1 ? 2 : 3), &binIdx2Val); /* binIdx = 2 */
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    if (binIdx1Val == 0) {
+        *out_syntax_element = binIdx2Val == 0 ? 0 : 3; /* 0 (P_L0_16x16): 0 0 0, 3 (P_8x8): 0 0 1 */
+    } else {
+        *out_syntax_element = binIdx2Val == 0 ? 2 : 1; /* 2 (P_L0_L0_8x16): 0 1 0, 1 (P_L0_L0_16x8): 0 1 1 */
+    }
+
+    return ERR_OK;
 }
 
 /* Table 9-34 – Syntax elements and associated types of binarization, maxBinIdxCtx, and ctxIdxOffset */
@@ -2231,7 +2471,7 @@ int cabac_sub_mb_type(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* pictu
         /* Type of binarization : as specified in clause 9.3.2.5 2 21 */
         /* maxBinIdxCtx: 2 */
         /* ctxIdxOffset: 21 */
-        err_code = cabac_sub_mb_type_for_P_SP_slices(rbsp_reader, cabac, picture, CurrMbAddr, out_syntax_element);
+        err_code = cabac_sub_mb_type_for_P_SP_slices(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, out_syntax_element);
         if (err_code < 0) {
             return err_code;
         }
@@ -2239,7 +2479,7 @@ int cabac_sub_mb_type(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* pictu
         /* Type of binarization : as specified in clause 9.3.2.5 */
         /* maxBinIdxCtx: 3 */
         /* ctxIdxOffset: 36 */
-        err_code = cabac_sub_mb_type_for_B_slices(rbsp_reader, cabac, picture, CurrMbAddr, out_syntax_element);
+        err_code = cabac_sub_mb_type_for_B_slices(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, out_syntax_element);
         if (err_code < 0) {
             return err_code;
         }
@@ -2450,4 +2690,120 @@ int cabac_sub_mb_type_for_P_SP_slices(RBSPReader* rbsp_reader, CABAC* cabac, Fra
     }
 
     return ERR_OK;
-}
\ No newline at end of file
+}
+
+int cabac_ref_idx(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, int32_t list, int32_t x4, int32_t y4, int32_t* out_syntax_element) {
+    int err_code = ERR_OK;
+
+    int32_t ctxIdxInc = 0;
+    int32_t binVal = 0;
+    int32_t value = 0;
+
+    /* Type of binarization: U, maxBinIdxCtx: 2, ctxIdxOffset: 54 */
+    int32_t ctxIdxOffset = 54;
+
+    err_code = derivation_for_ctxIdxInc_ref_idx(picture, list, x4, y4, &ctxIdxInc);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* Table 9-39: binIdx 0 uses ctxIdxInc 0, 1, 2 or 3, binIdx 1 uses 4 and the following bins use 5 */
+    err_code = DecodeBin(rbsp_reader, cabac, 0, ctxIdxOffset + ctxIdxInc, &binVal);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    while (binVal) {
+        ++value;
+        if (value >= H264_MAX_REFS) {
+            return ERR_INVALID_REF_IDX;
+        }
+
+        err_code = DecodeBin(rbsp_reader, cabac, 0, ctxIdxOffset + (value == 1 ? 4 : 5), &binVal);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    *out_syntax_element = value;
+    return ERR_OK;
+}
+
+int cabac_mvd(RBSPReader* rbsp_reader, CABAC* cabac, FrameOrField* picture, int32_t list, int32_t compIdx, int32_t x4, int32_t y4, int32_t* out_syntax_element) {
+    int err_code = ERR_OK;
+
+    int32_t ctxIdxInc = 0;
+    int32_t binVal = 0;
+    int32_t prefix = 0;
+
+    /* Type of binarization: UEG3 with signedValFlag = 1 and uCoff = 9, maxBinIdxCtx: prefix 4, ctxIdxOffset: prefix 40 for the horizontal and 47 for the vertical
+     * component */
+    int32_t ctxIdxOffset = compIdx ? 47 : 40;
+    int32_t uCoff = 9;
+
+    err_code = derivation_for_ctxIdxInc_mvd(picture, list, compIdx, x4, y4, &ctxIdxInc);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* the TU prefix, Table 9-39: binIdx 0 uses ctxIdxInc 0, 1 or 2, binIdx 1 to 4 use 3, 4, 5, 6 and the following bins use 6 */
+    err_code = DecodeBin(rbsp_reader, cabac, 0, ctxIdxOffset + ctxIdxInc, &binVal);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    while (binVal) {
+        ++prefix;
+        if (prefix >= uCoff) {
+            break;
+        }
+
+        err_code = DecodeBin(rbsp_reader, cabac, 0, ctxIdxOffset + codec_min(prefix + 2, 6), &binVal);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    if (prefix == 0) {
+        *out_syntax_element = 0;
+        return ERR_OK;
+    }
+
+    int32_t value = prefix;
+
+    /* the Exp-Golomb suffix of order 3 in bypass mode */
+    if (prefix >= uCoff) {
+        int32_t k = 3;
+        for (;;) {
+            err_code = DecodeBypass(rbsp_reader, cabac, &binVal);
+            if (err_code < 0) {
+                return err_code;
+            }
+            if (!binVal) {
+                break;
+            }
+
+            value += 1 << k;
+            if (++k > 24) {
+                return ERR_DECODE_BYPASS;
+            }
+        }
+
+        while (k--) {
+            err_code = DecodeBypass(rbsp_reader, cabac, &binVal);
+            if (err_code < 0) {
+                return err_code;
+            }
+            value += binVal << k;
+        }
+    }
+
+    /* the sign in bypass mode */
+    err_code = DecodeBypass(rbsp_reader, cabac, &binVal);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    *out_syntax_element = binVal ? -value : value;
+    return ERR_OK;
+}
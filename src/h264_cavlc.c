@@ -1 +1,565 @@
-#include "h264decoder/h264_cavlc.h"
\ No newline at end of file
+#include "h264decoder/h264_cavlc.h"
+
+#include "h264decoder/h264_math.h"
+
+/**
+ * The first level of the CAVLC lookup tables. The code words with the same number of leading zero bits share one second level table, which is indexed by the suffix_bits
+ * bits following the first 1 bit. The code words shorter than the others in the same second level table fill several entries.
+ */
+typedef struct {
+    uint16_t offset;     /* the offset of the second level table in the entries array */
+    uint8_t suffix_bits; /* the bits number which indexes the second level table */
+} CAVLC_VLC_PREFIX;
+
+/**
+ * The second level of the CAVLC lookup tables
+ */
+typedef struct {
+    uint8_t value;  /* the syntax element value */
+    uint8_t length; /* the code word length, 0 for the code word which is not allowed */
+} CAVLC_VLC_ENTRY;
+
+/**
+ * The CAVLC lookup table.
+ * The leading zero bits number is clipped to max_leading_zeros, the first level entry at max_leading_zeros is the all-zero code word or the code word which is not allowed
+ */
+typedef struct {
+    const CAVLC_VLC_PREFIX* prefix;
+    const CAVLC_VLC_ENTRY* entries;
+    int32_t max_leading_zeros;
+} CAVLC_VLC_TABLE;
+
+/* the value of coeff_token entries */
+#define COEFF_TOKEN(TotalCoeff, TrailingOnes) (((TotalCoeff) << 2) | (TrailingOnes))
+
+/* Table 9-5 – coeff_token: TotalCoeff( coeff_token ) and TrailingOnes( coeff_token ) */
+static const CAVLC_VLC_PREFIX g_coeff_token_prefix[68] = {
+    /* 0 <= nC < 2 */
+    {0, 0}, {1, 0}, {2, 0}, {3, 2}, {7, 2}, {11, 2}, {15, 2}, {19, 2}, {23, 2}, {27, 3}, {35, 3}, {43, 3},
+    {51, 3}, {59, 2}, {63, 0}, {64, 0},
+    /* 2 <= nC < 4 */
+    {65, 1}, {67, 2}, {71, 3}, {79, 2}, {83, 2}, {87, 2}, {91, 2}, {95, 3}, {103, 3}, {111, 3}, {119, 3}, {127, 2},
+    {131, 0}, {132, 0},
+    /* 4 <= nC < 8 */
+    {133, 3}, {141, 3}, {149, 3}, {157, 3}, {165, 3}, {173, 3}, {181, 3}, {189, 2}, {193, 1}, {195, 0}, {196, 0},
+    /* 8 <= nC */
+    {197, 5}, {229, 4}, {245, 3}, {253, 2}, {257, 1}, {259, 0}, {260, 0},
+    /* nC == -1 */
+    {261, 0}, {262, 0}, {263, 0}, {264, 2}, {268, 1}, {270, 1}, {272, 1}, {274, 0},
+    /* nC == -2 */
+    {275, 0}, {276, 0}, {277, 0}, {278, 3}, {286, 0}, {287, 0}, {288, 2}, {292, 2}, {296, 2}, {300, 2}, {304, 2}, {308, 0},
+};
+
+static const CAVLC_VLC_ENTRY g_coeff_token_entries[309] = {
+    /* 0 <= nC < 2 */
+    {COEFF_TOKEN(0, 0), 1}, {COEFF_TOKEN(1, 1), 2}, {COEFF_TOKEN(2, 2), 3}, {COEFF_TOKEN(2, 1), 6}, {COEFF_TOKEN(1, 0), 6}, {COEFF_TOKEN(3, 3), 5},
+    {COEFF_TOKEN(3, 3), 5}, {COEFF_TOKEN(5, 3), 7}, {COEFF_TOKEN(3, 2), 7}, {COEFF_TOKEN(4, 3), 6}, {COEFF_TOKEN(4, 3), 6}, {COEFF_TOKEN(6, 3), 8},
+    {COEFF_TOKEN(4, 2), 8}, {COEFF_TOKEN(3, 1), 8}, {COEFF_TOKEN(2, 0), 8}, {COEFF_TOKEN(7, 3), 9}, {COEFF_TOKEN(5, 2), 9}, {COEFF_TOKEN(4, 1), 9},
+    {COEFF_TOKEN(3, 0), 9}, {COEFF_TOKEN(8, 3), 10}, {COEFF_TOKEN(6, 2), 10}, {COEFF_TOKEN(5, 1), 10}, {COEFF_TOKEN(4, 0), 10}, {COEFF_TOKEN(9, 3), 11},
+    {COEFF_TOKEN(7, 2), 11}, {COEFF_TOKEN(6, 1), 11}, {COEFF_TOKEN(5, 0), 11}, {COEFF_TOKEN(8, 0), 13}, {COEFF_TOKEN(9, 2), 13}, {COEFF_TOKEN(8, 1), 13},
+    {COEFF_TOKEN(7, 0), 13}, {COEFF_TOKEN(10, 3), 13}, {COEFF_TOKEN(8, 2), 13}, {COEFF_TOKEN(7, 1), 13}, {COEFF_TOKEN(6, 0), 13}, {COEFF_TOKEN(12, 3), 14},
+    {COEFF_TOKEN(11, 2), 14}, {COEFF_TOKEN(10, 1), 14}, {COEFF_TOKEN(10, 0), 14}, {COEFF_TOKEN(11, 3), 14}, {COEFF_TOKEN(10, 2), 14}, {COEFF_TOKEN(9, 1), 14},
+    {COEFF_TOKEN(9, 0), 14}, {COEFF_TOKEN(14, 3), 15}, {COEFF_TOKEN(13, 2), 15}, {COEFF_TOKEN(12, 1), 15}, {COEFF_TOKEN(12, 0), 15}, {COEFF_TOKEN(13, 3), 15},
+    {COEFF_TOKEN(12, 2), 15}, {COEFF_TOKEN(11, 1), 15}, {COEFF_TOKEN(11, 0), 15}, {COEFF_TOKEN(16, 3), 16}, {COEFF_TOKEN(15, 2), 16}, {COEFF_TOKEN(15, 1), 16},
+    {COEFF_TOKEN(14, 0), 16}, {COEFF_TOKEN(15, 3), 16}, {COEFF_TOKEN(14, 2), 16}, {COEFF_TOKEN(14, 1), 16}, {COEFF_TOKEN(13, 0), 16}, {COEFF_TOKEN(16, 0), 16},
+    {COEFF_TOKEN(16, 2), 16}, {COEFF_TOKEN(16, 1), 16}, {COEFF_TOKEN(15, 0), 16}, {COEFF_TOKEN(13, 1), 15}, {0, 0},
+    /* 2 <= nC < 4 */
+    {COEFF_TOKEN(1, 1), 2}, {COEFF_TOKEN(0, 0), 2}, {COEFF_TOKEN(4, 3), 4}, {COEFF_TOKEN(3, 3), 4}, {COEFF_TOKEN(2, 2), 3}, {COEFF_TOKEN(2, 2), 3},
+    {COEFF_TOKEN(6, 3), 6}, {COEFF_TOKEN(3, 2), 6}, {COEFF_TOKEN(3, 1), 6}, {COEFF_TOKEN(1, 0), 6}, {COEFF_TOKEN(5, 3), 5}, {COEFF_TOKEN(5, 3), 5},
+    {COEFF_TOKEN(2, 1), 5}, {COEFF_TOKEN(2, 1), 5}, {COEFF_TOKEN(7, 3), 6}, {COEFF_TOKEN(4, 2), 6}, {COEFF_TOKEN(4, 1), 6}, {COEFF_TOKEN(2, 0), 6},
+    {COEFF_TOKEN(8, 3), 7}, {COEFF_TOKEN(5, 2), 7}, {COEFF_TOKEN(5, 1), 7}, {COEFF_TOKEN(3, 0), 7}, {COEFF_TOKEN(5, 0), 8}, {COEFF_TOKEN(6, 2), 8},
+    {COEFF_TOKEN(6, 1), 8}, {COEFF_TOKEN(4, 0), 8}, {COEFF_TOKEN(9, 3), 9}, {COEFF_TOKEN(7, 2), 9}, {COEFF_TOKEN(7, 1), 9}, {COEFF_TOKEN(6, 0), 9},
+    {COEFF_TOKEN(11, 3), 11}, {COEFF_TOKEN(9, 2), 11}, {COEFF_TOKEN(9, 1), 11}, {COEFF_TOKEN(8, 0), 11}, {COEFF_TOKEN(10, 3), 11}, {COEFF_TOKEN(8, 2), 11},
+    {COEFF_TOKEN(8, 1), 11}, {COEFF_TOKEN(7, 0), 11}, {COEFF_TOKEN(11, 0), 12}, {COEFF_TOKEN(11, 2), 12}, {COEFF_TOKEN(11, 1), 12}, {COEFF_TOKEN(10, 0), 12},
+    {COEFF_TOKEN(12, 3), 12}, {COEFF_TOKEN(10, 2), 12}, {COEFF_TOKEN(10, 1), 12}, {COEFF_TOKEN(9, 0), 12}, {COEFF_TOKEN(14, 3), 13}, {COEFF_TOKEN(13, 2), 13},
+    {COEFF_TOKEN(13, 1), 13}, {COEFF_TOKEN(13, 0), 13}, {COEFF_TOKEN(13, 3), 13}, {COEFF_TOKEN(12, 2), 13}, {COEFF_TOKEN(12, 1), 13}, {COEFF_TOKEN(12, 0), 13},
+    {COEFF_TOKEN(15, 1), 14}, {COEFF_TOKEN(15, 0), 14}, {COEFF_TOKEN(15, 2), 14}, {COEFF_TOKEN(14, 1), 14}, {COEFF_TOKEN(14, 2), 13}, {COEFF_TOKEN(14, 2), 13},
+    {COEFF_TOKEN(14, 0), 13}, {COEFF_TOKEN(14, 0), 13}, {COEFF_TOKEN(16, 3), 14}, {COEFF_TOKEN(16, 2), 14}, {COEFF_TOKEN(16, 1), 14}, {COEFF_TOKEN(16, 0), 14},
+    {COEFF_TOKEN(15, 3), 13}, {0, 0},
+    /* 4 <= nC < 8 */
+    {COEFF_TOKEN(7, 3), 4}, {COEFF_TOKEN(6, 3), 4}, {COEFF_TOKEN(5, 3), 4}, {COEFF_TOKEN(4, 3), 4}, {COEFF_TOKEN(3, 3), 4}, {COEFF_TOKEN(2, 2), 4},
+    {COEFF_TOKEN(1, 1), 4}, {COEFF_TOKEN(0, 0), 4}, {COEFF_TOKEN(5, 1), 5}, {COEFF_TOKEN(5, 2), 5}, {COEFF_TOKEN(4, 1), 5}, {COEFF_TOKEN(4, 2), 5},
+    {COEFF_TOKEN(3, 1), 5}, {COEFF_TOKEN(8, 3), 5}, {COEFF_TOKEN(3, 2), 5}, {COEFF_TOKEN(2, 1), 5}, {COEFF_TOKEN(3, 0), 6}, {COEFF_TOKEN(7, 2), 6},
+    {COEFF_TOKEN(7, 1), 6}, {COEFF_TOKEN(2, 0), 6}, {COEFF_TOKEN(9, 3), 6}, {COEFF_TOKEN(6, 2), 6}, {COEFF_TOKEN(6, 1), 6}, {COEFF_TOKEN(1, 0), 6},
+    {COEFF_TOKEN(7, 0), 7}, {COEFF_TOKEN(6, 0), 7}, {COEFF_TOKEN(9, 2), 7}, {COEFF_TOKEN(5, 0), 7}, {COEFF_TOKEN(10, 3), 7}, {COEFF_TOKEN(8, 2), 7},
+    {COEFF_TOKEN(8, 1), 7}, {COEFF_TOKEN(4, 0), 7}, {COEFF_TOKEN(12, 3), 8}, {COEFF_TOKEN(11, 2), 8}, {COEFF_TOKEN(10, 1), 8}, {COEFF_TOKEN(9, 0), 8},
+    {COEFF_TOKEN(11, 3), 8}, {COEFF_TOKEN(10, 2), 8}, {COEFF_TOKEN(9, 1), 8}, {COEFF_TOKEN(8, 0), 8}, {COEFF_TOKEN(12, 0), 9}, {COEFF_TOKEN(13, 2), 9},
+    {COEFF_TOKEN(12, 1), 9}, {COEFF_TOKEN(11, 0), 9}, {COEFF_TOKEN(13, 3), 9}, {COEFF_TOKEN(12, 2), 9}, {COEFF_TOKEN(11, 1), 9}, {COEFF_TOKEN(10, 0), 9},
+    {COEFF_TOKEN(15, 1), 10}, {COEFF_TOKEN(14, 0), 10}, {COEFF_TOKEN(14, 3), 10}, {COEFF_TOKEN(14, 2), 10}, {COEFF_TOKEN(14, 1), 10}, {COEFF_TOKEN(13, 0), 10},
+    {COEFF_TOKEN(13, 1), 9}, {COEFF_TOKEN(13, 1), 9}, {COEFF_TOKEN(16, 1), 10}, {COEFF_TOKEN(15, 0), 10}, {COEFF_TOKEN(15, 3), 10}, {COEFF_TOKEN(15, 2), 10},
+    {COEFF_TOKEN(16, 3), 10}, {COEFF_TOKEN(16, 2), 10}, {COEFF_TOKEN(16, 0), 10}, {0, 0},
+    /* 8 <= nC */
+    {COEFF_TOKEN(9, 0), 6}, {COEFF_TOKEN(9, 1), 6}, {COEFF_TOKEN(9, 2), 6}, {COEFF_TOKEN(9, 3), 6}, {COEFF_TOKEN(10, 0), 6}, {COEFF_TOKEN(10, 1), 6},
+    {COEFF_TOKEN(10, 2), 6}, {COEFF_TOKEN(10, 3), 6}, {COEFF_TOKEN(11, 0), 6}, {COEFF_TOKEN(11, 1), 6}, {COEFF_TOKEN(11, 2), 6}, {COEFF_TOKEN(11, 3), 6},
+    {COEFF_TOKEN(12, 0), 6}, {COEFF_TOKEN(12, 1), 6}, {COEFF_TOKEN(12, 2), 6}, {COEFF_TOKEN(12, 3), 6}, {COEFF_TOKEN(13, 0), 6}, {COEFF_TOKEN(13, 1), 6},
+    {COEFF_TOKEN(13, 2), 6}, {COEFF_TOKEN(13, 3), 6}, {COEFF_TOKEN(14, 0), 6}, {COEFF_TOKEN(14, 1), 6}, {COEFF_TOKEN(14, 2), 6}, {COEFF_TOKEN(14, 3), 6},
+    {COEFF_TOKEN(15, 0), 6}, {COEFF_TOKEN(15, 1), 6}, {COEFF_TOKEN(15, 2), 6}, {COEFF_TOKEN(15, 3), 6}, {COEFF_TOKEN(16, 0), 6}, {COEFF_TOKEN(16, 1), 6},
+    {COEFF_TOKEN(16, 2), 6}, {COEFF_TOKEN(16, 3), 6}, {COEFF_TOKEN(5, 0), 6}, {COEFF_TOKEN(5, 1), 6}, {COEFF_TOKEN(5, 2), 6}, {COEFF_TOKEN(5, 3), 6},
+    {COEFF_TOKEN(6, 0), 6}, {COEFF_TOKEN(6, 1), 6}, {COEFF_TOKEN(6, 2), 6}, {COEFF_TOKEN(6, 3), 6}, {COEFF_TOKEN(7, 0), 6}, {COEFF_TOKEN(7, 1), 6},
+    {COEFF_TOKEN(7, 2), 6}, {COEFF_TOKEN(7, 3), 6}, {COEFF_TOKEN(8, 0), 6}, {COEFF_TOKEN(8, 1), 6}, {COEFF_TOKEN(8, 2), 6}, {COEFF_TOKEN(8, 3), 6},
+    {COEFF_TOKEN(3, 0), 6}, {COEFF_TOKEN(3, 1), 6}, {COEFF_TOKEN(3, 2), 6}, {COEFF_TOKEN(3, 3), 6}, {COEFF_TOKEN(4, 0), 6}, {COEFF_TOKEN(4, 1), 6},
+    {COEFF_TOKEN(4, 2), 6}, {COEFF_TOKEN(4, 3), 6}, {COEFF_TOKEN(2, 0), 6}, {COEFF_TOKEN(2, 1), 6}, {COEFF_TOKEN(2, 2), 6}, {0, 0},
+    {0, 0}, {COEFF_TOKEN(0, 0), 6}, {COEFF_TOKEN(1, 1), 6}, {COEFF_TOKEN(1, 0), 6},
+    /* nC == -1 */
+    {COEFF_TOKEN(1, 1), 1}, {COEFF_TOKEN(0, 0), 2}, {COEFF_TOKEN(2, 2), 3}, {COEFF_TOKEN(2, 0), 6}, {COEFF_TOKEN(3, 3), 6}, {COEFF_TOKEN(2, 1), 6},
+    {COEFF_TOKEN(1, 0), 6}, {COEFF_TOKEN(4, 0), 6}, {COEFF_TOKEN(3, 0), 6}, {COEFF_TOKEN(3, 2), 7}, {COEFF_TOKEN(3, 1), 7}, {COEFF_TOKEN(4, 2), 8},
+    {COEFF_TOKEN(4, 1), 8}, {COEFF_TOKEN(4, 3), 7},
+    /* nC == -2 */
+    {COEFF_TOKEN(0, 0), 1}, {COEFF_TOKEN(1, 1), 2}, {COEFF_TOKEN(2, 2), 3}, {COEFF_TOKEN(6, 3), 7}, {COEFF_TOKEN(5, 3), 7}, {COEFF_TOKEN(4, 2), 7},
+    {COEFF_TOKEN(3, 2), 7}, {COEFF_TOKEN(3, 1), 7}, {COEFF_TOKEN(2, 1), 7}, {COEFF_TOKEN(2, 0), 7}, {COEFF_TOKEN(1, 0), 7}, {COEFF_TOKEN(3, 3), 5},
+    {COEFF_TOKEN(4, 3), 6}, {COEFF_TOKEN(5, 2), 9}, {COEFF_TOKEN(4, 1), 9}, {COEFF_TOKEN(4, 0), 9}, {COEFF_TOKEN(3, 0), 9}, {COEFF_TOKEN(7, 3), 10},
+    {COEFF_TOKEN(6, 2), 10}, {COEFF_TOKEN(5, 1), 10}, {COEFF_TOKEN(5, 0), 10}, {COEFF_TOKEN(8, 3), 11}, {COEFF_TOKEN(7, 2), 11}, {COEFF_TOKEN(6, 1), 11},
+    {COEFF_TOKEN(6, 0), 11}, {COEFF_TOKEN(8, 2), 12}, {COEFF_TOKEN(8, 1), 12}, {COEFF_TOKEN(7, 1), 12}, {COEFF_TOKEN(7, 0), 12}, {0, 0},
+    {0, 0}, {0, 0}, {COEFF_TOKEN(8, 0), 13}, {0, 0},
+};
+
+static const CAVLC_VLC_TABLE g_coeff_token_tables[6] = {
+    {&g_coeff_token_prefix[0], g_coeff_token_entries, 15}, /* 0 <= nC < 2 */
+    {&g_coeff_token_prefix[16], g_coeff_token_entries, 13}, /* 2 <= nC < 4 */
+    {&g_coeff_token_prefix[30], g_coeff_token_entries, 10}, /* 4 <= nC < 8 */
+    {&g_coeff_token_prefix[41], g_coeff_token_entries, 6}, /* 8 <= nC */
+    {&g_coeff_token_prefix[48], g_coeff_token_entries, 7}, /* nC == -1 */
+    {&g_coeff_token_prefix[56], g_coeff_token_entries, 11}, /* nC == -2 */
+};
+
+/* Table 9-7, Table 9-8 and Table 9-9 – total_zeros */
+static const CAVLC_VLC_PREFIX g_total_zeros_prefix[123] = {
+    /* tzVlcIndex 1 */
+    {0, 0}, {1, 1}, {3, 1}, {5, 1}, {7, 1}, {9, 1}, {11, 1}, {13, 1}, {15, 0}, {16, 0},
+    /* tzVlcIndex 2 */
+    {17, 2}, {21, 2}, {25, 1}, {27, 1}, {29, 1}, {31, 0}, {32, 0},
+    /* tzVlcIndex 3 */
+    {33, 2}, {37, 2}, {41, 1}, {43, 1}, {45, 0}, {46, 0}, {47, 0},
+    /* tzVlcIndex 4 */
+    {48, 2}, {52, 2}, {56, 1}, {58, 1}, {60, 0}, {61, 0},
+    /* tzVlcIndex 5 */
+    {62, 2}, {66, 2}, {70, 1}, {72, 0}, {73, 0}, {74, 0},
+    /* tzVlcIndex 6 */
+    {75, 2}, {79, 1}, {81, 0}, {82, 0}, {83, 0}, {84, 0}, {85, 0},
+    /* tzVlcIndex 7 */
+    {86, 2}, {90, 1}, {92, 0}, {93, 0}, {94, 0}, {95, 0}, {96, 0},
+    /* tzVlcIndex 8 */
+    {97, 1}, {99, 1}, {101, 0}, {102, 0}, {103, 0}, {104, 0}, {105, 0},
+    /* tzVlcIndex 9 */
+    {106, 1}, {108, 0}, {109, 0}, {110, 0}, {111, 0}, {112, 0}, {113, 0},
+    /* tzVlcIndex 10 */
+    {114, 1}, {116, 0}, {117, 0}, {118, 0}, {119, 0}, {120, 0},
+    /* tzVlcIndex 11 */
+    {121, 0}, {122, 1}, {124, 0}, {125, 0}, {126, 0},
+    /* tzVlcIndex 12 */
+    {127, 0}, {128, 0}, {129, 0}, {130, 0}, {131, 0},
+    /* tzVlcIndex 13 */
+    {132, 0}, {133, 0}, {134, 0}, {135, 0},
+    /* tzVlcIndex 14 */
+    {136, 0}, {137, 0}, {138, 0},
+    /* tzVlcIndex 15 */
+    {139, 0}, {140, 0},
+    /* chroma DC 2x2, tzVlcIndex 1 */
+    {141, 0}, {142, 0}, {143, 0}, {144, 0},
+    /* chroma DC 2x2, tzVlcIndex 2 */
+    {145, 0}, {146, 0}, {147, 0},
+    /* chroma DC 2x2, tzVlcIndex 3 */
+    {148, 0}, {149, 0},
+    /* chroma DC 2x4, tzVlcIndex 1 */
+    {150, 0}, {151, 1}, {153, 1}, {155, 0}, {156, 0}, {157, 0},
+    /* chroma DC 2x4, tzVlcIndex 2 */
+    {158, 2}, {162, 0}, {163, 0}, {164, 0},
+    /* chroma DC 2x4, tzVlcIndex 3 */
+    {165, 2}, {169, 0}, {170, 0}, {171, 0},
+    /* chroma DC 2x4, tzVlcIndex 4 */
+    {172, 2}, {176, 0}, {177, 0},
+    /* chroma DC 2x4, tzVlcIndex 5 */
+    {178, 1}, {180, 0}, {181, 0},
+    /* chroma DC 2x4, tzVlcIndex 6 */
+    {182, 0}, {183, 0}, {184, 0},
+    /* chroma DC 2x4, tzVlcIndex 7 */
+    {185, 0}, {186, 0},
+};
+
+static const CAVLC_VLC_ENTRY g_total_zeros_entries[187] = {
+    /* tzVlcIndex 1 */
+    {0, 1}, {2, 3}, {1, 3}, {4, 4}, {3, 4}, {6, 5}, {5, 5}, {8, 6}, {7, 6}, {10, 7}, {9, 7}, {12, 8},
+    {11, 8}, {14, 9}, {13, 9}, {15, 9}, {0, 0},
+    /* tzVlcIndex 2 */
+    {3, 3}, {2, 3}, {1, 3}, {0, 3}, {6, 4}, {5, 4}, {4, 3}, {4, 3}, {8, 4}, {7, 4}, {10, 5}, {9, 5},
+    {12, 6}, {11, 6}, {13, 6}, {14, 6},
+    /* tzVlcIndex 3 */
+    {6, 3}, {3, 3}, {2, 3}, {1, 3}, {4, 4}, {0, 4}, {7, 3}, {7, 3}, {8, 4}, {5, 4}, {10, 5}, {9, 5},
+    {12, 5}, {11, 6}, {13, 6},
+    /* tzVlcIndex 4 */
+    {6, 3}, {5, 3}, {4, 3}, {1, 3}, {3, 4}, {2, 4}, {8, 3}, {8, 3}, {9, 4}, {7, 4}, {10, 5}, {0, 5},
+    {11, 5}, {12, 5},
+    /* tzVlcIndex 5 */
+    {6, 3}, {5, 3}, {4, 3}, {3, 3}, {1, 4}, {0, 4}, {7, 3}, {7, 3}, {8, 4}, {2, 4}, {10, 4}, {9, 5},
+    {11, 5},
+    /* tzVlcIndex 6 */
+    {5, 3}, {4, 3}, {3, 3}, {2, 3}, {7, 3}, {6, 3}, {9, 3}, {8, 4}, {1, 5}, {0, 6}, {10, 6},
+    /* tzVlcIndex 7 */
+    {3, 3}, {2, 3}, {5, 2}, {5, 2}, {6, 3}, {4, 3}, {8, 3}, {7, 4}, {1, 5}, {0, 6}, {9, 6},
+    /* tzVlcIndex 8 */
+    {5, 2}, {4, 2}, {6, 3}, {3, 3}, {7, 3}, {1, 4}, {2, 5}, {0, 6}, {8, 6},
+    /* tzVlcIndex 9 */
+    {4, 2}, {3, 2}, {6, 2}, {5, 3}, {2, 4}, {7, 5}, {0, 6}, {1, 6},
+    /* tzVlcIndex 10 */
+    {4, 2}, {3, 2}, {5, 2}, {2, 3}, {6, 4}, {0, 5}, {1, 5},
+    /* tzVlcIndex 11 */
+    {4, 1}, {3, 3}, {5, 3}, {2, 3}, {1, 4}, {0, 4},
+    /* tzVlcIndex 12 */
+    {3, 1}, {2, 2}, {4, 3}, {1, 4}, {0, 4},
+    /* tzVlcIndex 13 */
+    {2, 1}, {3, 2}, {1, 3}, {0, 3},
+    /* tzVlcIndex 14 */
+    {2, 1}, {1, 2}, {0, 2},
+    /* tzVlcIndex 15 */
+    {1, 1}, {0, 1},
+    /* chroma DC 2x2, tzVlcIndex 1 */
+    {0, 1}, {1, 2}, {2, 3}, {3, 3},
+    /* chroma DC 2x2, tzVlcIndex 2 */
+    {0, 1}, {1, 2}, {2, 2},
+    /* chroma DC 2x2, tzVlcIndex 3 */
+    {0, 1}, {1, 1},
+    /* chroma DC 2x4, tzVlcIndex 1 */
+    {0, 1}, {1, 3}, {2, 3}, {3, 4}, {4, 4}, {5, 4}, {6, 5}, {7, 5},
+    /* chroma DC 2x4, tzVlcIndex 2 */
+    {3, 3}, {4, 3}, {5, 3}, {6, 3}, {1, 2}, {2, 3}, {0, 3},
+    /* chroma DC 2x4, tzVlcIndex 3 */
+    {3, 2}, {3, 2}, {4, 3}, {5, 3}, {2, 2}, {1, 3}, {0, 3},
+    /* chroma DC 2x4, tzVlcIndex 4 */
+    {3, 2}, {3, 2}, {0, 3}, {4, 3}, {2, 2}, {1, 2},
+    /* chroma DC 2x4, tzVlcIndex 5 */
+    {2, 2}, {3, 2}, {1, 2}, {0, 2},
+    /* chroma DC 2x4, tzVlcIndex 6 */
+    {2, 1}, {1, 2}, {0, 2},
+    /* chroma DC 2x4, tzVlcIndex 7 */
+    {1, 1}, {0, 1},
+};
+
+static const CAVLC_VLC_TABLE g_total_zeros_tables[25] = {
+    {&g_total_zeros_prefix[0], g_total_zeros_entries, 9}, /* tzVlcIndex 1 */
+    {&g_total_zeros_prefix[10], g_total_zeros_entries, 6}, /* tzVlcIndex 2 */
+    {&g_total_zeros_prefix[17], g_total_zeros_entries, 6}, /* tzVlcIndex 3 */
+    {&g_total_zeros_prefix[24], g_total_zeros_entries, 5}, /* tzVlcIndex 4 */
+    {&g_total_zeros_prefix[30], g_total_zeros_entries, 5}, /* tzVlcIndex 5 */
+    {&g_total_zeros_prefix[36], g_total_zeros_entries, 6}, /* tzVlcIndex 6 */
+    {&g_total_zeros_prefix[43], g_total_zeros_entries, 6}, /* tzVlcIndex 7 */
+    {&g_total_zeros_prefix[50], g_total_zeros_entries, 6}, /* tzVlcIndex 8 */
+    {&g_total_zeros_prefix[57], g_total_zeros_entries, 6}, /* tzVlcIndex 9 */
+    {&g_total_zeros_prefix[64], g_total_zeros_entries, 5}, /* tzVlcIndex 10 */
+    {&g_total_zeros_prefix[70], g_total_zeros_entries, 4}, /* tzVlcIndex 11 */
+    {&g_total_zeros_prefix[75], g_total_zeros_entries, 4}, /* tzVlcIndex 12 */
+    {&g_total_zeros_prefix[80], g_total_zeros_entries, 3}, /* tzVlcIndex 13 */
+    {&g_total_zeros_prefix[84], g_total_zeros_entries, 2}, /* tzVlcIndex 14 */
+    {&g_total_zeros_prefix[87], g_total_zeros_entries, 1}, /* tzVlcIndex 15 */
+    {&g_total_zeros_prefix[89], g_total_zeros_entries, 3}, /* chroma DC 2x2, tzVlcIndex 1 */
+    {&g_total_zeros_prefix[93], g_total_zeros_entries, 2}, /* chroma DC 2x2, tzVlcIndex 2 */
+    {&g_total_zeros_prefix[96], g_total_zeros_entries, 1}, /* chroma DC 2x2, tzVlcIndex 3 */
+    {&g_total_zeros_prefix[98], g_total_zeros_entries, 5}, /* chroma DC 2x4, tzVlcIndex 1 */
+    {&g_total_zeros_prefix[104], g_total_zeros_entries, 3}, /* chroma DC 2x4, tzVlcIndex 2 */
+    {&g_total_zeros_prefix[108], g_total_zeros_entries, 3}, /* chroma DC 2x4, tzVlcIndex 3 */
+    {&g_total_zeros_prefix[112], g_total_zeros_entries, 2}, /* chroma DC 2x4, tzVlcIndex 4 */
+    {&g_total_zeros_prefix[115], g_total_zeros_entries, 2}, /* chroma DC 2x4, tzVlcIndex 5 */
+    {&g_total_zeros_prefix[118], g_total_zeros_entries, 2}, /* chroma DC 2x4, tzVlcIndex 6 */
+    {&g_total_zeros_prefix[121], g_total_zeros_entries, 1}, /* chroma DC 2x4, tzVlcIndex 7 */
+};
+
+/* Table 9-10 – Tables for run_before */
+static const CAVLC_VLC_PREFIX g_run_before_prefix[32] = {
+    /* zerosLeft 1 */
+    {0, 0}, {1, 0},
+    /* zerosLeft 2 */
+    {2, 0}, {3, 0}, {4, 0},
+    /* zerosLeft 3 */
+    {5, 1}, {7, 0}, {8, 0},
+    /* zerosLeft 4 */
+    {9, 1}, {11, 0}, {12, 0}, {13, 0},
+    /* zerosLeft 5 */
+    {14, 1}, {16, 1}, {18, 0}, {19, 0},
+    /* zerosLeft 6 */
+    {20, 2}, {24, 1}, {26, 0}, {27, 0},
+    /* zerosLeft > 6 */
+    {28, 2}, {32, 1}, {34, 0}, {35, 0}, {36, 0}, {37, 0}, {38, 0}, {39, 0}, {40, 0}, {41, 0}, {42, 0}, {43, 0},
+};
+
+static const CAVLC_VLC_ENTRY g_run_before_entries[44] = {
+    /* zerosLeft 1 */
+    {0, 1}, {1, 1},
+    /* zerosLeft 2 */
+    {0, 1}, {1, 2}, {2, 2},
+    /* zerosLeft 3 */
+    {1, 2}, {0, 2}, {2, 2}, {3, 2},
+    /* zerosLeft 4 */
+    {1, 2}, {0, 2}, {2, 2}, {3, 3}, {4, 3},
+    /* zerosLeft 5 */
+    {1, 2}, {0, 2}, {3, 3}, {2, 3}, {4, 3}, {5, 3},
+    /* zerosLeft 6 */
+    {6, 3}, {5, 3}, {0, 2}, {0, 2}, {4, 3}, {3, 3}, {2, 3}, {1, 3},
+    /* zerosLeft > 6 */
+    {3, 3}, {2, 3}, {1, 3}, {0, 3}, {5, 3}, {4, 3}, {6, 3}, {7, 4}, {8, 5}, {9, 6}, {10, 7}, {11, 8},
+    {12, 9}, {13, 10}, {14, 11}, {0, 0},
+};
+
+static const CAVLC_VLC_TABLE g_run_before_tables[7] = {
+    {&g_run_before_prefix[0], g_run_before_entries, 1}, /* zerosLeft 1 */
+    {&g_run_before_prefix[2], g_run_before_entries, 2}, /* zerosLeft 2 */
+    {&g_run_before_prefix[5], g_run_before_entries, 2}, /* zerosLeft 3 */
+    {&g_run_before_prefix[8], g_run_before_entries, 3}, /* zerosLeft 4 */
+    {&g_run_before_prefix[12], g_run_before_entries, 3}, /* zerosLeft 5 */
+    {&g_run_before_prefix[16], g_run_before_entries, 3}, /* zerosLeft 6 */
+    {&g_run_before_prefix[20], g_run_before_entries, 11}, /* zerosLeft > 6 */
+};
+
+/* read the code word of the lookup table */
+static inline int cavlc_read_vlc(RBSPReader* rbsp_reader, const CAVLC_VLC_TABLE* table, int32_t* out_value) {
+    /* the longest code word is 16 bits */
+    uint32_t bits = peek_u(rbsp_reader, 24) << 8;
+    int32_t leading_zeros = count_leading_zeros(bits);
+    if (leading_zeros > table->max_leading_zeros) {
+        leading_zeros = table->max_leading_zeros;
+    }
+
+    const CAVLC_VLC_PREFIX* prefix = &table->prefix[leading_zeros];
+    uint32_t suffix = 0;
+    if (prefix->suffix_bits) {
+        suffix = (bits << (leading_zeros + 1)) >> (32 - prefix->suffix_bits);
+    }
+
+    const CAVLC_VLC_ENTRY* entry = &table->entries[prefix->offset + suffix];
+    if (entry->length == 0) {
+        return ERR_CAVLC_INVALID_CODE;
+    }
+
+    skip_n_bits(rbsp_reader, entry->length);
+    *out_value = entry->value;
+
+    return ERR_OK;
+}
+
+/* read n bits, n may be 0 */
+static inline uint32_t cavlc_read_bits(RBSPReader* rbsp_reader, int32_t n) {
+    uint32_t result = 0;
+
+    if (n == 0) {
+        return 0;
+    } else if (n <= 25) {
+        result = peek_u(rbsp_reader, n);
+        skip_n_bits(rbsp_reader, n);
+        return result;
+    }
+
+    return read_u(rbsp_reader, n);
+}
+
+/* 9.2.2.1 Parsing process for level_prefix */
+static inline int cavlc_level_prefix(RBSPReader* rbsp_reader, int32_t* out_level_prefix) {
+    int32_t leadingZeroBits = 0;
+
+    while (1) {
+        uint32_t bits = peek_u(rbsp_reader, 25) << 7;
+        if (bits) {
+            int32_t zeros = count_leading_zeros(bits);
+            leadingZeroBits += zeros;
+            skip_n_bits(rbsp_reader, zeros + 1);
+            break;
+        }
+
+        leadingZeroBits += 25;
+        skip_n_bits(rbsp_reader, 25);
+
+        /* the level_suffix is not longer than 32 bits */
+        if (leadingZeroBits > 35 || !is_end_valid(rbsp_reader)) {
+            return ERR_CAVLC_INVALID_LEVEL_PREFIX;
+        }
+    }
+
+    *out_level_prefix = leadingZeroBits;
+
+    return ERR_OK;
+}
+
+/* 9.2.1 Parsing process for total number of non-zero transform coefficient levels and number of trailing ones */
+static inline const CAVLC_VLC_TABLE* cavlc_coeff_token_table(int32_t nC) {
+    /* Table 9-5 – coeff_token, TrailingOnes( coeff_token ), TotalCoeff( coeff_token ) and nC */
+    if (nC >= 0) {
+        if (nC < 2) {
+            return &g_coeff_token_tables[0];
+        } else if (nC < 4) {
+            return &g_coeff_token_tables[1];
+        } else if (nC < 8) {
+            return &g_coeff_token_tables[2];
+        } else {
+            return &g_coeff_token_tables[3];
+        }
+    } else if (nC == -1) {
+        return &g_coeff_token_tables[4];
+    } else {
+        return &g_coeff_token_tables[5];
+    }
+}
+
+/* 7.3.5.3.2 Residual block CAVLC syntax */
+/* 9.2 CAVLC parsing process for transform coefficient levels */
+int residual_block_cavlc(RBSPReader* rbsp_reader, int32_t nC, int32_t* coeffLevel, int32_t startIdx, int32_t endIdx, int32_t maxNumCoeff, int32_t* out_TotalCoeff) {
+    int err_code = ERR_OK;
+
+    int32_t levelVal[16];
+    int32_t runVal[16];
+
+    int32_t coeff_token = 0;
+    int32_t TotalCoeff = 0;
+    int32_t TrailingOnes = 0;
+    int32_t suffixLength = 0;
+    int32_t zerosLeft = 0;
+    int32_t numCoeff = endIdx - startIdx + 1;
+
+    for (int32_t i = 0; i < maxNumCoeff; i++) {
+        coeffLevel[i] = 0;
+    }
+
+    err_code = cavlc_read_vlc(rbsp_reader, cavlc_coeff_token_table(nC), &coeff_token);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    TotalCoeff = coeff_token >> 2;
+    TrailingOnes = coeff_token & 0x03;
+    *out_TotalCoeff = TotalCoeff;
+
+    if (TotalCoeff == 0) {
+        return ERR_OK;
+    }
+
+    if (TotalCoeff > numCoeff) {
+        return ERR_CAVLC_COEFF_OVERFLOW;
+    }
+
+    /* 9.2.2 Parsing process for level information */
+    if (TotalCoeff > 10 && TrailingOnes < 3) {
+        suffixLength = 1;
+    } else {
+        suffixLength = 0;
+    }
+
+    /* the trailing_ones_sign_flag of all trailing ones are read at once */
+    if (TrailingOnes > 0) {
+        uint32_t trailing_ones_sign_flags = cavlc_read_bits(rbsp_reader, TrailingOnes);
+        for (int32_t i = 0; i < TrailingOnes; i++) {
+            levelVal[i] = 1 - (int32_t)((trailing_ones_sign_flags >> (TrailingOnes - 1 - i)) & 0x01) * 2;
+        }
+    }
+
+    for (int32_t i = TrailingOnes; i < TotalCoeff; i++) {
+        int32_t level_prefix = 0;
+        int32_t levelSuffixSize = 0;
+        int32_t levelCode = 0;
+
+        err_code = cavlc_level_prefix(rbsp_reader, &level_prefix);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        /* 9.2.2.1 Parsing process for level_prefix */
+        if (level_prefix == 14 && suffixLength == 0) {
+            levelSuffixSize = 4;
+        } else if (level_prefix >= 15) {
+            levelSuffixSize = level_prefix - 3;
+        } else {
+            levelSuffixSize = suffixLength;
+        }
+
+        levelCode = (codec_min(15, level_prefix) << suffixLength);
+        if (suffixLength > 0 || level_prefix >= 14) {
+            levelCode += (int32_t)cavlc_read_bits(rbsp_reader, levelSuffixSize);
+        }
+
+        if (level_prefix >= 15 && suffixLength == 0) {
+            levelCode += 15;
+        }
+
+        if (level_prefix >= 16) {
+            levelCode += (1 << (level_prefix - 3)) - 4096;
+        }
+
+        if (i == TrailingOnes && TrailingOnes < 3) {
+            levelCode += 2;
+        }
+
+        if ((levelCode & 0x01) == 0) {
+            levelVal[i] = (levelCode + 2) >> 1;
+        } else {
+            levelVal[i] = (-levelCode - 1) >> 1;
+        }
+
+        if (suffixLength == 0) {
+            suffixLength = 1;
+        }
+
+        if ((levelVal[i] > (3 << (suffixLength - 1)) || levelVal[i] < -(3 << (suffixLength - 1))) && suffixLength < 6) {
+            suffixLength++;
+        }
+    }
+
+    /* 9.2.3 Parsing process for run information */
+    if (TotalCoeff < numCoeff) {
+        const CAVLC_VLC_TABLE* total_zeros_table = 0;
+        int32_t total_zeros = 0;
+
+        /* tzVlcIndex is equal to TotalCoeff */
+        if (maxNumCoeff == 4) {
+            /* Table 9-9 (a) – Chroma DC 2x2 block (4:2:0 chroma sampling) */
+            total_zeros_table = &g_total_zeros_tables[15 + TotalCoeff - 1];
+        } else if (maxNumCoeff == 8) {
+            /* Table 9-9 (b) – Chroma DC 2x4 block (4:2:2 chroma sampling) */
+            total_zeros_table = &g_total_zeros_tables[18 + TotalCoeff - 1];
+        } else {
+            /* Table 9-7 and Table 9-8 – total_zeros tables for 4x4 blocks */
+            total_zeros_table = &g_total_zeros_tables[TotalCoeff - 1];
+        }
+
+        err_code = cavlc_read_vlc(rbsp_reader, total_zeros_table, &total_zeros);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        zerosLeft = total_zeros;
+    } else {
+        zerosLeft = 0;
+    }
+
+    if (TotalCoeff + zerosLeft > numCoeff) {
+        return ERR_CAVLC_COEFF_OVERFLOW;
+    }
+
+    for (int32_t i = 0; i < TotalCoeff - 1; i++) {
+        int32_t run_before = 0;
+
+        if (zerosLeft > 0) {
+            /* Table 9-10 – Tables for run_before */
+            err_code = cavlc_read_vlc(rbsp_reader, &g_run_before_tables[codec_min(zerosLeft, 7) - 1], &run_before);
+            if (err_code < 0) {
+                return err_code;
+            }
+
+            if (run_before > zerosLeft) {
+                return ERR_CAVLC_COEFF_OVERFLOW;
+            }
+        }
+
+        runVal[i] = run_before;
+        zerosLeft = zerosLeft - run_before;
+    }
+
+    runVal[TotalCoeff - 1] = zerosLeft;
+
+    /* 9.2.4 Combining level and run information */
+    int32_t coeffNum = -1;
+    for (int32_t i = TotalCoeff - 1; i >= 0; i--) {
+        coeffNum += runVal[i] + 1;
+        coeffLevel[startIdx + coeffNum] = levelVal[i];
+    }
+
+    if (!is_end_valid(rbsp_reader)) {
+        return ERR_CAVLC_INVALID_CODE;
+    }
+
+    return ERR_OK;
+}
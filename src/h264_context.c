@@ -1,26 +1,408 @@
 #include "h264decoder/h264_context.h"
 
+#include "h264decoder/h264_cpu.h"
 #include "h264decoder/h264_nalu_pps.h"
 #include "h264decoder/h264_nalu_slice_header.h"
 #include "h264decoder/h264_nalu_sps.h"
 #include "h264decoder/h264_rbsp.h"
 
+int set_deblock_thread_enabled(H264Context* context, int enabled) {
+    if (!enabled) {
+        if (context->deblock_thread) {
+            free_deblock_thread(context->deblock_thread);
+            context->deblock_thread = 0;
+        }
+        return ERR_OK;
+    }
+
+    if (!context->deblock_thread) {
+        context->deblock_thread = create_deblock_thread(&context->deblock_funcs);
+        if (!context->deblock_thread) {
+            return ERR_OOM;
+        }
+    }
+    return ERR_OK;
+}
+
+int set_frame_threads(H264Context* context, int32_t thread_count) {
+    if (thread_count < 0 || thread_count > H264_MAX_FRAME_THREADS) {
+        return ERR_INVALID_PARAM;
+    }
+
+    if (context->frame_threads) {
+        /* the current picture is decoded completely, its remaining slices are decoded by the next workers or by the decoding thread */
+        free_frame_threads(context->frame_threads, &context->picture_pool);
+        context->frame_threads = 0;
+        if (context->current_picture) {
+            context->current_picture->threads = 0;
+        }
+    }
+
+    if (thread_count > 1) {
+        context->frame_threads = create_frame_threads(thread_count);
+        if (!context->frame_threads) {
+            return ERR_OOM;
+        }
+    }
+    return ERR_OK;
+}
+
+int set_slice_threads(H264Context* context, int32_t thread_count) {
+    if (thread_count < 0 || thread_count > H264_MAX_SLICE_THREADS) {
+        return ERR_INVALID_PARAM;
+    }
+
+    if (context->slice_threads) {
+        free_slice_threads(context->slice_threads);
+        context->slice_threads = 0;
+    }
+
+    if (thread_count > 1) {
+        context->slice_threads = create_slice_threads(thread_count);
+        if (!context->slice_threads) {
+            return ERR_OOM;
+        }
+    }
+    return ERR_OK;
+}
+
+int set_reconstruction_threads(H264Context* context, int32_t thread_count) {
+    if (thread_count < 0 || thread_count > H264_MAX_RECONSTRUCT_THREADS) {
+        return ERR_INVALID_PARAM;
+    }
+
+    if (context->reconstructor) {
+        free_reconstructor(context->reconstructor);
+        context->reconstructor = 0;
+    }
+
+    if (thread_count != H264_RECONSTRUCT_PARSE_ONLY) {
+        context->reconstructor = create_reconstructor(thread_count);
+        if (!context->reconstructor) {
+            return ERR_OOM;
+        }
+    }
+    return ERR_OK;
+}
+
+/**
+ * @brief the frame or field which the slice decodes
+ */
+static FrameOrField* get_slice_frame_or_field(Picture* picture, const SliceHeader* header) {
+    if (!header->field_pic_flag) {
+        return picture->frame;
+    }
+    return header->bottom_field_flag ? picture->bottom_field : picture->top_field;
+}
+
+int set_picture_border(H264Context* context, int32_t border) { return set_picture_pool_border(&context->picture_pool, border); }
+
+int set_frame_pool_policy(H264Context* context, FRAME_POOL_POLICY policy) {
+    if (policy != FRAME_POOL_FAIL && policy != FRAME_POOL_GROW && policy != FRAME_POOL_BLOCK) {
+        return ERR_INVALID_PARAM;
+    }
+
+    context->pool_policy = policy;
+    return ERR_OK;
+}
+
+int set_memory_limit(H264Context* context, size_t limit) { return set_memory_budget_limit(&context->memory, limit); }
+
+void get_memory_usage(H264Context* context, MemoryUsage* usage) { get_memory_budget_usage(&context->memory, usage); }
+
+void set_access_unit_timestamps(H264Context* context, int64_t pts, int64_t dts) {
+    context->next_pts = pts;
+    context->next_dts = dts;
+}
+
+/**
+ * @brief return the pictures whose frames the application has released to the picture pool
+ *
+ * @param context the H264 context pointer
+ */
+static void return_released_pictures(H264Context* context) {
+    Picture* pictures[H264_MAX_POOL_PICTURES];
+    int32_t count = take_released_pictures(context->frame_delivery, pictures);
+
+    for (int32_t i = 0; i < count; i++) {
+        release_picture(&context->picture_pool, pictures[i]);
+    }
+}
+
+/**
+ * @brief take a picture from the pool, if the frames of the application hold every free picture the pool fails, grows or waits for a frame by the pool policy
+ *
+ * @param context the H264 context pointer
+ * @param out_picture output parameter. the picture
+ * @return int 0 on success, negative value on error
+ */
+static int acquire_picture(H264Context* context, Picture** out_picture) {
+    for (;;) {
+        return_released_pictures(context);
+
+        int err_code = get_picture_from_pool(&context->picture_pool, context->active_sps, out_picture);
+        if (err_code != ERR_PICTURE_POOL_EXHAUSTED && err_code != ERR_MEMORY_BUDGET_EXCEEDED) {
+            return err_code;
+        }
+
+        /* the pictures in flight hold their reference pictures until they are decoded */
+        if (context->frame_threads && context->frame_threads->job_count > 0) {
+            retire_picture_jobs(context->frame_threads, &context->picture_pool, context->frame_threads->job_count - 1);
+            continue;
+        }
+
+        /* the pool does not grow beyond the memory budget, the output pictures held by the application beyond it are refused like those of a fixed pool */
+        if (context->pool_policy == FRAME_POOL_GROW && err_code == ERR_PICTURE_POOL_EXHAUSTED) {
+            err_code = grow_picture_pool(&context->picture_pool);
+            if (err_code < 0) {
+                return err_code;
+            }
+        } else if (context->pool_policy == FRAME_POOL_BLOCK) {
+            /* the pictures held by the DPB are not released while the decoder waits, only the frames of the application are */
+            if (!wait_for_released_picture(context->frame_delivery)) {
+                return err_code;
+            }
+        } else {
+            return err_code;
+        }
+    }
+}
+
+int is_waiting_for_frames(H264Context* context) {
+    return_released_pictures(context);
+
+    /* the pool is initialized for the active sps by the first picture */
+    if (!context->active_sps || context->picture_pool.size <= 0) {
+        return 0;
+    }
+    if (has_picture_pool_room(&context->picture_pool, context->pool_policy == FRAME_POOL_GROW)) {
+        return 0;
+    }
+    return has_held_frames(context->frame_delivery);
+}
+
+/**
+ * @brief mark the decoded frame or field of the current picture and store it in the DPB. the pictures preceding a picture with
+ * memory_management_control_operation equal to 5 are output before it
+ *
+ * @param context the H264 context pointer
+ * @param header the header of a slice of the decoded frame or field
+ * @return int 0 on success, negative value on error
+ */
+static int finish_current_picture(H264Context* context, SliceHeader* header) {
+    Picture* picture = context->current_picture;
+
+    /* the samples are reconstructed once all the slices of the frame or field are parsed, the errors of the broken macroblocks are concealed by leaving them. the
+     * worker of the picture reconstructs the rows as it parses them and finishes the frame or field after its last slice */
+    int err_code = ERR_OK;
+    if (picture->threads) {
+        err_code = queue_frame_or_field_end(picture->threads, picture, header);
+        if (err_code < 0) {
+            return err_code;
+        }
+    } else if (context->reconstructor) {
+        reconstruct_frame_or_field(context->reconstructor, get_slice_frame_or_field(picture, header), context->active_sps, &context->deblock_funcs,
+                                   context->deblock_thread);
+    }
+
+    err_code = decoded_reference_picture_marking(&context->dpb, picture, header);
+    if (err_code < 0) {
+        return err_code;
+    }
+    /* memory_management_control_operation equal to 5 resets the picture order counts which the queued slices of the picture read */
+    if (picture->has_mmco5 && picture->threads) {
+        wait_for_picture(picture->threads, picture);
+    }
+    update_picture_order_count(&context->poc_state, context->active_sps, header, picture);
+
+    if (picture->has_mmco5 && !picture->in_dpb) {
+        err_code = output_pictures(&context->dpb, &context->picture_pool, 1);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    return store_picture_in_dpb(&context->dpb, &context->picture_pool, picture);
+}
+
 int get_picture_from_context(H264Context* context, int is_new_picture, Picture** out_picture) {
     int err_code = ERR_OK;
+    SliceHeader* header = context->current_slice_header;
+
+    if (!is_new_picture && context->current_picture) {
+        *out_picture = context->current_picture;
+        return ERR_OK;
+    }
+
+    if (context->current_picture) {
+        /* the slices of the picture are decoded before it is marked, deblocked and referred to, their errors are taken by the next slice */
+        if (context->slice_threads) {
+            wait_for_slice_tasks(context->slice_threads);
+        }
 
-    /* FIXME */
-    if (is_new_picture || !context->current_picture) {
-        context->gop_curr_index = (context->gop_curr_index + 1) % H264_MAX_DPB_FRAMES;
-        context->current_picture = context->gop[context->gop_curr_index];
+        err_code = finish_current_picture(context, context->prev_slice_header);
+        if (err_code < 0) {
+            return err_code;
+        }
 
-        reset_picture(context->current_picture);
+        /* the second field is decoded into the frame store of the first field */
+        if (is_second_field_of_picture(context->current_picture, header)) {
+            *out_picture = context->current_picture;
+            return decode_picture_order_count(&context->poc_state, context->active_sps, header, context->current_picture);
+        }
+
+        if (context->current_picture->threads) {
+            close_picture_job(context->current_picture->threads, context->current_picture);
+        }
+        release_picture(&context->picture_pool, context->current_picture);
+        context->current_picture = 0;
+
+        /* the previous picture is complete, the pictures are output as soon as the reordering allows */
+        err_code = output_pictures(&context->dpb, &context->picture_pool, 0);
+        if (err_code < 0) {
+            return err_code;
+        }
     }
 
-    *out_picture = context->current_picture;
+    /* an IDR picture marks all the reference pictures as unused, so they are released before the pool is resized for the new sps */
+    if (header->nalu_header.IdrPicFlag) {
+        flush_dpb(&context->dpb, &context->picture_pool, header->dec_ref_pic_mark.no_output_of_prior_pics_flag);
+    }
 
+    /* the pictures are reallocated only if the resolution of the active sps changes, the pictures released by the application are returned first */
+    return_released_pictures(context);
+    err_code = init_picture_pool(&context->picture_pool, context->active_sps);
+    if (err_code < 0) {
+        return err_code;
+    }
+    init_dpb(&context->dpb, context->active_sps);
+
+    /* the previous pictures are deblocked, so the kernels are replaced for the bit depths of the active sps */
+    SPS* sps = context->active_sps;
+    if ((int32_t)sps->BitDepthY != context->deblock_bit_depths[0] || (int32_t)sps->BitDepthC != context->deblock_bit_depths[1]) {
+        init_deblock_funcs(&context->deblock_funcs, (int32_t)sps->BitDepthY, (int32_t)sps->BitDepthC, get_cpu_flags());
+        context->deblock_bit_depths[0] = (int32_t)sps->BitDepthY;
+        context->deblock_bit_depths[1] = (int32_t)sps->BitDepthC;
+    }
+
+    if (!header->nalu_header.IdrPicFlag) {
+        err_code = fill_frame_num_gap(&context->dpb, &context->picture_pool, context->active_sps, header);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    Picture* picture = 0;
+    err_code = acquire_picture(context, &picture);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    init_picture_format(picture, context->active_sps);
+    picture->pts = context->next_pts;
+    picture->dts = context->next_dts;
+    context->next_pts = H264_NO_TIMESTAMP;
+    context->next_dts = H264_NO_TIMESTAMP;
+    picture->FrameNum = (int32_t)header->frame_num;
+    picture->is_reference = header->nalu_header.nal_ref_idc != 0;
+    picture->is_idr = header->nalu_header.IdrPicFlag;
+    picture->needed_for_output = 1;
+    picture->decode_index = context->dpb.decode_count++;
+    context->current_picture = picture;
+    context->flushing = 0;
+
+    if (context->frame_threads) {
+        err_code = start_picture_job(context->frame_threads, &context->picture_pool, &context->dpb, picture);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    *out_picture = picture;
+
+    return decode_picture_order_count(&context->poc_state, context->active_sps, header, picture);
+}
+
+int flush_context(H264Context* context) {
+    int err_code = ERR_OK;
+
+    /* the last slice header belongs to the current picture */
+    if (context->current_picture) {
+        if (context->slice_threads) {
+            wait_for_slice_tasks(context->slice_threads);
+        }
+
+        err_code = finish_current_picture(context, context->current_slice_header);
+        if (context->current_picture->threads) {
+            close_picture_job(context->current_picture->threads, context->current_picture);
+        }
+        release_picture(&context->picture_pool, context->current_picture);
+        context->current_picture = 0;
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    context->flushing = 1;
+    err_code = output_pictures(&context->dpb, &context->picture_pool, 1);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* the errors of the slices decoded by the workers since the last slice */
+    if (context->frame_threads) {
+        retire_picture_jobs(context->frame_threads, &context->picture_pool, 0);
+        err_code = take_frame_thread_error(context->frame_threads);
+    }
+    if (context->slice_threads && err_code == ERR_OK) {
+        err_code = take_slice_thread_error(context->slice_threads);
+    }
     return err_code;
 }
 
+/**
+ * @brief take the next picture of the output queue. the pictures flushed beyond the size of the output queue are queued as it empties
+ *
+ * @param context the H264 context pointer
+ * @return Picture* the picture, 0 if no picture is output
+ */
+static Picture* take_output_picture(H264Context* context) {
+    if (context->flushing && !context->dpb.output_count) {
+        output_pictures(&context->dpb, &context->picture_pool, 1);
+    }
+
+    return get_output_picture_from_dpb(&context->dpb);
+}
+
+int receive_frame(H264Context* context, DecodedFrame* frame) {
+    return_released_pictures(context);
+
+    Picture* picture = take_output_picture(context);
+    if (!picture) {
+        memset(frame, 0, sizeof(DecodedFrame));
+        return ERR_NO_FRAME;
+    }
+
+    /* the workers may still decode the rows of the picture */
+    if (context->frame_threads) {
+        wait_for_picture(context->frame_threads, picture);
+    }
+
+    /* the handle takes over the reference of the output queue */
+    attach_frame(context->frame_delivery, picture, frame);
+    return ERR_OK;
+}
+
+Picture* get_output_picture(H264Context* context) {
+    Picture* picture = take_output_picture(context);
+    if (picture && context->frame_threads) {
+        wait_for_picture(context->frame_threads, picture);
+    }
+    return picture;
+}
+
+void release_output_picture(H264Context* context, Picture* picture) { release_picture(&context->picture_pool, picture); }
+
 void get_slice_header(H264Context* context, SliceHeader** out_header) {
     SliceHeader* swap_header = context->current_slice_header;
     context->current_slice_header = context->prev_slice_header;
@@ -31,53 +413,93 @@ void get_slice_header(H264Context* context, SliceHeader** out_header) {
     *out_header = context->current_slice_header;
 }
 
-int parse_nalu(const uint8_t* nalu_start, const uint8_t* nalu_end, H264Context* context, void** nalu) {
-    int err_code = ERR_OK;
-    int rbsp_len = 0;
-    uint8_t* rbsp_buffer = 0;
-    RBSPReader* rbsp_reader = 0;
+int decode_slice_nalu(H264Context* context, SliceHeader* slice_header, int is_first_VCL_NAL, uint8_t** rbsp_buffer, size_t* rbsp_capacity,
+                      RBSPReader* rbsp_reader) {
+    Picture* picture;
 
-    int nal_unit_header_bytes = 1;
-    uint8_t svc_extension_flag = 0;
-    uint8_t avc_3d_extension_flag = 0;
+    /* get a picture from the H264 context to decode the slice data*/
+    int err_code = get_picture_from_context(context, is_first_VCL_NAL, &picture);
+    if (err_code < 0) {
+        return ERR_INVALID_SLICE;
+    }
 
-    uint8_t forbidden_zero_bit = (nalu_start[0] >> 7) & 0x01;
-    uint8_t nal_ref_idc = (nalu_start[0] >> 5) & 0x03;
-    uint8_t nal_unit_type = nalu_start[0] & 0x1F;
+    err_code = construct_ref_pic_lists(&context->ref_list_cache, &context->dpb, picture, slice_header, &context->ref_lists);
+    if (err_code < 0) {
+        return ERR_INVALID_SLICE;
+    }
+
+    set_picture_structure(picture, slice_header);
 
-    if (nal_unit_type == NALU_PREFIX_NALU                 /* 14 */
-        || nal_unit_type == NALU_CODED_SLICE_EXTENSION    /* 20 */
-        || nal_unit_type == NALU_CODED_SLICE_EXTENSION_DV /* 21 */
-    ) {
-        if (nalu_end - nalu_start <= 1) {
-            err_code = ERR_EOS;
-            goto exit_flag;
+    /* the macroblocks are packed for the reconstruction as the slices are parsed */
+    if (context->reconstructor) {
+        err_code = start_residual_records(context->reconstructor, get_slice_frame_or_field(picture, slice_header), slice_header);
+        if (err_code < 0) {
+            return err_code;
         }
+    }
 
-        if (nal_unit_type != NALU_CODED_SLICE_EXTENSION_DV) {
-            svc_extension_flag = (uint8_t)(nalu_start[1] >> 7) & 0x01;
-        } else {
-            avc_3d_extension_flag = (uint8_t)(nalu_start[1] >> 7) & 0x01;
+    if (picture->threads) {
+        /* the worker of the picture decodes the slice data, the slice job takes over the RBSP and hands back the buffer of its previous slice */
+        err_code = queue_slice_job(picture->threads, picture, slice_header, rbsp_buffer, rbsp_capacity, rbsp_reader, &context->ref_lists);
+        if (err_code < 0) {
+            return ERR_INVALID_SLICE;
         }
 
-        if (svc_extension_flag) {
-            /* TODO: */
-            /* specified in Annex F */
-            nal_unit_header_bytes += 3;
-        } else if (avc_3d_extension_flag) {
-            /* TODO: */
-            /* specified in Annex I */
-            nal_unit_header_bytes += 2;
-        } else {
-            /* TODO: */
-            /* specified in Annex G */
-            nal_unit_header_bytes += 3;
+        /* the slices failed on the workers are reported by the next slice */
+        if (take_frame_thread_error(picture->threads) < 0) {
+            return ERR_INVALID_SLICE;
+        }
+        return ERR_OK;
+    }
+
+    if (context->slice_threads) {
+        /* a slice thread decodes the slice data while the next slices are parsed, the task takes over the RBSP and hands back the buffer of its previous slice */
+        err_code = queue_slice_task(context->slice_threads, picture, slice_header, rbsp_buffer, rbsp_capacity, rbsp_reader, &context->ref_lists);
+        if (err_code < 0) {
+            return ERR_INVALID_SLICE;
+        }
+
+        if (take_slice_thread_error(context->slice_threads) < 0) {
+            return ERR_INVALID_SLICE;
         }
+        return ERR_OK;
     }
 
-    rbsp_buffer = (uint8_t*)malloc(nalu_end - nalu_start - nal_unit_header_bytes);
+    err_code = decode_slice(picture, context->mb_scratch, rbsp_reader, slice_header, &context->ref_lists);
+    if (err_code < 0) {
+        return ERR_INVALID_SLICE;
+    }
+
+    rbsp_slice_trailing_bits(rbsp_reader, context->active_pps->entropy_coding_mode_flag);
+
+    return ERR_OK;
+}
+
+int parse_nalu(const uint8_t* nalu_start, const uint8_t* nalu_end, H264Context* context, void** nalu) {
+    int err_code = ERR_OK;
+    int rbsp_len = 0;
+    uint8_t* rbsp_buffer = 0;
+    size_t rbsp_capacity = 0;
+    RBSPReader* rbsp_reader = 0;
+
+    NALUHeader nalu_header;
+    int nal_unit_header_bytes = nal_unit_header(nalu_start, nalu_end, &nalu_header);
+    if (nal_unit_header_bytes < 0) {
+        err_code = nal_unit_header_bytes;
+        goto exit_flag;
+    }
+
+    uint8_t forbidden_zero_bit = nalu_header.forbidden_zero_bit;
+    uint8_t nal_ref_idc = nalu_header.nal_ref_idc;
+    uint8_t nal_unit_type = nalu_header.nal_unit_type;
+    uint8_t svc_extension_flag = nalu_header.svc_extension_flag;
+    uint8_t avc_3d_extension_flag = nalu_header.avc_3d_extension_flag;
+
+    rbsp_capacity = nalu_end - nalu_start - nal_unit_header_bytes;
+    rbsp_buffer = (uint8_t*)malloc(rbsp_capacity);
     if (!rbsp_buffer) {
         err_code = ERR_OOM;
+        goto exit_flag;
     }
     memset(rbsp_buffer, 0, nalu_end - nalu_start - nal_unit_header_bytes);
 
@@ -122,23 +544,10 @@ int parse_nalu(const uint8_t* nalu_start, const uint8_t* nalu_end, H264Context*
             /* check if the slice is the first VCL NAL of a primary coded picture */
             int is_first_VCL_NAL = detect_first_VCL_NAL_of_primary_coded_picture(slice_header, context->prev_slice_header);
 
-            Picture* picture;
-
-            /* get a picture from the H264 context to decode the slice data*/
-            err_code = get_picture_from_context(context, is_first_VCL_NAL, &picture);
+            err_code = decode_slice_nalu(context, slice_header, is_first_VCL_NAL, &rbsp_buffer, &rbsp_capacity, rbsp_reader);
             if (err_code < 0) {
-                err_code = ERR_INVALID_SLICE;
                 goto exit_flag;
             }
-
-            err_code = decode_slice(picture, rbsp_reader, slice_header);
-            if (err_code < 0) {
-                err_code = ERR_INVALID_SLICE;
-                goto exit_flag;
-            }
-
-            rbsp_slice_trailing_bits(rbsp_reader, context->active_pps->entropy_coding_mode_flag);
-
             break;
         }
 
@@ -213,6 +622,15 @@ int parse_nalu(const uint8_t* nalu_start, const uint8_t* nalu_end, H264Context*
             break;
         }
 
+        case NALU_END_OF_SEQUENCE:
+        case NALU_END_OF_STREAM:
+            /* the next picture is an IDR picture, so every decoded picture is output now instead of when it starts */
+            err_code = flush_context(context);
+            if (err_code < 0) {
+                goto exit_flag;
+            }
+            /* fall through */
+
         default: {
             NALUHeader* header = (NALUHeader*)malloc(sizeof(NALUHeader));
             if (!header) {
@@ -251,6 +669,13 @@ int add_sps_to_context(H264Context* context, SPS* sps) {
     }
 
     if (context->sps[sps->seq_parameter_set_id]) {
+        /* the queued slices refer to the parameter sets */
+        if (context->frame_threads) {
+            wait_for_queued_slices(context->frame_threads);
+        }
+        if (context->slice_threads) {
+            wait_for_slice_tasks(context->slice_threads);
+        }
         free_nalu(context->sps[sps->seq_parameter_set_id]);
         context->sps[sps->seq_parameter_set_id] = 0;
     }
@@ -265,6 +690,13 @@ int add_pps_to_context(H264Context* context, PPS* pps) {
     }
 
     if (context->pps[pps->pic_parameter_set_id]) {
+        /* the queued slices refer to the parameter sets */
+        if (context->frame_threads) {
+            wait_for_queued_slices(context->frame_threads);
+        }
+        if (context->slice_threads) {
+            wait_for_slice_tasks(context->slice_threads);
+        }
         free_nalu(context->pps[pps->pic_parameter_set_id]);
         context->pps[pps->pic_parameter_set_id] = 0;
     }
@@ -280,29 +712,15 @@ H264Context* create_context() {
     }
     memset(ctx, 0, sizeof(H264Context));
 
-    for (int i = 0; i < H264_MAX_SPS_COUNT; ++i) {
-        SPS* sps = (SPS*)malloc(sizeof(SPS));
-        if (!sps) {
-            free_context(ctx);
-            return 0;
-        }
-        memset(sps, 0, sizeof(SPS));
-        sps->seq_parameter_set_id = H264_INVALID_SPS_ID;
-
-        ctx->sps[i] = sps;
+    /* the pictures are charged to the budget of the context, it has no limit until set_memory_limit() */
+    if (init_memory_budget(&ctx->memory, 0) < 0) {
+        free(ctx);
+        return 0;
     }
+    ctx->picture_pool.budget = &ctx->memory;
 
-    for (int i = 0; i < H264_MAX_PPS_COUNT; ++i) {
-        PPS* pps = (PPS*)malloc(sizeof(PPS));
-        if (!pps) {
-            free_context(ctx);
-            return 0;
-        }
-        memset(pps, 0, sizeof(PPS));
-        pps->pic_parameter_set_id = H264_INVALID_PPS_ID;
-
-        ctx->pps[i] = pps;
-    }
+    /* the parameter sets are allocated as they are received, a slice referring to a parameter set which is not received fails with ERR_NO_PPS_PARSED or
+     * ERR_NO_SPS_PARSED */
 
     ctx->current_slice_header = (SliceHeader*)malloc(sizeof(SliceHeader));
     if (!ctx->current_slice_header) {
@@ -318,22 +736,46 @@ H264Context* create_context() {
     }
     memset(ctx->prev_slice_header, 0, sizeof(SliceHeader));
 
-    for (int i = 0; i < H264_MAX_DPB_FRAMES; ++i) {
-        Picture* pic = (Picture*)malloc(sizeof(Picture));
-        if (!pic) {
-            free_context(ctx);
-            return 0;
-        }
-        memset(pic, 0, sizeof(Picture));
-        ctx->gop[i] = pic;
+    /* the frame threads and the slice threads have their own scratch, this one is used by the slices decoded by the decoding thread */
+    ctx->mb_scratch = (MacroBlockScratch*)malloc(sizeof(MacroBlockScratch));
+    if (!ctx->mb_scratch) {
+        free_context(ctx);
+        return 0;
+    }
+    memset(ctx->mb_scratch, 0, sizeof(MacroBlockScratch));
+
+    /* the samples are reconstructed on the decoding thread until set_reconstruction_threads() */
+    ctx->reconstructor = create_reconstructor(1);
+    if (!ctx->reconstructor) {
+        free_context(ctx);
+        return 0;
     }
 
-    ctx->gop_curr_index = -1;
+    /* the table of the bit depth 8 until the bit depths of the active sps are known */
+    init_deblock_funcs(&ctx->deblock_funcs, 8, 8, get_cpu_flags());
+    ctx->deblock_bit_depths[0] = 8;
+    ctx->deblock_bit_depths[1] = 8;
+
+    ctx->frame_delivery = create_frame_delivery();
+    if (!ctx->frame_delivery) {
+        free_context(ctx);
+        return 0;
+    }
+    ctx->next_pts = H264_NO_TIMESTAMP;
+    ctx->next_dts = H264_NO_TIMESTAMP;
+
+    /* the pictures are allocated when the first picture of the active sps is decoded */
+    ctx->dpb.MaxLongTermFrameIdx = -1;
 
     return ctx;
 }
 
 void free_context(H264Context* context) {
+    /* the workers finish the pictures in flight before the parameter sets and the pictures are freed */
+    set_frame_threads(context, 0);
+    set_slice_threads(context, 0);
+    set_reconstruction_threads(context, H264_RECONSTRUCT_PARSE_ONLY);
+
     for (int i = 0; i < H264_MAX_SPS_COUNT; ++i) {
         if (context->sps[i]) {
             free_nalu(context->sps[i]);
@@ -361,12 +803,23 @@ void free_context(H264Context* context) {
         context->prev_slice_header = 0;
     }
 
-    for (int i = 0; i < H264_MAX_DPB_FRAMES; ++i) {
-        if (context->gop[i]) {
-            free_picture(context->gop[i]);
-            context->gop[i] = 0;
-        }
+    if (context->mb_scratch) {
+        free(context->mb_scratch);
+        context->mb_scratch = 0;
+    }
+
+    /* the worker is stopped before the pictures it may filter are freed */
+    set_deblock_thread_enabled(context, 0);
+
+    /* the delivery keeps the pictures of the frames held by the application, the pool frees those of the DPB, the output queue and the current picture */
+    if (context->frame_delivery) {
+        close_frame_delivery(context->frame_delivery, &context->picture_pool);
+        context->frame_delivery = 0;
     }
+    free_picture_pool(&context->picture_pool);
+    memset(&context->dpb, 0, sizeof(DecodedPictureBuffer));
+    context->current_picture = 0;
+    free_memory_budget(&context->memory);
 
     free(context);
 }
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "h264decoder/h264_cpu.h"
+
+int32_t get_cpu_flags() {
+    int32_t flags = 0;
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2")) {
+        flags |= H264_CPU_SSE2;
+    }
+
+    if (__builtin_cpu_supports("ssse3")) {
+        flags |= H264_CPU_SSSE3;
+    }
+
+    /* the AVX2 state is checked against XCR0 by the compiler runtime */
+    if (__builtin_cpu_supports("avx2")) {
+        flags |= H264_CPU_AVX2;
+    }
+#endif
+
+    return flags;
+}
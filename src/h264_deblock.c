@@ -0,0 +1,496 @@
+#include "h264decoder/h264_deblock.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_math.h"
+#include "h264decoder/h264_transform.h"
+
+/* alpha' of Table 8-16 indexed by indexA */
+static const uint8_t g_alpha_table[52] = {0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,   0,   0,   4,   4,   5,   6,   7,   8,   9,   10,  12,  13,
+                                          15, 17, 20, 22, 25, 28, 32, 36, 40, 45, 50, 56, 63, 71, 80, 90, 101, 113, 127, 144, 162, 182, 203, 226, 255, 255};
+
+/* beta' of Table 8-16 indexed by indexB */
+static const uint8_t g_beta_table[52] = {0, 0, 0, 0, 0, 0, 0, 0, 0,  0,  0,  0,  0,  0,  0,  0,  2,  2,  2,  3,  3,  3,  3,  4,  4,  4,
+                                         6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18};
+
+/* t'C0 of Table 8-17 indexed by indexA and bS - 1 */
+static const int8_t g_tc0_table[52][3] = {
+    {0, 0, 0},  {0, 0, 0},  {0, 0, 0},   {0, 0, 0},   {0, 0, 0},   {0, 0, 0},   {0, 0, 0},   {0, 0, 0},   {0, 0, 0},   {0, 0, 0},   {0, 0, 0},
+    {0, 0, 0},  {0, 0, 0},  {0, 0, 0},   {0, 0, 0},   {0, 0, 0},   {0, 0, 0},   {0, 0, 1},   {0, 0, 1},   {0, 0, 1},   {0, 0, 1},   {0, 1, 1},
+    {0, 1, 1},  {1, 1, 1},  {1, 1, 1},   {1, 1, 1},   {1, 1, 1},   {1, 1, 2},   {1, 1, 2},   {1, 1, 2},   {1, 1, 2},   {1, 2, 3},   {1, 2, 3},
+    {2, 2, 3},  {2, 2, 4},  {2, 3, 4},   {2, 3, 4},   {3, 3, 5},   {3, 4, 6},   {3, 4, 6},   {4, 5, 7},   {4, 5, 8},   {4, 6, 9},   {5, 7, 10},
+    {6, 8, 11}, {6, 8, 13}, {7, 10, 14}, {8, 11, 16}, {9, 12, 18}, {10, 13, 20}, {11, 15, 23}, {13, 17, 25},
+};
+
+/* luma4x4BlkIdx of the 4x4 blocks in raster block order */
+static const uint8_t g_raster_luma4x4_blk[16] = {0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15};
+
+#define BIT_DEPTH 8
+#include "h264_deblock_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 9
+#include "h264_deblock_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 10
+#include "h264_deblock_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 11
+#include "h264_deblock_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 12
+#include "h264_deblock_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 13
+#include "h264_deblock_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 14
+#include "h264_deblock_template.h"
+#undef BIT_DEPTH
+
+static inline int32_t mv_differs(const int16_t a[2], const int16_t b[2], int32_t mvy_limit) { return abs(a[0] - b[0]) >= 4 || abs(a[1] - b[1]) >= mvy_limit; }
+
+/**
+ * @brief check the conditions of bS equal to 1 of the blocks p and q, the reference pictures are compared as a set, so the prediction of p from list 0 and of q from
+ * list 1 of the same picture is compared crosswise
+ */
+static inline int32_t motion_differs(const DeblockCache* cache, int32_t p, int32_t q, int32_t mvy_limit) {
+    if (cache->ref[0][p] == cache->ref[0][q] && cache->ref[1][p] == cache->ref[1][q] && !mv_differs(cache->mv[0][p], cache->mv[0][q], mvy_limit) &&
+        !mv_differs(cache->mv[1][p], cache->mv[1][q], mvy_limit)) {
+        return 0;
+    }
+
+    if (cache->ref[0][p] == cache->ref[1][q] && cache->ref[1][p] == cache->ref[0][q] && !mv_differs(cache->mv[0][p], cache->mv[1][q], mvy_limit) &&
+        !mv_differs(cache->mv[1][p], cache->mv[0][q], mvy_limit)) {
+        return 0;
+    }
+
+    return 1;
+}
+
+static void boundary_strength_c(const DeblockCache* cache, int32_t mvy_limit, uint8_t bS[2][4][4]) {
+    for (int32_t dir = 0; dir < 2; dir++) {
+        for (int32_t edge = 0; edge < 4; edge++) {
+            for (int32_t seg = 0; seg < 4; seg++) {
+                int32_t q = dir ? MV_CACHE_IDX(seg, edge) : MV_CACHE_IDX(edge, seg);
+                int32_t p = dir ? q - 8 : q - 1;
+
+                if (cache->nnz[p] | cache->nnz[q]) {
+                    bS[dir][edge][seg] = 2;
+                } else {
+                    bS[dir][edge][seg] = (uint8_t)motion_differs(cache, p, q, mvy_limit);
+                }
+            }
+        }
+    }
+}
+
+void init_deblock_funcs(DeblockFuncs* funcs, int32_t BitDepthY, int32_t BitDepthC, int32_t cpu_flags) {
+    switch (BitDepthY) {
+        case 9:
+            init_deblock_funcs_9_c(funcs);
+            break;
+        case 10:
+            init_deblock_funcs_10_c(funcs);
+            break;
+        case 11:
+            init_deblock_funcs_11_c(funcs);
+            break;
+        case 12:
+            init_deblock_funcs_12_c(funcs);
+            break;
+        case 13:
+            init_deblock_funcs_13_c(funcs);
+            break;
+        case 14:
+            init_deblock_funcs_14_c(funcs);
+            break;
+        default:
+            init_deblock_funcs_8_c(funcs);
+            break;
+    }
+
+    switch (BitDepthC) {
+        case 9:
+            init_deblock_chroma_funcs_9_c(funcs);
+            break;
+        case 10:
+            init_deblock_chroma_funcs_10_c(funcs);
+            break;
+        case 11:
+            init_deblock_chroma_funcs_11_c(funcs);
+            break;
+        case 12:
+            init_deblock_chroma_funcs_12_c(funcs);
+            break;
+        case 13:
+            init_deblock_chroma_funcs_13_c(funcs);
+            break;
+        case 14:
+            init_deblock_chroma_funcs_14_c(funcs);
+            break;
+        default:
+            init_deblock_chroma_funcs_8_c(funcs);
+            break;
+    }
+    funcs->boundary_strength = boundary_strength_c;
+
+    /* the SIMD kernels are written for the 8-bit samples */
+    if (cpu_flags && BitDepthY == 8 && BitDepthC == 8) {
+        init_deblock_funcs_x86(funcs, cpu_flags);
+    }
+}
+
+/**
+ * @brief check whether the edges of the macroblock are filtered as the edges of an intra macroblock, the macroblocks of SP and SI slices included
+ */
+static inline int32_t is_intra_edge(FrameOrField* picture, int32_t mbAddr) {
+    return mb_is_intra(&picture->mb_list[mbAddr]) || picture->slice_deblock_params[picture->mb_slice_ids[mbAddr]].is_switching_slice;
+}
+
+/**
+ * @brief the identifier of the reference picture referred by the reference index, the reference indices of the entries which are not set yet are assumed to refer to
+ * distinct pictures
+ */
+static inline int8_t ref_pic_id(const RefPicLists* lists, int32_t list, int32_t refIdx) {
+    if (refIdx < 0) {
+        return -1;
+    }
+    const FrameOrField* ff = lists->entries[list][refIdx].ff;
+    return (int8_t)(ff ? ff->ref_pic_id : 64 + list * H264_MAX_REFS + refIdx);
+}
+
+/**
+ * @brief load the motion data and the non-zero coefficient mask of the blocks of a macroblock into the cache
+ *
+ * @param blocks the mask of the raster block indices to load
+ * @param offset the offset of the block ( 0, 0 ) of the macroblock in the cache
+ */
+static void load_deblock_blocks(DeblockCache* cache, FrameOrField* picture, int32_t mbAddr, int32_t ChromaArrayType, uint32_t blocks, int32_t offset) {
+    const MacroBlock* mb = &picture->mb_list[mbAddr];
+    const RefPicLists* lists = &picture->slice_ref_lists[picture->mb_slice_ids[mbAddr]];
+    uint32_t coded = mb->coded_block_flags & H264_CBF_LUMA_MASK;
+
+    /* the residual of the Cb and Cr blocks of ChromaArrayType equal to 3 is coded like luma */
+    if (ChromaArrayType == 3) {
+        coded |= (mb->coded_block_flags_444 | (mb->coded_block_flags_444 >> 16)) & H264_CBF_LUMA_MASK;
+    }
+
+    for (int32_t blk = 0; blk < 16; blk++) {
+        if (!((blocks >> blk) & 1)) {
+            continue;
+        }
+
+        int32_t idx = offset + (blk >> 2) * 8 + (blk & 3);
+        cache->nnz[idx] = (uint8_t)((coded >> g_raster_luma4x4_blk[blk]) & 1);
+
+        for (int32_t list = 0; list < 2; list++) {
+            int32_t refIdx = picture->ref_idxs[list][mbAddr * 16 + blk];
+            cache->ref[list][idx] = ref_pic_id(lists, list, refIdx);
+            if (refIdx >= 0) {
+                cache->mv[list][idx][0] = picture->mvs[list][(mbAddr * 16 + blk) * 2];
+                cache->mv[list][idx][1] = picture->mvs[list][(mbAddr * 16 + blk) * 2 + 1];
+            } else {
+                cache->mv[list][idx][0] = 0;
+                cache->mv[list][idx][1] = 0;
+            }
+        }
+    }
+}
+
+/**
+ * @brief qPp of the luma samples of a macroblock, 0 for I_PCM
+ */
+static inline int32_t deblock_luma_qp(FrameOrField* picture, int32_t mbAddr) { return picture->mb_type_names[mbAddr] == I_PCM ? 0 : picture->mb_qps[mbAddr]; }
+
+/**
+ * @brief the thresholds of an edge of the average quantisation parameter
+ * @see 8.7.2.2 Derivation process for the thresholds for each block edge
+ */
+typedef struct {
+    int32_t alpha;
+    int32_t beta;
+    int32_t indexA;
+} EdgeThresholds;
+
+static inline EdgeThresholds derivation_for_thresholds(const SliceDeblockParams* params, int32_t qPp, int32_t qPq, int32_t BitDepth) {
+    int32_t qPav = (qPp + qPq + 1) >> 1;
+    EdgeThresholds t;
+    t.indexA = clip3(0, 51, qPav + params->FilterOffsetA);
+    /* equations 8-456 and 8-457 */
+    t.alpha = g_alpha_table[t.indexA] * (1 << (BitDepth - 8));
+    t.beta = g_beta_table[clip3(0, 51, qPav + params->FilterOffsetB)] * (1 << (BitDepth - 8));
+    return t;
+}
+
+/**
+ * @brief filter an edge of 16 luma samples, or of the Cb or Cr samples with the size of the luma edge
+ *
+ * @param kernel the kernel of the edge direction, DeblockFuncs::luma or DeblockFuncs::chroma444
+ * @param intra_kernel the kernel of the edge direction for bS equal to 4
+ * @param bS the bS of the 4 segments
+ */
+static inline void filter_luma_edge(deblock_func kernel, deblock_intra_func intra_kernel, uint8_t* pix, int32_t stride, const uint8_t bS[4], EdgeThresholds t) {
+    if (!t.alpha || !t.beta) {
+        return;
+    }
+
+    /* bS equal to 4 is derived for the whole macroblock edge */
+    if (bS[0] == 4) {
+        intra_kernel(pix, stride, t.alpha, t.beta);
+        return;
+    }
+
+    int8_t tc0[4];
+    for (int32_t seg = 0; seg < 4; seg++) {
+        tc0[seg] = (int8_t)(bS[seg] ? g_tc0_table[t.indexA][bS[seg] - 1] : -1);
+    }
+    kernel(pix, stride, t.alpha, t.beta, tc0);
+}
+
+/**
+ * @brief filter an edge of 8 chroma samples with chromaStyleFilteringFlag equal to 1
+ *
+ * @param bS the bS of the 4 segments of 2 samples
+ */
+static inline void filter_chroma_edge(const DeblockFuncs* funcs, int32_t dir, uint8_t* pix, int32_t stride, const uint8_t bS[4], EdgeThresholds t) {
+    if (!t.alpha || !t.beta) {
+        return;
+    }
+
+    if (bS[0] == 4) {
+        funcs->chroma_intra[dir](pix, stride, t.alpha, t.beta);
+        return;
+    }
+
+    int8_t tc0[4];
+    for (int32_t seg = 0; seg < 4; seg++) {
+        tc0[seg] = (int8_t)(bS[seg] ? g_tc0_table[t.indexA][bS[seg] - 1] : -1);
+    }
+    funcs->chroma[dir](pix, stride, t.alpha, t.beta, tc0);
+}
+
+static inline int32_t edge_is_filtered(const uint8_t bS[4]) { return (bS[0] | bS[1] | bS[2] | bS[3]) != 0; }
+
+/**
+ * @brief the address of the sample ( x, y ) of a plane, the samples of the bit depths greater than 8 are 2 bytes
+ */
+static inline uint8_t* sample_addr(uint8_t* plane, int32_t stride, int32_t x, int32_t y, int32_t BitDepth) {
+    return plane + (((ptrdiff_t)y * stride + x) << (BitDepth > 8));
+}
+
+int deblock_macroblock(const DeblockFuncs* funcs, FrameOrField* picture, const DeblockPlanes* planes, int32_t CurrMbAddr) {
+    int32_t slice_num = picture->mb_slice_ids[CurrMbAddr];
+    const SliceDeblockParams* params = &picture->slice_deblock_params[slice_num];
+
+    if (params->disable_deblocking_filter_idc == 1) {
+        return ERR_OK;
+    }
+
+    /* the mixed edges of the frame and field macroblock pairs are not supported */
+    if (params->MbaffFrameFlag) {
+        return ERR_NOT_IMPL;
+    }
+
+    int32_t PicWidthInMbs = planes->PicWidthInMbs;
+    int32_t mb_x = CurrMbAddr % PicWidthInMbs;
+    int32_t mb_y = CurrMbAddr / PicWidthInMbs;
+    int32_t mbAddrA = CurrMbAddr - 1;
+    int32_t mbAddrB = CurrMbAddr - PicWidthInMbs;
+
+    /* filterLeftMbEdgeFlag and filterTopMbEdgeFlag, the edges of the slice are not filtered for disable_deblocking_filter_idc equal to 2 */
+    int32_t filter_left = mb_x > 0 && picture->mb_slice_ids[mbAddrA] >= 0 && (params->disable_deblocking_filter_idc != 2 || picture->mb_slice_ids[mbAddrA] == slice_num);
+    int32_t filter_top = mb_y > 0 && picture->mb_slice_ids[mbAddrB] >= 0 && (params->disable_deblocking_filter_idc != 2 || picture->mb_slice_ids[mbAddrB] == slice_num);
+
+    const MacroBlock* mb = &picture->mb_list[CurrMbAddr];
+    int32_t transform_size_8x8_flag = mb->transform_size_8x8_flag;
+    int32_t field_pic_flag = params->field_pic_flag;
+
+    /* 8.7.2.1, the intra macroblock edges have bS equal to 4 except the horizontal edges of the fields, the inner edges of the intra macroblocks have bS equal to 3 */
+    uint8_t bS[2][4][4];
+    if (is_intra_edge(picture, CurrMbAddr)) {
+        memset(bS, 3, sizeof(bS));
+        memset(bS[0][0], 4, 4);
+        memset(bS[1][0], field_pic_flag ? 3 : 4, 4);
+    } else {
+        DeblockCache cache;
+        load_deblock_blocks(&cache, picture, CurrMbAddr, planes->ChromaArrayType, 0xFFFF, MV_CACHE_IDX(0, 0));
+        /* the right column of the left macroblock and the bottom row of the macroblock above */
+        if (filter_left) {
+            load_deblock_blocks(&cache, picture, mbAddrA, planes->ChromaArrayType, 0x8888, MV_CACHE_IDX(-4, 0));
+        }
+        if (filter_top) {
+            load_deblock_blocks(&cache, picture, mbAddrB, planes->ChromaArrayType, 0xF000, MV_CACHE_IDX(0, -4));
+        }
+
+        /* the blocks of the macroblocks which are not loaded give bS of the edges which are not filtered */
+        if (!filter_left) {
+            for (int32_t y = 0; y < 4; y++) {
+                int32_t idx = MV_CACHE_IDX(-1, y);
+                cache.nnz[idx] = 0;
+                cache.ref[0][idx] = cache.ref[1][idx] = -1;
+                memset(cache.mv[0][idx], 0, sizeof(cache.mv[0][idx]));
+                memset(cache.mv[1][idx], 0, sizeof(cache.mv[1][idx]));
+            }
+        }
+        if (!filter_top) {
+            int32_t idx = MV_CACHE_IDX(0, -1);
+            memset(&cache.nnz[idx], 0, 4);
+            memset(&cache.ref[0][idx], 0xFF, 4);
+            memset(&cache.ref[1][idx], 0xFF, 4);
+            memset(cache.mv[0][idx], 0, 4 * sizeof(cache.mv[0][idx]));
+            memset(cache.mv[1][idx], 0, 4 * sizeof(cache.mv[1][idx]));
+        }
+
+        funcs->boundary_strength(&cache, field_pic_flag ? 2 : 4, bS);
+
+        if (filter_left && is_intra_edge(picture, mbAddrA)) {
+            memset(bS[0][0], 4, 4);
+        }
+        if (filter_top && is_intra_edge(picture, mbAddrB)) {
+            memset(bS[1][0], field_pic_flag ? 3 : 4, 4);
+        }
+    }
+
+    if (!filter_left) {
+        memset(bS[0][0], 0, 4);
+    }
+    if (!filter_top) {
+        memset(bS[1][0], 0, 4);
+    }
+
+    /* qPp of the macroblocks left of and above the current macroblock and qPq of the current macroblock */
+    int32_t qp[3] = {deblock_luma_qp(picture, CurrMbAddr), filter_left ? deblock_luma_qp(picture, mbAddrA) : 0, filter_top ? deblock_luma_qp(picture, mbAddrB) : 0};
+
+    /* 8.7.1, the vertical edges from left to right, then the horizontal edges from top to bottom. the luma edges 1 and 3 are not transform block edges of the 8x8 transform */
+    int32_t luma_stride = planes->strides[0];
+    int32_t BitDepthY = planes->BitDepthY;
+    uint8_t* luma = sample_addr(planes->planes[0], luma_stride, mb_x * 16, mb_y * 16, BitDepthY);
+
+    for (int32_t dir = 0; dir < 2; dir++) {
+        for (int32_t edge = 0; edge < 4; edge++) {
+            if ((transform_size_8x8_flag && (edge & 1)) || !edge_is_filtered(bS[dir][edge])) {
+                continue;
+            }
+            EdgeThresholds t = derivation_for_thresholds(params, edge ? qp[0] : qp[1 + dir], qp[0], BitDepthY);
+            uint8_t* pix = dir ? sample_addr(luma, luma_stride, 0, edge * 4, BitDepthY) : sample_addr(luma, luma_stride, edge * 4, 0, BitDepthY);
+            filter_luma_edge(funcs->luma[dir], funcs->luma_intra[dir], pix, luma_stride, bS[dir][edge], t);
+        }
+    }
+
+    int32_t ChromaArrayType = planes->ChromaArrayType;
+    if (ChromaArrayType == 0) {
+        return ERR_OK;
+    }
+
+    /* QPC of 8.7.2.2 is derived with the lower bound -QpBdOffsetC of qPI */
+    int32_t BitDepthC = planes->BitDepthC;
+    int32_t QpBdOffsetC = 6 * (BitDepthC - 8);
+
+    for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+        int32_t offset = params->chroma_qp_index_offset[iCbCr];
+        int32_t qpc[3];
+        for (int32_t i = 0; i < 3; i++) {
+            qpc[i] = derivation_for_chroma_qp(qp[i], offset, QpBdOffsetC) - QpBdOffsetC;
+        }
+
+        int32_t stride = planes->strides[1 + iCbCr];
+
+        /* the Cb and Cr samples of ChromaArrayType equal to 3 are filtered like the luma samples, chromaStyleFilteringFlag is 0 */
+        if (ChromaArrayType == 3) {
+            uint8_t* chroma = sample_addr(planes->planes[1 + iCbCr], stride, mb_x * 16, mb_y * 16, BitDepthC);
+            for (int32_t dir = 0; dir < 2; dir++) {
+                for (int32_t edge = 0; edge < 4; edge++) {
+                    if ((transform_size_8x8_flag && (edge & 1)) || !edge_is_filtered(bS[dir][edge])) {
+                        continue;
+                    }
+                    EdgeThresholds t = derivation_for_thresholds(params, edge ? qpc[0] : qpc[1 + dir], qpc[0], BitDepthC);
+                    uint8_t* pix = dir ? sample_addr(chroma, stride, 0, edge * 4, BitDepthC) : sample_addr(chroma, stride, edge * 4, 0, BitDepthC);
+                    filter_luma_edge(funcs->chroma444[dir], funcs->chroma444_intra[dir], pix, stride, bS[dir][edge], t);
+                }
+            }
+            continue;
+        }
+
+        /* the chroma edges take bS of the luma edges at the corresponding luma sample positions */
+        int32_t MbHeightC = ChromaArrayType == 1 ? 8 : 16;
+        uint8_t* chroma = sample_addr(planes->planes[1 + iCbCr], stride, mb_x * 8, mb_y * MbHeightC, BitDepthC);
+
+        for (int32_t edge = 0; edge < 2; edge++) {
+            const uint8_t* edge_bS = bS[0][edge * 2];
+            if (!edge_is_filtered(edge_bS)) {
+                continue;
+            }
+            EdgeThresholds t = derivation_for_thresholds(params, edge ? qpc[0] : qpc[1], qpc[0], BitDepthC);
+            uint8_t* pix = sample_addr(chroma, stride, edge * 4, 0, BitDepthC);
+            if (ChromaArrayType == 1) {
+                filter_chroma_edge(funcs, 0, pix, stride, edge_bS, t);
+            } else {
+                /* the 16 lines of ChromaArrayType equal to 2 are 4 lines per segment */
+                const uint8_t upper[4] = {edge_bS[0], edge_bS[0], edge_bS[1], edge_bS[1]};
+                const uint8_t lower[4] = {edge_bS[2], edge_bS[2], edge_bS[3], edge_bS[3]};
+                filter_chroma_edge(funcs, 0, pix, stride, upper, t);
+                filter_chroma_edge(funcs, 0, sample_addr(pix, stride, 0, 8, BitDepthC), stride, lower, t);
+            }
+        }
+
+        int32_t num_edges = MbHeightC / 4;
+        for (int32_t edge = 0; edge < num_edges; edge++) {
+            const uint8_t* edge_bS = bS[1][ChromaArrayType == 1 ? edge * 2 : edge];
+            if (!edge_is_filtered(edge_bS)) {
+                continue;
+            }
+            EdgeThresholds t = derivation_for_thresholds(params, edge ? qpc[0] : qpc[2], qpc[0], BitDepthC);
+            filter_chroma_edge(funcs, 1, sample_addr(chroma, stride, 0, edge * 4, BitDepthC), stride, edge_bS, t);
+        }
+    }
+
+    return ERR_OK;
+}
+
+int deblock_macroblock_row(const DeblockFuncs* funcs, FrameOrField* picture, const DeblockPlanes* planes, int32_t mb_row) {
+    int32_t first = mb_row * planes->PicWidthInMbs;
+
+    for (int32_t mbAddr = first; mbAddr < first + planes->PicWidthInMbs; mbAddr++) {
+        /* the macroblocks of the missing slices are left as they are */
+        if (picture->mb_slice_ids[mbAddr] < 0) {
+            continue;
+        }
+
+        int err_code = deblock_macroblock(funcs, picture, planes, mbAddr);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    return ERR_OK;
+}
+
+int deblock_picture(const DeblockFuncs* funcs, FrameOrField* picture, const DeblockPlanes* planes) {
+    int32_t PicHeightInMbs = picture->mb_list_len / planes->PicWidthInMbs;
+
+    for (int32_t mb_row = 0; mb_row < PicHeightInMbs; mb_row++) {
+        int err_code = deblock_macroblock_row(funcs, picture, planes, mb_row);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    return ERR_OK;
+}
+
+void init_deblock_planes(DeblockPlanes* planes, const FrameOrField* ff, const SPS* sps) {
+    memset(planes, 0, sizeof(DeblockPlanes));
+
+    for (int32_t i = 0; i < ff->plane_count; i++) {
+        planes->planes[i] = ff->planes[i].data;
+        planes->strides[i] = ff->planes[i].stride;
+    }
+
+    planes->PicWidthInMbs = (int32_t)sps->PicWidthInMbs;
+    planes->ChromaArrayType = (int32_t)sps->ChromaArrayType;
+    planes->BitDepthY = (int32_t)sps->BitDepthY;
+    planes->BitDepthC = (int32_t)sps->BitDepthC;
+}
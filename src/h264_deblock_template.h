@@ -0,0 +1,122 @@
+/*
+ * the scalar deblocking filter kernels of one bit depth, included by h264_deblock.c for every bit depth with BIT_DEPTH defined. the thresholds alpha and beta are
+ * scaled to the bit depth by the caller, tC0 is scaled by the kernels
+ */
+
+#include "h264_bit_depth_template.h"
+
+/**
+ * @brief filter the lines across an edge with bS less than 4, equations 8-458 to 8-475
+ *
+ * @param xstep the step from p0 to q0
+ * @param ystep the step from one line to the next
+ * @param lines the number of lines of a tC0 segment
+ * @param chroma_style chromaStyleFilteringFlag
+ */
+static inline void FUNCC(filter_normal)(pixel* pix, int32_t xstep, int32_t ystep, int32_t lines, int32_t alpha, int32_t beta, const int8_t tc0[4], int32_t chroma_style) {
+    for (int32_t i = 0; i < 4 * lines; i++, pix += ystep) {
+        if (tc0[i / lines] < 0) {
+            continue;
+        }
+        /* tC0 of equation 8-462 is scaled to the bit depth */
+        int32_t tC0 = tc0[i / lines] * (1 << (BIT_DEPTH - 8));
+
+        int32_t p0 = pix[-xstep], p1 = pix[-2 * xstep];
+        int32_t q0 = pix[0], q1 = pix[xstep];
+        if (abs(p0 - q0) >= alpha || abs(p1 - p0) >= beta || abs(q1 - q0) >= beta) {
+            continue;
+        }
+
+        if (chroma_style) {
+            int32_t tC = tC0 + 1;
+            int32_t delta = clip3(-tC, tC, (((q0 - p0) * 4) + (p1 - q1) + 4) >> 3);
+            pix[-xstep] = (pixel)CLIP1(p0 + delta);
+            pix[0] = (pixel)CLIP1(q0 - delta);
+            continue;
+        }
+
+        int32_t p2 = pix[-3 * xstep], q2 = pix[2 * xstep];
+        int32_t ap = abs(p2 - p0) < beta;
+        int32_t aq = abs(q2 - q0) < beta;
+        int32_t tC = tC0 + ap + aq;
+        int32_t delta = clip3(-tC, tC, (((q0 - p0) * 4) + (p1 - q1) + 4) >> 3);
+
+        if (ap) {
+            pix[-2 * xstep] = (pixel)(p1 + clip3(-tC0, tC0, (p2 + ((p0 + q0 + 1) >> 1) - (p1 * 2)) >> 1));
+        }
+        if (aq) {
+            pix[xstep] = (pixel)(q1 + clip3(-tC0, tC0, (q2 + ((p0 + q0 + 1) >> 1) - (q1 * 2)) >> 1));
+        }
+        pix[-xstep] = (pixel)CLIP1(p0 + delta);
+        pix[0] = (pixel)CLIP1(q0 - delta);
+    }
+}
+
+/**
+ * @brief filter the lines across an edge with bS equal to 4, equations 8-476 to 8-490
+ *
+ * @param lines the number of lines
+ */
+static inline void FUNCC(filter_intra)(pixel* pix, int32_t xstep, int32_t ystep, int32_t lines, int32_t alpha, int32_t beta, int32_t chroma_style) {
+    for (int32_t i = 0; i < lines; i++, pix += ystep) {
+        int32_t p0 = pix[-xstep], p1 = pix[-2 * xstep];
+        int32_t q0 = pix[0], q1 = pix[xstep];
+        if (abs(p0 - q0) >= alpha || abs(p1 - p0) >= beta || abs(q1 - q0) >= beta) {
+            continue;
+        }
+
+        if (chroma_style) {
+            pix[-xstep] = (pixel)((2 * p1 + p0 + q1 + 2) >> 2);
+            pix[0] = (pixel)((2 * q1 + q0 + p1 + 2) >> 2);
+            continue;
+        }
+
+        int32_t p2 = pix[-3 * xstep], q2 = pix[2 * xstep];
+        int32_t strong = abs(p0 - q0) < ((alpha >> 2) + 2);
+
+        if (strong && abs(p2 - p0) < beta) {
+            int32_t p3 = pix[-4 * xstep];
+            pix[-xstep] = (pixel)((p2 + 2 * p1 + 2 * p0 + 2 * q0 + q1 + 4) >> 3);
+            pix[-2 * xstep] = (pixel)((p2 + p1 + p0 + q0 + 2) >> 2);
+            pix[-3 * xstep] = (pixel)((2 * p3 + 3 * p2 + p1 + p0 + q0 + 4) >> 3);
+        } else {
+            pix[-xstep] = (pixel)((2 * p1 + p0 + q1 + 2) >> 2);
+        }
+
+        if (strong && abs(q2 - q0) < beta) {
+            int32_t q3 = pix[3 * xstep];
+            pix[0] = (pixel)((p1 + 2 * p0 + 2 * q0 + 2 * q1 + q2 + 4) >> 3);
+            pix[xstep] = (pixel)((p0 + q0 + q1 + q2 + 2) >> 2);
+            pix[2 * xstep] = (pixel)((2 * q3 + 3 * q2 + q1 + q0 + p0 + 4) >> 3);
+        } else {
+            pix[0] = (pixel)((2 * q1 + q0 + p1 + 2) >> 2);
+        }
+    }
+}
+
+static void FUNCC(luma_v)(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta, const int8_t tc0[4]) { FUNCC(filter_normal)((pixel*)pix, 1, stride, 4, alpha, beta, tc0, 0); }
+static void FUNCC(luma_h)(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta, const int8_t tc0[4]) { FUNCC(filter_normal)((pixel*)pix, stride, 1, 4, alpha, beta, tc0, 0); }
+static void FUNCC(luma_intra_v)(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta) { FUNCC(filter_intra)((pixel*)pix, 1, stride, 16, alpha, beta, 0); }
+static void FUNCC(luma_intra_h)(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta) { FUNCC(filter_intra)((pixel*)pix, stride, 1, 16, alpha, beta, 0); }
+static void FUNCC(chroma_v)(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta, const int8_t tc0[4]) { FUNCC(filter_normal)((pixel*)pix, 1, stride, 2, alpha, beta, tc0, 1); }
+static void FUNCC(chroma_h)(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta, const int8_t tc0[4]) { FUNCC(filter_normal)((pixel*)pix, stride, 1, 2, alpha, beta, tc0, 1); }
+static void FUNCC(chroma_intra_v)(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta) { FUNCC(filter_intra)((pixel*)pix, 1, stride, 8, alpha, beta, 1); }
+static void FUNCC(chroma_intra_h)(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta) { FUNCC(filter_intra)((pixel*)pix, stride, 1, 8, alpha, beta, 1); }
+
+static void FUNCC(init_deblock_funcs)(DeblockFuncs* funcs) {
+    funcs->luma[0] = FUNCC(luma_v);
+    funcs->luma[1] = FUNCC(luma_h);
+    funcs->luma_intra[0] = FUNCC(luma_intra_v);
+    funcs->luma_intra[1] = FUNCC(luma_intra_h);
+}
+
+static void FUNCC(init_deblock_chroma_funcs)(DeblockFuncs* funcs) {
+    funcs->chroma[0] = FUNCC(chroma_v);
+    funcs->chroma[1] = FUNCC(chroma_h);
+    funcs->chroma_intra[0] = FUNCC(chroma_intra_v);
+    funcs->chroma_intra[1] = FUNCC(chroma_intra_h);
+    funcs->chroma444[0] = FUNCC(luma_v);
+    funcs->chroma444[1] = FUNCC(luma_h);
+    funcs->chroma444_intra[0] = FUNCC(luma_intra_v);
+    funcs->chroma444_intra[1] = FUNCC(luma_intra_h);
+}
@@ -0,0 +1,145 @@
+#include "h264decoder/h264_deblock_thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief the next row can be filtered if the row below it is reconstructed, the last row once the whole picture is reconstructed
+ */
+static inline int32_t next_row_ready(const DeblockThread* thread) {
+    if (!thread->picture || thread->deblocked_rows >= thread->PicHeightInMbs) {
+        return 0;
+    }
+    return thread->reconstructed_rows >= thread->deblocked_rows + 2 || thread->reconstructed_rows >= thread->PicHeightInMbs;
+}
+
+static void* deblock_thread_main(void* arg) {
+    DeblockThread* thread = (DeblockThread*)arg;
+
+    pthread_mutex_lock(&thread->mutex);
+    while (!thread->quit) {
+        if (!next_row_ready(thread)) {
+            pthread_cond_wait(&thread->cond, &thread->mutex);
+            continue;
+        }
+
+        /* the reconstruction never writes the rows above the reported ones, so the row is filtered without the lock */
+        int32_t mb_row = thread->deblocked_rows;
+        pthread_mutex_unlock(&thread->mutex);
+
+        int err_code = ERR_OK;
+        if (thread->err_code == ERR_OK) {
+            err_code = deblock_macroblock_row(thread->funcs, thread->picture, &thread->planes, mb_row);
+        }
+
+        pthread_mutex_lock(&thread->mutex);
+        if (err_code < 0 && thread->err_code == ERR_OK) {
+            thread->err_code = err_code;
+        }
+        thread->deblocked_rows = mb_row + 1;
+        pthread_cond_broadcast(&thread->cond);
+    }
+    pthread_mutex_unlock(&thread->mutex);
+
+    return 0;
+}
+
+DeblockThread* create_deblock_thread(const DeblockFuncs* funcs) {
+    DeblockThread* thread = (DeblockThread*)malloc(sizeof(DeblockThread));
+    if (!thread) {
+        return 0;
+    }
+    memset(thread, 0, sizeof(DeblockThread));
+    thread->funcs = funcs;
+
+    if (pthread_mutex_init(&thread->mutex, 0)) {
+        free(thread);
+        return 0;
+    }
+    if (pthread_cond_init(&thread->cond, 0)) {
+        pthread_mutex_destroy(&thread->mutex);
+        free(thread);
+        return 0;
+    }
+    if (pthread_create(&thread->thread, 0, deblock_thread_main, thread)) {
+        pthread_cond_destroy(&thread->cond);
+        pthread_mutex_destroy(&thread->mutex);
+        free(thread);
+        return 0;
+    }
+
+    return thread;
+}
+
+void free_deblock_thread(DeblockThread* thread) {
+    pthread_mutex_lock(&thread->mutex);
+    thread->quit = 1;
+    pthread_cond_broadcast(&thread->cond);
+    pthread_mutex_unlock(&thread->mutex);
+
+    pthread_join(thread->thread, 0);
+    pthread_cond_destroy(&thread->cond);
+    pthread_mutex_destroy(&thread->mutex);
+    free(thread);
+}
+
+int start_deblock_picture(DeblockThread* thread, FrameOrField* picture, const DeblockPlanes* planes) {
+    if (planes->PicWidthInMbs <= 0 || picture->mb_list_len % planes->PicWidthInMbs) {
+        return ERR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&thread->mutex);
+    if (thread->picture && thread->deblocked_rows < thread->PicHeightInMbs) {
+        pthread_mutex_unlock(&thread->mutex);
+        return ERR_INVALID_PARAM;
+    }
+
+    thread->picture = picture;
+    thread->planes = *planes;
+    thread->PicHeightInMbs = picture->mb_list_len / planes->PicWidthInMbs;
+    thread->reconstructed_rows = 0;
+    thread->deblocked_rows = 0;
+    thread->err_code = ERR_OK;
+    pthread_mutex_unlock(&thread->mutex);
+
+    return ERR_OK;
+}
+
+void report_reconstructed_rows(DeblockThread* thread, int32_t rows) {
+    pthread_mutex_lock(&thread->mutex);
+    if (rows > thread->reconstructed_rows) {
+        thread->reconstructed_rows = rows;
+        if (next_row_ready(thread)) {
+            pthread_cond_broadcast(&thread->cond);
+        }
+    }
+    pthread_mutex_unlock(&thread->mutex);
+}
+
+int32_t get_deblocked_rows(DeblockThread* thread) {
+    pthread_mutex_lock(&thread->mutex);
+    int32_t rows = thread->deblocked_rows;
+    pthread_mutex_unlock(&thread->mutex);
+
+    return rows;
+}
+
+int finish_deblock_picture(DeblockThread* thread) {
+    pthread_mutex_lock(&thread->mutex);
+    if (!thread->picture) {
+        pthread_mutex_unlock(&thread->mutex);
+        return ERR_OK;
+    }
+
+    thread->reconstructed_rows = thread->PicHeightInMbs;
+    pthread_cond_broadcast(&thread->cond);
+    while (thread->deblocked_rows < thread->PicHeightInMbs) {
+        pthread_cond_wait(&thread->cond, &thread->mutex);
+    }
+
+    int err_code = thread->err_code;
+    thread->picture = 0;
+    pthread_mutex_unlock(&thread->mutex);
+
+    return err_code;
+}
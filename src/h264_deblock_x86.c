@@ -0,0 +1,448 @@
+#include "h264decoder/h264_deblock.h"
+
+#include <string.h>
+
+#include "h264decoder/h264_cpu.h"
+
+/**
+ * the SSE2 deblocking kernels. the 16 lines of a luma edge are filtered at once, a register holds one sample position across the edge, p3 to q3, of all the lines.
+ * the vertical edges are transposed to this layout and back. the filters are computed on 16-bit lanes, the lines of a negative tC0 and the lines which fail the
+ * thresholds of equation 8-460 are masked. boundary_strength computes the 4 segments of an edge in the 32-bit lanes of a register.
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+
+static inline int32_t load32(const uint8_t* p) {
+    int32_t v = 0;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline TARGET_SSE2 __m128i select_sse2(__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+static inline TARGET_SSE2 __m128i abs_diff_epi16_sse2(__m128i a, __m128i b) {
+    __m128i d = _mm_sub_epi16(a, b);
+    return _mm_max_epi16(d, _mm_sub_epi16(_mm_setzero_si128(), d));
+}
+
+/**
+ * @brief the mask of the lines where | p0 - q0 | < alpha, | p1 - p0 | < beta and | q1 - q0 | < beta, equation 8-460
+ */
+static inline TARGET_SSE2 __m128i filter_mask_sse2(__m128i p1, __m128i p0, __m128i q0, __m128i q1, __m128i alpha, __m128i beta) {
+    __m128i mask = _mm_cmplt_epi16(abs_diff_epi16_sse2(p0, q0), alpha);
+    mask = _mm_and_si128(mask, _mm_cmplt_epi16(abs_diff_epi16_sse2(p1, p0), beta));
+    return _mm_and_si128(mask, _mm_cmplt_epi16(abs_diff_epi16_sse2(q1, q0), beta));
+}
+
+/**
+ * @brief the filter of bS less than 4 of 8 lines, r holds p3 to q3 as 16-bit lanes and is updated in place
+ * @see 8.7.2.3 Filtering process for edges with bS less than 4
+ *
+ * @param tc0 tC0 of the lines, negative for the lines which are not filtered
+ */
+static inline TARGET_SSE2 void filter_normal_epi16_sse2(__m128i r[8], __m128i alpha, __m128i beta, __m128i tc0, int32_t chroma_style) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i p2 = r[1], p1 = r[2], p0 = r[3], q0 = r[4], q1 = r[5], q2 = r[6];
+
+    __m128i mask = _mm_and_si128(filter_mask_sse2(p1, p0, q0, q1, alpha, beta), _mm_cmpgt_epi16(tc0, _mm_set1_epi16(-1)));
+    __m128i tc;
+    __m128i ap = zero, aq = zero;
+
+    if (chroma_style) {
+        tc = _mm_add_epi16(tc0, _mm_set1_epi16(1));
+    } else {
+        ap = _mm_and_si128(mask, _mm_cmplt_epi16(abs_diff_epi16_sse2(p2, p0), beta));
+        aq = _mm_and_si128(mask, _mm_cmplt_epi16(abs_diff_epi16_sse2(q2, q0), beta));
+        /* the masks are -1, so tC = tC0 + ap + aq */
+        tc = _mm_sub_epi16(_mm_sub_epi16(tc0, ap), aq);
+    }
+
+    /* equation 8-467, delta = Clip3( -tC, tC, ( ( ( q0 - p0 ) << 2 ) + ( p1 - q1 ) + 4 ) >> 3 ) */
+    __m128i delta = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(q0, p0), 2), _mm_sub_epi16(p1, q1));
+    delta = _mm_srai_epi16(_mm_add_epi16(delta, _mm_set1_epi16(4)), 3);
+    delta = _mm_min_epi16(_mm_max_epi16(delta, _mm_sub_epi16(zero, tc)), tc);
+    delta = _mm_and_si128(delta, mask);
+
+    if (!chroma_style) {
+        /* equations 8-471 and 8-473 */
+        __m128i avg = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(p0, q0), _mm_set1_epi16(1)), 1);
+        __m128i neg_tc0 = _mm_sub_epi16(zero, tc0);
+        __m128i dp1 = _mm_srai_epi16(_mm_sub_epi16(_mm_add_epi16(p2, avg), _mm_slli_epi16(p1, 1)), 1);
+        __m128i dq1 = _mm_srai_epi16(_mm_sub_epi16(_mm_add_epi16(q2, avg), _mm_slli_epi16(q1, 1)), 1);
+        dp1 = _mm_and_si128(_mm_min_epi16(_mm_max_epi16(dp1, neg_tc0), tc0), ap);
+        dq1 = _mm_and_si128(_mm_min_epi16(_mm_max_epi16(dq1, neg_tc0), tc0), aq);
+        r[2] = _mm_add_epi16(p1, dp1);
+        r[5] = _mm_add_epi16(q1, dq1);
+    }
+
+    /* the clipping of equations 8-468 and 8-469 is done by the saturating pack */
+    r[3] = _mm_add_epi16(p0, delta);
+    r[4] = _mm_sub_epi16(q0, delta);
+}
+
+/**
+ * @brief the filter of bS equal to 4 of 8 lines, r holds p3 to q3 as 16-bit lanes and is updated in place
+ * @see 8.7.2.4 Filtering process for edges for bS equal to 4
+ */
+static inline TARGET_SSE2 void filter_intra_epi16_sse2(__m128i r[8], __m128i alpha, __m128i beta, int32_t chroma_style) {
+    __m128i two = _mm_set1_epi16(2);
+    __m128i four = _mm_set1_epi16(4);
+    __m128i p3 = r[0], p2 = r[1], p1 = r[2], p0 = r[3], q0 = r[4], q1 = r[5], q2 = r[6], q3 = r[7];
+
+    __m128i mask = filter_mask_sse2(p1, p0, q0, q1, alpha, beta);
+
+    /* equations 8-479 and 8-486, the filter of the chroma samples and of the luma samples without the strong filter */
+    __m128i p0_weak = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(p1, 1), p0), _mm_add_epi16(q1, two)), 2);
+    __m128i q0_weak = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(q1, 1), q0), _mm_add_epi16(p1, two)), 2);
+
+    if (chroma_style) {
+        r[3] = select_sse2(mask, p0_weak, p0);
+        r[4] = select_sse2(mask, q0_weak, q0);
+        return;
+    }
+
+    __m128i strong = _mm_and_si128(mask, _mm_cmplt_epi16(abs_diff_epi16_sse2(p0, q0), _mm_add_epi16(_mm_srai_epi16(alpha, 2), two)));
+    __m128i ap = _mm_and_si128(strong, _mm_cmplt_epi16(abs_diff_epi16_sse2(p2, p0), beta));
+    __m128i aq = _mm_and_si128(strong, _mm_cmplt_epi16(abs_diff_epi16_sse2(q2, q0), beta));
+
+    /* equations 8-476 to 8-478 */
+    __m128i sum = _mm_add_epi16(_mm_add_epi16(p1, p0), q0);
+    __m128i p0_strong = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(sum, 1), _mm_add_epi16(p2, q1)), four), 3);
+    __m128i p1_strong = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(sum, p2), two), 2);
+    __m128i p2_strong = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(_mm_add_epi16(p3, p2), 1), _mm_add_epi16(p2, sum)), four), 3);
+
+    /* equations 8-483 to 8-485 */
+    sum = _mm_add_epi16(_mm_add_epi16(p0, q0), q1);
+    __m128i q0_strong = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(sum, 1), _mm_add_epi16(p1, q2)), four), 3);
+    __m128i q1_strong = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(sum, q2), two), 2);
+    __m128i q2_strong = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(_mm_add_epi16(q3, q2), 1), _mm_add_epi16(q2, sum)), four), 3);
+
+    r[1] = select_sse2(ap, p2_strong, p2);
+    r[2] = select_sse2(ap, p1_strong, p1);
+    r[3] = select_sse2(ap, p0_strong, select_sse2(mask, p0_weak, p0));
+    r[4] = select_sse2(aq, q0_strong, select_sse2(mask, q0_weak, q0));
+    r[5] = select_sse2(aq, q1_strong, q1);
+    r[6] = select_sse2(aq, q2_strong, q2);
+}
+
+/**
+ * @brief filter the 16 lines of the samples p3 to q3 in r, the low and the high 8 lines are filtered on 16-bit lanes
+ *
+ * @param tc0 tC0 of the 4 segments of 4 lines, 0 for bS equal to 4
+ */
+static inline TARGET_SSE2 void filter_luma_sse2(__m128i r[8], int32_t alpha, int32_t beta, const int8_t* tc0, int32_t intra) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i valpha = _mm_set1_epi16((int16_t)alpha);
+    __m128i vbeta = _mm_set1_epi16((int16_t)beta);
+    __m128i lo[8], hi[8];
+
+    for (int32_t i = 0; i < 8; i++) {
+        lo[i] = _mm_unpacklo_epi8(r[i], zero);
+        hi[i] = _mm_unpackhi_epi8(r[i], zero);
+    }
+
+    if (intra) {
+        filter_intra_epi16_sse2(lo, valpha, vbeta, 0);
+        filter_intra_epi16_sse2(hi, valpha, vbeta, 0);
+    } else {
+        filter_normal_epi16_sse2(lo, valpha, vbeta, _mm_setr_epi16(tc0[0], tc0[0], tc0[0], tc0[0], tc0[1], tc0[1], tc0[1], tc0[1]), 0);
+        filter_normal_epi16_sse2(hi, valpha, vbeta, _mm_setr_epi16(tc0[2], tc0[2], tc0[2], tc0[2], tc0[3], tc0[3], tc0[3], tc0[3]), 0);
+    }
+
+    /* only p2 to q2 are modified */
+    for (int32_t i = 1; i < 7; i++) {
+        r[i] = _mm_packus_epi16(lo[i], hi[i]);
+    }
+}
+
+/**
+ * @brief transpose the 16 rows of 8 samples starting at src to the 8 columns of 16 samples
+ */
+static inline TARGET_SSE2 void transpose_16x8_sse2(const uint8_t* src, int32_t stride, __m128i cols[8]) {
+    __m128i t[8], u[8], v[4], w[4];
+
+    for (int32_t i = 0; i < 8; i++) {
+        t[i] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src + 2 * i * stride)), _mm_loadl_epi64((const __m128i*)(src + (2 * i + 1) * stride)));
+    }
+    for (int32_t i = 0; i < 4; i++) {
+        u[2 * i] = _mm_unpacklo_epi16(t[2 * i], t[2 * i + 1]);
+        u[2 * i + 1] = _mm_unpackhi_epi16(t[2 * i], t[2 * i + 1]);
+    }
+
+    /* the columns 0-1, 2-3, 4-5 and 6-7 of the rows 0 to 7 and of the rows 8 to 15 */
+    v[0] = _mm_unpacklo_epi32(u[0], u[2]);
+    v[1] = _mm_unpackhi_epi32(u[0], u[2]);
+    v[2] = _mm_unpacklo_epi32(u[1], u[3]);
+    v[3] = _mm_unpackhi_epi32(u[1], u[3]);
+    w[0] = _mm_unpacklo_epi32(u[4], u[6]);
+    w[1] = _mm_unpackhi_epi32(u[4], u[6]);
+    w[2] = _mm_unpacklo_epi32(u[5], u[7]);
+    w[3] = _mm_unpackhi_epi32(u[5], u[7]);
+
+    for (int32_t i = 0; i < 4; i++) {
+        cols[2 * i] = _mm_unpacklo_epi64(v[i], w[i]);
+        cols[2 * i + 1] = _mm_unpackhi_epi64(v[i], w[i]);
+    }
+}
+
+/**
+ * @brief transpose the 8 columns of 16 samples back to the 16 rows of 8 samples starting at dst
+ */
+static inline TARGET_SSE2 void transpose_8x16_sse2(const __m128i cols[8], uint8_t* dst, int32_t stride) {
+    __m128i a[8], b[8];
+
+    for (int32_t i = 0; i < 4; i++) {
+        a[2 * i] = _mm_unpacklo_epi8(cols[2 * i], cols[2 * i + 1]);
+        a[2 * i + 1] = _mm_unpackhi_epi8(cols[2 * i], cols[2 * i + 1]);
+    }
+
+    /* the columns 0-3 and 4-7 of the rows 0-3, 4-7, 8-11 and 12-15 */
+    for (int32_t half = 0; half < 2; half++) {
+        b[4 * half] = _mm_unpacklo_epi16(a[half], a[2 + half]);
+        b[4 * half + 1] = _mm_unpackhi_epi16(a[half], a[2 + half]);
+        b[4 * half + 2] = _mm_unpacklo_epi16(a[4 + half], a[6 + half]);
+        b[4 * half + 3] = _mm_unpackhi_epi16(a[4 + half], a[6 + half]);
+    }
+
+    for (int32_t half = 0; half < 2; half++) {
+        __m128i rows[4];
+        rows[0] = _mm_unpacklo_epi32(b[4 * half], b[4 * half + 2]);
+        rows[1] = _mm_unpackhi_epi32(b[4 * half], b[4 * half + 2]);
+        rows[2] = _mm_unpacklo_epi32(b[4 * half + 1], b[4 * half + 3]);
+        rows[3] = _mm_unpackhi_epi32(b[4 * half + 1], b[4 * half + 3]);
+
+        uint8_t* p = dst + half * 8 * stride;
+        for (int32_t i = 0; i < 4; i++) {
+            _mm_storel_epi64((__m128i*)(p + 2 * i * stride), rows[i]);
+            _mm_storel_epi64((__m128i*)(p + (2 * i + 1) * stride), _mm_srli_si128(rows[i], 8));
+        }
+    }
+}
+
+static TARGET_SSE2 void luma_h_sse2(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta, const int8_t tc0[4]) {
+    __m128i r[8];
+    for (int32_t i = 0; i < 8; i++) {
+        r[i] = _mm_loadu_si128((const __m128i*)(pix + (i - 4) * stride));
+    }
+    filter_luma_sse2(r, alpha, beta, tc0, 0);
+    for (int32_t i = 1; i < 7; i++) {
+        _mm_storeu_si128((__m128i*)(pix + (i - 4) * stride), r[i]);
+    }
+}
+
+static TARGET_SSE2 void luma_v_sse2(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta, const int8_t tc0[4]) {
+    __m128i r[8];
+    transpose_16x8_sse2(pix - 4, stride, r);
+    filter_luma_sse2(r, alpha, beta, tc0, 0);
+    transpose_8x16_sse2(r, pix - 4, stride);
+}
+
+static TARGET_SSE2 void luma_intra_h_sse2(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta) {
+    __m128i r[8];
+    for (int32_t i = 0; i < 8; i++) {
+        r[i] = _mm_loadu_si128((const __m128i*)(pix + (i - 4) * stride));
+    }
+    filter_luma_sse2(r, alpha, beta, 0, 1);
+    for (int32_t i = 1; i < 7; i++) {
+        _mm_storeu_si128((__m128i*)(pix + (i - 4) * stride), r[i]);
+    }
+}
+
+static TARGET_SSE2 void luma_intra_v_sse2(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta) {
+    __m128i r[8];
+    transpose_16x8_sse2(pix - 4, stride, r);
+    filter_luma_sse2(r, alpha, beta, 0, 1);
+    transpose_8x16_sse2(r, pix - 4, stride);
+}
+
+/**
+ * @brief filter the 8 lines of the chroma samples p1 to q1 in r[2] to r[5], the samples are in the low 64 bits
+ */
+static inline TARGET_SSE2 void filter_chroma_sse2(__m128i r[8], int32_t alpha, int32_t beta, const int8_t* tc0, int32_t intra) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i valpha = _mm_set1_epi16((int16_t)alpha);
+    __m128i vbeta = _mm_set1_epi16((int16_t)beta);
+
+    for (int32_t i = 2; i < 6; i++) {
+        r[i] = _mm_unpacklo_epi8(r[i], zero);
+    }
+
+    if (intra) {
+        filter_intra_epi16_sse2(r, valpha, vbeta, 1);
+    } else {
+        filter_normal_epi16_sse2(r, valpha, vbeta, _mm_setr_epi16(tc0[0], tc0[0], tc0[1], tc0[1], tc0[2], tc0[2], tc0[3], tc0[3]), 1);
+    }
+
+    r[3] = _mm_packus_epi16(r[3], r[3]);
+    r[4] = _mm_packus_epi16(r[4], r[4]);
+}
+
+static TARGET_SSE2 void chroma_h_sse2(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta, const int8_t tc0[4]) {
+    __m128i r[8];
+    r[0] = r[1] = r[6] = r[7] = _mm_setzero_si128();
+    for (int32_t i = 2; i < 6; i++) {
+        r[i] = _mm_loadl_epi64((const __m128i*)(pix + (i - 4) * stride));
+    }
+    filter_chroma_sse2(r, alpha, beta, tc0, 0);
+    _mm_storel_epi64((__m128i*)(pix - stride), r[3]);
+    _mm_storel_epi64((__m128i*)pix, r[4]);
+}
+
+static TARGET_SSE2 void chroma_intra_h_sse2(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta) {
+    __m128i r[8];
+    r[0] = r[1] = r[6] = r[7] = _mm_setzero_si128();
+    for (int32_t i = 2; i < 6; i++) {
+        r[i] = _mm_loadl_epi64((const __m128i*)(pix + (i - 4) * stride));
+    }
+    filter_chroma_sse2(r, alpha, beta, 0, 1);
+    _mm_storel_epi64((__m128i*)(pix - stride), r[3]);
+    _mm_storel_epi64((__m128i*)pix, r[4]);
+}
+
+/**
+ * @brief transpose the 8 rows of the samples p1 to q1 of a vertical chroma edge into r[2] to r[5]
+ */
+static inline TARGET_SSE2 void load_chroma_v_sse2(const uint8_t* pix, int32_t stride, __m128i r[8]) {
+    __m128i t[4];
+    for (int32_t i = 0; i < 4; i++) {
+        t[i] = _mm_unpacklo_epi8(_mm_cvtsi32_si128(load32(pix - 2 + 2 * i * stride)), _mm_cvtsi32_si128(load32(pix - 2 + (2 * i + 1) * stride)));
+    }
+    __m128i u0 = _mm_unpacklo_epi16(t[0], t[1]);
+    __m128i u1 = _mm_unpacklo_epi16(t[2], t[3]);
+    __m128i v0 = _mm_unpacklo_epi32(u0, u1);
+    __m128i v1 = _mm_unpackhi_epi32(u0, u1);
+
+    r[0] = r[1] = r[6] = r[7] = _mm_setzero_si128();
+    r[2] = v0;
+    r[3] = _mm_srli_si128(v0, 8);
+    r[4] = v1;
+    r[5] = _mm_srli_si128(v1, 8);
+}
+
+/**
+ * @brief store the rows of p1 to q1 of a vertical chroma edge, only p0 and q0 are modified
+ */
+static inline TARGET_SSE2 void store_chroma_v_sse2(uint8_t* pix, int32_t stride, const __m128i r[8]) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i p = _mm_unpacklo_epi8(_mm_packus_epi16(r[2], zero), r[3]);
+    __m128i q = _mm_unpacklo_epi8(r[4], _mm_packus_epi16(r[5], zero));
+    __m128i lo = _mm_unpacklo_epi16(p, q);
+    __m128i hi = _mm_unpackhi_epi16(p, q);
+
+    uint8_t rows[32];
+    _mm_storeu_si128((__m128i*)rows, lo);
+    _mm_storeu_si128((__m128i*)(rows + 16), hi);
+    for (int32_t i = 0; i < 8; i++) {
+        memcpy(pix - 2 + i * stride, rows + 4 * i, 4);
+    }
+}
+
+static TARGET_SSE2 void chroma_v_sse2(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta, const int8_t tc0[4]) {
+    __m128i r[8];
+    load_chroma_v_sse2(pix, stride, r);
+    filter_chroma_sse2(r, alpha, beta, tc0, 0);
+    store_chroma_v_sse2(pix, stride, r);
+}
+
+static TARGET_SSE2 void chroma_intra_v_sse2(uint8_t* pix, int32_t stride, int32_t alpha, int32_t beta) {
+    __m128i r[8];
+    load_chroma_v_sse2(pix, stride, r);
+    filter_chroma_sse2(r, alpha, beta, 0, 1);
+    store_chroma_v_sse2(pix, stride, r);
+}
+
+/**
+ * @brief the mask of the 32-bit lanes of the blocks whose motion vectors differ, | dx | >= 4 or | dy | >= mvy_limit
+ */
+static inline TARGET_SSE2 __m128i mv_differs_sse2(__m128i a, __m128i b, __m128i limit) {
+    __m128i d = abs_diff_epi16_sse2(a, b);
+    __m128i m = _mm_cmpgt_epi16(d, limit);
+    return _mm_xor_si128(_mm_cmpeq_epi32(m, _mm_setzero_si128()), _mm_set1_epi32(-1));
+}
+
+/**
+ * @brief the mask of the 32-bit lanes of the blocks whose 8-bit values differ
+ */
+static inline TARGET_SSE2 __m128i ref_differs_sse2(const int8_t* a, const int8_t* b) {
+    __m128i m = _mm_cmpeq_epi8(_mm_cvtsi32_si128(load32((const uint8_t*)a)), _mm_cvtsi32_si128(load32((const uint8_t*)b)));
+    m = _mm_unpacklo_epi8(m, m);
+    m = _mm_unpacklo_epi16(m, m);
+    return _mm_xor_si128(m, _mm_set1_epi32(-1));
+}
+
+/**
+ * @brief bS of the 4 block pairs p and q, which are the 4 consecutive blocks from the cache index p and from q
+ */
+static inline TARGET_SSE2 __m128i boundary_strength4_sse2(const DeblockCache* cache, int32_t p, int32_t q, __m128i limit) {
+    __m128i p_mv0 = _mm_loadu_si128((const __m128i*)cache->mv[0][p]);
+    __m128i p_mv1 = _mm_loadu_si128((const __m128i*)cache->mv[1][p]);
+    __m128i q_mv0 = _mm_loadu_si128((const __m128i*)cache->mv[0][q]);
+    __m128i q_mv1 = _mm_loadu_si128((const __m128i*)cache->mv[1][q]);
+
+    /* the same reference pictures in the same lists, or in the other lists */
+    __m128i straight = _mm_or_si128(ref_differs_sse2(&cache->ref[0][p], &cache->ref[0][q]), ref_differs_sse2(&cache->ref[1][p], &cache->ref[1][q]));
+    straight = _mm_or_si128(straight, _mm_or_si128(mv_differs_sse2(p_mv0, q_mv0, limit), mv_differs_sse2(p_mv1, q_mv1, limit)));
+    __m128i crossed = _mm_or_si128(ref_differs_sse2(&cache->ref[0][p], &cache->ref[1][q]), ref_differs_sse2(&cache->ref[1][p], &cache->ref[0][q]));
+    crossed = _mm_or_si128(crossed, _mm_or_si128(mv_differs_sse2(p_mv0, q_mv1, limit), mv_differs_sse2(p_mv1, q_mv0, limit)));
+    __m128i bs1 = _mm_and_si128(_mm_and_si128(straight, crossed), _mm_set1_epi32(1));
+
+    __m128i nnz = _mm_or_si128(_mm_cvtsi32_si128(load32(&cache->nnz[p])), _mm_cvtsi32_si128(load32(&cache->nnz[q])));
+    nnz = _mm_unpacklo_epi16(_mm_unpacklo_epi8(nnz, _mm_setzero_si128()), _mm_setzero_si128());
+    __m128i coded = _mm_xor_si128(_mm_cmpeq_epi32(nnz, _mm_setzero_si128()), _mm_set1_epi32(-1));
+
+    return select_sse2(coded, _mm_set1_epi32(2), bs1);
+}
+
+static TARGET_SSE2 void boundary_strength_sse2(const DeblockCache* cache, int32_t mvy_limit, uint8_t bS[2][4][4]) {
+    /* the thresholds minus 1 of the horizontal and the vertical components */
+    __m128i limit = _mm_setr_epi16(3, (int16_t)(mvy_limit - 1), 3, (int16_t)(mvy_limit - 1), 3, (int16_t)(mvy_limit - 1), 3, (int16_t)(mvy_limit - 1));
+    __m128i v[4], h[4];
+
+    /* the row y gives the segment y of the 4 vertical edges, and the horizontal edge y */
+    for (int32_t y = 0; y < 4; y++) {
+        v[y] = boundary_strength4_sse2(cache, MV_CACHE_IDX(-1, y), MV_CACHE_IDX(0, y), limit);
+        h[y] = boundary_strength4_sse2(cache, MV_CACHE_IDX(0, y - 1), MV_CACHE_IDX(0, y), limit);
+    }
+
+    /* the values are 0 to 2, the packs keep them as bytes */
+    __m128i hv = _mm_packs_epi16(_mm_packs_epi32(h[0], h[1]), _mm_packs_epi32(h[2], h[3]));
+    _mm_storeu_si128((__m128i*)bS[1], hv);
+
+    /* the vertical edges are transposed from [ segment ][ edge ] to [ edge ][ segment ] */
+    __m128i vv = _mm_packs_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+    __m128i t0 = _mm_unpacklo_epi8(vv, _mm_srli_si128(vv, 4));
+    __m128i t1 = _mm_unpacklo_epi8(_mm_srli_si128(vv, 8), _mm_srli_si128(vv, 12));
+    __m128i t = _mm_unpacklo_epi16(t0, t1);
+    _mm_storeu_si128((__m128i*)bS[0], t);
+}
+
+void init_deblock_funcs_x86(DeblockFuncs* funcs, int32_t cpu_flags) {
+    if (cpu_flags & H264_CPU_SSE2) {
+        funcs->luma[0] = luma_v_sse2;
+        funcs->luma[1] = luma_h_sse2;
+        funcs->luma_intra[0] = luma_intra_v_sse2;
+        funcs->luma_intra[1] = luma_intra_h_sse2;
+        funcs->chroma[0] = chroma_v_sse2;
+        funcs->chroma[1] = chroma_h_sse2;
+        funcs->chroma_intra[0] = chroma_intra_v_sse2;
+        funcs->chroma_intra[1] = chroma_intra_h_sse2;
+        funcs->chroma444[0] = luma_v_sse2;
+        funcs->chroma444[1] = luma_h_sse2;
+        funcs->chroma444_intra[0] = luma_intra_v_sse2;
+        funcs->chroma444_intra[1] = luma_intra_h_sse2;
+        funcs->boundary_strength = boundary_strength_sse2;
+    }
+}
+
+#else
+
+void init_deblock_funcs_x86(DeblockFuncs* funcs, int32_t cpu_flags) {
+    (void)funcs;
+    (void)cpu_flags;
+}
+
+#endif
@@ -0,0 +1,446 @@
+#include "h264decoder/h264_decoder_group.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "h264decoder/h264_nalu.h"
+#include "h264decoder/h264_stream.h"
+
+/**
+ * @brief the stream has work for a worker: a packet to decode unless the stream waits for the frames of the application, frames left in the context or the flush
+ * after the last packet, and room for the frames. the caller holds the mutex of the group
+ */
+static int is_stream_runnable(const GroupStream* stream) {
+    if (stream->removed || stream->output_frames - stream->received_frames >= H264_GROUP_OUTPUT_DEPTH) {
+        return 0;
+    }
+
+    int32_t has_packet = stream->decoded_packets != stream->submitted_packets;
+    return (has_packet && !stream->starved) || stream->frames_pending || (!has_packet && stream->ended && !stream->flushed);
+}
+
+/**
+ * @brief append the stream to the run queue if it is runnable and not scheduled yet. the caller holds the mutex of the group
+ */
+static void schedule_stream(DecoderGroup* group, GroupStream* stream) {
+    if (stream->scheduled || !is_stream_runnable(stream)) {
+        return;
+    }
+
+    stream->scheduled = 1;
+    stream->next = 0;
+    if (group->run_tail) {
+        group->run_tail->next = stream;
+    } else {
+        group->run_head = stream;
+    }
+    group->run_tail = stream;
+    pthread_cond_signal(&group->work);
+}
+
+/**
+ * @brief schedule the stream again if it waits for the frames of the application, they may have been released since
+ */
+static void retry_starved_stream(DecoderGroup* group, GroupStream* stream) {
+    pthread_mutex_lock(&group->mutex);
+    stream->starved = 0;
+    schedule_stream(group, stream);
+    pthread_mutex_unlock(&group->mutex);
+}
+
+/**
+ * @brief decode the NALUs of the packet, the parameter sets are added to the context
+ *
+ * @return int 0 on success, the error of the first NALU which failed otherwise
+ */
+static int decode_group_packet(H264Context* context, GroupPacket* packet) {
+    int first_err_code = ERR_OK;
+    H264BitStream bit_stream;
+    memset(&bit_stream, 0, sizeof(H264BitStream));
+    bit_stream.start = packet->data;
+    bit_stream.end = packet->data + packet->size;
+    bit_stream.nalu_start = packet->data;
+
+    set_access_unit_timestamps(context, packet->pts, packet->dts);
+
+    while (read_next_nalu(&bit_stream) == ERR_OK) {
+        void* nalu = 0;
+        int err_code = parse_nalu(bit_stream.nalu_start, bit_stream.nalu_end, context, &nalu);
+        if (nalu) {
+            uint8_t nal_unit_type = bit_stream.nalu_start[0] & 0x1F;
+            if (err_code >= 0 && nal_unit_type == NALU_SPS) {
+                err_code = add_sps_to_context(context, (SPS*)nalu);
+            } else if (err_code >= 0 && nal_unit_type == NALU_PPS) {
+                err_code = add_pps_to_context(context, (PPS*)nalu);
+            } else {
+                free_nalu(nalu);
+                nalu = 0;
+            }
+            if (err_code < 0 && nalu) {
+                free_nalu(nalu);
+            }
+        }
+
+        if (err_code < 0 && first_err_code == ERR_OK) {
+            first_err_code = err_code;
+        }
+    }
+
+    return first_err_code;
+}
+
+static void* group_thread_main(void* arg) {
+    DecoderGroup* group = (DecoderGroup*)arg;
+
+    pthread_mutex_lock(&group->mutex);
+    while (!group->quit) {
+        GroupStream* stream = group->run_head;
+        if (!stream) {
+            pthread_cond_wait(&group->work, &group->mutex);
+            continue;
+        }
+        group->run_head = stream->next;
+        if (!group->run_head) {
+            group->run_tail = 0;
+        }
+
+        /* the stream stays scheduled while it is decoded, so no other worker takes it */
+        GroupPacket* packet = 0;
+        int32_t flush = 0;
+        int32_t starved = 0;
+        if (stream->decoded_packets != stream->submitted_packets) {
+            packet = stream->starved ? 0 : &stream->packets[stream->decoded_packets % H264_GROUP_INPUT_DEPTH];
+        } else if (stream->ended && !stream->flushed) {
+            flush = 1;
+        }
+        uint32_t first_frame = stream->output_frames;
+        int32_t free_frames = H264_GROUP_OUTPUT_DEPTH - (int32_t)(stream->output_frames - stream->received_frames);
+        pthread_mutex_unlock(&group->mutex);
+
+        /* a packet which starts a picture would fail if the budget of the stream has no room for it, so it waits until the application releases a frame */
+        if (packet && is_waiting_for_frames(stream->context)) {
+            packet = 0;
+            starved = 1;
+        }
+
+        int err_code = ERR_OK;
+        if (packet) {
+            err_code = decode_group_packet(stream->context, packet);
+        } else if (flush) {
+            err_code = flush_context(stream->context);
+        }
+
+        /* the slots after the output frames are not read by the application until they are counted */
+        int32_t frame_count = 0;
+        while (frame_count < free_frames &&
+               receive_frame(stream->context, &stream->frames[(first_frame + frame_count) % H264_GROUP_OUTPUT_DEPTH]) == ERR_OK) {
+            frame_count++;
+        }
+
+        pthread_mutex_lock(&group->mutex);
+        if (packet) {
+            stream->decoded_packets++;
+        }
+        if (flush) {
+            stream->flushed = 1;
+        }
+        /* the application clears the flag when it receives a frame or finds the input queue full, the frames it released meanwhile are found then */
+        if (starved) {
+            stream->starved = 1;
+        }
+        if (err_code < 0 && stream->err_code == ERR_OK) {
+            stream->err_code = err_code;
+        }
+        stream->output_frames += frame_count;
+        stream->frames_pending = frame_count == free_frames;
+        stream->scheduled = 0;
+        schedule_stream(group, stream);
+        pthread_cond_broadcast(&stream->progress);
+    }
+    pthread_mutex_unlock(&group->mutex);
+
+    return 0;
+}
+
+/**
+ * @brief stop the workers and wait for them
+ *
+ * @param group the group
+ * @param count the number of the started workers
+ */
+static void stop_worker_threads(DecoderGroup* group, int32_t count) {
+    pthread_mutex_lock(&group->mutex);
+    group->quit = 1;
+    pthread_cond_broadcast(&group->work);
+    pthread_mutex_unlock(&group->mutex);
+
+    for (int32_t i = 0; i < count; i++) {
+        pthread_join(group->threads[i], 0);
+    }
+}
+
+DecoderGroup* create_decoder_group(int32_t thread_count) {
+    if (thread_count < 1 || thread_count > H264_MAX_GROUP_THREADS) {
+        return 0;
+    }
+
+    DecoderGroup* group = (DecoderGroup*)malloc(sizeof(DecoderGroup));
+    if (!group) {
+        return 0;
+    }
+    memset(group, 0, sizeof(DecoderGroup));
+    group->thread_count = thread_count;
+
+    if (init_memory_budget(&group->memory, 0) < 0) {
+        free(group);
+        return 0;
+    }
+    if (init_shared_picture_pool(&group->pictures) < 0) {
+        free_memory_budget(&group->memory);
+        free(group);
+        return 0;
+    }
+    group->pictures.budget = &group->memory;
+    if (pthread_mutex_init(&group->mutex, 0)) {
+        free_shared_picture_pool(&group->pictures);
+        free_memory_budget(&group->memory);
+        free(group);
+        return 0;
+    }
+    if (pthread_cond_init(&group->work, 0)) {
+        pthread_mutex_destroy(&group->mutex);
+        free_shared_picture_pool(&group->pictures);
+        free_memory_budget(&group->memory);
+        free(group);
+        return 0;
+    }
+
+    for (int32_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&group->threads[i], 0, group_thread_main, group)) {
+            stop_worker_threads(group, i);
+            pthread_cond_destroy(&group->work);
+            pthread_mutex_destroy(&group->mutex);
+            free_shared_picture_pool(&group->pictures);
+            free_memory_budget(&group->memory);
+            free(group);
+            return 0;
+        }
+    }
+
+    return group;
+}
+
+void free_decoder_group(DecoderGroup* group) {
+    stop_worker_threads(group, group->thread_count);
+
+    pthread_cond_destroy(&group->work);
+    pthread_mutex_destroy(&group->mutex);
+    free_shared_picture_pool(&group->pictures);
+    free_memory_budget(&group->memory);
+    free(group);
+}
+
+int set_group_memory_limit(DecoderGroup* group, size_t limit) {
+    int err_code = set_memory_budget_limit(&group->memory, limit);
+    /* the idle pictures of the shared pool give way to the limit */
+    if (err_code == ERR_MEMORY_BUDGET_EXCEEDED && trim_shared_picture_pool(&group->pictures) > 0) {
+        err_code = set_memory_budget_limit(&group->memory, limit);
+    }
+    return err_code;
+}
+
+void set_group_stream_memory_limit(DecoderGroup* group, size_t limit) {
+    pthread_mutex_lock(&group->mutex);
+    group->stream_memory_limit = limit;
+    pthread_mutex_unlock(&group->mutex);
+}
+
+void get_group_memory_usage(DecoderGroup* group, MemoryUsage* usage) { get_memory_budget_usage(&group->memory, usage); }
+
+GroupStream* add_group_stream(DecoderGroup* group) {
+    GroupStream* stream = (GroupStream*)malloc(sizeof(GroupStream));
+    if (!stream) {
+        return 0;
+    }
+    memset(stream, 0, sizeof(GroupStream));
+    stream->group = group;
+
+    stream->context = create_context();
+    if (!stream->context) {
+        free(stream);
+        return 0;
+    }
+    /* the frames waiting in the output queue hold pictures beyond the ones which the DPB needs */
+    if (set_frame_pool_policy(stream->context, FRAME_POOL_GROW) < 0) {
+        free_context(stream->context);
+        free(stream);
+        return 0;
+    }
+    stream->context->picture_pool.shared = &group->pictures;
+
+    /* the limit of the stream is reserved from the group, the idle pictures of the shared pool give way to it */
+    pthread_mutex_lock(&group->mutex);
+    size_t memory_limit = group->stream_memory_limit;
+    pthread_mutex_unlock(&group->mutex);
+    int err_code = set_memory_budget_parent(&stream->context->memory, &group->memory);
+    if (err_code == ERR_OK) {
+        err_code = set_memory_budget_limit(&stream->context->memory, memory_limit);
+    }
+    if (err_code == ERR_MEMORY_BUDGET_EXCEEDED && trim_shared_picture_pool(&group->pictures) > 0) {
+        err_code = set_memory_budget_limit(&stream->context->memory, memory_limit);
+    }
+    if (err_code < 0) {
+        free_context(stream->context);
+        free(stream);
+        return 0;
+    }
+
+    if (pthread_cond_init(&stream->progress, 0)) {
+        free_context(stream->context);
+        free(stream);
+        return 0;
+    }
+
+    return stream;
+}
+
+void remove_group_stream(GroupStream* stream) {
+    DecoderGroup* group = stream->group;
+
+    pthread_mutex_lock(&group->mutex);
+    /* the packets which are not decoded are dropped, the stream is only waited for if a worker decodes it */
+    stream->removed = 1;
+    if (stream->scheduled) {
+        GroupStream** link = &group->run_head;
+        GroupStream* prev = 0;
+        while (*link && *link != stream) {
+            prev = *link;
+            link = &(*link)->next;
+        }
+        if (*link) {
+            *link = stream->next;
+            if (group->run_tail == stream) {
+                group->run_tail = prev;
+            }
+            stream->scheduled = 0;
+        }
+    }
+    while (stream->scheduled) {
+        pthread_cond_wait(&stream->progress, &group->mutex);
+    }
+    pthread_mutex_unlock(&group->mutex);
+
+    while (stream->received_frames != stream->output_frames) {
+        release_frame(&stream->frames[stream->received_frames++ % H264_GROUP_OUTPUT_DEPTH]);
+    }
+    for (int32_t i = 0; i < H264_GROUP_INPUT_DEPTH; i++) {
+        if (stream->packets[i].data) {
+            free(stream->packets[i].data);
+        }
+    }
+
+    /* the pictures of the context go to the shared picture pool */
+    free_context(stream->context);
+    pthread_cond_destroy(&stream->progress);
+    free(stream);
+}
+
+int submit_group_packet(GroupStream* stream, const uint8_t* data, size_t size, int64_t pts, int64_t dts) {
+    DecoderGroup* group = stream->group;
+
+    if (!data || !size) {
+        return ERR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&group->mutex);
+    int32_t ended = stream->ended;
+    int32_t is_full = stream->submitted_packets - stream->decoded_packets >= H264_GROUP_INPUT_DEPTH;
+    uint32_t index = stream->submitted_packets % H264_GROUP_INPUT_DEPTH;
+    pthread_mutex_unlock(&group->mutex);
+
+    if (ended) {
+        return ERR_INVALID_PARAM;
+    }
+    if (is_full) {
+        retry_starved_stream(group, stream);
+        return ERR_STREAM_QUEUE_FULL;
+    }
+
+    /* the slot is not read by the workers until the packet is counted */
+    GroupPacket* packet = &stream->packets[index];
+    if (packet->capacity < size) {
+        uint8_t* buffer = (uint8_t*)malloc(size);
+        if (!buffer) {
+            return ERR_OOM;
+        }
+        if (packet->data) {
+            free(packet->data);
+        }
+        packet->data = buffer;
+        packet->capacity = size;
+    }
+    memcpy(packet->data, data, size);
+    packet->size = size;
+    packet->pts = pts;
+    packet->dts = dts;
+
+    pthread_mutex_lock(&group->mutex);
+    stream->submitted_packets++;
+    schedule_stream(group, stream);
+    pthread_mutex_unlock(&group->mutex);
+
+    return ERR_OK;
+}
+
+int end_group_stream(GroupStream* stream) {
+    DecoderGroup* group = stream->group;
+
+    pthread_mutex_lock(&group->mutex);
+    stream->ended = 1;
+    schedule_stream(group, stream);
+    pthread_mutex_unlock(&group->mutex);
+
+    return ERR_OK;
+}
+
+int receive_group_frame(GroupStream* stream, DecodedFrame* frame, int wait) {
+    DecoderGroup* group = stream->group;
+    int err_code = ERR_OK;
+
+    pthread_mutex_lock(&group->mutex);
+    /* the application may have released frames since the stream was deferred */
+    stream->starved = 0;
+    schedule_stream(group, stream);
+    while (1) {
+        if (stream->received_frames != stream->output_frames) {
+            *frame = stream->frames[stream->received_frames++ % H264_GROUP_OUTPUT_DEPTH];
+            /* the stream may have waited for the room in the output queue */
+            schedule_stream(group, stream);
+            err_code = ERR_OK;
+            break;
+        }
+
+        if (stream->flushed && !stream->scheduled && !is_stream_runnable(stream)) {
+            err_code = ERR_EOS;
+            break;
+        }
+        if (!wait || !stream->scheduled) {
+            err_code = ERR_NO_FRAME;
+            break;
+        }
+        pthread_cond_wait(&stream->progress, &group->mutex);
+    }
+    pthread_mutex_unlock(&group->mutex);
+
+    return err_code;
+}
+
+int get_group_stream_error(GroupStream* stream) {
+    DecoderGroup* group = stream->group;
+
+    pthread_mutex_lock(&group->mutex);
+    int err_code = stream->err_code;
+    pthread_mutex_unlock(&group->mutex);
+
+    return err_code;
+}
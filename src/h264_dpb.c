@@ -0,0 +1,508 @@
+#include "h264decoder/h264_dpb.h"
+
+#include <string.h>
+
+#include "h264decoder/h264_math.h"
+
+/**
+ * @brief the frame or field being marked, the decoded picture or a non-existing frame
+ */
+typedef struct {
+    Picture* picture;
+    /* frame_num of the frame or field */
+    int32_t frame_num;
+    /* field_pic_flag and bottom_field_flag of the frame or field */
+    int32_t field_pic_flag;
+    int32_t bottom_field_flag;
+} MarkedPicture;
+
+static inline int is_used_for_reference(const Picture* pic) { return pic->ref_marking[0] != REF_PIC_UNUSED || pic->ref_marking[1] != REF_PIC_UNUSED; }
+
+static inline int has_marking(const Picture* pic, uint8_t marking) { return pic->ref_marking[0] == marking || pic->ref_marking[1] == marking; }
+
+/**
+ * @brief FrameNumWrap of the frame store, equation 8-27
+ */
+static inline int32_t frame_num_wrap(const DecodedPictureBuffer* dpb, const Picture* pic, int32_t frame_num) {
+    return pic->FrameNum > frame_num ? pic->FrameNum - dpb->MaxFrameNum : pic->FrameNum;
+}
+
+/**
+ * @brief PicNum or LongTermPicNum of the field of the frame store for the marked picture, equations 8-28 to 8-33. the frames are numbered as a whole
+ *
+ * @param dpb the DPB
+ * @param curr the marked picture
+ * @param pic the frame store
+ * @param parity the field, 0 for the top field and 1 for the bottom field
+ * @param marking REF_PIC_SHORT_TERM for PicNum and REF_PIC_LONG_TERM for LongTermPicNum
+ * @return int32_t the picture number
+ */
+static int32_t picture_number(const DecodedPictureBuffer* dpb, const MarkedPicture* curr, const Picture* pic, int32_t parity, uint8_t marking) {
+    int32_t num = marking == REF_PIC_SHORT_TERM ? frame_num_wrap(dpb, pic, curr->frame_num) : pic->LongTermFrameIdx;
+    if (!curr->field_pic_flag) {
+        return num;
+    }
+
+    /* the fields of the same parity as the current field get the odd numbers */
+    return 2 * num + (parity == curr->bottom_field_flag);
+}
+
+/**
+ * @brief find the reference frame or field with the marking and the picture number, a frame is matched if both of its fields have the marking
+ *
+ * @param dpb the DPB
+ * @param curr the marked picture
+ * @param marking REF_PIC_SHORT_TERM or REF_PIC_LONG_TERM
+ * @param num PicNum or LongTermPicNum
+ * @param mask output parameter. the matched fields, bit 0 for the top field and bit 1 for the bottom field
+ * @return Picture* the frame store, 0 if no reference picture has the number
+ */
+static Picture* find_reference(const DecodedPictureBuffer* dpb, const MarkedPicture* curr, uint8_t marking, int32_t num, int32_t* mask) {
+    for (int32_t i = 0; i < dpb->size; i++) {
+        Picture* pic = dpb->frames[i];
+
+        if (!curr->field_pic_flag) {
+            if (pic->ref_marking[0] == marking && pic->ref_marking[1] == marking && picture_number(dpb, curr, pic, 0, marking) == num) {
+                *mask = 3;
+                return pic;
+            }
+            continue;
+        }
+
+        for (int32_t parity = 0; parity < 2; parity++) {
+            if (pic->ref_marking[parity] == marking && picture_number(dpb, curr, pic, parity, marking) == num) {
+                *mask = 1 << parity;
+                return pic;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void set_marking(Picture* pic, int32_t mask, uint8_t marking) {
+    for (int32_t parity = 0; parity < 2; parity++) {
+        if (mask & (1 << parity)) {
+            pic->ref_marking[parity] = marking;
+        }
+    }
+}
+
+/**
+ * @brief mark the long-term fields which have the LongTermFrameIdx as unused for reference, except the fields of the frame store keep
+ */
+static void unmark_long_term_frame_idx(DecodedPictureBuffer* dpb, const Picture* keep, int32_t LongTermFrameIdx) {
+    for (int32_t i = 0; i < dpb->size; i++) {
+        Picture* pic = dpb->frames[i];
+        if (pic == keep || pic->LongTermFrameIdx != LongTermFrameIdx) {
+            continue;
+        }
+
+        for (int32_t parity = 0; parity < 2; parity++) {
+            if (pic->ref_marking[parity] == REF_PIC_LONG_TERM) {
+                pic->ref_marking[parity] = REF_PIC_UNUSED;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Sliding window decoded reference picture marking process
+ * @see 8.2.5.3 Sliding window decoded reference picture marking process
+ *
+ * @param dpb the DPB
+ * @param curr the marked picture
+ */
+static void sliding_window_marking(DecodedPictureBuffer* dpb, const MarkedPicture* curr) {
+    /* the second field of a complementary reference field pair whose first field is marked as used for short-term reference is marked with it */
+    if (curr->field_pic_flag && curr->picture->ref_marking[!curr->bottom_field_flag] == REF_PIC_SHORT_TERM) {
+        return;
+    }
+
+    /* the condition is numShortTerm + numLongTerm == Max( max_num_ref_frames, 1 ), the frames are removed until it holds for the streams exceeding it too */
+    for (;;) {
+        int32_t numShortTerm = 0;
+        int32_t numLongTerm = 0;
+        Picture* oldest = 0;
+
+        for (int32_t i = 0; i < dpb->size; i++) {
+            Picture* pic = dpb->frames[i];
+            if (has_marking(pic, REF_PIC_LONG_TERM)) {
+                numLongTerm++;
+            }
+            if (!has_marking(pic, REF_PIC_SHORT_TERM)) {
+                continue;
+            }
+
+            numShortTerm++;
+            if (pic != curr->picture && (!oldest || frame_num_wrap(dpb, pic, curr->frame_num) < frame_num_wrap(dpb, oldest, curr->frame_num))) {
+                oldest = pic;
+            }
+        }
+
+        if (numShortTerm + numLongTerm < dpb->max_num_ref_frames || !oldest) {
+            return;
+        }
+
+        for (int32_t parity = 0; parity < 2; parity++) {
+            if (oldest->ref_marking[parity] == REF_PIC_SHORT_TERM) {
+                oldest->ref_marking[parity] = REF_PIC_UNUSED;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Adaptive memory control decoded reference picture marking process, the operations referring to no picture are ignored
+ * @see 8.2.5.4 Adaptive memory control decoded reference picture marking process
+ *
+ * @param dpb the DPB
+ * @param curr the marked picture
+ * @param marking the decoded reference picture marking of the slice header
+ * @return int 1 if the current picture is marked as used for long-term reference, 0 otherwise
+ */
+static int adaptive_memory_control_marking(DecodedPictureBuffer* dpb, const MarkedPicture* curr, const DecRefPicMark* marking) {
+    int32_t CurrPicNum = curr->field_pic_flag ? 2 * curr->frame_num + 1 : curr->frame_num;
+    int32_t curr_mask = curr->field_pic_flag ? 1 << curr->bottom_field_flag : 3;
+    int is_long_term = 0;
+
+    for (size_t i = 0; i < marking->mmco_len; i++) {
+        Picture* pic = 0;
+        int32_t mask = 0;
+
+        switch (marking->mmco[i].memory_management_control_operation) {
+            case 1: {
+                /* 8.2.5.4.1 marking of a short-term reference picture as "unused for reference" */
+                int32_t picNumX = CurrPicNum - (int32_t)(marking->mmco[i].difference_of_pic_nums_minus1 + 1);
+                pic = find_reference(dpb, curr, REF_PIC_SHORT_TERM, picNumX, &mask);
+                if (pic) {
+                    set_marking(pic, mask, REF_PIC_UNUSED);
+                }
+                break;
+            }
+            case 2: {
+                /* 8.2.5.4.2 marking of a long-term reference picture as "unused for reference" */
+                pic = find_reference(dpb, curr, REF_PIC_LONG_TERM, (int32_t)marking->mmco[i].long_term_pic_num, &mask);
+                if (pic) {
+                    set_marking(pic, mask, REF_PIC_UNUSED);
+                }
+                break;
+            }
+            case 3: {
+                /* 8.2.5.4.3 assignment of a LongTermFrameIdx to a short-term reference picture. the other frame stores holding the LongTermFrameIdx are unmarked,
+                 * the field of the same frame keeps it */
+                int32_t picNumX = CurrPicNum - (int32_t)(marking->mmco[i].difference_of_pic_nums_minus1 + 1);
+                int32_t LongTermFrameIdx = (int32_t)marking->mmco[i].long_term_frame_idx;
+                pic = find_reference(dpb, curr, REF_PIC_SHORT_TERM, picNumX, &mask);
+                if (!pic) {
+                    break;
+                }
+
+                unmark_long_term_frame_idx(dpb, pic, LongTermFrameIdx);
+                if (pic->LongTermFrameIdx != LongTermFrameIdx) {
+                    /* the other field of the frame has another LongTermFrameIdx */
+                    for (int32_t parity = 0; parity < 2; parity++) {
+                        if (!(mask & (1 << parity)) && pic->ref_marking[parity] == REF_PIC_LONG_TERM) {
+                            pic->ref_marking[parity] = REF_PIC_UNUSED;
+                        }
+                    }
+                }
+                set_marking(pic, mask, REF_PIC_LONG_TERM);
+                pic->LongTermFrameIdx = LongTermFrameIdx;
+                break;
+            }
+            case 4: {
+                /* 8.2.5.4.4 the long-term frame indices greater than MaxLongTermFrameIdx are unmarked */
+                dpb->MaxLongTermFrameIdx = (int32_t)marking->mmco[i].max_long_term_frame_idx_plus1 - 1;
+                for (int32_t j = 0; j < dpb->size; j++) {
+                    Picture* ref = dpb->frames[j];
+                    if (ref->LongTermFrameIdx > dpb->MaxLongTermFrameIdx) {
+                        for (int32_t parity = 0; parity < 2; parity++) {
+                            if (ref->ref_marking[parity] == REF_PIC_LONG_TERM) {
+                                ref->ref_marking[parity] = REF_PIC_UNUSED;
+                            }
+                        }
+                    }
+                }
+                break;
+            }
+            case 5: {
+                /* 8.2.5.4.5 all the reference pictures are marked as unused for reference */
+                for (int32_t j = 0; j < dpb->size; j++) {
+                    dpb->frames[j]->ref_marking[0] = dpb->frames[j]->ref_marking[1] = REF_PIC_UNUSED;
+                }
+                dpb->MaxLongTermFrameIdx = -1;
+                curr->picture->has_mmco5 = 1;
+                break;
+            }
+            case 6: {
+                /* 8.2.5.4.6 assignment of a LongTermFrameIdx to the current picture, the first field of the same frame keeps it */
+                int32_t LongTermFrameIdx = (int32_t)marking->mmco[i].long_term_frame_idx;
+                unmark_long_term_frame_idx(dpb, curr->picture, LongTermFrameIdx);
+                set_marking(curr->picture, curr_mask, REF_PIC_LONG_TERM);
+                curr->picture->LongTermFrameIdx = LongTermFrameIdx;
+                is_long_term = 1;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return is_long_term;
+}
+
+void init_dpb(DecodedPictureBuffer* dpb, SPS* sps) {
+    dpb->capacity = get_dpb_frame_count(sps);
+    dpb->max_num_ref_frames = (int32_t)codec_max(sps->max_num_ref_frames, 1);
+    dpb->MaxFrameNum = (int32_t)sps->MaxFrameNum;
+
+    /* the output order of pic_order_cnt_type 2 is the decoding order. max_num_reorder_frames is inferred by the vui semantics if it is not present */
+    dpb->max_num_reorder_frames = sps->pic_order_cnt_type == 2 ? 0 : (int32_t)codec_min(sps->vui.max_num_reorder_frames, (uint32_t)dpb->capacity);
+}
+
+int is_second_field_of_picture(const Picture* first, const SliceHeader* header) {
+    int32_t parity_bit = header->bottom_field_flag ? 2 : 1;
+
+    /* the second field is not an IDR picture and it shares frame_num with the first field, both fields are reference fields or non-reference fields */
+    if (!header->field_pic_flag || header->nalu_header.IdrPicFlag) {
+        return 0;
+    }
+    if ((first->decoded_fields != 1 && first->decoded_fields != 2) || first->decoded_fields == parity_bit) {
+        return 0;
+    }
+
+    return first->FrameNum == (int32_t)header->frame_num && first->is_reference == (header->nalu_header.nal_ref_idc != 0);
+}
+
+int decoded_reference_picture_marking(DecodedPictureBuffer* dpb, Picture* picture, SliceHeader* header) {
+    MarkedPicture curr = {picture, (int32_t)header->frame_num, header->field_pic_flag, header->bottom_field_flag};
+    int32_t curr_mask = curr.field_pic_flag ? 1 << curr.bottom_field_flag : 3;
+    const DecRefPicMark* marking = &header->dec_ref_pic_mark;
+
+    /* the non-reference pictures are not marked */
+    if (!header->nalu_header.nal_ref_idc) {
+        return ERR_OK;
+    }
+
+    if (header->nalu_header.IdrPicFlag) {
+        /* all the reference pictures are marked as unused for reference */
+        for (int32_t i = 0; i < dpb->size; i++) {
+            if (dpb->frames[i] != picture) {
+                dpb->frames[i]->ref_marking[0] = dpb->frames[i]->ref_marking[1] = REF_PIC_UNUSED;
+            }
+        }
+
+        if (marking->long_term_reference_flag) {
+            set_marking(picture, curr_mask, REF_PIC_LONG_TERM);
+            picture->LongTermFrameIdx = 0;
+            dpb->MaxLongTermFrameIdx = 0;
+        } else {
+            set_marking(picture, curr_mask, REF_PIC_SHORT_TERM);
+            dpb->MaxLongTermFrameIdx = -1;
+        }
+        dpb->PrevRefFrameNum = 0;
+        return ERR_OK;
+    }
+
+    int is_long_term = 0;
+    if (marking->adaptive_ref_pic_marking_mode_flag) {
+        is_long_term = adaptive_memory_control_marking(dpb, &curr, marking);
+    } else {
+        sliding_window_marking(dpb, &curr);
+    }
+
+    if (!is_long_term) {
+        set_marking(picture, curr_mask, REF_PIC_SHORT_TERM);
+    }
+
+    /* the picture with memory_management_control_operation equal to 5 is inferred to have had frame_num equal to 0, see 8.2.1 */
+    if (picture->has_mmco5) {
+        picture->FrameNum = 0;
+    }
+    dpb->PrevRefFrameNum = picture->FrameNum;
+
+    return ERR_OK;
+}
+
+/**
+ * @brief release the frame stores which are unused for reference and not needed for the output, except the picture keep
+ */
+static void remove_unused_frames(DecodedPictureBuffer* dpb, PicturePool* pool, const Picture* keep) {
+    int32_t size = 0;
+
+    for (int32_t i = 0; i < dpb->size; i++) {
+        Picture* pic = dpb->frames[i];
+        if (pic != keep && !is_used_for_reference(pic) && !pic->needed_for_output) {
+            pic->in_dpb = 0;
+            release_picture(pool, pic);
+            continue;
+        }
+        dpb->frames[size++] = pic;
+    }
+
+    dpb->size = size;
+}
+
+int store_picture_in_dpb(DecodedPictureBuffer* dpb, PicturePool* pool, Picture* picture) {
+    remove_unused_frames(dpb, pool, picture);
+
+    if (picture->in_dpb || (!is_used_for_reference(picture) && !picture->needed_for_output)) {
+        return ERR_OK;
+    }
+
+    /* the frame store above the capacity is emptied by output_pictures() */
+    if (dpb->size > dpb->capacity) {
+        return ERR_DPB_FULL;
+    }
+
+    retain_picture(picture);
+    picture->in_dpb = 1;
+    dpb->frames[dpb->size++] = picture;
+
+    return ERR_OK;
+}
+
+/**
+ * @brief find the picture waiting for the output with the smallest PicOrderCnt( ) of its frame or field
+ *
+ * @param dpb the DPB
+ * @param waiting output parameter. the number of the pictures waiting for the output
+ * @return Picture* the picture, 0 if no picture waits for the output
+ */
+static Picture* find_first_output_picture(const DecodedPictureBuffer* dpb, int32_t* waiting) {
+    Picture* first = 0;
+
+    *waiting = 0;
+    for (int32_t i = 0; i < dpb->size; i++) {
+        Picture* pic = dpb->frames[i];
+        if (!pic->needed_for_output) {
+            continue;
+        }
+
+        (*waiting)++;
+        if (!first || pic->frame->poc < first->frame->poc) {
+            first = pic;
+        }
+    }
+
+    return first;
+}
+
+int output_pictures(DecodedPictureBuffer* dpb, PicturePool* pool, int flush) {
+    for (;;) {
+        int32_t waiting = 0;
+        Picture* pic = find_first_output_picture(dpb, &waiting);
+
+        if (!pic || (!flush && dpb->size <= dpb->capacity && waiting <= dpb->max_num_reorder_frames)) {
+            break;
+        }
+        /* the application has not taken the output pictures, the rest stay in the DPB */
+        if (dpb->output_count >= H264_MAX_DPB_FRAMES) {
+            break;
+        }
+
+        pic->needed_for_output = 0;
+        pic->output_latency = (int32_t)(dpb->decode_count - 1 - pic->decode_index);
+        retain_picture(pic);
+        dpb->output_queue[(dpb->output_head + dpb->output_count) % H264_MAX_DPB_FRAMES] = pic;
+        dpb->output_count++;
+
+        remove_unused_frames(dpb, pool, 0);
+    }
+
+    if (dpb->size > dpb->capacity) {
+        /* the memory management control operations of the stream keep more reference frames than the DPB holds, the oldest short-term frame is dropped */
+        Picture* last = dpb->frames[dpb->size - 1];
+        MarkedPicture curr = {last, last->FrameNum, 0, 0};
+        int32_t max_num_ref_frames = dpb->max_num_ref_frames;
+
+        dpb->max_num_ref_frames = dpb->capacity + 1;
+        sliding_window_marking(dpb, &curr);
+        dpb->max_num_ref_frames = max_num_ref_frames;
+
+        remove_unused_frames(dpb, pool, 0);
+        if (dpb->size > dpb->capacity) {
+            return ERR_DPB_FULL;
+        }
+    }
+
+    return ERR_OK;
+}
+
+Picture* get_output_picture_from_dpb(DecodedPictureBuffer* dpb) {
+    if (!dpb->output_count) {
+        return 0;
+    }
+
+    Picture* pic = dpb->output_queue[dpb->output_head];
+    dpb->output_head = (dpb->output_head + 1) % H264_MAX_DPB_FRAMES;
+    dpb->output_count--;
+
+    return pic;
+}
+
+int fill_frame_num_gap(DecodedPictureBuffer* dpb, PicturePool* pool, SPS* sps, SliceHeader* header) {
+    int32_t frame_num = (int32_t)header->frame_num;
+    int32_t UnusedShortTermFrameNum = (dpb->PrevRefFrameNum + 1) % dpb->MaxFrameNum;
+
+    if (frame_num == dpb->PrevRefFrameNum || frame_num == UnusedShortTermFrameNum) {
+        return ERR_OK;
+    }
+
+    /* the gap is also filled if gaps_in_frame_num_value_allowed_flag is 0, as the concealment of the lost pictures. the frames of a gap longer than
+     * max_num_ref_frames which would be removed by the sliding window of the later frames of the gap are skipped */
+    int32_t count = (frame_num - UnusedShortTermFrameNum + dpb->MaxFrameNum) % dpb->MaxFrameNum;
+    if (count > dpb->max_num_ref_frames) {
+        UnusedShortTermFrameNum = (UnusedShortTermFrameNum + count - dpb->max_num_ref_frames) % dpb->MaxFrameNum;
+    }
+
+    while (UnusedShortTermFrameNum != frame_num) {
+        Picture* pic = 0;
+        int err_code = get_picture_from_pool(pool, sps, &pic);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        pic->coded_type = PICTURE_CODED_FRAME;
+        pic->decoded_fields = 3;
+        pic->is_reference = 1;
+        pic->non_existing = 1;
+        pic->FrameNum = UnusedShortTermFrameNum;
+
+        MarkedPicture curr = {pic, UnusedShortTermFrameNum, 0, 0};
+        sliding_window_marking(dpb, &curr);
+        set_marking(pic, 3, REF_PIC_SHORT_TERM);
+
+        err_code = store_picture_in_dpb(dpb, pool, pic);
+        release_picture(pool, pic);
+        if (err_code < 0) {
+            return err_code;
+        }
+        err_code = output_pictures(dpb, pool, 0);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        dpb->PrevRefFrameNum = UnusedShortTermFrameNum;
+        UnusedShortTermFrameNum = (UnusedShortTermFrameNum + 1) % dpb->MaxFrameNum;
+    }
+
+    return ERR_OK;
+}
+
+void flush_dpb(DecodedPictureBuffer* dpb, PicturePool* pool, int no_output_of_prior_pics_flag) {
+    if (!no_output_of_prior_pics_flag) {
+        output_pictures(dpb, pool, 1);
+    }
+
+    /* the pictures which the full output queue does not take are discarded too */
+    for (int32_t i = 0; i < dpb->size; i++) {
+        dpb->frames[i]->ref_marking[0] = dpb->frames[i]->ref_marking[1] = REF_PIC_UNUSED;
+        dpb->frames[i]->needed_for_output = 0;
+    }
+
+    remove_unused_frames(dpb, pool, 0);
+    dpb->MaxLongTermFrameIdx = -1;
+    dpb->PrevRefFrameNum = 0;
+}
@@ -0,0 +1,155 @@
+#include "h264decoder/h264_frame.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+FrameDelivery* create_frame_delivery() {
+    FrameDelivery* delivery = (FrameDelivery*)malloc(sizeof(FrameDelivery));
+    if (!delivery) {
+        return 0;
+    }
+    memset(delivery, 0, sizeof(FrameDelivery));
+
+    if (pthread_mutex_init(&delivery->mutex, 0)) {
+        free(delivery);
+        return 0;
+    }
+    if (pthread_cond_init(&delivery->released, 0)) {
+        pthread_mutex_destroy(&delivery->mutex);
+        free(delivery);
+        return 0;
+    }
+
+    return delivery;
+}
+
+void free_frame_delivery(FrameDelivery* delivery) {
+    pthread_cond_destroy(&delivery->released);
+    pthread_mutex_destroy(&delivery->mutex);
+    free(delivery);
+}
+
+void close_frame_delivery(FrameDelivery* delivery, PicturePool* pool) {
+    pthread_mutex_lock(&delivery->mutex);
+    for (int32_t i = 0; i < H264_MAX_POOL_PICTURES; i++) {
+        Picture* picture = pool->pictures[i];
+        if (picture && picture->frame_ref_count > 0) {
+            detach_pool_picture(pool, picture);
+        }
+    }
+    /* the released pictures are still in the pool, which frees them */
+    delivery->released_count = 0;
+    delivery->is_closed = 1;
+    int is_unused = delivery->held_count == 0;
+    pthread_mutex_unlock(&delivery->mutex);
+
+    if (is_unused) {
+        free_frame_delivery(delivery);
+    }
+}
+
+void attach_frame(FrameDelivery* delivery, Picture* picture, DecodedFrame* frame) {
+    memset(frame, 0, sizeof(DecodedFrame));
+
+    /* the planes of the frame, a non-paired field is delivered in the frame with the rows of the other field undecoded */
+    memcpy(frame->planes, picture->frame->planes, sizeof(frame->planes));
+    frame->plane_count = picture->frame->plane_count;
+    frame->chroma_format_idc = picture->chroma_format_idc;
+    frame->BitDepthY = picture->BitDepthY;
+    frame->BitDepthC = picture->BitDepthC;
+
+    frame->crop_left = picture->crop_left;
+    frame->crop_top = picture->crop_top;
+    frame->crop_width = picture->crop_width;
+    frame->crop_height = picture->crop_height;
+
+    frame->poc = picture->frame->poc;
+    frame->pts = picture->pts;
+    frame->dts = picture->dts;
+    frame->decode_index = picture->decode_index;
+    frame->output_latency = picture->output_latency;
+
+    frame->picture = picture;
+    frame->delivery = delivery;
+
+    pthread_mutex_lock(&delivery->mutex);
+    picture->frame_ref_count = 1;
+    delivery->held_count++;
+    pthread_mutex_unlock(&delivery->mutex);
+}
+
+int32_t take_released_pictures(FrameDelivery* delivery, Picture** pictures) {
+    pthread_mutex_lock(&delivery->mutex);
+    int32_t count = delivery->released_count;
+    memcpy(pictures, delivery->released_pictures, count * sizeof(Picture*));
+    delivery->released_count = 0;
+    pthread_mutex_unlock(&delivery->mutex);
+
+    return count;
+}
+
+int wait_for_released_picture(FrameDelivery* delivery) {
+    pthread_mutex_lock(&delivery->mutex);
+    while (!delivery->released_count && delivery->held_count > 0) {
+        pthread_cond_wait(&delivery->released, &delivery->mutex);
+    }
+    int is_released = delivery->released_count > 0;
+    pthread_mutex_unlock(&delivery->mutex);
+
+    return is_released;
+}
+
+int has_held_frames(FrameDelivery* delivery) {
+    pthread_mutex_lock(&delivery->mutex);
+    int is_held = delivery->held_count > 0;
+    pthread_mutex_unlock(&delivery->mutex);
+
+    return is_held;
+}
+
+int ref_frame(DecodedFrame* dst, const DecodedFrame* src) {
+    if (!src->picture || !src->delivery) {
+        return ERR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&src->delivery->mutex);
+    src->picture->frame_ref_count++;
+    pthread_mutex_unlock(&src->delivery->mutex);
+
+    if (dst != src) {
+        memcpy(dst, src, sizeof(DecodedFrame));
+    }
+    return ERR_OK;
+}
+
+void release_frame(DecodedFrame* frame) {
+    FrameDelivery* delivery = frame->delivery;
+    if (!frame->picture || !delivery) {
+        return;
+    }
+
+    Picture* detached_picture = 0;
+    int is_unused = 0;
+
+    pthread_mutex_lock(&delivery->mutex);
+    if (--frame->picture->frame_ref_count == 0) {
+        delivery->held_count--;
+        if (delivery->is_closed) {
+            detached_picture = frame->picture;
+            is_unused = delivery->held_count == 0;
+        } else {
+            /* every picture of the pool is released at most once, so the queue never overflows */
+            delivery->released_pictures[delivery->released_count++] = frame->picture;
+            pthread_cond_broadcast(&delivery->released);
+        }
+    }
+    pthread_mutex_unlock(&delivery->mutex);
+
+    memset(frame, 0, sizeof(DecodedFrame));
+    if (detached_picture) {
+        free_picture(detached_picture);
+    }
+    if (is_unused) {
+        free_frame_delivery(delivery);
+    }
+}
@@ -0,0 +1,619 @@
+#include "h264decoder/h264_frame_thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "h264decoder/h264_atomic.h"
+#include "h264decoder/h264_cpu.h"
+#include "h264decoder/h264_math.h"
+
+/**
+ * @brief raise the decoded rows of the frame or field. they are written under the mutex and read without it by the fast path of the waits, which loads them
+ * with acquire so the rows are decoded once it sees them
+ */
+static inline void raise_decoded_rows(FrameOrField* ff, int32_t rows) {
+    if (rows > ff->decoded_mb_rows) {
+        store_release_i32(&ff->decoded_mb_rows, rows);
+    }
+}
+
+/**
+ * @brief publish the rows of the frame or field of the picture for the frame and both fields. a field macroblock row covers two frame macroblock rows, and a
+ * frame macroblock row covers half of a field macroblock row of both fields. the mutex MUST be held
+ */
+static void publish_decoded_rows(Picture* picture, FrameOrField* ff, int32_t rows) {
+    if (ff == picture->frame) {
+        raise_decoded_rows(picture->frame, rows);
+        raise_decoded_rows(picture->top_field, rows == H264_ALL_MB_ROWS ? rows : rows / 2);
+        raise_decoded_rows(picture->bottom_field, rows == H264_ALL_MB_ROWS ? rows : rows / 2);
+        return;
+    }
+
+    raise_decoded_rows(ff, rows);
+    int32_t pair_rows = codec_min(picture->top_field->decoded_mb_rows, picture->bottom_field->decoded_mb_rows);
+    raise_decoded_rows(picture->frame, pair_rows == H264_ALL_MB_ROWS ? pair_rows : 2 * pair_rows);
+}
+
+/**
+ * @brief free the slice group maps which the slice job took over, the RBSP buffer is kept for the next slice of the job
+ */
+static void clear_slice_job(SliceJob* slice) {
+    if (slice->header.mapUnitToSliceGroupMap) {
+        free(slice->header.mapUnitToSliceGroupMap);
+        slice->header.mapUnitToSliceGroupMap = 0;
+    }
+    if (slice->header.MbToSliceGroupMap) {
+        free(slice->header.MbToSliceGroupMap);
+        slice->header.MbToSliceGroupMap = 0;
+    }
+}
+
+/**
+ * @brief take a decoded slice job with its RBSP buffer, or allocate one if there is none
+ */
+static SliceJob* take_slice_job(FrameThreads* threads) {
+    pthread_mutex_lock(&threads->mutex);
+    SliceJob* slice = threads->free_slices;
+    if (slice) {
+        threads->free_slices = slice->next;
+    }
+    pthread_mutex_unlock(&threads->mutex);
+
+    if (!slice) {
+        slice = (SliceJob*)malloc(sizeof(SliceJob));
+        if (!slice) {
+            return 0;
+        }
+        memset(slice, 0, sizeof(SliceJob));
+    }
+    return slice;
+}
+
+/**
+ * @brief put the slice job which failed to be queued back to the decoded slice jobs
+ */
+static void put_back_slice_job(FrameThreads* threads, SliceJob* slice) {
+    pthread_mutex_lock(&threads->mutex);
+    slice->next = threads->free_slices;
+    threads->free_slices = slice;
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+/**
+ * @brief the frame or field which the slice decodes
+ */
+static FrameOrField* get_slice_frame_or_field(Picture* picture, const SliceHeader* header) {
+    if (!header->field_pic_flag) {
+        return picture->frame;
+    }
+    return header->bottom_field_flag ? picture->bottom_field : picture->top_field;
+}
+
+/**
+ * @brief let the worker reconstruct the rows of the frame or field with its kernels, the deblocking kernels are selected for the bit depths of the sps
+ */
+static void attach_worker_kernels(FrameWorker* worker, FrameOrField* ff, const SPS* sps) {
+    if ((int32_t)sps->BitDepthY != worker->deblock_bit_depths[0] || (int32_t)sps->BitDepthC != worker->deblock_bit_depths[1]) {
+        init_deblock_funcs(&worker->deblock_funcs, (int32_t)sps->BitDepthY, (int32_t)sps->BitDepthC, get_cpu_flags());
+        worker->deblock_bit_depths[0] = (int32_t)sps->BitDepthY;
+        worker->deblock_bit_depths[1] = (int32_t)sps->BitDepthC;
+    }
+
+    ff->residuals->row_reconstructor = worker->reconstructor;
+    ff->residuals->row_deblock_funcs = &worker->deblock_funcs;
+}
+
+/**
+ * @brief reconstruct the rows of the frame or field which the slices left, and publish it as decoded completely. the errors of the broken macroblocks are
+ * concealed by leaving them as on the decoding thread
+ */
+static void finish_frame_or_field(FrameWorker* worker, Picture* picture, const SliceHeader* header) {
+    FrameThreads* threads = worker->threads;
+    FrameOrField* ff = get_slice_frame_or_field(picture, header);
+    int32_t rows = ff->mb_list_len / (int32_t)header->sps->PicWidthInMbs;
+
+    if (ff->residuals && ff->residuals->active) {
+        attach_worker_kernels(worker, ff, header->sps);
+        reconstruct_parsed_rows(worker->reconstructor, &worker->deblock_funcs, ff, header->sps, rows, &rows);
+    }
+
+    pthread_mutex_lock(&threads->mutex);
+    publish_decoded_rows(picture, ff, rows);
+    pthread_cond_broadcast(&threads->progress);
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+/**
+ * @brief take the oldest job which no worker decodes, the mutex MUST be held
+ */
+static PictureJob* take_next_job(FrameThreads* threads) {
+    for (int32_t i = 0; i < threads->job_count; i++) {
+        PictureJob* job = &threads->jobs[(threads->job_head + i) % H264_MAX_FRAME_THREADS];
+        if (!job->is_taken) {
+            job->is_taken = 1;
+            return job;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief decode the slices of the job until it is closed, the mutex is held on entry and on return
+ */
+static void decode_picture_job(FrameWorker* worker, PictureJob* job) {
+    FrameThreads* threads = worker->threads;
+
+    for (;;) {
+        while (!job->first_slice && !job->is_closed && !threads->quit) {
+            pthread_cond_wait(&threads->work, &threads->mutex);
+        }
+
+        SliceJob* slice = job->first_slice;
+        if (!slice) {
+            break;
+        }
+        job->first_slice = slice->next;
+        if (!job->first_slice) {
+            job->last_slice = 0;
+        }
+
+        /* the slices of a picture are decoded only by the worker of its job */
+        pthread_mutex_unlock(&threads->mutex);
+        int err_code = ERR_OK;
+        if (slice->is_end) {
+            finish_frame_or_field(worker, job->picture, &slice->header);
+        } else {
+            FrameOrField* ff = get_slice_frame_or_field(job->picture, &slice->header);
+            if (ff->residuals && ff->residuals->active) {
+                attach_worker_kernels(worker, ff, slice->header.sps);
+            }
+            err_code = decode_slice(job->picture, worker->scratch, &slice->reader, &slice->header, &slice->ref_lists);
+            if (err_code >= 0) {
+                rbsp_slice_trailing_bits(&slice->reader, slice->header.pps->entropy_coding_mode_flag);
+            }
+        }
+        clear_slice_job(slice);
+        pthread_mutex_lock(&threads->mutex);
+
+        /* the slice job and its RBSP buffer are reused by a later slice */
+        slice->next = threads->free_slices;
+        threads->free_slices = slice;
+
+        if (err_code < 0 && job->err_code == ERR_OK) {
+            job->err_code = err_code;
+        }
+        if (--job->pending_slices == 0) {
+            pthread_cond_broadcast(&threads->progress);
+        }
+    }
+
+    /* the rows of the lost slices are never decoded, the later pictures refer to them as they are */
+    publish_decoded_rows(job->picture, job->picture->top_field, H264_ALL_MB_ROWS);
+    publish_decoded_rows(job->picture, job->picture->bottom_field, H264_ALL_MB_ROWS);
+    job->is_done = 1;
+    pthread_cond_broadcast(&threads->progress);
+}
+
+static void* frame_thread_main(void* arg) {
+    FrameWorker* worker = (FrameWorker*)arg;
+    FrameThreads* threads = worker->threads;
+
+    pthread_mutex_lock(&threads->mutex);
+    while (!threads->quit) {
+        PictureJob* job = take_next_job(threads);
+        if (!job) {
+            pthread_cond_wait(&threads->work, &threads->mutex);
+            continue;
+        }
+
+        decode_picture_job(worker, job);
+    }
+    pthread_mutex_unlock(&threads->mutex);
+
+    return 0;
+}
+
+/**
+ * @brief stop and join the first count worker threads
+ */
+static void stop_worker_threads(FrameThreads* threads, int32_t count) {
+    pthread_mutex_lock(&threads->mutex);
+    threads->quit = 1;
+    pthread_cond_broadcast(&threads->work);
+    pthread_mutex_unlock(&threads->mutex);
+
+    for (int32_t i = 0; i < count; i++) {
+        pthread_join(threads->workers[i].thread, 0);
+    }
+}
+
+/**
+ * @brief free the kernels and the macroblock scratch of the workers
+ */
+static void free_worker_kernels(FrameThreads* threads) {
+    for (int32_t i = 0; i < H264_MAX_FRAME_THREADS; i++) {
+        if (threads->workers[i].reconstructor) {
+            free_reconstructor(threads->workers[i].reconstructor);
+        }
+        free(threads->workers[i].scratch);
+    }
+}
+
+FrameThreads* create_frame_threads(int32_t thread_count) {
+    if (thread_count < 1 || thread_count > H264_MAX_FRAME_THREADS) {
+        return 0;
+    }
+
+    FrameThreads* threads = (FrameThreads*)malloc(sizeof(FrameThreads));
+    if (!threads) {
+        return 0;
+    }
+    memset(threads, 0, sizeof(FrameThreads));
+    threads->thread_count = thread_count;
+
+    /* the kernels of the bit depth 8 until the workers decode the pictures of another bit depth */
+    int32_t cpu_flags = get_cpu_flags();
+    for (int32_t i = 0; i < thread_count; i++) {
+        FrameWorker* worker = &threads->workers[i];
+        worker->threads = threads;
+        worker->reconstructor = create_reconstructor(1);
+        worker->scratch = (MacroBlockScratch*)calloc(1, sizeof(MacroBlockScratch));
+        if (!worker->reconstructor || !worker->scratch) {
+            free_worker_kernels(threads);
+            free(threads);
+            return 0;
+        }
+        init_deblock_funcs(&worker->deblock_funcs, 8, 8, cpu_flags);
+        worker->deblock_bit_depths[0] = 8;
+        worker->deblock_bit_depths[1] = 8;
+    }
+
+    if (pthread_mutex_init(&threads->mutex, 0)) {
+        free_worker_kernels(threads);
+        free(threads);
+        return 0;
+    }
+    if (pthread_cond_init(&threads->work, 0)) {
+        pthread_mutex_destroy(&threads->mutex);
+        free_worker_kernels(threads);
+        free(threads);
+        return 0;
+    }
+    if (pthread_cond_init(&threads->progress, 0)) {
+        pthread_cond_destroy(&threads->work);
+        pthread_mutex_destroy(&threads->mutex);
+        free_worker_kernels(threads);
+        free(threads);
+        return 0;
+    }
+
+    for (int32_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&threads->workers[i].thread, 0, frame_thread_main, &threads->workers[i])) {
+            stop_worker_threads(threads, i);
+            pthread_cond_destroy(&threads->progress);
+            pthread_cond_destroy(&threads->work);
+            pthread_mutex_destroy(&threads->mutex);
+            free_worker_kernels(threads);
+            free(threads);
+            return 0;
+        }
+    }
+
+    return threads;
+}
+
+void free_frame_threads(FrameThreads* threads, PicturePool* pool) {
+    pthread_mutex_lock(&threads->mutex);
+    for (int32_t i = 0; i < threads->job_count; i++) {
+        threads->jobs[(threads->job_head + i) % H264_MAX_FRAME_THREADS].is_closed = 1;
+    }
+    pthread_cond_broadcast(&threads->work);
+    pthread_mutex_unlock(&threads->mutex);
+
+    retire_picture_jobs(threads, pool, 0);
+    stop_worker_threads(threads, threads->thread_count);
+
+    while (threads->free_slices) {
+        SliceJob* slice = threads->free_slices;
+        threads->free_slices = slice->next;
+        free(slice->rbsp_buffer);
+        free(slice);
+    }
+
+    pthread_cond_destroy(&threads->progress);
+    pthread_cond_destroy(&threads->work);
+    pthread_mutex_destroy(&threads->mutex);
+    free_worker_kernels(threads);
+    free(threads);
+}
+
+int start_picture_job(FrameThreads* threads, PicturePool* pool, const DecodedPictureBuffer* dpb, Picture* picture) {
+    retire_picture_jobs(threads, pool, threads->thread_count - 1);
+
+    pthread_mutex_lock(&threads->mutex);
+    PictureJob* job = &threads->jobs[(threads->job_head + threads->job_count) % H264_MAX_FRAME_THREADS];
+    memset(job, 0, sizeof(PictureJob));
+
+    job->picture = picture;
+    retain_picture(picture);
+    for (int32_t i = 0; i < dpb->size; i++) {
+        job->refs[job->ref_count++] = dpb->frames[i];
+        retain_picture(dpb->frames[i]);
+    }
+
+    /* the picture is not referred by the other jobs until the job is visible to them */
+    picture->threads = threads;
+    picture->frame->decoded_mb_rows = 0;
+    picture->top_field->decoded_mb_rows = 0;
+    picture->bottom_field->decoded_mb_rows = 0;
+
+    threads->job_count++;
+    pthread_cond_broadcast(&threads->work);
+    pthread_mutex_unlock(&threads->mutex);
+
+    return ERR_OK;
+}
+
+/**
+ * @brief find the job of the picture which is not closed, the newest job. the mutex MUST be held
+ */
+static PictureJob* find_open_job(FrameThreads* threads, const Picture* picture) {
+    if (!threads->job_count) {
+        return 0;
+    }
+
+    PictureJob* job = &threads->jobs[(threads->job_head + threads->job_count - 1) % H264_MAX_FRAME_THREADS];
+    return (job->picture == picture && !job->is_closed) ? job : 0;
+}
+
+/**
+ * @brief append the slice job to the open job of the picture and wake its worker
+ */
+static int append_slice_job(FrameThreads* threads, Picture* picture, SliceJob* slice) {
+    pthread_mutex_lock(&threads->mutex);
+    PictureJob* job = find_open_job(threads, picture);
+    if (!job) {
+        pthread_mutex_unlock(&threads->mutex);
+        return ERR_INVALID_PARAM;
+    }
+
+    if (job->last_slice) {
+        job->last_slice->next = slice;
+    } else {
+        job->first_slice = slice;
+    }
+    job->last_slice = slice;
+    job->pending_slices++;
+    pthread_cond_broadcast(&threads->work);
+    pthread_mutex_unlock(&threads->mutex);
+
+    return ERR_OK;
+}
+
+int queue_slice_job(FrameThreads* threads, Picture* picture, SliceHeader* header, uint8_t** rbsp_buffer, size_t* rbsp_capacity, const RBSPReader* reader,
+                    const RefPicLists* ref_lists) {
+    SliceJob* slice = take_slice_job(threads);
+    if (!slice) {
+        return ERR_OOM;
+    }
+    memcpy(&slice->header, header, sizeof(SliceHeader));
+    slice->is_end = 0;
+    swap_rbsp_buffers(&slice->rbsp_buffer, &slice->rbsp_capacity, rbsp_buffer, rbsp_capacity);
+    slice->reader = *reader;
+    slice->ref_lists = *ref_lists;
+    slice->next = 0;
+
+    int err_code = append_slice_job(threads, picture, slice);
+    if (err_code < 0) {
+        /* the caller keeps the RBSP and the slice group maps */
+        swap_rbsp_buffers(&slice->rbsp_buffer, &slice->rbsp_capacity, rbsp_buffer, rbsp_capacity);
+        slice->header.mapUnitToSliceGroupMap = 0;
+        slice->header.MbToSliceGroupMap = 0;
+        put_back_slice_job(threads, slice);
+        return err_code;
+    }
+
+    /* the slice group maps are freed with the slice job */
+    header->mapUnitToSliceGroupMap = 0;
+    header->MbToSliceGroupMap = 0;
+
+    return ERR_OK;
+}
+
+int queue_frame_or_field_end(FrameThreads* threads, Picture* picture, const SliceHeader* header) {
+    SliceJob* slice = take_slice_job(threads);
+    if (!slice) {
+        return ERR_OOM;
+    }
+    memcpy(&slice->header, header, sizeof(SliceHeader));
+    slice->header.mapUnitToSliceGroupMap = 0;
+    slice->header.MbToSliceGroupMap = 0;
+    slice->is_end = 1;
+    slice->next = 0;
+
+    int err_code = append_slice_job(threads, picture, slice);
+    if (err_code < 0) {
+        put_back_slice_job(threads, slice);
+    }
+    return err_code;
+}
+
+void close_picture_job(FrameThreads* threads, Picture* picture) {
+    pthread_mutex_lock(&threads->mutex);
+    PictureJob* job = find_open_job(threads, picture);
+    if (job) {
+        job->is_closed = 1;
+        pthread_cond_broadcast(&threads->work);
+    }
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+void retire_picture_jobs(FrameThreads* threads, PicturePool* pool, int32_t max_jobs) {
+    pthread_mutex_lock(&threads->mutex);
+    while (threads->job_count > 0) {
+        PictureJob* job = &threads->jobs[threads->job_head];
+        if (!job->is_done) {
+            if (threads->job_count <= max_jobs) {
+                break;
+            }
+            pthread_cond_wait(&threads->progress, &threads->mutex);
+            continue;
+        }
+
+        if (job->err_code < 0 && threads->err_code == ERR_OK) {
+            threads->err_code = job->err_code;
+        }
+
+        /* the reference counts of the pictures are only changed by the decoding thread */
+        release_picture(pool, job->picture);
+        for (int32_t i = 0; i < job->ref_count; i++) {
+            release_picture(pool, job->refs[i]);
+        }
+        job->picture = 0;
+        job->ref_count = 0;
+
+        threads->job_head = (threads->job_head + 1) % H264_MAX_FRAME_THREADS;
+        threads->job_count--;
+    }
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+int take_frame_thread_error(FrameThreads* threads) {
+    pthread_mutex_lock(&threads->mutex);
+    int err_code = threads->err_code;
+    threads->err_code = ERR_OK;
+    pthread_mutex_unlock(&threads->mutex);
+
+    return err_code;
+}
+
+void wait_for_decoded_mb_rows(FrameThreads* threads, const FrameOrField* ff, int32_t rows) {
+    if (load_acquire_i32(&ff->decoded_mb_rows) >= rows) {
+        return;
+    }
+
+    pthread_mutex_lock(&threads->mutex);
+    while (ff->decoded_mb_rows < rows) {
+        pthread_cond_wait(&threads->progress, &threads->mutex);
+    }
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+/**
+ * @brief the job is done, or it is open and its worker waits for the next slice. the mutex MUST be held
+ */
+static inline int is_job_idle(const PictureJob* job) { return job->is_done || (!job->is_closed && job->pending_slices == 0); }
+
+void wait_for_picture(FrameThreads* threads, Picture* picture) {
+    if (load_acquire_i32(&picture->frame->decoded_mb_rows) == H264_ALL_MB_ROWS) {
+        return;
+    }
+
+    pthread_mutex_lock(&threads->mutex);
+    for (int32_t i = 0; i < threads->job_count; i++) {
+        PictureJob* job = &threads->jobs[(threads->job_head + i) % H264_MAX_FRAME_THREADS];
+        if (job->picture == picture) {
+            while (!is_job_idle(job)) {
+                pthread_cond_wait(&threads->progress, &threads->mutex);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+void wait_for_queued_slices(FrameThreads* threads) {
+    pthread_mutex_lock(&threads->mutex);
+    for (int32_t i = 0; i < threads->job_count; i++) {
+        PictureJob* job = &threads->jobs[(threads->job_head + i) % H264_MAX_FRAME_THREADS];
+        while (!is_job_idle(job)) {
+            pthread_cond_wait(&threads->progress, &threads->mutex);
+        }
+    }
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+/* the maximum number of the reference frames or fields of a macroblock, one per 4x4 block and list */
+#define MAX_MB_REFERENCES 32
+
+void wait_for_macroblock_references(const FrameOrField* ff, const RefPicLists* ref_lists, int32_t PicWidthInMbs, int32_t CurrMbAddr) {
+    FrameThreads* threads = ff->parent->threads;
+    int32_t mb_y = CurrMbAddr / PicWidthInMbs;
+
+    const FrameOrField* refs[MAX_MB_REFERENCES];
+    int32_t ref_rows[MAX_MB_REFERENCES];
+    int32_t ref_count = 0;
+
+    for (int32_t list = 0; list < 2; ++list) {
+        const int8_t* ref_idxs = ff->ref_idxs[list] + CurrMbAddr * 16;
+        const int16_t* mvs = ff->mvs[list] + CurrMbAddr * 32;
+
+        for (int32_t blk = 0; blk < 16; ++blk) {
+            int32_t refIdx = ref_idxs[blk];
+            if (refIdx < 0 || refIdx >= ref_lists->num[list]) {
+                continue;
+            }
+
+            /* the first field is decoded before the second field by the same job */
+            const FrameOrField* ref = ref_lists->entries[list][refIdx].ff;
+            if (!ref || ref->parent == ff->parent) {
+                continue;
+            }
+
+            int32_t bottom_line = mb_y * 16 + (blk / 4) * 4 + 3 + (mvs[2 * blk + 1] >> 2) + 3;
+            int32_t height = ref->mb_list_len / PicWidthInMbs;
+            int32_t rows = codec_min(codec_max(bottom_line / 16 + 1, 1), height);
+
+            int32_t i = 0;
+            while (i < ref_count && refs[i] != ref) {
+                i++;
+            }
+            if (i == ref_count) {
+                refs[ref_count] = ref;
+                ref_rows[ref_count++] = rows;
+            } else if (rows > ref_rows[i]) {
+                ref_rows[i] = rows;
+            }
+        }
+    }
+
+    for (int32_t i = 0; i < ref_count; i++) {
+        wait_for_decoded_mb_rows(threads, refs[i], ref_rows[i]);
+    }
+}
+
+void report_decoded_macroblock(FrameOrField* ff, const SliceHeader* header, int32_t CurrMbAddr) {
+    /* the rows are complete while the slices follow each other in raster order, see slice_data() */
+    if (ff->current_mb < 0 || header->pps->num_slice_groups_minus1 > 0) {
+        return;
+    }
+
+    int32_t PicWidthInMbs = (int32_t)header->sps->PicWidthInMbs;
+    int32_t rows;
+    if (header->MbaffFrameFlag) {
+        if (CurrMbAddr % 2 == 0 || (CurrMbAddr / 2) % PicWidthInMbs != PicWidthInMbs - 1) {
+            return;
+        }
+        rows = 2 * (CurrMbAddr / 2 / PicWidthInMbs + 1);
+    } else {
+        if (CurrMbAddr % PicWidthInMbs != PicWidthInMbs - 1) {
+            return;
+        }
+        rows = CurrMbAddr / PicWidthInMbs + 1;
+    }
+
+    /* the rows of a reconstructed frame or field are decoded once their samples are final */
+    ResidualStore* store = ff->residuals;
+    if (store && store->active) {
+        if (!store->row_reconstructor) {
+            return;
+        }
+        reconstruct_parsed_rows(store->row_reconstructor, store->row_deblock_funcs, ff, header->sps, rows, &rows);
+    }
+
+    FrameThreads* threads = ff->parent->threads;
+    pthread_mutex_lock(&threads->mutex);
+    publish_decoded_rows(ff->parent, ff, rows);
+    pthread_cond_broadcast(&threads->progress);
+    pthread_mutex_unlock(&threads->mutex);
+}
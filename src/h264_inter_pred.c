@@ -0,0 +1,226 @@
+#include "h264decoder/h264_inter_pred.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "h264decoder/h264_math.h"
+
+/* the 6-tap filter ( 1, -5, 20, 20, -5, 1 ) of equations 8-241 and 8-242, p points to G and the taps are step apart */
+#define TAP6(p, step) ((p)[-2 * (step)] - 5 * (p)[-(step)] + 20 * (p)[0] + 20 * (p)[(step)] - 5 * (p)[2 * (step)] + (p)[3 * (step)])
+
+/**
+ * @brief the planes which are averaged for a quarter sample position
+ * @see Table 8-12 – Assignment of the luma prediction sample predPartLXL[ xL, yL ]
+ */
+typedef enum {
+    MC_PLANE_FULL = 0, /* G, or H, M with the offset */
+    MC_PLANE_H6 = 1,   /* b, or s one row below */
+    MC_PLANE_V6 = 2,   /* h, or m one column right */
+    MC_PLANE_HV6 = 3,  /* j */
+} MC_PLANE;
+
+typedef struct {
+    uint8_t plane;
+    uint8_t dx;
+    uint8_t dy;
+} McPlaneRef;
+
+/* the two planes averaged for ( xFracL, yFracL ), indexed by yFracL * 4 + xFracL. the half sample and full sample positions use the first plane only */
+static const McPlaneRef g_qpel_planes[16][2] = {
+    {{MC_PLANE_FULL, 0, 0}, {MC_PLANE_FULL, 0, 0}}, /* G */
+    {{MC_PLANE_FULL, 0, 0}, {MC_PLANE_H6, 0, 0}},   /* a = ( G + b + 1 ) >> 1 */
+    {{MC_PLANE_H6, 0, 0}, {MC_PLANE_H6, 0, 0}},     /* b */
+    {{MC_PLANE_FULL, 1, 0}, {MC_PLANE_H6, 0, 0}},   /* c = ( H + b + 1 ) >> 1 */
+    {{MC_PLANE_FULL, 0, 0}, {MC_PLANE_V6, 0, 0}},   /* d = ( G + h + 1 ) >> 1 */
+    {{MC_PLANE_H6, 0, 0}, {MC_PLANE_V6, 0, 0}},     /* e = ( b + h + 1 ) >> 1 */
+    {{MC_PLANE_H6, 0, 0}, {MC_PLANE_HV6, 0, 0}},    /* f = ( b + j + 1 ) >> 1 */
+    {{MC_PLANE_H6, 0, 0}, {MC_PLANE_V6, 1, 0}},     /* g = ( b + m + 1 ) >> 1 */
+    {{MC_PLANE_V6, 0, 0}, {MC_PLANE_V6, 0, 0}},     /* h */
+    {{MC_PLANE_V6, 0, 0}, {MC_PLANE_HV6, 0, 0}},    /* i = ( h + j + 1 ) >> 1 */
+    {{MC_PLANE_HV6, 0, 0}, {MC_PLANE_HV6, 0, 0}},   /* j */
+    {{MC_PLANE_V6, 1, 0}, {MC_PLANE_HV6, 0, 0}},    /* k = ( j + m + 1 ) >> 1 */
+    {{MC_PLANE_FULL, 0, 1}, {MC_PLANE_V6, 0, 0}},   /* n = ( M + h + 1 ) >> 1 */
+    {{MC_PLANE_V6, 0, 0}, {MC_PLANE_H6, 0, 1}},     /* p = ( h + s + 1 ) >> 1 */
+    {{MC_PLANE_HV6, 0, 0}, {MC_PLANE_H6, 0, 1}},    /* q = ( j + s + 1 ) >> 1 */
+    {{MC_PLANE_V6, 1, 0}, {MC_PLANE_H6, 0, 1}},     /* r = ( m + s + 1 ) >> 1 */
+};
+
+/**
+ * @brief the table index of the block width, 0 for 16, 1 for 8 and 2 for 4, or 0 for 8, 1 for 4 and 2 for 2 of chroma
+ */
+static inline int32_t width_index(int32_t width, int32_t max_width) { return width == max_width ? 0 : (width == max_width / 2 ? 1 : 2); }
+
+#define BIT_DEPTH 8
+#include "h264_inter_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 9
+#include "h264_inter_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 10
+#include "h264_inter_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 11
+#include "h264_inter_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 12
+#include "h264_inter_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 13
+#include "h264_inter_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 14
+#include "h264_inter_pred_template.h"
+#undef BIT_DEPTH
+
+void init_inter_pred_funcs(InterPredFuncs* funcs, int32_t BitDepth, int32_t cpu_flags) {
+    switch (BitDepth) {
+        case 9:
+            init_inter_pred_funcs_9_c(funcs);
+            break;
+        case 10:
+            init_inter_pred_funcs_10_c(funcs);
+            break;
+        case 11:
+            init_inter_pred_funcs_11_c(funcs);
+            break;
+        case 12:
+            init_inter_pred_funcs_12_c(funcs);
+            break;
+        case 13:
+            init_inter_pred_funcs_13_c(funcs);
+            break;
+        case 14:
+            init_inter_pred_funcs_14_c(funcs);
+            break;
+        default:
+            init_inter_pred_funcs_8_c(funcs);
+            break;
+    }
+
+    /* the SIMD kernels are written for the 8-bit samples */
+    if (cpu_flags && BitDepth == 8) {
+        init_inter_pred_funcs_x86(funcs, cpu_flags);
+    }
+}
+
+void derivation_for_explicit_weights(SliceHeader* header) {
+    PredWeights* weights = &header->pred_weights;
+    const PredWeightTable* pwt = &header->pred_weight_table;
+    PPS* pps = header->pps;
+    SPS* sps = header->sps;
+    int32_t slice_type = header->slice_type % 5;
+
+    if (slice_type == SLICE_TYPE_P || slice_type == SLICE_TYPE_SP) {
+        weights->weighted_mode = pps->weighted_pred_flag;
+    } else if (slice_type == SLICE_TYPE_B) {
+        weights->weighted_mode = pps->weighted_bipred_idc;
+    } else {
+        weights->weighted_mode = 0;
+    }
+
+    /* the implicit weights are derived with the reference picture lists, see derivation_for_implicit_weights() */
+    if (weights->weighted_mode != 1) {
+        weights->logWD[0] = weights->logWD[1] = weights->logWD[2] = 5;
+        return;
+    }
+
+    /* equations 8-282 to 8-287, the offsets are scaled by ( 1 << ( BitDepth - 8 ) ) */
+    weights->logWD[0] = (int32_t)pwt->luma_log2_weight_denom;
+    weights->logWD[1] = (int32_t)pwt->chroma_log2_weight_denom;
+    weights->logWD[2] = (int32_t)pwt->chroma_log2_weight_denom;
+
+    int32_t num_refs[2] = {(int32_t)header->num_ref_idx_l0_active_minus1 + 1, slice_type == SLICE_TYPE_B ? (int32_t)header->num_ref_idx_l1_active_minus1 + 1 : 0};
+    int32_t luma_shift = (int32_t)sps->BitDepthY - 8;
+    int32_t chroma_shift = (int32_t)sps->BitDepthC - 8;
+
+    for (int32_t i = 0; i < num_refs[0]; i++) {
+        weights->w[0][i][0] = (int16_t)pwt->luma_weight_l0[i];
+        weights->o[0][i][0] = (int16_t)(pwt->luma_offset_l0[i] * (1 << luma_shift));
+        for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+            weights->w[0][i][1 + iCbCr] = (int16_t)(sps->ChromaArrayType ? pwt->chroma_weight_l0[i][iCbCr] : 1);
+            weights->o[0][i][1 + iCbCr] = (int16_t)(sps->ChromaArrayType ? pwt->chroma_offset_l0[i][iCbCr] * (1 << chroma_shift) : 0);
+        }
+    }
+
+    for (int32_t i = 0; i < num_refs[1]; i++) {
+        weights->w[1][i][0] = (int16_t)pwt->luma_weight_l1[i];
+        weights->o[1][i][0] = (int16_t)(pwt->luma_offset_l1[i] * (1 << luma_shift));
+        for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+            weights->w[1][i][1 + iCbCr] = (int16_t)(sps->ChromaArrayType ? pwt->chroma_weight_l1[i][iCbCr] : 1);
+            weights->o[1][i][1 + iCbCr] = (int16_t)(sps->ChromaArrayType ? pwt->chroma_offset_l1[i][iCbCr] * (1 << chroma_shift) : 0);
+        }
+    }
+}
+
+void derivation_for_implicit_weights(PredWeights* weights, int32_t table, int32_t currPicOrField, const int32_t* poc_l0, const uint8_t* long_term_l0, int32_t num_l0,
+                                     const int32_t* poc_l1, const uint8_t* long_term_l1, int32_t num_l1) {
+    weights->logWD[0] = 5;
+    weights->logWD[1] = 5;
+    weights->logWD[2] = 5;
+
+    for (int32_t refIdxL0 = 0; refIdxL0 < num_l0; refIdxL0++) {
+        /* equation 8-201, tb does not depend on pic1 */
+        int32_t tb = clip3(-128, 127, currPicOrField - poc_l0[refIdxL0]);
+
+        for (int32_t refIdxL1 = 0; refIdxL1 < num_l1; refIdxL1++) {
+            int32_t diff = poc_l1[refIdxL1] - poc_l0[refIdxL0];
+            int32_t w1 = 32;
+
+            /* equations 8-197 to 8-200 and 8-293 to 8-295, the default weights are used for the long-term and the co-located pictures */
+            if (diff != 0 && !long_term_l0[refIdxL0] && !long_term_l1[refIdxL1]) {
+                int32_t td = clip3(-128, 127, diff);
+                int32_t tx = (16384 + abs(td / 2)) / td;
+                int32_t DistScaleFactor = clip3(-1024, 1023, (tb * tx + 32) >> 6);
+                if ((DistScaleFactor >> 2) >= -64 && (DistScaleFactor >> 2) <= 128) {
+                    w1 = DistScaleFactor >> 2;
+                }
+            }
+            weights->implicit_w1[table][refIdxL0][refIdxL1] = (int16_t)w1;
+        }
+    }
+}
+
+/**
+ * @brief the table index of the block width 16, 8, 4 and 2
+ */
+static inline int32_t weight_index(int32_t width) { return width == 16 ? 0 : (width == 8 ? 1 : (width == 4 ? 2 : 3)); }
+
+void weighted_sample_prediction(const InterPredFuncs* funcs, const PredWeights* weights, int32_t table, int32_t iCx, int32_t refIdxL0, int32_t refIdxL1, uint8_t* dst,
+                                int32_t dst_stride, const uint8_t* predPartL1, int32_t pred_stride, int32_t width, int32_t height) {
+    int32_t w = weight_index(width);
+    int32_t bipred = refIdxL0 >= 0 && refIdxL1 >= 0;
+    int32_t logWD = weights->logWD[iCx];
+
+    if (weights->weighted_mode == 1) {
+        /* equations 8-280 and 8-281, the field macroblocks of a MBAFF frame refer to the fields of the reference frames */
+        int32_t refIdxL0WP = table ? refIdxL0 >> 1 : refIdxL0;
+        int32_t refIdxL1WP = table ? refIdxL1 >> 1 : refIdxL1;
+
+        if (bipred) {
+            int32_t o = (weights->o[0][refIdxL0WP][iCx] + weights->o[1][refIdxL1WP][iCx] + 1) >> 1;
+            funcs->biweight[w](dst, dst_stride, predPartL1, pred_stride, height, logWD, weights->w[0][refIdxL0WP][iCx], weights->w[1][refIdxL1WP][iCx], o);
+        } else {
+            int32_t list = refIdxL0 >= 0 ? 0 : 1;
+            int32_t refIdxWP = list ? refIdxL1WP : refIdxL0WP;
+            int32_t weight = weights->w[list][refIdxWP][iCx];
+            int32_t offset = weights->o[list][refIdxWP][iCx];
+            /* the default weight and offset of luma_weight_lX_flag equal to 0 leave the prediction unchanged */
+            if (weight != 1 << logWD || offset != 0) {
+                funcs->weight[w](dst, dst_stride, height, logWD, weight, offset);
+            }
+        }
+        return;
+    }
+
+    if (!bipred) {
+        return;
+    }
+
+    /* the implicit weights of the reference pictures at equal distances are the default weights of equation 8-269 */
+    if (weights->weighted_mode == 2 && weights->implicit_w1[table][refIdxL0][refIdxL1] != 32) {
+        int32_t w1 = weights->implicit_w1[table][refIdxL0][refIdxL1];
+        funcs->biweight[w](dst, dst_stride, predPartL1, pred_stride, height, 5, 64 - w1, w1, 0);
+    } else {
+        funcs->avg[w](dst, dst_stride, predPartL1, pred_stride, height);
+    }
+}
@@ -0,0 +1,262 @@
+/*
+ * the scalar inter prediction kernels and the motion compensation of one bit depth, included by h264_inter_pred.c for every bit depth with BIT_DEPTH defined
+ */
+
+#include "h264_bit_depth_template.h"
+
+static inline void FUNCC(copy)(pixel* dst, int32_t dst_stride, const pixel* src, int32_t src_stride, int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        memcpy(dst + y * dst_stride, src + y * src_stride, width * sizeof(pixel));
+    }
+}
+
+static inline void FUNCC(avg)(pixel* dst, int32_t dst_stride, const pixel* src, int32_t src_stride, int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            dst[y * dst_stride + x] = (pixel)((dst[y * dst_stride + x] + src[y * src_stride + x] + 1) >> 1);
+        }
+    }
+}
+
+static inline void FUNCC(luma_h6)(pixel* dst, int32_t dst_stride, const pixel* src, int32_t src_stride, int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            const pixel* p = src + y * src_stride + x;
+            dst[y * dst_stride + x] = (pixel)CLIP1((TAP6(p, 1) + 16) >> 5);
+        }
+    }
+}
+
+static inline void FUNCC(luma_v6)(pixel* dst, int32_t dst_stride, const pixel* src, int32_t src_stride, int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            const pixel* p = src + y * src_stride + x;
+            dst[y * dst_stride + x] = (pixel)CLIP1((TAP6(p, src_stride) + 16) >> 5);
+        }
+    }
+}
+
+static inline void FUNCC(luma_hv6)(pixel* dst, int32_t dst_stride, const pixel* src, int32_t src_stride, int32_t width, int32_t height) {
+    /* the intermediate values b1 of the rows -2..height+2, equation 8-247 filters them vertically */
+    int32_t b1[21 * 16];
+    for (int32_t y = 0; y < height + 5; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            const pixel* p = src + (y - 2) * src_stride + x;
+            b1[y * 16 + x] = TAP6(p, 1);
+        }
+    }
+
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            const int32_t* p = b1 + (y + 2) * 16 + x;
+            dst[y * dst_stride + x] = (pixel)CLIP1((TAP6(p, 16) + 512) >> 10);
+        }
+    }
+}
+
+/* the kernels of the fixed block widths */
+#define DEFINE_MC_C(name, width)                                                                                           \
+    static void FUNCC(name##_##width)(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height) { \
+        FUNCC(name)((pixel*)dst, dst_stride, (const pixel*)src, src_stride, width, height);                                \
+    }
+
+DEFINE_MC_C(copy, 16)
+DEFINE_MC_C(copy, 8)
+DEFINE_MC_C(copy, 4)
+DEFINE_MC_C(avg, 16)
+DEFINE_MC_C(avg, 8)
+DEFINE_MC_C(avg, 4)
+DEFINE_MC_C(avg, 2)
+DEFINE_MC_C(luma_h6, 16)
+DEFINE_MC_C(luma_h6, 8)
+DEFINE_MC_C(luma_h6, 4)
+DEFINE_MC_C(luma_v6, 16)
+DEFINE_MC_C(luma_v6, 8)
+DEFINE_MC_C(luma_v6, 4)
+DEFINE_MC_C(luma_hv6, 16)
+DEFINE_MC_C(luma_hv6, 8)
+DEFINE_MC_C(luma_hv6, 4)
+
+#undef DEFINE_MC_C
+
+/* 8.4.2.2.2 Chroma sample interpolation process, equation 8-266 */
+static inline void FUNCC(chroma)(pixel* dst, int32_t dst_stride, const pixel* src, int32_t src_stride, int32_t width, int32_t height, int32_t xFrac, int32_t yFrac) {
+    int32_t wA = (8 - xFrac) * (8 - yFrac);
+    int32_t wB = xFrac * (8 - yFrac);
+    int32_t wC = (8 - xFrac) * yFrac;
+    int32_t wD = xFrac * yFrac;
+
+    for (int32_t y = 0; y < height; y++) {
+        const pixel* p = src + y * src_stride;
+        for (int32_t x = 0; x < width; x++) {
+            dst[y * dst_stride + x] = (pixel)((wA * p[x] + wB * p[x + 1] + wC * p[src_stride + x] + wD * p[src_stride + x + 1] + 32) >> 6);
+        }
+    }
+}
+
+#define DEFINE_CHROMA_C(width)                                                                                                                      \
+    static void FUNCC(chroma_##width)(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height, int32_t xFrac, int32_t yFrac) { \
+        FUNCC(chroma)((pixel*)dst, dst_stride, (const pixel*)src, src_stride, width, height, xFrac, yFrac);                                        \
+    }
+
+DEFINE_CHROMA_C(8)
+DEFINE_CHROMA_C(4)
+DEFINE_CHROMA_C(2)
+
+#undef DEFINE_CHROMA_C
+
+/* 8.4.2.3.2 Weighted sample prediction process, equation 8-270 */
+static inline void FUNCC(weight)(pixel* dst, int32_t stride, int32_t width, int32_t height, int32_t logWD, int32_t w, int32_t o) {
+    int32_t rounding = logWD >= 1 ? 1 << (logWD - 1) : 0;
+
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            dst[y * stride + x] = (pixel)CLIP1(((dst[y * stride + x] * w + rounding) >> logWD) + o);
+        }
+    }
+}
+
+/* equation 8-272 */
+static inline void FUNCC(biweight)(pixel* dst, int32_t dst_stride, const pixel* src, int32_t src_stride, int32_t width, int32_t height, int32_t logWD, int32_t w0,
+                                   int32_t w1, int32_t o) {
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            int32_t sum = dst[y * dst_stride + x] * w0 + src[y * src_stride + x] * w1;
+            dst[y * dst_stride + x] = (pixel)CLIP1(((sum + (1 << logWD)) >> (logWD + 1)) + o);
+        }
+    }
+}
+
+#define DEFINE_WEIGHT_C(width)                                                                                                                       \
+    static void FUNCC(weight_##width)(uint8_t* dst, int32_t stride, int32_t height, int32_t logWD, int32_t w, int32_t o) {                           \
+        FUNCC(weight)((pixel*)dst, stride, width, height, logWD, w, o);                                                                             \
+    }                                                                                                                                                \
+    static void FUNCC(biweight_##width)(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height, int32_t logWD,     \
+                                        int32_t w0, int32_t w1, int32_t o) {                                                                         \
+        FUNCC(biweight)((pixel*)dst, dst_stride, (const pixel*)src, src_stride, width, height, logWD, w0, w1, o);                                   \
+    }
+
+DEFINE_WEIGHT_C(16)
+DEFINE_WEIGHT_C(8)
+DEFINE_WEIGHT_C(4)
+DEFINE_WEIGHT_C(2)
+
+#undef DEFINE_WEIGHT_C
+
+static void FUNCC(init_inter_pred_funcs)(InterPredFuncs* funcs) {
+    funcs->copy[0] = FUNCC(copy_16);
+    funcs->copy[1] = FUNCC(copy_8);
+    funcs->copy[2] = FUNCC(copy_4);
+    funcs->avg[0] = FUNCC(avg_16);
+    funcs->avg[1] = FUNCC(avg_8);
+    funcs->avg[2] = FUNCC(avg_4);
+    funcs->avg[3] = FUNCC(avg_2);
+    funcs->luma_h6[0] = FUNCC(luma_h6_16);
+    funcs->luma_h6[1] = FUNCC(luma_h6_8);
+    funcs->luma_h6[2] = FUNCC(luma_h6_4);
+    funcs->luma_v6[0] = FUNCC(luma_v6_16);
+    funcs->luma_v6[1] = FUNCC(luma_v6_8);
+    funcs->luma_v6[2] = FUNCC(luma_v6_4);
+    funcs->luma_hv6[0] = FUNCC(luma_hv6_16);
+    funcs->luma_hv6[1] = FUNCC(luma_hv6_8);
+    funcs->luma_hv6[2] = FUNCC(luma_hv6_4);
+    funcs->chroma[0] = FUNCC(chroma_8);
+    funcs->chroma[1] = FUNCC(chroma_4);
+    funcs->chroma[2] = FUNCC(chroma_2);
+    funcs->weight[0] = FUNCC(weight_16);
+    funcs->weight[1] = FUNCC(weight_8);
+    funcs->weight[2] = FUNCC(weight_4);
+    funcs->weight[3] = FUNCC(weight_2);
+    funcs->biweight[0] = FUNCC(biweight_16);
+    funcs->biweight[1] = FUNCC(biweight_8);
+    funcs->biweight[2] = FUNCC(biweight_4);
+    funcs->biweight[3] = FUNCC(biweight_2);
+}
+
+#if SAMPLE_FUNCS_INSTANCE
+void FUNC16(pad_reference_lines)(pixel* plane, int32_t stride, int32_t width, int32_t height, int32_t border, int32_t first_line, int32_t end_line) {
+    for (int32_t y = first_line; y < end_line; y++) {
+        pixel* row = plane + y * stride;
+#if BIT_DEPTH == 8
+        memset(row - border, row[0], border);
+        memset(row + width, row[width - 1], border);
+#else
+        for (int32_t x = 0; x < border; x++) {
+            row[x - border] = row[0];
+            row[width + x] = row[width - 1];
+        }
+#endif
+    }
+
+    /* the rows above and below repeat the first and the last row including their padded ends */
+    for (int32_t y = 1; y <= border && first_line == 0 && end_line > 0; y++) {
+        memcpy(plane - y * stride - border, plane - border, (width + 2 * border) * sizeof(pixel));
+    }
+    for (int32_t y = 1; y <= border && end_line == height && first_line < end_line; y++) {
+        memcpy(plane + (height - 1 + y) * stride - border, plane + (height - 1) * stride - border, (width + 2 * border) * sizeof(pixel));
+    }
+}
+
+void FUNC16(pad_reference_plane)(pixel* plane, int32_t stride, int32_t width, int32_t height, int32_t border) {
+    FUNC16(pad_reference_lines)(plane, stride, width, height, border, 0, height);
+}
+
+/**
+ * @brief produce one of the planes of Table 8-12 for the block
+ */
+static inline void FUNC16(mc_luma_plane)(const InterPredFuncs* funcs, int32_t w, McPlaneRef plane, pixel* dst, int32_t dst_stride, const pixel* src, int32_t src_stride,
+                                         int32_t height) {
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* p = (const uint8_t*)(src + plane.dy * src_stride + plane.dx);
+
+    switch (plane.plane) {
+    case MC_PLANE_FULL:
+        funcs->copy[w](d, dst_stride, p, src_stride, height);
+        break;
+    case MC_PLANE_H6:
+        funcs->luma_h6[w](d, dst_stride, p, src_stride, height);
+        break;
+    case MC_PLANE_V6:
+        funcs->luma_v6[w](d, dst_stride, p, src_stride, height);
+        break;
+    default:
+        funcs->luma_hv6[w](d, dst_stride, p, src_stride, height);
+        break;
+    }
+}
+
+void FUNC16(mc_luma)(const InterPredFuncs* funcs, pixel* dst, int32_t dst_stride, const pixel* ref, int32_t ref_stride, int32_t PicWidthInSamplesL,
+                     int32_t PicHeightInSamplesL, int32_t xAL, int32_t yAL, const int16_t mvLX[2], int32_t width, int32_t height) {
+    /* equations 8-227 to 8-230, the blocks in the border are moved to its inner edge where every sample of the filter window is a copy of the edge sample */
+    int32_t xIntL = clip3(2 - H264_MC_LUMA_BORDER, PicWidthInSamplesL + 2, xAL + (mvLX[0] >> 2));
+    int32_t yIntL = clip3(2 - H264_MC_LUMA_BORDER, PicHeightInSamplesL + 2, yAL + (mvLX[1] >> 2));
+    int32_t frac = (mvLX[1] & 3) * 4 + (mvLX[0] & 3);
+    int32_t w = width_index(width, 16);
+
+    const pixel* src = ref + yIntL * ref_stride + xIntL;
+    const McPlaneRef* planes = g_qpel_planes[frac];
+
+    FUNC16(mc_luma_plane)(funcs, w, planes[0], dst, dst_stride, src, ref_stride, height);
+
+    /* the quarter sample positions average a second plane */
+    if (frac & 5) {
+        pixel tmp[16 * 16];
+        FUNC16(mc_luma_plane)(funcs, w, planes[1], tmp, 16, src, ref_stride, height);
+        funcs->avg[w]((uint8_t*)dst, dst_stride, (const uint8_t*)tmp, 16, height);
+    }
+}
+
+void FUNC16(mc_chroma)(const InterPredFuncs* funcs, pixel* dst, int32_t dst_stride, const pixel* ref, int32_t ref_stride, int32_t PicWidthInSamplesC,
+                       int32_t PicHeightInSamplesC, int32_t xAC, int32_t yAC, const int16_t mvCLX[2], int32_t SubHeightC, int32_t width, int32_t height) {
+    /* equations 8-229 to 8-232, the vertical motion vector of ChromaArrayType 2 is in quarter samples */
+    int32_t xIntC = xAC + (mvCLX[0] >> 3);
+    int32_t xFracC = mvCLX[0] & 7;
+    int32_t yIntC = SubHeightC == 1 ? yAC + (mvCLX[1] >> 2) : yAC + (mvCLX[1] >> 3);
+    int32_t yFracC = SubHeightC == 1 ? (mvCLX[1] & 3) << 1 : mvCLX[1] & 7;
+
+    xIntC = clip3(-H264_MC_CHROMA_BORDER, PicWidthInSamplesC - 1, xIntC);
+    yIntC = clip3(-H264_MC_CHROMA_BORDER, PicHeightInSamplesC - 1, yIntC);
+
+    funcs->chroma[width_index(width, 8)]((uint8_t*)dst, dst_stride, (const uint8_t*)(ref + yIntC * ref_stride + xIntC), ref_stride, height, xFracC, yFracC);
+}
+#endif
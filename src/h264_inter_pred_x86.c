@@ -0,0 +1,499 @@
+#include "h264decoder/h264_inter_pred.h"
+
+#include <string.h>
+
+#include "h264decoder/h264_cpu.h"
+
+/**
+ * the SSE2, SSSE3 and AVX2 motion compensation kernels. the 6-tap filters work on 16-bit lanes, the intermediate value b1 of equation 8-241 fits in 16 bits and the
+ * centre sample j of equation 8-247 is filtered with 32-bit sums. a 128-bit register holds 8 samples of a row, the 4-sample blocks compute 8 samples and store 4,
+ * which reads at most 13 samples right of the block, within H264_MC_LUMA_BORDER.
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+static inline int32_t load32(const uint8_t* p) {
+    int32_t v = 0;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline void store32(uint8_t* p, int32_t v) { memcpy(p, &v, 4); }
+
+/**
+ * @brief store the low 4, 8 or all 16 bytes
+ */
+static inline TARGET_SSE2 void store_width_sse2(uint8_t* dst, __m128i v, int32_t width) {
+    if (width == 4) {
+        store32(dst, _mm_cvtsi128_si32(v));
+    } else if (width == 8) {
+        _mm_storel_epi64((__m128i*)dst, v);
+    } else {
+        _mm_storeu_si128((__m128i*)dst, v);
+    }
+}
+
+/**
+ * @brief ( a + f ) - 5 * ( b + e ) + 20 * ( c + d ) of the 16-bit lanes
+ */
+static inline TARGET_SSE2 __m128i tap6_epi16_sse2(__m128i a, __m128i b, __m128i c, __m128i d, __m128i e, __m128i f) {
+    __m128i sum = _mm_add_epi16(a, f);
+    sum = _mm_sub_epi16(sum, _mm_mullo_epi16(_mm_add_epi16(b, e), _mm_set1_epi16(5)));
+    return _mm_add_epi16(sum, _mm_mullo_epi16(_mm_add_epi16(c, d), _mm_set1_epi16(20)));
+}
+
+/**
+ * @brief the intermediate values b1 of 8 samples of a row, p points to G of the first sample
+ */
+static inline TARGET_SSE2 __m128i h6_row8_sse2(const uint8_t* p) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i u = _mm_loadu_si128((const __m128i*)(p - 2));
+
+    return tap6_epi16_sse2(_mm_unpacklo_epi8(u, zero), _mm_unpacklo_epi8(_mm_srli_si128(u, 1), zero), _mm_unpacklo_epi8(_mm_srli_si128(u, 2), zero),
+                           _mm_unpacklo_epi8(_mm_srli_si128(u, 3), zero), _mm_unpacklo_epi8(_mm_srli_si128(u, 4), zero), _mm_unpacklo_epi8(_mm_srli_si128(u, 5), zero));
+}
+
+/**
+ * @brief Clip1( ( x1 + 16 ) >> 5 ) of equations 8-243 and 8-244 for two vectors of 8 values
+ */
+static inline TARGET_SSE2 __m128i round_half_sse2(__m128i lo, __m128i hi) {
+    __m128i rounding = _mm_set1_epi16(16);
+    return _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(lo, rounding), 5), _mm_srai_epi16(_mm_add_epi16(hi, rounding), 5));
+}
+
+static inline TARGET_SSE2 void copy_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        if (width == 16) {
+            _mm_storeu_si128((__m128i*)(dst + y * dst_stride), _mm_loadu_si128((const __m128i*)(src + y * src_stride)));
+        } else if (width == 8) {
+            _mm_storel_epi64((__m128i*)(dst + y * dst_stride), _mm_loadl_epi64((const __m128i*)(src + y * src_stride)));
+        } else {
+            store32(dst + y * dst_stride, load32(src + y * src_stride));
+        }
+    }
+}
+
+static inline TARGET_SSE2 void avg_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* d = dst + y * dst_stride;
+        const uint8_t* s = src + y * src_stride;
+        if (width == 16) {
+            _mm_storeu_si128((__m128i*)d, _mm_avg_epu8(_mm_loadu_si128((const __m128i*)d), _mm_loadu_si128((const __m128i*)s)));
+        } else if (width == 8) {
+            _mm_storel_epi64((__m128i*)d, _mm_avg_epu8(_mm_loadl_epi64((const __m128i*)d), _mm_loadl_epi64((const __m128i*)s)));
+        } else {
+            store32(d, _mm_cvtsi128_si32(_mm_avg_epu8(_mm_cvtsi32_si128(load32(d)), _mm_cvtsi32_si128(load32(s)))));
+        }
+    }
+}
+
+static inline TARGET_SSE2 void luma_h6_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* p = src + y * src_stride;
+        __m128i lo = h6_row8_sse2(p);
+        __m128i hi = width == 16 ? h6_row8_sse2(p + 8) : lo;
+        store_width_sse2(dst + y * dst_stride, round_half_sse2(lo, hi), width);
+    }
+}
+
+static inline TARGET_SSE2 void luma_v6_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t width, int32_t height) {
+    __m128i zero = _mm_setzero_si128();
+
+    /* the columns 0..7 and 8..15 are filtered in turn, the six rows of the filter window slide down */
+    for (int32_t x = 0; x < width; x += 8) {
+        const uint8_t* p = src + x - 2 * src_stride;
+        __m128i r[6];
+        for (int32_t k = 0; k < 5; k++) {
+            r[k] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + k * src_stride)), zero);
+        }
+
+        for (int32_t y = 0; y < height; y++) {
+            r[5] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + (y + 5) * src_stride)), zero);
+            __m128i h1 = tap6_epi16_sse2(r[0], r[1], r[2], r[3], r[4], r[5]);
+            store_width_sse2(dst + y * dst_stride + x, round_half_sse2(h1, h1), width == 4 ? 4 : 8);
+
+            r[0] = r[1];
+            r[1] = r[2];
+            r[2] = r[3];
+            r[3] = r[4];
+            r[4] = r[5];
+        }
+    }
+}
+
+/**
+ * @brief the centre sample j of 8 samples from the intermediate values b1 of the rows -2..3, Clip1( ( j1 + 512 ) >> 10 ) of equation 8-247
+ */
+static inline TARGET_SSE2 __m128i hv6_row8_sse2(const int16_t* b1, int32_t stride) {
+    __m128i r0 = _mm_loadu_si128((const __m128i*)b1);
+    __m128i r1 = _mm_loadu_si128((const __m128i*)(b1 + stride));
+    __m128i r2 = _mm_loadu_si128((const __m128i*)(b1 + 2 * stride));
+    __m128i r3 = _mm_loadu_si128((const __m128i*)(b1 + 3 * stride));
+    __m128i r4 = _mm_loadu_si128((const __m128i*)(b1 + 4 * stride));
+    __m128i r5 = _mm_loadu_si128((const __m128i*)(b1 + 5 * stride));
+
+    /* the pair sums fit in 16 bits, the weighted sum j1 needs 32 bits */
+    __m128i p05 = _mm_add_epi16(r0, r5);
+    __m128i p14 = _mm_add_epi16(r1, r4);
+    __m128i p23 = _mm_add_epi16(r2, r3);
+    __m128i w_05_23 = _mm_set1_epi32((20 << 16) | 1);
+    __m128i w_14 = _mm_set1_epi32(0xFFFB);
+    __m128i zero = _mm_setzero_si128();
+    __m128i rounding = _mm_set1_epi32(512);
+
+    __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(p05, p23), w_05_23), _mm_madd_epi16(_mm_unpacklo_epi16(p14, zero), w_14));
+    __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(p05, p23), w_05_23), _mm_madd_epi16(_mm_unpackhi_epi16(p14, zero), w_14));
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, rounding), 10);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, rounding), 10);
+
+    __m128i j = _mm_packs_epi32(lo, hi);
+    return _mm_packus_epi16(j, j);
+}
+
+static inline TARGET_SSE2 void luma_hv6_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t width, int32_t height) {
+    /* the intermediate values b1 of the rows -2..height+2 */
+    int16_t b1[21 * 16];
+    int32_t columns = width == 16 ? 16 : 8;
+
+    for (int32_t y = 0; y < height + 5; y++) {
+        for (int32_t x = 0; x < columns; x += 8) {
+            _mm_storeu_si128((__m128i*)(b1 + y * 16 + x), h6_row8_sse2(src + (y - 2) * src_stride + x));
+        }
+    }
+
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < columns; x += 8) {
+            store_width_sse2(dst + y * dst_stride + x, hv6_row8_sse2(b1 + y * 16 + x, 16), width == 4 ? 4 : 8);
+        }
+    }
+}
+
+#define DEFINE_MC_SSE2(name, width)                                                                                                      \
+    static TARGET_SSE2 void name##_##width##_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height) { \
+        name##_sse2(dst, dst_stride, src, src_stride, width, height);                                                                    \
+    }
+
+DEFINE_MC_SSE2(copy, 16)
+DEFINE_MC_SSE2(copy, 8)
+DEFINE_MC_SSE2(avg, 16)
+DEFINE_MC_SSE2(avg, 8)
+DEFINE_MC_SSE2(avg, 4)
+DEFINE_MC_SSE2(luma_h6, 16)
+DEFINE_MC_SSE2(luma_h6, 8)
+DEFINE_MC_SSE2(luma_h6, 4)
+DEFINE_MC_SSE2(luma_v6, 16)
+DEFINE_MC_SSE2(luma_v6, 8)
+DEFINE_MC_SSE2(luma_v6, 4)
+DEFINE_MC_SSE2(luma_hv6, 16)
+DEFINE_MC_SSE2(luma_hv6, 8)
+DEFINE_MC_SSE2(luma_hv6, 4)
+
+#undef DEFINE_MC_SSE2
+
+/**
+ * @brief load 4, 8 or 16 samples of a row
+ */
+static inline TARGET_SSE2 __m128i load_width_sse2(const uint8_t* src, int32_t width) {
+    if (width == 4) {
+        return _mm_cvtsi32_si128(load32(src));
+    } else if (width == 8) {
+        return _mm_loadl_epi64((const __m128i*)src);
+    }
+    return _mm_loadu_si128((const __m128i*)src);
+}
+
+/* equation 8-270, the products of the 8-bit samples and the weights fit in 16 bits */
+static inline TARGET_SSE2 void weight_sse2(uint8_t* dst, int32_t stride, int32_t width, int32_t height, int32_t logWD, int32_t w, int32_t o) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i weight = _mm_set1_epi16((int16_t)w);
+    __m128i offset = _mm_set1_epi16((int16_t)o);
+    __m128i rounding = _mm_set1_epi16((int16_t)(logWD >= 1 ? 1 << (logWD - 1) : 0));
+    __m128i shift = _mm_cvtsi32_si128(logWD);
+
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* d = dst + y * stride;
+        __m128i p = load_width_sse2(d, width);
+        __m128i lo = _mm_sra_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), weight), rounding), shift);
+        __m128i hi = _mm_sra_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), weight), rounding), shift);
+        store_width_sse2(d, _mm_packus_epi16(_mm_adds_epi16(lo, offset), _mm_adds_epi16(hi, offset)), width);
+    }
+}
+
+/* equation 8-272, the samples of the two predictions are interleaved and weighted with 32-bit sums by pmaddwd */
+static inline TARGET_SSE2 void biweight_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t width, int32_t height, int32_t logWD,
+                                             int32_t w0, int32_t w1, int32_t o) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i weights = _mm_set1_epi32((int32_t)(((uint32_t)w1 << 16) | ((uint32_t)w0 & 0xFFFF)));
+    __m128i offset = _mm_set1_epi16((int16_t)o);
+    __m128i rounding = _mm_set1_epi32(1 << logWD);
+    __m128i shift = _mm_cvtsi32_si128(logWD + 1);
+
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* d = dst + y * dst_stride;
+        __m128i p0 = load_width_sse2(d, width);
+        __m128i p1 = load_width_sse2(src + y * src_stride, width);
+        __m128i result[2];
+
+        for (int32_t half = 0; half < 2; half++) {
+            __m128i a = half ? _mm_unpackhi_epi8(p0, zero) : _mm_unpacklo_epi8(p0, zero);
+            __m128i b = half ? _mm_unpackhi_epi8(p1, zero) : _mm_unpacklo_epi8(p1, zero);
+            __m128i lo = _mm_sra_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), weights), rounding), shift);
+            __m128i hi = _mm_sra_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), weights), rounding), shift);
+            result[half] = _mm_adds_epi16(_mm_packs_epi32(lo, hi), offset);
+            if (width < 16) {
+                result[1] = result[0];
+                break;
+            }
+        }
+        store_width_sse2(d, _mm_packus_epi16(result[0], result[1]), width);
+    }
+}
+
+#define DEFINE_WEIGHT_SSE2(width)                                                                                                          \
+    static TARGET_SSE2 void weight_##width##_sse2(uint8_t* dst, int32_t stride, int32_t height, int32_t logWD, int32_t w, int32_t o) {     \
+        weight_sse2(dst, stride, width, height, logWD, w, o);                                                                              \
+    }                                                                                                                                      \
+    static TARGET_SSE2 void biweight_##width##_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height, \
+                                                    int32_t logWD, int32_t w0, int32_t w1, int32_t o) {                                    \
+        biweight_sse2(dst, dst_stride, src, src_stride, width, height, logWD, w0, w1, o);                                                  \
+    }
+
+DEFINE_WEIGHT_SSE2(16)
+DEFINE_WEIGHT_SSE2(8)
+DEFINE_WEIGHT_SSE2(4)
+
+#undef DEFINE_WEIGHT_SSE2
+
+/* equation 8-266 with the weights in 16-bit lanes */
+static inline TARGET_SSE2 void chroma_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t width, int32_t height, int32_t xFrac,
+                                           int32_t yFrac) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i wA = _mm_set1_epi16((int16_t)((8 - xFrac) * (8 - yFrac)));
+    __m128i wB = _mm_set1_epi16((int16_t)(xFrac * (8 - yFrac)));
+    __m128i wC = _mm_set1_epi16((int16_t)((8 - xFrac) * yFrac));
+    __m128i wD = _mm_set1_epi16((int16_t)(xFrac * yFrac));
+    __m128i rounding = _mm_set1_epi16(32);
+
+    __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)src), zero);
+    __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src + 1)), zero);
+
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* p = src + (y + 1) * src_stride;
+        __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), zero);
+        __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + 1)), zero);
+
+        __m128i sum = _mm_add_epi16(_mm_mullo_epi16(a, wA), _mm_mullo_epi16(b, wB));
+        sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_mullo_epi16(c, wC), _mm_mullo_epi16(d, wD)));
+        sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 6);
+        store_width_sse2(dst + y * dst_stride, _mm_packus_epi16(sum, sum), width);
+
+        a = c;
+        b = d;
+    }
+}
+
+static TARGET_SSE2 void chroma_8_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height, int32_t xFrac, int32_t yFrac) {
+    chroma_sse2(dst, dst_stride, src, src_stride, 8, height, xFrac, yFrac);
+}
+static TARGET_SSE2 void chroma_4_sse2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height, int32_t xFrac, int32_t yFrac) {
+    chroma_sse2(dst, dst_stride, src, src_stride, 4, height, xFrac, yFrac);
+}
+
+/* equation 8-266 with the sample pairs ( A, B ) and ( C, D ) interleaved for pmaddubsw */
+static inline TARGET_SSSE3 void chroma_ssse3(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t width, int32_t height, int32_t xFrac,
+                                             int32_t yFrac) {
+    __m128i wAB = _mm_set1_epi16((int16_t)(((xFrac * (8 - yFrac)) << 8) | ((8 - xFrac) * (8 - yFrac))));
+    __m128i wCD = _mm_set1_epi16((int16_t)(((xFrac * yFrac) << 8) | ((8 - xFrac) * yFrac)));
+    __m128i rounding = _mm_set1_epi16(32);
+
+    __m128i ab = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)src), _mm_loadl_epi64((const __m128i*)(src + 1)));
+
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* p = src + (y + 1) * src_stride;
+        __m128i cd = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_loadl_epi64((const __m128i*)(p + 1)));
+
+        __m128i sum = _mm_add_epi16(_mm_maddubs_epi16(ab, wAB), _mm_maddubs_epi16(cd, wCD));
+        sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 6);
+        store_width_sse2(dst + y * dst_stride, _mm_packus_epi16(sum, sum), width);
+
+        ab = cd;
+    }
+}
+
+static TARGET_SSSE3 void chroma_8_ssse3(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height, int32_t xFrac, int32_t yFrac) {
+    chroma_ssse3(dst, dst_stride, src, src_stride, 8, height, xFrac, yFrac);
+}
+static TARGET_SSSE3 void chroma_4_ssse3(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height, int32_t xFrac, int32_t yFrac) {
+    chroma_ssse3(dst, dst_stride, src, src_stride, 4, height, xFrac, yFrac);
+}
+
+/**
+ * @brief the 16 samples of a row with 8-bit samples widened to 16-bit lanes
+ */
+static inline TARGET_AVX2 __m256i load16_epu8_avx2(const uint8_t* p) { return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p)); }
+
+static inline TARGET_AVX2 __m256i tap6_epi16_avx2(__m256i a, __m256i b, __m256i c, __m256i d, __m256i e, __m256i f) {
+    __m256i sum = _mm256_add_epi16(a, f);
+    sum = _mm256_sub_epi16(sum, _mm256_mullo_epi16(_mm256_add_epi16(b, e), _mm256_set1_epi16(5)));
+    return _mm256_add_epi16(sum, _mm256_mullo_epi16(_mm256_add_epi16(c, d), _mm256_set1_epi16(20)));
+}
+
+static inline TARGET_AVX2 __m256i h6_row16_avx2(const uint8_t* p) {
+    return tap6_epi16_avx2(load16_epu8_avx2(p - 2), load16_epu8_avx2(p - 1), load16_epu8_avx2(p), load16_epu8_avx2(p + 1), load16_epu8_avx2(p + 2),
+                           load16_epu8_avx2(p + 3));
+}
+
+/**
+ * @brief pack the 16 lanes to bytes and store them
+ */
+static inline TARGET_AVX2 void store16_epi16_avx2(uint8_t* dst, __m256i v) {
+    /* the packed bytes of the two 128-bit lanes are moved to the low lane */
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(packed));
+}
+
+static TARGET_AVX2 void luma_h6_16_avx2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        __m256i b1 = h6_row16_avx2(src + y * src_stride);
+        store16_epi16_avx2(dst + y * dst_stride, _mm256_srai_epi16(_mm256_add_epi16(b1, _mm256_set1_epi16(16)), 5));
+    }
+}
+
+static TARGET_AVX2 void luma_v6_16_avx2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height) {
+    const uint8_t* p = src - 2 * src_stride;
+    __m256i r[6];
+    for (int32_t k = 0; k < 5; k++) {
+        r[k] = load16_epu8_avx2(p + k * src_stride);
+    }
+
+    for (int32_t y = 0; y < height; y++) {
+        r[5] = load16_epu8_avx2(p + (y + 5) * src_stride);
+        __m256i h1 = tap6_epi16_avx2(r[0], r[1], r[2], r[3], r[4], r[5]);
+        store16_epi16_avx2(dst + y * dst_stride, _mm256_srai_epi16(_mm256_add_epi16(h1, _mm256_set1_epi16(16)), 5));
+
+        r[0] = r[1];
+        r[1] = r[2];
+        r[2] = r[3];
+        r[3] = r[4];
+        r[4] = r[5];
+    }
+}
+
+static TARGET_AVX2 void luma_hv6_16_avx2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height) {
+    __m256i w_05_23 = _mm256_set1_epi32((20 << 16) | 1);
+    __m256i w_14 = _mm256_set1_epi32(0xFFFB);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i rounding = _mm256_set1_epi32(512);
+
+    /* the intermediate values b1 of the rows of the filter window slide down */
+    __m256i r[6];
+    for (int32_t k = 0; k < 5; k++) {
+        r[k] = h6_row16_avx2(src + (k - 2) * src_stride);
+    }
+
+    for (int32_t y = 0; y < height; y++) {
+        r[5] = h6_row16_avx2(src + (y + 3) * src_stride);
+
+        __m256i p05 = _mm256_add_epi16(r[0], r[5]);
+        __m256i p14 = _mm256_add_epi16(r[1], r[4]);
+        __m256i p23 = _mm256_add_epi16(r[2], r[3]);
+
+        /* the unpacked halves of each 128-bit lane are packed back in the same order */
+        __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(p05, p23), w_05_23), _mm256_madd_epi16(_mm256_unpacklo_epi16(p14, zero), w_14));
+        __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(p05, p23), w_05_23), _mm256_madd_epi16(_mm256_unpackhi_epi16(p14, zero), w_14));
+        lo = _mm256_srai_epi32(_mm256_add_epi32(lo, rounding), 10);
+        hi = _mm256_srai_epi32(_mm256_add_epi32(hi, rounding), 10);
+        store16_epi16_avx2(dst + y * dst_stride, _mm256_packs_epi32(lo, hi));
+
+        r[0] = r[1];
+        r[1] = r[2];
+        r[2] = r[3];
+        r[3] = r[4];
+        r[4] = r[5];
+    }
+}
+
+static TARGET_AVX2 void weight_16_avx2(uint8_t* dst, int32_t stride, int32_t height, int32_t logWD, int32_t w, int32_t o) {
+    __m256i weight = _mm256_set1_epi16((int16_t)w);
+    __m256i offset = _mm256_set1_epi16((int16_t)o);
+    __m256i rounding = _mm256_set1_epi16((int16_t)(logWD >= 1 ? 1 << (logWD - 1) : 0));
+    __m128i shift = _mm_cvtsi32_si128(logWD);
+
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* d = dst + y * stride;
+        __m256i v = _mm256_sra_epi16(_mm256_add_epi16(_mm256_mullo_epi16(load16_epu8_avx2(d), weight), rounding), shift);
+        store16_epi16_avx2(d, _mm256_adds_epi16(v, offset));
+    }
+}
+
+static TARGET_AVX2 void biweight_16_avx2(uint8_t* dst, int32_t dst_stride, const uint8_t* src, int32_t src_stride, int32_t height, int32_t logWD, int32_t w0, int32_t w1,
+                                         int32_t o) {
+    __m256i weights = _mm256_set1_epi32((int32_t)(((uint32_t)w1 << 16) | ((uint32_t)w0 & 0xFFFF)));
+    __m256i offset = _mm256_set1_epi16((int16_t)o);
+    __m256i rounding = _mm256_set1_epi32(1 << logWD);
+    __m128i shift = _mm_cvtsi32_si128(logWD + 1);
+
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* d = dst + y * dst_stride;
+        __m256i a = load16_epu8_avx2(d);
+        __m256i b = load16_epu8_avx2(src + y * src_stride);
+        __m256i lo = _mm256_sra_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weights), rounding), shift);
+        __m256i hi = _mm256_sra_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weights), rounding), shift);
+        store16_epi16_avx2(d, _mm256_adds_epi16(_mm256_packs_epi32(lo, hi), offset));
+    }
+}
+
+void init_inter_pred_funcs_x86(InterPredFuncs* funcs, int32_t cpu_flags) {
+    if (cpu_flags & H264_CPU_SSE2) {
+        funcs->copy[0] = copy_16_sse2;
+        funcs->copy[1] = copy_8_sse2;
+        funcs->avg[0] = avg_16_sse2;
+        funcs->avg[1] = avg_8_sse2;
+        funcs->avg[2] = avg_4_sse2;
+        funcs->luma_h6[0] = luma_h6_16_sse2;
+        funcs->luma_h6[1] = luma_h6_8_sse2;
+        funcs->luma_h6[2] = luma_h6_4_sse2;
+        funcs->luma_v6[0] = luma_v6_16_sse2;
+        funcs->luma_v6[1] = luma_v6_8_sse2;
+        funcs->luma_v6[2] = luma_v6_4_sse2;
+        funcs->luma_hv6[0] = luma_hv6_16_sse2;
+        funcs->luma_hv6[1] = luma_hv6_8_sse2;
+        funcs->luma_hv6[2] = luma_hv6_4_sse2;
+        funcs->chroma[0] = chroma_8_sse2;
+        funcs->chroma[1] = chroma_4_sse2;
+        funcs->weight[0] = weight_16_sse2;
+        funcs->weight[1] = weight_8_sse2;
+        funcs->weight[2] = weight_4_sse2;
+        funcs->biweight[0] = biweight_16_sse2;
+        funcs->biweight[1] = biweight_8_sse2;
+        funcs->biweight[2] = biweight_4_sse2;
+    }
+
+    if (cpu_flags & H264_CPU_SSSE3) {
+        funcs->chroma[0] = chroma_8_ssse3;
+        funcs->chroma[1] = chroma_4_ssse3;
+    }
+
+    if (cpu_flags & H264_CPU_AVX2) {
+        funcs->luma_h6[0] = luma_h6_16_avx2;
+        funcs->luma_v6[0] = luma_v6_16_avx2;
+        funcs->luma_hv6[0] = luma_hv6_16_avx2;
+        funcs->weight[0] = weight_16_avx2;
+        funcs->biweight[0] = biweight_16_avx2;
+    }
+}
+
+#else
+
+void init_inter_pred_funcs_x86(InterPredFuncs* funcs, int32_t cpu_flags) {
+    (void)funcs;
+    (void)cpu_flags;
+}
+
+#endif
@@ -0,0 +1,156 @@
+#include "h264decoder/h264_intra_pred.h"
+
+#include <string.h>
+
+#include "h264decoder/h264_locations_neighbours.h"
+#include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_math.h"
+
+#define BIT_DEPTH 8
+#include "h264_intra_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 9
+#include "h264_intra_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 10
+#include "h264_intra_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 11
+#include "h264_intra_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 12
+#include "h264_intra_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 13
+#include "h264_intra_pred_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 14
+#include "h264_intra_pred_template.h"
+#undef BIT_DEPTH
+
+void init_intra_pred_funcs(IntraPredFuncs* funcs, int32_t BitDepth, int32_t cpu_flags) {
+    switch (BitDepth) {
+        case 9:
+            init_intra_pred_funcs_9_c(funcs);
+            break;
+        case 10:
+            init_intra_pred_funcs_10_c(funcs);
+            break;
+        case 11:
+            init_intra_pred_funcs_11_c(funcs);
+            break;
+        case 12:
+            init_intra_pred_funcs_12_c(funcs);
+            break;
+        case 13:
+            init_intra_pred_funcs_13_c(funcs);
+            break;
+        case 14:
+            init_intra_pred_funcs_14_c(funcs);
+            break;
+        default:
+            init_intra_pred_funcs_8_c(funcs);
+            break;
+    }
+
+    /* the SIMD kernels are written for the 8-bit samples */
+    if (cpu_flags && BitDepth == 8) {
+        init_intra_pred_funcs_x86(funcs, cpu_flags);
+    }
+}
+
+/**
+ * @brief get intraMxMPredModeN of the neighbouring block
+ * @see 8.3.1.1 Derivation process for Intra4x4PredMode
+ * @see 8.3.2.1 Derivation process for Intra8x8PredMode
+ *
+ * @param picture pointer to the FrameOrField
+ * @param mb the current macroblock
+ * @param mbAddrN the neighbouring macroblock address, negative if it is not available
+ * @param luma4x4BlkIdxN the 4x4 luma block of mbAddrN whose mode is used when mbAddrN is coded in Intra_4x4
+ * @param luma8x8BlkIdxN the 8x8 luma block of mbAddrN whose mode is used when mbAddrN is coded in Intra_8x8
+ * @param out_mode output parameter. intraMxMPredModeN, -1 if dcPredModePredictedFlag is equal to 1
+ */
+static void intra_mxm_pred_mode_n(FrameOrField* picture, const MacroBlock* mb, int32_t mbAddrN, int32_t luma4x4BlkIdxN, int32_t luma8x8BlkIdxN, int32_t* out_mode) {
+    /* the macroblock mbAddrN is not available or it is coded in Inter prediction mode and constrained_intra_pred_flag is equal to 1 */
+    if (mbAddrN < 0) {
+        *out_mode = -1;
+        return;
+    }
+
+    const MacroBlock* mbN = &picture->mb_list[mbAddrN];
+    if (!mb_is_intra(mbN) && mb->constrained_intra_pred_flag) {
+        *out_mode = -1;
+        return;
+    }
+
+    if (mbN->mb_pred_type == Intra_4x4) {
+        *out_mode = mb_intra_nxn_pred_mode(mbN, luma4x4BlkIdxN);
+    } else if (mbN->mb_pred_type == Intra_8x8) {
+        /* Intra8x8PredMode is stored in the 4 blocks of the 8x8 block */
+        *out_mode = mb_intra_nxn_pred_mode(mbN, luma8x8BlkIdxN * 4);
+    } else {
+        /* the macroblock mbAddrN is not coded in Intra_4x4 or Intra_8x8 macroblock prediction mode, intraMxMPredModeN is Intra_4x4_DC */
+        *out_mode = Intra_NxN_DC;
+    }
+}
+
+int derivation_for_intra_nxn_pred_modes(FrameOrField* picture, SliceHeader* header, int32_t CurrMbAddr) {
+    MacroBlock* mb = &picture->mb_list[CurrMbAddr];
+    MacroBlockScratch* scratch = picture->mb_scratch;
+    int32_t MbaffFrameFlag = header->MbaffFrameFlag;
+    int32_t currMbFrameFlag = !bitset_get(picture->mb_field_flags, CurrMbAddr);
+    int32_t PicWidthInMbs = (int32_t)header->sps->PicWidthInMbs;
+
+    int32_t mbAddrA = -1;
+    int32_t mbAddrB = -1;
+    int32_t blkA = -1;
+    int32_t blkB = -1;
+    int32_t modeA = 0;
+    int32_t modeB = 0;
+
+    mb->intra_pred_modes = 0;
+
+    if (mb->mb_pred_type == Intra_4x4) {
+        for (int32_t luma4x4BlkIdx = 0; luma4x4BlkIdx < 16; luma4x4BlkIdx++) {
+            /* 6.4.11.4 Derivation process for neighbouring 4x4 luma blocks */
+            neighbouring_4x4_luma_block(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, picture->mb_slice_ids, picture->mb_field_flags, luma4x4BlkIdx, &mbAddrA,
+                                        &blkA, &mbAddrB, &blkB);
+
+            intra_mxm_pred_mode_n(picture, mb, mbAddrA, blkA, blkA >> 2, &modeA);
+            intra_mxm_pred_mode_n(picture, mb, mbAddrB, blkB, blkB >> 2, &modeB);
+
+            int32_t predIntra4x4PredMode = (modeA < 0 || modeB < 0) ? Intra_NxN_DC : codec_min(modeA, modeB);
+            int32_t mode = predIntra4x4PredMode;
+
+            if (!scratch->prev_intra4x4_pred_mode_flag[luma4x4BlkIdx]) {
+                int32_t rem = scratch->rem_intra4x4_pred_mode[luma4x4BlkIdx];
+                mode = rem < predIntra4x4PredMode ? rem : rem + 1;
+            }
+
+            mb->intra_pred_modes |= (uint64_t)mode << (luma4x4BlkIdx * 4);
+        }
+    } else if (mb->mb_pred_type == Intra_8x8) {
+        for (int32_t luma8x8BlkIdx = 0; luma8x8BlkIdx < 4; luma8x8BlkIdx++) {
+            /* 6.4.11.2 Derivation process for neighbouring 8x8 luma block */
+            neighbouring_8x8_luma_block(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, picture->mb_slice_ids, picture->mb_field_flags, luma8x8BlkIdx, &mbAddrA,
+                                        &blkA, &mbAddrB, &blkB);
+
+            /* the 4x4 block luma8x8BlkIdxN * 4 + n of an Intra_4x4 macroblock, n is 1 for A and 2 for B */
+            intra_mxm_pred_mode_n(picture, mb, mbAddrA, blkA * 4 + 1, blkA, &modeA);
+            intra_mxm_pred_mode_n(picture, mb, mbAddrB, blkB * 4 + 2, blkB, &modeB);
+
+            int32_t predIntra8x8PredMode = (modeA < 0 || modeB < 0) ? Intra_NxN_DC : codec_min(modeA, modeB);
+            int32_t mode = predIntra8x8PredMode;
+
+            if (!scratch->prev_intra8x8_pred_mode_flag[luma8x8BlkIdx]) {
+                int32_t rem = scratch->rem_intra8x8_pred_mode[luma8x8BlkIdx];
+                mode = rem < predIntra8x8PredMode ? rem : rem + 1;
+            }
+
+            mb->intra_pred_modes |= ((uint64_t)mode * 0x1111u) << (luma8x8BlkIdx * 16);
+        }
+    }
+
+    return ERR_OK;
+}
@@ -0,0 +1,462 @@
+/*
+ * the scalar intra prediction kernels of one bit depth, included by h264_intra_pred.c for every bit depth with BIT_DEPTH defined
+ */
+
+#include "h264_bit_depth_template.h"
+
+#if SAMPLE_FUNCS_INSTANCE
+static inline void FUNC16(fill_pixels)(pixel* dst, int32_t value, int32_t count) {
+#if BIT_DEPTH == 8
+    memset(dst, value, count);
+#else
+    for (int32_t i = 0; i < count; i++) {
+        dst[i] = (pixel)value;
+    }
+#endif
+}
+
+void FUNC16(intra_pred_substitute_top_right)(IntraPredSamplesT* samples, int32_t N) {
+    if ((samples->available & (H264_INTRA_AVAIL_TOP | H264_INTRA_AVAIL_TOP_RIGHT)) != H264_INTRA_AVAIL_TOP) {
+        return;
+    }
+
+    FUNC16(fill_pixels)(samples->top + N, samples->top[N - 1], N);
+    samples->available |= H264_INTRA_AVAIL_TOP_RIGHT;
+}
+
+void FUNC16(intra8x8_filter_reference_samples)(const IntraPredSamplesT* samples, IntraPredSamplesT* out_filtered) {
+    const pixel* top = samples->top;
+    const pixel* left = samples->left;
+    int32_t has_top = samples->available & H264_INTRA_AVAIL_TOP;
+    int32_t has_left = samples->available & H264_INTRA_AVAIL_LEFT;
+    int32_t has_top_left = samples->available & H264_INTRA_AVAIL_TOP_LEFT;
+
+    *out_filtered = *samples;
+
+    /* p[ x, -1 ], with x = 0..15, the samples above right are substituted when they are not available */
+    if (has_top) {
+        if (has_top_left) {
+            out_filtered->top[0] = (pixel)((samples->top_left + 2 * top[0] + top[1] + 2) >> 2);
+        } else {
+            out_filtered->top[0] = (pixel)((3 * top[0] + top[1] + 2) >> 2);
+        }
+
+        for (int32_t x = 1; x < 15; x++) {
+            out_filtered->top[x] = (pixel)((top[x - 1] + 2 * top[x] + top[x + 1] + 2) >> 2);
+        }
+        out_filtered->top[15] = (pixel)((top[14] + 3 * top[15] + 2) >> 2);
+    }
+
+    /* p[ -1, -1 ] */
+    if (has_top_left) {
+        if (has_top && has_left) {
+            out_filtered->top_left = (pixel)((top[0] + 2 * samples->top_left + left[0] + 2) >> 2);
+        } else if (has_top) {
+            out_filtered->top_left = (pixel)((3 * samples->top_left + top[0] + 2) >> 2);
+        } else if (has_left) {
+            out_filtered->top_left = (pixel)((3 * samples->top_left + left[0] + 2) >> 2);
+        }
+    }
+
+    /* p[ -1, y ], with y = 0..7 */
+    if (has_left) {
+        if (has_top_left) {
+            out_filtered->left[0] = (pixel)((samples->top_left + 2 * left[0] + left[1] + 2) >> 2);
+        } else {
+            out_filtered->left[0] = (pixel)((3 * left[0] + left[1] + 2) >> 2);
+        }
+
+        for (int32_t y = 1; y < 7; y++) {
+            out_filtered->left[y] = (pixel)((left[y - 1] + 2 * left[y] + left[y + 1] + 2) >> 2);
+        }
+        out_filtered->left[7] = (pixel)((left[6] + 3 * left[7] + 2) >> 2);
+    }
+}
+#endif
+
+/* p[ x, -1 ] and p[ -1, y ] of the edge array built by load_edge(), x and y are in the range of -1 to 15 */
+#define P_TOP(x) edge[17 + (x)]
+#define P_LEFT(y) edge[15 - (y)]
+
+/**
+ * @brief put the neighbouring samples into one array so that the prediction equations of clause 8.3 can address p[ x, -1 ] and p[ -1, y ] directly,
+ * edge[ 15 - y ] is p[ -1, y ], edge[ 16 ] is p[ -1, -1 ] and edge[ 17 + x ] is p[ x, -1 ]
+ *
+ * @param samples the neighbouring samples
+ * @param edge output parameter. the edge array of 33 samples
+ */
+static void FUNCC(load_edge)(const IntraPredSamplesT* samples, pixel* edge) {
+    for (int32_t i = 0; i < 16; i++) {
+        edge[15 - i] = samples->left[i];
+        edge[17 + i] = samples->top[i];
+    }
+    edge[16] = samples->top_left;
+}
+
+/**
+ * @brief the DC value of the NxN block
+ * @see 8.3.1.2.3 Specification of Intra_4x4_DC prediction mode
+ * @see 8.3.2.2.4 Specification of Intra_8x8_DC prediction mode
+ * @see 8.3.3.3 Specification of Intra_16x16_DC prediction mode
+ *
+ * @param samples the neighbouring samples
+ * @param N the block size, 4, 8 or 16
+ * @param log2N Log2( N )
+ * @return int32_t the DC value
+ */
+static int32_t FUNCC(nxn_dc_value)(const IntraPredSamplesT* samples, int32_t N, int32_t log2N) {
+    int32_t sum_top = 0;
+    int32_t sum_left = 0;
+
+    for (int32_t i = 0; i < N; i++) {
+        sum_top += samples->top[i];
+        sum_left += samples->left[i];
+    }
+
+    int32_t has_top = samples->available & H264_INTRA_AVAIL_TOP;
+    int32_t has_left = samples->available & H264_INTRA_AVAIL_LEFT;
+    if (has_top && has_left) {
+        return (sum_top + sum_left + N) >> (log2N + 1);
+    } else if (has_left) {
+        return (sum_left + (N >> 1)) >> log2N;
+    } else if (has_top) {
+        return (sum_top + (N >> 1)) >> log2N;
+    }
+
+    return PIXEL_HALF; /* 1 << ( BitDepthY - 1 ) */
+}
+
+static void FUNCC(pred_vertical)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        memcpy(dst + y * stride, samples->top, width * sizeof(pixel));
+    }
+}
+
+static void FUNCC(pred_horizontal)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        FUNC16(fill_pixels)(dst + y * stride, samples->left[y], width);
+    }
+}
+
+static void FUNCC(pred_nxn_dc)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t N) {
+    int32_t dc = FUNCC(nxn_dc_value)(samples, N, N == 4 ? 2 : (N == 8 ? 3 : 4));
+    for (int32_t y = 0; y < N; y++) {
+        FUNC16(fill_pixels)(dst + y * stride, dc, N);
+    }
+}
+
+static void FUNCC(pred_nxn_diagonal_down_left)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t N) {
+    pixel edge[33];
+    FUNCC(load_edge)(samples, edge);
+
+    for (int32_t y = 0; y < N; y++) {
+        for (int32_t x = 0; x < N; x++) {
+            if (x == N - 1 && y == N - 1) {
+                dst[y * stride + x] = (pixel)((P_TOP(2 * N - 2) + 3 * P_TOP(2 * N - 1) + 2) >> 2);
+            } else {
+                dst[y * stride + x] = (pixel)((P_TOP(x + y) + 2 * P_TOP(x + y + 1) + P_TOP(x + y + 2) + 2) >> 2);
+            }
+        }
+    }
+}
+
+static void FUNCC(pred_nxn_diagonal_down_right)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t N) {
+    pixel edge[33];
+    FUNCC(load_edge)(samples, edge);
+
+    for (int32_t y = 0; y < N; y++) {
+        for (int32_t x = 0; x < N; x++) {
+            if (x > y) {
+                dst[y * stride + x] = (pixel)((P_TOP(x - y - 2) + 2 * P_TOP(x - y - 1) + P_TOP(x - y) + 2) >> 2);
+            } else if (x < y) {
+                dst[y * stride + x] = (pixel)((P_LEFT(y - x - 2) + 2 * P_LEFT(y - x - 1) + P_LEFT(y - x) + 2) >> 2);
+            } else {
+                dst[y * stride + x] = (pixel)((P_TOP(0) + 2 * P_TOP(-1) + P_LEFT(0) + 2) >> 2);
+            }
+        }
+    }
+}
+
+static void FUNCC(pred_nxn_vertical_right)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t N) {
+    pixel edge[33];
+    FUNCC(load_edge)(samples, edge);
+
+    for (int32_t y = 0; y < N; y++) {
+        for (int32_t x = 0; x < N; x++) {
+            int32_t zVR = 2 * x - y;
+            int32_t value;
+
+            if (zVR >= 0 && (zVR & 1) == 0) {
+                value = (P_TOP(x - (y >> 1) - 1) + P_TOP(x - (y >> 1)) + 1) >> 1;
+            } else if (zVR >= 0) {
+                value = (P_TOP(x - (y >> 1) - 2) + 2 * P_TOP(x - (y >> 1) - 1) + P_TOP(x - (y >> 1)) + 2) >> 2;
+            } else if (zVR == -1) {
+                value = (P_LEFT(0) + 2 * P_LEFT(-1) + P_TOP(0) + 2) >> 2;
+            } else {
+                value = (P_LEFT(y - 2 * x - 1) + 2 * P_LEFT(y - 2 * x - 2) + P_LEFT(y - 2 * x - 3) + 2) >> 2;
+            }
+            dst[y * stride + x] = (pixel)value;
+        }
+    }
+}
+
+static void FUNCC(pred_nxn_horizontal_down)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t N) {
+    pixel edge[33];
+    FUNCC(load_edge)(samples, edge);
+
+    for (int32_t y = 0; y < N; y++) {
+        for (int32_t x = 0; x < N; x++) {
+            int32_t zHD = 2 * y - x;
+            int32_t value;
+
+            if (zHD >= 0 && (zHD & 1) == 0) {
+                value = (P_LEFT(y - (x >> 1) - 1) + P_LEFT(y - (x >> 1)) + 1) >> 1;
+            } else if (zHD >= 0) {
+                value = (P_LEFT(y - (x >> 1) - 2) + 2 * P_LEFT(y - (x >> 1) - 1) + P_LEFT(y - (x >> 1)) + 2) >> 2;
+            } else if (zHD == -1) {
+                value = (P_LEFT(0) + 2 * P_LEFT(-1) + P_TOP(0) + 2) >> 2;
+            } else {
+                value = (P_TOP(x - 2 * y - 1) + 2 * P_TOP(x - 2 * y - 2) + P_TOP(x - 2 * y - 3) + 2) >> 2;
+            }
+            dst[y * stride + x] = (pixel)value;
+        }
+    }
+}
+
+static void FUNCC(pred_nxn_vertical_left)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t N) {
+    pixel edge[33];
+    FUNCC(load_edge)(samples, edge);
+
+    for (int32_t y = 0; y < N; y++) {
+        for (int32_t x = 0; x < N; x++) {
+            int32_t i = x + (y >> 1);
+            if ((y & 1) == 0) {
+                dst[y * stride + x] = (pixel)((P_TOP(i) + P_TOP(i + 1) + 1) >> 1);
+            } else {
+                dst[y * stride + x] = (pixel)((P_TOP(i) + 2 * P_TOP(i + 1) + P_TOP(i + 2) + 2) >> 2);
+            }
+        }
+    }
+}
+
+static void FUNCC(pred_nxn_horizontal_up)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t N) {
+    pixel edge[33];
+    FUNCC(load_edge)(samples, edge);
+
+    for (int32_t y = 0; y < N; y++) {
+        for (int32_t x = 0; x < N; x++) {
+            int32_t zHU = x + 2 * y;
+            int32_t i = y + (x >> 1);
+            int32_t value;
+
+            if (zHU < 2 * N - 3 && (zHU & 1) == 0) {
+                value = (P_LEFT(i) + P_LEFT(i + 1) + 1) >> 1;
+            } else if (zHU < 2 * N - 3) {
+                value = (P_LEFT(i) + 2 * P_LEFT(i + 1) + P_LEFT(i + 2) + 2) >> 2;
+            } else if (zHU == 2 * N - 3) {
+                value = (P_LEFT(N - 2) + 3 * P_LEFT(N - 1) + 2) >> 2;
+            } else {
+                value = P_LEFT(N - 1);
+            }
+            dst[y * stride + x] = (pixel)value;
+        }
+    }
+}
+
+/* 8.3.3.4 Specification of Intra_16x16_Plane prediction mode */
+static void FUNCC(pred_plane)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples) {
+    pixel edge[33];
+    FUNCC(load_edge)(samples, edge);
+
+    int32_t H = 0;
+    int32_t V = 0;
+    for (int32_t i = 0; i < 8; i++) {
+        H += (i + 1) * (P_TOP(8 + i) - P_TOP(6 - i));
+        V += (i + 1) * (P_LEFT(8 + i) - P_LEFT(6 - i));
+    }
+
+    int32_t a = 16 * (P_LEFT(15) + P_TOP(15));
+    int32_t b = (5 * H + 32) >> 6;
+    int32_t c = (5 * V + 32) >> 6;
+
+    for (int32_t y = 0; y < 16; y++) {
+        for (int32_t x = 0; x < 16; x++) {
+            dst[y * stride + x] = (pixel)CLIP1((a + b * (x - 7) + c * (y - 7) + 16) >> 5);
+        }
+    }
+}
+
+/**
+ * @brief Specification of Intra_Chroma_DC prediction mode
+ * @see 8.3.4.1 Specification of Intra_Chroma_DC prediction mode
+ *
+ * @param dst the upper-left sample of the chroma block
+ * @param stride the row stride
+ * @param samples the neighbouring samples
+ * @param MbHeightC the height of the chroma block, 8 or 16
+ */
+static void FUNCC(pred_chroma_dc)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t MbHeightC) {
+    int32_t has_top = samples->available & H264_INTRA_AVAIL_TOP;
+    int32_t has_left = samples->available & H264_INTRA_AVAIL_LEFT;
+
+    for (int32_t chroma4x4BlkIdx = 0; chroma4x4BlkIdx < MbHeightC / 2; chroma4x4BlkIdx++) {
+        int32_t xO = (chroma4x4BlkIdx & 1) * 4;
+        int32_t yO = (chroma4x4BlkIdx >> 1) * 4;
+        int32_t sum_top = 0;
+        int32_t sum_left = 0;
+        int32_t dc = PIXEL_HALF;
+
+        for (int32_t i = 0; i < 4; i++) {
+            sum_top += samples->top[xO + i];
+            sum_left += samples->left[yO + i];
+        }
+
+        if ((xO == 0 && yO == 0) || (xO > 0 && yO > 0)) {
+            if (has_top && has_left) {
+                dc = (sum_top + sum_left + 4) >> 3;
+            } else if (has_left) {
+                dc = (sum_left + 2) >> 2;
+            } else if (has_top) {
+                dc = (sum_top + 2) >> 2;
+            }
+        } else if (xO > 0 && yO == 0) {
+            if (has_top) {
+                dc = (sum_top + 2) >> 2;
+            } else if (has_left) {
+                dc = (sum_left + 2) >> 2;
+            }
+        } else {
+            if (has_left) {
+                dc = (sum_left + 2) >> 2;
+            } else if (has_top) {
+                dc = (sum_top + 2) >> 2;
+            }
+        }
+
+        for (int32_t y = 0; y < 4; y++) {
+            FUNC16(fill_pixels)(dst + (yO + y) * stride + xO, dc, 4);
+        }
+    }
+}
+
+/**
+ * @brief Specification of Intra_Chroma_Plane prediction mode for ChromaArrayType 1 and 2
+ * @see 8.3.4.4 Specification of Intra_Chroma_Plane prediction mode
+ *
+ * @param dst the upper-left sample of the chroma block
+ * @param stride the row stride
+ * @param samples the neighbouring samples
+ * @param MbHeightC the height of the chroma block, 8 or 16
+ */
+static void FUNCC(pred_chroma_plane)(pixel* dst, int32_t stride, const IntraPredSamplesT* samples, int32_t MbHeightC) {
+    pixel edge[33];
+    FUNCC(load_edge)(samples, edge);
+
+    /* xCF = 4 * ( chroma_format_idc = = 3 ), yCF = 4 * ( chroma_format_idc != 1 ) */
+    int32_t yCF = MbHeightC == 16 ? 4 : 0;
+    int32_t H = 0;
+    int32_t V = 0;
+
+    for (int32_t i = 0; i < 4; i++) {
+        H += (i + 1) * (P_TOP(4 + i) - P_TOP(2 - i));
+    }
+    for (int32_t i = 0; i < 4 + yCF; i++) {
+        V += (i + 1) * (P_LEFT(4 + yCF + i) - P_LEFT(2 + yCF - i));
+    }
+
+    int32_t a = 16 * (P_LEFT(MbHeightC - 1) + P_TOP(7));
+    int32_t b = (34 * H + 32) >> 6;
+    int32_t c = ((34 - 29 * (MbHeightC == 16)) * V + 32) >> 6;
+
+    for (int32_t y = 0; y < MbHeightC; y++) {
+        for (int32_t x = 0; x < 8; x++) {
+            dst[y * stride + x] = (pixel)CLIP1((a + b * (x - 3) + c * (y - 3 - yCF) + 16) >> 5);
+        }
+    }
+}
+
+/* the kernels of the function table, the sample pointers of the table are reinterpreted as the samples of the bit depth */
+#define DEFINE_PRED(name, helper, ...)                                                                       \
+    static void FUNCC(name)(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {                \
+        FUNCC(helper)((pixel*)dst, stride, (const IntraPredSamplesT*)samples, __VA_ARGS__);                 \
+    }
+
+#define DEFINE_PRED_NXN(name)                           \
+    DEFINE_PRED(pred4x4_##name, pred_nxn_##name, 4)     \
+    DEFINE_PRED(pred8x8_##name, pred_nxn_##name, 8)
+
+DEFINE_PRED(pred4x4_vertical, pred_vertical, 4, 4)
+DEFINE_PRED(pred8x8_vertical, pred_vertical, 8, 8)
+DEFINE_PRED(pred4x4_horizontal, pred_horizontal, 4, 4)
+DEFINE_PRED(pred8x8_horizontal, pred_horizontal, 8, 8)
+DEFINE_PRED_NXN(dc)
+DEFINE_PRED_NXN(diagonal_down_left)
+DEFINE_PRED_NXN(diagonal_down_right)
+DEFINE_PRED_NXN(vertical_right)
+DEFINE_PRED_NXN(horizontal_down)
+DEFINE_PRED_NXN(vertical_left)
+DEFINE_PRED_NXN(horizontal_up)
+
+/* 8.3.3.1 to 8.3.3.4, Intra_16x16 */
+DEFINE_PRED(pred16x16_vertical, pred_vertical, 16, 16)
+DEFINE_PRED(pred16x16_horizontal, pred_horizontal, 16, 16)
+DEFINE_PRED(pred16x16_dc, pred_nxn_dc, 16)
+
+static void FUNCC(pred16x16_plane)(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    FUNCC(pred_plane)((pixel*)dst, stride, (const IntraPredSamplesT*)samples);
+}
+
+/* the chroma kernels, 8.3.4.2 Intra_Chroma_Horizontal and 8.3.4.3 Intra_Chroma_Vertical are the sample copies of clause 8.3.3 */
+DEFINE_PRED(pred_chroma420_dc, pred_chroma_dc, 8)
+DEFINE_PRED(pred_chroma420_horizontal, pred_horizontal, 8, 8)
+DEFINE_PRED(pred_chroma420_vertical, pred_vertical, 8, 8)
+DEFINE_PRED(pred_chroma420_plane, pred_chroma_plane, 8)
+
+DEFINE_PRED(pred_chroma422_dc, pred_chroma_dc, 16)
+DEFINE_PRED(pred_chroma422_horizontal, pred_horizontal, 8, 16)
+DEFINE_PRED(pred_chroma422_vertical, pred_vertical, 8, 16)
+DEFINE_PRED(pred_chroma422_plane, pred_chroma_plane, 16)
+
+#undef DEFINE_PRED_NXN
+#undef DEFINE_PRED
+
+static void FUNCC(init_intra_pred_funcs)(IntraPredFuncs* funcs) {
+    funcs->pred4x4[Intra_NxN_Vertical] = FUNCC(pred4x4_vertical);
+    funcs->pred4x4[Intra_NxN_Horizontal] = FUNCC(pred4x4_horizontal);
+    funcs->pred4x4[Intra_NxN_DC] = FUNCC(pred4x4_dc);
+    funcs->pred4x4[Intra_NxN_Diagonal_Down_Left] = FUNCC(pred4x4_diagonal_down_left);
+    funcs->pred4x4[Intra_NxN_Diagonal_Down_Right] = FUNCC(pred4x4_diagonal_down_right);
+    funcs->pred4x4[Intra_NxN_Vertical_Right] = FUNCC(pred4x4_vertical_right);
+    funcs->pred4x4[Intra_NxN_Horizontal_Down] = FUNCC(pred4x4_horizontal_down);
+    funcs->pred4x4[Intra_NxN_Vertical_Left] = FUNCC(pred4x4_vertical_left);
+    funcs->pred4x4[Intra_NxN_Horizontal_Up] = FUNCC(pred4x4_horizontal_up);
+
+    funcs->pred8x8[Intra_NxN_Vertical] = FUNCC(pred8x8_vertical);
+    funcs->pred8x8[Intra_NxN_Horizontal] = FUNCC(pred8x8_horizontal);
+    funcs->pred8x8[Intra_NxN_DC] = FUNCC(pred8x8_dc);
+    funcs->pred8x8[Intra_NxN_Diagonal_Down_Left] = FUNCC(pred8x8_diagonal_down_left);
+    funcs->pred8x8[Intra_NxN_Diagonal_Down_Right] = FUNCC(pred8x8_diagonal_down_right);
+    funcs->pred8x8[Intra_NxN_Vertical_Right] = FUNCC(pred8x8_vertical_right);
+    funcs->pred8x8[Intra_NxN_Horizontal_Down] = FUNCC(pred8x8_horizontal_down);
+    funcs->pred8x8[Intra_NxN_Vertical_Left] = FUNCC(pred8x8_vertical_left);
+    funcs->pred8x8[Intra_NxN_Horizontal_Up] = FUNCC(pred8x8_horizontal_up);
+
+    funcs->pred16x16[Intra_16x16_Vertical] = FUNCC(pred16x16_vertical);
+    funcs->pred16x16[Intra_16x16_Horizontal] = FUNCC(pred16x16_horizontal);
+    funcs->pred16x16[Intra_16x16_DC] = FUNCC(pred16x16_dc);
+    funcs->pred16x16[Intra_16x16_Plane] = FUNCC(pred16x16_plane);
+
+    funcs->pred_chroma[0][Intra_Chroma_DC] = FUNCC(pred_chroma420_dc);
+    funcs->pred_chroma[0][Intra_Chroma_Horizontal] = FUNCC(pred_chroma420_horizontal);
+    funcs->pred_chroma[0][Intra_Chroma_Vertical] = FUNCC(pred_chroma420_vertical);
+    funcs->pred_chroma[0][Intra_Chroma_Plane] = FUNCC(pred_chroma420_plane);
+
+    funcs->pred_chroma[1][Intra_Chroma_DC] = FUNCC(pred_chroma422_dc);
+    funcs->pred_chroma[1][Intra_Chroma_Horizontal] = FUNCC(pred_chroma422_horizontal);
+    funcs->pred_chroma[1][Intra_Chroma_Vertical] = FUNCC(pred_chroma422_vertical);
+    funcs->pred_chroma[1][Intra_Chroma_Plane] = FUNCC(pred_chroma422_plane);
+
+}
+
+#undef P_TOP
+#undef P_LEFT
@@ -0,0 +1,455 @@
+#include "h264decoder/h264_intra_pred.h"
+
+#include <string.h>
+
+#include "h264decoder/h264_cpu.h"
+
+/**
+ * the SSE2, SSSE3 and AVX2 intra prediction kernels. the functions are compiled for their instruction set with the target attribute, so the library does not require
+ * the instruction sets at build time, init_intra_pred_funcs_x86() installs the kernels which the CPU supports.
+ *
+ * the Intra_4x4 kernels stay scalar, a 4x4 block is a single 32-bit store per row. the Intra_8x8 Vertical_Right, Horizontal_Down and Horizontal_Up kernels stay scalar as
+ * well, their samples are gathered from both edges in a different order per row.
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+/**
+ * @brief the 3-tap filter ( a + 2 * b + c + 2 ) >> 2 of the bytes, computed without widening as avg( b, avg( a, c ) - ( ( a ^ c ) & 1 ) )
+ */
+static inline TARGET_SSE2 __m128i lowpass3_sse2(__m128i a, __m128i b, __m128i c) {
+    __m128i avg_ac = _mm_sub_epi8(_mm_avg_epu8(a, c), _mm_and_si128(_mm_xor_si128(a, c), _mm_set1_epi8(1)));
+    return _mm_avg_epu8(avg_ac, b);
+}
+
+/**
+ * @brief the DC value of the NxN block from the sums of the samples, see nxn_dc_value()
+ */
+static inline int32_t dc_value(const IntraPredSamples* samples, int32_t sum_top, int32_t sum_left, int32_t log2N) {
+    int32_t has_top = samples->available & H264_INTRA_AVAIL_TOP;
+    int32_t has_left = samples->available & H264_INTRA_AVAIL_LEFT;
+
+    if (has_top && has_left) {
+        return (sum_top + sum_left + (1 << log2N)) >> (log2N + 1);
+    } else if (has_left) {
+        return (sum_left + (1 << (log2N - 1))) >> log2N;
+    } else if (has_top) {
+        return (sum_top + (1 << (log2N - 1))) >> log2N;
+    }
+
+    return 128;
+}
+
+/**
+ * @brief the sum of the 16 bytes
+ */
+static inline TARGET_SSE2 int32_t sum16_sse2(const uint8_t* p) {
+    __m128i sad = _mm_sad_epu8(_mm_loadu_si128((const __m128i*)p), _mm_setzero_si128());
+    return _mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+}
+
+/**
+ * @brief the sum of the 8 bytes
+ */
+static inline TARGET_SSE2 int32_t sum8_sse2(const uint8_t* p) { return _mm_cvtsi128_si32(_mm_sad_epu8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128())); }
+
+/**
+ * @brief the plane gradients H and V of Intra_16x16_Plane, 8.3.3.4
+ */
+static void plane16x16_gradients(const IntraPredSamples* samples, int32_t* out_H, int32_t* out_V) {
+    int32_t H = 8 * (samples->top[15] - samples->top_left);
+    int32_t V = 8 * (samples->left[15] - samples->top_left);
+
+    for (int32_t i = 0; i < 7; i++) {
+        H += (i + 1) * (samples->top[8 + i] - samples->top[6 - i]);
+        V += (i + 1) * (samples->left[8 + i] - samples->left[6 - i]);
+    }
+
+    *out_H = H;
+    *out_V = V;
+}
+
+/**
+ * @brief the plane gradients H and V of Intra_Chroma_Plane, 8.3.4.4
+ */
+static void plane_chroma_gradients(const IntraPredSamples* samples, int32_t MbHeightC, int32_t* out_H, int32_t* out_V) {
+    int32_t yCF = MbHeightC == 16 ? 4 : 0;
+    int32_t H = 4 * (samples->top[7] - samples->top_left);
+    int32_t V = (4 + yCF) * (samples->left[7 + 2 * yCF] - samples->top_left);
+
+    for (int32_t i = 0; i < 3; i++) {
+        H += (i + 1) * (samples->top[4 + i] - samples->top[2 - i]);
+    }
+    for (int32_t i = 0; i < 3 + yCF; i++) {
+        V += (i + 1) * (samples->left[4 + yCF + i] - samples->left[2 + yCF - i]);
+    }
+
+    *out_H = H;
+    *out_V = V;
+}
+
+/**
+ * @brief store the 16x16 plane prediction, the 16-bit intermediate values do not overflow for the bit depth 8
+ */
+static inline TARGET_SSE2 void store_plane16x16_sse2(uint8_t* dst, int32_t stride, int32_t a, int32_t b, int32_t c) {
+    __m128i vb = _mm_set1_epi16((int16_t)b);
+    __m128i vc = _mm_set1_epi16((int16_t)c);
+    __m128i base = _mm_set1_epi16((int16_t)(a - 7 * c + 16));
+    __m128i row_lo = _mm_add_epi16(base, _mm_mullo_epi16(vb, _mm_setr_epi16(-7, -6, -5, -4, -3, -2, -1, 0)));
+    __m128i row_hi = _mm_add_epi16(base, _mm_mullo_epi16(vb, _mm_setr_epi16(1, 2, 3, 4, 5, 6, 7, 8)));
+
+    for (int32_t y = 0; y < 16; y++) {
+        _mm_storeu_si128((__m128i*)(dst + y * stride), _mm_packus_epi16(_mm_srai_epi16(row_lo, 5), _mm_srai_epi16(row_hi, 5)));
+        row_lo = _mm_add_epi16(row_lo, vc);
+        row_hi = _mm_add_epi16(row_hi, vc);
+    }
+}
+
+/**
+ * @brief store the 8xMbHeightC chroma plane prediction
+ */
+static inline TARGET_SSE2 void store_plane_chroma_sse2(uint8_t* dst, int32_t stride, int32_t MbHeightC, int32_t a, int32_t b, int32_t c) {
+    int32_t yCF = MbHeightC == 16 ? 4 : 0;
+    __m128i vc = _mm_set1_epi16((int16_t)c);
+    __m128i row = _mm_add_epi16(_mm_set1_epi16((int16_t)(a - (3 + yCF) * c + 16)), _mm_mullo_epi16(_mm_set1_epi16((int16_t)b), _mm_setr_epi16(-3, -2, -1, 0, 1, 2, 3, 4)));
+
+    for (int32_t y = 0; y < MbHeightC; y++) {
+        __m128i r = _mm_srai_epi16(row, 5);
+        _mm_storel_epi64((__m128i*)(dst + y * stride), _mm_packus_epi16(r, r));
+        row = _mm_add_epi16(row, vc);
+    }
+}
+
+static TARGET_SSE2 void pred16x16_vertical_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    __m128i top = _mm_loadu_si128((const __m128i*)samples->top);
+    for (int32_t y = 0; y < 16; y++) {
+        _mm_storeu_si128((__m128i*)(dst + y * stride), top);
+    }
+}
+
+static TARGET_SSE2 void pred16x16_horizontal_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    for (int32_t y = 0; y < 16; y++) {
+        _mm_storeu_si128((__m128i*)(dst + y * stride), _mm_set1_epi8((char)samples->left[y]));
+    }
+}
+
+static TARGET_SSE2 void pred16x16_dc_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    __m128i dc = _mm_set1_epi8((char)dc_value(samples, sum16_sse2(samples->top), sum16_sse2(samples->left), 4));
+    for (int32_t y = 0; y < 16; y++) {
+        _mm_storeu_si128((__m128i*)(dst + y * stride), dc);
+    }
+}
+
+static TARGET_SSE2 void pred16x16_plane_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    int32_t H = 0;
+    int32_t V = 0;
+    plane16x16_gradients(samples, &H, &V);
+
+    int32_t a = 16 * (samples->left[15] + samples->top[15]);
+    store_plane16x16_sse2(dst, stride, a, (5 * H + 32) >> 6, (5 * V + 32) >> 6);
+}
+
+static TARGET_SSE2 void pred8x8_vertical_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    __m128i top = _mm_loadl_epi64((const __m128i*)samples->top);
+    for (int32_t y = 0; y < 8; y++) {
+        _mm_storel_epi64((__m128i*)(dst + y * stride), top);
+    }
+}
+
+static TARGET_SSE2 void pred8x8_horizontal_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    for (int32_t y = 0; y < 8; y++) {
+        _mm_storel_epi64((__m128i*)(dst + y * stride), _mm_set1_epi8((char)samples->left[y]));
+    }
+}
+
+static TARGET_SSE2 void pred8x8_dc_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    __m128i dc = _mm_set1_epi8((char)dc_value(samples, sum8_sse2(samples->top), sum8_sse2(samples->left), 3));
+    for (int32_t y = 0; y < 8; y++) {
+        _mm_storel_epi64((__m128i*)(dst + y * stride), dc);
+    }
+}
+
+/* 8.3.2.2.5 Specification of Intra_8x8_Diagonal_Down_Left prediction mode */
+static TARGET_SSE2 void pred8x8_diagonal_down_left_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    /* t[ i ] = p[ i, -1 ], t[ 16 ] = t[ 15 ] gives ( p[ 14, -1 ] + 3 * p[ 15, -1 ] + 2 ) >> 2 for the last sample */
+    __m128i t0 = _mm_loadu_si128((const __m128i*)samples->top);
+    __m128i t1 = _mm_or_si128(_mm_srli_si128(t0, 1), _mm_slli_si128(_mm_srli_si128(t0, 15), 15));
+    __m128i t2 = _mm_srli_si128(t1, 1);
+    __m128i filtered = lowpass3_sse2(t0, t1, t2);
+
+    for (int32_t y = 0; y < 8; y++) {
+        _mm_storel_epi64((__m128i*)(dst + y * stride), filtered);
+        filtered = _mm_srli_si128(filtered, 1);
+    }
+}
+
+/* 8.3.2.2.6 Specification of Intra_8x8_Diagonal_Down_Right prediction mode */
+static TARGET_SSE2 void pred8x8_diagonal_down_right_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    /* edge[ 7 - y ] = p[ -1, y ], edge[ 8 ] = p[ -1, -1 ], edge[ 9 + x ] = p[ x, -1 ], pred8x8L[ x, y ] is the filtered edge[ 8 + x - y ] */
+    uint8_t edge[32] = {0};
+    for (int32_t i = 0; i < 8; i++) {
+        edge[7 - i] = samples->left[i];
+        edge[9 + i] = samples->top[i];
+    }
+    edge[8] = samples->top_left;
+
+    __m128i filtered = lowpass3_sse2(_mm_loadu_si128((const __m128i*)edge), _mm_loadu_si128((const __m128i*)(edge + 1)), _mm_loadu_si128((const __m128i*)(edge + 2)));
+
+    _mm_storel_epi64((__m128i*)(dst + 0 * stride), _mm_srli_si128(filtered, 7));
+    _mm_storel_epi64((__m128i*)(dst + 1 * stride), _mm_srli_si128(filtered, 6));
+    _mm_storel_epi64((__m128i*)(dst + 2 * stride), _mm_srli_si128(filtered, 5));
+    _mm_storel_epi64((__m128i*)(dst + 3 * stride), _mm_srli_si128(filtered, 4));
+    _mm_storel_epi64((__m128i*)(dst + 4 * stride), _mm_srli_si128(filtered, 3));
+    _mm_storel_epi64((__m128i*)(dst + 5 * stride), _mm_srli_si128(filtered, 2));
+    _mm_storel_epi64((__m128i*)(dst + 6 * stride), _mm_srli_si128(filtered, 1));
+    _mm_storel_epi64((__m128i*)(dst + 7 * stride), filtered);
+}
+
+/* 8.3.2.2.9 Specification of Intra_8x8_Vertical_Left prediction mode */
+static TARGET_SSE2 void pred8x8_vertical_left_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    __m128i t0 = _mm_loadu_si128((const __m128i*)samples->top);
+    __m128i t1 = _mm_srli_si128(t0, 1);
+    __m128i t2 = _mm_srli_si128(t0, 2);
+    __m128i even = _mm_avg_epu8(t0, t1);
+    __m128i odd = lowpass3_sse2(t0, t1, t2);
+
+    for (int32_t y = 0; y < 8; y += 2) {
+        _mm_storel_epi64((__m128i*)(dst + y * stride), even);
+        _mm_storel_epi64((__m128i*)(dst + (y + 1) * stride), odd);
+        even = _mm_srli_si128(even, 1);
+        odd = _mm_srli_si128(odd, 1);
+    }
+}
+
+static TARGET_SSE2 void pred_chroma_vertical_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples, int32_t MbHeightC) {
+    __m128i top = _mm_loadl_epi64((const __m128i*)samples->top);
+    for (int32_t y = 0; y < MbHeightC; y++) {
+        _mm_storel_epi64((__m128i*)(dst + y * stride), top);
+    }
+}
+
+static TARGET_SSE2 void pred_chroma_horizontal_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples, int32_t MbHeightC) {
+    for (int32_t y = 0; y < MbHeightC; y++) {
+        _mm_storel_epi64((__m128i*)(dst + y * stride), _mm_set1_epi8((char)samples->left[y]));
+    }
+}
+
+/* 8.3.4.1 Specification of Intra_Chroma_DC prediction mode */
+static TARGET_SSE2 void pred_chroma_dc_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples, int32_t MbHeightC) {
+    int32_t has_top = samples->available & H264_INTRA_AVAIL_TOP;
+    int32_t has_left = samples->available & H264_INTRA_AVAIL_LEFT;
+    int32_t sum_top0 = samples->top[0] + samples->top[1] + samples->top[2] + samples->top[3];
+    int32_t sum_top1 = samples->top[4] + samples->top[5] + samples->top[6] + samples->top[7];
+    int32_t top0 = (sum_top0 + 2) >> 2;
+    int32_t top1 = (sum_top1 + 2) >> 2;
+
+    for (int32_t yO = 0; yO < MbHeightC; yO += 4) {
+        int32_t sum_left = samples->left[yO] + samples->left[yO + 1] + samples->left[yO + 2] + samples->left[yO + 3];
+        int32_t left = (sum_left + 2) >> 2;
+        int32_t dc0 = 128;
+        int32_t dc1 = 128;
+
+        if (yO == 0) {
+            /* the block ( 0, 0 ) uses both edges, the block ( 4, 0 ) prefers the top edge */
+            dc0 = has_top && has_left ? (sum_top0 + sum_left + 4) >> 3 : (has_left ? left : (has_top ? top0 : 128));
+            dc1 = has_top ? top1 : (has_left ? left : 128);
+        } else {
+            /* the block ( 0, yO ) prefers the left edge, the block ( 4, yO ) uses both edges */
+            dc0 = has_left ? left : (has_top ? top0 : 128);
+            dc1 = has_top && has_left ? (sum_top1 + sum_left + 4) >> 3 : (has_left ? left : (has_top ? top1 : 128));
+        }
+
+        __m128i row = _mm_unpacklo_epi32(_mm_set1_epi8((char)dc0), _mm_set1_epi8((char)dc1));
+        for (int32_t y = 0; y < 4; y++) {
+            _mm_storel_epi64((__m128i*)(dst + (yO + y) * stride), row);
+        }
+    }
+}
+
+static TARGET_SSE2 void pred_chroma_plane_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples, int32_t MbHeightC) {
+    int32_t H = 0;
+    int32_t V = 0;
+    plane_chroma_gradients(samples, MbHeightC, &H, &V);
+
+    int32_t a = 16 * (samples->left[MbHeightC - 1] + samples->top[7]);
+    int32_t b = (34 * H + 32) >> 6;
+    int32_t c = ((34 - 29 * (MbHeightC == 16)) * V + 32) >> 6;
+    store_plane_chroma_sse2(dst, stride, MbHeightC, a, b, c);
+}
+
+static TARGET_SSE2 void pred_chroma420_dc_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) { pred_chroma_dc_sse2(dst, stride, samples, 8); }
+static TARGET_SSE2 void pred_chroma420_horizontal_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) { pred_chroma_horizontal_sse2(dst, stride, samples, 8); }
+static TARGET_SSE2 void pred_chroma420_vertical_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) { pred_chroma_vertical_sse2(dst, stride, samples, 8); }
+static TARGET_SSE2 void pred_chroma420_plane_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) { pred_chroma_plane_sse2(dst, stride, samples, 8); }
+static TARGET_SSE2 void pred_chroma422_dc_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) { pred_chroma_dc_sse2(dst, stride, samples, 16); }
+static TARGET_SSE2 void pred_chroma422_horizontal_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) { pred_chroma_horizontal_sse2(dst, stride, samples, 16); }
+static TARGET_SSE2 void pred_chroma422_vertical_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) { pred_chroma_vertical_sse2(dst, stride, samples, 16); }
+static TARGET_SSE2 void pred_chroma422_plane_sse2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) { pred_chroma_plane_sse2(dst, stride, samples, 16); }
+
+/**
+ * @brief the weighted sum of the differences of the edge samples with pmaddubsw, Σ ( i + 1 ) * ( edge[ N + i ] - edge[ N - 2 - i ] ) with i = 0..N-1 where edge[ -1 ] is
+ * p[ -1, -1 ], it is H or V of the plane prediction modes for N equal to 8
+ *
+ * @param edge p[ x, -1 ] or p[ -1, y ]
+ * @param top_left p[ -1, -1 ]
+ */
+static inline TARGET_SSSE3 int32_t plane_gradient8_ssse3(const uint8_t* edge, uint8_t top_left) {
+    __m128i lo = _mm_or_si128(_mm_slli_epi64(_mm_loadl_epi64((const __m128i*)edge), 8), _mm_cvtsi32_si128(top_left));
+    __m128i hi = _mm_loadl_epi64((const __m128i*)(edge + 8));
+    __m128i weights = _mm_setr_epi8(-8, -7, -6, -5, -4, -3, -2, -1, 1, 2, 3, 4, 5, 6, 7, 8);
+    __m128i sum = _mm_madd_epi16(_mm_maddubs_epi16(_mm_unpacklo_epi64(lo, hi), weights), _mm_set1_epi16(1));
+
+    sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+    sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+    return _mm_cvtsi128_si32(sum);
+}
+
+/**
+ * @brief Σ ( i + 1 ) * ( edge[ 4 + i ] - edge[ 2 - i ] ) with i = 0..3 where edge[ -1 ] is p[ -1, -1 ]
+ */
+static inline TARGET_SSSE3 int32_t plane_gradient4_ssse3(const uint8_t* edge, uint8_t top_left) {
+    int32_t lo4 = 0;
+    int32_t hi4 = 0;
+    memcpy(&lo4, edge, 4);
+    memcpy(&hi4, edge + 4, 4);
+
+    __m128i lo = _mm_or_si128(_mm_slli_epi32(_mm_cvtsi32_si128(lo4), 8), _mm_cvtsi32_si128(top_left));
+    __m128i hi = _mm_cvtsi32_si128(hi4);
+    __m128i weights = _mm_setr_epi8(-4, -3, -2, -1, 1, 2, 3, 4, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i sum = _mm_madd_epi16(_mm_maddubs_epi16(_mm_unpacklo_epi32(lo, hi), weights), _mm_set1_epi16(1));
+
+    sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+    return _mm_cvtsi128_si32(sum);
+}
+
+static TARGET_SSSE3 void pred16x16_plane_ssse3(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    int32_t H = plane_gradient8_ssse3(samples->top, samples->top_left);
+    int32_t V = plane_gradient8_ssse3(samples->left, samples->top_left);
+    int32_t a = 16 * (samples->left[15] + samples->top[15]);
+
+    store_plane16x16_sse2(dst, stride, a, (5 * H + 32) >> 6, (5 * V + 32) >> 6);
+}
+
+static TARGET_SSSE3 void pred_chroma420_plane_ssse3(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    int32_t H = plane_gradient4_ssse3(samples->top, samples->top_left);
+    int32_t V = plane_gradient4_ssse3(samples->left, samples->top_left);
+    int32_t a = 16 * (samples->left[7] + samples->top[7]);
+
+    store_plane_chroma_sse2(dst, stride, 8, a, (34 * H + 32) >> 6, (34 * V + 32) >> 6);
+}
+
+static TARGET_SSSE3 void pred_chroma422_plane_ssse3(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    int32_t H = plane_gradient4_ssse3(samples->top, samples->top_left);
+    int32_t V = plane_gradient8_ssse3(samples->left, samples->top_left);
+    int32_t a = 16 * (samples->left[15] + samples->top[7]);
+
+    store_plane_chroma_sse2(dst, stride, 16, a, (34 * H + 32) >> 6, (5 * V + 32) >> 6);
+}
+
+static TARGET_AVX2 void pred16x16_plane_avx2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    int32_t H = plane_gradient8_ssse3(samples->top, samples->top_left);
+    int32_t V = plane_gradient8_ssse3(samples->left, samples->top_left);
+    int32_t a = 16 * (samples->left[15] + samples->top[15]);
+    int32_t b = (5 * H + 32) >> 6;
+    int32_t c = (5 * V + 32) >> 6;
+
+    __m256i vc = _mm256_set1_epi16((int16_t)c);
+    __m256i row = _mm256_add_epi16(_mm256_set1_epi16((int16_t)(a - 7 * c + 16)),
+                                   _mm256_mullo_epi16(_mm256_set1_epi16((int16_t)b), _mm256_setr_epi16(-7, -6, -5, -4, -3, -2, -1, 0, 1, 2, 3, 4, 5, 6, 7, 8)));
+
+    for (int32_t y = 0; y < 16; y++) {
+        __m256i r = _mm256_srai_epi16(row, 5);
+        /* the packed bytes of the two 128-bit lanes are moved to the low lane */
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(r, r), 0x08);
+        _mm_storeu_si128((__m128i*)(dst + y * stride), _mm256_castsi256_si128(packed));
+        row = _mm256_add_epi16(row, vc);
+    }
+}
+
+/**
+ * @brief store the 8xMbHeightC chroma plane prediction, two rows per iteration
+ */
+static inline TARGET_AVX2 void store_plane_chroma_avx2(uint8_t* dst, int32_t stride, int32_t MbHeightC, int32_t a, int32_t b, int32_t c) {
+    int32_t yCF = MbHeightC == 16 ? 4 : 0;
+    __m256i vc2 = _mm256_set1_epi16((int16_t)(2 * c));
+    __m256i row = _mm256_add_epi16(_mm256_set1_epi16((int16_t)(a - (3 + yCF) * c + 16)),
+                                   _mm256_mullo_epi16(_mm256_set1_epi16((int16_t)b), _mm256_setr_epi16(-3, -2, -1, 0, 1, 2, 3, 4, -3, -2, -1, 0, 1, 2, 3, 4)));
+    row = _mm256_add_epi16(row, _mm256_setr_epi16(0, 0, 0, 0, 0, 0, 0, 0, (int16_t)c, (int16_t)c, (int16_t)c, (int16_t)c, (int16_t)c, (int16_t)c, (int16_t)c, (int16_t)c));
+
+    for (int32_t y = 0; y < MbHeightC; y += 2) {
+        __m256i r = _mm256_srai_epi16(row, 5);
+        __m256i packed = _mm256_packus_epi16(r, r);
+        _mm_storel_epi64((__m128i*)(dst + y * stride), _mm256_castsi256_si128(packed));
+        _mm_storel_epi64((__m128i*)(dst + (y + 1) * stride), _mm256_extracti128_si256(packed, 1));
+        row = _mm256_add_epi16(row, vc2);
+    }
+}
+
+static TARGET_AVX2 void pred_chroma420_plane_avx2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    int32_t H = plane_gradient4_ssse3(samples->top, samples->top_left);
+    int32_t V = plane_gradient4_ssse3(samples->left, samples->top_left);
+    int32_t a = 16 * (samples->left[7] + samples->top[7]);
+
+    store_plane_chroma_avx2(dst, stride, 8, a, (34 * H + 32) >> 6, (34 * V + 32) >> 6);
+}
+
+static TARGET_AVX2 void pred_chroma422_plane_avx2(uint8_t* dst, int32_t stride, const IntraPredSamples* samples) {
+    int32_t H = plane_gradient4_ssse3(samples->top, samples->top_left);
+    int32_t V = plane_gradient8_ssse3(samples->left, samples->top_left);
+    int32_t a = 16 * (samples->left[15] + samples->top[7]);
+
+    store_plane_chroma_avx2(dst, stride, 16, a, (34 * H + 32) >> 6, (5 * V + 32) >> 6);
+}
+
+void init_intra_pred_funcs_x86(IntraPredFuncs* funcs, int32_t cpu_flags) {
+    if (cpu_flags & H264_CPU_SSE2) {
+        funcs->pred8x8[Intra_NxN_Vertical] = pred8x8_vertical_sse2;
+        funcs->pred8x8[Intra_NxN_Horizontal] = pred8x8_horizontal_sse2;
+        funcs->pred8x8[Intra_NxN_DC] = pred8x8_dc_sse2;
+        funcs->pred8x8[Intra_NxN_Diagonal_Down_Left] = pred8x8_diagonal_down_left_sse2;
+        funcs->pred8x8[Intra_NxN_Diagonal_Down_Right] = pred8x8_diagonal_down_right_sse2;
+        funcs->pred8x8[Intra_NxN_Vertical_Left] = pred8x8_vertical_left_sse2;
+
+        funcs->pred16x16[Intra_16x16_Vertical] = pred16x16_vertical_sse2;
+        funcs->pred16x16[Intra_16x16_Horizontal] = pred16x16_horizontal_sse2;
+        funcs->pred16x16[Intra_16x16_DC] = pred16x16_dc_sse2;
+        funcs->pred16x16[Intra_16x16_Plane] = pred16x16_plane_sse2;
+
+        funcs->pred_chroma[0][Intra_Chroma_DC] = pred_chroma420_dc_sse2;
+        funcs->pred_chroma[0][Intra_Chroma_Horizontal] = pred_chroma420_horizontal_sse2;
+        funcs->pred_chroma[0][Intra_Chroma_Vertical] = pred_chroma420_vertical_sse2;
+        funcs->pred_chroma[0][Intra_Chroma_Plane] = pred_chroma420_plane_sse2;
+
+        funcs->pred_chroma[1][Intra_Chroma_DC] = pred_chroma422_dc_sse2;
+        funcs->pred_chroma[1][Intra_Chroma_Horizontal] = pred_chroma422_horizontal_sse2;
+        funcs->pred_chroma[1][Intra_Chroma_Vertical] = pred_chroma422_vertical_sse2;
+        funcs->pred_chroma[1][Intra_Chroma_Plane] = pred_chroma422_plane_sse2;
+    }
+
+    if (cpu_flags & H264_CPU_SSSE3) {
+        funcs->pred16x16[Intra_16x16_Plane] = pred16x16_plane_ssse3;
+        funcs->pred_chroma[0][Intra_Chroma_Plane] = pred_chroma420_plane_ssse3;
+        funcs->pred_chroma[1][Intra_Chroma_Plane] = pred_chroma422_plane_ssse3;
+    }
+
+    if (cpu_flags & H264_CPU_AVX2) {
+        funcs->pred16x16[Intra_16x16_Plane] = pred16x16_plane_avx2;
+        funcs->pred_chroma[0][Intra_Chroma_Plane] = pred_chroma420_plane_avx2;
+        funcs->pred_chroma[1][Intra_Chroma_Plane] = pred_chroma422_plane_avx2;
+    }
+}
+
+#else
+
+void init_intra_pred_funcs_x86(IntraPredFuncs* funcs, int32_t cpu_flags) {
+    (void)funcs;
+    (void)cpu_flags;
+}
+
+#endif
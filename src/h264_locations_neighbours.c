@@ -1,6 +1,37 @@
 #include "h264decoder/h264_locations_neighbours.h"
 
 #include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_math.h"
+
+/**
+ * @brief the macroblocks belong to the same slice, the slice of the macroblock which is not decoded yet is -1
+ */
+static inline int is_same_slice(const int32_t* mb_slice_ids, int32_t mbAddrX, int32_t mbAddrY) {
+    return load_shared_i32(&mb_slice_ids[mbAddrX]) == load_shared_i32(&mb_slice_ids[mbAddrY]);
+}
+
+/**
+ * @brief the upper-left luma sample location of the 4x4 luma blocks relative to the macroblock, indexed by luma4x4BlkIdx
+ * @see 6.4.3 Inverse 4x4 luma block scanning process
+ *
+ * x = InverseRasterScan( luma4x4BlkIdx / 4, 8, 8, 16, 0 ) + InverseRasterScan( luma4x4BlkIdx % 4, 4, 4, 8, 0 )
+ * y = InverseRasterScan( luma4x4BlkIdx / 4, 8, 8, 16, 1 ) + InverseRasterScan( luma4x4BlkIdx % 4, 4, 4, 8, 1 )
+ */
+static const uint8_t g_luma4x4_blk_x[16] = {0, 4, 0, 4, 8, 12, 8, 12, 0, 4, 0, 4, 8, 12, 8, 12};
+static const uint8_t g_luma4x4_blk_y[16] = {0, 0, 4, 4, 0, 0, 4, 4, 8, 8, 12, 12, 8, 8, 12, 12};
+
+/**
+ * @brief the luma4x4BlkIdx of the 4x4 luma block covering the luma location ( xP, yP ), indexed by [ yP / 4 ][ xP / 4 ]
+ * @see 6.4.13.1 Derivation process for 4x4 luma block indices
+ *
+ * luma4x4BlkIdx = 8 * ( yP / 8 ) + 4 * ( xP / 8 ) + 2 * ( ( yP % 8 ) / 4 ) + ( ( xP % 8 ) / 4 )
+ */
+static const uint8_t g_luma4x4_blk_idx[4][4] = {
+    {0, 1, 4, 5},
+    {2, 3, 6, 7},
+    {8, 9, 12, 13},
+    {10, 11, 14, 15},
+};
 
 /* 6.4.1 Inverse macroblock scanning process */
 void inverse_macroblock_scanning_process(int32_t mbAddr, int32_t PicWidthInSamplesL, int32_t MbaffFrameFlag, int32_t is_frame_macroblock, int32_t* out_x, int32_t* out_y) {
@@ -25,17 +56,13 @@ void inverse_macroblock_scanning_process(int32_t mbAddr, int32_t PicWidthInSampl
 /* Table 7-13 – Macroblock type values 0 to 4 for P and SP slices */
 /* Table 7-14 – Macroblock type values 0 to 22 for B slices */
 int inverse_macroblock_partition_scanning_process(int32_t mbPartIdx, MB_TYPE_NAME mb_type, int32_t* out_x, int32_t* out_y) {
-    int err_code = ERR_OK;
-    int32_t width = 0;
-    int32_t height = 0;
-
-    err_code = MbPartWidthHeight(mb_type, &width, &height);
-    if (err_code < 0) {
-        return err_code;
+    const MB_TYPE_INFO* info = get_mb_type_info(mb_type);
+    if (info->is_sub_mb_type || !info->MbPartWidth) {
+        return ERR_UNRECOGNIZED_MB;
     }
 
-    *out_x = InverseRasterScan(mbPartIdx, width, height, 16, 0);
-    *out_y = InverseRasterScan(mbPartIdx, width, height, 16, 1);
+    *out_x = info->part_x[mbPartIdx];
+    *out_y = info->part_y[mbPartIdx];
 
     return ERR_OK;
 }
@@ -43,20 +70,17 @@ int inverse_macroblock_partition_scanning_process(int32_t mbPartIdx, MB_TYPE_NAM
 /* 6.4.2.2 Inverse sub-macroblock partition scanning process */
 int inverse_sub_macroblock_partition_scanning_process(MB_TYPE_NAME mb_type, MB_TYPE_NAME sub_mb_type_of_mbPartIdx, int32_t subMbPartIdx, int32_t* out_x, int32_t* out_y) {
     if (mb_type == P_8x8 || mb_type == P_8x8ref0 || mb_type == B_8x8) {
-        int32_t sub_mb_part_width = 0;
-        int32_t sub_mb_part_height = 0;
-        int err_code = ERR_OK;
-
-        err_code = SubMbPartWidthHeight(sub_mb_type_of_mbPartIdx, &sub_mb_part_width, &sub_mb_part_height);
-        if (err_code < 0) {
-            return err_code;
+        const MB_TYPE_INFO* info = get_mb_type_info(sub_mb_type_of_mbPartIdx);
+        if (!info->is_sub_mb_type) {
+            return ERR_UNRECOGNIZED_MB;
         }
 
-        *out_x = InverseRasterScan(subMbPartIdx, sub_mb_part_width, sub_mb_part_height, 8, 0);
-        *out_y = InverseRasterScan(subMbPartIdx, sub_mb_part_width, sub_mb_part_height, 8, 1);
+        *out_x = info->part_x[subMbPartIdx];
+        *out_y = info->part_y[subMbPartIdx];
     } else {
-        *out_x = InverseRasterScan(subMbPartIdx, 4, 4, 8, 0);
-        *out_y = InverseRasterScan(subMbPartIdx, 4, 4, 8, 1);
+        /* InverseRasterScan( subMbPartIdx, 4, 4, 8, 0 or 1 ) */
+        *out_x = (subMbPartIdx & 1) * 4;
+        *out_y = (subMbPartIdx >> 1) * 4;
     }
 
     return ERR_OK;
@@ -64,32 +88,32 @@ int inverse_sub_macroblock_partition_scanning_process(MB_TYPE_NAME mb_type, MB_T
 
 /* 6.4.3 Inverse 4x4 luma block scanning process */
 void inverse_4x4_luma_block_scanning_process(int32_t luma4x4BlkIdx, int32_t* out_x, int32_t* out_y) {
-    *out_x = InverseRasterScan(luma4x4BlkIdx / 4, 8, 8, 16, 0) + InverseRasterScan(luma4x4BlkIdx % 4, 4, 4, 8, 0);
-    *out_y = InverseRasterScan(luma4x4BlkIdx / 4, 8, 8, 16, 1) + InverseRasterScan(luma4x4BlkIdx % 4, 4, 4, 8, 1);
+    *out_x = g_luma4x4_blk_x[luma4x4BlkIdx];
+    *out_y = g_luma4x4_blk_y[luma4x4BlkIdx];
 }
 
 /* 6.4.4 Inverse 4x4 Cb or Cr block scanning process for ChromaArrayType equal to 3 */
 void inverse_4x4_Cb_Cr_block_scanning_process(int32_t cbcr4x4BlkIdx, int32_t* out_x, int32_t* out_y) {
-    *out_x = InverseRasterScan(cbcr4x4BlkIdx / 4, 8, 8, 16, 0) + InverseRasterScan(cbcr4x4BlkIdx % 4, 4, 4, 8, 0);
-    *out_y = InverseRasterScan(cbcr4x4BlkIdx / 4, 8, 8, 16, 1) + InverseRasterScan(cbcr4x4BlkIdx % 4, 4, 4, 8, 1);
+    *out_x = g_luma4x4_blk_x[cbcr4x4BlkIdx];
+    *out_y = g_luma4x4_blk_y[cbcr4x4BlkIdx];
 }
 
 /* 6.4.5 Inverse 8x8 luma block scanning process */
 void inverse_8x8_luma_block_scanning_process(int32_t luma8x8BlkIdx, int32_t* out_x, int32_t* out_y) {
-    *out_x = InverseRasterScan(luma8x8BlkIdx, 8, 8, 16, 0);
-    *out_y = InverseRasterScan(luma8x8BlkIdx, 8, 8, 16, 1);
+    *out_x = (luma8x8BlkIdx & 1) * 8;
+    *out_y = (luma8x8BlkIdx >> 1) * 8;
 }
 
 /* 6.4.6 Inverse 8x8 Cb or Cr block scanning process for ChromaArrayType equal to 3 */
 void inverse_8x8_Cb_Cr_block_scanning_process(int32_t cbcr8x8BlkIdx, int32_t* out_x, int32_t* out_y) {
-    *out_x = InverseRasterScan(cbcr8x8BlkIdx, 8, 8, 16, 0);
-    *out_y = InverseRasterScan(cbcr8x8BlkIdx, 8, 8, 16, 1);
+    *out_x = (cbcr8x8BlkIdx & 1) * 8;
+    *out_y = (cbcr8x8BlkIdx >> 1) * 8;
 }
 
 /* 6.4.7 Inverse 4x4 chroma block scanning process */
 void inverse_4x4_chroma_block_scanning_process(int32_t chroma4x4BlkIdx, int32_t* out_x, int32_t* out_y) {
-    *out_x = InverseRasterScan(chroma4x4BlkIdx, 4, 4, 8, 0);
-    *out_y = InverseRasterScan(chroma4x4BlkIdx, 4, 4, 8, 1);
+    *out_x = (chroma4x4BlkIdx & 1) * 4;
+    *out_y = (chroma4x4BlkIdx >> 1) * 4;
 }
 
 /* 6.4.8 Derivation process of the availability for macroblock addresses */
@@ -109,19 +133,19 @@ void neighbouring_mb_address_availability(int32_t CurrMbAddr, int32_t PicWidthIn
     *out_mbAddrC = CurrMbAddr - PicWidthInMbs + 1;
     *out_mbAddrD = CurrMbAddr - PicWidthInMbs - 1;
 
-    if (*out_mbAddrA < 0 /* || *out_mbAddrA > CurrMbAddr (Note: redundant)*/ || CurrMbAddr % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrA]) {
+    if (*out_mbAddrA < 0 /* || *out_mbAddrA > CurrMbAddr (Note: redundant)*/ || CurrMbAddr % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrA)) {
         *out_mbAddrA = -1;
     }
 
-    if (*out_mbAddrB < 0 /*|| *out_mbAddrB > CurrMbAddr (Note: redundant)*/ || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrB]) {
+    if (*out_mbAddrB < 0 /*|| *out_mbAddrB > CurrMbAddr (Note: redundant)*/ || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrB)) {
         *out_mbAddrB = -1;
     }
 
-    if (*out_mbAddrC < 0 || *out_mbAddrC > CurrMbAddr || (CurrMbAddr + 1) % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrC]) {
+    if (*out_mbAddrC < 0 || *out_mbAddrC > CurrMbAddr || (CurrMbAddr + 1) % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrC)) {
         *out_mbAddrC = -1;
     }
 
-    if (*out_mbAddrD < 0 /* || *out_mbAddrD > CurrMbAddr (Note: redundant)*/ || CurrMbAddr % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrD]) {
+    if (*out_mbAddrD < 0 /* || *out_mbAddrD > CurrMbAddr (Note: redundant)*/ || CurrMbAddr % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrD)) {
         *out_mbAddrD = -1;
     }
 }
@@ -130,7 +154,7 @@ void neighbouring_mb_address_availability(int32_t CurrMbAddr, int32_t PicWidthIn
 void neighbouring_mb_A_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrA) {
     *out_mbAddrA = CurrMbAddr - 1;
 
-    if (*out_mbAddrA < 0 /* || *out_mbAddrA > CurrMbAddr (Note: redundant)*/ || CurrMbAddr % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrA]) {
+    if (*out_mbAddrA < 0 /* || *out_mbAddrA > CurrMbAddr (Note: redundant)*/ || CurrMbAddr % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrA)) {
         *out_mbAddrA = -1;
     }
 }
@@ -139,7 +163,7 @@ void neighbouring_mb_A_address_availability(int32_t CurrMbAddr, int32_t PicWidth
 void neighbouring_mb_B_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrB) {
     *out_mbAddrB = CurrMbAddr - PicWidthInMbs;
 
-    if (*out_mbAddrB < 0 /*|| *out_mbAddrB > CurrMbAddr (Note: redundant)*/ || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrB]) {
+    if (*out_mbAddrB < 0 /*|| *out_mbAddrB > CurrMbAddr (Note: redundant)*/ || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrB)) {
         *out_mbAddrB = -1;
     }
 }
@@ -148,7 +172,7 @@ void neighbouring_mb_B_address_availability(int32_t CurrMbAddr, int32_t PicWidth
 void neighbouring_mb_C_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrC) {
     *out_mbAddrC = CurrMbAddr - PicWidthInMbs + 1;
 
-    if (*out_mbAddrC < 0 || *out_mbAddrC > CurrMbAddr || (CurrMbAddr + 1) % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrC]) {
+    if (*out_mbAddrC < 0 || *out_mbAddrC > CurrMbAddr || (CurrMbAddr + 1) % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrC)) {
         *out_mbAddrC = -1;
     }
 }
@@ -157,7 +181,7 @@ void neighbouring_mb_C_address_availability(int32_t CurrMbAddr, int32_t PicWidth
 void neighbouring_mb_D_address_availability(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrD) {
     *out_mbAddrD = CurrMbAddr - PicWidthInMbs - 1;
 
-    if (*out_mbAddrD < 0 /* || *out_mbAddrD > CurrMbAddr (Note: redundant)*/ || CurrMbAddr % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrD]) {
+    if (*out_mbAddrD < 0 /* || *out_mbAddrD > CurrMbAddr (Note: redundant)*/ || CurrMbAddr % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrD)) {
         *out_mbAddrD = -1;
     }
 }
@@ -170,19 +194,19 @@ void neighbouring_mb_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int
     *out_mbAddrC = 2 * (CurrMbAddr / 2 - PicWidthInMbs + 1);
     *out_mbAddrD = 2 * (CurrMbAddr / 2 - PicWidthInMbs - 1);
 
-    if (*out_mbAddrA < 0 /*|| *out_mbAddrA > CurrMbAddr (Note: redundant) */ || (CurrMbAddr / 2) % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrA]) {
+    if (*out_mbAddrA < 0 /*|| *out_mbAddrA > CurrMbAddr (Note: redundant) */ || (CurrMbAddr / 2) % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrA)) {
         *out_mbAddrA = -2;
     }
 
-    if (*out_mbAddrB < 0 /* || *out_mbAddrB > CurrMbAddr (Note: redundant) */ || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrB]) {
+    if (*out_mbAddrB < 0 /* || *out_mbAddrB > CurrMbAddr (Note: redundant) */ || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrB)) {
         *out_mbAddrB = -2;
     }
 
-    if (*out_mbAddrC < 0 || *out_mbAddrC > CurrMbAddr || (CurrMbAddr / 2 + 1) % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrC]) {
+    if (*out_mbAddrC < 0 || *out_mbAddrC > CurrMbAddr || (CurrMbAddr / 2 + 1) % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrC)) {
         *out_mbAddrC = -2;
     }
 
-    if (*out_mbAddrD < 0 /* || *out_mbAddrD > CurrMbAddr (Note: redundant)*/ || (CurrMbAddr / 2) % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrD]) {
+    if (*out_mbAddrD < 0 /* || *out_mbAddrD > CurrMbAddr (Note: redundant)*/ || (CurrMbAddr / 2) % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrD)) {
         *out_mbAddrD = -2;
     }
 }
@@ -190,7 +214,7 @@ void neighbouring_mb_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int
 /* 6.4.10 Derivation process for neighbouring macroblock addresses and their availability in MBAFF frames */
 void neighbouring_mb_A_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrA) {
     *out_mbAddrA = 2 * (CurrMbAddr / 2 - 1);
-    if (*out_mbAddrA < 0 /*|| *out_mbAddrA > CurrMbAddr (Note: redundant) */ || (CurrMbAddr / 2) % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrA]) {
+    if (*out_mbAddrA < 0 /*|| *out_mbAddrA > CurrMbAddr (Note: redundant) */ || (CurrMbAddr / 2) % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrA)) {
         *out_mbAddrA = -1;
     }
 }
@@ -198,7 +222,7 @@ void neighbouring_mb_A_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, i
 /* 6.4.10 Derivation process for neighbouring macroblock addresses and their availability in MBAFF frames */
 void neighbouring_mb_B_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrB) {
     *out_mbAddrB = 2 * (CurrMbAddr / 2 - PicWidthInMbs);
-    if (*out_mbAddrB < 0 /* || *out_mbAddrB > CurrMbAddr (Note: redundant) */ || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrB]) {
+    if (*out_mbAddrB < 0 /* || *out_mbAddrB > CurrMbAddr (Note: redundant) */ || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrB)) {
         *out_mbAddrB = -1;
     }
 }
@@ -206,7 +230,7 @@ void neighbouring_mb_B_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, i
 /* 6.4.10 Derivation process for neighbouring macroblock addresses and their availability in MBAFF frames */
 void neighbouring_mb_C_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrC) {
     *out_mbAddrC = 2 * (CurrMbAddr / 2 - PicWidthInMbs + 1);
-    if (*out_mbAddrC < 0 || *out_mbAddrC > CurrMbAddr || (CurrMbAddr / 2 + 1) % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrC]) {
+    if (*out_mbAddrC < 0 || *out_mbAddrC > CurrMbAddr || (CurrMbAddr / 2 + 1) % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrC)) {
         *out_mbAddrC = -1;
     }
 }
@@ -215,13 +239,13 @@ void neighbouring_mb_C_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, i
 void neighbouring_mb_D_address_availability_in_MBAFF_frame(int32_t CurrMbAddr, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* out_mbAddrD) {
     *out_mbAddrD = 2 * (CurrMbAddr / 2 - PicWidthInMbs - 1);
 
-    if (*out_mbAddrD < 0 /* || *out_mbAddrD > CurrMbAddr (Note: redundant)*/ || (CurrMbAddr / 2) % PicWidthInMbs == 0 || mb_slice_ids[CurrMbAddr] != mb_slice_ids[*out_mbAddrD]) {
+    if (*out_mbAddrD < 0 /* || *out_mbAddrD > CurrMbAddr (Note: redundant)*/ || (CurrMbAddr / 2) % PicWidthInMbs == 0 || !is_same_slice(mb_slice_ids, CurrMbAddr, *out_mbAddrD)) {
         *out_mbAddrD = -1;
     }
 }
 
 /* 6.4.11.1 Derivation process for neighbouring macroblocks*/
-void neighbouring_macroblocks(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags,
+void neighbouring_macroblocks(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags,
                               int32_t is_chroma, int32_t MbWidthC, int32_t MbHeightC, int32_t* out_mbAddrA, int32_t* out_mbAddrB) {
     int32_t out_xW = 0;
     int32_t out_yW = 0;
@@ -249,16 +273,16 @@ void neighbouring_macroblocks(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_
     }
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xA, yA, maxW, maxH, &out_mbAddrA_type, out_mbAddrA, &out_xW,
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xA, yA, maxW, maxH, &out_mbAddrA_type, out_mbAddrA, &out_xW,
                            &out_yW);
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xB, yB, maxW, maxH, &out_mbAddrB_type, out_mbAddrB, &out_xW,
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xB, yB, maxW, maxH, &out_mbAddrB_type, out_mbAddrB, &out_xW,
                            &out_yW);
 }
 
 /* 6.4.11.2 Derivation process for neighbouring 8x8 luma block */
-void neighbouring_8x8_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags,
+void neighbouring_8x8_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags,
                                  int32_t luma8x8BlkIdx, int32_t* out_mbAddrA, int32_t* out_luma8x8BlkIdxA, int32_t* out_mbAddrB, int32_t* out_luma8x8BlkIdxB) {
     int32_t xW = 0;
     int32_t yW = 0;
@@ -268,7 +292,7 @@ void neighbouring_8x8_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int
     RELATIVE_LOCATION_TYPE mbAddrA_type = RELATIVE_LOCATION_TYPE_NOT_AVAILABLE;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xA, yA, 16, 16, &mbAddrA_type, out_mbAddrA, &xW, &yW);
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xA, yA, 16, 16, &mbAddrA_type, out_mbAddrA, &xW, &yW);
     if (*out_mbAddrA < 0) {
         *out_luma8x8BlkIdxA = -1;
     } else {
@@ -280,7 +304,7 @@ void neighbouring_8x8_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int
     RELATIVE_LOCATION_TYPE mbAddrB_type = RELATIVE_LOCATION_TYPE_NOT_AVAILABLE;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xB, yB, 16, 16, &mbAddrB_type, out_mbAddrB, &xW, &yW);
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xB, yB, 16, 16, &mbAddrB_type, out_mbAddrB, &xW, &yW);
     if (*out_mbAddrB < 0) {
         *out_luma8x8BlkIdxB = -1;
     } else {
@@ -290,7 +314,7 @@ void neighbouring_8x8_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int
 
 /* 6.4.11.3 Derivation process for neighbouring 8x8 chroma blocks for ChromaArrayType equal to 3 */
 void neighbouring_8x8_chroma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t MbWidthC, int32_t MbHeightC,
-                                   int32_t* mb_slice_ids, int32_t* mb_frame_flags, int32_t cbcr8x8BlkIdx, int32_t* out_mbAddrA, int32_t* out_cbcr8x8BlkIdxA, int32_t* out_mbAddrB,
+                                   int32_t* mb_slice_ids, uint32_t* mb_field_flags, int32_t cbcr8x8BlkIdx, int32_t* out_mbAddrA, int32_t* out_cbcr8x8BlkIdxA, int32_t* out_mbAddrB,
                                    int32_t* out_cbcr8x8BlkIdxB) {
     int32_t xW = 0;
     int32_t yW = 0;
@@ -300,7 +324,7 @@ void neighbouring_8x8_chroma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, i
     RELATIVE_LOCATION_TYPE mbAddrA_type = RELATIVE_LOCATION_TYPE_NOT_AVAILABLE;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xA, yA, MbWidthC, MbHeightC, &mbAddrA_type, out_mbAddrA, &xW,
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xA, yA, MbWidthC, MbHeightC, &mbAddrA_type, out_mbAddrA, &xW,
                            &yW);
     if (*out_mbAddrA < 0) {
         *out_cbcr8x8BlkIdxA = -1;
@@ -313,7 +337,7 @@ void neighbouring_8x8_chroma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, i
     RELATIVE_LOCATION_TYPE mbAddrB_type = RELATIVE_LOCATION_TYPE_NOT_AVAILABLE;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xB, yB, MbWidthC, MbHeightC, &mbAddrB_type, out_mbAddrB, &xW,
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xB, yB, MbWidthC, MbHeightC, &mbAddrB_type, out_mbAddrB, &xW,
                            &yW);
     if (*out_mbAddrB < 0) {
         *out_cbcr8x8BlkIdxB = -1;
@@ -323,7 +347,7 @@ void neighbouring_8x8_chroma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, i
 }
 
 /* 6.4.11.4 Derivation process for neighbouring 4x4 luma blocks */
-void neighbouring_4x4_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags,
+void neighbouring_4x4_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags,
                                  int32_t luma4x4BlkIdx, int32_t* out_mbAddrA, int32_t* out_luma4x4BlkIdxA, int32_t* out_mbAddrB, int32_t* out_luma4x4BlkIdxB) {
     int32_t xW = 0;
     int32_t yW = 0;
@@ -340,7 +364,7 @@ void neighbouring_4x4_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int
     RELATIVE_LOCATION_TYPE mbAddrA_type = RELATIVE_LOCATION_TYPE_NOT_AVAILABLE;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xA, yA, 16, 16, &mbAddrA_type, out_mbAddrA, &xW, &yW);
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xA, yA, 16, 16, &mbAddrA_type, out_mbAddrA, &xW, &yW);
     if (*out_mbAddrA < 0) {
         *out_luma4x4BlkIdxA = -1;
     } else {
@@ -353,7 +377,7 @@ void neighbouring_4x4_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int
     RELATIVE_LOCATION_TYPE mbAddrB_type = RELATIVE_LOCATION_TYPE_NOT_AVAILABLE;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xB, yB, 16, 16, &mbAddrB_type, out_mbAddrB, &xW, &yW);
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xB, yB, 16, 16, &mbAddrB_type, out_mbAddrB, &xW, &yW);
     if (*out_mbAddrB < 0) {
         *out_luma4x4BlkIdxB = -1;
     } else {
@@ -363,7 +387,7 @@ void neighbouring_4x4_luma_block(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int
 
 /* 6.4.11.5 Derivation process for neighbouring 4x4 chroma blocks */
 void neighbouring_4x4_chroma_block_ChromaArrayType_12(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t MbWidthC,
-                                                      int32_t MbHeightC, int32_t* mb_slice_ids, int32_t* mb_frame_flags, int32_t chroma4x4BlkIdx, int32_t* out_mbAddrA,
+                                                      int32_t MbHeightC, int32_t* mb_slice_ids, uint32_t* mb_field_flags, int32_t chroma4x4BlkIdx, int32_t* out_mbAddrA,
                                                       int32_t* out_chroma4x4BlkIdxA, int32_t* out_mbAddrB, int32_t* out_chroma4x4BlkIdxB) {
     int32_t xW = 0;
     int32_t yW = 0;
@@ -380,7 +404,7 @@ void neighbouring_4x4_chroma_block_ChromaArrayType_12(int32_t MbaffFrameFlag, in
     RELATIVE_LOCATION_TYPE mbAddrA_type = RELATIVE_LOCATION_TYPE_NOT_AVAILABLE;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xA, yA, MbWidthC, MbHeightC, &mbAddrA_type, out_mbAddrA, &xW,
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xA, yA, MbWidthC, MbHeightC, &mbAddrA_type, out_mbAddrA, &xW,
                            &yW);
     if (*out_mbAddrA < 0) {
         *out_chroma4x4BlkIdxA = -1;
@@ -394,7 +418,7 @@ void neighbouring_4x4_chroma_block_ChromaArrayType_12(int32_t MbaffFrameFlag, in
     RELATIVE_LOCATION_TYPE mbAddrB_type = RELATIVE_LOCATION_TYPE_NOT_AVAILABLE;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xB, yB, MbWidthC, MbHeightC, &mbAddrB_type, out_mbAddrB, &xW,
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xB, yB, MbWidthC, MbHeightC, &mbAddrB_type, out_mbAddrB, &xW,
                            &yW);
     if (*out_mbAddrB < 0) {
         *out_chroma4x4BlkIdxB = -1;
@@ -405,7 +429,7 @@ void neighbouring_4x4_chroma_block_ChromaArrayType_12(int32_t MbaffFrameFlag, in
 
 /* 6.4.11.6 Derivation process for neighbouring 4x4 chroma blocks for ChromaArrayType equal to 3 */
 void neighbouring_4x4_chroma_block_ChromaArrayType_3(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t MbWidthC,
-                                                     int32_t MbHeightC, int32_t* mb_slice_ids, int32_t* mb_frame_flags, int32_t chroma4x4BlkIdx, int32_t* out_mbAddrA,
+                                                     int32_t MbHeightC, int32_t* mb_slice_ids, uint32_t* mb_field_flags, int32_t chroma4x4BlkIdx, int32_t* out_mbAddrA,
                                                      int32_t* out_chroma4x4BlkIdxA, int32_t* out_mbAddrB, int32_t* out_chroma4x4BlkIdxB) {
     int32_t xW = 0;
     int32_t yW = 0;
@@ -422,7 +446,7 @@ void neighbouring_4x4_chroma_block_ChromaArrayType_3(int32_t MbaffFrameFlag, int
     RELATIVE_LOCATION_TYPE mbAddrA_type = RELATIVE_LOCATION_TYPE_NOT_AVAILABLE;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xA, yA, MbWidthC, MbHeightC, &mbAddrA_type, out_mbAddrA, &xW,
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xA, yA, MbWidthC, MbHeightC, &mbAddrA_type, out_mbAddrA, &xW,
                            &yW);
     if (*out_mbAddrA < 0) {
         *out_chroma4x4BlkIdxA = -1;
@@ -436,7 +460,7 @@ void neighbouring_4x4_chroma_block_ChromaArrayType_3(int32_t MbaffFrameFlag, int
     RELATIVE_LOCATION_TYPE mbAddrB_type = RELATIVE_LOCATION_TYPE_NOT_AVAILABLE;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xB, yB, MbWidthC, MbHeightC, &mbAddrB_type, out_mbAddrB, &xW,
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xB, yB, MbWidthC, MbHeightC, &mbAddrB_type, out_mbAddrB, &xW,
                            &yW);
     if (*out_mbAddrB < 0) {
         *out_chroma4x4BlkIdxB = -1;
@@ -446,7 +470,7 @@ void neighbouring_4x4_chroma_block_ChromaArrayType_3(int32_t MbaffFrameFlag, int
 }
 
 /* 6.4.11.7 Derivation process for neighbouring partitions */
-int neighbouring_partitions(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags,
+int neighbouring_partitions(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags,
                             int32_t mbPartIdx, MB_TYPE_NAME currSubMbType, int32_t subMbPartIdx, MB_TYPE_NAME subMbPartType, int32_t* out_mbAddrA, int32_t* out_mbPartIdxA,
                             int32_t* out_subMbPartIdxA, int32_t* out_mbAddrB, int32_t* out_mbPartIdxB, int32_t* out_subMbPartIdxB, int32_t* out_mbAddrC, int32_t* out_mbPartIdxC,
                             int32_t* out_subMbPartIdxC, int32_t* out_mbAddrD, int32_t* out_mbPartIdxD, int32_t* out_subMbPartIdxD) {
@@ -484,7 +508,10 @@ int neighbouring_partitions(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t
             return err_code;
         }
     } else { /* Otherwise, predPartWidth = MbPartWidth( mb_type ). */
-        predPartWidth = MbPartWidth(currSubMbType, &predPartWidth);
+        err_code = MbPartWidth(currSubMbType, &predPartWidth);
+        if (err_code < 0) {
+            return err_code;
+        }
     }
 
     int32_t xD_A = -1;
@@ -520,13 +547,13 @@ int neighbouring_partitions(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t
     int32_t yW_D = 0;
 
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xN_A, yN_A, 16, 16, &mbAddrA_type, out_mbAddrA, &xW_A, &yW_A);
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xN_A, yN_A, 16, 16, &mbAddrA_type, out_mbAddrA, &xW_A, &yW_A);
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xN_B, yN_B, 16, 16, &mbAddrB_type, out_mbAddrB, &xW_B, &yW_B);
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xN_B, yN_B, 16, 16, &mbAddrB_type, out_mbAddrB, &xW_B, &yW_B);
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xN_C, yN_C, 16, 16, &mbAddrC_type, out_mbAddrC, &xW_C, &yW_C);
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xN_C, yN_C, 16, 16, &mbAddrC_type, out_mbAddrC, &xW_C, &yW_C);
     /* 6.4.12 Derivation process for neighbouring locations */
-    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xN_D, yN_D, 16, 16, &mbAddrD_type, out_mbAddrD, &xW_D, &yW_D);
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xN_D, yN_D, 16, 16, &mbAddrD_type, out_mbAddrD, &xW_D, &yW_D);
 
     if (*out_mbAddrA < 0) {
         *out_mbPartIdxA = -1;
@@ -552,12 +579,12 @@ int neighbouring_partitions(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t
 }
 
 /* 6.4.12 Derivation process for neighbouring locations */
-void neighbouring_locations(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags, int32_t xN,
+void neighbouring_locations(int32_t MbaffFrameFlag, int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags, int32_t xN,
                             int32_t yN, int32_t maxW, int32_t maxH, RELATIVE_LOCATION_TYPE* out_mbAddrN_type, int32_t* out_mbAddrN, int32_t* out_xW, int32_t* out_yW) {
     if (!MbaffFrameFlag) { /* 6.4.12.1 Specification for neighbouring locations in fields and non-MBAFF frames */
         neighbouring_locations_in_frame_non_MBAFF_frame(CurrMbAddr, PicWidthInMbs, mb_slice_ids, xN, yN, maxW, maxH, out_mbAddrN_type, out_mbAddrN, out_xW, out_yW);
     } else { /* 6.4.12.2 Specification for neighbouring locations in MBAFF frames */
-        neighbouring_locations_in_MBAFF_frame(CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_frame_flags, xN, yN, maxW, maxH, out_mbAddrN_type, out_mbAddrN, out_xW,
+        neighbouring_locations_in_MBAFF_frame(CurrMbAddr, currMbFrameFlag, PicWidthInMbs, mb_slice_ids, mb_field_flags, xN, yN, maxW, maxH, out_mbAddrN_type, out_mbAddrN, out_xW,
                                               out_yW);
     }
 }
@@ -618,7 +645,7 @@ void neighbouring_locations_in_frame_non_MBAFF_frame(int32_t CurrMbAddr, int32_t
 }
 
 /* 6.4.12.2 Specification for neighbouring locations in MBAFF frames */
-void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, int32_t* mb_frame_flags, int32_t xN,
+void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFrameFlag, int32_t PicWidthInMbs, int32_t* mb_slice_ids, uint32_t* mb_field_flags, int32_t xN,
                                            int32_t yN, int32_t maxW, int32_t maxH, RELATIVE_LOCATION_TYPE* out_mbAddrN_type, int32_t* out_mbAddrN, int32_t* out_xW,
                                            int32_t* out_yW) {
     int32_t mbIsTopMbFlag = 0;
@@ -636,7 +663,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
     int32_t mbAddrC = 0;
     int32_t mbAddrD = 0;
 
-    neighbouring_mb_address_availability_in_MBAFF_frame(CurrMbAddr, PicWidthInMbs, mb_slice_ids, &mbAddrA, mbAddrB, mbAddrC, mbAddrD);
+    neighbouring_mb_address_availability_in_MBAFF_frame(CurrMbAddr, PicWidthInMbs, mb_slice_ids, &mbAddrA, &mbAddrB, &mbAddrC, &mbAddrD);
 
     /* check if the current macroblock is a top macroblock */
     if (CurrMbAddr % 2 == 0) {
@@ -657,7 +684,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
                 mbAddrX_type = RELATIVE_LOCATION_TYPE_mbAddrA;
                 mbAddrX = mbAddrA;
                 if (mbAddrX >= 0) {
-                    mbAddrXFrameFlag = mb_frame_flags[mbAddrX];
+                    mbAddrXFrameFlag = !bitset_get(mb_field_flags, mbAddrX);
                     if (mbAddrXFrameFlag) {
                         *out_mbAddrN_type = RELATIVE_LOCATION_TYPE_mbAddrA;
                         *out_mbAddrN = mbAddrA;
@@ -674,7 +701,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
                 mbAddrX_type = RELATIVE_LOCATION_TYPE_mbAddrD;
                 mbAddrX = mbAddrD;
                 if (mbAddrX >= 0) {
-                    mbAddrXFrameFlag = mb_frame_flags[mbAddrX];
+                    mbAddrXFrameFlag = !bitset_get(mb_field_flags, mbAddrX);
                     if (mbAddrXFrameFlag) {
                         *out_mbAddrN_type = RELATIVE_LOCATION_TYPE_mbAddrD_add_1;
                         *out_mbAddrN = mbAddrD + 1;
@@ -699,7 +726,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
                 mbAddrX_type = RELATIVE_LOCATION_TYPE_mbAddrA;
                 mbAddrX = mbAddrA;
                 if (mbAddrX >= 0) {
-                    mbAddrXFrameFlag = mb_frame_flags[mbAddrX];
+                    mbAddrXFrameFlag = !bitset_get(mb_field_flags, mbAddrX);
                     if (mbAddrXFrameFlag) {
                         *out_mbAddrN_type = RELATIVE_LOCATION_TYPE_mbAddrA;
                         *out_mbAddrN = mbAddrA;
@@ -720,7 +747,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
                 mbAddrX_type = RELATIVE_LOCATION_TYPE_mbAddrA;
                 mbAddrX = mbAddrA;
                 if (mbAddrX >= 0) {
-                    mbAddrXFrameFlag = mb_frame_flags[mbAddrX];
+                    mbAddrXFrameFlag = !bitset_get(mb_field_flags, mbAddrX);
                     if (mbAddrXFrameFlag) {
                         *out_mbAddrN_type = RELATIVE_LOCATION_TYPE_mbAddrA_add_1;
                         *out_mbAddrN = mbAddrA + 1;
@@ -743,7 +770,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
                 mbAddrX_type = RELATIVE_LOCATION_TYPE_mbAddrA;
                 mbAddrX = mbAddrA;
                 if (mbAddrX >= 0) {
-                    mbAddrXFrameFlag = mb_frame_flags[mbAddrX];
+                    mbAddrXFrameFlag = !bitset_get(mb_field_flags, mbAddrX);
                     if (mbAddrXFrameFlag) {
                         if (yN < (maxH / 2)) {
                             *out_mbAddrN_type = RELATIVE_LOCATION_TYPE_mbAddrA;
@@ -764,7 +791,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
                 mbAddrX_type = RELATIVE_LOCATION_TYPE_mbAddrA;
                 mbAddrX = mbAddrA;
                 if (mbAddrX >= 0) {
-                    mbAddrXFrameFlag = mb_frame_flags[mbAddrX];
+                    mbAddrXFrameFlag = !bitset_get(mb_field_flags, mbAddrX);
                     if (mbAddrXFrameFlag) {
                         if (yN < (maxH / 2)) {
                             *out_mbAddrN_type = RELATIVE_LOCATION_TYPE_mbAddrA;
@@ -803,7 +830,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
                 mbAddrX_type = RELATIVE_LOCATION_TYPE_mbAddrB;
                 mbAddrX = mbAddrB;
                 if (mbAddrX >= 0) {
-                    mbAddrXFrameFlag = mb_frame_flags[mbAddrX];
+                    mbAddrXFrameFlag = !bitset_get(mb_field_flags, mbAddrX);
                     if (mbAddrXFrameFlag) {
                         *out_mbAddrN_type = RELATIVE_LOCATION_TYPE_mbAddrB_add_1;
                         *out_mbAddrN = mbAddrB + 1;
@@ -848,7 +875,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
                 mbAddrX_type = RELATIVE_LOCATION_TYPE_mbAddrC;
                 mbAddrX = mbAddrC;
                 if (mbAddrX >= 0) {
-                    mbAddrXFrameFlag = mb_frame_flags[mbAddrX];
+                    mbAddrXFrameFlag = !bitset_get(mb_field_flags, mbAddrX);
                     if (mbAddrXFrameFlag) {
                         *out_mbAddrN_type = RELATIVE_LOCATION_TYPE_mbAddrC_add_1;
                         *out_mbAddrN = mbAddrC + 1;
@@ -880,7 +907,7 @@ void neighbouring_locations_in_MBAFF_frame(int32_t CurrMbAddr, int32_t currMbFra
 }
 
 /* 6.4.13.1 Derivation process for 4x4 luma block indices */
-void derivate_4x4_luma_block_indices(int32_t xP, int32_t yP, int32_t* out_luma4x4BlkIdx) { *out_luma4x4BlkIdx = 8 * (yP / 8) + 4 * (xP / 8) + 2 * ((yP % 8) / 4) + ((xP % 8) / 4); }
+void derivate_4x4_luma_block_indices(int32_t xP, int32_t yP, int32_t* out_luma4x4BlkIdx) { *out_luma4x4BlkIdx = g_luma4x4_blk_idx[yP >> 2][xP >> 2]; }
 
 /* 6.4.13.2 Derivation process for 4x4 chroma block indices */
 void derivate_4x4_chroma_block_indices(int32_t xP, int32_t yP, int32_t* out_chroma4x4BlkIdx) { *out_chroma4x4BlkIdx = 2 * (yP / 4) + (xP / 4); }
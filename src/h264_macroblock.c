@@ -1,309 +1,255 @@
 #include "h264decoder/h264_macroblock.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#include "h264decoder/h264_cavlc.h"
+#include "h264decoder/h264_intra_pred.h"
+#include "h264decoder/h264_locations_neighbours.h"
+#include "h264decoder/h264_mv_pred.h"
 #include "h264decoder/h264_picture.h"
+#include "h264decoder/h264_transform.h"
 
 /**
- * @brief macroblock types for I slices
+ * @brief the properties of the macroblock types and the sub-macroblock types, indexed by MB_TYPE_NAME
  * @see Table 7-11 – Macroblock types for I slices
- *
- * {
- *   mb_type
- *   Name of mb_type
- *   transform_size_8x8_flag
- *   MbPartPredMode(mb_type, 0)
- *   Intra16x16PredMode
- *   CodedBlockPatternChroma
- *   CodedBlockPatternLuma
- * }
- */
-static const MB_TYPE_FOR_I_SLICES g_mb_type_for_i_slices[27] = {
-    {0, I_NxN, 0, Intra_4x4, -1, -1, -1},           {0, I_NxN, 1, Intra_8x8, -1, -1, -1},           {1, I_16x16_0_0_0, -1, Intra_16x16, 0, 0, 0},
-    {2, I_16x16_1_0_0, -1, Intra_16x16, 1, 0, 0},   {3, I_16x16_2_0_0, -1, Intra_16x16, 2, 0, 0},   {4, I_16x16_3_0_0, -1, Intra_16x16, 3, 0, 0},
-    {5, I_16x16_0_1_0, -1, Intra_16x16, 0, 1, 0},   {6, I_16x16_1_1_0, -1, Intra_16x16, 1, 1, 0},   {7, I_16x16_2_1_0, -1, Intra_16x16, 2, 1, 0},
-    {8, I_16x16_3_1_0, -1, Intra_16x16, 3, 1, 0},   {9, I_16x16_0_2_0, -1, Intra_16x16, 0, 2, 0},   {10, I_16x16_1_2_0, -1, Intra_16x16, 1, 2, 0},
-    {11, I_16x16_2_2_0, -1, Intra_16x16, 2, 2, 0},  {12, I_16x16_3_2_0, -1, Intra_16x16, 3, 2, 0},  {13, I_16x16_0_0_1, -1, Intra_16x16, 0, 0, 15},
-    {14, I_16x16_1_0_1, -1, Intra_16x16, 1, 0, 15}, {15, I_16x16_2_0_1, -1, Intra_16x16, 2, 0, 15}, {16, I_16x16_3_0_1, -1, Intra_16x16, 3, 0, 15},
-    {17, I_16x16_0_1_1, -1, Intra_16x16, 0, 1, 15}, {18, I_16x16_1_1_1, -1, Intra_16x16, 1, 1, 15}, {19, I_16x16_2_1_1, -1, Intra_16x16, 2, 1, 15},
-    {20, I_16x16_3_1_1, -1, Intra_16x16, 3, 1, 15}, {21, I_16x16_0_2_1, -1, Intra_16x16, 0, 2, 15}, {22, I_16x16_1_2_1, -1, Intra_16x16, 1, 2, 15},
-    {23, I_16x16_2_2_1, -1, Intra_16x16, 2, 2, 15}, {24, I_16x16_3_2_1, -1, Intra_16x16, 3, 2, 15}, {25, I_PCM, -1, Intra_NA, -1, -1, -1},
-};
-
-/**
- * @brief Macroblock type with value 0 for SI slices
  * @see Table 7-12 – Macroblock type with value 0 for SI slices
+ * @see Table 7-13 – Macroblock type values 0 to 4 for P and SP slices
+ * @see Table 7-14 – Macroblock type values 0 to 22 for B slices
+ * @see Table 7-17 – Sub-macroblock types in P macroblocks
+ * @see Table 7-18 – Sub-macroblock types in B macroblocks
  *
  * {
- *   mb_type
- *   Name of mb_type
- *   MbPartPredMode(mb_type, 0)
+ *   mb_type or sub_mb_type
+ *   NumMbPart( mb_type ) or NumSubMbPart( sub_mb_type )
+ *   MbPartWidth( mb_type ) or SubMbPartWidth( sub_mb_type )
+ *   MbPartHeight( mb_type ) or SubMbPartHeight( sub_mb_type )
+ *   MbPartPredMode( mb_type, 0 ) or SubMbPredMode( sub_mb_type )
+ *   MbPartPredMode( mb_type, 1 )
  *   Intra16x16PredMode
  *   CodedBlockPatternChroma
  *   CodedBlockPatternLuma
+ *   is_sub_mb_type
+ *   the x of the upper-left luma sample of the partitions
+ *   the y of the upper-left luma sample of the partitions
  * }
  */
-static const MB_TYPE_FOR_SI_SLICES g_mb_type_for_si_slices[1] = {
-    {0, SI_SI, Intra_4x4, -1, -1, -1},
+const MB_TYPE_INFO g_mb_type_info[MB_TYPE_NAME_NUM] = {
+    [I_NxN] = {0, -1, 0, 0, Intra_4x4, Pred_NA, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_0_0_0] = {1, -1, 0, 0, Intra_16x16, Pred_NA, 0, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_1_0_0] = {2, -1, 0, 0, Intra_16x16, Pred_NA, 1, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_2_0_0] = {3, -1, 0, 0, Intra_16x16, Pred_NA, 2, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_3_0_0] = {4, -1, 0, 0, Intra_16x16, Pred_NA, 3, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_0_1_0] = {5, -1, 0, 0, Intra_16x16, Pred_NA, 0, 1, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_1_1_0] = {6, -1, 0, 0, Intra_16x16, Pred_NA, 1, 1, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_2_1_0] = {7, -1, 0, 0, Intra_16x16, Pred_NA, 2, 1, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_3_1_0] = {8, -1, 0, 0, Intra_16x16, Pred_NA, 3, 1, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_0_2_0] = {9, -1, 0, 0, Intra_16x16, Pred_NA, 0, 2, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_1_2_0] = {10, -1, 0, 0, Intra_16x16, Pred_NA, 1, 2, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_2_2_0] = {11, -1, 0, 0, Intra_16x16, Pred_NA, 2, 2, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_3_2_0] = {12, -1, 0, 0, Intra_16x16, Pred_NA, 3, 2, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_0_0_1] = {13, -1, 0, 0, Intra_16x16, Pred_NA, 0, 0, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_1_0_1] = {14, -1, 0, 0, Intra_16x16, Pred_NA, 1, 0, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_2_0_1] = {15, -1, 0, 0, Intra_16x16, Pred_NA, 2, 0, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_3_0_1] = {16, -1, 0, 0, Intra_16x16, Pred_NA, 3, 0, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_0_1_1] = {17, -1, 0, 0, Intra_16x16, Pred_NA, 0, 1, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_1_1_1] = {18, -1, 0, 0, Intra_16x16, Pred_NA, 1, 1, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_2_1_1] = {19, -1, 0, 0, Intra_16x16, Pred_NA, 2, 1, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_3_1_1] = {20, -1, 0, 0, Intra_16x16, Pred_NA, 3, 1, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_0_2_1] = {21, -1, 0, 0, Intra_16x16, Pred_NA, 0, 2, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_1_2_1] = {22, -1, 0, 0, Intra_16x16, Pred_NA, 1, 2, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_2_2_1] = {23, -1, 0, 0, Intra_16x16, Pred_NA, 2, 2, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_16x16_3_2_1] = {24, -1, 0, 0, Intra_16x16, Pred_NA, 3, 2, 15, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [I_PCM] = {25, -1, 0, 0, Intra_NA, Pred_NA, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [SI_SI] = {0, -1, 0, 0, Intra_4x4, Pred_NA, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [P_L0_16x16] = {0, 1, 16, 16, Pred_L0, Pred_NA, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [P_L0_L0_16x8] = {1, 2, 16, 8, Pred_L0, Pred_L0, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 8, 0, 0}},
+    [P_L0_L0_8x16] = {2, 2, 8, 16, Pred_L0, Pred_L0, -1, 0, 0, 0, {0, 8, 0, 0}, {0, 0, 0, 0}},
+    [P_8x8] = {3, 4, 8, 8, Pred_NA, Pred_NA, -1, 0, 0, 0, {0, 8, 0, 8}, {0, 0, 8, 8}},
+    [P_8x8ref0] = {4, 4, 8, 8, Pred_NA, Pred_NA, -1, 0, 0, 0, {0, 8, 0, 8}, {0, 0, 8, 8}},
+    [P_Skip] = {5, 1, 16, 16, Pred_L0, Pred_NA, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [B_Direct_16x16] = {0, -1, 8, 8, Direct, Pred_NA, -1, 0, 0, 0, {0, 8, 0, 8}, {0, 0, 8, 8}},
+    [B_L0_16x16] = {1, 1, 16, 16, Pred_L0, Pred_NA, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [B_L1_16x16] = {2, 1, 16, 16, Pred_L1, Pred_NA, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [B_Bi_16x16] = {3, 1, 16, 16, BiPred, Pred_NA, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [B_L0_L0_16x8] = {4, 2, 16, 8, Pred_L0, Pred_L0, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 8, 0, 0}},
+    [B_L0_L0_8x16] = {5, 2, 8, 16, Pred_L0, Pred_L0, -1, 0, 0, 0, {0, 8, 0, 0}, {0, 0, 0, 0}},
+    [B_L1_L1_16x8] = {6, 2, 16, 8, Pred_L1, Pred_L1, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 8, 0, 0}},
+    [B_L1_L1_8x16] = {7, 2, 8, 16, Pred_L1, Pred_L1, -1, 0, 0, 0, {0, 8, 0, 0}, {0, 0, 0, 0}},
+    [B_L0_L1_16x8] = {8, 2, 16, 8, Pred_L0, Pred_L1, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 8, 0, 0}},
+    [B_L0_L1_8x16] = {9, 2, 8, 16, Pred_L0, Pred_L1, -1, 0, 0, 0, {0, 8, 0, 0}, {0, 0, 0, 0}},
+    [B_L1_L0_16x8] = {10, 2, 16, 8, Pred_L1, Pred_L0, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 8, 0, 0}},
+    [B_L1_L0_8x16] = {11, 2, 8, 16, Pred_L1, Pred_L0, -1, 0, 0, 0, {0, 8, 0, 0}, {0, 0, 0, 0}},
+    [B_L0_Bi_16x8] = {12, 2, 16, 8, Pred_L0, BiPred, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 8, 0, 0}},
+    [B_L0_Bi_8x16] = {13, 2, 8, 16, Pred_L0, BiPred, -1, 0, 0, 0, {0, 8, 0, 0}, {0, 0, 0, 0}},
+    [B_L1_Bi_16x8] = {14, 2, 16, 8, Pred_L1, BiPred, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 8, 0, 0}},
+    [B_L1_Bi_8x16] = {15, 2, 8, 16, Pred_L1, BiPred, -1, 0, 0, 0, {0, 8, 0, 0}, {0, 0, 0, 0}},
+    [B_Bi_L0_16x8] = {16, 2, 16, 8, BiPred, Pred_L0, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 8, 0, 0}},
+    [B_Bi_L0_8x16] = {17, 2, 8, 16, BiPred, Pred_L0, -1, 0, 0, 0, {0, 8, 0, 0}, {0, 0, 0, 0}},
+    [B_Bi_L1_16x8] = {18, 2, 16, 8, BiPred, Pred_L1, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 8, 0, 0}},
+    [B_Bi_L1_8x16] = {19, 2, 8, 16, BiPred, Pred_L1, -1, 0, 0, 0, {0, 8, 0, 0}, {0, 0, 0, 0}},
+    [B_Bi_Bi_16x8] = {20, 2, 16, 8, BiPred, BiPred, -1, 0, 0, 0, {0, 0, 0, 0}, {0, 8, 0, 0}},
+    [B_Bi_Bi_8x16] = {21, 2, 8, 16, BiPred, BiPred, -1, 0, 0, 0, {0, 8, 0, 0}, {0, 0, 0, 0}},
+    [B_8x8] = {22, 4, 8, 8, Pred_NA, Pred_NA, -1, 0, 0, 0, {0, 8, 0, 8}, {0, 0, 8, 8}},
+    [B_Skip] = {23, -1, 8, 8, Direct, Pred_NA, -1, 0, 0, 0, {0, 8, 0, 8}, {0, 0, 8, 8}},
+    [P_L0_8x8] = {0, 1, 8, 8, Pred_L0, Pred_NA, -1, 0, 0, 1, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [P_L0_8x4] = {1, 2, 8, 4, Pred_L0, Pred_NA, -1, 0, 0, 1, {0, 0, 0, 0}, {0, 4, 0, 0}},
+    [P_L0_4x8] = {2, 2, 4, 8, Pred_L0, Pred_NA, -1, 0, 0, 1, {0, 4, 0, 0}, {0, 0, 0, 0}},
+    [P_L0_4x4] = {3, 4, 4, 4, Pred_L0, Pred_NA, -1, 0, 0, 1, {0, 4, 0, 4}, {0, 0, 4, 4}},
+    [B_Direct_8x8] = {0, 4, 4, 4, Direct, Pred_NA, -1, 0, 0, 1, {0, 4, 0, 4}, {0, 0, 4, 4}},
+    [B_L0_8x8] = {1, 1, 8, 8, Pred_L0, Pred_NA, -1, 0, 0, 1, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [B_L1_8x8] = {2, 1, 8, 8, Pred_L1, Pred_NA, -1, 0, 0, 1, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [B_Bi_8x8] = {3, 1, 8, 8, BiPred, Pred_NA, -1, 0, 0, 1, {0, 0, 0, 0}, {0, 0, 0, 0}},
+    [B_L0_8x4] = {4, 2, 8, 4, Pred_L0, Pred_NA, -1, 0, 0, 1, {0, 0, 0, 0}, {0, 4, 0, 0}},
+    [B_L0_4x8] = {5, 2, 4, 8, Pred_L0, Pred_NA, -1, 0, 0, 1, {0, 4, 0, 0}, {0, 0, 0, 0}},
+    [B_L1_8x4] = {6, 2, 8, 4, Pred_L1, Pred_NA, -1, 0, 0, 1, {0, 0, 0, 0}, {0, 4, 0, 0}},
+    [B_L1_4x8] = {7, 2, 4, 8, Pred_L1, Pred_NA, -1, 0, 0, 1, {0, 4, 0, 0}, {0, 0, 0, 0}},
+    [B_Bi_8x4] = {8, 2, 8, 4, BiPred, Pred_NA, -1, 0, 0, 1, {0, 0, 0, 0}, {0, 4, 0, 0}},
+    [B_Bi_4x8] = {9, 2, 4, 8, BiPred, Pred_NA, -1, 0, 0, 1, {0, 4, 0, 0}, {0, 0, 0, 0}},
+    [B_L0_4x4] = {10, 4, 4, 4, Pred_L0, Pred_NA, -1, 0, 0, 1, {0, 4, 0, 4}, {0, 0, 4, 4}},
+    [B_L1_4x4] = {11, 4, 4, 4, Pred_L1, Pred_NA, -1, 0, 0, 1, {0, 4, 0, 4}, {0, 0, 4, 4}},
+    [B_Bi_4x4] = {12, 4, 4, 4, BiPred, Pred_NA, -1, 0, 0, 1, {0, 4, 0, 4}, {0, 0, 4, 4}},
 };
 
 /**
- * @brief Macroblock type values 0 to 4 for P and SP slices
- * @see Table 7-13 – Macroblock type values 0 to 4 for P and SP slices
- *
- * {
- *  mb_type
- *  Name of mb_type
- *  NumMbPart( mb_type )
- *  MbPartPredMode( mb_type, 0 )
- *  MbPartPredMode( mb_type, 1 )
- *  MbPartWidth( mb_type )
- *  MbPartHeight( mb_type )
- * }
+ * @brief the first MB_TYPE_NAME of the macroblock type table of the slice type and the number of the macroblock types in the table, indexed by slice_type % 5.
+ * P_Skip and B_Skip are included as the mb_type following the last one of Table 7-13 and Table 7-14
  */
-static const MB_TYPE_FOR_P_SP_SLICES g_mb_type_for_p_sp_slices[6] = {
-    {0, P_L0_16x16, 1, Pred_L0, Pred_NA, 16, 16}, {1, P_L0_L0_16x8, 2, Pred_L0, Pred_L0, 16, 8}, {2, P_L0_L0_8x16, 2, Pred_L0, Pred_L0, 8, 16},
-    {3, P_8x8, 4, Pred_NA, Pred_NA, 8, 8},        {4, P_8x8ref0, 4, Pred_NA, Pred_NA, 8, 8},     {5, P_Skip, 1, Pred_L0, Pred_NA, 16, 16},
+static const int32_t g_mb_type_name_base[5][2] = {
+    {P_L0_16x16, 6},      /* SLICE_TYPE_P */
+    {B_Direct_16x16, 24}, /* SLICE_TYPE_B */
+    {I_NxN, 26},          /* SLICE_TYPE_I */
+    {P_L0_16x16, 6},      /* SLICE_TYPE_SP */
+    {SI_SI, 1},           /* SLICE_TYPE_SI */
 };
 
-/**
- * @brief Macroblock type values 0 to 22 for B slices
- * @see Table 7-14 – Macroblock type values 0 to 22 for B slices
- *
- * {
- *  mb_type
- *  Name of mb_type
- *  NumMbPart( mb_type )
- *  MbPartPredMode( mb_type, 0 )
- *  MbPartPredMode( mb_type, 1 )
- *  MbPartWidth( mb_type )
- *  MbPartHeight( mb_type )
- * }
- */
-static const MB_TYPE_FOR_B_SLICES g_mb_type_for_b_slices[24] = {
-    {0, B_Direct_16x16, -1, Direct, Pred_NA, 8, 8}, {1, B_L0_16x16, 1, Pred_L0, Pred_NA, 16, 16},   {2, B_L1_16x16, 1, Pred_L1, Pred_NA, 16, 16},
-    {3, B_Bi_16x16, 1, BiPred, Pred_NA, 16, 16},    {4, B_L0_L0_16x8, 2, Pred_L0, Pred_L0, 16, 8},  {5, B_L0_L0_8x16, 2, Pred_L0, Pred_L0, 8, 16},
-    {6, B_L1_L1_16x8, 2, Pred_L1, Pred_L1, 16, 8},  {7, B_L1_L1_8x16, 2, Pred_L1, Pred_L1, 8, 16},  {8, B_L0_L1_16x8, 2, Pred_L0, Pred_L1, 16, 8},
-    {9, B_L0_L1_8x16, 2, Pred_L0, Pred_L1, 8, 16},  {10, B_L1_L0_16x8, 2, Pred_L1, Pred_L0, 16, 8}, {11, B_L1_L0_8x16, 2, Pred_L1, Pred_L0, 8, 16},
-    {12, B_L0_Bi_16x8, 2, Pred_L0, BiPred, 16, 8},  {13, B_L0_Bi_8x16, 2, Pred_L0, BiPred, 8, 16},  {14, B_L1_Bi_16x8, 2, Pred_L1, BiPred, 16, 8},
-    {15, B_L1_Bi_8x16, 2, Pred_L1, BiPred, 8, 16},  {16, B_Bi_L0_16x8, 2, BiPred, Pred_L0, 16, 8},  {17, B_Bi_L0_8x16, 2, BiPred, Pred_L0, 8, 16},
-    {18, B_Bi_L1_16x8, 2, BiPred, Pred_L1, 16, 8},  {19, B_Bi_L1_8x16, 2, BiPred, Pred_L1, 8, 16},  {20, B_Bi_Bi_16x8, 2, BiPred, BiPred, 16, 8},
-    {21, B_Bi_Bi_8x16, 2, BiPred, BiPred, 8, 16},   {22, B_8x8, 4, Pred_NA, Pred_NA, 8, 8},         {23, B_Skip, -1, Direct, Pred_NA, 8, 8},
-};
+int get_mb_type_name(int32_t slice_type, int32_t mb_type, MB_TYPE_NAME* out_mb_type_name) {
+    slice_type %= 5;
 
-/**
- * @brief Sub-macroblock types in P macroblocks
- * @see Table 7-17 – Sub-macroblock types in P macroblocks
- *
- * {
- *  sub_mb_type[ mbPartIdx ]
- *  Name of sub_mb_type[ mbPartIdx ]
- *  NumSubMbPart( sub_mb_type[ mbPartIdx ] )
- *  SubMbPredMode( sub_mb_type[ mbPartIdx ] )
- *  SubMbPartWidth( sub_mb_type[ mbPartIdx ] )
- *  SubMbPartHeight( sub_mb_type[ mbPartIdx ] )
- * }
- */
-static const SUB_MB_TYPE_IN_P_MB g_sub_mb_type_p_mb[4] = {
-    {0, P_L0_8x8, 1, Pred_L0, 8, 8},
-    {1, P_L0_8x4, 2, Pred_L0, 8, 4},
-    {2, P_L0_4x8, 2, Pred_L0, 4, 8},
-    {3, P_L0_4x4, 4, Pred_L0, 4, 4},
-};
+    if (mb_type < 0 || mb_type >= g_mb_type_name_base[slice_type][1]) {
+        return ERR_UNRECOGNIZED_MB;
+    }
 
-/**
- * @brief Sub-macroblock types in B macroblocks
- * @see Table 7-18 – Sub-macroblock types in B macroblocks
- *
- * {
- *  sub_mb_type[ mbPartIdx ]
- *  Name of sub_mb_type[ mbPartIdx ]
- *  NumSubMbPart ( sub_mb_type[ mbPartIdx ] )
- *  SubMbPredMode( sub_mb_type[ mbPartIdx ] )
- *  SubMbPartWidth( sub_mb_type[ mbPartIdx ] )
- *  SubMbPartHeight( sub_mb_type[ mbPartIdx ] )
- * }
- */
-static const SUB_MB_TYPE_IN_B_MB g_sub_mb_type_b_mb[13] = {
-    {0, B_Direct_8x8, 4, Direct, 4, 4}, {1, B_L0_8x8, 1, Pred_L0, 8, 8},  {2, B_L1_8x8, 1, Pred_L1, 8, 8}, {3, B_Bi_8x8, 1, BiPred, 8, 8}, {4, B_L0_8x4, 2, Pred_L0, 8, 4},
-    {5, B_L0_4x8, 2, Pred_L0, 4, 8},    {6, B_L1_8x4, 2, Pred_L1, 8, 4},  {7, B_L1_4x8, 2, Pred_L1, 4, 8}, {8, B_Bi_8x4, 2, BiPred, 8, 4}, {9, B_Bi_4x8, 2, BiPred, 4, 8},
-    {10, B_L0_4x4, 4, Pred_L0, 4, 4},   {11, B_L1_4x4, 4, Pred_L1, 4, 4}, {12, B_Bi_4x4, 4, BiPred, 4, 4},
-};
+    *out_mb_type_name = (MB_TYPE_NAME)(g_mb_type_name_base[slice_type][0] + mb_type);
+    return ERR_OK;
+}
 
 int MbPartWidth(MB_TYPE_NAME mb_type, int32_t* out_width) {
-    if (mb_type >= P_L0_16x16 && mb_type <= P_Skip) {
-        *out_width = g_mb_type_for_p_sp_slices[mb_type - P_L0_16x16].MbPartWidth;
-    } else if (mb_type >= B_Direct_16x16 && mb_type <= B_Skip) {
-        *out_width = g_mb_type_for_b_slices[mb_type - B_Direct_16x16].MbPartWidth;
-    } else {
+    const MB_TYPE_INFO* info = get_mb_type_info(mb_type);
+    if (info->is_sub_mb_type || !info->MbPartWidth) {
         return ERR_UNRECOGNIZED_MB;
     }
 
+    *out_width = info->MbPartWidth;
     return ERR_OK;
 }
 
 int MbPartHeight(MB_TYPE_NAME mb_type, int32_t* out_height) {
-    if (mb_type >= P_L0_16x16 && mb_type <= P_Skip) {
-        *out_height = g_mb_type_for_p_sp_slices[mb_type - P_L0_16x16].MbPartHeight;
-    } else if (mb_type >= B_Direct_16x16 && mb_type <= B_Skip) {
-        *out_height = g_mb_type_for_b_slices[mb_type - B_Direct_16x16].MbPartHeight;
-    } else {
+    const MB_TYPE_INFO* info = get_mb_type_info(mb_type);
+    if (info->is_sub_mb_type || !info->MbPartHeight) {
         return ERR_UNRECOGNIZED_MB;
     }
 
+    *out_height = info->MbPartHeight;
     return ERR_OK;
 }
 
 int MbPartWidthHeight(MB_TYPE_NAME mb_type, int32_t* out_width, int32_t* out_height) {
-    if (mb_type >= P_L0_16x16 && mb_type <= P_Skip) {
-        *out_width = g_mb_type_for_p_sp_slices[mb_type - P_L0_16x16].MbPartWidth;
-        *out_height = g_mb_type_for_p_sp_slices[mb_type - P_L0_16x16].MbPartHeight;
-    } else if (mb_type >= B_Direct_16x16 && mb_type <= B_Skip) {
-        *out_width = g_mb_type_for_b_slices[mb_type - B_Direct_16x16].MbPartWidth;
-        *out_height = g_mb_type_for_b_slices[mb_type - B_Direct_16x16].MbPartHeight;
-    } else {
+    const MB_TYPE_INFO* info = get_mb_type_info(mb_type);
+    if (info->is_sub_mb_type || !info->MbPartWidth) {
         return ERR_UNRECOGNIZED_MB;
     }
 
+    *out_width = info->MbPartWidth;
+    *out_height = info->MbPartHeight;
     return ERR_OK;
 }
 
 int SubMbPartWidth(MB_TYPE_NAME mb_type, int32_t* out_width) {
-    if (mb_type >= P_L0_8x8 && mb_type <= P_L0_4x4) {
-        *out_width = g_sub_mb_type_p_mb[mb_type - P_L0_8x8].SubMbPartWidth;
-    } else if (mb_type >= B_Direct_8x8 && mb_type <= B_Bi_4x4) {
-        *out_width = g_sub_mb_type_b_mb[mb_type - B_Direct_8x8].SubMbPartWidth;
-    } else {
+    const MB_TYPE_INFO* info = get_mb_type_info(mb_type);
+    if (!info->is_sub_mb_type) {
         return ERR_UNRECOGNIZED_MB;
     }
 
+    *out_width = info->MbPartWidth;
     return ERR_OK;
 }
 
 int SubMbPartHeight(MB_TYPE_NAME mb_type, int32_t* out_height) {
-    if (mb_type >= P_L0_8x8 && mb_type <= P_L0_4x4) {
-        *out_height = g_sub_mb_type_p_mb[mb_type - P_L0_8x8].SubMbPartHeight;
-    } else if (mb_type >= B_Direct_8x8 && mb_type <= B_Bi_4x4) {
-        *out_height = g_sub_mb_type_b_mb[mb_type - B_Direct_8x8].SubMbPartHeight;
-    } else {
+    const MB_TYPE_INFO* info = get_mb_type_info(mb_type);
+    if (!info->is_sub_mb_type) {
         return ERR_UNRECOGNIZED_MB;
     }
 
+    *out_height = info->MbPartHeight;
     return ERR_OK;
 }
 
 int SubMbPartWidthHeight(MB_TYPE_NAME mb_type, int32_t* out_width, int32_t* out_height) {
-    if (mb_type >= P_L0_8x8 && mb_type <= P_L0_4x4) {
-        *out_width = g_sub_mb_type_p_mb[mb_type - P_L0_8x8].SubMbPartWidth;
-        *out_height = g_sub_mb_type_p_mb[mb_type - P_L0_8x8].SubMbPartHeight;
-    } else if (mb_type >= B_Direct_8x8 && mb_type <= B_Bi_4x4) {
-        *out_width = g_sub_mb_type_b_mb[mb_type - B_Direct_8x8].SubMbPartWidth;
-        *out_height = g_sub_mb_type_b_mb[mb_type - B_Direct_8x8].SubMbPartHeight;
-    } else {
+    const MB_TYPE_INFO* info = get_mb_type_info(mb_type);
+    if (!info->is_sub_mb_type) {
         return ERR_UNRECOGNIZED_MB;
     }
 
+    *out_width = info->MbPartWidth;
+    *out_height = info->MbPartHeight;
     return ERR_OK;
 }
 
 int MbSubMbPartWidthHeight(MB_TYPE_NAME mb_type, int32_t* out_width, int32_t* out_height) {
-    if (mb_type >= P_L0_16x16 && mb_type <= P_Skip) {
-        *out_width = g_mb_type_for_p_sp_slices[mb_type - P_L0_16x16].MbPartWidth;
-        *out_height = g_mb_type_for_p_sp_slices[mb_type - P_L0_16x16].MbPartHeight;
-    } else if (mb_type >= B_Direct_16x16 && mb_type <= B_Skip) {
-        *out_width = g_mb_type_for_b_slices[mb_type - B_Direct_16x16].MbPartWidth;
-        *out_height = g_mb_type_for_b_slices[mb_type - B_Direct_16x16].MbPartHeight;
-    } else if (mb_type >= P_L0_8x8 && mb_type <= P_L0_4x4) {
-        *out_width = g_sub_mb_type_p_mb[mb_type - P_L0_8x8].SubMbPartWidth;
-        *out_height = g_sub_mb_type_p_mb[mb_type - P_L0_8x8].SubMbPartHeight;
-    } else if (mb_type >= B_Direct_8x8 && mb_type <= B_Bi_4x4) {
-        *out_width = g_sub_mb_type_b_mb[mb_type - B_Direct_8x8].SubMbPartWidth;
-        *out_height = g_sub_mb_type_b_mb[mb_type - B_Direct_8x8].SubMbPartHeight;
-    } else {
+    const MB_TYPE_INFO* info = get_mb_type_info(mb_type);
+    if (!info->MbPartWidth) {
         return ERR_UNRECOGNIZED_MB;
     }
 
+    *out_width = info->MbPartWidth;
+    *out_height = info->MbPartHeight;
     return ERR_OK;
 }
 
 int MbPartPredMode(int32_t slice_type, int32_t transform_size_8x8_flag, int32_t mb_type, int32_t index, MB_TYPE_NAME* out_mb_type_name, H264_MB_PART_PRED_MODE* out_mb_pred_mode) {
-    slice_type %= 5;
+    if (get_mb_type_name(slice_type, mb_type, out_mb_type_name) < 0) {
+        return ERR_UNKNOWN_MB_PART_PRED_MODE;
+    }
 
-    if (slice_type == SLICE_TYPE_I) {
-        if (mb_type == 0) {
-            if (transform_size_8x8_flag == 0) {
-                *out_mb_type_name = g_mb_type_for_i_slices[0].mb_type_name;
-                *out_mb_pred_mode = g_mb_type_for_i_slices[0].MbPartPredMode;
-            } else {
-                *out_mb_type_name = g_mb_type_for_i_slices[1].mb_type_name;
-                *out_mb_pred_mode = g_mb_type_for_i_slices[1].MbPartPredMode;
-            }
-        } else if (mb_type >= 1 && mb_type <= 25) {
-            *out_mb_type_name = g_mb_type_for_i_slices[mb_type + 1].mb_type_name;
-            *out_mb_pred_mode = g_mb_type_for_i_slices[mb_type + 1].MbPartPredMode;
-        } else {
-            return ERR_UNKNOWN_MB_PART_PRED_MODE;
-        }
-    } else if (slice_type == SLICE_TYPE_SI) {
-        if (mb_type == 0) {
-            *out_mb_type_name = g_mb_type_for_si_slices[0].mb_type_name;
-            *out_mb_pred_mode = g_mb_type_for_si_slices[0].MbPartPredMode;
-        } else {
-            return ERR_UNKNOWN_MB_PART_PRED_MODE;
-        }
-    } else if (slice_type == SLICE_TYPE_P || slice_type == SLICE_TYPE_SP) {
-        if (mb_type >= 0 && mb_type <= 5) {
-            *out_mb_type_name = g_mb_type_for_p_sp_slices[mb_type].mb_type_name;
-            if (index == 0) {
-                *out_mb_pred_mode = g_mb_type_for_p_sp_slices[mb_type].MbPartPredMode0;
-            } else {
-                *out_mb_pred_mode = g_mb_type_for_p_sp_slices[mb_type].MbPartPredMode1;
-            }
-        } else {
-            return ERR_UNKNOWN_MB_PART_PRED_MODE;
-        }
-    } else if (slice_type == SLICE_TYPE_B) {
-        if (mb_type >= 0 && mb_type <= 23) {
-            *out_mb_type_name = g_mb_type_for_b_slices[mb_type].mb_type_name;
-            if (index == 0) {
-                *out_mb_pred_mode = g_mb_type_for_b_slices[mb_type].MbPartPredMode0;
-            } else {
-                *out_mb_pred_mode = g_mb_type_for_b_slices[mb_type].MbPartPredMode1;
-            }
-        } else {
-            return ERR_UNKNOWN_MB_PART_PRED_MODE;
-        }
+    const MB_TYPE_INFO* info = get_mb_type_info(*out_mb_type_name);
+    *out_mb_pred_mode = (H264_MB_PART_PRED_MODE)(index == 0 ? info->MbPartPredMode0 : info->MbPartPredMode1);
+
+    /* the prediction mode of I_NxN is Intra_8x8 when transform_size_8x8_flag is equal to 1 */
+    if (*out_mb_type_name == I_NxN && transform_size_8x8_flag) {
+        *out_mb_pred_mode = Intra_8x8;
     }
 
     return ERR_OK;
 }
 
 void NumMbPart(int32_t slice_type, int32_t mb_type, int32_t* out_num) {
-    slice_type %= 5;
+    MB_TYPE_NAME mb_type_name;
 
     *out_num = 0;
 
-    if (slice_type == SLICE_TYPE_P || slice_type == SLICE_TYPE_SP) {
-        if (mb_type >= 0 && mb_type <= 5) {
-            *out_num = g_mb_type_for_p_sp_slices[mb_type].NumMbPart;
-        }
-    } else if (slice_type == SLICE_TYPE_B) {
-        if (mb_type >= 0 && mb_type <= 23) {
-            *out_num = g_mb_type_for_b_slices[mb_type].NumMbPart;
-        }
+    if (get_mb_type_name(slice_type, mb_type, &mb_type_name) < 0) {
+        return;
+    }
+
+    /* NumMbPart is not defined for the macroblock types of I and SI slices */
+    if (get_mb_type_info(mb_type_name)->MbPartWidth) {
+        *out_num = get_mb_type_info(mb_type_name)->NumMbPart;
     }
 }
 
 void CodedBlockPatternLumaChroma(int32_t slice_type, int32_t mb_type, int32_t* out_luma, int32_t* out_chroma) {
-    slice_type %= 5;
+    MB_TYPE_NAME mb_type_name;
 
     *out_luma = 0;
     *out_chroma = 0;
 
-    if (slice_type == SLICE_TYPE_I) {
-        if (mb_type >= 1 && mb_type <= 24) {
-            *out_chroma = g_mb_type_for_i_slices[mb_type + 1].CodedBlockPatternChroma;
-            *out_luma = g_mb_type_for_i_slices[mb_type + 1].CodedBlockPatternLuma;
-        }
+    if (get_mb_type_name(slice_type, mb_type, &mb_type_name) < 0) {
+        return;
     }
+
+    *out_luma = get_mb_type_info(mb_type_name)->CodedBlockPatternLuma;
+    *out_chroma = get_mb_type_info(mb_type_name)->CodedBlockPatternChroma;
 }
 
 /* 7.3.5 Macroblock layer syntax */
@@ -335,119 +281,203 @@ int macroblock_layer(RBSPReader* rbsp_reader, FrameOrField* picture, SliceHeader
         return err_code;
     }
 
-    MacroBlock* mb = &picture->mb_list[picture->current_mb++];
+    MacroBlock* mb = &picture->mb_list[CurrMbAddr];
+    MacroBlockScratch* scratch = picture->mb_scratch;
+    mb->mb_type = mb_type;
+    picture->mb_skip_flags[CurrMbAddr] = 0;
+    picture->mb_qps[CurrMbAddr] = (int8_t)picture->QPY_pred;
+    mb->transform_size_8x8_flag = 0;
+    mb->coded_block_pattern = 0;
+    mb->mb_qp_delta = 0;
+    mb->constrained_intra_pred_flag = pps->constrained_intra_pred_flag;
+
+    /* the non-zero block masks and the TotalCoeff( coeff_token ) are written by the residual parsing only */
+    mb->coded_block_flags = 0;
+    mb->coded_block_flags_444 = 0;
+    mb->coded_block_flags_dc = 0;
+    memset(mb->total_coeff, 0, sizeof(mb->total_coeff));
+
+    if (slice_type == SLICE_TYPE_I && mb_type == 25) { /* I_PCM */
+        picture->mb_type_names[CurrMbAddr] = I_PCM;
+        mb->mb_pred_type = Intra_NA;
+        mb->CodedBlockPatternLuma = 0;
+        mb->CodedBlockPatternChroma = 0;
+
+        /* 9.2.1: nN is set equal to 16 for I_PCM, 9.3.3.1.1.9: condTermFlagN is set equal to 1 for I_PCM, 8.7.2.1: I_PCM is intra coded */
+        mb->coded_block_flags = 0xFFFFFFFFu;
+        mb->coded_block_flags_444 = 0xFFFFFFFFu;
+        mb->coded_block_flags_dc = H264_CBF_DC_LUMA | H264_CBF_DC_CB | H264_CBF_DC_CR;
+        memset(mb->total_coeff, 0xFF, sizeof(mb->total_coeff));
 
-    if (mb_type == 25) { /* I_PCM */
         while (!is_byte_aligned(rbsp_reader)) {
             /* uint32_t pcm_alignment_zero_bit; */
             (void)read_u(rbsp_reader, 1);
         }
 
         for (int i = 0; i < 256; ++i) {
-            mb->pcm_sample_luma[i] = read_u(rbsp_reader, sps->BitDepthY);
+            scratch->pcm_sample_luma[i] = read_u(rbsp_reader, sps->BitDepthY);
         }
 
         for (int i = 0; i < 2 * sps->MbHeightC * sps->MbWidthC; ++i) {
-            mb->pcm_sample_chroma[i] = read_u(rbsp_reader, sps->BitDepthC);
+            scratch->pcm_sample_chroma[i] = read_u(rbsp_reader, sps->BitDepthC);
         }
-    } else {
-        int noSubMbPartSizeLessThan8x8Flag = 1;
 
-        MB_TYPE_NAME mb_type_name;
-        H264_MB_PART_PRED_MODE mb_part_pred_mode;
-        err_code = MbPartPredMode(slice_type, 0, mb_type, 0, &mb_type_name, &mb_part_pred_mode);
-        if (err_code < 0) {
-            return err_code;
+        /* 9.3.1.2: the decoding engine is initialized after the pcm samples */
+        if (is_entropy_coding) {
+            err_code = cabac_init_arithmetic_decoding_engine(rbsp_reader, cabac);
+            if (err_code < 0) {
+                return err_code;
+            }
         }
 
-        CodedBlockPatternLumaChroma(slice_type, mb_type, &CodedBlockPatternLuma, &CodedBlockPatternChroma);
+        return derivation_for_motion_vectors(picture, slice_header, CurrMbAddr);
+    }
 
-        int32_t num_mb_part = 0;
-        NumMbPart(slice_type, mb_type, &num_mb_part);
+    int noSubMbPartSizeLessThan8x8Flag = 1;
 
-        if (mb_type != 0 /*I_NxN*/ && mb_part_pred_mode != Intra_16x16 && num_mb_part == 4) {
-            return ERR_NOT_IMPL;
-        } else {
-            if (pps->transform_8x8_mode_flag && mb_type == 0 /*I_NxN*/) {
-                int32_t transform_size_8x8_flag = 0;
-                if (is_entropy_coding) {
-                    err_code = cabac_transform_size_8x8_flag(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, &transform_size_8x8_flag);
-                    if (err_code < 0) {
-                        return err_code;
-                    }
-                } else {
-                    transform_size_8x8_flag = (int32_t)read_u(rbsp_reader, 1);
-                }
+    MB_TYPE_NAME mb_type_name;
+    err_code = get_mb_type_name(slice_type, mb_type, &mb_type_name);
+    if (err_code < 0) {
+        return ERR_UNKNOWN_MB_PART_PRED_MODE;
+    }
 
-                mb->transform_size_8x8_flag = transform_size_8x8_flag;
+    const MB_TYPE_INFO* mb_type_info = get_mb_type_info(mb_type_name);
+    H264_MB_PART_PRED_MODE mb_part_pred_mode = (H264_MB_PART_PRED_MODE)mb_type_info->MbPartPredMode0;
+    CodedBlockPatternLuma = mb_type_info->CodedBlockPatternLuma;
+    CodedBlockPatternChroma = mb_type_info->CodedBlockPatternChroma;
+    int32_t num_mb_part = mb_type_info->MbPartWidth ? mb_type_info->NumMbPart : 0;
 
-                err_code = MbPartPredMode(slice_type, transform_size_8x8_flag, mb_type, 0, &mb_type_name, &mb_part_pred_mode);
-                if (err_code < 0) {
-                    return err_code;
-                }
-            }
+    if (mb_type_name != I_NxN && mb_part_pred_mode != Intra_16x16 && num_mb_part == 4) {
+        picture->mb_type_names[CurrMbAddr] = mb_type_name;
+        mb->mb_pred_type = mb_part_pred_mode;
 
-            /* TODO mb_pred(); */
+        init_mv_cache(picture, slice_header, CurrMbAddr);
+        err_code = sub_mb_pred(rbsp_reader, picture, mb, slice_header, cabac, CurrMbAddr);
+        if (err_code < 0) {
+            return err_code;
         }
 
-        if (mb_part_pred_mode != Intra_16x16) {
-            int32_t coded_block_pattern = 0;
-
+        for (int mbPartIdx = 0; mbPartIdx < 4; mbPartIdx++) {
+            const MB_TYPE_INFO* sub_info = get_mb_type_info((MB_TYPE_NAME)mb->sub_mb_type_name[mbPartIdx]);
+            if (mb->sub_mb_type_name[mbPartIdx] != B_Direct_8x8) {
+                if (sub_info->NumMbPart > 1) {
+                    noSubMbPartSizeLessThan8x8Flag = 0;
+                }
+            } else if (!sps->direct_8x8_inference_flag) {
+                noSubMbPartSizeLessThan8x8Flag = 0;
+            }
+        }
+    } else {
+        if (pps->transform_8x8_mode_flag && mb_type_name == I_NxN) {
+            int32_t transform_size_8x8_flag = 0;
             if (is_entropy_coding) {
-                err_code = cabac_coded_block_pattern(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, sps->ChromaArrayType, &coded_block_pattern);
+                err_code = cabac_transform_size_8x8_flag(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, &transform_size_8x8_flag);
                 if (err_code < 0) {
                     return err_code;
                 }
             } else {
-                coded_block_pattern = read_me(rbsp_reader, sps->ChromaArrayType, mb_part_pred_mode);
-                if (coded_block_pattern != -1) {
-                    mb->coded_block_pattern = coded_block_pattern;
-                } else {
-                    return ERR_INVALID_CODED_BLOCK_PATTERN;
-                }
+                transform_size_8x8_flag = (int32_t)read_u(rbsp_reader, 1);
+            }
+
+            mb->transform_size_8x8_flag = transform_size_8x8_flag;
+
+            /* the prediction mode of I_NxN is Intra_8x8 when transform_size_8x8_flag is equal to 1 */
+            if (transform_size_8x8_flag) {
+                mb_part_pred_mode = Intra_8x8;
             }
+        }
 
-            CodedBlockPatternLuma = coded_block_pattern % 16;
-            CodedBlockPatternChroma = coded_block_pattern / 16;
+        picture->mb_type_names[CurrMbAddr] = mb_type_name;
+        mb->mb_pred_type = mb_part_pred_mode;
 
-            if (CodedBlockPatternLuma > 0 && pps->transform_8x8_mode_flag && mb_type != 0 /*I_NxN*/ && noSubMbPartSizeLessThan8x8Flag &&
-                (mb_type_name != B_Direct_16x16 || sps->direct_8x8_inference_flag)) {
-                int32_t transform_size_8x8_flag = 0;
+        if (!mb_is_intra(mb)) {
+            init_mv_cache(picture, slice_header, CurrMbAddr);
+        }
 
-                if (is_entropy_coding) {
-                    err_code = cabac_transform_size_8x8_flag(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, &transform_size_8x8_flag);
-                    if (err_code < 0) {
-                        return err_code;
-                    }
-                } else {
-                    transform_size_8x8_flag = (int32_t)read_u(rbsp_reader, 1);
-                }
+        err_code = mb_pred(rbsp_reader, picture, mb, slice_header, cabac, CurrMbAddr, num_mb_part);
+        if (err_code < 0) {
+            return err_code;
+        }
 
-                err_code = MbPartPredMode(slice_type, transform_size_8x8_flag, mb_type, 0, &mb_type_name, &mb_part_pred_mode);
-                if (err_code < 0) {
-                    return err_code;
-                }
+        if (mb_part_pred_mode == Intra_4x4 || mb_part_pred_mode == Intra_8x8) {
+            err_code = derivation_for_intra_nxn_pred_modes(picture, slice_header, CurrMbAddr);
+            if (err_code < 0) {
+                return err_code;
+            }
+        }
+    }
+
+    err_code = derivation_for_motion_vectors(picture, slice_header, CurrMbAddr);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    if (mb_part_pred_mode != Intra_16x16) {
+        int32_t coded_block_pattern = 0;
+
+        if (is_entropy_coding) {
+            err_code = cabac_coded_block_pattern(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, sps->ChromaArrayType, &coded_block_pattern);
+            if (err_code < 0) {
+                return err_code;
+            }
+        } else {
+            coded_block_pattern = read_me(rbsp_reader, sps->ChromaArrayType, mb_part_pred_mode);
+            if (coded_block_pattern == -1) {
+                return ERR_INVALID_CODED_BLOCK_PATTERN;
             }
         }
 
-        if (CodedBlockPatternLuma > 0 || CodedBlockPatternChroma > 0 || mb_part_pred_mode == Intra_16x16) {
-            int32_t mb_qp_delta;
+        mb->coded_block_pattern = coded_block_pattern;
+
+        CodedBlockPatternLuma = coded_block_pattern % 16;
+        CodedBlockPatternChroma = coded_block_pattern / 16;
+
+        if (CodedBlockPatternLuma > 0 && pps->transform_8x8_mode_flag && mb_type_name != I_NxN && noSubMbPartSizeLessThan8x8Flag &&
+            (mb_type_name != B_Direct_16x16 || sps->direct_8x8_inference_flag)) {
+            int32_t transform_size_8x8_flag = 0;
+
             if (is_entropy_coding) {
-                err_code = cabac_mb_qp_delta(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, &mb_qp_delta);
+                err_code = cabac_transform_size_8x8_flag(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, &transform_size_8x8_flag);
                 if (err_code < 0) {
                     return err_code;
                 }
             } else {
-                mb_qp_delta = (int32_t)read_se(rbsp_reader);
+                transform_size_8x8_flag = (int32_t)read_u(rbsp_reader, 1);
             }
 
-            mb->mb_qp_delta = mb_qp_delta;
+            mb->transform_size_8x8_flag = transform_size_8x8_flag;
+        }
+    }
+
+    mb->CodedBlockPatternLuma = CodedBlockPatternLuma;
+    mb->CodedBlockPatternChroma = CodedBlockPatternChroma;
 
-            /* residual( 0, 15 ); */
+    if (CodedBlockPatternLuma > 0 || CodedBlockPatternChroma > 0 || mb_part_pred_mode == Intra_16x16) {
+        int32_t mb_qp_delta;
+        if (is_entropy_coding) {
+            err_code = cabac_mb_qp_delta(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, &mb_qp_delta);
+            if (err_code < 0) {
+                return err_code;
+            }
+        } else {
+            mb_qp_delta = (int32_t)read_se(rbsp_reader);
         }
 
-        return ERR_OK;
+        mb->mb_qp_delta = mb_qp_delta;
+
+        /* 7.4.5 Macroblock layer semantics: QPY = ( ( QPY,PRED + mb_qp_delta + 52 + 2 * QpBdOffsetY ) % ( 52 + QpBdOffsetY ) ) − QpBdOffsetY */
+        int32_t QpBdOffsetY = (int32_t)sps->QpBdOffsetY;
+        int32_t QPY = ((picture->QPY_pred + mb_qp_delta + 52 + 2 * QpBdOffsetY) % (52 + QpBdOffsetY)) - QpBdOffsetY;
+        picture->QPY_pred = QPY;
+        picture->mb_qps[CurrMbAddr] = (int8_t)QPY;
+
+        err_code = residual(rbsp_reader, picture, mb, slice_header, cabac, CurrMbAddr, 0, 15);
+        if (err_code < 0) {
+            return err_code;
+        }
     }
+
+    return scaling_for_residual(picture, slice_header, CurrMbAddr);
 }
 
 int revise_slice_type_mb_type(int32_t slice_type, int32_t mb_type, int32_t* revised_slice_type, int32_t* revised_mb_type) {
@@ -505,13 +535,97 @@ int revise_slice_type_mb_type(int32_t slice_type, int32_t mb_type, int32_t* revi
     return ERR_OK;
 }
 
+/**
+ * @brief check whether the partition with the prediction mode is predicted from the list
+ */
+static inline int32_t mb_part_uses_list(int32_t pred_mode, int32_t list) { return pred_mode == BiPred || pred_mode == (list ? Pred_L1 : Pred_L0); }
+
+/**
+ * @brief write the parsed reference index of a partition into the motion data cache for the ctxIdxInc derivation of the later partitions
+ */
+static void set_cache_ref(MvCache* cache, int32_t list, int32_t x4, int32_t y4, int32_t w4, int32_t h4, int32_t ref_idx) {
+    for (int32_t y = y4; y < y4 + h4; ++y) {
+        memset(&cache->ref[list][MV_CACHE_IDX(x4, y)], ref_idx, w4);
+    }
+}
+
+/**
+ * @brief parse ref_idx_l0 or ref_idx_l1 of a partition, it is inferred to be 0 if only one reference picture can be referred
+ * @see 7.3.5.1 Macroblock prediction syntax
+ * @see 7.4.5.1 Macroblock prediction semantics
+ */
+static int parse_ref_idx(RBSPReader* rbsp_reader, FrameOrField* picture, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t list, int32_t x4, int32_t y4,
+                         int32_t* out_ref_idx) {
+    int err_code = ERR_OK;
+
+    int32_t mb_field_decoding_flag = bitset_get(picture->mb_field_flags, CurrMbAddr);
+    int32_t num_ref_idx_active_minus1 = (int32_t)(list ? slice_header->num_ref_idx_l1_active_minus1 : slice_header->num_ref_idx_l0_active_minus1);
+
+    if (num_ref_idx_active_minus1 == 0 && mb_field_decoding_flag == slice_header->field_pic_flag) {
+        *out_ref_idx = 0;
+        return ERR_OK;
+    }
+
+    /* the range is 0 to 2 * num_ref_idx_lX_active_minus1 + 1 for the field macroblocks of MBAFF frames */
+    int32_t range = (slice_header->MbaffFrameFlag && mb_field_decoding_flag) ? 2 * num_ref_idx_active_minus1 + 1 : num_ref_idx_active_minus1;
+    int32_t ref_idx;
+
+    if (slice_header->pps->entropy_coding_mode_flag) {
+        err_code = cabac_ref_idx(rbsp_reader, cabac, picture, list, x4, y4, &ref_idx);
+        if (err_code < 0) {
+            return err_code;
+        }
+    } else {
+        ref_idx = (int32_t)read_te(rbsp_reader, range);
+    }
+
+    if (ref_idx < 0 || ref_idx > range) {
+        return ERR_INVALID_REF_IDX;
+    }
+
+    *out_ref_idx = ref_idx;
+    return ERR_OK;
+}
+
+/**
+ * @brief parse mvd_l0 or mvd_l1 of a partition, the absolute values are written into the motion data cache for the ctxIdxInc derivation of the later partitions
+ * @see 7.3.5.1 Macroblock prediction syntax
+ * @see 7.4.5.1 Macroblock prediction semantics
+ */
+static int parse_mvd(RBSPReader* rbsp_reader, FrameOrField* picture, SliceHeader* slice_header, CABAC* cabac, int32_t list, int32_t x4, int32_t y4, int32_t w4, int32_t h4,
+                     int32_t mvd[2]) {
+    int err_code = ERR_OK;
+    MvCache* cache = &picture->mb_scratch->mv_cache;
+
+    for (int32_t compIdx = 0; compIdx < 2; ++compIdx) {
+        if (slice_header->pps->entropy_coding_mode_flag) {
+            err_code = cabac_mvd(rbsp_reader, cabac, picture, list, compIdx, x4, y4, &mvd[compIdx]);
+            if (err_code < 0) {
+                return err_code;
+            }
+        } else {
+            mvd[compIdx] = read_se(rbsp_reader);
+        }
+    }
+
+    uint8_t abs_mvd[2] = {(uint8_t)codec_min(abs(mvd[0]), 255), (uint8_t)codec_min(abs(mvd[1]), 255)};
+    for (int32_t y = y4; y < y4 + h4; ++y) {
+        for (int32_t x = x4; x < x4 + w4; ++x) {
+            cache->mvd[list][MV_CACHE_IDX(x, y)][0] = abs_mvd[0];
+            cache->mvd[list][MV_CACHE_IDX(x, y)][1] = abs_mvd[1];
+        }
+    }
+
+    return ERR_OK;
+}
+
 int mb_pred(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t NumMbPart) {
     int err_code = ERR_OK;
 
     PPS* pps = slice_header->pps;
     SPS* sps = slice_header->sps;
-    int32_t slice_type = (int32_t)slice_header->slice_type;
 
+    MacroBlockScratch* scratch = picture->mb_scratch;
     H264_MB_PART_PRED_MODE pred_type = mb->mb_pred_type;
     uint8_t is_entropy_coding = pps->entropy_coding_mode_flag;
 
@@ -528,7 +642,7 @@ int mb_pred(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, Slic
                     prev_intra4x4_pred_mode_flag = (int32_t)read_u(rbsp_reader, 1);
                 }
 
-                mb->prev_intra4x4_pred_mode_flag[luma4x4BlkIdx] = prev_intra4x4_pred_mode_flag;
+                scratch->prev_intra4x4_pred_mode_flag[luma4x4BlkIdx] = prev_intra4x4_pred_mode_flag;
 
                 if (!prev_intra4x4_pred_mode_flag) {
                     int32_t rem_pred_mode;
@@ -541,7 +655,7 @@ int mb_pred(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, Slic
                         rem_pred_mode = (int32_t)read_u(rbsp_reader, 3);
                     }
 
-                    mb->rem_intra4x4_pred_mode[luma4x4BlkIdx] = rem_pred_mode;
+                    scratch->rem_intra4x4_pred_mode[luma4x4BlkIdx] = rem_pred_mode;
                 }
             }
         }
@@ -558,7 +672,7 @@ int mb_pred(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, Slic
                     prev_intra8x8_pred_mode_flag = (int32_t)read_u(rbsp_reader, 1);
                 }
 
-                mb->prev_intra8x8_pred_mode_flag[luma8x8BlkIdx] = prev_intra8x8_pred_mode_flag;
+                scratch->prev_intra8x8_pred_mode_flag[luma8x8BlkIdx] = prev_intra8x8_pred_mode_flag;
 
                 if (!prev_intra8x8_pred_mode_flag) {
                     int32_t rem_pred_mode;
@@ -571,7 +685,7 @@ int mb_pred(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, Slic
                         rem_pred_mode = (int32_t)read_u(rbsp_reader, 3);
                     }
 
-                    mb->rem_intra8x8_pred_mode[luma8x8BlkIdx] = rem_pred_mode;
+                    scratch->rem_intra8x8_pred_mode[luma8x8BlkIdx] = rem_pred_mode;
                 }
             }
         }
@@ -586,53 +700,472 @@ int mb_pred(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, Slic
 
             mb->intra_chroma_pred_mode = intra_chroma_pred_mode;
         }
-    } else if (pred_type == Direct) {
-        for (int mbPartIdx = 0; mbPartIdx < NumMbPart; mbPartIdx++) {
+    } else if (pred_type != Direct) {
+        /* B_Direct_16x16 has no prediction syntax, its motion data is derived by the direct prediction */
+        const MB_TYPE_INFO* info = get_mb_type_info((MB_TYPE_NAME)picture->mb_type_names[CurrMbAddr]);
+        MvCache* cache = &scratch->mv_cache;
+        int32_t w4 = info->MbPartWidth / 4;
+        int32_t h4 = info->MbPartHeight / 4;
+
+        for (int list = 0; list < 2; list++) {
+            for (int mbPartIdx = 0; mbPartIdx < NumMbPart; mbPartIdx++) {
+                int32_t x4 = info->part_x[mbPartIdx] / 4;
+                int32_t y4 = info->part_y[mbPartIdx] / 4;
+                int32_t ref_idx = -1;
+
+                if (mb_part_uses_list(mbPartIdx ? info->MbPartPredMode1 : info->MbPartPredMode0, list)) {
+                    err_code = parse_ref_idx(rbsp_reader, picture, slice_header, cabac, CurrMbAddr, list, x4, y4, &ref_idx);
+                    if (err_code < 0) {
+                        return err_code;
+                    }
+                }
+
+                scratch->ref_idx[list][mbPartIdx] = ref_idx;
+                set_cache_ref(cache, list, x4, y4, w4, h4, ref_idx);
+            }
+        }
+
+        for (int list = 0; list < 2; list++) {
+            for (int mbPartIdx = 0; mbPartIdx < NumMbPart; mbPartIdx++) {
+                if (mb_part_uses_list(mbPartIdx ? info->MbPartPredMode1 : info->MbPartPredMode0, list)) {
+                    err_code = parse_mvd(rbsp_reader, picture, slice_header, cabac, list, info->part_x[mbPartIdx] / 4, info->part_y[mbPartIdx] / 4, w4, h4,
+                                         scratch->mvd[list][mbPartIdx][0]);
+                    if (err_code < 0) {
+                        return err_code;
+                    }
+                }
+            }
         }
+    }
+
+    return ERR_OK;
+}
 
-        for (int mbPartIdx = 0; mbPartIdx < NumMbPart; mbPartIdx++) {
+int sub_mb_pred(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr) {
+    int err_code = ERR_OK;
+
+    MacroBlockScratch* scratch = picture->mb_scratch;
+    MvCache* cache = &scratch->mv_cache;
+    int32_t slice_type = (int32_t)(slice_header->slice_type % 5);
+    int32_t is_slice_type_b = slice_type == SLICE_TYPE_B;
+    MB_TYPE_NAME mb_type_name = (MB_TYPE_NAME)picture->mb_type_names[CurrMbAddr];
+
+    for (int mbPartIdx = 0; mbPartIdx < 4; mbPartIdx++) {
+        int32_t sub_mb_type;
+        if (slice_header->pps->entropy_coding_mode_flag) {
+            err_code = cabac_sub_mb_type(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, &sub_mb_type);
+            if (err_code < 0) {
+                return err_code;
+            }
+        } else {
+            sub_mb_type = (int32_t)read_ue(rbsp_reader);
         }
 
-        for (int mbPartIdx = 0; mbPartIdx < NumMbPart; mbPartIdx++) {
+        /* Table 7-17 and Table 7-18 */
+        if (sub_mb_type < 0 || sub_mb_type > (is_slice_type_b ? 12 : 3)) {
+            return ERR_UNRECOGNIZED_MB;
         }
 
-        for (int mbPartIdx = 0; mbPartIdx < NumMbPart; mbPartIdx++) {
+        mb->sub_mb_type_name[mbPartIdx] = (uint8_t)((is_slice_type_b ? B_Direct_8x8 : P_L0_8x8) + sub_mb_type);
+
+        /* the direct sub-macroblocks make condTermFlagN of ref_idx 0 for the later partitions */
+        int32_t is_direct = mb->sub_mb_type_name[mbPartIdx] == B_Direct_8x8;
+        for (int y4 = 0; y4 < 2; y4++) {
+            for (int x4 = 0; x4 < 2; x4++) {
+                cache->direct[MV_CACHE_IDX((mbPartIdx & 1) * 2 + x4, (mbPartIdx >> 1) * 2 + y4)] = (uint8_t)is_direct;
+            }
+        }
+    }
+
+    for (int list = 0; list < 2; list++) {
+        for (int mbPartIdx = 0; mbPartIdx < 4; mbPartIdx++) {
+            MB_TYPE_NAME sub_mb_type_name = (MB_TYPE_NAME)mb->sub_mb_type_name[mbPartIdx];
+            int32_t x4 = (mbPartIdx & 1) * 2;
+            int32_t y4 = (mbPartIdx >> 1) * 2;
+            int32_t ref_idx = -1;
+
+            if (sub_mb_type_name != B_Direct_8x8 && mb_part_uses_list(get_mb_type_info(sub_mb_type_name)->MbPartPredMode0, list)) {
+                /* ref_idx_l0 is inferred to be 0 for P_8x8ref0 */
+                ref_idx = 0;
+                if (mb_type_name != P_8x8ref0) {
+                    err_code = parse_ref_idx(rbsp_reader, picture, slice_header, cabac, CurrMbAddr, list, x4, y4, &ref_idx);
+                    if (err_code < 0) {
+                        return err_code;
+                    }
+                }
+            }
+
+            scratch->ref_idx[list][mbPartIdx] = ref_idx;
+            set_cache_ref(cache, list, x4, y4, 2, 2, ref_idx);
         }
+    }
 
-        return ERR_NOT_IMPL;
+    for (int list = 0; list < 2; list++) {
+        for (int mbPartIdx = 0; mbPartIdx < 4; mbPartIdx++) {
+            MB_TYPE_NAME sub_mb_type_name = (MB_TYPE_NAME)mb->sub_mb_type_name[mbPartIdx];
+            const MB_TYPE_INFO* sub_info = get_mb_type_info(sub_mb_type_name);
+
+            if (sub_mb_type_name == B_Direct_8x8 || !mb_part_uses_list(sub_info->MbPartPredMode0, list)) {
+                continue;
+            }
+
+            for (int subMbPartIdx = 0; subMbPartIdx < sub_info->NumMbPart; subMbPartIdx++) {
+                int32_t x4 = (mbPartIdx & 1) * 2 + sub_info->part_x[subMbPartIdx] / 4;
+                int32_t y4 = (mbPartIdx >> 1) * 2 + sub_info->part_y[subMbPartIdx] / 4;
+                err_code = parse_mvd(rbsp_reader, picture, slice_header, cabac, list, x4, y4, sub_info->MbPartWidth / 4, sub_info->MbPartHeight / 4,
+                                     scratch->mvd[list][mbPartIdx][subMbPartIdx]);
+                if (err_code < 0) {
+                    return err_code;
+                }
+            }
+        }
     }
 
     return ERR_OK;
 }
 
+/**
+ * @brief store TotalCoeff( coeff_token ) of the 4x4 block, the 4 bits of the block are 0 before
+ *
+ * @param mb the macroblock
+ * @param iComp the colour component, 0 for luma, 1 for Cb, 2 for Cr
+ * @param blkIdx the 4x4 block index
+ * @param TotalCoeff the TotalCoeff( coeff_token )
+ */
+static inline void set_mb_total_coeff(MacroBlock* mb, int32_t iComp, int32_t blkIdx, int32_t TotalCoeff) {
+    mb->total_coeff[iComp] |= (uint64_t)codec_min(TotalCoeff, 15) << (blkIdx * 4);
+}
+
+/**
+ * @brief derive nC of the luma, Cb or Cr 4x4 block from TotalCoeff( coeff_token ) of the neighbouring blocks
+ * @see 9.2.1 Parsing process for total number of non-zero transform coefficient levels and number of trailing ones
+ *
+ * @param picture pointer to the FrameOrField
+ * @param slice_header pointer to the slice header
+ * @param CurrMbAddr the current macroblock address
+ * @param iComp the colour component, 0 for luma, 1 for Cb, 2 for Cr
+ * @param blkIdx luma4x4BlkIdx, cb4x4BlkIdx or cr4x4BlkIdx for luma and ChromaArrayType equal to 3, otherwise chroma4x4BlkIdx
+ * @return int32_t nC
+ */
+static int32_t derivation_for_nC(FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t iComp, int32_t blkIdx) {
+    SPS* sps = slice_header->sps;
+    MacroBlock* mb_list = picture->mb_list;
+    MacroBlock* curr_mb = &mb_list[CurrMbAddr];
+
+    int32_t mbAddrA = -1;
+    int32_t mbAddrB = -1;
+    int32_t blkA = 0;
+    int32_t blkB = 0;
+
+    if (iComp == 0 || sps->ChromaArrayType == 3) {
+        /* 6.4.11.4 Derivation process for neighbouring 4x4 luma blocks */
+        neighbouring_4x4_luma_block(slice_header->MbaffFrameFlag, CurrMbAddr, !bitset_get(picture->mb_field_flags, CurrMbAddr), sps->PicWidthInMbs, picture->mb_slice_ids,
+                                    picture->mb_field_flags, blkIdx, &mbAddrA, &blkA, &mbAddrB, &blkB);
+    } else {
+        /* 6.4.11.5 Derivation process for neighbouring 4x4 chroma blocks */
+        neighbouring_4x4_chroma_block_ChromaArrayType_12(slice_header->MbaffFrameFlag, CurrMbAddr, !bitset_get(picture->mb_field_flags, CurrMbAddr), sps->PicWidthInMbs, sps->MbWidthC,
+                                                         sps->MbHeightC, picture->mb_slice_ids, picture->mb_field_flags, blkIdx, &mbAddrA, &blkA, &mbAddrB, &blkB);
+    }
+
+    /* the current macroblock is coded using an Intra prediction mode, constrained_intra_pred_flag is equal to 1, mbAddrN is coded using an Inter prediction mode, and
+     * slice data partitioning is in use (nal_unit_type is in the range of 2 through 4, inclusive): availableFlagN is set equal to 0 */
+    int32_t check_partitioning = slice_header->pps->constrained_intra_pred_flag && mb_is_intra(curr_mb) && slice_header->nalu_header.nal_unit_type >= 2 &&
+                                 slice_header->nalu_header.nal_unit_type <= 4;
+    if (check_partitioning && mbAddrA >= 0 && !mb_is_intra(&mb_list[mbAddrA])) {
+        mbAddrA = -1;
+    }
+    if (check_partitioning && mbAddrB >= 0 && !mb_is_intra(&mb_list[mbAddrB])) {
+        mbAddrB = -1;
+    }
+
+    /* total_coeff holds 0 for P_Skip, B_Skip and the blocks without coded residual, and 16 (saturated) for I_PCM, so nN is read directly */
+    if (mbAddrA >= 0 && mbAddrB >= 0) {
+        return (mb_total_coeff(&mb_list[mbAddrA], iComp, blkA) + mb_total_coeff(&mb_list[mbAddrB], iComp, blkB) + 1) >> 1;
+    } else if (mbAddrA >= 0) {
+        return mb_total_coeff(&mb_list[mbAddrA], iComp, blkA);
+    } else if (mbAddrB >= 0) {
+        return mb_total_coeff(&mb_list[mbAddrB], iComp, blkB);
+    }
+
+    return 0;
+}
+
+/* the ctxBlockCat of Table 9-42 of the residual_luma( ) blocks, indexed by the colour component and the DC, AC, 4x4 and 8x8 levels */
+static const int32_t g_residual_luma_ctxBlockCat[3][4] = {{0, 1, 2, 5}, {6, 7, 8, 9}, {10, 11, 12, 13}};
+
+/**
+ * @brief parse one residual block with CAVLC or CABAC
+ * @see 7.3.5.3 Residual data syntax
+ *
+ * @param rbsp_reader the RBSPReader
+ * @param picture pointer to the FrameOrField
+ * @param slice_header pointer to the slice header
+ * @param cabac pointer to the CABAC
+ * @param CurrMbAddr the current macroblock address
+ * @param ctxBlockCat the block category of Table 9-42, it selects nC of clause 9.2.1 for CAVLC
+ * @param blkIdx the index of the 4x4 or 8x8 block, 0 for the DC blocks
+ * @param iCbCr the chroma component of ctxBlockCat 3 and 4, -1 otherwise
+ * @param coeffLevel output parameter. the coefficient levels
+ * @param startIdx the start index
+ * @param endIdx the end index
+ * @param maxNumCoeff the max number of coeff
+ * @param out_TotalCoeff output parameter. the number of non-zero coefficient levels
+ * @return int 0 on success, negative value on error
+ */
+static int residual_block(RBSPReader* rbsp_reader, FrameOrField* picture, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t ctxBlockCat, int32_t blkIdx,
+                          int32_t iCbCr, int32_t* coeffLevel, int32_t startIdx, int32_t endIdx, int32_t maxNumCoeff, int32_t* out_TotalCoeff) {
+    if (slice_header->pps->entropy_coding_mode_flag) {
+        return residual_block_cabac(rbsp_reader, picture, slice_header, cabac, CurrMbAddr, ctxBlockCat, blkIdx, iCbCr, coeffLevel, startIdx, endIdx, maxNumCoeff,
+                                    out_TotalCoeff);
+    }
+
+    int32_t nC = 0;
+    if (ctxBlockCat == 3) {
+        nC = -maxNumCoeff / 4; /* -NumC8x8 */
+    } else if (ctxBlockCat == 4) {
+        nC = derivation_for_nC(picture, slice_header, CurrMbAddr, 1 + iCbCr, blkIdx);
+    } else {
+        nC = derivation_for_nC(picture, slice_header, CurrMbAddr, ctxBlockCat < 6 ? 0 : (ctxBlockCat < 10 ? 1 : 2), blkIdx);
+    }
+
+    return residual_block_cavlc(rbsp_reader, nC, coeffLevel, startIdx, endIdx, maxNumCoeff, out_TotalCoeff);
+}
+
 int residual(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t startIdx, int32_t endIdx) {
     int err_code = ERR_OK;
 
-    uint8_t is_entropy_coding = slice_header->pps->entropy_coding_mode_flag;
+    SPS* sps = slice_header->sps;
+    MacroBlockScratch* scratch = picture->mb_scratch;
+
+    err_code = residual_luma(rbsp_reader, picture, mb, slice_header, cabac, CurrMbAddr, 0, startIdx, endIdx);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    if (sps->ChromaArrayType == 1 || sps->ChromaArrayType == 2) {
+        int32_t NumC8x8 = 4 / (sps->SubWidthC * sps->SubHeightC);
+        int32_t TotalCoeff = 0;
+
+        for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+            if ((mb->CodedBlockPatternChroma & 3) && startIdx == 0) { /* chroma DC residual present */
+                err_code = residual_block(rbsp_reader, picture, slice_header, cabac, CurrMbAddr, 3, 0, iCbCr, scratch->ChromaDCLevel[iCbCr], 0, 4 * NumC8x8 - 1,
+                                          4 * NumC8x8, &TotalCoeff);
+                if (err_code < 0) {
+                    return err_code;
+                }
+
+                if (TotalCoeff) {
+                    mb->coded_block_flags_dc |= H264_CBF_DC_CB << iCbCr;
+                }
+            } else {
+                memset(scratch->ChromaDCLevel[iCbCr], 0, sizeof(scratch->ChromaDCLevel[iCbCr]));
+            }
+        }
+
+        for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+            int32_t shift = iCbCr ? H264_CBF_CR_SHIFT : H264_CBF_CB_SHIFT;
+
+            for (int32_t i8x8 = 0; i8x8 < NumC8x8; i8x8++) {
+                for (int32_t i4x4 = 0; i4x4 < 4; i4x4++) {
+                    int32_t chroma4x4BlkIdx = i8x8 * 4 + i4x4;
+
+                    if (mb->CodedBlockPatternChroma & 2) { /* chroma AC residual present */
+                        err_code = residual_block(rbsp_reader, picture, slice_header, cabac, CurrMbAddr, 4, chroma4x4BlkIdx, iCbCr,
+                                                  scratch->ChromaACLevel[iCbCr][chroma4x4BlkIdx], codec_max(0, startIdx - 1), endIdx - 1, 15, &TotalCoeff);
+                        if (err_code < 0) {
+                            return err_code;
+                        }
+
+                        set_mb_total_coeff(mb, 1 + iCbCr, chroma4x4BlkIdx, TotalCoeff);
+                        if (TotalCoeff) {
+                            mb->coded_block_flags |= 1u << (shift + chroma4x4BlkIdx);
+                        }
+                    } else {
+                        memset(scratch->ChromaACLevel[iCbCr][chroma4x4BlkIdx], 0, sizeof(scratch->ChromaACLevel[iCbCr][chroma4x4BlkIdx]));
+                    }
+                }
+            }
+        }
+    } else if (sps->ChromaArrayType == 3) {
+        /* residual_luma( cb... ) and residual_luma( cr... ), the Cb and Cr levels are parsed like the luma levels */
+        for (int32_t iComp = 1; iComp < 3; iComp++) {
+            err_code = residual_luma(rbsp_reader, picture, mb, slice_header, cabac, CurrMbAddr, iComp, startIdx, endIdx);
+            if (err_code < 0) {
+                return err_code;
+            }
+        }
+    }
 
     return ERR_OK;
 }
 
-int residual_luma(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t startIdx, int32_t endIdx) {
+int residual_luma(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t iComp, int32_t startIdx,
+                  int32_t endIdx) {
     int err_code = ERR_OK;
 
+    MacroBlockScratch* scratch = picture->mb_scratch;
     uint8_t is_entropy_coding = slice_header->pps->entropy_coding_mode_flag;
+    int32_t is_intra_16x16 = (mb->mb_pred_type == Intra_16x16);
+    int32_t TotalCoeff = 0;
+    int32_t* i16x16DClevel = scratch->i16x16DClevel[iComp];
+    int32_t(*i16x16AClevel)[16] = scratch->i16x16AClevel[iComp];
+    int32_t(*level4x4)[16] = scratch->level4x4[iComp];
+    int32_t(*level8x8)[64] = scratch->level8x8[iComp];
+    const int32_t* ctxBlockCat = g_residual_luma_ctxBlockCat[iComp];
+
+    /* the bits of the blocks are set as soon as the blocks are parsed, coded_block_flag of the next blocks of the macroblock is coded with them */
+    uint32_t* coded_block_flags = iComp == 0 ? &mb->coded_block_flags : &mb->coded_block_flags_444;
+    int32_t shift = iComp == 0 ? 0 : (iComp - 1) * 16;
+
+    if (startIdx == 0 && is_intra_16x16) {
+        err_code = residual_block(rbsp_reader, picture, slice_header, cabac, CurrMbAddr, ctxBlockCat[0], 0, -1, i16x16DClevel, 0, 15, 16, &TotalCoeff);
+        if (err_code < 0) {
+            return err_code;
+        }
 
-    if (startIdx == 0 && mb->mb_pred_type == Intra_16x16) {
-        if (is_entropy_coding) {
-            /* residual_block */
+        /* the DC block does not count in nN of clause 9.2.1 */
+        if (TotalCoeff) {
+            mb->coded_block_flags_dc |= H264_CBF_DC_LUMA << iComp;
+        }
+    }
+
+    for (int32_t i8x8 = 0; i8x8 < 4; i8x8++) {
+        if (!mb->transform_size_8x8_flag || !is_entropy_coding) {
+            uint32_t coded_8x8 = 0;
+
+            for (int32_t i4x4 = 0; i4x4 < 4; i4x4++) {
+                int32_t luma4x4BlkIdx = i8x8 * 4 + i4x4;
+
+                if (mb->CodedBlockPatternLuma & (1 << i8x8)) {
+                    if (is_intra_16x16) {
+                        err_code = residual_block(rbsp_reader, picture, slice_header, cabac, CurrMbAddr, ctxBlockCat[1], luma4x4BlkIdx, -1, i16x16AClevel[luma4x4BlkIdx],
+                                                  codec_max(0, startIdx - 1), endIdx - 1, 15, &TotalCoeff);
+                    } else {
+                        err_code = residual_block(rbsp_reader, picture, slice_header, cabac, CurrMbAddr, ctxBlockCat[2], luma4x4BlkIdx, -1, level4x4[luma4x4BlkIdx], startIdx,
+                                                  endIdx, 16, &TotalCoeff);
+                    }
+                    if (err_code < 0) {
+                        return err_code;
+                    }
+
+                    set_mb_total_coeff(mb, iComp, luma4x4BlkIdx, TotalCoeff);
+                    if (TotalCoeff) {
+                        coded_8x8 = 1;
+                        *coded_block_flags |= 1u << (shift + luma4x4BlkIdx);
+                    }
+                } else if (is_intra_16x16) {
+                    memset(i16x16AClevel[luma4x4BlkIdx], 0, 15 * sizeof(int32_t));
+                } else {
+                    memset(level4x4[luma4x4BlkIdx], 0, 16 * sizeof(int32_t));
+                }
+
+                if (!is_entropy_coding && mb->transform_size_8x8_flag) {
+                    for (int32_t i = 0; i < 16; i++) {
+                        level8x8[i8x8][4 * i + i4x4] = level4x4[luma4x4BlkIdx][i];
+                    }
+                }
+            }
+
+            /* the four 4x4 blocks of the interleaved CAVLC 8x8 block share the non-zero flag of the 8x8 block */
+            if (coded_8x8 && mb->transform_size_8x8_flag) {
+                *coded_block_flags |= 0xFu << (shift + i8x8 * 4);
+            }
+        } else if (mb->CodedBlockPatternLuma & (1 << i8x8)) {
+            err_code = residual_block(rbsp_reader, picture, slice_header, cabac, CurrMbAddr, ctxBlockCat[3], i8x8, -1, level8x8[i8x8], 4 * startIdx, 4 * endIdx + 3, 64,
+                                      &TotalCoeff);
+            if (err_code < 0) {
+                return err_code;
+            }
+
+            if (TotalCoeff) {
+                *coded_block_flags |= 0xFu << (shift + i8x8 * 4);
+            }
         } else {
-            /* residual_block */
+            memset(level8x8[i8x8], 0, 64 * sizeof(int32_t));
         }
     }
 
     return ERR_OK;
 }
 
-int residual_block_cabac(RBSPReader* rbsp_reader, FrameOrField* picture, MacroBlock* mb, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t* coeffLevel,
-                         int32_t startIdx, int32_t endIdx, int32_t maxNumCoeff){
+int residual_block_cabac(RBSPReader* rbsp_reader, FrameOrField* picture, SliceHeader* slice_header, CABAC* cabac, int32_t CurrMbAddr, int32_t ctxBlockCat, int32_t blkIdx,
+                         int32_t iCbCr, int32_t* coeffLevel, int32_t startIdx, int32_t endIdx, int32_t maxNumCoeff, int32_t* out_TotalCoeff) {
     int err_code = ERR_OK;
 
+    int32_t coded_block_flag = 1;
+    uint8_t significant_coeff_flag[64];
+
+    memset(coeffLevel, 0, maxNumCoeff * sizeof(int32_t));
+    *out_TotalCoeff = 0;
+
+    /* the coded_block_flag of the 8x8 blocks is inferred to be 1 unless ChromaArrayType is equal to 3 */
+    if (maxNumCoeff != 64 || slice_header->sps->ChromaArrayType == 3) {
+        err_code = cabac_coded_block_flag(rbsp_reader, cabac, picture, slice_header, CurrMbAddr, ctxBlockCat, blkIdx, iCbCr, &coded_block_flag);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    if (!coded_block_flag) {
+        return ERR_OK;
+    }
+
+    int32_t is_field = slice_header->field_pic_flag || bitset_get(picture->mb_field_flags, CurrMbAddr);
+    int32_t NumC8x8 = maxNumCoeff / 4;
+    int32_t numCoeff = endIdx + 1;
+
+    /* the significance map, the coefficient endIdx is significant when no last_significant_coeff_flag ends the map before it */
+    for (int32_t i = startIdx; i < numCoeff - 1; i++) {
+        int32_t flag = 0;
+        err_code = cabac_significant_coeff_flag(rbsp_reader, cabac, ctxBlockCat, is_field, i, NumC8x8, &flag);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        significant_coeff_flag[i] = (uint8_t)flag;
+        if (flag) {
+            err_code = cabac_last_significant_coeff_flag(rbsp_reader, cabac, ctxBlockCat, is_field, i, NumC8x8, &flag);
+            if (err_code < 0) {
+                return err_code;
+            }
+            if (flag) {
+                numCoeff = i + 1;
+            }
+        }
+    }
+    significant_coeff_flag[numCoeff - 1] = 1;
+
+    /* the levels in the reverse scanning order */
+    int32_t numDecodAbsLevelEq1 = 0;
+    int32_t numDecodAbsLevelGt1 = 0;
+    int32_t TotalCoeff = 0;
+
+    for (int32_t i = numCoeff - 1; i >= startIdx; i--) {
+        if (!significant_coeff_flag[i]) {
+            continue;
+        }
+
+        int32_t coeff_abs_level_minus1 = 0;
+        int32_t coeff_sign_flag = 0;
+        err_code = cabac_coeff_abs_level_minus1(rbsp_reader, cabac, ctxBlockCat, numDecodAbsLevelEq1, numDecodAbsLevelGt1, &coeff_abs_level_minus1);
+        if (err_code < 0) {
+            return err_code;
+        }
+        err_code = cabac_coeff_sign_flag(rbsp_reader, cabac, &coeff_sign_flag);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        coeffLevel[i] = (coeff_abs_level_minus1 + 1) * (1 - 2 * coeff_sign_flag);
+        if (coeff_abs_level_minus1) {
+            ++numDecodAbsLevelGt1;
+        } else {
+            ++numDecodAbsLevelEq1;
+        }
+        ++TotalCoeff;
+    }
+
+    *out_TotalCoeff = TotalCoeff;
 
     return ERR_OK;
-}
\ No newline at end of file
+}
@@ -0,0 +1,173 @@
+#include "h264decoder/h264_memory.h"
+
+#include <string.h>
+
+/**
+ * @brief the root of the tree of the budget, its mutex locks the counters of the tree
+ */
+static MemoryBudget* get_root_budget(MemoryBudget* budget) {
+    while (budget->parent) {
+        budget = budget->parent;
+    }
+    return budget;
+}
+
+int init_memory_budget(MemoryBudget* budget, MemoryBudget* parent) {
+    memset(budget, 0, sizeof(MemoryBudget));
+    if (pthread_mutex_init(&budget->mutex, 0) != 0) {
+        return ERR_OOM;
+    }
+    budget->parent = parent;
+
+    return ERR_OK;
+}
+
+void free_memory_budget(MemoryBudget* budget) {
+    if (budget->parent) {
+        MemoryBudget* root = get_root_budget(budget);
+        pthread_mutex_lock(&root->mutex);
+        budget->parent->reserved -= budget->limit;
+        pthread_mutex_unlock(&root->mutex);
+    }
+
+    pthread_mutex_destroy(&budget->mutex);
+}
+
+int set_memory_budget_parent(MemoryBudget* budget, MemoryBudget* parent) {
+    if (budget->total || budget->limit || budget->reserved) {
+        return ERR_INVALID_PARAM;
+    }
+
+    budget->parent = parent;
+    return ERR_OK;
+}
+
+int set_memory_budget_limit(MemoryBudget* budget, size_t limit) {
+    int err_code = ERR_OK;
+    MemoryBudget* root = get_root_budget(budget);
+    MemoryBudget* parent = budget->parent;
+
+    pthread_mutex_lock(&root->mutex);
+    if (limit && budget->reserved + budget->unreserved > limit) {
+        err_code = ERR_MEMORY_BUDGET_EXCEEDED;
+        goto exit_flag;
+    }
+
+    if (parent) {
+        /* the bytes of a child without a limit are unreserved in the parent, a child with a limit takes the limit from the parent instead */
+        size_t reserved = parent->reserved - budget->limit + limit;
+        size_t unreserved = parent->unreserved + (budget->limit ? budget->total : 0) - (limit ? budget->total : 0);
+        if (parent->limit && reserved + unreserved > parent->limit) {
+            err_code = ERR_MEMORY_BUDGET_EXCEEDED;
+            goto exit_flag;
+        }
+        parent->reserved = reserved;
+        parent->unreserved = unreserved;
+    }
+    budget->limit = limit;
+
+exit_flag:
+    pthread_mutex_unlock(&root->mutex);
+    return err_code;
+}
+
+int charge_memory(MemoryBudget* budget, MEMORY_CATEGORY category, size_t size) {
+    if (!budget || !size) {
+        return ERR_OK;
+    }
+
+    MemoryBudget* root = get_root_budget(budget);
+    pthread_mutex_lock(&root->mutex);
+
+    /* the charge is unreserved in the budget itself, and in a parent if it comes from a child without a limit */
+    int32_t is_unreserved = 1;
+    for (MemoryBudget* b = budget; b; b = b->parent) {
+        if (is_unreserved && b->limit && b->reserved + b->unreserved + size > b->limit) {
+            for (MemoryBudget* r = budget; r; r = r->parent) {
+                r->refused++;
+            }
+            pthread_mutex_unlock(&root->mutex);
+            return ERR_MEMORY_BUDGET_EXCEEDED;
+        }
+        is_unreserved = !b->limit;
+    }
+
+    is_unreserved = 1;
+    for (MemoryBudget* b = budget; b; b = b->parent) {
+        if (is_unreserved) {
+            b->unreserved += size;
+        }
+        is_unreserved = !b->limit;
+
+        b->total += size;
+        b->current[category] += size;
+        if (b->total > b->peak_total) {
+            b->peak_total = b->total;
+        }
+        if (b->current[category] > b->peak[category]) {
+            b->peak[category] = b->current[category];
+        }
+    }
+
+    pthread_mutex_unlock(&root->mutex);
+    return ERR_OK;
+}
+
+void uncharge_memory(MemoryBudget* budget, MEMORY_CATEGORY category, size_t size) {
+    if (!budget || !size) {
+        return;
+    }
+
+    MemoryBudget* root = get_root_budget(budget);
+    pthread_mutex_lock(&root->mutex);
+
+    int32_t is_unreserved = 1;
+    for (MemoryBudget* b = budget; b; b = b->parent) {
+        if (is_unreserved) {
+            b->unreserved -= size;
+        }
+        is_unreserved = !b->limit;
+
+        b->total -= size;
+        b->current[category] -= size;
+    }
+
+    pthread_mutex_unlock(&root->mutex);
+}
+
+size_t get_memory_room(MemoryBudget* budget) {
+    size_t room = SIZE_MAX;
+    if (!budget) {
+        return room;
+    }
+
+    MemoryBudget* root = get_root_budget(budget);
+    pthread_mutex_lock(&root->mutex);
+
+    int32_t is_unreserved = 1;
+    for (MemoryBudget* b = budget; b; b = b->parent) {
+        if (is_unreserved && b->limit) {
+            size_t used = b->reserved + b->unreserved;
+            size_t free_bytes = used < b->limit ? b->limit - used : 0;
+            room = free_bytes < room ? free_bytes : room;
+        }
+        is_unreserved = !b->limit;
+    }
+
+    pthread_mutex_unlock(&root->mutex);
+    return room;
+}
+
+void get_memory_budget_usage(MemoryBudget* budget, MemoryUsage* usage) {
+    MemoryBudget* root = get_root_budget(budget);
+    pthread_mutex_lock(&root->mutex);
+
+    usage->limit = budget->limit;
+    usage->total = budget->total;
+    usage->peak_total = budget->peak_total;
+    memcpy(usage->current, budget->current, sizeof(usage->current));
+    memcpy(usage->peak, budget->peak, sizeof(usage->peak));
+    usage->refused = budget->refused;
+
+    pthread_mutex_unlock(&root->mutex);
+}
@@ -0,0 +1,657 @@
+#include "h264decoder/h264_mv_pred.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "h264decoder/h264_frame_thread.h"
+#include "h264decoder/h264_locations_neighbours.h"
+#include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_math.h"
+
+/**
+ * @brief the prediction of 8.4.1.3 selected by the partition shape, the 16x8 and 8x16 partitions take the motion vector of one neighbour with the same reference index
+ */
+typedef enum MV_PRED_SHAPE {
+    MV_PRED_MEDIAN,     /* the other partitions */
+    MV_PRED_16x8_UPPER, /* mbPartIdx 0 of a 16x8 macroblock type, B */
+    MV_PRED_16x8_LOWER, /* mbPartIdx 1 of a 16x8 macroblock type, A */
+    MV_PRED_8x16_LEFT,  /* mbPartIdx 0 of a 8x16 macroblock type, A */
+    MV_PRED_8x16_RIGHT, /* mbPartIdx 1 of a 8x16 macroblock type, C */
+} MV_PRED_SHAPE;
+
+/**
+ * @brief vertMvScale of the co-located macroblock
+ * @see Table 8-6 – Specification of the variable colPic
+ */
+typedef enum VERT_MV_SCALE {
+    One_To_One,
+    Frm_To_Fld,
+    Fld_To_Frm,
+} VERT_MV_SCALE;
+
+/**
+ * @brief the predictors of the spatial direct mode, they are derived once per macroblock from the neighbours of the whole macroblock
+ * @see 8.4.1.2.2 Derivation process for spatial direct luma motion vector and reference index prediction
+ */
+typedef struct {
+    int32_t is_derived;
+    int32_t refIdx[2];
+    int16_t mvp[2][2];
+    int32_t directZeroPredictionFlag;
+} SpatialDirect;
+
+/**
+ * @brief the co-located picture of the direct modes of the macroblock
+ * @see 8.4.1.2.1 Derivation process for the co-located 4x4 sub-macroblock partitions
+ */
+typedef struct {
+    /* the frame or field which holds the motion data of colPic */
+    const FrameOrField* colPic;
+    VERT_MV_SCALE vertMvScale;
+    /* RefPicList1[ 0 ] is a long-term reference picture */
+    int32_t long_term;
+} CoLocated;
+
+static inline int32_t median3(int32_t a, int32_t b, int32_t c) { return a + b + c - codec_min(a, codec_min(b, c)) - codec_max(a, codec_max(b, c)); }
+
+/* MinPositive( x, y ) of equation 8-186 */
+static inline int32_t min_positive(int32_t x, int32_t y) { return (x >= 0 && y >= 0) ? codec_min(x, y) : codec_max(x, y); }
+
+static inline void copy_mv(int16_t dst[2], const int16_t src[2]) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+}
+
+/**
+ * @brief check whether the 8x8 block of the macroblock is predicted in the direct mode
+ */
+static inline int32_t is_direct_block(const FrameOrField* picture, int32_t mbAddr, int32_t luma8x8BlkIdx) {
+    MB_TYPE_NAME mb_type_name = (MB_TYPE_NAME)picture->mb_type_names[mbAddr];
+    return mb_type_name == B_Skip || mb_type_name == B_Direct_16x16 || (mb_type_name == B_8x8 && picture->mb_list[mbAddr].sub_mb_type_name[luma8x8BlkIdx] == B_Direct_8x8);
+}
+
+/**
+ * @brief load the motion data of the 4x4 block ( xW, yW ) of the macroblock mbAddrN into the cache entry
+ * @see 8.4.1.3.2 Derivation process for motion data of neighbouring partitions
+ */
+static void load_neighbour(const FrameOrField* picture, MvCache* cache, int32_t MbaffFrameFlag, int32_t currMbFrameFlag, int32_t mbAddrN, int32_t xW, int32_t yW,
+                           int32_t idx) {
+    if (mbAddrN < 0) {
+        return;
+    }
+
+    int32_t blk = mbAddrN * 16 + (yW >> 2) * 4 + (xW >> 2);
+
+    /* in MBAFF frames the vertical motion vector and the reference index of a frame macroblock are scaled for a field macroblock and vice versa, equations 8-214 to
+     * 8-217. the vertical mvd is scaled as specified in 9.3.3.1.1.7 */
+    int32_t scale = 0;
+    if (MbaffFrameFlag) {
+        int32_t mbFieldN = bitset_get(picture->mb_field_flags, mbAddrN);
+        if (!currMbFrameFlag && !mbFieldN) {
+            scale = -1;
+        } else if (currMbFrameFlag && mbFieldN) {
+            scale = 1;
+        }
+    }
+
+    for (int32_t list = 0; list < 2; ++list) {
+        int32_t refIdx = picture->ref_idxs[list][blk];
+        int32_t mvy = picture->mvs[list][2 * blk + 1];
+        int32_t mvdy = picture->mvds[list][2 * blk + 1];
+
+        if (scale < 0) {
+            mvy = mvy / 2;
+            mvdy = mvdy / 2;
+            refIdx = refIdx >= 0 ? refIdx * 2 : refIdx;
+        } else if (scale > 0) {
+            mvy = mvy * 2;
+            mvdy = codec_min(mvdy * 2, 255);
+            refIdx = refIdx >= 0 ? refIdx >> 1 : refIdx;
+        }
+
+        cache->ref[list][idx] = (int8_t)refIdx;
+        cache->mv[list][idx][0] = picture->mvs[list][2 * blk];
+        cache->mv[list][idx][1] = (int16_t)mvy;
+        cache->mvd[list][idx][0] = picture->mvds[list][2 * blk];
+        cache->mvd[list][idx][1] = (uint8_t)mvdy;
+    }
+
+    cache->direct[idx] = (uint8_t)is_direct_block(picture, mbAddrN, (yW >> 3) * 2 + (xW >> 3));
+}
+
+void init_mv_cache(FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr) {
+    MvCache* cache = &picture->mb_scratch->mv_cache;
+    int32_t MbaffFrameFlag = slice_header->MbaffFrameFlag;
+    int32_t currMbFrameFlag = !bitset_get(picture->mb_field_flags, CurrMbAddr);
+    int32_t PicWidthInMbs = (int32_t)slice_header->sps->PicWidthInMbs;
+
+    RELATIVE_LOCATION_TYPE mbAddrN_type;
+    int32_t mbAddrN = -1;
+    int32_t xW = 0;
+    int32_t yW = 0;
+
+    memset(cache, 0, sizeof(MvCache));
+    memset(cache->ref, H264_MV_CACHE_NA, sizeof(cache->ref));
+
+    /* A: the rows of the macroblock may be in the different macroblocks of the left macroblock pair in MBAFF frames */
+    for (int32_t y4 = 0; y4 < 4; ++y4) {
+        neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, picture->mb_slice_ids, picture->mb_field_flags, -1, y4 * 4, 16, 16,
+                               &mbAddrN_type, &mbAddrN, &xW, &yW);
+        load_neighbour(picture, cache, MbaffFrameFlag, currMbFrameFlag, mbAddrN, xW, yW, MV_CACHE_IDX(-1, y4));
+    }
+
+    /* B: the row above the macroblock is one row of one macroblock */
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, picture->mb_slice_ids, picture->mb_field_flags, 0, -1, 16, 16, &mbAddrN_type,
+                           &mbAddrN, &xW, &yW);
+    for (int32_t x4 = 0; x4 < 4; ++x4) {
+        load_neighbour(picture, cache, MbaffFrameFlag, currMbFrameFlag, mbAddrN, x4 * 4, yW, MV_CACHE_IDX(x4, -1));
+    }
+
+    /* C */
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, picture->mb_slice_ids, picture->mb_field_flags, 16, -1, 16, 16, &mbAddrN_type,
+                           &mbAddrN, &xW, &yW);
+    load_neighbour(picture, cache, MbaffFrameFlag, currMbFrameFlag, mbAddrN, xW, yW, MV_CACHE_IDX(4, -1));
+
+    /* D */
+    neighbouring_locations(MbaffFrameFlag, CurrMbAddr, currMbFrameFlag, PicWidthInMbs, picture->mb_slice_ids, picture->mb_field_flags, -1, -1, 16, 16, &mbAddrN_type,
+                           &mbAddrN, &xW, &yW);
+    load_neighbour(picture, cache, MbaffFrameFlag, currMbFrameFlag, mbAddrN, xW, yW, MV_CACHE_IDX(-1, -1));
+}
+
+/**
+ * @brief Derivation process for luma motion vector prediction
+ * @see 8.4.1.3 Derivation process for luma motion vector prediction
+ * @see 8.4.1.3.1 Derivation process for median luma motion vector prediction
+ *
+ * @param cache the motion data cache
+ * @param list the reference picture list X
+ * @param idx the cache index of the upper-left 4x4 block of the partition
+ * @param w4 predPartWidth / 4
+ * @param refIdxLX the reference index of the partition
+ * @param shape the partition shape
+ * @param mvpLX output parameter. the motion vector prediction
+ */
+static void luma_mv_prediction(const MvCache* cache, int32_t list, int32_t idx, int32_t w4, int32_t refIdxLX, MV_PRED_SHAPE shape, int16_t mvpLX[2]) {
+    const int8_t* ref = cache->ref[list];
+    const int16_t(*mv)[2] = cache->mv[list];
+
+    int32_t idxA = idx - 1;
+    int32_t idxB = idx - 8;
+    int32_t idxC = idx - 8 + w4;
+    /* 8.4.1.3.2: when the partition C is not available, the partition D is used */
+    if (ref[idxC] == H264_MV_CACHE_NA) {
+        idxC = idx - 9;
+    }
+
+    int32_t refIdxLXA = ref[idxA];
+    int32_t refIdxLXB = ref[idxB];
+    int32_t refIdxLXC = ref[idxC];
+
+    if (shape == MV_PRED_16x8_UPPER && refIdxLXB == refIdxLX) {
+        copy_mv(mvpLX, mv[idxB]);
+        return;
+    } else if ((shape == MV_PRED_16x8_LOWER || shape == MV_PRED_8x16_LEFT) && refIdxLXA == refIdxLX) {
+        copy_mv(mvpLX, mv[idxA]);
+        return;
+    } else if (shape == MV_PRED_8x16_RIGHT && refIdxLXC == refIdxLX) {
+        copy_mv(mvpLX, mv[idxC]);
+        return;
+    }
+
+    /* when both B and C are not available and A is available, mvLXA is used for B and C and the median is mvLXA */
+    if (refIdxLXB == H264_MV_CACHE_NA && refIdxLXC == H264_MV_CACHE_NA && refIdxLXA != H264_MV_CACHE_NA) {
+        copy_mv(mvpLX, mv[idxA]);
+        return;
+    }
+
+    /* when one and only one of the reference indices is equal to refIdxLX, the motion vector of that partition is the prediction */
+    int32_t matchA = refIdxLXA == refIdxLX;
+    int32_t matchB = refIdxLXB == refIdxLX;
+    int32_t matchC = refIdxLXC == refIdxLX;
+    if (matchA + matchB + matchC == 1) {
+        copy_mv(mvpLX, mv[matchA ? idxA : (matchB ? idxB : idxC)]);
+        return;
+    }
+
+    mvpLX[0] = (int16_t)median3(mv[idxA][0], mv[idxB][0], mv[idxC][0]);
+    mvpLX[1] = (int16_t)median3(mv[idxA][1], mv[idxB][1], mv[idxC][1]);
+}
+
+/**
+ * @brief write the motion data of a partition of w4 x h4 4x4 blocks into the cache
+ */
+static void fill_partition(MvCache* cache, int32_t list, int32_t idx, int32_t w4, int32_t h4, int32_t refIdx, const int16_t mvLX[2]) {
+    for (int32_t y4 = 0; y4 < h4; ++y4) {
+        for (int32_t x4 = 0; x4 < w4; ++x4) {
+            cache->ref[list][idx + y4 * 8 + x4] = (int8_t)refIdx;
+            copy_mv(cache->mv[list][idx + y4 * 8 + x4], mvLX);
+        }
+    }
+}
+
+/**
+ * @brief derive the motion vector of a partition predicted from list X, mvLX = mvpLX + mvdLX, the reference index is -1 if the list is not used
+ * @see 8.4.1 Derivation process for motion vector components and reference indices
+ */
+static void derivation_for_partition(MvCache* cache, int32_t list, int32_t idx, int32_t w4, int32_t h4, int32_t refIdxLX, MV_PRED_SHAPE shape, const int32_t mvdLX[2]) {
+    int16_t mvLX[2] = {0, 0};
+
+    if (refIdxLX >= 0) {
+        luma_mv_prediction(cache, list, idx, w4, refIdxLX, shape, mvLX);
+        mvLX[0] = (int16_t)(mvLX[0] + mvdLX[0]);
+        mvLX[1] = (int16_t)(mvLX[1] + mvdLX[1]);
+    }
+
+    fill_partition(cache, list, idx, w4, h4, refIdxLX < 0 ? -1 : refIdxLX, mvLX);
+}
+
+/**
+ * @brief Derivation process for luma motion vectors for skipped macroblocks in P and SP slices
+ * @see 8.4.1.1 Derivation process for luma motion vectors for skipped macroblocks in P and SP slices
+ */
+static void derivation_for_p_skip(MvCache* cache) {
+    static const int16_t zero_mv[2] = {0, 0};
+    int16_t mvL0[2] = {0, 0};
+
+    int32_t idxA = MV_CACHE_IDX(-1, 0);
+    int32_t idxB = MV_CACHE_IDX(0, -1);
+    int32_t refIdxL0A = cache->ref[0][idxA];
+    int32_t refIdxL0B = cache->ref[0][idxB];
+
+    /* the motion vector is 0 if A or B is not available, or A or B refers to the first reference picture with the motion vector 0 */
+    if (!(refIdxL0A == H264_MV_CACHE_NA || refIdxL0B == H264_MV_CACHE_NA || (refIdxL0A == 0 && cache->mv[0][idxA][0] == 0 && cache->mv[0][idxA][1] == 0) ||
+          (refIdxL0B == 0 && cache->mv[0][idxB][0] == 0 && cache->mv[0][idxB][1] == 0))) {
+        luma_mv_prediction(cache, 0, MV_CACHE_IDX(0, 0), 4, 0, MV_PRED_MEDIAN, mvL0);
+    }
+
+    fill_partition(cache, 0, MV_CACHE_IDX(0, 0), 4, 4, 0, mvL0);
+    fill_partition(cache, 1, MV_CACHE_IDX(0, 0), 4, 4, -1, zero_mv);
+}
+
+/**
+ * @brief select the co-located picture of the macroblocks of the current picture
+ * @see 8.4.1.2.1 Derivation process for the co-located 4x4 sub-macroblock partitions
+ * @see Table 8-6 – Specification of the variable colPic
+ *
+ * @param picture the frame or field
+ * @param slice_header the slice header
+ * @param out_col output parameter. the co-located picture
+ * @return int 0 on success, negative value on error
+ */
+static int derivation_for_colocated_picture(FrameOrField* picture, SliceHeader* slice_header, CoLocated* out_col) {
+    const RefPicEntry* firstRefPicL1 = &get_current_ref_lists(picture)->entries[1][0];
+
+    /* the reference picture lists are filled by the reference picture list construction */
+    if (!firstRefPicL1->ff || !firstRefPicL1->ff->parent) {
+        return ERR_NO_COLOCATED_PICTURE;
+    }
+
+    /* the co-located macroblocks of the MBAFF frames are not supported */
+    if (slice_header->MbaffFrameFlag || (slice_header->sps->mb_adaptive_frame_field_flag && firstRefPicL1->ff->parent->coded_type == PICTURE_CODED_FRAME)) {
+        return ERR_NOT_IMPL;
+    }
+
+    const Picture* refPic = firstRefPicL1->ff->parent;
+    int32_t is_coded_frame = refPic->coded_type == PICTURE_CODED_FRAME;
+
+    out_col->long_term = firstRefPicL1->long_term;
+    if (slice_header->field_pic_flag) {
+        /* the field of a decoded frame or a decoded field */
+        out_col->colPic = is_coded_frame ? refPic->frame : firstRefPicL1->ff;
+        out_col->vertMvScale = is_coded_frame ? Frm_To_Fld : One_To_One;
+    } else if (is_coded_frame) {
+        out_col->colPic = refPic->frame;
+        out_col->vertMvScale = One_To_One;
+    } else {
+        /* the field of the complementary field pair which is closer to the current picture */
+        int32_t topAbsDiffPOC = abs(refPic->top_field->poc - picture->poc);
+        int32_t bottomAbsDiffPOC = abs(refPic->bottom_field->poc - picture->poc);
+        out_col->colPic = topAbsDiffPOC < bottomAbsDiffPOC ? refPic->top_field : refPic->bottom_field;
+        out_col->vertMvScale = Fld_To_Frm;
+    }
+
+    return ERR_OK;
+}
+
+/**
+ * @brief wait until the frame thread decoding colPic has decoded the macroblock row holding the co-located macroblocks of the current macroblock
+ *
+ * @param picture the frame or field being decoded by a frame thread
+ * @param col the co-located picture
+ * @param PicWidthInMbs the picture width in macroblocks
+ * @param CurrMbAddr the current macroblock address
+ */
+static void wait_for_colocated_row(const FrameOrField* picture, const CoLocated* col, int32_t PicWidthInMbs, int32_t CurrMbAddr) {
+    int32_t mb_row = CurrMbAddr / PicWidthInMbs;
+
+    /* the rows of mbAddrCol of derivation_for_colocated_block() */
+    int32_t rows = mb_row + 1;
+    if (col->vertMvScale == Frm_To_Fld) {
+        rows = 2 * mb_row + 2;
+    } else if (col->vertMvScale == Fld_To_Frm) {
+        rows = mb_row / 2 + 1;
+    }
+
+    if (col->colPic->parent != picture->parent) {
+        wait_for_decoded_mb_rows(picture->parent->threads, col->colPic, rows);
+    }
+}
+
+/**
+ * @brief get the motion data of the co-located 4x4 block
+ * @see 8.4.1.2.1 Derivation process for the co-located 4x4 sub-macroblock partitions
+ *
+ * @param col the co-located picture
+ * @param PicWidthInMbs the picture width in macroblocks
+ * @param CurrMbAddr the current macroblock address
+ * @param xCol the horizontal luma location of the 4x4 block in the current macroblock
+ * @param yCol the vertical luma location of the 4x4 block in the current macroblock
+ * @param mvCol output parameter. the motion vector of the co-located block
+ * @param refIdxCol output parameter. the reference index of the co-located block, -1 for the intra macroblocks
+ * @param refPicCol output parameter. the frame or field referred by refIdxCol, 0 if refIdxCol is -1
+ */
+static void derivation_for_colocated_block(const CoLocated* col, int32_t PicWidthInMbs, int32_t CurrMbAddr, int32_t xCol, int32_t yCol, int16_t mvCol[2],
+                                           int32_t* refIdxCol, const FrameOrField** refPicCol) {
+    const FrameOrField* colPic = col->colPic;
+    int32_t mbAddrCol = CurrMbAddr;
+    int32_t yM = yCol;
+
+    if (col->vertMvScale == Frm_To_Fld) {
+        mbAddrCol = 2 * PicWidthInMbs * (CurrMbAddr / PicWidthInMbs) + (CurrMbAddr % PicWidthInMbs) + PicWidthInMbs * (yCol / 8);
+        yM = (2 * yCol) % 16;
+    } else if (col->vertMvScale == Fld_To_Frm) {
+        mbAddrCol = PicWidthInMbs * (CurrMbAddr / (2 * PicWidthInMbs)) + (CurrMbAddr % PicWidthInMbs);
+        yM = 8 * ((CurrMbAddr / PicWidthInMbs) % 2) + 4 * (yCol / 8);
+    }
+
+    int32_t blk = mbAddrCol * 16 + (yM >> 2) * 4 + (xCol >> 2);
+    int32_t slice_num = colPic->mb_slice_ids[mbAddrCol];
+
+    /* the list 1 motion data is used if predFlagL0Col is 0, the intra macroblocks have the reference index -1 in both lists */
+    int32_t listCol = colPic->ref_idxs[0][blk] < 0;
+
+    *refIdxCol = slice_num < 0 ? -1 : colPic->ref_idxs[listCol][blk];
+    if (*refIdxCol < 0) {
+        mvCol[0] = 0;
+        mvCol[1] = 0;
+        *refPicCol = 0;
+        return;
+    }
+
+    copy_mv(mvCol, &colPic->mvs[listCol][2 * blk]);
+    *refPicCol = colPic->slice_ref_lists[slice_num].entries[listCol][*refIdxCol].ff;
+}
+
+/**
+ * @brief Derivation process for spatial direct luma motion vector and reference index prediction of a 8x8 block
+ * @see 8.4.1.2.2 Derivation process for spatial direct luma motion vector and reference index prediction
+ */
+static void derivation_for_spatial_direct(MvCache* cache, const CoLocated* col, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t mbPartIdx, SpatialDirect* spatial) {
+    if (!spatial->is_derived) {
+        /* the reference indices and the motion vector predictions are derived for the whole macroblock, predPartWidth is 16 */
+        int32_t idxC = MV_CACHE_IDX(4, -1);
+        for (int32_t list = 0; list < 2; ++list) {
+            const int8_t* ref = cache->ref[list];
+            int32_t refIdxC = ref[idxC] == H264_MV_CACHE_NA ? ref[MV_CACHE_IDX(-1, -1)] : ref[idxC];
+            spatial->refIdx[list] = min_positive(ref[MV_CACHE_IDX(-1, 0)], min_positive(ref[MV_CACHE_IDX(0, -1)], refIdxC));
+        }
+
+        spatial->directZeroPredictionFlag = spatial->refIdx[0] < 0 && spatial->refIdx[1] < 0;
+        if (spatial->directZeroPredictionFlag) {
+            spatial->refIdx[0] = 0;
+            spatial->refIdx[1] = 0;
+        }
+
+        for (int32_t list = 0; list < 2; ++list) {
+            spatial->mvp[list][0] = 0;
+            spatial->mvp[list][1] = 0;
+            if (!spatial->directZeroPredictionFlag && spatial->refIdx[list] >= 0) {
+                luma_mv_prediction(cache, list, MV_CACHE_IDX(0, 0), 4, spatial->refIdx[list], MV_PRED_MEDIAN, spatial->mvp[list]);
+            }
+        }
+
+        spatial->is_derived = 1;
+    }
+
+    int32_t direct_8x8_inference_flag = slice_header->sps->direct_8x8_inference_flag;
+    int32_t PicWidthInMbs = (int32_t)slice_header->sps->PicWidthInMbs;
+    int32_t x8 = (mbPartIdx & 1) * 2;
+    int32_t y8 = (mbPartIdx >> 1) * 2;
+
+    for (int32_t subMbPartIdx = 0; subMbPartIdx < 4; ++subMbPartIdx) {
+        int32_t x4 = x8 + (subMbPartIdx & 1);
+        int32_t y4 = y8 + (subMbPartIdx >> 1);
+        /* the corner 4x4 block of the 8x8 block, luma4x4BlkIdx = 5 * mbPartIdx, is co-located with the 8x8 block when direct_8x8_inference_flag is 1 */
+        int32_t xCol = direct_8x8_inference_flag ? (mbPartIdx & 1) * 12 : x4 * 4;
+        int32_t yCol = direct_8x8_inference_flag ? (mbPartIdx >> 1) * 12 : y4 * 4;
+
+        int16_t mvCol[2];
+        int32_t refIdxCol;
+        const FrameOrField* refPicCol;
+        derivation_for_colocated_block(col, PicWidthInMbs, CurrMbAddr, xCol, yCol, mvCol, &refIdxCol, &refPicCol);
+
+        int32_t colZeroFlag = !col->long_term && refIdxCol == 0 && mvCol[0] >= -1 && mvCol[0] <= 1 && mvCol[1] >= -1 && mvCol[1] <= 1;
+
+        for (int32_t list = 0; list < 2; ++list) {
+            int32_t refIdx = spatial->refIdx[list];
+            int16_t mvLX[2] = {0, 0};
+            if (!spatial->directZeroPredictionFlag && refIdx >= 0 && !(refIdx == 0 && colZeroFlag)) {
+                copy_mv(mvLX, spatial->mvp[list]);
+            }
+            fill_partition(cache, list, MV_CACHE_IDX(x4, y4), 1, 1, refIdx < 0 ? -1 : refIdx, mvLX);
+        }
+    }
+}
+
+/**
+ * @brief Derivation process for temporal direct luma motion vector and reference index prediction of a 8x8 block
+ * @see 8.4.1.2.3 Derivation process for temporal direct luma motion vector and reference index prediction
+ */
+static int derivation_for_temporal_direct(FrameOrField* picture, MvCache* cache, const CoLocated* col, SliceHeader* slice_header, int32_t CurrMbAddr, int32_t mbPartIdx) {
+    const RefPicLists* lists = get_current_ref_lists(picture);
+    int32_t direct_8x8_inference_flag = slice_header->sps->direct_8x8_inference_flag;
+    int32_t PicWidthInMbs = (int32_t)slice_header->sps->PicWidthInMbs;
+    int32_t x8 = (mbPartIdx & 1) * 2;
+    int32_t y8 = (mbPartIdx >> 1) * 2;
+
+    for (int32_t subMbPartIdx = 0; subMbPartIdx < 4; ++subMbPartIdx) {
+        int32_t x4 = x8 + (subMbPartIdx & 1);
+        int32_t y4 = y8 + (subMbPartIdx >> 1);
+        int32_t xCol = direct_8x8_inference_flag ? (mbPartIdx & 1) * 12 : x4 * 4;
+        int32_t yCol = direct_8x8_inference_flag ? (mbPartIdx >> 1) * 12 : y4 * 4;
+
+        int16_t mvCol[2];
+        int32_t refIdxCol;
+        const FrameOrField* refPicCol;
+        derivation_for_colocated_block(col, PicWidthInMbs, CurrMbAddr, xCol, yCol, mvCol, &refIdxCol, &refPicCol);
+
+        /* refIdxL0 is the lowest valued reference index in the current list 0 that references the frame, the field or the field of the frame referred by refIdxCol */
+        int32_t refIdxL0 = 0;
+        if (refIdxCol >= 0) {
+            const FrameOrField* target = refPicCol;
+            if (refPicCol && col->vertMvScale == Frm_To_Fld) {
+                target = slice_header->bottom_field_flag ? refPicCol->parent->bottom_field : refPicCol->parent->top_field;
+            } else if (refPicCol && col->vertMvScale == Fld_To_Frm) {
+                target = refPicCol->parent->frame;
+            }
+
+            refIdxL0 = -1;
+            for (int32_t i = 0; i < lists->num[0]; ++i) {
+                if (target && lists->entries[0][i].ff == target) {
+                    refIdxL0 = i;
+                    break;
+                }
+            }
+            if (refIdxL0 < 0) {
+                return ERR_INVALID_REF_IDX;
+            }
+        }
+
+        if (col->vertMvScale == Frm_To_Fld) {
+            mvCol[1] = (int16_t)(mvCol[1] / 2);
+        } else if (col->vertMvScale == Fld_To_Frm) {
+            mvCol[1] = (int16_t)(mvCol[1] * 2);
+        }
+
+        const RefPicEntry* pic0 = &lists->entries[0][refIdxL0];
+        const RefPicEntry* pic1 = &lists->entries[1][0];
+        int16_t mvL0[2];
+        int16_t mvL1[2];
+
+        int32_t tb = clip3(-128, 127, picture->poc - pic0->poc);
+        int32_t td = clip3(-128, 127, pic1->poc - pic0->poc);
+        if (pic0->long_term || td == 0) {
+            copy_mv(mvL0, mvCol);
+            mvL1[0] = 0;
+            mvL1[1] = 0;
+        } else {
+            int32_t tx = (16384 + abs(td / 2)) / td;
+            int32_t DistScaleFactor = clip3(-1024, 1023, (tb * tx + 32) >> 6);
+            for (int32_t compIdx = 0; compIdx < 2; ++compIdx) {
+                mvL0[compIdx] = (int16_t)((DistScaleFactor * mvCol[compIdx] + 128) >> 8);
+                mvL1[compIdx] = (int16_t)(mvL0[compIdx] - mvCol[compIdx]);
+            }
+        }
+
+        fill_partition(cache, 0, MV_CACHE_IDX(x4, y4), 1, 1, refIdxL0, mvL0);
+        fill_partition(cache, 1, MV_CACHE_IDX(x4, y4), 1, 1, 0, mvL1);
+    }
+
+    return ERR_OK;
+}
+
+/**
+ * @brief store the motion data of the macroblock from the cache to the picture
+ */
+static void store_motion_data(FrameOrField* picture, const MvCache* cache, int32_t CurrMbAddr) {
+    for (int32_t list = 0; list < 2; ++list) {
+        int16_t* mvs = picture->mvs[list] + CurrMbAddr * 32;
+        int8_t* ref_idxs = picture->ref_idxs[list] + CurrMbAddr * 16;
+        uint8_t* mvds = picture->mvds[list] + CurrMbAddr * 32;
+
+        for (int32_t y4 = 0; y4 < 4; ++y4) {
+            int32_t idx = MV_CACHE_IDX(0, y4);
+            memcpy(mvs + y4 * 8, cache->mv[list][idx], 8 * sizeof(int16_t));
+            memcpy(ref_idxs + y4 * 4, &cache->ref[list][idx], 4);
+            memcpy(mvds + y4 * 8, cache->mvd[list][idx], 8);
+        }
+    }
+}
+
+int derivation_for_motion_vectors(FrameOrField* picture, SliceHeader* slice_header, int32_t CurrMbAddr) {
+    int err_code = ERR_OK;
+
+    MacroBlock* mb = &picture->mb_list[CurrMbAddr];
+    MacroBlockScratch* scratch = picture->mb_scratch;
+    MvCache* cache = &scratch->mv_cache;
+    MB_TYPE_NAME mb_type_name = (MB_TYPE_NAME)picture->mb_type_names[CurrMbAddr];
+
+    if (mb_is_intra(mb)) {
+        for (int32_t list = 0; list < 2; ++list) {
+            memset(picture->mvs[list] + CurrMbAddr * 32, 0, 32 * sizeof(int16_t));
+            memset(picture->ref_idxs[list] + CurrMbAddr * 16, 0xFF, 16);
+            memset(picture->mvds[list] + CurrMbAddr * 32, 0, 32);
+        }
+        return ERR_OK;
+    }
+
+    /* the partitions are derived in decoding order, the blocks of the macroblock are not available until their partition is derived */
+    for (int32_t list = 0; list < 2; ++list) {
+        for (int32_t y4 = 0; y4 < 4; ++y4) {
+            memset(&cache->ref[list][MV_CACHE_IDX(0, y4)], H264_MV_CACHE_NA, 4);
+        }
+    }
+
+    CoLocated col;
+    SpatialDirect spatial;
+    spatial.is_derived = 0;
+
+    int32_t has_direct = mb_type_name == B_Skip || mb_type_name == B_Direct_16x16;
+    if (mb_type_name == B_8x8) {
+        for (int32_t mbPartIdx = 0; mbPartIdx < 4; ++mbPartIdx) {
+            has_direct |= mb->sub_mb_type_name[mbPartIdx] == B_Direct_8x8;
+        }
+    }
+
+    if (has_direct) {
+        err_code = derivation_for_colocated_picture(picture, slice_header, &col);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        if (picture->parent && picture->parent->threads) {
+            wait_for_colocated_row(picture, &col, (int32_t)slice_header->sps->PicWidthInMbs, CurrMbAddr);
+        }
+    }
+
+    if (mb_type_name == P_Skip) {
+        derivation_for_p_skip(cache);
+    } else if (has_direct && mb_type_name != B_8x8) {
+        for (int32_t mbPartIdx = 0; mbPartIdx < 4; ++mbPartIdx) {
+            if (slice_header->direct_spatial_mv_pred_flag) {
+                derivation_for_spatial_direct(cache, &col, slice_header, CurrMbAddr, mbPartIdx, &spatial);
+            } else {
+                err_code = derivation_for_temporal_direct(picture, cache, &col, slice_header, CurrMbAddr, mbPartIdx);
+                if (err_code < 0) {
+                    return err_code;
+                }
+            }
+        }
+    } else if (mb_type_name == P_8x8 || mb_type_name == P_8x8ref0 || mb_type_name == B_8x8) {
+        for (int32_t mbPartIdx = 0; mbPartIdx < 4; ++mbPartIdx) {
+            MB_TYPE_NAME sub_mb_type_name = (MB_TYPE_NAME)mb->sub_mb_type_name[mbPartIdx];
+
+            if (sub_mb_type_name == B_Direct_8x8) {
+                if (slice_header->direct_spatial_mv_pred_flag) {
+                    derivation_for_spatial_direct(cache, &col, slice_header, CurrMbAddr, mbPartIdx, &spatial);
+                } else {
+                    err_code = derivation_for_temporal_direct(picture, cache, &col, slice_header, CurrMbAddr, mbPartIdx);
+                    if (err_code < 0) {
+                        return err_code;
+                    }
+                }
+                continue;
+            }
+
+            const MB_TYPE_INFO* sub_info = get_mb_type_info(sub_mb_type_name);
+            int32_t pred_mode = sub_info->MbPartPredMode0;
+            int32_t w4 = sub_info->MbPartWidth / 4;
+            int32_t h4 = sub_info->MbPartHeight / 4;
+
+            for (int32_t subMbPartIdx = 0; subMbPartIdx < sub_info->NumMbPart; ++subMbPartIdx) {
+                int32_t idx = MV_CACHE_IDX((mbPartIdx & 1) * 2 + sub_info->part_x[subMbPartIdx] / 4, (mbPartIdx >> 1) * 2 + sub_info->part_y[subMbPartIdx] / 4);
+                for (int32_t list = 0; list < 2; ++list) {
+                    int32_t uses_list = pred_mode == BiPred || pred_mode == (list ? Pred_L1 : Pred_L0);
+                    int32_t refIdxLX = uses_list ? scratch->ref_idx[list][mbPartIdx] : -1;
+                    derivation_for_partition(cache, list, idx, w4, h4, refIdxLX, MV_PRED_MEDIAN, scratch->mvd[list][mbPartIdx][subMbPartIdx]);
+                }
+            }
+        }
+    } else {
+        const MB_TYPE_INFO* info = get_mb_type_info(mb_type_name);
+        int32_t w4 = info->MbPartWidth / 4;
+        int32_t h4 = info->MbPartHeight / 4;
+
+        for (int32_t mbPartIdx = 0; mbPartIdx < info->NumMbPart; ++mbPartIdx) {
+            int32_t pred_mode = mbPartIdx ? info->MbPartPredMode1 : info->MbPartPredMode0;
+            int32_t idx = MV_CACHE_IDX(info->part_x[mbPartIdx] / 4, info->part_y[mbPartIdx] / 4);
+
+            MV_PRED_SHAPE shape = MV_PRED_MEDIAN;
+            if (w4 == 4 && h4 == 2) {
+                shape = mbPartIdx ? MV_PRED_16x8_LOWER : MV_PRED_16x8_UPPER;
+            } else if (w4 == 2 && h4 == 4) {
+                shape = mbPartIdx ? MV_PRED_8x16_RIGHT : MV_PRED_8x16_LEFT;
+            }
+
+            for (int32_t list = 0; list < 2; ++list) {
+                int32_t uses_list = pred_mode == BiPred || pred_mode == (list ? Pred_L1 : Pred_L0);
+                int32_t refIdxLX = uses_list ? scratch->ref_idx[list][mbPartIdx] : -1;
+                derivation_for_partition(cache, list, idx, w4, h4, refIdxLX, shape, scratch->mvd[list][mbPartIdx][0]);
+            }
+        }
+    }
+
+    store_motion_data(picture, cache, CurrMbAddr);
+
+    return ERR_OK;
+}
@@ -65,6 +65,46 @@ void free_nalu(void* nalu) {
     }
 }
 
+int nal_unit_header(const uint8_t* nalu_start, const uint8_t* nalu_end, NALUHeader* header) {
+    int nal_unit_header_bytes = 1;
+
+    memset(header, 0, sizeof(NALUHeader));
+    header->forbidden_zero_bit = (nalu_start[0] >> 7) & 0x01;
+    header->nal_ref_idc = (nalu_start[0] >> 5) & 0x03;
+    header->nal_unit_type = nalu_start[0] & 0x1F;
+
+    if (header->nal_unit_type == NALU_PREFIX_NALU                 /* 14 */
+        || header->nal_unit_type == NALU_CODED_SLICE_EXTENSION    /* 20 */
+        || header->nal_unit_type == NALU_CODED_SLICE_EXTENSION_DV /* 21 */
+    ) {
+        if (nalu_end - nalu_start <= 1) {
+            return ERR_EOS;
+        }
+
+        if (header->nal_unit_type != NALU_CODED_SLICE_EXTENSION_DV) {
+            header->svc_extension_flag = (uint8_t)(nalu_start[1] >> 7) & 0x01;
+        } else {
+            header->avc_3d_extension_flag = (uint8_t)(nalu_start[1] >> 7) & 0x01;
+        }
+
+        if (header->svc_extension_flag) {
+            /* TODO: */
+            /* specified in Annex F */
+            nal_unit_header_bytes += 3;
+        } else if (header->avc_3d_extension_flag) {
+            /* TODO: */
+            /* specified in Annex I */
+            nal_unit_header_bytes += 2;
+        } else {
+            /* TODO: */
+            /* specified in Annex G */
+            nal_unit_header_bytes += 3;
+        }
+    }
+
+    return nal_unit_header_bytes;
+}
+
 int hrd_parameters(RBSPReader* rbsp_reader, HRD* hrd) {
     /* @see E.2.2 HRD parameters semantics*/
     uint32_t i = 0;
@@ -0,0 +1,386 @@
+#include "h264decoder/h264_nalu_pipeline.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "h264decoder/h264_atomic.h"
+#include "h264decoder/h264_nalu_pps.h"
+#include "h264decoder/h264_nalu_slice_header.h"
+#include "h264decoder/h264_nalu_sps.h"
+#include "h264decoder/h264_rbsp.h"
+
+/* the head and the tail are written by their own thread without the mutex, and a thread sleeps only after it stores its waiting flag, see h264_atomic.h */
+
+/**
+ * @brief parse the SPS or PPS of the RBSP
+ *
+ * @param reader the reader of the RBSP, it is not advanced
+ * @param nalu_header the NAL unit header of the parameter set
+ * @param context the context whose active sps the PPS refers to
+ * @param out_parameter_set output parameter, the parameter set
+ * @return int 0 on success, negative value on error
+ */
+static int parse_parameter_set(const RBSPReader* reader, const NALUHeader* nalu_header, H264Context* context, void** out_parameter_set) {
+    RBSPReader rbsp_reader = *reader;
+    int err_code = ERR_OK;
+
+    if (nalu_header->nal_unit_type == NALU_SPS) {
+        SPS* sps = (SPS*)malloc(sizeof(SPS));
+        if (!sps) {
+            return ERR_OOM;
+        }
+        memset(sps, 0, sizeof(SPS));
+        sps->nalu_header = *nalu_header;
+
+        err_code = seq_parameter_set_rbsp(&rbsp_reader, sps);
+        if (err_code >= 0) {
+            err_code = post_process_sps(sps);
+        }
+        if (err_code < 0) {
+            free_nalu(sps);
+            return ERR_INVALID_SPS;
+        }
+        *out_parameter_set = sps;
+    } else {
+        PPS* pps = (PPS*)malloc(sizeof(PPS));
+        if (!pps) {
+            return ERR_OOM;
+        }
+        memset(pps, 0, sizeof(PPS));
+        pps->nalu_header = *nalu_header;
+
+        err_code = pic_parameter_set_rbsp(&rbsp_reader, pps, context);
+        if (err_code >= 0) {
+            err_code = post_process_pps(pps, context);
+        }
+        if (err_code < 0) {
+            free_nalu(pps);
+            return err_code;
+        }
+        *out_parameter_set = pps;
+    }
+
+    if (!is_end_valid(&rbsp_reader)) {
+        free_nalu(*out_parameter_set);
+        *out_parameter_set = 0;
+        return ERR_INVALID_RBSP;
+    }
+    return ERR_OK;
+}
+
+/**
+ * @brief parse the current NALU of the stream into the descriptor
+ */
+static void parse_descriptor(NaluPipeline* pipeline, NaluDescriptor* descriptor) {
+    H264Context* parser = pipeline->parse_context;
+    const uint8_t* nalu_start = pipeline->stream.nalu_start;
+    const uint8_t* nalu_end = pipeline->stream.nalu_end;
+
+    descriptor->nalu_start = nalu_start;
+    descriptor->nalu_end = nalu_end;
+    descriptor->first_VCL_NAL = 0;
+    descriptor->end_of_stream = 0;
+    descriptor->err_code = ERR_OK;
+
+    int nal_unit_header_bytes = nal_unit_header(nalu_start, nalu_end, &descriptor->nalu_header);
+    if (nal_unit_header_bytes < 0) {
+        descriptor->err_code = nal_unit_header_bytes;
+        return;
+    }
+
+    /* the buffer grows to the largest NALU which it holds, the thread jobs hand their buffers back to the descriptors, see decode_descriptor() */
+    size_t size = (size_t)(nalu_end - nalu_start - nal_unit_header_bytes);
+    if (size > descriptor->rbsp_capacity || !descriptor->rbsp_buffer) {
+        free(descriptor->rbsp_buffer);
+        descriptor->rbsp_capacity = 0;
+        descriptor->rbsp_buffer = (uint8_t*)malloc(size ? size : 1);
+        if (!descriptor->rbsp_buffer) {
+            descriptor->err_code = ERR_OOM;
+            return;
+        }
+        descriptor->rbsp_capacity = size;
+    }
+
+    int rbsp_len = extract_nalu_rbsp_simple(nalu_start + nal_unit_header_bytes, size, descriptor->rbsp_buffer);
+    if (rbsp_len < 0) {
+        descriptor->err_code = ERR_INVALID_RBSP;
+        return;
+    }
+    /* the bytes after the RBSP are 0 as in the buffers of parse_nalu() */
+    memset(descriptor->rbsp_buffer + rbsp_len, 0, size - rbsp_len);
+
+    RBSPReader* reader = &descriptor->reader;
+    memset(reader, 0, sizeof(RBSPReader));
+    reader->start = descriptor->rbsp_buffer;
+    reader->end = descriptor->rbsp_buffer + rbsp_len;
+    reader->current = descriptor->rbsp_buffer;
+    reader->bits_left = 8;
+
+    switch (descriptor->nalu_header.nal_unit_type) {
+        case NALU_CODED_SLICE_NON_IDR:
+        case NALU_CODED_SLICE_IDR:
+        case NALU_CODED_SLICE_AUXILIARY: {
+            SliceHeader* slice_header = 0;
+            get_slice_header(parser, &slice_header);
+            slice_header->nalu_header = descriptor->nalu_header;
+
+            if (slice_layer_without_partitioning_rbsp(reader, slice_header, parser) < 0) {
+                descriptor->err_code = ERR_INVALID_SLICE;
+                return;
+            }
+            descriptor->first_VCL_NAL = detect_first_VCL_NAL_of_primary_coded_picture(slice_header, parser->prev_slice_header);
+
+            /* the slice group maps move to the descriptor with the header */
+            reset_slice_header(&descriptor->header);
+            memcpy(&descriptor->header, slice_header, sizeof(SliceHeader));
+            slice_header->mapUnitToSliceGroupMap = 0;
+            slice_header->MbToSliceGroupMap = 0;
+            break;
+        }
+
+        case NALU_SPS:
+        case NALU_PPS: {
+            void* parameter_set = 0;
+            int err_code = parse_parameter_set(reader, &descriptor->nalu_header, parser, &parameter_set);
+            if (err_code >= 0) {
+                err_code = descriptor->nalu_header.nal_unit_type == NALU_SPS ? add_sps_to_context(parser, (SPS*)parameter_set)
+                                                                             : add_pps_to_context(parser, (PPS*)parameter_set);
+                if (err_code < 0) {
+                    free_nalu(parameter_set);
+                }
+            }
+            /* the copy of the decoding context */
+            if (err_code >= 0) {
+                err_code = parse_parameter_set(reader, &descriptor->nalu_header, parser, &descriptor->parameter_set);
+            }
+            descriptor->err_code = err_code;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief wait until the descriptor after the published ones is released by the decoding thread
+ *
+ * @return int 1 if the descriptor is free, 0 if the pipeline quits
+ */
+static int wait_for_free_descriptor(NaluPipeline* pipeline) {
+    uint32_t head = pipeline->head;
+    if (head - load_seq_cst_u32(&pipeline->tail) < H264_NALU_PIPELINE_DEPTH) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&pipeline->mutex);
+    store_seq_cst_i32(&pipeline->producer_waiting, 1);
+    while (!pipeline->quit && head - load_seq_cst_u32(&pipeline->tail) >= H264_NALU_PIPELINE_DEPTH) {
+        pthread_cond_wait(&pipeline->not_full, &pipeline->mutex);
+    }
+    store_seq_cst_i32(&pipeline->producer_waiting, 0);
+    int quit = pipeline->quit;
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    return !quit;
+}
+
+static void publish_descriptor(NaluPipeline* pipeline) {
+    store_seq_cst_u32(&pipeline->head, pipeline->head + 1);
+    if (!load_seq_cst_i32(&pipeline->consumer_waiting)) {
+        return;
+    }
+    pthread_mutex_lock(&pipeline->mutex);
+    pthread_cond_signal(&pipeline->not_empty);
+    pthread_mutex_unlock(&pipeline->mutex);
+}
+
+static void* parse_thread_main(void* arg) {
+    NaluPipeline* pipeline = (NaluPipeline*)arg;
+
+    while (wait_for_free_descriptor(pipeline)) {
+        NaluDescriptor* descriptor = &pipeline->descriptors[pipeline->head % H264_NALU_PIPELINE_DEPTH];
+
+        if (read_next_nalu(&pipeline->stream) < 0) {
+            descriptor->end_of_stream = 1;
+            publish_descriptor(pipeline);
+            break;
+        }
+
+        parse_descriptor(pipeline, descriptor);
+        publish_descriptor(pipeline);
+    }
+
+    return 0;
+}
+
+NaluPipeline* create_nalu_pipeline(uint8_t* data, size_t size) {
+    NaluPipeline* pipeline = (NaluPipeline*)malloc(sizeof(NaluPipeline));
+    if (!pipeline) {
+        return 0;
+    }
+    memset(pipeline, 0, sizeof(NaluPipeline));
+
+    pipeline->stream.start = data;
+    pipeline->stream.end = data + size;
+    pipeline->stream.nalu_start = data;
+
+    pipeline->parse_context = create_context();
+    if (!pipeline->parse_context) {
+        free(pipeline);
+        return 0;
+    }
+
+    if (pthread_mutex_init(&pipeline->mutex, 0)) {
+        free_context(pipeline->parse_context);
+        free(pipeline);
+        return 0;
+    }
+    if (pthread_cond_init(&pipeline->not_full, 0)) {
+        pthread_mutex_destroy(&pipeline->mutex);
+        free_context(pipeline->parse_context);
+        free(pipeline);
+        return 0;
+    }
+    if (pthread_cond_init(&pipeline->not_empty, 0)) {
+        pthread_cond_destroy(&pipeline->not_full);
+        pthread_mutex_destroy(&pipeline->mutex);
+        free_context(pipeline->parse_context);
+        free(pipeline);
+        return 0;
+    }
+    if (pthread_create(&pipeline->thread, 0, parse_thread_main, pipeline)) {
+        pthread_cond_destroy(&pipeline->not_empty);
+        pthread_cond_destroy(&pipeline->not_full);
+        pthread_mutex_destroy(&pipeline->mutex);
+        free_context(pipeline->parse_context);
+        free(pipeline);
+        return 0;
+    }
+
+    return pipeline;
+}
+
+void free_nalu_pipeline(NaluPipeline* pipeline) {
+    pthread_mutex_lock(&pipeline->mutex);
+    pipeline->quit = 1;
+    pthread_cond_signal(&pipeline->not_full);
+    pthread_mutex_unlock(&pipeline->mutex);
+    pthread_join(pipeline->thread, 0);
+
+    for (int32_t i = 0; i < H264_NALU_PIPELINE_DEPTH; i++) {
+        NaluDescriptor* descriptor = &pipeline->descriptors[i];
+        if (descriptor->rbsp_buffer) {
+            free(descriptor->rbsp_buffer);
+        }
+        if (descriptor->parameter_set) {
+            free_nalu(descriptor->parameter_set);
+        }
+        reset_slice_header(&descriptor->header);
+    }
+
+    free_context(pipeline->parse_context);
+    pthread_cond_destroy(&pipeline->not_empty);
+    pthread_cond_destroy(&pipeline->not_full);
+    pthread_mutex_destroy(&pipeline->mutex);
+    free(pipeline);
+}
+
+/**
+ * @brief wait until the parsing thread publishes the descriptor after the released ones
+ */
+static NaluDescriptor* wait_for_descriptor(NaluPipeline* pipeline) {
+    uint32_t tail = pipeline->tail;
+    if (load_seq_cst_u32(&pipeline->head) != tail) {
+        return &pipeline->descriptors[tail % H264_NALU_PIPELINE_DEPTH];
+    }
+
+    pthread_mutex_lock(&pipeline->mutex);
+    store_seq_cst_i32(&pipeline->consumer_waiting, 1);
+    while (load_seq_cst_u32(&pipeline->head) == tail) {
+        pthread_cond_wait(&pipeline->not_empty, &pipeline->mutex);
+    }
+    store_seq_cst_i32(&pipeline->consumer_waiting, 0);
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    return &pipeline->descriptors[tail % H264_NALU_PIPELINE_DEPTH];
+}
+
+static void release_descriptor(NaluPipeline* pipeline) {
+    store_seq_cst_u32(&pipeline->tail, pipeline->tail + 1);
+    if (!load_seq_cst_i32(&pipeline->producer_waiting)) {
+        return;
+    }
+    pthread_mutex_lock(&pipeline->mutex);
+    pthread_cond_signal(&pipeline->not_full);
+    pthread_mutex_unlock(&pipeline->mutex);
+}
+
+/**
+ * @brief decode the parsed NALU of the descriptor with the context
+ */
+static int decode_descriptor(H264Context* context, NaluDescriptor* descriptor) {
+    int err_code = ERR_OK;
+
+    switch (descriptor->nalu_header.nal_unit_type) {
+        case NALU_CODED_SLICE_NON_IDR:
+        case NALU_CODED_SLICE_IDR:
+        case NALU_CODED_SLICE_AUXILIARY: {
+            SliceHeader* slice_header = 0;
+            get_slice_header(context, &slice_header);
+            memcpy(slice_header, &descriptor->header, sizeof(SliceHeader));
+            descriptor->header.mapUnitToSliceGroupMap = 0;
+            descriptor->header.MbToSliceGroupMap = 0;
+
+            /* the parameter sets of the decoding context are the ones which the parsing thread had for the slice */
+            slice_header->pps = context->pps[slice_header->pic_parameter_set_id];
+            slice_header->sps = slice_header->pps ? context->sps[slice_header->pps->seq_parameter_set_id] : 0;
+            if (!slice_header->sps) {
+                /* the parameter set failed to be added to the decoding context */
+                return ERR_NO_SPS_PARSED;
+            }
+            context->active_pps = slice_header->pps;
+            context->active_sps = slice_header->sps;
+
+            /* the thread jobs hand back the buffers of their previous slices, the descriptor reuses them for the next NALU */
+            return decode_slice_nalu(context, slice_header, descriptor->first_VCL_NAL, &descriptor->rbsp_buffer, &descriptor->rbsp_capacity, &descriptor->reader);
+        }
+
+        case NALU_SPS:
+        case NALU_PPS: {
+            void* parameter_set = descriptor->parameter_set;
+            descriptor->parameter_set = 0;
+            err_code = descriptor->nalu_header.nal_unit_type == NALU_SPS ? add_sps_to_context(context, (SPS*)parameter_set)
+                                                                         : add_pps_to_context(context, (PPS*)parameter_set);
+            if (err_code < 0) {
+                free_nalu(parameter_set);
+            }
+            return err_code;
+        }
+
+        case NALU_END_OF_SEQUENCE:
+        case NALU_END_OF_STREAM:
+            /* the next picture is an IDR picture, so every decoded picture is output now instead of when it starts */
+            return flush_context(context);
+
+        default:
+            return ERR_OK;
+    }
+}
+
+int decode_next_nalu(NaluPipeline* pipeline, H264Context* context) {
+    NaluDescriptor* descriptor = wait_for_descriptor(pipeline);
+
+    /* the descriptor of the end of the stream is not released, the later calls report the end too */
+    if (descriptor->end_of_stream) {
+        return ERR_EOS;
+    }
+
+    int err_code = descriptor->err_code;
+    if (err_code >= 0) {
+        err_code = decode_descriptor(context, descriptor);
+    }
+    release_descriptor(pipeline);
+
+    return err_code;
+}
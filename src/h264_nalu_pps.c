@@ -4,6 +4,7 @@
 #include "h264decoder/h264_math.h"
 #include "h264decoder/h264_nalu_pps.h"
 #include "h264decoder/h264_nalu_sps.h"
+#include "h264decoder/h264_transform.h"
 
 static void free_pps(void* nalu) {
     PPS* pps = (PPS*)nalu;
@@ -309,6 +310,8 @@ int post_process_pps(PPS* pps, H264Context* context) {
         }
     }
 
+    derivation_for_level_scale(pps);
+
     return ERR_OK;
 }
 
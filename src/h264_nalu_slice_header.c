@@ -1,6 +1,7 @@
 #include "h264decoder/h264_nalu_slice_header.h"
 
 #include "h264decoder/h264_context.h"
+#include "h264decoder/h264_inter_pred.h"
 #include "h264decoder/h264_math.h"
 
 static void compute_mapUnitToSliceGroupMap(SliceHeader* header, H264Context* context) {
@@ -176,6 +177,8 @@ static int post_process_slice_header_without_partitioning(SliceHeader* header, H
     header->pps = context->active_pps;
     header->sps = context->active_sps;
 
+    derivation_for_explicit_weights(header);
+
     return ERR_OK;
 }
 
@@ -684,21 +687,29 @@ static int slice_header(RBSPReader* rbsp_reader, SliceHeader* header, H264Contex
     if (header->nalu_header.nal_unit_type == NALU_CODED_SLICE_EXTENSION || header->nalu_header.nal_unit_type == NALU_CODED_SLICE_EXTENSION_DV) {
         header->rplm_mvc = 1;
         err_code = ref_pic_list_mvc_modification(rbsp_reader, &header->rplm, header, sps, header->slice_type);
-        goto error_flag;
+        if (err_code < 0) {
+            goto error_flag;
+        }
     } else {
         header->rplm_mvc = 0;
         err_code = ref_pic_list_modification(rbsp_reader, &header->rplm, header, sps, header->slice_type);
-        goto error_flag;
+        if (err_code < 0) {
+            goto error_flag;
+        }
     }
 
     if ((pps->weighted_pred_flag && (is_slice_type_p || is_slice_type_sp)) || (pps->weighted_bipred_idc == 1 && is_slice_type_b)) {
         err_code = pred_weight_table(rbsp_reader, header, sps, pps, context);
-        goto error_flag;
+        if (err_code < 0) {
+            goto error_flag;
+        }
     }
 
     if (header->nalu_header.nal_ref_idc != 0) {
         err_code = dec_ref_pic_marking(rbsp_reader, &header->dec_ref_pic_mark, sps, idr_pic_flag);
-        goto error_flag;
+        if (err_code < 0) {
+            goto error_flag;
+        }
     }
 
     if (pps->entropy_coding_mode_flag && !is_slice_type_i && !is_slice_type_si) {
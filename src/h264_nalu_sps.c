@@ -1,5 +1,7 @@
 #include "h264decoder/h264_nalu_sps.h"
 
+#include "h264decoder/h264_math.h"
+
 static void free_sps(void* nalu) {
     SPS* sps = (SPS*)nalu;
     free(sps);
@@ -289,6 +291,57 @@ error_flag:
     return err_code;
 }
 
+/**
+ * @brief get MaxDpbMbs of the level
+ * @see Table A-1 – Level limits
+ *
+ * @param sps pointer to the sps
+ * @return uint32_t MaxDpbMbs, 0 if the level is unknown
+ */
+static uint32_t get_max_dpb_mbs(SPS* sps) {
+    switch (sps->level_idc) {
+        case 9:
+            return 396; /* level 1b */
+        case 10:
+            return 396;
+        case 11:
+            /* level 1b of the Baseline, Constrained Baseline, Main, and Extended profiles is level_idc 11 with constraint_set3_flag equal to 1 */
+            if (sps->constraint_set3_flag && (sps->profile_idc == 66 || sps->profile_idc == 77 || sps->profile_idc == 88)) {
+                return 396;
+            }
+            return 900;
+        case 12:
+        case 13:
+        case 20:
+            return 2376;
+        case 21:
+            return 4752;
+        case 22:
+        case 30:
+            return 8100;
+        case 31:
+            return 18000;
+        case 32:
+            return 20480;
+        case 40:
+        case 41:
+            return 32768;
+        case 42:
+            return 34816;
+        case 50:
+            return 110400;
+        case 51:
+        case 52:
+            return 184320;
+        case 60:
+        case 61:
+        case 62:
+            return 696320;
+        default:
+            return 0;
+    }
+}
+
 int post_process_sps(SPS* sps) {
     sps->PicWidthInMbs = sps->pic_width_in_mbs_minus1 + 1;
     sps->PicWidthInSamplesL = sps->PicWidthInMbs * 16;
@@ -353,6 +406,16 @@ int post_process_sps(SPS* sps) {
         sps->ChromaArrayType = sps->chroma_format_idc;
     }
 
+    uint32_t MaxDpbMbs = get_max_dpb_mbs(sps);
+    if (sps->vui_parameters_present_flag && sps->vui.bitstream_restriction_flag) {
+        sps->MaxDpbFrames = codec_max(sps->vui.max_dec_frame_buffering, 1);
+    } else if (MaxDpbMbs) {
+        sps->MaxDpbFrames = codec_max(MaxDpbMbs / (sps->PicWidthInMbs * sps->FrameHeightInMbs), 1);
+    } else {
+        sps->MaxDpbFrames = H264_MAX_DPB_FRAMES;
+    }
+    sps->MaxDpbFrames = codec_min(sps->MaxDpbFrames, H264_MAX_DPB_FRAMES);
+
     int32_t scaling_list_size = (sps->chroma_format_idc != 3) ? 8 : 12;
     if (!sps->seq_scaling_matrix_present_flag) {
         for (int32_t i = 0; i < scaling_list_size; i++) {
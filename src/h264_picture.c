@@ -1,5 +1,15 @@
 #include "h264decoder/h264_picture.h"
 
+#include <stddef.h>
+
+#include "h264decoder/h264_cabac.h"
+#include "h264decoder/h264_frame_thread.h"
+#include "h264decoder/h264_inter_pred.h"
+#include "h264decoder/h264_locations_neighbours.h"
+#include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_mv_pred.h"
+#include "h264decoder/h264_reconstruct.h"
+
 /**
  * @brief Get the next mb address in the same slice group
  *
@@ -23,48 +33,335 @@ static int32_t NextMbAddress(SliceHeader* header, int32_t current_addr) {
     return i;
 }
 
+/**
+ * @brief set mb_field_decoding_flag of the macroblock
+ *
+ * @param ff pointer to FrameOrField
+ * @param CurrMbAddr the current macroblock address
+ * @param mb_field_decoding_flag the mb_field_decoding_flag of the macroblock
+ */
+static void set_mb_field_decoding_flag(FrameOrField* ff, int32_t CurrMbAddr, int32_t mb_field_decoding_flag) {
+    bitset_set(ff->mb_field_flags, CurrMbAddr, mb_field_decoding_flag);
+}
+
+/**
+ * @brief record the slice which the macroblock belongs to, it is used by the availability derivation of the neighbouring macroblocks. mb_field_decoding_flag is inferred
+ * as if it is not present for both macroblocks of the macroblock pair
+ * @see 6.4.1 Derivation process for the availability of macroblock addresses
+ * @see 7.4.4 Slice data semantics
+ *
+ * @param ff pointer to FrameOrField
+ * @param header pointer to the slice header
+ * @param CurrMbAddr the current macroblock address
+ */
+static void set_macroblock_slice(FrameOrField* ff, SliceHeader* header, int32_t CurrMbAddr) {
+    store_shared_i32(&ff->mb_slice_ids[CurrMbAddr], ff->slice_count - 1);
+
+    if (!header->MbaffFrameFlag) {
+        set_mb_field_decoding_flag(ff, CurrMbAddr, header->field_pic_flag);
+        return;
+    }
+
+    /* the bottom macroblock of the pair shares the flag of the top macroblock */
+    if (CurrMbAddr % 2 == 1) {
+        set_mb_field_decoding_flag(ff, CurrMbAddr, bitset_get(ff->mb_field_flags, CurrMbAddr - 1));
+        return;
+    }
+
+    /* – if there is a neighbouring macroblock pair to the left of the current macroblock pair in the same slice, the value of mb_field_decoding_flag shall be inferred to be
+     *   equal to the value of mb_field_decoding_flag for the neighbouring macroblock pair to the left of the current macroblock pair,
+     * – otherwise, if there is a neighbouring macroblock pair above the current macroblock pair in the same slice, the value of mb_field_decoding_flag shall be inferred to be
+     *   equal to the value of mb_field_decoding_flag for the neighbouring macroblock pair above the current macroblock pair,
+     * – otherwise, the value of mb_field_decoding_flag shall be inferred to be equal to 0. */
+    int32_t mbAddrA = -1;
+    int32_t mbAddrB = -1;
+    int32_t mb_field_decoding_flag = 0;
+
+    neighbouring_mb_A_address_availability_in_MBAFF_frame(CurrMbAddr, (int32_t)header->sps->PicWidthInMbs, ff->mb_slice_ids, &mbAddrA);
+    neighbouring_mb_B_address_availability_in_MBAFF_frame(CurrMbAddr, (int32_t)header->sps->PicWidthInMbs, ff->mb_slice_ids, &mbAddrB);
+    if (mbAddrA >= 0) {
+        mb_field_decoding_flag = bitset_get(ff->mb_field_flags, mbAddrA);
+    } else if (mbAddrB >= 0) {
+        mb_field_decoding_flag = bitset_get(ff->mb_field_flags, mbAddrB);
+    }
+
+    set_mb_field_decoding_flag(ff, CurrMbAddr, mb_field_decoding_flag);
+}
+
+/**
+ * @brief set the state of a skipped macroblock. P_Skip and B_Skip have no residual, their non-zero block masks and TotalCoeff( coeff_token ) are 0
+ * @see 7.4.4 Slice data semantics
+ *
+ * @param ff pointer to FrameOrField
+ * @param header pointer to the slice header
+ * @param CurrMbAddr the current macroblock address
+ */
+static void set_skipped_macroblock(FrameOrField* ff, SliceHeader* header, int32_t CurrMbAddr) {
+    MacroBlock* mb = &ff->mb_list[CurrMbAddr];
+    int32_t is_slice_type_b = (header->slice_type % 5 == SLICE_TYPE_B);
+
+    ff->mb_skip_flags[CurrMbAddr] = 1;
+    ff->mb_type_names[CurrMbAddr] = is_slice_type_b ? B_Skip : P_Skip;
+    /* mb_qp_delta is inferred to be equal to 0 */
+    ff->mb_qps[CurrMbAddr] = (int8_t)ff->QPY_pred;
+
+    mb->mb_pred_type = is_slice_type_b ? Direct : Pred_L0;
+    mb->transform_size_8x8_flag = 0;
+    mb->coded_block_pattern = 0;
+    mb->CodedBlockPatternLuma = 0;
+    mb->CodedBlockPatternChroma = 0;
+    mb->mb_qp_delta = 0;
+
+    mb->coded_block_flags = 0;
+    mb->coded_block_flags_444 = 0;
+    mb->coded_block_flags_dc = 0;
+    memset(mb->total_coeff, 0, sizeof(mb->total_coeff));
+}
+
+/**
+ * @brief free the arrays of the reference picture lists replaced by the growth of slice_ref_lists
+ */
+static void free_retired_ref_lists(FrameOrField* ff) {
+    for (int32_t i = 0; i < ff->retired_ref_lists_count; i++) {
+        free(ff->retired_ref_lists[i]);
+        ff->retired_ref_lists[i] = 0;
+    }
+    ff->retired_ref_lists_count = 0;
+    uncharge_frame_or_field(ff, MEMORY_MB_METADATA, ff->retired_ref_lists_size);
+    ff->retired_ref_lists_size = 0;
+}
+
+/**
+ * @brief free the macroblock arrays of the frame or field
+ *
+ * @param ff pointer to FrameOrField
+ */
+static void release_frame_or_field(FrameOrField* ff) {
+    if (ff->mb_list) {
+        free(ff->mb_list);
+        ff->mb_list = 0;
+    }
+    ff->mb_list_len = 0;
+    ff->current_mb = 0;
+
+    if (ff->mb_meta_buffer) {
+        free(ff->mb_meta_buffer);
+        ff->mb_meta_buffer = 0;
+        ff->mb_slice_ids = 0;
+        ff->mb_field_flags = 0;
+        ff->mb_skip_flags = 0;
+        ff->mb_type_names = 0;
+        ff->mb_qps = 0;
+    }
+
+    if (ff->mv_buffer) {
+        free(ff->mv_buffer);
+        ff->mv_buffer = 0;
+        ff->mvs[0] = ff->mvs[1] = 0;
+        ff->ref_idxs[0] = ff->ref_idxs[1] = 0;
+        ff->mvds[0] = ff->mvds[1] = 0;
+    }
+
+    if (ff->slice_ref_lists) {
+        free(ff->slice_ref_lists);
+        ff->slice_ref_lists = 0;
+    }
+    free_retired_ref_lists(ff);
+    if (ff->slice_deblock_params) {
+        free(ff->slice_deblock_params);
+        ff->slice_deblock_params = 0;
+    }
+    ff->slice_ref_lists_capacity = 0;
+    ff->slice_count = 0;
+
+    if (ff->residuals) {
+        free_residual_store(ff->residuals);
+        ff->residuals = 0;
+    }
+
+    for (int32_t i = 0; i < H264_MEMORY_CATEGORIES; i++) {
+        uncharge_frame_or_field(ff, (MEMORY_CATEGORY)i, ff->memory[i]);
+    }
+}
+
 FrameOrField* create_frame_or_field() {
     FrameOrField* ff = (FrameOrField*)malloc(sizeof(FrameOrField));
     if (!ff) {
         return 0;
     }
     memset(ff, 0, sizeof(FrameOrField));
+    ff->decoded_mb_rows = H264_ALL_MB_ROWS;
 
     return ff;
 }
 
-int init_frame_or_field(FrameOrField* ff, SliceHeader* slice_header) {
+int charge_frame_or_field(FrameOrField* ff, MEMORY_CATEGORY category, size_t size) {
+    int err_code = charge_memory(ff->parent ? ff->parent->budget : 0, category, size);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    ff->memory[category] += size;
+    return ERR_OK;
+}
+
+void uncharge_frame_or_field(FrameOrField* ff, MEMORY_CATEGORY category, size_t size) {
+    uncharge_memory(ff->parent ? ff->parent->budget : 0, category, size);
+    ff->memory[category] -= size;
+}
+
+int alloc_frame_or_field(FrameOrField* ff, int32_t PicSizeInMbs) {
+    if (ff->mb_list && ff->mb_meta_buffer && ff->mv_buffer && ff->mb_list_len == PicSizeInMbs) {
+        return ERR_OK;
+    }
+
+    release_frame_or_field(ff);
+
+    size_t slice_ids_size = PicSizeInMbs * sizeof(int32_t);
+    size_t field_flags_size = ((PicSizeInMbs + 31) >> 5) * sizeof(uint32_t);
+    size_t meta_size = slice_ids_size + field_flags_size + 3 * PicSizeInMbs;
+
+    /* the motion vectors, the reference indices and the mvd of the 16 4x4 blocks of every macroblock for both lists */
+    size_t mvs_size = PicSizeInMbs * 32 * sizeof(int16_t);
+    size_t ref_idxs_size = PicSizeInMbs * 16;
+    size_t mvds_size = PicSizeInMbs * 32;
+    size_t mv_size = 2 * (mvs_size + ref_idxs_size + mvds_size);
+
+    /* the arrays are charged before they are allocated, so a frame or field which does not fit the budget allocates nothing */
+    int err_code = charge_frame_or_field(ff, MEMORY_MB_METADATA, PicSizeInMbs * sizeof(MacroBlock) + meta_size + mv_size);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    ff->mb_list = (MacroBlock*)malloc(PicSizeInMbs * sizeof(MacroBlock));
     if (!ff->mb_list) {
-        ff->mb_list = (MacroBlock*)malloc(slice_header->PicSizeInMbs * sizeof(MacroBlock));
-        if (!ff->mb_list) {
+        release_frame_or_field(ff);
+        return ERR_OOM;
+    }
+    memset(ff->mb_list, 0, PicSizeInMbs * sizeof(MacroBlock));
+    ff->mb_list_len = (int)PicSizeInMbs;
+    ff->current_mb = 0;
+
+    ff->mb_meta_buffer = (uint8_t*)malloc(meta_size);
+    if (!ff->mb_meta_buffer) {
+        release_frame_or_field(ff);
+        return ERR_OOM;
+    }
+
+    ff->mb_slice_ids = (int32_t*)ff->mb_meta_buffer;
+    ff->mb_field_flags = (uint32_t*)(ff->mb_meta_buffer + slice_ids_size);
+    ff->mb_skip_flags = ff->mb_meta_buffer + slice_ids_size + field_flags_size;
+    ff->mb_type_names = ff->mb_skip_flags + PicSizeInMbs;
+    ff->mb_qps = (int8_t*)(ff->mb_type_names + PicSizeInMbs);
+
+    /* -1 marks the macroblocks which are not decoded yet */
+    memset(ff->mb_slice_ids, 0xFF, slice_ids_size);
+    memset(ff->mb_field_flags, 0, field_flags_size + 3 * PicSizeInMbs);
+
+    ff->mv_buffer = (uint8_t*)malloc(mv_size);
+    if (!ff->mv_buffer) {
+        release_frame_or_field(ff);
+        return ERR_OOM;
+    }
+
+    ff->mvs[0] = (int16_t*)ff->mv_buffer;
+    ff->mvs[1] = (int16_t*)(ff->mv_buffer + mvs_size);
+    ff->mvds[0] = ff->mv_buffer + 2 * mvs_size;
+    ff->mvds[1] = ff->mvds[0] + mvds_size;
+    ff->ref_idxs[0] = (int8_t*)(ff->mvds[1] + mvds_size);
+    ff->ref_idxs[1] = ff->ref_idxs[0] + ref_idxs_size;
+
+    return ERR_OK;
+}
+
+int init_frame_or_field(FrameOrField* ff, SliceHeader* slice_header, const RefPicLists* ref_lists) {
+    /* the pictures of the pool are allocated already, it only allocates the pictures which are not from the pool */
+    int err_code = alloc_frame_or_field(ff, (int32_t)slice_header->PicSizeInMbs);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* every slice of the frame or field gets the next slice number and its own reference picture lists */
+    if (ff->slice_count >= ff->slice_ref_lists_capacity) {
+        int32_t capacity = ff->slice_ref_lists_capacity ? 2 * ff->slice_ref_lists_capacity : 8;
+        size_t added_size = (capacity - ff->slice_ref_lists_capacity) * sizeof(SliceDeblockParams) + capacity * sizeof(RefPicLists);
+
+        err_code = charge_frame_or_field(ff, MEMORY_MB_METADATA, added_size);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        /* the frame threads of the later pictures may read the lists of the decoded slices meanwhile, so the lists are copied and the previous array is kept */
+        RefPicLists* lists = (RefPicLists*)malloc(capacity * sizeof(RefPicLists));
+        if (!lists || ff->retired_ref_lists_count >= (int32_t)(sizeof(ff->retired_ref_lists) / sizeof(ff->retired_ref_lists[0]))) {
+            free(lists);
+            uncharge_frame_or_field(ff, MEMORY_MB_METADATA, added_size);
             return ERR_OOM;
         }
-        memset(ff->mb_list, 0, slice_header->PicSizeInMbs * sizeof(MacroBlock));
-        ff->mb_list_len = (int)slice_header->PicSizeInMbs;
-        ff->current_mb = 0;
+        if (ff->slice_ref_lists) {
+            memcpy(lists, ff->slice_ref_lists, ff->slice_count * sizeof(RefPicLists));
+            ff->retired_ref_lists[ff->retired_ref_lists_count++] = ff->slice_ref_lists;
+            ff->retired_ref_lists_size += ff->slice_ref_lists_capacity * sizeof(RefPicLists);
+        }
+        ff->slice_ref_lists = lists;
+
+        SliceDeblockParams* params = (SliceDeblockParams*)realloc(ff->slice_deblock_params, capacity * sizeof(SliceDeblockParams));
+        if (!params) {
+            /* the deblocking filter parameters keep the previous capacity */
+            uncharge_frame_or_field(ff, MEMORY_MB_METADATA, (capacity - ff->slice_ref_lists_capacity) * sizeof(SliceDeblockParams));
+            return ERR_OOM;
+        }
+        ff->slice_deblock_params = params;
+        ff->slice_ref_lists_capacity = capacity;
+    }
+
+    int32_t slice_type = (int32_t)(slice_header->slice_type % 5);
+    SliceDeblockParams* params = &ff->slice_deblock_params[ff->slice_count];
+    params->disable_deblocking_filter_idc = (uint8_t)slice_header->disable_deblocking_filter_idc;
+    params->is_switching_slice = slice_type == SLICE_TYPE_SP || slice_type == SLICE_TYPE_SI;
+    params->FilterOffsetA = (int8_t)(slice_header->slice_alpha_c0_offset_div2 * 2);
+    params->FilterOffsetB = (int8_t)(slice_header->slice_beta_offset_div2 * 2);
+    params->chroma_qp_index_offset[0] = (int8_t)slice_header->pps->chroma_qp_index_offset;
+    params->chroma_qp_index_offset[1] = (int8_t)slice_header->pps->second_chroma_qp_index_offset;
+    params->field_pic_flag = slice_header->field_pic_flag;
+    params->MbaffFrameFlag = (uint8_t)slice_header->MbaffFrameFlag;
+
+    if (ff->residuals && ff->residuals->active) {
+        err_code = store_reconstruct_slice(ff, ff->slice_count, slice_header, ref_lists);
+        if (err_code < 0) {
+            return err_code;
+        }
     }
 
+    ff->slice_ref_lists[ff->slice_count++] = *ref_lists;
+
     return ERR_OK;
 }
 
 void reset_frame_or_field(FrameOrField* ff) {
-    /*TODO*/
-    if (ff->mb_list) {
-        free(ff->mb_list);
-        ff->mb_list = 0;
-        ff->mb_list_len = 0;
-        ff->current_mb = 0;
+    ff->coded_type = 0;
+    ff->QPY_pred = 0;
+    ff->current_mb = 0;
+    ff->slice_count = 0;
+    ff->poc = 0;
+    ff->decoded_mb_rows = H264_ALL_MB_ROWS;
+    free_retired_ref_lists(ff);
+    if (ff->residuals) {
+        ff->residuals->active = 0;
+        ff->residuals->used = 0;
+    }
+
+    /**
+     * the other per-macroblock state is written when the macroblock is decoded, and the state of the macroblocks which are not decoded yet is never read since they are
+     * not available, so only the slice ids are reset
+     */
+    if (ff->mb_slice_ids) {
+        memset(ff->mb_slice_ids, 0xFF, ff->mb_list_len * sizeof(int32_t));
     }
 }
 
 void free_frame_or_field(FrameOrField* ff) {
-    /*TODO*/
-    if (ff->mb_list) {
-        free(ff->mb_list);
-        ff->mb_list = 0;
-        ff->mb_list_len = 0;
-        ff->current_mb = 0;
-    }
+    release_frame_or_field(ff);
     free(ff);
 }
 
@@ -93,11 +390,284 @@ Picture* create_picture() {
         return 0;
     }
 
-    /*TODO*/
+    pic->frame->parent = pic;
+    pic->top_field->parent = pic;
+    pic->bottom_field->parent = pic;
+    pic->output_latency = -1;
+    pic->pts = H264_NO_TIMESTAMP;
+    pic->dts = H264_NO_TIMESTAMP;
+
+    return pic;
+}
+
+/**
+ * @brief round the size up to a multiple of H264_PLANE_ALIGN
+ */
+static size_t align_plane_size(size_t size) { return (size + H264_PLANE_ALIGN - 1) & ~(size_t)(H264_PLANE_ALIGN - 1); }
+
+/**
+ * @brief derive the layout of a frame plane with the border on every side. the left border is rounded up so that the sample ( 0, 0 ) is aligned, and the rows above
+ * and below are doubled if the frame may be coded as fields, so that the field views have the border too
+ *
+ * @param plane the layout, data is set by the caller
+ * @param width the width of the frame in samples
+ * @param height the height of the frame in samples
+ * @param border the border in samples
+ * @param bytes_per_sample the size of a sample
+ * @param frame_mbs_only_flag frame_mbs_only_flag of the sps
+ * @param offset output parameter. the offset of the sample ( 0, 0 ) from the start of the plane in bytes
+ * @return size_t the size of the plane including the border in bytes
+ */
+static size_t derive_plane_layout(SamplePlane* plane, int32_t width, int32_t height, int32_t border, int32_t bytes_per_sample, int32_t frame_mbs_only_flag,
+                                  size_t* offset) {
+    size_t left = align_plane_size((size_t)border * bytes_per_sample);
+    size_t stride = align_plane_size(left + (size_t)(width + border) * bytes_per_sample);
+    size_t rows = (size_t)border * (2 - frame_mbs_only_flag);
+
+    /* the rows of a block map to the same cache sets if the stride is a multiple of the page size */
+    if (stride % 4096 == 0) {
+        stride += H264_PLANE_ALIGN;
+    }
+
+    *offset = rows * stride + left;
+    plane->data = 0;
+    plane->stride = (int32_t)(stride / bytes_per_sample);
+    plane->width = width;
+    plane->height = height;
+    plane->border = border;
+    plane->bytes_per_sample = bytes_per_sample;
+
+    return (height + 2 * rows) * stride;
+}
+
+/**
+ * @brief set the planes of the fields as the views of the alternate rows of the frame planes
+ *
+ * @param picture the picture, the frame planes are set
+ */
+static void set_field_planes(Picture* picture) {
+    FrameOrField* fields[2] = {picture->top_field, picture->bottom_field};
+
+    for (int32_t parity = 0; parity < 2; parity++) {
+        FrameOrField* field = fields[parity];
+        field->plane_count = picture->frame->plane_count;
+
+        for (int32_t i = 0; i < picture->frame->plane_count; i++) {
+            SamplePlane* frame_plane = &picture->frame->planes[i];
+            SamplePlane* plane = &field->planes[i];
+
+            *plane = *frame_plane;
+            plane->data = frame_plane->data + parity * frame_plane->stride * frame_plane->bytes_per_sample;
+            plane->stride = 2 * frame_plane->stride;
+            plane->height = frame_plane->height / 2;
+        }
+    }
+}
+
+/**
+ * @brief allocate the sample planes of the picture, the buffer is reallocated only if its size changes
+ *
+ * @param picture the picture
+ * @param sps the sps
+ * @param border the border of the luma planes in samples
+ * @return int 0 on success, negative value on error
+ */
+static int alloc_picture_planes(Picture* picture, SPS* sps, int32_t border) {
+    FrameOrField* frame = picture->frame;
+    int32_t width = (int32_t)sps->PicWidthInMbs * 16;
+    int32_t height = (int32_t)sps->FrameHeightInMbs * 16;
+    int32_t bytes_per_sample_y = sps->BitDepthY > 8 ? 2 : 1;
+    int32_t bytes_per_sample_c = sps->BitDepthC > 8 ? 2 : 1;
+    size_t offsets[3] = {0};
+    size_t size = 0;
+
+    memset(frame->planes, 0, sizeof(frame->planes));
+    frame->plane_count = sps->chroma_format_idc == 0 ? 1 : 3;
+
+    for (int32_t i = 0; i < frame->plane_count; i++) {
+        /* the colour planes of separate_colour_plane_flag equal to 1 are coded as monochrome pictures of the luma geometry */
+        int32_t is_luma = i == 0 || sps->separate_colour_plane_flag;
+        int32_t plane_width = is_luma ? width : (int32_t)(sps->PicWidthInMbs * sps->MbWidthC);
+        int32_t plane_height = is_luma ? height : (int32_t)(sps->FrameHeightInMbs * sps->MbHeightC);
+        /* the chroma border is scaled like the chroma width, it is at least H264_MC_CHROMA_BORDER since the luma border is at least H264_MC_LUMA_BORDER */
+        int32_t plane_border = is_luma ? border : border / sps->SubWidthC;
+
+        size_t plane_size = derive_plane_layout(&frame->planes[i], plane_width, plane_height, plane_border, is_luma ? bytes_per_sample_y : bytes_per_sample_c,
+                                                sps->frame_mbs_only_flag, &offsets[i]);
+        offsets[i] += size;
+        size += plane_size;
+    }
+
+    if (!picture->sample_alloc || picture->sample_buffer_size != size) {
+        if (picture->sample_alloc) {
+            free(picture->sample_alloc);
+            picture->sample_alloc = 0;
+            uncharge_memory(picture->budget, MEMORY_FRAME_BUFFERS, picture->sample_buffer_size + H264_PLANE_ALIGN - 1);
+        }
+        picture->sample_buffer = 0;
+        picture->sample_buffer_size = 0;
+
+        int err_code = charge_memory(picture->budget, MEMORY_FRAME_BUFFERS, size + H264_PLANE_ALIGN - 1);
+        if (err_code == ERR_OK) {
+            picture->sample_alloc = malloc(size + H264_PLANE_ALIGN - 1);
+            err_code = picture->sample_alloc ? ERR_OK : ERR_OOM;
+            if (err_code < 0) {
+                uncharge_memory(picture->budget, MEMORY_FRAME_BUFFERS, size + H264_PLANE_ALIGN - 1);
+            }
+        }
+        if (err_code < 0) {
+            memset(frame->planes, 0, sizeof(frame->planes));
+            frame->plane_count = 0;
+            return err_code;
+        }
+        picture->sample_buffer = (uint8_t*)picture->sample_alloc + (-(uintptr_t)picture->sample_alloc & (H264_PLANE_ALIGN - 1));
+        picture->sample_buffer_size = size;
+    }
+
+    for (int32_t i = 0; i < frame->plane_count; i++) {
+        frame->planes[i].data = picture->sample_buffer + offsets[i];
+    }
+
+    if (sps->frame_mbs_only_flag) {
+        memset(picture->top_field->planes, 0, sizeof(picture->top_field->planes));
+        memset(picture->bottom_field->planes, 0, sizeof(picture->bottom_field->planes));
+        picture->top_field->plane_count = picture->bottom_field->plane_count = 0;
+    } else {
+        set_field_planes(picture);
+    }
+
+    return ERR_OK;
+}
+
+/**
+ * @brief free the sample planes of the picture
+ *
+ * @param picture the picture
+ */
+static void release_picture_planes(Picture* picture) {
+    if (picture->sample_alloc) {
+        free(picture->sample_alloc);
+        picture->sample_alloc = 0;
+        uncharge_memory(picture->budget, MEMORY_FRAME_BUFFERS, picture->sample_buffer_size + H264_PLANE_ALIGN - 1);
+    }
+    picture->sample_buffer = 0;
+    picture->sample_buffer_size = 0;
+
+    FrameOrField* ffs[3] = {picture->frame, picture->top_field, picture->bottom_field};
+    for (int32_t i = 0; i < 3; i++) {
+        if (ffs[i]) {
+            memset(ffs[i]->planes, 0, sizeof(ffs[i]->planes));
+            ffs[i]->plane_count = 0;
+        }
+    }
+}
+
+void pad_frame_or_field(FrameOrField* ff) {
+    for (int32_t i = 0; i < ff->plane_count; i++) {
+        SamplePlane* plane = &ff->planes[i];
+        if (plane->bytes_per_sample == 2) {
+            pad_reference_plane16((uint16_t*)plane->data, plane->stride, plane->width, plane->height, plane->border);
+        } else {
+            pad_reference_plane(plane->data, plane->stride, plane->width, plane->height, plane->border);
+        }
+    }
+}
+
+void pad_frame_or_field_rows(FrameOrField* ff, int32_t first_row, int32_t end_row) {
+    /* the luma plane has 16 lines per macroblock row, the chroma planes MbHeightC lines */
+    int32_t PicHeightInMbs = ff->plane_count ? ff->planes[0].height / 16 : 0;
+
+    for (int32_t i = 0; i < ff->plane_count && PicHeightInMbs > 0; i++) {
+        SamplePlane* plane = &ff->planes[i];
+        int32_t lines = plane->height / PicHeightInMbs;
+        if (plane->bytes_per_sample == 2) {
+            pad_reference_lines16((uint16_t*)plane->data, plane->stride, plane->width, plane->height, plane->border, first_row * lines, end_row * lines);
+        } else {
+            pad_reference_lines(plane->data, plane->stride, plane->width, plane->height, plane->border, first_row * lines, end_row * lines);
+        }
+    }
+}
+
+int alloc_picture(Picture* picture, SPS* sps, int32_t border) {
+    int err_code = ERR_OK;
+    int32_t PicSizeInMbs = (int32_t)(sps->PicWidthInMbs * sps->FrameHeightInMbs);
+
+    err_code = alloc_frame_or_field(picture->frame, PicSizeInMbs);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* the fields are present only if frame_mbs_only_flag is equal to 0, PicHeightInMbs = FrameHeightInMbs / 2 */
+    if (sps->frame_mbs_only_flag) {
+        release_frame_or_field(picture->top_field);
+        release_frame_or_field(picture->bottom_field);
+    } else {
+        err_code = alloc_frame_or_field(picture->top_field, PicSizeInMbs / 2);
+        if (err_code < 0) {
+            return err_code;
+        }
+
+        err_code = alloc_frame_or_field(picture->bottom_field, PicSizeInMbs / 2);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    return alloc_picture_planes(picture, sps, border);
+}
+
+void init_picture_format(Picture* picture, const SPS* sps) {
+    int32_t width = (int32_t)sps->PicWidthInMbs * 16;
+    int32_t height = (int32_t)sps->FrameHeightInMbs * 16;
+
+    picture->chroma_format_idc = sps->chroma_format_idc;
+    picture->BitDepthY = sps->BitDepthY;
+    picture->BitDepthC = sps->BitDepthC;
+
+    picture->crop_left = 0;
+    picture->crop_top = 0;
+    picture->crop_width = width;
+    picture->crop_height = height;
+    if (!sps->frame_cropping_flag) {
+        return;
+    }
+
+    /* equations 7-19 to 7-22 */
+    int32_t CropUnitX = sps->ChromaArrayType == 0 ? 1 : (int32_t)sps->SubWidthC;
+    int32_t CropUnitY = (sps->ChromaArrayType == 0 ? 1 : (int32_t)sps->SubHeightC) * (2 - sps->frame_mbs_only_flag);
+    int32_t left = CropUnitX * (int32_t)sps->frame_crop_left_offset;
+    int32_t right = CropUnitX * (int32_t)sps->frame_crop_right_offset;
+    int32_t top = CropUnitY * (int32_t)sps->frame_crop_top_offset;
+    int32_t bottom = CropUnitY * (int32_t)sps->frame_crop_bottom_offset;
+
+    /* the offsets of a stream which crop the whole picture are ignored */
+    if (left + right < width && top + bottom < height) {
+        picture->crop_left = left;
+        picture->crop_top = top;
+        picture->crop_width = width - left - right;
+        picture->crop_height = height - top - bottom;
+    }
 }
 
 void reset_picture(Picture* picture) {
-    /*TODO*/
+    picture->coded_type = 0;
+    picture->decoded_fields = 0;
+    picture->is_reference = 0;
+    picture->is_idr = 0;
+    picture->has_mmco5 = 0;
+    picture->non_existing = 0;
+    picture->in_dpb = 0;
+    picture->needed_for_output = 0;
+    picture->ref_marking[0] = picture->ref_marking[1] = REF_PIC_UNUSED;
+    picture->decode_index = 0;
+    picture->output_latency = -1;
+    picture->pts = H264_NO_TIMESTAMP;
+    picture->dts = H264_NO_TIMESTAMP;
+    picture->frame_ref_count = 0;
+    picture->threads = 0;
+    picture->FrameNum = 0;
+    picture->LongTermFrameIdx = 0;
+
     if (picture->frame) {
         reset_frame_or_field(picture->frame);
     }
@@ -109,12 +679,11 @@ void reset_picture(Picture* picture) {
     if (picture->bottom_field) {
         reset_frame_or_field(picture->bottom_field);
     }
-
-    memset(picture, 0, sizeof(Picture));
 }
 
 void free_picture(Picture* picture) {
-    /*TODO*/
+    release_picture_planes(picture);
+
     if (picture->frame) {
         free_frame_or_field(picture->frame);
         picture->frame = 0;
@@ -133,6 +702,365 @@ void free_picture(Picture* picture) {
     free(picture);
 }
 
+/**
+ * @brief the bytes charged for the picture by category, the sample planes and the allocations of the frame and the fields
+ *
+ * @param picture the picture
+ * @param memory output parameter. the bytes of H264_MEMORY_CATEGORIES categories
+ */
+static void get_picture_memory(const Picture* picture, size_t* memory) {
+    const FrameOrField* ffs[3] = {picture->frame, picture->top_field, picture->bottom_field};
+
+    memset(memory, 0, H264_MEMORY_CATEGORIES * sizeof(size_t));
+    memory[MEMORY_FRAME_BUFFERS] = picture->sample_alloc ? picture->sample_buffer_size + H264_PLANE_ALIGN - 1 : 0;
+    for (int32_t i = 0; i < 3; i++) {
+        for (int32_t category = 0; category < H264_MEMORY_CATEGORIES; category++) {
+            memory[category] += ffs[i]->memory[category];
+        }
+    }
+}
+
+/**
+ * @brief the total of the bytes charged for the picture
+ */
+static size_t get_picture_memory_total(const Picture* picture) {
+    size_t memory[H264_MEMORY_CATEGORIES];
+    get_picture_memory(picture, memory);
+
+    size_t total = 0;
+    for (int32_t category = 0; category < H264_MEMORY_CATEGORIES; category++) {
+        total += memory[category];
+    }
+    return total;
+}
+
+/**
+ * @brief move the charges of the picture to another budget. the picture is charged to no budget if the new one has no room for it
+ *
+ * @param picture the picture
+ * @param budget the new budget
+ * @return int 0 on success, negative value on error. ERR_MEMORY_BUDGET_EXCEEDED if the budget has no room for the picture
+ */
+static int move_picture_memory(Picture* picture, MemoryBudget* budget) {
+    size_t memory[H264_MEMORY_CATEGORIES];
+    get_picture_memory(picture, memory);
+
+    for (int32_t category = 0; category < H264_MEMORY_CATEGORIES; category++) {
+        uncharge_memory(picture->budget, (MEMORY_CATEGORY)category, memory[category]);
+    }
+    picture->budget = 0;
+
+    for (int32_t category = 0; category < H264_MEMORY_CATEGORIES; category++) {
+        int err_code = charge_memory(budget, (MEMORY_CATEGORY)category, memory[category]);
+        if (err_code < 0) {
+            while (--category >= 0) {
+                uncharge_memory(budget, (MEMORY_CATEGORY)category, memory[category]);
+            }
+            return err_code;
+        }
+    }
+    picture->budget = budget;
+
+    return ERR_OK;
+}
+
+/**
+ * @brief hand the idle picture to the shared pool, or free it if the pool is not shared, the shared pool is full or its budget has no room for the picture
+ *
+ * @param pool the picture pool
+ * @param picture the idle picture
+ */
+static void discard_picture(PicturePool* pool, Picture* picture) {
+    SharedPicturePool* shared = pool->shared;
+    if (shared && move_picture_memory(picture, shared->budget) == ERR_OK) {
+        pthread_mutex_lock(&shared->mutex);
+        if (shared->count < H264_MAX_SHARED_PICTURES) {
+            shared->pictures[shared->count++] = picture;
+            picture = 0;
+        }
+        pthread_mutex_unlock(&shared->mutex);
+    }
+
+    if (picture) {
+        free_picture(picture);
+    }
+}
+
+/**
+ * @brief take an idle picture allocated for the geometry of the pool from the shared pool
+ *
+ * @param pool the picture pool
+ * @return Picture* the picture, 0 if the shared pool has none
+ */
+static Picture* take_shared_picture(PicturePool* pool) {
+    SharedPicturePool* shared = pool->shared;
+    Picture* picture = 0;
+    if (!shared) {
+        return 0;
+    }
+
+    int32_t PicSizeInMbs = (int32_t)(pool->PicWidthInMbs * pool->FrameHeightInMbs);
+    int32_t plane_count = pool->chroma_format_idc == 0 ? 1 : 3;
+    int32_t bytes_per_sample = pool->BitDepthY > 8 ? 2 : 1;
+
+    pthread_mutex_lock(&shared->mutex);
+    for (int32_t i = shared->count - 1; i >= 0; i--) {
+        Picture* pic = shared->pictures[i];
+        const FrameOrField* frame = pic->frame;
+        /* the pictures of another geometry would be reallocated, they are left for the streams of their geometry */
+        if (frame->mb_list_len == PicSizeInMbs && (pic->top_field->mb_list_len != 0) == !pool->frame_mbs_only_flag && frame->plane_count == plane_count &&
+            frame->planes[0].width == (int32_t)pool->PicWidthInMbs * 16 && frame->planes[0].border == pool->border &&
+            frame->planes[0].bytes_per_sample == bytes_per_sample) {
+            picture = pic;
+            shared->pictures[i] = shared->pictures[--shared->count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&shared->mutex);
+
+    /* the picture is charged to the pool which takes it, it is freed if the pool has no room for it */
+    if (picture && move_picture_memory(picture, pool->budget) < 0) {
+        free_picture(picture);
+        picture = 0;
+    }
+
+    return picture;
+}
+
+/**
+ * @brief free the idle pictures which do not fit the pool any more, the pictures of a previous geometry or of the slots beyond the size
+ *
+ * @param pool the picture pool
+ */
+static void free_stale_pictures(PicturePool* pool) {
+    for (int i = 0; i < H264_MAX_POOL_PICTURES; i++) {
+        Picture* pic = pool->pictures[i];
+        if (pic && pic->ref_count == 0 && (pic->pool_generation != pool->generation || i >= pool->size)) {
+            discard_picture(pool, pic);
+            pool->pictures[i] = 0;
+        }
+    }
+}
+
+int init_picture_pool(PicturePool* pool, SPS* sps) {
+    int32_t border = pool->requested_border ? pool->requested_border : H264_PLANE_BORDER;
+    int is_resized = pool->PicWidthInMbs != sps->PicWidthInMbs || pool->FrameHeightInMbs != sps->FrameHeightInMbs || pool->frame_mbs_only_flag != sps->frame_mbs_only_flag ||
+                     pool->chroma_format_idc != sps->chroma_format_idc || pool->separate_colour_plane_flag != sps->separate_colour_plane_flag ||
+                     pool->BitDepthY != sps->BitDepthY || pool->BitDepthC != sps->BitDepthC || pool->border != border;
+
+    if (is_resized) {
+        /* the pictures of the previous resolution, sample format or border are not reused */
+        pool->generation++;
+        pool->PicWidthInMbs = sps->PicWidthInMbs;
+        pool->FrameHeightInMbs = sps->FrameHeightInMbs;
+        pool->frame_mbs_only_flag = sps->frame_mbs_only_flag;
+        pool->chroma_format_idc = sps->chroma_format_idc;
+        pool->separate_colour_plane_flag = sps->separate_colour_plane_flag;
+        pool->BitDepthY = sps->BitDepthY;
+        pool->BitDepthC = sps->BitDepthC;
+        pool->border = border;
+        pool->picture_memory = 0;
+    }
+
+    /* the slots added by grow_picture_pool() are kept for the pictures of the same geometry */
+    int size = 2 * get_dpb_frame_count(sps) + 1;
+    pool->size = is_resized ? size : codec_max(pool->size, size);
+    free_stale_pictures(pool);
+
+    return ERR_OK;
+}
+
+int set_picture_pool_border(PicturePool* pool, int32_t border) {
+    if (border < H264_MC_LUMA_BORDER || border > H264_PLANE_MAX_BORDER) {
+        return ERR_INVALID_PARAM;
+    }
+
+    pool->requested_border = border;
+    return ERR_OK;
+}
+
+int grow_picture_pool(PicturePool* pool) {
+    if (pool->size >= H264_MAX_POOL_PICTURES) {
+        return ERR_PICTURE_POOL_EXHAUSTED;
+    }
+
+    pool->size++;
+    return ERR_OK;
+}
+
+/**
+ * @brief take a picture of the geometry of the pool from the shared pool, or create one, and allocate it for the SPS
+ *
+ * @param pool the picture pool
+ * @param sps the active sps
+ * @param out_picture output parameter. the picture, charged to the budget of the pool
+ * @return int 0 on success, negative value on error
+ */
+static int allocate_pool_picture(PicturePool* pool, SPS* sps, Picture** out_picture) {
+    Picture* pic = take_shared_picture(pool);
+    if (pic) {
+        reset_picture(pic);
+    } else {
+        pic = create_picture();
+        if (!pic) {
+            return ERR_OOM;
+        }
+        pic->budget = pool->budget;
+    }
+
+    int err_code = alloc_picture(pic, sps, pool->border);
+    if (err_code < 0) {
+        free_picture(pic);
+        return err_code;
+    }
+
+    *out_picture = pic;
+    return ERR_OK;
+}
+
+int get_picture_from_pool(PicturePool* pool, SPS* sps, Picture** out_picture) {
+    int err_code = ERR_OK;
+    int free_slot = -1;
+
+    if (pool->size <= 0) {
+        return ERR_INVALID_PARAM;
+    }
+
+    for (int i = 0; i < pool->size; i++) {
+        Picture* pic = pool->pictures[i];
+        if (!pic) {
+            free_slot = free_slot < 0 ? i : free_slot;
+            continue;
+        }
+
+        if (pic->ref_count == 0 && pic->pool_generation == pool->generation) {
+            reset_picture(pic);
+            pic->ref_count = 1;
+            *out_picture = pic;
+            return ERR_OK;
+        }
+    }
+
+    if (free_slot < 0) {
+        return ERR_PICTURE_POOL_EXHAUSTED;
+    }
+
+    Picture* pic = 0;
+    err_code = allocate_pool_picture(pool, sps, &pic);
+    /* the idle pictures of the shared pool give way to the pictures in use */
+    if (err_code == ERR_MEMORY_BUDGET_EXCEEDED && trim_shared_picture_pool(pool->shared) > 0) {
+        err_code = allocate_pool_picture(pool, sps, &pic);
+    }
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* the identifiers are unique among the pictures of the pool since they are derived from the slot */
+    pic->frame->ref_pic_id = 3 * free_slot;
+    pic->top_field->ref_pic_id = 3 * free_slot + 1;
+    pic->bottom_field->ref_pic_id = 3 * free_slot + 2;
+    pic->pool_index = free_slot;
+    pic->pool_generation = pool->generation;
+    pic->ref_count = 1;
+    pool->pictures[free_slot] = pic;
+    pool->picture_memory = codec_max(pool->picture_memory, get_picture_memory_total(pic));
+
+    *out_picture = pic;
+    return ERR_OK;
+}
+
+int has_picture_pool_room(PicturePool* pool, int can_grow) {
+    int has_free_slot = can_grow && pool->size < H264_MAX_POOL_PICTURES;
+
+    for (int i = 0; i < pool->size; i++) {
+        Picture* pic = pool->pictures[i];
+        if (!pic) {
+            has_free_slot = 1;
+        } else if (pic->ref_count == 0 && pic->pool_generation == pool->generation) {
+            return 1;
+        }
+    }
+
+    if (!has_free_slot) {
+        return 0;
+    }
+    if (get_memory_room(pool->budget) >= pool->picture_memory) {
+        return 1;
+    }
+    return trim_shared_picture_pool(pool->shared) > 0 && get_memory_room(pool->budget) >= pool->picture_memory;
+}
+
+void detach_pool_picture(PicturePool* pool, Picture* picture) {
+    pool->pictures[picture->pool_index] = 0;
+    move_picture_memory(picture, 0);
+}
+
+void release_picture(PicturePool* pool, Picture* picture) {
+    if (--picture->ref_count > 0) {
+        return;
+    }
+
+    if (picture->pool_generation != pool->generation || picture->pool_index >= pool->size) {
+        pool->pictures[picture->pool_index] = 0;
+        discard_picture(pool, picture);
+        return;
+    }
+
+    /* the residual records are allocated once the picture is reconstructed, so the size of a picture is known when it becomes idle */
+    pool->picture_memory = codec_max(pool->picture_memory, get_picture_memory_total(picture));
+}
+
+void free_picture_pool(PicturePool* pool) {
+    /* the border, the shared pool and the budget are settings of the pool, they are kept for the pictures allocated later */
+    int32_t requested_border = pool->requested_border;
+    SharedPicturePool* shared = pool->shared;
+    MemoryBudget* budget = pool->budget;
+
+    for (int i = 0; i < H264_MAX_POOL_PICTURES; i++) {
+        if (pool->pictures[i]) {
+            discard_picture(pool, pool->pictures[i]);
+            pool->pictures[i] = 0;
+        }
+    }
+
+    memset(pool, 0, sizeof(PicturePool));
+    pool->requested_border = requested_border;
+    pool->shared = shared;
+    pool->budget = budget;
+}
+
+int init_shared_picture_pool(SharedPicturePool* shared) {
+    memset(shared, 0, sizeof(SharedPicturePool));
+    if (pthread_mutex_init(&shared->mutex, 0) != 0) {
+        return ERR_OOM;
+    }
+
+    return ERR_OK;
+}
+
+int32_t trim_shared_picture_pool(SharedPicturePool* shared) {
+    Picture* pictures[H264_MAX_SHARED_PICTURES];
+    if (!shared) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&shared->mutex);
+    int32_t count = shared->count;
+    memcpy(pictures, shared->pictures, count * sizeof(Picture*));
+    shared->count = 0;
+    pthread_mutex_unlock(&shared->mutex);
+
+    for (int32_t i = 0; i < count; i++) {
+        free_picture(pictures[i]);
+    }
+    return count;
+}
+
+void free_shared_picture_pool(SharedPicturePool* shared) {
+    trim_shared_picture_pool(shared);
+    pthread_mutex_destroy(&shared->mutex);
+}
+
 /* 7.4.1.2.4 Detection of the first VCL NAL unit of a primary coded picture */
 int detect_first_VCL_NAL_of_primary_coded_picture(SliceHeader* current, SliceHeader* prev) {
     /* 7.4.3 Slice header semantics When present, the value of the slice header syntax elements pic_parameter_set_id, frame_num, field_pic_flag, bottom_field_flag, idr_pic_id,
@@ -212,7 +1140,23 @@ int detect_first_VCL_NAL_of_primary_coded_picture(SliceHeader* current, SliceHea
     return 0;
 }
 
-int slice_data(FrameOrField* ff, RBSPReader* rbsp_reader, SliceHeader* header) {
+/**
+ * @brief the macroblock is decoded. its residual is packed if the frame or field is reconstructed, and on a frame thread the last macroblock of a row reconstructs
+ * the row and publishes the decoded rows to the later pictures
+ */
+static inline void finish_macroblock(FrameOrField* ff, SliceHeader* header, int32_t CurrMbAddr) {
+    if (ff->residuals && ff->residuals->active) {
+        pack_macroblock_residual(ff, CurrMbAddr);
+    }
+    if (ff->parent && ff->parent->threads) {
+        report_decoded_macroblock(ff, header, CurrMbAddr);
+    }
+}
+
+/**
+ * @brief decode the slice data with the macroblock scratch attached to the frame or field, see slice_data()
+ */
+static int decode_slice_data(FrameOrField* ff, RBSPReader* rbsp_reader, SliceHeader* header) {
     /* @see 7.3.4 Slice data syntax */
     /* @see 7.4.4 Slice data semantics */
 
@@ -224,8 +1168,8 @@ int slice_data(FrameOrField* ff, RBSPReader* rbsp_reader, SliceHeader* header) {
     int32_t is_slice_type_i = (header->slice_type % 5 == SLICE_TYPE_I);
     int32_t is_slice_type_si = (header->slice_type % 5 == SLICE_TYPE_SI);
 
-    /* get the global singleton CABAC object */
-    CABAC* cabac = get_singleton_cabac();
+    /* the decoding engine of the thread decoding the slice */
+    CABAC* cabac = &ff->mb_scratch->cabac;
 
     uint8_t entropy_coding_mode_flag = pps->entropy_coding_mode_flag;
     if (entropy_coding_mode_flag) {
@@ -247,6 +1191,14 @@ int slice_data(FrameOrField* ff, RBSPReader* rbsp_reader, SliceHeader* header) {
 
     int32_t CurrMbAddr = header->first_mb_in_slice * (1 + header->MbaffFrameFlag);
     int32_t moreDataFlag = 1;
+
+    /* the rows of the frame or field are complete when their last macroblock is decoded only if every slice starts where the previous one ends */
+    if (CurrMbAddr != ff->current_mb) {
+        ff->current_mb = -1;
+    }
+
+    /* 7.4.5: QPY,PRED is SliceQPY for the first macroblock in the slice */
+    ff->QPY_pred = header->SliceQPY;
     int32_t prevMbSkipped = 0;
 
     uint32_t mb_skip_run = 0;
@@ -259,22 +1211,46 @@ int slice_data(FrameOrField* ff, RBSPReader* rbsp_reader, SliceHeader* header) {
                 mb_skip_run = read_ue(rbsp_reader);
                 prevMbSkipped = (mb_skip_run > 0);
                 for (uint32_t i = 0; i < mb_skip_run; i++) {
+                    set_macroblock_slice(ff, header, CurrMbAddr);
+                    set_skipped_macroblock(ff, header, CurrMbAddr);
+
+                    init_mv_cache(ff, header, CurrMbAddr);
+                    err_code = derivation_for_motion_vectors(ff, header, CurrMbAddr);
+                    if (err_code < 0) {
+                        return err_code;
+                    }
+                    finish_macroblock(ff, header, CurrMbAddr);
+
                     CurrMbAddr = NextMbAddress(header, CurrMbAddr);
                 }
                 if (mb_skip_run > 0) {
                     moreDataFlag = more_rbsp_data(rbsp_reader);
                 }
             } else {
+                set_macroblock_slice(ff, header, CurrMbAddr);
+
                 err_code = cabac_mb_skip_flag(rbsp_reader, cabac, ff, header, CurrMbAddr, &mb_skip_flag);
                 if (err_code < 0) {
                     return err_code;
                 }
 
                 moreDataFlag = !mb_skip_flag;
+                if (mb_skip_flag) {
+                    set_skipped_macroblock(ff, header, CurrMbAddr);
+
+                    init_mv_cache(ff, header, CurrMbAddr);
+                    err_code = derivation_for_motion_vectors(ff, header, CurrMbAddr);
+                    if (err_code < 0) {
+                        return err_code;
+                    }
+                    finish_macroblock(ff, header, CurrMbAddr);
+                }
             }
         }
 
         if (moreDataFlag) {
+            set_macroblock_slice(ff, header, CurrMbAddr);
+
             if (header->MbaffFrameFlag && (CurrMbAddr % 2 == 0 || (CurrMbAddr % 2 == 1 && prevMbSkipped))) {
                 uint32_t mb_field_decoding_flag;
                 if (entropy_coding_mode_flag) {
@@ -285,12 +1261,19 @@ int slice_data(FrameOrField* ff, RBSPReader* rbsp_reader, SliceHeader* header) {
                 } else {
                     mb_field_decoding_flag = read_u(rbsp_reader, 1);
                 }
+
+                set_mb_field_decoding_flag(ff, CurrMbAddr, (int32_t)mb_field_decoding_flag);
+                /* the skipped top macroblock of the pair uses the flag decoded for the bottom macroblock */
+                if (CurrMbAddr % 2 == 1) {
+                    set_mb_field_decoding_flag(ff, CurrMbAddr - 1, (int32_t)mb_field_decoding_flag);
+                }
             }
 
             err_code = macroblock_layer(rbsp_reader, ff, header, cabac, CurrMbAddr);
             if (err_code < 0) {
                 return err_code;
             }
+            finish_macroblock(ff, header, CurrMbAddr);
         }
 
         if (!entropy_coding_mode_flag) {
@@ -314,38 +1297,57 @@ int slice_data(FrameOrField* ff, RBSPReader* rbsp_reader, SliceHeader* header) {
         CurrMbAddr = NextMbAddress(header, CurrMbAddr);
     } while (moreDataFlag);
 
+    if (ff->current_mb >= 0) {
+        ff->current_mb = CurrMbAddr;
+    }
+    if (ff->residuals && ff->residuals->active) {
+        report_packed_slice(ff);
+    }
+
 error_flag:
-    if (cabac) {
-        free(cabac);
+    return err_code;
+}
+
+void set_picture_structure(Picture* picture, const SliceHeader* header) {
+    if (!header->field_pic_flag) {
+        picture->coded_type = PICTURE_CODED_FRAME;
+        picture->decoded_fields = 3;
+        return;
+    }
+
+    /* the second field of the frame store makes it a complementary field pair */
+    picture->decoded_fields |= header->bottom_field_flag ? 2 : 1;
+    if (picture->decoded_fields == 3) {
+        picture->coded_type = PICTURE_CODED_COMPLEMENTARY_FIELD_PAIR;
+    } else {
+        picture->coded_type = header->bottom_field_flag ? PICTURE_CODED_BOTTOM_FIELD : PICTURE_CODED_TOP_FIELD;
     }
+}
+
+int slice_data(FrameOrField* ff, MacroBlockScratch* scratch, RBSPReader* rbsp_reader, SliceHeader* header) {
+    /* the scratch belongs to the decoding thread, the frame or field refers to it only while the slice is decoded */
+    ff->mb_scratch = scratch;
+    int err_code = decode_slice_data(ff, rbsp_reader, header);
+    ff->mb_scratch = 0;
 
     return err_code;
 }
 
-int decode_slice(Picture* picture, RBSPReader* rbsp_reader, SliceHeader* header) {
+int decode_slice(Picture* picture, MacroBlockScratch* scratch, RBSPReader* rbsp_reader, SliceHeader* header, const RefPicLists* ref_lists) {
     /* @see 7.3.4 Slice data syntax */
     /* @see 7.4.4 Slice data semantics */
     int err_code = ERR_OK;
 
-    if (!header->field_pic_flag) { /* frame */
-        picture->coded_type = PICTURE_CODED_FRAME;
-
-        err_code = init_frame_or_field(picture->frame, header);
-        if (err_code < 0) {
-            return err_code;
-        }
-        err_code = slice_data(picture->frame, rbsp_reader, header);
-    } else {
-        picture->coded_type = PICTURE_CODED_COMPLEMENTARY_FIELD_PAIR;
+    /* the frame or field of the slice, the structure of the picture is set by set_picture_structure() */
+    FrameOrField* ff = picture->frame;
+    if (header->field_pic_flag) {
+        ff = header->bottom_field_flag ? picture->bottom_field : picture->top_field;
+    }
 
-        if (header->bottom_field_flag) { /* bottom field*/
-            picture->coded_type = PICTURE_CODED_BOTTOM_FIELD;
-            err_code = slice_data(picture->bottom_field, rbsp_reader, header);
-        } else { /* top field */
-            picture->coded_type = PICTURE_CODED_TOP_FIELD;
-            err_code = slice_data(picture->bottom_field, rbsp_reader, header);
-        }
+    err_code = init_frame_or_field(ff, header, ref_lists);
+    if (err_code < 0) {
+        return err_code;
     }
 
-    return err_code;
-}
\ No newline at end of file
+    return slice_data(ff, scratch, rbsp_reader, header);
+}
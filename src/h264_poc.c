@@ -0,0 +1,193 @@
+#include "h264decoder/h264_poc.h"
+
+#include "h264decoder/h264_math.h"
+
+/**
+ * @brief the slice header of a reference picture has memory_management_control_operation equal to 5
+ */
+static int has_mmco5(const SliceHeader* header) {
+    const DecRefPicMark* marking = &header->dec_ref_pic_mark;
+
+    if (!header->nalu_header.nal_ref_idc || header->nalu_header.IdrPicFlag || !marking->adaptive_ref_pic_marking_mode_flag) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < marking->mmco_len; i++) {
+        if (marking->mmco[i].memory_management_control_operation == 5) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief set the poc of the fields which the slice header codes and PicOrderCnt( ) of the frame, Min( TopFieldOrderCnt, BottomFieldOrderCnt ) of the decoded fields
+ * @see 8.2.1 equation 8-1
+ */
+static void set_picture_order_count(Picture* picture, const SliceHeader* header, int32_t TopFieldOrderCnt, int32_t BottomFieldOrderCnt) {
+    if (!header->field_pic_flag) {
+        picture->top_field->poc = TopFieldOrderCnt;
+        picture->bottom_field->poc = BottomFieldOrderCnt;
+        picture->frame->poc = codec_min(TopFieldOrderCnt, BottomFieldOrderCnt);
+        return;
+    }
+
+    /* decoded_fields holds the first field while the second field is started */
+    if (header->bottom_field_flag) {
+        picture->bottom_field->poc = BottomFieldOrderCnt;
+        picture->frame->poc = (picture->decoded_fields & 1) ? codec_min(picture->top_field->poc, BottomFieldOrderCnt) : BottomFieldOrderCnt;
+    } else {
+        picture->top_field->poc = TopFieldOrderCnt;
+        picture->frame->poc = (picture->decoded_fields & 2) ? codec_min(TopFieldOrderCnt, picture->bottom_field->poc) : TopFieldOrderCnt;
+    }
+}
+
+/**
+ * @brief FrameNumOffset of pic_order_cnt_type 1 and 2, equations 8-6 and 8-11
+ */
+static int32_t frame_num_offset(const PicOrderCntState* state, const SPS* sps, const SliceHeader* header) {
+    if (header->nalu_header.IdrPicFlag) {
+        return 0;
+    }
+    if (state->prevFrameNum > (int32_t)header->frame_num) {
+        return state->prevFrameNumOffset + (int32_t)sps->MaxFrameNum;
+    }
+    return state->prevFrameNumOffset;
+}
+
+int decode_picture_order_count(PicOrderCntState* state, SPS* sps, SliceHeader* header, Picture* picture) {
+    int32_t TopFieldOrderCnt = 0;
+    int32_t BottomFieldOrderCnt = 0;
+    int32_t nal_ref_idc = header->nalu_header.nal_ref_idc;
+
+    switch (sps->pic_order_cnt_type) {
+        case 0: {
+            /* 8.2.1.1 the previous reference picture of an IDR picture is inferred with PicOrderCntMsb and pic_order_cnt_lsb equal to 0 */
+            int32_t prevPicOrderCntMsb = header->nalu_header.IdrPicFlag ? 0 : state->prevPicOrderCntMsb;
+            int32_t prevPicOrderCntLsb = header->nalu_header.IdrPicFlag ? 0 : state->prevPicOrderCntLsb;
+            int32_t MaxPicOrderCntLsb = (int32_t)sps->MaxPicOrderCntLsb;
+            int32_t pic_order_cnt_lsb = (int32_t)header->pic_order_cnt_lsb;
+
+            /* equation 8-3 */
+            if (pic_order_cnt_lsb < prevPicOrderCntLsb && prevPicOrderCntLsb - pic_order_cnt_lsb >= MaxPicOrderCntLsb / 2) {
+                state->PicOrderCntMsb = prevPicOrderCntMsb + MaxPicOrderCntLsb;
+            } else if (pic_order_cnt_lsb > prevPicOrderCntLsb && pic_order_cnt_lsb - prevPicOrderCntLsb > MaxPicOrderCntLsb / 2) {
+                state->PicOrderCntMsb = prevPicOrderCntMsb - MaxPicOrderCntLsb;
+            } else {
+                state->PicOrderCntMsb = prevPicOrderCntMsb;
+            }
+
+            /* equations 8-4 and 8-5 */
+            TopFieldOrderCnt = state->PicOrderCntMsb + pic_order_cnt_lsb;
+            if (!header->field_pic_flag) {
+                BottomFieldOrderCnt = TopFieldOrderCnt + header->delta_pic_order_cnt_bottom;
+            } else {
+                BottomFieldOrderCnt = state->PicOrderCntMsb + pic_order_cnt_lsb;
+            }
+            break;
+        }
+
+        case 1: {
+            /* 8.2.1.2 */
+            int32_t num_ref_frames_in_pic_order_cnt_cycle = (int32_t)sps->num_ref_frames_in_pic_order_cnt_cycle;
+            int32_t expectedPicOrderCnt = 0;
+            int32_t absFrameNum = 0;
+
+            state->FrameNumOffset = frame_num_offset(state, sps, header);
+
+            /* equation 8-7 */
+            if (num_ref_frames_in_pic_order_cnt_cycle != 0) {
+                absFrameNum = state->FrameNumOffset + (int32_t)header->frame_num;
+            }
+            if (nal_ref_idc == 0 && absFrameNum > 0) {
+                absFrameNum = absFrameNum - 1;
+            }
+
+            /* equations 8-8 to 8-10 */
+            if (absFrameNum > 0) {
+                int32_t picOrderCntCycleCnt = (absFrameNum - 1) / num_ref_frames_in_pic_order_cnt_cycle;
+                int32_t frameNumInPicOrderCntCycle = (absFrameNum - 1) % num_ref_frames_in_pic_order_cnt_cycle;
+
+                expectedPicOrderCnt = picOrderCntCycleCnt * (int32_t)sps->ExpectedDeltaPerPicOrderCntCycle;
+                for (int32_t i = 0; i <= frameNumInPicOrderCntCycle; i++) {
+                    expectedPicOrderCnt += sps->offset_for_ref_frame[i];
+                }
+            }
+            if (nal_ref_idc == 0) {
+                expectedPicOrderCnt += sps->offset_for_non_ref_pic;
+            }
+
+            /* equation 8-10 */
+            if (!header->field_pic_flag) {
+                TopFieldOrderCnt = expectedPicOrderCnt + header->delta_pic_order_cnt[0];
+                BottomFieldOrderCnt = TopFieldOrderCnt + sps->offset_for_top_to_bottom_field + header->delta_pic_order_cnt[1];
+            } else if (!header->bottom_field_flag) {
+                TopFieldOrderCnt = expectedPicOrderCnt + header->delta_pic_order_cnt[0];
+            } else {
+                BottomFieldOrderCnt = expectedPicOrderCnt + sps->offset_for_top_to_bottom_field + header->delta_pic_order_cnt[0];
+            }
+            break;
+        }
+
+        case 2: {
+            /* 8.2.1.3 the output order is the decoding order */
+            int32_t tempPicOrderCnt = 0;
+
+            state->FrameNumOffset = frame_num_offset(state, sps, header);
+
+            /* equation 8-12 */
+            if (!header->nalu_header.IdrPicFlag) {
+                tempPicOrderCnt = 2 * (state->FrameNumOffset + (int32_t)header->frame_num) - (nal_ref_idc == 0);
+            }
+
+            /* equation 8-13 */
+            TopFieldOrderCnt = tempPicOrderCnt;
+            BottomFieldOrderCnt = tempPicOrderCnt;
+            break;
+        }
+
+        default:
+            return ERR_INVALID_PARAM;
+    }
+
+    set_picture_order_count(picture, header, TopFieldOrderCnt, BottomFieldOrderCnt);
+
+    return ERR_OK;
+}
+
+void update_picture_order_count(PicOrderCntState* state, SPS* sps, SliceHeader* header, Picture* picture) {
+    int mmco5 = has_mmco5(header);
+
+    if (mmco5) {
+        /* tempPicOrderCnt is PicOrderCnt( CurrPic ), the counts of the frame or field become relative to it */
+        if (!header->field_pic_flag) {
+            int32_t tempPicOrderCnt = picture->frame->poc;
+            picture->top_field->poc -= tempPicOrderCnt;
+            picture->bottom_field->poc -= tempPicOrderCnt;
+            set_picture_order_count(picture, header, picture->top_field->poc, picture->bottom_field->poc);
+        } else {
+            set_picture_order_count(picture, header, 0, 0);
+        }
+    }
+
+    if (sps->pic_order_cnt_type == 0) {
+        /* 8.2.1.1 prevPicOrderCntMsb and prevPicOrderCntLsb are of the previous reference picture */
+        if (!header->nalu_header.nal_ref_idc) {
+            return;
+        }
+
+        if (mmco5) {
+            state->prevPicOrderCntMsb = 0;
+            state->prevPicOrderCntLsb = header->field_pic_flag && header->bottom_field_flag ? 0 : picture->top_field->poc;
+        } else {
+            state->prevPicOrderCntMsb = state->PicOrderCntMsb;
+            state->prevPicOrderCntLsb = (int32_t)header->pic_order_cnt_lsb;
+        }
+        return;
+    }
+
+    /* 8.2.1.2 and 8.2.1.3 prevFrameNumOffset is of the previous picture, the picture with memory_management_control_operation equal to 5 is inferred to have had
+     * frame_num equal to 0 */
+    state->prevFrameNumOffset = mmco5 ? 0 : state->FrameNumOffset;
+    state->prevFrameNum = mmco5 ? 0 : (int32_t)header->frame_num;
+}
@@ -2,7 +2,7 @@
 
 /* Table 9-4 – Assignment of codeNum to values of coded_block_pattern for macroblock prediction modes (a) ChromaArrayType is equal to 1 or 2 */
 /* 0: codeNum, 1: coded_block_pattern value for Intra_4x4 or Intra_8x8, 2: coded_block_pattern value for Inter*/
-static int32_t g_coded_block_pattern_ChromaArrayType_1_2[48][3] = {
+static const int32_t g_coded_block_pattern_ChromaArrayType_1_2[48][3] = {
     {0, 47, 0},   {1, 31, 16},  {2, 15, 1},   {3, 0, 2},    {4, 23, 4},   {5, 27, 8},   {6, 29, 32},  {7, 30, 3},   {8, 7, 5},    {9, 11, 10},  {10, 13, 12}, {11, 14, 15},
     {12, 39, 47}, {13, 43, 7},  {14, 45, 11}, {15, 46, 13}, {16, 16, 14}, {17, 3, 6},   {18, 5, 9},   {19, 10, 31}, {20, 12, 35}, {21, 19, 37}, {22, 21, 42}, {23, 26, 44},
     {24, 28, 33}, {25, 35, 34}, {26, 37, 36}, {27, 42, 40}, {28, 44, 39}, {29, 1, 43},  {30, 2, 45},  {31, 4, 46},  {32, 8, 17},  {33, 17, 18}, {34, 18, 20}, {35, 20, 24},
@@ -11,7 +11,7 @@ static int32_t g_coded_block_pattern_ChromaArrayType_1_2[48][3] = {
 
 /* Table 9-4 – Assignment of codeNum to values of coded_block_pattern for macroblock prediction modes (b) ChromaArrayType is equal to 0 or 3 */
 /* 0: codeNum, 1: coded_block_pattern value for Intra_4x4 or Intra_8x8, 2: coded_block_pattern value for Inter*/
-static int32_t g_coded_block_pattern_ChromaArrayType_0_3[16][3] = {
+static const int32_t g_coded_block_pattern_ChromaArrayType_0_3[16][3] = {
     {0,  15,   0},
     {1,  0,   1},
     {2,  7,   2},
@@ -158,13 +158,10 @@ inline void read_byte_aligned_pointer(RBSPReader* reader, uint8_t** ptr, int* le
 }
 
 inline void skip_n_bits(RBSPReader* reader, int n) {
-    int i = 0;
-    for (i = 0; i < n; ++i) {
-        if (0 == (--reader->bits_left)) {
-            reader->current++;
-            reader->bits_left = 8;
-        }
-    }
+    int consumed_bits = 8 - reader->bits_left + n;
+
+    reader->current += consumed_bits >> 3;
+    reader->bits_left = 8 - (consumed_bits & 0x07);
 }
 
 inline uint32_t read_f(RBSPReader* reader, int n) { return read_u(reader, n); }
@@ -255,18 +252,19 @@ int32_t read_me(RBSPReader* reader, int32_t ChromaArrayType, H264_MB_PART_PRED_M
     uint32_t codeNum = read_ue(reader);
     if(ChromaArrayType == 1 || ChromaArrayType == 2){
         if(codeNum <= 47){
+            /* the inter macroblocks have the prediction modes Pred_L0, Pred_L1, BiPred, Direct or Pred_NA of the sub-macroblock types */
             if(pred_mode == Intra_4x4 || pred_mode == Intra_8x8){
-                coded_block_pattern = g_coded_block_pattern_ChromaArrayType_1_2[codeNum][0];
-            }else if(pred_mode == Inter){
                 coded_block_pattern = g_coded_block_pattern_ChromaArrayType_1_2[codeNum][1];
+            }else if(pred_mode != Intra_16x16 && pred_mode != Intra_NA){
+                coded_block_pattern = g_coded_block_pattern_ChromaArrayType_1_2[codeNum][2];
             }
         }
     }else if(ChromaArrayType == 0 || ChromaArrayType == 3){
         if(codeNum <= 15){
             if(pred_mode == Intra_4x4 || pred_mode == Intra_8x8){
-                coded_block_pattern = g_coded_block_pattern_ChromaArrayType_0_3[codeNum][0];
-            }else if(pred_mode == Inter){
                 coded_block_pattern = g_coded_block_pattern_ChromaArrayType_0_3[codeNum][1];
+            }else if(pred_mode != Intra_16x16 && pred_mode != Intra_NA){
+                coded_block_pattern = g_coded_block_pattern_ChromaArrayType_0_3[codeNum][2];
             }
         }
     }
@@ -292,4 +290,24 @@ inline uint8_t peek_u1(RBSPReader* reader) {
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+inline uint32_t peek_u(RBSPReader* reader, int n) {
+    uint32_t cache = 0;
+
+    if (reader->current + 4 <= reader->end) {
+        cache = ((uint32_t)reader->current[0] << 24) | ((uint32_t)reader->current[1] << 16) | ((uint32_t)reader->current[2] << 8) | reader->current[3];
+    } else {
+        for (int i = 0; i < 4; ++i) {
+            cache <<= 8;
+            if (reader->current + i < reader->end) {
+                cache |= reader->current[i];
+            }
+        }
+    }
+
+    /* at most 7 bits of the current byte have been consumed, so there are at least 25 valid bits in the cache */
+    cache <<= (8 - reader->bits_left);
+
+    return cache >> (32 - n);
+}
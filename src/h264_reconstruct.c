@@ -0,0 +1,791 @@
+#include "h264decoder/h264_reconstruct.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "h264decoder/h264_atomic.h"
+#include "h264decoder/h264_cpu.h"
+#include "h264decoder/h264_frame_thread.h"
+#include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_math.h"
+
+/**
+ * @brief reserve count entries of the packed coefficients, the slice threads pack their macroblocks concurrently
+ *
+ * @return int64_t the offset of the entries, -1 if the buffer is full
+ */
+static inline int64_t reserve_coeffs(ResidualStore* store, uint32_t count) {
+    uint32_t offset = fetch_add_shared_u32(&store->used, count);
+    return (uint64_t)offset + count <= store->capacity ? (int64_t)offset : -1;
+}
+
+/**
+ * @brief the number of the packed coefficients of a block mask, size for the blocks with a non-zero AC coefficient and 1 for the other blocks
+ */
+static inline uint32_t packed_size(uint32_t nz, uint32_t ac, uint32_t size) {
+    uint32_t count = 0;
+    for (; nz; nz &= nz - 1) {
+        count += (ac & (nz & (0u - nz))) ? size : 1;
+    }
+    return count;
+}
+
+static inline uint32_t record_size(const MbResidual* record, int32_t transform_size_8x8_flag, int32_t ChromaArrayType) {
+    uint32_t luma_size = transform_size_8x8_flag ? 64 : 16;
+    uint32_t chroma_size = ChromaArrayType == 3 ? luma_size : 16;
+    return packed_size(record->luma_nz, record->luma_ac, luma_size) + packed_size(record->chroma_nz[0], record->chroma_ac[0], chroma_size) +
+           packed_size(record->chroma_nz[1], record->chroma_ac[1], chroma_size);
+}
+
+/**
+ * @brief the state of the slice, 0 if the slice is not started
+ */
+static inline const ReconstructSlice* get_reconstruct_slice(const ResidualStore* store, int32_t slice_num) {
+    if (slice_num < 0 || slice_num / H264_RECONSTRUCT_SLICE_CHUNK >= store->slice_chunk_count || !store->slice_chunks[slice_num / H264_RECONSTRUCT_SLICE_CHUNK]) {
+        return 0;
+    }
+    return &store->slice_chunks[slice_num / H264_RECONSTRUCT_SLICE_CHUNK][slice_num % H264_RECONSTRUCT_SLICE_CHUNK];
+}
+
+/**
+ * @brief free the buffers of the store and uncharge them from the frame or field
+ */
+static void release_residual_buffers(ResidualStore* store, FrameOrField* ff) {
+    size_t size = (size_t)store->mb_count * (sizeof(MbResidual) + sizeof(int32_t) + (size_t)store->mb_entries * store->entry_size) +
+                  (size_t)store->slice_chunk_count * sizeof(ReconstructSlice*);
+    for (int32_t i = 0; i < store->slice_chunk_count; i++) {
+        if (store->slice_chunks[i]) {
+            free(store->slice_chunks[i]);
+            size += H264_RECONSTRUCT_SLICE_CHUNK * sizeof(ReconstructSlice);
+        }
+    }
+    free(store->slice_chunks);
+    free(store->records);
+    free(store->mb_ready);
+    free(store->coeffs);
+    uncharge_frame_or_field(ff, MEMORY_SCRATCH, size);
+
+    store->slice_chunks = 0;
+    store->slice_chunk_count = 0;
+    store->records = 0;
+    store->mb_ready = 0;
+    store->coeffs = 0;
+    store->mb_count = 0;
+    store->mb_entries = 0;
+    store->entry_size = 0;
+    store->capacity = 0;
+}
+
+/**
+ * @brief allocate the buffers of the store for the macroblocks of the frame or field and the entries of its format
+ */
+static int alloc_residual_buffers(ResidualStore* store, FrameOrField* ff, int32_t mb_entries, int32_t entry_size) {
+    int32_t chunk_count = (ff->mb_list_len + H264_RECONSTRUCT_SLICE_CHUNK - 1) / H264_RECONSTRUCT_SLICE_CHUNK;
+    size_t size = (size_t)ff->mb_list_len * (sizeof(MbResidual) + sizeof(int32_t) + (size_t)mb_entries * entry_size) + (size_t)chunk_count * sizeof(ReconstructSlice*);
+    int err_code = charge_frame_or_field(ff, MEMORY_SCRATCH, size);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* the records are cleared once, so the record of a macroblock which a broken slice left unpacked points into the buffer. the buffer itself is not cleared,
+     * its pages are touched only as far as the pictures fill it */
+    store->records = (MbResidual*)calloc(ff->mb_list_len, sizeof(MbResidual));
+    store->mb_ready = (int32_t*)malloc(ff->mb_list_len * sizeof(int32_t));
+    store->coeffs = malloc((size_t)ff->mb_list_len * mb_entries * entry_size);
+    store->slice_chunks = (ReconstructSlice**)calloc(chunk_count, sizeof(ReconstructSlice*));
+    if (!store->records || !store->mb_ready || !store->coeffs || !store->slice_chunks) {
+        free(store->records);
+        free(store->mb_ready);
+        free(store->coeffs);
+        free(store->slice_chunks);
+        store->records = 0;
+        store->mb_ready = 0;
+        store->coeffs = 0;
+        store->slice_chunks = 0;
+        uncharge_frame_or_field(ff, MEMORY_SCRATCH, size);
+        return ERR_OOM;
+    }
+    store->slice_chunk_count = chunk_count;
+    store->mb_count = ff->mb_list_len;
+    store->mb_entries = mb_entries;
+    store->entry_size = entry_size;
+    store->capacity = (uint32_t)ff->mb_list_len * mb_entries;
+    return ERR_OK;
+}
+
+/* the availability of the neighbouring macroblocks A, B, C and D for the intra prediction */
+#define MB_AVAIL_A 0x01
+#define MB_AVAIL_B 0x02
+#define MB_AVAIL_C 0x04
+#define MB_AVAIL_D 0x08
+
+/**
+ * @brief the neighbouring macroblock is available for the intra prediction: it is in the same slice, and is intra coded if constrained_intra_pred_flag is 1
+ * @see 6.4.10 Derivation process for neighbouring locations
+ * @see 8.3.1.2 Intra_4x4 sample prediction
+ */
+static inline int32_t is_intra_neighbour(const FrameOrField* ff, int32_t CurrMbAddr, int32_t mbAddrN) {
+    if (ff->mb_slice_ids[mbAddrN] != ff->mb_slice_ids[CurrMbAddr]) {
+        return 0;
+    }
+    return !ff->mb_list[CurrMbAddr].constrained_intra_pred_flag || mb_is_intra(&ff->mb_list[mbAddrN]);
+}
+
+static int32_t derive_intra_neighbours(const ReconstructJob* job, int32_t CurrMbAddr, int32_t mb_x, int32_t mb_y) {
+    int32_t W = job->PicWidthInMbs;
+    int32_t avail = 0;
+
+    if (mb_x > 0 && is_intra_neighbour(job->ff, CurrMbAddr, CurrMbAddr - 1)) {
+        avail |= MB_AVAIL_A;
+    }
+    if (mb_y > 0) {
+        if (is_intra_neighbour(job->ff, CurrMbAddr, CurrMbAddr - W)) {
+            avail |= MB_AVAIL_B;
+        }
+        if (mb_x < W - 1 && is_intra_neighbour(job->ff, CurrMbAddr, CurrMbAddr - W + 1)) {
+            avail |= MB_AVAIL_C;
+        }
+        if (mb_x > 0 && is_intra_neighbour(job->ff, CurrMbAddr, CurrMbAddr - W - 1)) {
+            avail |= MB_AVAIL_D;
+        }
+    }
+    return avail;
+}
+
+/**
+ * @brief the availability of the neighbouring samples of the block ( x, y ) of a N x N grid within the macroblock
+ *
+ * @param mb_avail the MB_AVAIL_XXX flags of the macroblock
+ * @param x the column of the block
+ * @param y the row of the block
+ * @param n the number of the blocks of a row, 4 or 2
+ * @param top_right_inside the block above right within the macroblock is decoded before the block
+ */
+static inline int32_t block_availability(int32_t mb_avail, int32_t x, int32_t y, int32_t n, int32_t top_right_inside) {
+    int32_t available = 0;
+
+    if (x > 0 || (mb_avail & MB_AVAIL_A)) {
+        available |= H264_INTRA_AVAIL_LEFT;
+    }
+    if (y > 0 || (mb_avail & MB_AVAIL_B)) {
+        available |= H264_INTRA_AVAIL_TOP;
+    }
+    if (y > 0 ? (x > 0 || (mb_avail & MB_AVAIL_A)) : (x > 0 ? (mb_avail & MB_AVAIL_B) : (mb_avail & MB_AVAIL_D))) {
+        available |= H264_INTRA_AVAIL_TOP_LEFT;
+    }
+    if (y == 0 ? (x < n - 1 ? (mb_avail & MB_AVAIL_B) : (mb_avail & MB_AVAIL_C)) : (x < n - 1 && top_right_inside)) {
+        available |= H264_INTRA_AVAIL_TOP_RIGHT;
+    }
+    return available;
+}
+
+/**
+ * @brief luma4x4BlkIdx of the 4x4 block ( x, y ) of the macroblock
+ * @see 6.4.13.1 Derivation process for 4x4 luma block indices
+ */
+static inline int32_t luma4x4_blk_idx(int32_t x, int32_t y) { return 8 * (y / 2) + 4 * (x / 2) + 2 * (y % 2) + (x % 2); }
+
+/**
+ * @brief the 4x4 blocks of the macroblock have the same motion data
+ */
+static inline int32_t same_motion(const FrameOrField* ff, int32_t blk_a, int32_t blk_b) {
+    for (int32_t list = 0; list < 2; list++) {
+        if (ff->ref_idxs[list][blk_a] != ff->ref_idxs[list][blk_b] || ff->mvs[list][blk_a * 2] != ff->mvs[list][blk_b * 2] ||
+            ff->mvs[list][blk_a * 2 + 1] != ff->mvs[list][blk_b * 2 + 1]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief the four 4x4 blocks of the 8x8 block ( x8, y8 ) have the same motion data
+ */
+static inline int32_t same_motion_8x8(const FrameOrField* ff, int32_t first_blk, int32_t x8, int32_t y8) {
+    int32_t blk = first_blk + y8 * 8 + x8 * 2;
+    return same_motion(ff, blk, blk + 1) && same_motion(ff, blk, blk + 4) && same_motion(ff, blk, blk + 5);
+}
+
+
+#define BIT_DEPTH 8
+#include "h264_reconstruct_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 9
+#include "h264_reconstruct_template.h"
+#undef BIT_DEPTH
+
+/**
+ * @brief select the kernels of the bit depth, the workers are idle
+ */
+static void init_reconstruct_kernels(Reconstructor* r, int32_t BitDepth) {
+    int32_t cpu_flags = get_cpu_flags();
+    init_transform_funcs(&r->transform_funcs, BitDepth, cpu_flags);
+    init_intra_pred_funcs(&r->intra_funcs, BitDepth, cpu_flags);
+    init_inter_pred_funcs(&r->inter_funcs, BitDepth, cpu_flags);
+    r->BitDepth = BitDepth;
+}
+
+static void init_reconstruct_job(ReconstructJob* job, FrameOrField* ff, const SPS* sps) {
+    memset(job, 0, sizeof(ReconstructJob));
+    job->ff = ff;
+    job->PicWidthInMbs = (int32_t)sps->PicWidthInMbs;
+    job->PicHeightInMbs = ff->mb_list_len / job->PicWidthInMbs;
+    job->field_parity = ff == ff->parent->frame ? -1 : (ff == ff->parent->bottom_field);
+    job->ChromaArrayType = (int32_t)sps->ChromaArrayType;
+    if (job->ChromaArrayType) {
+        job->MbWidthC = (int32_t)sps->MbWidthC;
+        job->MbHeightC = (int32_t)sps->MbHeightC;
+    }
+}
+
+/**
+ * @brief wake the workers waiting for the macroblocks which the entropy stage packs
+ */
+static void wake_waiting_workers(Reconstructor* r) {
+    if (!load_seq_cst_i32(&r->waiters)) {
+        return;
+    }
+    pthread_mutex_lock(&r->mutex);
+    pthread_cond_broadcast(&r->progress);
+    pthread_mutex_unlock(&r->mutex);
+}
+
+static int start_wavefront(Reconstructor* r, const ReconstructJob* job);
+static int finish_wavefront(Reconstructor* r, DeblockThread* deblock_thread);
+
+int start_residual_records(Reconstructor* reconstructor, FrameOrField* ff, const SliceHeader* header) {
+    const SPS* sps = header->sps;
+
+    /* the frames and fields of the other formats are not reconstructed, the separate colour planes have 3 planes of ChromaArrayType 0 */
+    if (sps->BitDepthY != sps->BitDepthC || header->MbaffFrameFlag || ff->plane_count != (sps->ChromaArrayType ? 3 : 1) ||
+        ff->mb_list_len <= 0) {
+        return ERR_OK;
+    }
+
+    ResidualStore* store = ff->residuals;
+    if (store && store->active) {
+        return ERR_OK;
+    }
+
+    if (!store) {
+        store = (ResidualStore*)malloc(sizeof(ResidualStore));
+        if (!store) {
+            return ERR_OOM;
+        }
+        memset(store, 0, sizeof(ResidualStore));
+        ff->residuals = store;
+    }
+
+    /* the coefficients of the bit depths greater than 8 are int32_t, the PCM samples are stored in the entries of the coefficients */
+    int32_t mb_entries = 256 + (sps->ChromaArrayType ? 2 * (int32_t)(sps->MbWidthC * sps->MbHeightC) : 0);
+    int32_t entry_size = sps->BitDepthY > 8 ? (int32_t)sizeof(int32_t) : (int32_t)sizeof(int16_t);
+    if (store->mb_count != ff->mb_list_len || store->mb_entries != mb_entries || store->entry_size != entry_size) {
+        release_residual_buffers(store, ff);
+        int err_code = alloc_residual_buffers(store, ff, mb_entries, entry_size);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+
+    /* a wavefront left running by a picture which was never finished */
+    if (reconstructor->job.ff) {
+        finish_wavefront(reconstructor, 0);
+    }
+    if (reconstructor->BitDepth != (int32_t)sps->BitDepthY) {
+        init_reconstruct_kernels(reconstructor, (int32_t)sps->BitDepthY);
+    }
+
+    memset(store->mb_ready, 0, store->mb_count * sizeof(int32_t));
+    store->ChromaArrayType = (int32_t)sps->ChromaArrayType;
+    store->used = 0;
+    store->reconstructor = 0;
+    store->row_reconstructor = 0;
+    store->row_deblock_funcs = 0;
+    store->reconstructed_rows = 0;
+    store->deblocked_rows = 0;
+    store->padded_rows = 0;
+    store->active = 1;
+
+    /* the workers follow the entropy stage from the first macroblock, the frame threads reconstruct their pictures themselves */
+    if (reconstructor->thread_count && !ff->parent->threads) {
+        ReconstructJob job;
+        init_reconstruct_job(&job, ff, sps);
+        int err_code = start_wavefront(reconstructor, &job);
+        if (err_code < 0) {
+            store->active = 0;
+            return err_code;
+        }
+        store->reconstructor = reconstructor;
+    }
+    return ERR_OK;
+}
+
+int store_reconstruct_slice(FrameOrField* ff, int32_t slice_num, const SliceHeader* header, const RefPicLists* ref_lists) {
+    ResidualStore* store = ff->residuals;
+
+    /* every slice has a macroblock, so a frame or field has at most mb_count slices */
+    if (slice_num < 0 || slice_num / H264_RECONSTRUCT_SLICE_CHUNK >= store->slice_chunk_count) {
+        return ERR_INVALID_SLICE;
+    }
+
+    ReconstructSlice** chunk = &store->slice_chunks[slice_num / H264_RECONSTRUCT_SLICE_CHUNK];
+    if (!*chunk) {
+        int err_code = charge_frame_or_field(ff, MEMORY_SCRATCH, H264_RECONSTRUCT_SLICE_CHUNK * sizeof(ReconstructSlice));
+        if (err_code < 0) {
+            return err_code;
+        }
+        *chunk = (ReconstructSlice*)malloc(H264_RECONSTRUCT_SLICE_CHUNK * sizeof(ReconstructSlice));
+        if (!*chunk) {
+            uncharge_frame_or_field(ff, MEMORY_SCRATCH, H264_RECONSTRUCT_SLICE_CHUNK * sizeof(ReconstructSlice));
+            return ERR_OOM;
+        }
+    }
+
+    ReconstructSlice* slice = &(*chunk)[slice_num % H264_RECONSTRUCT_SLICE_CHUNK];
+    int32_t slice_type = (int32_t)(header->slice_type % 5);
+    slice->ref_lists = *ref_lists;
+    slice->is_switching_slice = slice_type == SLICE_TYPE_SP || slice_type == SLICE_TYPE_SI;
+
+    PredWeights* weights = &slice->weights;
+    *weights = header->pred_weights;
+
+    /* the implicit weights depend on the distances of the reference pictures of the slice */
+    if (weights->weighted_mode == 2 && slice_type == SLICE_TYPE_B) {
+        int32_t poc_lx[2][H264_MAX_REFS];
+        uint8_t long_term_lx[2][H264_MAX_REFS];
+
+        for (int32_t list = 0; list < 2; list++) {
+            for (int32_t i = 0; i < ref_lists->num[list]; i++) {
+                poc_lx[list][i] = ref_lists->entries[list][i].poc;
+                long_term_lx[list][i] = ref_lists->entries[list][i].long_term;
+            }
+        }
+        derivation_for_implicit_weights(weights, 0, ff->poc, poc_lx[0], long_term_lx[0], ref_lists->num[0], poc_lx[1], long_term_lx[1], ref_lists->num[1]);
+    }
+
+    return ERR_OK;
+}
+
+void pack_macroblock_residual(FrameOrField* ff, int32_t CurrMbAddr) {
+    ResidualStore* store = ff->residuals;
+    MbResidual* record = &store->records[CurrMbAddr];
+
+    memset(record, 0, sizeof(MbResidual));
+    if (!ff->mb_skip_flags[CurrMbAddr]) {
+        if (store->entry_size == (int32_t)sizeof(int16_t)) {
+            pack_residual(store, record, ff, CurrMbAddr);
+        } else {
+            pack_residual16(store, record, ff, CurrMbAddr);
+        }
+    }
+
+    /* the record, the macroblock state and the slice are visible to the worker which sees the flag */
+    store_seq_cst_i32(&store->mb_ready[CurrMbAddr], 1);
+
+    Reconstructor* r = store->reconstructor;
+    if (r && (CurrMbAddr + 1) % r->job.PicWidthInMbs == 0) {
+        wake_waiting_workers(r);
+    }
+}
+
+void report_packed_slice(FrameOrField* ff) {
+    if (ff->residuals && ff->residuals->active && ff->residuals->reconstructor) {
+        wake_waiting_workers(ff->residuals->reconstructor);
+    }
+}
+
+void free_residual_store(ResidualStore* store) {
+    for (int32_t i = 0; i < store->slice_chunk_count; i++) {
+        free(store->slice_chunks[i]);
+    }
+    free(store->slice_chunks);
+    free(store->records);
+    free(store->mb_ready);
+    free(store->coeffs);
+    free(store);
+}
+
+/**
+ * @brief reconstruct the macroblock packed by the entropy stage
+ */
+static int reconstruct_macroblock(Reconstructor* r, const ReconstructJob* job, int32_t CurrMbAddr) {
+    const FrameOrField* ff = job->ff;
+    const ResidualStore* store = ff->residuals;
+
+    /* the macroblocks which no slice packed, and the macroblocks of the SP and SI slices whose residual is decoded with the prediction, are left as they are */
+    if (!load_acquire_i32(&store->mb_ready[CurrMbAddr])) {
+        return ERR_OK;
+    }
+    const ReconstructSlice* slice = get_reconstruct_slice(store, ff->mb_slice_ids[CurrMbAddr]);
+    if (!slice) {
+        return ERR_INVALID_SLICE_DATA;
+    }
+    if (slice->is_switching_slice) {
+        return ERR_OK;
+    }
+
+    /* a frame thread reads the samples of the reference pictures once their rows are final */
+    if (ff->parent->threads && !mb_is_intra(&ff->mb_list[CurrMbAddr])) {
+        wait_for_macroblock_references(ff, &slice->ref_lists, job->PicWidthInMbs, CurrMbAddr);
+    }
+
+    if (store->entry_size == (int32_t)sizeof(int16_t)) {
+        return reconstruct_residual_macroblock(r, job, slice, CurrMbAddr);
+    }
+    return reconstruct_residual_macroblock16(r, job, slice, CurrMbAddr);
+}
+
+static void set_job_error(Reconstructor* r, int err_code) {
+    pthread_mutex_lock(&r->mutex);
+    if (r->err_code == ERR_OK) {
+        r->err_code = err_code;
+    }
+    pthread_mutex_unlock(&r->mutex);
+}
+
+/**
+ * @brief wait until the row is reconstructed up to mbs macroblocks. the progress is published without the mutex, the waiter count is the waiting flag of
+ * h264_atomic.h
+ *
+ * @return int32_t 0 if the workers quit
+ */
+static int32_t wait_for_row(Reconstructor* r, int32_t row, int32_t mbs) {
+    if (load_seq_cst_i32(&r->row_progress[row]) >= mbs) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&r->mutex);
+    store_seq_cst_i32(&r->waiters, r->waiters + 1);
+    while (load_seq_cst_i32(&r->row_progress[row]) < mbs && !r->quit) {
+        pthread_cond_wait(&r->progress, &r->mutex);
+    }
+    store_seq_cst_i32(&r->waiters, r->waiters - 1);
+    int32_t quit = r->quit;
+    pthread_mutex_unlock(&r->mutex);
+
+    return !quit;
+}
+
+/**
+ * @brief wait until the entropy stage packs the macroblock, or all the slices of the job are parsed
+ *
+ * @return int32_t 0 if the workers quit
+ */
+static int32_t wait_for_macroblock(Reconstructor* r, const int32_t* mb_ready) {
+    if (load_seq_cst_i32(mb_ready) || load_seq_cst_i32(&r->parsed)) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&r->mutex);
+    store_seq_cst_i32(&r->waiters, r->waiters + 1);
+    while (!load_seq_cst_i32(mb_ready) && !load_seq_cst_i32(&r->parsed) && !r->quit) {
+        pthread_cond_wait(&r->progress, &r->mutex);
+    }
+    store_seq_cst_i32(&r->waiters, r->waiters - 1);
+    int32_t quit = r->quit;
+    pthread_mutex_unlock(&r->mutex);
+
+    return !quit;
+}
+
+static void publish_row(Reconstructor* r, int32_t row, int32_t mbs) {
+    store_seq_cst_i32(&r->row_progress[row], mbs);
+    if (!load_seq_cst_i32(&r->waiters)) {
+        return;
+    }
+    pthread_mutex_lock(&r->mutex);
+    pthread_cond_broadcast(&r->progress);
+    pthread_mutex_unlock(&r->mutex);
+}
+
+/**
+ * @brief reconstruct a macroblock row, the macroblock x waits until it is packed and for the macroblock x + 1 of the row above, which its intra prediction reads
+ * as C
+ */
+static void reconstruct_row(Reconstructor* r, int32_t mb_y) {
+    const ReconstructJob* job = &r->job;
+    const int32_t* mb_ready = job->ff->residuals->mb_ready;
+    int32_t W = job->PicWidthInMbs;
+
+    for (int32_t mb_x = 0; mb_x < W; mb_x++) {
+        if (mb_y > 0 && !wait_for_row(r, mb_y - 1, codec_min(mb_x + 2, W))) {
+            return;
+        }
+        if (!wait_for_macroblock(r, &mb_ready[mb_y * W + mb_x])) {
+            return;
+        }
+
+        int err_code = reconstruct_macroblock(r, job, mb_y * W + mb_x);
+        if (err_code < 0) {
+            set_job_error(r, err_code);
+        }
+        publish_row(r, mb_y, mb_x + 1);
+    }
+}
+
+static void* reconstruct_thread_main(void* arg) {
+    Reconstructor* r = (Reconstructor*)arg;
+
+    pthread_mutex_lock(&r->mutex);
+    while (!r->quit) {
+        if (!r->job.ff || r->next_row >= r->job.PicHeightInMbs) {
+            pthread_cond_wait(&r->work, &r->mutex);
+            continue;
+        }
+
+        int32_t mb_y = r->next_row++;
+        pthread_mutex_unlock(&r->mutex);
+        reconstruct_row(r, mb_y);
+        pthread_mutex_lock(&r->mutex);
+
+        /* a row is complete only after the row above it, so the complete rows are the leading rows */
+        int32_t rows = ++r->done_rows;
+        DeblockThread* deblock_thread = r->job.deblock_thread;
+        if (rows == r->job.PicHeightInMbs) {
+            pthread_cond_broadcast(&r->progress);
+        }
+
+        if (deblock_thread) {
+            pthread_mutex_unlock(&r->mutex);
+            report_reconstructed_rows(deblock_thread, rows);
+            pthread_mutex_lock(&r->mutex);
+        }
+    }
+    pthread_mutex_unlock(&r->mutex);
+
+    return 0;
+}
+
+/**
+ * @brief stop and join the first count worker threads, the workers waiting for a job or for the progress of a job quit
+ */
+static void stop_worker_threads(Reconstructor* r, int32_t count) {
+    pthread_mutex_lock(&r->mutex);
+    r->quit = 1;
+    pthread_cond_broadcast(&r->work);
+    pthread_cond_broadcast(&r->progress);
+    pthread_mutex_unlock(&r->mutex);
+
+    for (int32_t i = 0; i < count; i++) {
+        pthread_join(r->threads[i], 0);
+    }
+}
+
+Reconstructor* create_reconstructor(int32_t thread_count) {
+    if (thread_count < 1 || thread_count > H264_MAX_RECONSTRUCT_THREADS) {
+        return 0;
+    }
+
+    Reconstructor* r = (Reconstructor*)malloc(sizeof(Reconstructor));
+    if (!r) {
+        return 0;
+    }
+    memset(r, 0, sizeof(Reconstructor));
+
+    /* the kernels of the bit depth 8 until the bit depth of the active sps is known */
+    init_reconstruct_kernels(r, 8);
+
+    /* one thread is the decoding thread itself */
+    if (thread_count == 1) {
+        return r;
+    }
+
+    if (pthread_mutex_init(&r->mutex, 0)) {
+        free(r);
+        return 0;
+    }
+    if (pthread_cond_init(&r->work, 0)) {
+        pthread_mutex_destroy(&r->mutex);
+        free(r);
+        return 0;
+    }
+    if (pthread_cond_init(&r->progress, 0)) {
+        pthread_cond_destroy(&r->work);
+        pthread_mutex_destroy(&r->mutex);
+        free(r);
+        return 0;
+    }
+
+    for (int32_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&r->threads[i], 0, reconstruct_thread_main, r)) {
+            stop_worker_threads(r, i);
+            pthread_cond_destroy(&r->progress);
+            pthread_cond_destroy(&r->work);
+            pthread_mutex_destroy(&r->mutex);
+            free(r);
+            return 0;
+        }
+    }
+    r->thread_count = thread_count;
+
+    return r;
+}
+
+void free_reconstructor(Reconstructor* reconstructor) {
+    if (reconstructor->thread_count) {
+        stop_worker_threads(reconstructor, reconstructor->thread_count);
+        pthread_cond_destroy(&reconstructor->progress);
+        pthread_cond_destroy(&reconstructor->work);
+        pthread_mutex_destroy(&reconstructor->mutex);
+    }
+    /* the frame or field of an unfinished job is reconstructed by the next reconstructor, if any, once it is parsed */
+    if (reconstructor->job.ff) {
+        reconstructor->job.ff->residuals->reconstructor = 0;
+    }
+    free(reconstructor->row_progress);
+    free(reconstructor);
+}
+
+/**
+ * @brief start the rows of the job on the workers, they reconstruct the macroblocks as the entropy stage packs them
+ */
+static int start_wavefront(Reconstructor* r, const ReconstructJob* job) {
+    if (job->PicHeightInMbs > r->row_progress_capacity) {
+        int32_t* row_progress = (int32_t*)malloc(job->PicHeightInMbs * sizeof(int32_t));
+        if (!row_progress) {
+            return ERR_OOM;
+        }
+        free(r->row_progress);
+        r->row_progress = row_progress;
+        r->row_progress_capacity = job->PicHeightInMbs;
+    }
+    memset(r->row_progress, 0, job->PicHeightInMbs * sizeof(int32_t));
+
+    pthread_mutex_lock(&r->mutex);
+    r->job = *job;
+    r->next_row = 0;
+    r->done_rows = 0;
+    store_seq_cst_i32(&r->parsed, 0);
+    r->err_code = ERR_OK;
+    pthread_cond_broadcast(&r->work);
+    pthread_mutex_unlock(&r->mutex);
+
+    return ERR_OK;
+}
+
+/**
+ * @brief let the workers finish the job once all its slices are parsed, and wait for them. the rows reconstructed so far are reported to the deblocking worker
+ */
+static int finish_wavefront(Reconstructor* r, DeblockThread* deblock_thread) {
+    pthread_mutex_lock(&r->mutex);
+    store_seq_cst_i32(&r->parsed, 1);
+    r->job.deblock_thread = deblock_thread;
+    int32_t rows = r->done_rows;
+    pthread_cond_broadcast(&r->progress);
+    pthread_mutex_unlock(&r->mutex);
+
+    if (deblock_thread && rows) {
+        report_reconstructed_rows(deblock_thread, rows);
+    }
+
+    pthread_mutex_lock(&r->mutex);
+    while (r->done_rows < r->job.PicHeightInMbs) {
+        pthread_cond_wait(&r->progress, &r->mutex);
+    }
+    int err_code = r->err_code;
+    r->job.ff->residuals->reconstructor = 0;
+    r->job.ff = 0;
+    pthread_mutex_unlock(&r->mutex);
+
+    return err_code;
+}
+
+int reconstruct_frame_or_field(Reconstructor* reconstructor, FrameOrField* ff, const SPS* sps, const DeblockFuncs* deblock_funcs, DeblockThread* deblock_thread) {
+    ResidualStore* store = ff->residuals;
+    if (!store || !store->active) {
+        return ERR_OK;
+    }
+
+    /* the frame threads were stopped while they reconstructed the rows of the frame or field, its remaining rows follow them */
+    if (store->reconstructed_rows > 0) {
+        int32_t final_rows;
+        return reconstruct_parsed_rows(reconstructor, deblock_funcs, ff, sps, ff->mb_list_len / (int32_t)sps->PicWidthInMbs, &final_rows);
+    }
+    store->active = 0;
+
+    DeblockPlanes planes;
+    init_deblock_planes(&planes, ff, sps);
+
+    int err_code = deblock_thread ? start_deblock_picture(deblock_thread, ff, &planes) : ERR_OK;
+    if (err_code < 0) {
+        if (store->reconstructor) {
+            finish_wavefront(reconstructor, 0);
+        }
+        return err_code;
+    }
+
+    if (store->reconstructor) {
+        /* the workers have followed the entropy stage, they take the macroblocks which no slice packed as they are */
+        err_code = finish_wavefront(reconstructor, deblock_thread);
+    } else {
+        ReconstructJob job;
+        init_reconstruct_job(&job, ff, sps);
+        for (int32_t mb_y = 0; mb_y < job.PicHeightInMbs; mb_y++) {
+            for (int32_t CurrMbAddr = mb_y * job.PicWidthInMbs; CurrMbAddr < (mb_y + 1) * job.PicWidthInMbs; CurrMbAddr++) {
+                int err = reconstruct_macroblock(reconstructor, &job, CurrMbAddr);
+                if (err < 0 && err_code == ERR_OK) {
+                    err_code = err;
+                }
+            }
+            if (deblock_thread) {
+                report_reconstructed_rows(deblock_thread, mb_y + 1);
+            }
+        }
+    }
+
+    /* the deblocking worker finishes the picture whatever the reconstruction reports */
+    int deblock_err = deblock_thread ? finish_deblock_picture(deblock_thread) : deblock_picture(deblock_funcs, ff, &planes);
+    if (err_code == ERR_OK) {
+        err_code = deblock_err;
+    }
+
+    /* the later pictures refer to the padded samples */
+    pad_frame_or_field(ff);
+
+    return err_code;
+}
+
+int reconstruct_parsed_rows(Reconstructor* reconstructor, const DeblockFuncs* deblock_funcs, FrameOrField* ff, const SPS* sps, int32_t rows, int32_t* final_rows) {
+    ResidualStore* store = ff->residuals;
+    int err_code = ERR_OK;
+
+    ReconstructJob job;
+    init_reconstruct_job(&job, ff, sps);
+    rows = codec_min(rows, job.PicHeightInMbs);
+    if (reconstructor->BitDepth != (int32_t)sps->BitDepthY) {
+        init_reconstruct_kernels(reconstructor, (int32_t)sps->BitDepthY);
+    }
+
+    for (; store->reconstructed_rows < rows; store->reconstructed_rows++) {
+        int32_t first = store->reconstructed_rows * job.PicWidthInMbs;
+        for (int32_t CurrMbAddr = first; CurrMbAddr < first + job.PicWidthInMbs; CurrMbAddr++) {
+            int err = reconstruct_macroblock(reconstructor, &job, CurrMbAddr);
+            if (err < 0 && err_code == ERR_OK) {
+                err_code = err;
+            }
+        }
+    }
+
+    /* the rows are filtered in the order of deblock_picture(), the last row once the whole frame or field is reconstructed */
+    DeblockPlanes planes;
+    init_deblock_planes(&planes, ff, sps);
+    while (store->deblocked_rows < store->reconstructed_rows - 1 || (store->reconstructed_rows == job.PicHeightInMbs && store->deblocked_rows < job.PicHeightInMbs)) {
+        int err = deblock_macroblock_row(deblock_funcs, ff, &planes, store->deblocked_rows++);
+        if (err < 0 && err_code == ERR_OK) {
+            err_code = err;
+        }
+    }
+
+    /* the filtering of a row modifies the bottom lines of the row above it */
+    int32_t rows_final = store->deblocked_rows == job.PicHeightInMbs ? job.PicHeightInMbs : codec_max(store->deblocked_rows - 1, 0);
+    if (rows_final > store->padded_rows) {
+        pad_frame_or_field_rows(ff, store->padded_rows, rows_final);
+        store->padded_rows = rows_final;
+    }
+    if (rows_final == job.PicHeightInMbs) {
+        store->active = 0;
+    }
+
+    *final_rows = rows_final;
+    return err_code;
+}
@@ -0,0 +1,367 @@
+/*
+ * the packing of the residual records and the reconstruction of the macroblocks of one sample size, included by h264_reconstruct.c with BIT_DEPTH 8 for the
+ * uint8_t samples and BIT_DEPTH 9 for the uint16_t samples of the bit depths 9 to 14, whose kernels are selected by the bit depth of the function tables
+ */
+
+#include "h264_bit_depth_template.h"
+
+/**
+ * @brief copy the blocks of a block mask between the coefficients of TransformCoeffs and the packed coefficients
+ *
+ * @param blocks the coefficients of the blocks, size coefficients per block
+ * @param packed the packed coefficients
+ * @param unpack 1 to copy the packed coefficients to the blocks
+ * @return dctcoef* the entry after the blocks in packed
+ */
+static dctcoef* FUNC16(copy_blocks)(dctcoef* blocks, dctcoef* packed, uint32_t nz, uint32_t ac, int32_t size, int32_t unpack) {
+    for (; nz; nz &= nz - 1) {
+        int32_t blk = int_log2(nz & (0u - nz));
+        int32_t count = (ac >> blk) & 1 ? size : 1;
+        if (unpack) {
+            memcpy(blocks + blk * size, packed, count * sizeof(dctcoef));
+        } else {
+            memcpy(packed, blocks + blk * size, count * sizeof(dctcoef));
+        }
+        packed += count;
+    }
+    return packed;
+}
+
+/**
+ * @brief pack the PCM samples or the scaled coefficients of the macroblock which is not skipped, the record is cleared by the caller
+ */
+static void FUNC16(pack_residual)(ResidualStore* store, MbResidual* record, const FrameOrField* ff, int32_t CurrMbAddr) {
+    const MacroBlockScratch* scratch = ff->mb_scratch;
+
+    if (ff->mb_type_names[CurrMbAddr] == I_PCM) {
+        int64_t offset = reserve_coeffs(store, store->mb_entries);
+        if (offset < 0) {
+            return;
+        }
+
+        dctcoef* samples = (dctcoef*)store->coeffs + offset;
+        for (int32_t i = 0; i < 256; i++) {
+            samples[i] = (dctcoef)scratch->pcm_sample_luma[i];
+        }
+        for (int32_t i = 0; i < store->mb_entries - 256; i++) {
+            samples[256 + i] = (dctcoef)scratch->pcm_sample_chroma[i];
+        }
+        record->offset = (uint32_t)offset;
+        return;
+    }
+
+#if BIT_DEPTH == 8
+    const TransformCoeffsT* coeffs = &scratch->coeffs;
+#else
+    const TransformCoeffsT* coeffs = &scratch->coeffs16;
+#endif
+    int32_t transform_size_8x8_flag = ff->mb_list[CurrMbAddr].transform_size_8x8_flag;
+
+    record->luma_nz = coeffs->luma_nz;
+    record->luma_ac = coeffs->luma_ac;
+    for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+        record->chroma_nz[iCbCr] = coeffs->chroma_nz[iCbCr];
+        record->chroma_ac[iCbCr] = coeffs->chroma_ac[iCbCr];
+    }
+
+    uint32_t size = record_size(record, transform_size_8x8_flag, store->ChromaArrayType);
+    if (!size) {
+        return;
+    }
+
+    int64_t offset = reserve_coeffs(store, size);
+    if (offset < 0) {
+        /* a macroblock decoded twice by a broken stream, its residual is dropped */
+        memset(record, 0, sizeof(MbResidual));
+        return;
+    }
+
+    int32_t luma_size = transform_size_8x8_flag ? 64 : 16;
+    int32_t chroma_size = store->ChromaArrayType == 3 ? luma_size : 16;
+    dctcoef* packed = (dctcoef*)store->coeffs + offset;
+    packed = FUNC16(copy_blocks)((dctcoef*)coeffs->luma, packed, coeffs->luma_nz, coeffs->luma_ac, luma_size, 0);
+    for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+        packed = FUNC16(copy_blocks)((dctcoef*)coeffs->chroma[iCbCr], packed, coeffs->chroma_nz[iCbCr], coeffs->chroma_ac[iCbCr], chroma_size, 0);
+    }
+    record->offset = (uint32_t)offset;
+}
+
+/**
+ * @brief gather the neighbouring samples p[ x, y ] of a width x height block, the width samples above right are read for the 4x4 and 8x8 blocks
+ */
+static void FUNC16(gather_intra_samples)(const pixel* dst, int32_t stride, int32_t width, int32_t height, int32_t available, IntraPredSamplesT* samples) {
+    memset(samples, 0, sizeof(IntraPredSamplesT));
+    samples->available = (uint8_t)available;
+
+    if (available & H264_INTRA_AVAIL_TOP) {
+        memcpy(samples->top, dst - stride, width * sizeof(pixel));
+    }
+    if (available & H264_INTRA_AVAIL_TOP_RIGHT) {
+        memcpy(samples->top + width, dst - stride + width, width * sizeof(pixel));
+    }
+    if (available & H264_INTRA_AVAIL_LEFT) {
+        for (int32_t y = 0; y < height; y++) {
+            samples->left[y] = dst[y * stride - 1];
+        }
+    }
+    if (available & H264_INTRA_AVAIL_TOP_LEFT) {
+        samples->top_left = dst[-stride - 1];
+    }
+}
+
+/**
+ * @brief predict the 16x16 samples of a colour component by the luma intra prediction of the macroblock and add its residual
+ * @see 8.3.1 Intra_4x4 prediction process for luma samples
+ * @see 8.3.2 Intra_8x8 prediction process for luma samples
+ * @see 8.3.3 Intra_16x16 prediction process for luma samples
+ *
+ * @param iComp the colour component, 1 and 2 for the Cb and Cr samples of ChromaArrayType equal to 3, see 8.3.4.5
+ * @param mb_avail the availability of the neighbouring macroblocks, see derive_intra_neighbours()
+ */
+static void FUNC16(reconstruct_intra_luma_layout)(Reconstructor* r, const MacroBlock* mb, int32_t mb_avail, const TransformCoeffsT* coeffs, int32_t iComp, pixel* dst,
+                                                  int32_t stride) {
+    IntraPredSamplesT samples;
+
+    if (mb->mb_pred_type == Intra_4x4) {
+        for (int32_t luma4x4BlkIdx = 0; luma4x4BlkIdx < 16; luma4x4BlkIdx++) {
+            /* 6.4.3 Inverse 4x4 luma block scanning process */
+            int32_t x = (luma4x4BlkIdx / 4 % 2) * 2 + luma4x4BlkIdx % 2;
+            int32_t y = (luma4x4BlkIdx / 8) * 2 + luma4x4BlkIdx / 2 % 2;
+            int32_t top_right_inside = y > 0 && x < 3 && luma4x4_blk_idx(x + 1, y - 1) < luma4x4BlkIdx;
+            pixel* block = dst + y * 4 * stride + x * 4;
+
+            FUNC16(gather_intra_samples)(block, stride, 4, 4, block_availability(mb_avail, x, y, 4, top_right_inside), &samples);
+            FUNC16(intra_pred_substitute_top_right)(&samples, 4);
+            r->intra_funcs.pred4x4[(mb->intra_pred_modes >> (4 * luma4x4BlkIdx)) & 0xF]((uint8_t*)block, stride, (const IntraPredSamples*)&samples);
+            FUNC16(transform_add_luma4x4)(&r->transform_funcs, coeffs, iComp, y * 4 + x, block, stride);
+        }
+    } else if (mb->mb_pred_type == Intra_8x8) {
+        IntraPredSamplesT filtered;
+        for (int32_t luma8x8BlkIdx = 0; luma8x8BlkIdx < 4; luma8x8BlkIdx++) {
+            int32_t x = luma8x8BlkIdx % 2;
+            int32_t y = luma8x8BlkIdx / 2;
+            pixel* block = dst + y * 8 * stride + x * 8;
+
+            /* the block above right of the lower left 8x8 block is the upper right one */
+            FUNC16(gather_intra_samples)(block, stride, 8, 8, block_availability(mb_avail, x, y, 2, luma8x8BlkIdx == 2), &samples);
+            FUNC16(intra_pred_substitute_top_right)(&samples, 8);
+            FUNC16(intra8x8_filter_reference_samples)(&samples, &filtered);
+            r->intra_funcs.pred8x8[(mb->intra_pred_modes >> (16 * luma8x8BlkIdx)) & 0xF]((uint8_t*)block, stride, (const IntraPredSamples*)&filtered);
+            FUNC16(transform_add_luma8x8)(&r->transform_funcs, coeffs, iComp, luma8x8BlkIdx, block, stride);
+        }
+    } else {
+        /* 7.4.5: Intra16x16PredMode of mb_type 1 to 24 of Table 7-11 */
+        FUNC16(gather_intra_samples)(dst, stride, 16, 16, block_availability(mb_avail, 0, 0, 1, 0) & ~H264_INTRA_AVAIL_TOP_RIGHT, &samples);
+        r->intra_funcs.pred16x16[(mb->mb_type - 1) % 4]((uint8_t*)dst, stride, (const IntraPredSamples*)&samples);
+        FUNC16(transform_add_luma)(&r->transform_funcs, coeffs, iComp, 0, dst, stride);
+    }
+}
+
+static void FUNC16(reconstruct_intra)(Reconstructor* r, const ReconstructJob* job, const MacroBlock* mb, int32_t CurrMbAddr, int32_t mb_x, int32_t mb_y,
+                                      const TransformCoeffsT* coeffs) {
+    int32_t mb_avail = derive_intra_neighbours(job, CurrMbAddr, mb_x, mb_y);
+
+    /* 8.3.4.5: the Cb and Cr samples of ChromaArrayType equal to 3 are predicted like the luma samples */
+    for (int32_t iComp = 0; iComp < (job->ChromaArrayType == 3 ? 3 : 1); iComp++) {
+        const SamplePlane* plane = &job->ff->planes[iComp];
+        pixel* dst = (pixel*)plane->data + (ptrdiff_t)mb_y * 16 * plane->stride + mb_x * 16;
+        FUNC16(reconstruct_intra_luma_layout)(r, mb, mb_avail, coeffs, iComp, dst, plane->stride);
+    }
+
+    if (job->ChromaArrayType != 1 && job->ChromaArrayType != 2) {
+        return;
+    }
+
+    /* 8.3.4 Intra prediction process for chroma samples, the MbWidthC x MbHeightC block of ChromaArrayType 1 or 2 */
+    IntraPredSamplesT samples;
+    int32_t available = block_availability(mb_avail, 0, 0, 1, 0) & ~H264_INTRA_AVAIL_TOP_RIGHT;
+    for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+        const SamplePlane* chroma = &job->ff->planes[1 + iCbCr];
+        pixel* dst_c = (pixel*)chroma->data + (ptrdiff_t)mb_y * job->MbHeightC * chroma->stride + mb_x * job->MbWidthC;
+
+        FUNC16(gather_intra_samples)(dst_c, chroma->stride, job->MbWidthC, job->MbHeightC, available, &samples);
+        r->intra_funcs.pred_chroma[job->ChromaArrayType - 1][mb->intra_chroma_pred_mode & 3]((uint8_t*)dst_c, chroma->stride, (const IntraPredSamples*)&samples);
+        FUNC16(transform_add_chroma)(&r->transform_funcs, coeffs, iCbCr, job->MbHeightC, dst_c, chroma->stride);
+    }
+}
+
+/**
+ * @brief predict a partition of the inter macroblock from the motion data of its upper-left 4x4 block
+ * @see 8.4.2 Decoding process for Inter prediction samples
+ */
+static int FUNC16(predict_partition)(Reconstructor* r, const ReconstructJob* job, const ReconstructSlice* slice, int32_t CurrMbAddr, int32_t mb_x, int32_t mb_y,
+                                     int32_t x4, int32_t y4, int32_t w4, int32_t h4) {
+    const FrameOrField* ff = job->ff;
+    const RefPicLists* lists = &slice->ref_lists;
+    int32_t blk = CurrMbAddr * 16 + y4 * 4 + x4;
+    int32_t refIdx[2] = {ff->ref_idxs[0][blk], ff->ref_idxs[1][blk]};
+    const FrameOrField* refs[2] = {0, 0};
+    pixel pred_l1[16 * 16];
+
+    for (int32_t list = 0; list < 2; list++) {
+        if (refIdx[list] < 0) {
+            continue;
+        }
+        if (refIdx[list] >= lists->num[list] || !lists->entries[list][refIdx[list]].ff || lists->entries[list][refIdx[list]].ff->plane_count != ff->plane_count) {
+            return ERR_INVALID_REF_IDX;
+        }
+        refs[list] = lists->entries[list][refIdx[list]].ff;
+    }
+    if (!refs[0] && !refs[1]) {
+        return ERR_INVALID_REF_IDX;
+    }
+
+    int32_t width = w4 * 4;
+    int32_t height = h4 * 4;
+    int32_t xAL = mb_x * 16 + x4 * 4;
+    int32_t yAL = mb_y * 16 + y4 * 4;
+    int32_t SubHeightC = job->ChromaArrayType ? 16 / job->MbHeightC : 1;
+
+    for (int32_t iCx = 0; iCx < (job->ChromaArrayType ? 3 : 1); iCx++) {
+        const SamplePlane* plane = &ff->planes[iCx];
+        int32_t w = iCx ? width * job->MbWidthC / 16 : width;
+        int32_t h = iCx ? height * job->MbHeightC / 16 : height;
+        int32_t x = iCx ? xAL * job->MbWidthC / 16 : xAL;
+        int32_t y = iCx ? yAL * job->MbHeightC / 16 : yAL;
+        pixel* dst = (pixel*)plane->data + (ptrdiff_t)y * plane->stride + x;
+        int32_t first = 1;
+
+        for (int32_t list = 0; list < 2; list++) {
+            if (!refs[list]) {
+                continue;
+            }
+
+            const SamplePlane* ref = &refs[list]->planes[iCx];
+            pixel* out = first ? dst : pred_l1;
+            int32_t out_stride = first ? plane->stride : 16;
+            int16_t mv[2] = {ff->mvs[list][blk * 2], ff->mvs[list][blk * 2 + 1]};
+
+            /* 8.4.2.2: the Cb and Cr samples of ChromaArrayType equal to 3 are interpolated like the luma samples */
+            if (iCx == 0 || job->ChromaArrayType == 3) {
+                FUNC16(mc_luma)(&r->inter_funcs, out, out_stride, (const pixel*)ref->data, ref->stride, ref->width, ref->height, x, y, mv, w, h);
+            } else {
+                /* Table 8-10: the chroma vector of a field of ChromaArrayType 1 refers to the field of the other parity a quarter chroma row off */
+                if (job->field_parity >= 0 && job->ChromaArrayType == 1) {
+                    int32_t ref_parity = refs[list] == refs[list]->parent->bottom_field;
+                    if (ref_parity != job->field_parity) {
+                        mv[1] = (int16_t)(mv[1] + (ref_parity ? -2 : 2));
+                    }
+                }
+                FUNC16(mc_chroma)(&r->inter_funcs, out, out_stride, (const pixel*)ref->data, ref->stride, ref->width, ref->height, x, y, mv, SubHeightC, w, h);
+            }
+            first = 0;
+        }
+
+        weighted_sample_prediction(&r->inter_funcs, &slice->weights, 0, iCx, refs[0] ? refIdx[0] : -1, refs[1] ? refIdx[1] : -1, (uint8_t*)dst, plane->stride,
+                                   (const uint8_t*)pred_l1, 16, w, h);
+    }
+
+    return ERR_OK;
+}
+
+static int FUNC16(reconstruct_inter)(Reconstructor* r, const ReconstructJob* job, const ReconstructSlice* slice, const MacroBlock* mb, int32_t CurrMbAddr,
+                                     int32_t mb_x, int32_t mb_y, const TransformCoeffsT* coeffs) {
+    const FrameOrField* ff = job->ff;
+    int err_code = ERR_OK;
+
+    /* the partitions are predicted as the largest blocks of uniform motion, which gives the same samples as the 4x4 blocks */
+    int32_t first_blk = CurrMbAddr * 16;
+    int32_t uniform = 1;
+    for (int32_t i = 0; i < 4 && uniform; i++) {
+        uniform = same_motion_8x8(ff, first_blk, i % 2, i / 2) && same_motion(ff, first_blk, first_blk + (i / 2) * 8 + (i % 2) * 2);
+    }
+
+    if (uniform) {
+        err_code = FUNC16(predict_partition)(r, job, slice, CurrMbAddr, mb_x, mb_y, 0, 0, 4, 4);
+    } else {
+        for (int32_t i = 0; i < 4 && err_code >= 0; i++) {
+            int32_t x8 = i % 2;
+            int32_t y8 = i / 2;
+            if (same_motion_8x8(ff, first_blk, x8, y8)) {
+                err_code = FUNC16(predict_partition)(r, job, slice, CurrMbAddr, mb_x, mb_y, x8 * 2, y8 * 2, 2, 2);
+                continue;
+            }
+            for (int32_t j = 0; j < 4 && err_code >= 0; j++) {
+                err_code = FUNC16(predict_partition)(r, job, slice, CurrMbAddr, mb_x, mb_y, x8 * 2 + j % 2, y8 * 2 + j / 2, 1, 1);
+            }
+        }
+    }
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    for (int32_t iComp = 0; iComp < (job->ChromaArrayType == 3 ? 3 : 1); iComp++) {
+        const SamplePlane* plane = &ff->planes[iComp];
+        FUNC16(transform_add_luma)(&r->transform_funcs, coeffs, iComp, mb->transform_size_8x8_flag, (pixel*)plane->data + (ptrdiff_t)mb_y * 16 * plane->stride + mb_x * 16,
+                                   plane->stride);
+    }
+    for (int32_t iCbCr = 0; iCbCr < 2 && (job->ChromaArrayType == 1 || job->ChromaArrayType == 2); iCbCr++) {
+        const SamplePlane* chroma = &ff->planes[1 + iCbCr];
+        pixel* dst_c = (pixel*)chroma->data + (ptrdiff_t)mb_y * job->MbHeightC * chroma->stride + mb_x * job->MbWidthC;
+        FUNC16(transform_add_chroma)(&r->transform_funcs, coeffs, iCbCr, job->MbHeightC, dst_c, chroma->stride);
+    }
+    return ERR_OK;
+}
+
+static void FUNC16(copy_pcm_samples)(const ReconstructJob* job, const dctcoef* samples, int32_t mb_x, int32_t mb_y) {
+    const SamplePlane* luma = &job->ff->planes[0];
+    pixel* dst = (pixel*)luma->data + (ptrdiff_t)mb_y * 16 * luma->stride + mb_x * 16;
+    for (int32_t i = 0; i < 256; i++) {
+        dst[(i / 16) * luma->stride + i % 16] = (pixel)samples[i];
+    }
+
+    int32_t MbWidthC = job->MbWidthC;
+    int32_t MbHeightC = job->MbHeightC;
+    for (int32_t iCbCr = 0; iCbCr < 2 && job->ChromaArrayType; iCbCr++) {
+        const SamplePlane* chroma = &job->ff->planes[1 + iCbCr];
+        pixel* dst_c = (pixel*)chroma->data + (ptrdiff_t)mb_y * MbHeightC * chroma->stride + mb_x * MbWidthC;
+        const dctcoef* samples_c = samples + 256 + iCbCr * MbWidthC * MbHeightC;
+        for (int32_t i = 0; i < MbWidthC * MbHeightC; i++) {
+            dst_c[(i / MbWidthC) * chroma->stride + i % MbWidthC] = (pixel)samples_c[i];
+        }
+    }
+}
+
+/**
+ * @brief reconstruct the packed macroblock from its residual record and the motion data or intra prediction modes decoded by the entropy stage
+ */
+static int FUNC16(reconstruct_residual_macroblock)(Reconstructor* r, const ReconstructJob* job, const ReconstructSlice* slice, int32_t CurrMbAddr) {
+    const FrameOrField* ff = job->ff;
+    const ResidualStore* store = ff->residuals;
+    int32_t mb_x = CurrMbAddr % job->PicWidthInMbs;
+    int32_t mb_y = CurrMbAddr / job->PicWidthInMbs;
+    const MacroBlock* mb = &ff->mb_list[CurrMbAddr];
+    MbResidual record = store->records[CurrMbAddr];
+
+    if (ff->mb_type_names[CurrMbAddr] == I_PCM) {
+        if ((uint64_t)record.offset + store->mb_entries > store->capacity) {
+            return ERR_INVALID_SLICE_DATA;
+        }
+        FUNC16(copy_pcm_samples)(job, (const dctcoef*)store->coeffs + record.offset, mb_x, mb_y);
+        return ERR_OK;
+    }
+
+    /* the kernels read the blocks of the masks only */
+    TransformCoeffsT coeffs;
+    uint32_t size = record_size(&record, mb->transform_size_8x8_flag, store->ChromaArrayType);
+    if ((uint64_t)record.offset + size > store->capacity) {
+        return ERR_INVALID_SLICE_DATA;
+    }
+    int32_t luma_size = mb->transform_size_8x8_flag ? 64 : 16;
+    int32_t chroma_size = store->ChromaArrayType == 3 ? luma_size : 16;
+    coeffs.luma_nz = record.luma_nz;
+    coeffs.luma_ac = record.luma_ac;
+    dctcoef* packed = (dctcoef*)store->coeffs + record.offset;
+    packed = FUNC16(copy_blocks)(coeffs.luma, packed, record.luma_nz, record.luma_ac, luma_size, 1);
+    for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+        coeffs.chroma_nz[iCbCr] = record.chroma_nz[iCbCr];
+        coeffs.chroma_ac[iCbCr] = record.chroma_ac[iCbCr];
+        packed = FUNC16(copy_blocks)(coeffs.chroma[iCbCr], packed, record.chroma_nz[iCbCr], record.chroma_ac[iCbCr], chroma_size, 1);
+    }
+
+    if (mb_is_intra(mb)) {
+        FUNC16(reconstruct_intra)(r, job, mb, CurrMbAddr, mb_x, mb_y, &coeffs);
+        return ERR_OK;
+    }
+    return FUNC16(reconstruct_inter)(r, job, slice, mb, CurrMbAddr, mb_x, mb_y, &coeffs);
+}
@@ -0,0 +1,499 @@
+#include "h264decoder/h264_ref_list.h"
+
+#include <string.h>
+
+/**
+ * @brief a frame store with the key it is ordered by
+ */
+typedef struct {
+    Picture* picture;
+    int32_t key;
+} SortedFrame;
+
+/**
+ * @brief sort the frame stores by their keys in ascending order, the lists hold at most H264_MAX_DPB_FRAMES frame stores
+ */
+static void sort_frames(SortedFrame* frames, int32_t count) {
+    for (int32_t i = 1; i < count; i++) {
+        SortedFrame frame = frames[i];
+        int32_t j = i - 1;
+        while (j >= 0 && frames[j].key > frame.key) {
+            frames[j + 1] = frames[j];
+            j--;
+        }
+        frames[j + 1] = frame;
+    }
+}
+
+/**
+ * @brief the reference frame or field of the frame store, parity is 0 for the top field and 1 for the bottom field, -1 for the frame
+ */
+static void set_entry(RefPicEntry* entry, Picture* picture, int32_t parity, uint8_t long_term) {
+    entry->ff = parity < 0 ? picture->frame : (parity ? picture->bottom_field : picture->top_field);
+    entry->poc = entry->ff->poc;
+    entry->long_term = long_term;
+}
+
+static inline int has_marking(const Picture* picture, uint8_t marking) { return picture->ref_marking[0] == marking || picture->ref_marking[1] == marking; }
+
+static inline int is_frame_marked(const Picture* picture, uint8_t marking) { return picture->ref_marking[0] == marking && picture->ref_marking[1] == marking; }
+
+/**
+ * @brief PicOrderCnt( ) of the frame store, Min( ) of the fields with the marking, so a frame store with one field used for reference is ordered by that field
+ * @see 8.2.4.2.4 Initialisation process for reference picture lists for B slices in fields
+ */
+static int32_t marked_picture_order_count(const Picture* picture, uint8_t marking) {
+    if (picture->ref_marking[0] != marking) {
+        return picture->bottom_field->poc;
+    }
+    if (picture->ref_marking[1] != marking) {
+        return picture->top_field->poc;
+    }
+    return codec_min(picture->top_field->poc, picture->bottom_field->poc);
+}
+
+/**
+ * @brief Decoding process for picture numbers, the numbers of the frame stores for the current frame or field
+ * @see 8.2.4.1 Decoding process for picture numbers
+ */
+static void derive_picture_numbers(DecodedPictureBuffer* dpb, const SliceHeader* header) {
+    int32_t frame_num = (int32_t)header->frame_num;
+
+    for (int32_t i = 0; i < dpb->size; i++) {
+        Picture* pic = dpb->frames[i];
+
+        /* equation 8-27 */
+        pic->FrameNumWrap = pic->FrameNum > frame_num ? pic->FrameNum - dpb->MaxFrameNum : pic->FrameNum;
+
+        /* equations 8-28 to 8-33, the fields of the same parity as the current field get the odd numbers */
+        for (int32_t parity = 0; parity < 2; parity++) {
+            if (!header->field_pic_flag) {
+                pic->PicNum[parity] = pic->FrameNumWrap;
+                pic->LongTermPicNum[parity] = pic->LongTermFrameIdx;
+            } else {
+                int32_t same_parity = parity == (int32_t)header->bottom_field_flag;
+                pic->PicNum[parity] = 2 * pic->FrameNumWrap + same_parity;
+                pic->LongTermPicNum[parity] = 2 * pic->LongTermFrameIdx + same_parity;
+            }
+        }
+    }
+}
+
+/**
+ * @brief collect the frame stores with the marking, ordered by the key
+ *
+ * @param dpb the DPB
+ * @param marking REF_PIC_SHORT_TERM or REF_PIC_LONG_TERM
+ * @param whole_frames 1 to collect the frames with both fields marked, 0 to collect the frame stores with any field marked
+ * @param key the key of a frame store
+ * @param frames output parameter. the frame stores in the ascending order of the keys
+ * @return int32_t the number of the frame stores
+ */
+static int32_t collect_frames(const DecodedPictureBuffer* dpb, uint8_t marking, int whole_frames, int32_t (*key)(const Picture*), SortedFrame* frames) {
+    int32_t count = 0;
+
+    for (int32_t i = 0; i < dpb->size; i++) {
+        Picture* pic = dpb->frames[i];
+        if (whole_frames ? is_frame_marked(pic, marking) : has_marking(pic, marking)) {
+            frames[count].picture = pic;
+            frames[count].key = key(pic);
+            count++;
+        }
+    }
+
+    sort_frames(frames, count);
+    return count;
+}
+
+static int32_t descending_pic_num(const Picture* picture) { return -picture->FrameNumWrap; }
+
+static int32_t ascending_long_term_frame_idx(const Picture* picture) { return picture->LongTermFrameIdx; }
+
+/* only the short-term frame stores are ordered by POC, 8.2.4.2.3 and 8.2.4.2.4 */
+static int32_t ascending_poc(const Picture* picture) { return marked_picture_order_count(picture, REF_PIC_SHORT_TERM); }
+
+/**
+ * @brief append the frames of the frame stores to the list
+ */
+static int32_t append_frames(RefPicEntry* list, int32_t count, const SortedFrame* frames, int32_t frame_count, uint8_t long_term) {
+    for (int32_t i = 0; i < frame_count && count < H264_MAX_REFS; i++) {
+        set_entry(&list[count++], frames[i].picture, -1, long_term);
+    }
+    return count;
+}
+
+/**
+ * @brief append the frame stores ordered by POC, first the frame stores with a POC less than or equal to poc in descending order and then the others in
+ * ascending order, or the other way round if after_first is 1
+ *
+ * @param frames the frame stores in the ascending order of POC
+ * @param frame_count the number of the frame stores
+ * @param poc PicOrderCnt( CurrPic )
+ * @param after_first 1 for RefPicList1, the frame stores following the current picture in the output order first
+ * @param ordered output parameter. the ordered frame stores
+ */
+static void order_by_poc(const SortedFrame* frames, int32_t frame_count, int32_t poc, int after_first, SortedFrame* ordered) {
+    int32_t split = 0;
+    while (split < frame_count && frames[split].key <= poc) {
+        split++;
+    }
+
+    int32_t n = 0;
+    if (after_first) {
+        for (int32_t i = split; i < frame_count; i++) {
+            ordered[n++] = frames[i];
+        }
+    }
+    for (int32_t i = split - 1; i >= 0; i--) {
+        ordered[n++] = frames[i];
+    }
+    if (!after_first) {
+        for (int32_t i = split; i < frame_count; i++) {
+            ordered[n++] = frames[i];
+        }
+    }
+}
+
+/**
+ * @brief take the fields with the marking from the ordered frame stores, alternating the parities starting with the parity of the current field. when no field
+ * of one parity is left, the fields of the other parity are appended in their order
+ * @see 8.2.4.2.5 Initialisation process for reference picture lists in fields
+ *
+ * @param list the reference picture list
+ * @param count the number of the entries of the list
+ * @param frames the ordered frame stores
+ * @param frame_count the number of the frame stores
+ * @param marking REF_PIC_SHORT_TERM or REF_PIC_LONG_TERM
+ * @param bottom_field_flag the parity of the current field
+ * @return int32_t the number of the entries of the list
+ */
+static int32_t append_fields(RefPicEntry* list, int32_t count, const SortedFrame* frames, int32_t frame_count, uint8_t marking, int32_t bottom_field_flag) {
+    int32_t next[2] = {0, 0};
+
+    for (int32_t parity = bottom_field_flag; count < H264_MAX_REFS; parity ^= 1) {
+        while (next[parity] < frame_count && frames[next[parity]].picture->ref_marking[parity] != marking) {
+            next[parity]++;
+        }
+        if (next[parity] == frame_count) {
+            parity ^= 1;
+            while (next[parity] < frame_count && frames[next[parity]].picture->ref_marking[parity] != marking) {
+                next[parity]++;
+            }
+            if (next[parity] == frame_count) {
+                break;
+            }
+        }
+
+        set_entry(&list[count++], frames[next[parity]].picture, parity, marking == REF_PIC_LONG_TERM);
+        next[parity]++;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Initialisation process for the reference picture list for P and SP slices
+ * @see 8.2.4.2.1 Initialisation process for the reference picture list for P and SP slices in frames
+ * @see 8.2.4.2.2 Initialisation process for the reference picture list for P and SP slices in fields
+ */
+static void init_p_list(RefPicListCache* cache, const DecodedPictureBuffer* dpb, const SliceHeader* header) {
+    SortedFrame short_term[H264_MAX_DPB_FRAMES + 1];
+    SortedFrame long_term[H264_MAX_DPB_FRAMES + 1];
+    int whole_frames = !header->field_pic_flag;
+
+    /* short-term by descending PicNum or FrameNumWrap, long-term by ascending LongTermPicNum or LongTermFrameIdx */
+    int32_t short_count = collect_frames(dpb, REF_PIC_SHORT_TERM, whole_frames, descending_pic_num, short_term);
+    int32_t long_count = collect_frames(dpb, REF_PIC_LONG_TERM, whole_frames, ascending_long_term_frame_idx, long_term);
+
+    if (whole_frames) {
+        cache->p_count = append_frames(cache->p_list, 0, short_term, short_count, 0);
+        cache->p_count = append_frames(cache->p_list, cache->p_count, long_term, long_count, 1);
+    } else {
+        int32_t bottom_field_flag = header->bottom_field_flag;
+        cache->p_count = append_fields(cache->p_list, 0, short_term, short_count, REF_PIC_SHORT_TERM, bottom_field_flag);
+        cache->p_count = append_fields(cache->p_list, cache->p_count, long_term, long_count, REF_PIC_LONG_TERM, bottom_field_flag);
+    }
+
+    cache->has_p_list = 1;
+    cache->init_count++;
+}
+
+/**
+ * @brief Initialisation process for reference picture lists for B slices
+ * @see 8.2.4.2.3 Initialisation process for reference picture lists for B slices in frames
+ * @see 8.2.4.2.4 Initialisation process for reference picture lists for B slices in fields
+ */
+static void init_b_lists(RefPicListCache* cache, const DecodedPictureBuffer* dpb, const Picture* picture, const SliceHeader* header) {
+    SortedFrame short_term[H264_MAX_DPB_FRAMES + 1];
+    SortedFrame ordered[H264_MAX_DPB_FRAMES + 1];
+    SortedFrame long_term[H264_MAX_DPB_FRAMES + 1];
+    int whole_frames = !header->field_pic_flag;
+    int32_t bottom_field_flag = header->bottom_field_flag;
+
+    int32_t poc = picture->frame->poc;
+    if (header->field_pic_flag) {
+        poc = bottom_field_flag ? picture->bottom_field->poc : picture->top_field->poc;
+    }
+
+    int32_t short_count = collect_frames(dpb, REF_PIC_SHORT_TERM, whole_frames, ascending_poc, short_term);
+    int32_t long_count = collect_frames(dpb, REF_PIC_LONG_TERM, whole_frames, ascending_long_term_frame_idx, long_term);
+
+    for (int32_t list = 0; list < 2; list++) {
+        RefPicEntry* entries = cache->b_lists[list];
+        int32_t count = 0;
+
+        order_by_poc(short_term, short_count, poc, list, ordered);
+        if (whole_frames) {
+            count = append_frames(entries, count, ordered, short_count, 0);
+            count = append_frames(entries, count, long_term, long_count, 1);
+        } else {
+            count = append_fields(entries, count, ordered, short_count, REF_PIC_SHORT_TERM, bottom_field_flag);
+            count = append_fields(entries, count, long_term, long_count, REF_PIC_LONG_TERM, bottom_field_flag);
+        }
+        cache->b_count[list] = count;
+    }
+
+    /* RefPicList1 with more than one entry is not identical to RefPicList0, its first two entries are switched otherwise */
+    int is_identical = cache->b_count[0] == cache->b_count[1];
+    for (int32_t i = 0; is_identical && i < cache->b_count[1]; i++) {
+        is_identical = cache->b_lists[0][i].ff == cache->b_lists[1][i].ff;
+    }
+    if (cache->b_count[1] > 1 && is_identical) {
+        RefPicEntry entry = cache->b_lists[1][0];
+        cache->b_lists[1][0] = cache->b_lists[1][1];
+        cache->b_lists[1][1] = entry;
+    }
+
+    cache->has_b_lists = 1;
+    cache->init_count++;
+}
+
+/**
+ * @brief find the reference frame or field with the marking and the picture number among the frame stores
+ *
+ * @param dpb the DPB
+ * @param header the slice header
+ * @param marking REF_PIC_SHORT_TERM for PicNum or REF_PIC_LONG_TERM for LongTermPicNum
+ * @param num the picture number
+ * @param entry output parameter. the entry of the reference picture
+ * @return int 0 on success, negative value if no reference picture has the number
+ */
+static int find_reference(const DecodedPictureBuffer* dpb, const SliceHeader* header, uint8_t marking, int32_t num, RefPicEntry* entry) {
+    for (int32_t i = 0; i < dpb->size; i++) {
+        Picture* pic = dpb->frames[i];
+
+        for (int32_t parity = 0; parity < 2; parity++) {
+            const int32_t* nums = marking == REF_PIC_SHORT_TERM ? pic->PicNum : pic->LongTermPicNum;
+            if (pic->ref_marking[parity] != marking || nums[parity] != num) {
+                continue;
+            }
+
+            if (!header->field_pic_flag) {
+                if (!is_frame_marked(pic, marking)) {
+                    break;
+                }
+                set_entry(entry, pic, -1, marking == REF_PIC_LONG_TERM);
+            } else {
+                set_entry(entry, pic, parity, marking == REF_PIC_LONG_TERM);
+            }
+            return ERR_OK;
+        }
+    }
+
+    return ERR_INVALID_REF_PIC_LIST_PARAM;
+}
+
+/**
+ * @brief PicNumF( ) or LongTermPicNumF( ) of the entry, equations 8-37 and 8-38. the entries of the other marking get a number no reference picture has
+ */
+static int32_t entry_picture_number(const RefPicEntry* entry, uint8_t marking) {
+    if (!entry->ff || entry->long_term != (marking == REF_PIC_LONG_TERM)) {
+        return INT32_MIN;
+    }
+
+    const Picture* pic = entry->ff->parent;
+    int32_t parity = entry->ff == pic->bottom_field;
+    return marking == REF_PIC_SHORT_TERM ? pic->PicNum[parity] : pic->LongTermPicNum[parity];
+}
+
+/**
+ * @brief place the reference picture at refIdxLX and remove its other entry from the list, equations 8-37 and 8-38
+ *
+ * @param list the reference picture list, num_ref_idx_lX_active_minus1 + 2 entries
+ * @param num num_ref_idx_lX_active_minus1 + 1
+ * @param refIdxLX the index of the modification, it is incremented
+ * @param entry the reference picture
+ * @param marking the marking the entry is matched by
+ * @param pic_num picNumLX or LongTermPicNum
+ */
+static void insert_reference(RefPicEntry* list, int32_t num, int32_t* refIdxLX, const RefPicEntry* entry, uint8_t marking, int32_t pic_num) {
+    for (int32_t cIdx = num; cIdx > *refIdxLX; cIdx--) {
+        list[cIdx] = list[cIdx - 1];
+    }
+    list[(*refIdxLX)++] = *entry;
+
+    int32_t nIdx = *refIdxLX;
+    for (int32_t cIdx = *refIdxLX; cIdx <= num; cIdx++) {
+        if (entry_picture_number(&list[cIdx], marking) != pic_num) {
+            list[nIdx++] = list[cIdx];
+        }
+    }
+}
+
+/**
+ * @brief the modification operations of the list, the layouts of rplm_l0 and rplm_l1 are the same
+ */
+static void get_modification(const RPLM* rplm, int32_t list, size_t i, uint32_t* modification_of_pic_nums_idc, uint32_t* abs_diff_pic_num_minus1,
+                             uint32_t* long_term_pic_num) {
+    if (list == 0) {
+        *modification_of_pic_nums_idc = rplm->rplm_l0[i].modification_of_pic_nums_idc;
+        *abs_diff_pic_num_minus1 = rplm->rplm_l0[i].abs_diff_pic_num_minus1;
+        *long_term_pic_num = rplm->rplm_l0[i].long_term_pic_num;
+    } else {
+        *modification_of_pic_nums_idc = rplm->rplm_l1[i].modification_of_pic_nums_idc;
+        *abs_diff_pic_num_minus1 = rplm->rplm_l1[i].abs_diff_pic_num_minus1;
+        *long_term_pic_num = rplm->rplm_l1[i].long_term_pic_num;
+    }
+}
+
+/**
+ * @brief Modification process for reference picture lists
+ * @see 8.2.4.3 Modification process for reference picture lists
+ *
+ * @param cache the cache holding CurrPicNum and MaxPicNum
+ * @param dpb the DPB
+ * @param header the slice header
+ * @param list 0 for RefPicList0 and 1 for RefPicList1
+ * @param entries the reference picture list with num entries, it has one more entry for the modification
+ * @param num num_ref_idx_lX_active_minus1 + 1
+ * @return int 0 on success, negative value on error
+ */
+static int modify_ref_pic_list(const RefPicListCache* cache, const DecodedPictureBuffer* dpb, const SliceHeader* header, int32_t list, RefPicEntry* entries,
+                               int32_t num) {
+    const RPLM* rplm = &header->rplm;
+    size_t len = list ? rplm->rplm_l1_len : rplm->rplm_l0_len;
+    int32_t picNumLXPred = cache->CurrPicNum;
+    int32_t refIdxLX = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        uint32_t modification_of_pic_nums_idc = 0;
+        uint32_t abs_diff_pic_num_minus1 = 0;
+        uint32_t long_term_pic_num = 0;
+        RefPicEntry entry;
+
+        get_modification(rplm, list, i, &modification_of_pic_nums_idc, &abs_diff_pic_num_minus1, &long_term_pic_num);
+        if (modification_of_pic_nums_idc == 3) {
+            break;
+        }
+        if (refIdxLX >= num || modification_of_pic_nums_idc > 2) {
+            return ERR_INVALID_REF_PIC_LIST_PARAM;
+        }
+
+        if (modification_of_pic_nums_idc == 2) {
+            /* 8.2.4.3.2 modification process of reference picture lists for long-term reference pictures */
+            if (find_reference(dpb, header, REF_PIC_LONG_TERM, (int32_t)long_term_pic_num, &entry) < 0) {
+                return ERR_INVALID_REF_PIC_LIST_PARAM;
+            }
+            insert_reference(entries, num, &refIdxLX, &entry, REF_PIC_LONG_TERM, (int32_t)long_term_pic_num);
+            continue;
+        }
+
+        /* 8.2.4.3.1 modification process of reference picture lists for short-term reference pictures, equations 8-34 to 8-36 */
+        int32_t abs_diff_pic_num = (int32_t)abs_diff_pic_num_minus1 + 1;
+        int32_t picNumLXNoWrap = 0;
+        if (modification_of_pic_nums_idc == 0) {
+            picNumLXNoWrap = picNumLXPred - abs_diff_pic_num;
+            if (picNumLXNoWrap < 0) {
+                picNumLXNoWrap += cache->MaxPicNum;
+            }
+        } else {
+            picNumLXNoWrap = picNumLXPred + abs_diff_pic_num;
+            if (picNumLXNoWrap >= cache->MaxPicNum) {
+                picNumLXNoWrap -= cache->MaxPicNum;
+            }
+        }
+        picNumLXPred = picNumLXNoWrap;
+
+        int32_t picNumLX = picNumLXNoWrap > cache->CurrPicNum ? picNumLXNoWrap - cache->MaxPicNum : picNumLXNoWrap;
+        if (find_reference(dpb, header, REF_PIC_SHORT_TERM, picNumLX, &entry) < 0) {
+            return ERR_INVALID_REF_PIC_LIST_PARAM;
+        }
+        insert_reference(entries, num, &refIdxLX, &entry, REF_PIC_SHORT_TERM, picNumLX);
+    }
+
+    return ERR_OK;
+}
+
+void reset_ref_pic_list_cache(RefPicListCache* cache) {
+    cache->structure = 0;
+    cache->has_p_list = 0;
+    cache->has_b_lists = 0;
+}
+
+int construct_ref_pic_lists(RefPicListCache* cache, DecodedPictureBuffer* dpb, const Picture* picture, const SliceHeader* header, RefPicLists* lists) {
+    int32_t slice_type = (int32_t)(header->slice_type % 5);
+    int32_t structure = header->field_pic_flag ? (header->bottom_field_flag ? 2 : 1) : 3;
+
+    memset(lists, 0, sizeof(RefPicLists));
+    if (slice_type == SLICE_TYPE_I || slice_type == SLICE_TYPE_SI) {
+        return ERR_OK;
+    }
+
+    /* the first slice of the frame or field derives the picture numbers, the marking of the DPB does not change until the picture is decoded */
+    if (cache->structure != structure || cache->decode_index != picture->decode_index) {
+        reset_ref_pic_list_cache(cache);
+        cache->decode_index = picture->decode_index;
+        cache->structure = structure;
+
+        /* CurrPicNum and MaxPicNum, see the semantics of frame_num in 7.4.3 */
+        cache->MaxPicNum = header->field_pic_flag ? 2 * dpb->MaxFrameNum : dpb->MaxFrameNum;
+        cache->CurrPicNum = header->field_pic_flag ? 2 * (int32_t)header->frame_num + 1 : (int32_t)header->frame_num;
+        derive_picture_numbers(dpb, header);
+    }
+
+    const RefPicEntry* initial[2] = {cache->p_list, 0};
+    int32_t initial_count[2] = {0, 0};
+    int32_t list_count = 1;
+
+    if (slice_type == SLICE_TYPE_B) {
+        if (!cache->has_b_lists) {
+            init_b_lists(cache, dpb, picture, header);
+        }
+        initial[0] = cache->b_lists[0];
+        initial[1] = cache->b_lists[1];
+        initial_count[0] = cache->b_count[0];
+        initial_count[1] = cache->b_count[1];
+        list_count = 2;
+    } else {
+        if (!cache->has_p_list) {
+            init_p_list(cache, dpb, header);
+        }
+        initial_count[0] = cache->p_count;
+    }
+
+    lists->num[0] = (int32_t)header->num_ref_idx_l0_active_minus1 + 1;
+    if (list_count == 2) {
+        lists->num[1] = (int32_t)header->num_ref_idx_l1_active_minus1 + 1;
+    }
+
+    for (int32_t list = 0; list < list_count; list++) {
+        /* the initial list is truncated to num_ref_idx_lX_active_minus1 + 1 entries, the entries beyond the initial list stay "no reference picture" */
+        RefPicEntry entries[H264_MAX_REFS + 1];
+        int32_t num = codec_min(lists->num[list], H264_MAX_REFS);
+
+        memset(entries, 0, sizeof(entries));
+        memcpy(entries, initial[list], codec_min(num, initial_count[list]) * sizeof(RefPicEntry));
+
+        uint8_t modification_flag = list ? header->rplm.ref_pic_list_modification_flag_l1 : header->rplm.ref_pic_list_modification_flag_l0;
+        if (modification_flag) {
+            int err_code = modify_ref_pic_list(cache, dpb, header, list, entries, num);
+            if (err_code < 0) {
+                return err_code;
+            }
+        }
+
+        memcpy(lists->entries[list], entries, num * sizeof(RefPicEntry));
+    }
+
+    return ERR_OK;
+}
@@ -0,0 +1,202 @@
+#include "h264decoder/h264_slice_thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief free the slice group maps which the task took over, the RBSP buffer is kept for the next slice of the task
+ */
+static void clear_slice_task(SliceTask* task) {
+    if (task->header.mapUnitToSliceGroupMap) {
+        free(task->header.mapUnitToSliceGroupMap);
+        task->header.mapUnitToSliceGroupMap = 0;
+    }
+    if (task->header.MbToSliceGroupMap) {
+        free(task->header.MbToSliceGroupMap);
+        task->header.MbToSliceGroupMap = 0;
+    }
+}
+
+static void* slice_thread_main(void* arg) {
+    SliceThreads* threads = (SliceThreads*)arg;
+
+    pthread_mutex_lock(&threads->mutex);
+    while (!threads->quit) {
+        SliceTask* task = threads->first_task;
+        if (!task) {
+            pthread_cond_wait(&threads->work, &threads->mutex);
+            continue;
+        }
+        threads->first_task = task->next;
+        if (!threads->first_task) {
+            threads->last_task = 0;
+        }
+
+        pthread_mutex_unlock(&threads->mutex);
+        int err_code = slice_data(&task->view, &task->scratch, &task->reader, &task->header);
+        if (err_code >= 0) {
+            rbsp_slice_trailing_bits(&task->reader, task->header.pps->entropy_coding_mode_flag);
+        }
+        clear_slice_task(task);
+        pthread_mutex_lock(&threads->mutex);
+
+        if (err_code < 0 && threads->err_code == ERR_OK) {
+            threads->err_code = err_code;
+        }
+        task->next = threads->free_tasks;
+        threads->free_tasks = task;
+        if (--threads->pending_tasks == 0) {
+            pthread_cond_broadcast(&threads->done);
+        }
+    }
+    pthread_mutex_unlock(&threads->mutex);
+
+    return 0;
+}
+
+/**
+ * @brief stop and join the first count worker threads
+ */
+static void stop_worker_threads(SliceThreads* threads, int32_t count) {
+    pthread_mutex_lock(&threads->mutex);
+    threads->quit = 1;
+    pthread_cond_broadcast(&threads->work);
+    pthread_mutex_unlock(&threads->mutex);
+
+    for (int32_t i = 0; i < count; i++) {
+        pthread_join(threads->threads[i], 0);
+    }
+}
+
+SliceThreads* create_slice_threads(int32_t thread_count) {
+    if (thread_count < 1 || thread_count > H264_MAX_SLICE_THREADS) {
+        return 0;
+    }
+
+    SliceThreads* threads = (SliceThreads*)malloc(sizeof(SliceThreads));
+    if (!threads) {
+        return 0;
+    }
+    memset(threads, 0, sizeof(SliceThreads));
+    threads->thread_count = thread_count;
+
+    if (pthread_mutex_init(&threads->mutex, 0)) {
+        free(threads);
+        return 0;
+    }
+    if (pthread_cond_init(&threads->work, 0)) {
+        pthread_mutex_destroy(&threads->mutex);
+        free(threads);
+        return 0;
+    }
+    if (pthread_cond_init(&threads->done, 0)) {
+        pthread_cond_destroy(&threads->work);
+        pthread_mutex_destroy(&threads->mutex);
+        free(threads);
+        return 0;
+    }
+
+    for (int32_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&threads->threads[i], 0, slice_thread_main, threads)) {
+            stop_worker_threads(threads, i);
+            pthread_cond_destroy(&threads->done);
+            pthread_cond_destroy(&threads->work);
+            pthread_mutex_destroy(&threads->mutex);
+            free(threads);
+            return 0;
+        }
+    }
+
+    return threads;
+}
+
+void free_slice_threads(SliceThreads* threads) {
+    wait_for_slice_tasks(threads);
+    stop_worker_threads(threads, threads->thread_count);
+
+    while (threads->free_tasks) {
+        SliceTask* task = threads->free_tasks;
+        threads->free_tasks = task->next;
+        free(task->rbsp_buffer);
+        free(task);
+    }
+
+    pthread_cond_destroy(&threads->done);
+    pthread_cond_destroy(&threads->work);
+    pthread_mutex_destroy(&threads->mutex);
+    free(threads);
+}
+
+int queue_slice_task(SliceThreads* threads, Picture* picture, SliceHeader* header, uint8_t** rbsp_buffer, size_t* rbsp_capacity, const RBSPReader* reader,
+                     const RefPicLists* ref_lists) {
+    FrameOrField* ff = picture->frame;
+    if (header->field_pic_flag) {
+        ff = header->bottom_field_flag ? picture->bottom_field : picture->top_field;
+    }
+
+    pthread_mutex_lock(&threads->mutex);
+    SliceTask* task = threads->free_tasks;
+    if (task) {
+        threads->free_tasks = task->next;
+    }
+    pthread_mutex_unlock(&threads->mutex);
+
+    if (!task) {
+        task = (SliceTask*)malloc(sizeof(SliceTask));
+        if (!task) {
+            return ERR_OOM;
+        }
+        memset(task, 0, sizeof(SliceTask));
+    }
+
+    /* the slice number and the reference picture lists are assigned in the decoding order */
+    int err_code = init_frame_or_field(ff, header, ref_lists);
+    if (err_code < 0) {
+        pthread_mutex_lock(&threads->mutex);
+        task->next = threads->free_tasks;
+        threads->free_tasks = task;
+        pthread_mutex_unlock(&threads->mutex);
+        return err_code;
+    }
+
+    /* the view keeps slice_count, so the slice number and get_current_ref_lists() refer to this slice while the later slices are started */
+    task->view = *ff;
+    memcpy(&task->header, header, sizeof(SliceHeader));
+    swap_rbsp_buffers(&task->rbsp_buffer, &task->rbsp_capacity, rbsp_buffer, rbsp_capacity);
+    task->reader = *reader;
+    task->next = 0;
+
+    pthread_mutex_lock(&threads->mutex);
+    if (threads->last_task) {
+        threads->last_task->next = task;
+    } else {
+        threads->first_task = task;
+    }
+    threads->last_task = task;
+    threads->pending_tasks++;
+    pthread_cond_signal(&threads->work);
+    pthread_mutex_unlock(&threads->mutex);
+
+    /* the slice group maps are freed with the task */
+    header->mapUnitToSliceGroupMap = 0;
+    header->MbToSliceGroupMap = 0;
+
+    return ERR_OK;
+}
+
+void wait_for_slice_tasks(SliceThreads* threads) {
+    pthread_mutex_lock(&threads->mutex);
+    while (threads->pending_tasks > 0) {
+        pthread_cond_wait(&threads->done, &threads->mutex);
+    }
+    pthread_mutex_unlock(&threads->mutex);
+}
+
+int take_slice_thread_error(SliceThreads* threads) {
+    pthread_mutex_lock(&threads->mutex);
+    int err_code = threads->err_code;
+    threads->err_code = ERR_OK;
+    pthread_mutex_unlock(&threads->mutex);
+
+    return err_code;
+}
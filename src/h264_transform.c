@@ -0,0 +1,302 @@
+#include "h264decoder/h264_transform.h"
+
+#include <string.h>
+
+#include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_math.h"
+
+/* @see Table 8-13 – Specification of mapping of idx to cij for zig-zag and field scan */
+const uint8_t g_zigzag_scan_4x4[16] = {0, 1, 4, 8, 5, 2, 3, 6, 9, 12, 13, 10, 7, 11, 14, 15};
+const uint8_t g_field_scan_4x4[16] = {0, 4, 1, 8, 12, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15};
+
+/* @see Table 8-14 – Specification of mapping of idx to cij for 8x8 luma zig-zag and field scan */
+const uint8_t g_zigzag_scan_8x8[64] = {0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+                                       35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+const uint8_t g_field_scan_8x8[64] = {0,  8,  16, 1,  9,  24, 32, 17, 2,  25, 40, 48, 56, 33, 10, 3,  18, 41, 49, 57, 26, 11, 4,  19, 34, 42, 50, 58, 27, 12, 5,  20,
+                                      35, 43, 51, 59, 28, 13, 6,  21, 36, 44, 52, 60, 29, 14, 22, 37, 45, 53, 61, 30, 7,  15, 38, 46, 54, 62, 23, 31, 39, 47, 55, 63};
+
+/* the raster block index of luma4x4BlkIdx */
+static const uint8_t g_luma4x4_blk_raster[16] = {0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15};
+
+/* the values of v of normAdjust4x4, see equation 8-315 */
+static const int32_t g_norm_adjust_4x4[6][3] = {{10, 16, 13}, {11, 18, 14}, {13, 20, 16}, {14, 23, 18}, {16, 25, 20}, {18, 29, 23}};
+
+/* the values of v of normAdjust8x8, see equation 8-318 */
+static const int32_t g_norm_adjust_8x8[6][6] = {
+    {20, 18, 32, 19, 25, 24}, {22, 19, 35, 21, 28, 26}, {26, 23, 42, 24, 33, 31}, {28, 25, 45, 26, 35, 33}, {32, 28, 51, 30, 40, 38}, {36, 32, 58, 34, 46, 43},
+};
+
+/* QPC as a function of qPI for qPI greater than or equal to 30, see Table 8-15 – Specification of QPC as a function of qPI */
+static const int32_t g_qpc_table[22] = {29, 30, 31, 32, 32, 33, 34, 34, 35, 35, 36, 36, 37, 37, 37, 38, 38, 38, 39, 39, 39, 39};
+
+/**
+ * @brief the 4x4 inverse transform of the equations 8-338 to 8-353, d is overwritten with h
+ */
+static inline void idct4x4(int32_t* d) {
+    for (int32_t i = 0; i < 4; i++) {
+        int32_t* row = d + i * 4;
+        int32_t e0 = row[0] + row[2];
+        int32_t e1 = row[0] - row[2];
+        int32_t e2 = (row[1] >> 1) - row[3];
+        int32_t e3 = row[1] + (row[3] >> 1);
+
+        row[0] = e0 + e3;
+        row[1] = e1 + e2;
+        row[2] = e1 - e2;
+        row[3] = e0 - e3;
+    }
+
+    for (int32_t j = 0; j < 4; j++) {
+        int32_t* col = d + j;
+        int32_t g0 = col[0] + col[8];
+        int32_t g1 = col[0] - col[8];
+        int32_t g2 = (col[4] >> 1) - col[12];
+        int32_t g3 = col[4] + (col[12] >> 1);
+
+        col[0] = g0 + g3;
+        col[4] = g1 + g2;
+        col[8] = g1 - g2;
+        col[12] = g0 - g3;
+    }
+}
+
+/**
+ * @brief the 1-D 8-point inverse transform of the equations 8-355 to 8-378, the samples are at p[ 0 ], p[ step ], ..., p[ 7 * step ]
+ */
+static inline void idct8(int32_t* p, int32_t step) {
+    int32_t d0 = p[0], d1 = p[step], d2 = p[2 * step], d3 = p[3 * step];
+    int32_t d4 = p[4 * step], d5 = p[5 * step], d6 = p[6 * step], d7 = p[7 * step];
+
+    int32_t e0 = d0 + d4;
+    int32_t e1 = -d3 + d5 - d7 - (d7 >> 1);
+    int32_t e2 = d0 - d4;
+    int32_t e3 = d1 + d7 - d3 - (d3 >> 1);
+    int32_t e4 = (d2 >> 1) - d6;
+    int32_t e5 = -d1 + d7 + d5 + (d5 >> 1);
+    int32_t e6 = d2 + (d6 >> 1);
+    int32_t e7 = d3 + d5 + d1 + (d1 >> 1);
+
+    int32_t f0 = e0 + e6;
+    int32_t f1 = e1 + (e7 >> 2);
+    int32_t f2 = e2 + e4;
+    int32_t f3 = e3 + (e5 >> 2);
+    int32_t f4 = e2 - e4;
+    int32_t f5 = (e3 >> 2) - e5;
+    int32_t f6 = e0 - e6;
+    int32_t f7 = e7 - (e1 >> 2);
+
+    p[0] = f0 + f7;
+    p[step] = f2 + f5;
+    p[2 * step] = f4 + f3;
+    p[3 * step] = f6 + f1;
+    p[4 * step] = f6 - f1;
+    p[5 * step] = f4 - f3;
+    p[6 * step] = f2 - f5;
+    p[7 * step] = f0 - f7;
+}
+
+void derivation_for_level_scale(PPS* pps) {
+    for (int32_t list = 0; list < 6; list++) {
+        int32_t weightScale4x4[16];
+        int32_t weightScale8x8[64];
+
+        /* 8.5.6 and 8.5.7: the scaling lists are mapped with the inverse zig-zag scan for frame and field macroblocks */
+        for (int32_t k = 0; k < 16; k++) {
+            weightScale4x4[g_zigzag_scan_4x4[k]] = pps->ScalingList4x4[list][k];
+        }
+        for (int32_t k = 0; k < 64; k++) {
+            weightScale8x8[g_zigzag_scan_8x8[k]] = pps->ScalingList8x8[list][k];
+        }
+
+        for (int32_t m = 0; m < 6; m++) {
+            for (int32_t i = 0; i < 4; i++) {
+                for (int32_t j = 0; j < 4; j++) {
+                    int32_t v = (i % 2 == 0 && j % 2 == 0) ? 0 : ((i % 2 == 1 && j % 2 == 1) ? 1 : 2);
+                    pps->LevelScale4x4[list][m][i * 4 + j] = weightScale4x4[i * 4 + j] * g_norm_adjust_4x4[m][v];
+                }
+            }
+
+            for (int32_t i = 0; i < 8; i++) {
+                for (int32_t j = 0; j < 8; j++) {
+                    int32_t v = 5;
+                    if (i % 4 == 0 && j % 4 == 0) {
+                        v = 0;
+                    } else if (i % 2 == 1 && j % 2 == 1) {
+                        v = 1;
+                    } else if (i % 4 == 2 && j % 4 == 2) {
+                        v = 2;
+                    } else if ((i % 4 == 0 && j % 2 == 1) || (i % 2 == 1 && j % 4 == 0)) {
+                        v = 3;
+                    } else if ((i % 4 == 0 && j % 4 == 2) || (i % 4 == 2 && j % 4 == 0)) {
+                        v = 4;
+                    }
+                    pps->LevelScale8x8[list][m][i * 8 + j] = weightScale8x8[i * 8 + j] * g_norm_adjust_8x8[m][v];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief the 4-point Hadamard transform of the equations 8-320 and 8-326, the samples are at p[ 0 ], p[ step ], p[ 2 * step ] and p[ 3 * step ]
+ */
+static inline void hadamard4(int32_t* p, int32_t step) {
+    int32_t s01 = p[0] + p[step];
+    int32_t d01 = p[0] - p[step];
+    int32_t s23 = p[2 * step] + p[3 * step];
+    int32_t d23 = p[2 * step] - p[3 * step];
+
+    p[0] = s01 + s23;
+    p[step] = s01 - s23;
+    p[2 * step] = d01 - d23;
+    p[3 * step] = d01 + d23;
+}
+
+/**
+ * @brief Scaling and transformation process for DC transform coefficients for Intra_16x16 macroblock type
+ * @see 8.5.10 Scaling and transformation process for DC transform coefficients for Intra_16x16 macroblock type
+ *
+ * @param i16x16DClevel the 16 DC levels in scan order
+ * @param scan the inverse scanning table
+ * @param LevelScale00 LevelScale4x4( qP % 6, 0, 0 )
+ * @param qP the quantization parameter
+ * @param out_dcY output parameter. dcY in raster order, it is the DC coefficient of the 4x4 block in raster block order
+ */
+static void scaling_intra16x16_dc(const int32_t* i16x16DClevel, const uint8_t* scan, int32_t LevelScale00, int32_t qP, int32_t* out_dcY) {
+    int32_t f[16];
+    for (int32_t k = 0; k < 16; k++) {
+        f[scan[k]] = i16x16DClevel[k];
+    }
+
+    for (int32_t i = 0; i < 4; i++) {
+        hadamard4(f + i * 4, 1);
+    }
+    for (int32_t j = 0; j < 4; j++) {
+        hadamard4(f + j, 4);
+    }
+
+    int32_t qP_div6 = qP / 6;
+    for (int32_t k = 0; k < 16; k++) {
+        out_dcY[k] = qP_div6 >= 6 ? (f[k] * LevelScale00) << (qP_div6 - 6) : (f[k] * LevelScale00 + (1 << (5 - qP_div6))) >> (6 - qP_div6);
+    }
+}
+
+/**
+ * @brief Transformation and scaling process for chroma DC transform coefficients
+ * @see 8.5.11.1 Transformation process for chroma DC transform coefficients
+ * @see 8.5.11.2 Scaling process for chroma DC transform coefficients
+ *
+ * @param ChromaDCLevel the 4 or 8 DC levels
+ * @param ChromaArrayType 1 or 2
+ * @param LevelScale LevelScale4x4( m, 0, 0 ) of the chroma list, indexed by m
+ * @param QPc the chroma quantization parameter QP'C
+ * @param out_dcC output parameter. dcC in raster order, it is the DC coefficient of the 4x4 block with chroma4x4BlkIdx
+ */
+static void scaling_chroma_dc(const int32_t* ChromaDCLevel, int32_t ChromaArrayType, const int32_t (*LevelScale)[16], int32_t QPc, int32_t* out_dcC) {
+    if (ChromaArrayType == 1) {
+        /* f = [ 1 1; 1 -1 ] * c * [ 1 1; 1 -1 ], c = [ c0 c1; c2 c3 ] */
+        int32_t s01 = ChromaDCLevel[0] + ChromaDCLevel[1];
+        int32_t d01 = ChromaDCLevel[0] - ChromaDCLevel[1];
+        int32_t s23 = ChromaDCLevel[2] + ChromaDCLevel[3];
+        int32_t d23 = ChromaDCLevel[2] - ChromaDCLevel[3];
+        int32_t f[4] = {s01 + s23, d01 + d23, s01 - s23, d01 - d23};
+
+        int32_t scale = LevelScale[QPc % 6][0];
+        for (int32_t k = 0; k < 4; k++) {
+            out_dcC[k] = ((f[k] * scale) << (QPc / 6)) >> 5;
+        }
+    } else {
+        /* c = [ c0 c2; c1 c5; c3 c6; c4 c7 ], f = A * c * [ 1 1; 1 -1 ] with the 4x4 Hadamard matrix A */
+        static const uint8_t c_index[8] = {0, 2, 1, 5, 3, 6, 4, 7};
+        int32_t f[8];
+        for (int32_t k = 0; k < 8; k++) {
+            f[k] = ChromaDCLevel[c_index[k]];
+        }
+
+        hadamard4(f, 2);
+        hadamard4(f + 1, 2);
+        for (int32_t i = 0; i < 4; i++) {
+            int32_t a = f[i * 2];
+            int32_t b = f[i * 2 + 1];
+            f[i * 2] = a + b;
+            f[i * 2 + 1] = a - b;
+        }
+
+        int32_t qP_dc = QPc + 3;
+        int32_t qP_div6 = qP_dc / 6;
+        int32_t scale = LevelScale[qP_dc % 6][0];
+        for (int32_t k = 0; k < 8; k++) {
+            out_dcC[k] = qP_div6 >= 6 ? (f[k] * scale) << (qP_div6 - 6) : (f[k] * scale + (1 << (5 - qP_div6))) >> (6 - qP_div6);
+        }
+    }
+}
+
+int32_t derivation_for_chroma_qp(int32_t QPY, int32_t qPOffset, int32_t QpBdOffsetC) {
+    int32_t qPI = clip3(-QpBdOffsetC, 51, QPY + qPOffset);
+    int32_t QPC = qPI < 30 ? qPI : g_qpc_table[qPI - 30];
+    return QPC + QpBdOffsetC;
+}
+
+#define BIT_DEPTH 8
+#include "h264_transform_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 9
+#include "h264_transform_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 10
+#include "h264_transform_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 11
+#include "h264_transform_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 12
+#include "h264_transform_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 13
+#include "h264_transform_template.h"
+#undef BIT_DEPTH
+#define BIT_DEPTH 14
+#include "h264_transform_template.h"
+#undef BIT_DEPTH
+
+void init_transform_funcs(TransformFuncs* funcs, int32_t BitDepth, int32_t cpu_flags) {
+    switch (BitDepth) {
+        case 9:
+            init_transform_funcs_9_c(funcs);
+            break;
+        case 10:
+            init_transform_funcs_10_c(funcs);
+            break;
+        case 11:
+            init_transform_funcs_11_c(funcs);
+            break;
+        case 12:
+            init_transform_funcs_12_c(funcs);
+            break;
+        case 13:
+            init_transform_funcs_13_c(funcs);
+            break;
+        case 14:
+            init_transform_funcs_14_c(funcs);
+            break;
+        default:
+            init_transform_funcs_8_c(funcs);
+            break;
+    }
+
+    /* the SIMD kernels are written for the 8-bit samples */
+    if (cpu_flags && BitDepth == 8) {
+        init_transform_funcs_x86(funcs, cpu_flags);
+    }
+}
+
+int scaling_for_residual(FrameOrField* picture, SliceHeader* header, int32_t CurrMbAddr) {
+    SPS* sps = header->sps;
+    MacroBlockScratch* scratch = picture->mb_scratch;
+
+    /* the coefficients of the bit depths greater than 8 exceed 16 bits, see 8.5.12.1 */
+    if (sps->BitDepthY > 8 || sps->BitDepthC > 8) {
+        return scaling_for_residual_coeffs16(picture, header, CurrMbAddr, &scratch->coeffs16);
+    }
+    return scaling_for_residual_coeffs(picture, header, CurrMbAddr, &scratch->coeffs);
+}
@@ -0,0 +1,403 @@
+/*
+ * the scalar inverse transform kernels and the coefficient storage of one bit depth, included by h264_transform.c for every bit depth with BIT_DEPTH defined
+ */
+
+#include "h264_bit_depth_template.h"
+
+/**
+ * @brief add the residual ( h + 32 ) >> 6 of the NxN block to the predicted samples, see equations 8-354 and 8-379 and clause 8.5.14
+ */
+static inline void FUNCC(add_residual)(pixel* dst, int32_t stride, const int32_t* h, int32_t N) {
+    for (int32_t i = 0; i < N; i++) {
+        for (int32_t j = 0; j < N; j++) {
+            dst[i * stride + j] = (pixel)CLIP1(dst[i * stride + j] + ((h[i * N + j] + 32) >> 6));
+        }
+    }
+}
+
+/**
+ * @brief add the residual of the block with d[ 0 ][ 0 ] as the only non-zero coefficient, every h[ i ][ j ] is equal to d[ 0 ][ 0 ]
+ */
+static inline void FUNCC(add_dc)(pixel* dst, int32_t stride, int32_t dc, int32_t N) {
+    int32_t r = (dc + 32) >> 6;
+    for (int32_t i = 0; i < N; i++) {
+        for (int32_t j = 0; j < N; j++) {
+            dst[i * stride + j] = (pixel)CLIP1(dst[i * stride + j] + r);
+        }
+    }
+}
+
+static void FUNCC(idct4x4_add)(uint8_t* _dst, int32_t stride, const int16_t* _coeffs) {
+    const dctcoef* coeffs = (const dctcoef*)_coeffs;
+    int32_t d[16];
+    for (int32_t i = 0; i < 16; i++) {
+        d[i] = coeffs[i];
+    }
+
+    idct4x4(d);
+    FUNCC(add_residual)((pixel*)_dst, stride, d, 4);
+}
+
+static void FUNCC(idct4x4_dc_add)(uint8_t* _dst, int32_t stride, const int16_t* _coeffs) { FUNCC(add_dc)((pixel*)_dst, stride, ((const dctcoef*)_coeffs)[0], 4); }
+
+static void FUNCC(idct8x8_add)(uint8_t* _dst, int32_t stride, const int16_t* _coeffs) {
+    const dctcoef* coeffs = (const dctcoef*)_coeffs;
+    int32_t d[64];
+    for (int32_t i = 0; i < 64; i++) {
+        d[i] = coeffs[i];
+    }
+
+    for (int32_t i = 0; i < 8; i++) {
+        idct8(d + i * 8, 1);
+    }
+    for (int32_t j = 0; j < 8; j++) {
+        idct8(d + j, 8);
+    }
+    FUNCC(add_residual)((pixel*)_dst, stride, d, 8);
+}
+
+static void FUNCC(idct8x8_dc_add)(uint8_t* _dst, int32_t stride, const int16_t* _coeffs) { FUNCC(add_dc)((pixel*)_dst, stride, ((const dctcoef*)_coeffs)[0], 8); }
+
+static void FUNCC(init_transform_funcs)(TransformFuncs* funcs) {
+    funcs->idct4x4_add = FUNCC(idct4x4_add);
+    funcs->idct4x4_dc_add = FUNCC(idct4x4_dc_add);
+    funcs->idct4x4_add2 = 0;
+    funcs->idct4x4_add4 = 0;
+    funcs->idct8x8_add = FUNCC(idct8x8_add);
+    funcs->idct8x8_dc_add = FUNCC(idct8x8_dc_add);
+    funcs->idct8x8_add2 = 0;
+}
+
+#if SAMPLE_FUNCS_INSTANCE
+
+/**
+ * @brief store the scaled coefficient, the values of a conforming bitstream are within 8 + BitDepth bits, see 8.5.12.1
+ */
+#if BIT_DEPTH == 8
+static inline dctcoef FUNC16(store_coeff)(int32_t d) { return (dctcoef)clip3(-32768, 32767, d); }
+#else
+static inline dctcoef FUNC16(store_coeff)(int32_t d) { return d; }
+#endif
+
+/**
+ * @brief inverse scanning and scaling of one 4x4 block
+ * @see 8.5.12.1 Scaling process for residual 4x4 blocks
+ *
+ * @param coeffLevel the levels of the scan indices startIdx..15
+ * @param startIdx 0, or 1 for the AC levels of Intra16x16 and chroma
+ * @param dc the scaled DC coefficient used when startIdx is 1
+ * @param scan the inverse scanning table
+ * @param LevelScale LevelScale4x4( qP % 6, i, j )
+ * @param qP the quantization parameter
+ * @param out_d output parameter. the 16 scaled coefficients
+ * @return int32_t 0 for a block of zeros, 1 for the DC coefficient only, 3 for non-zero AC coefficients
+ */
+static int32_t FUNC16(scaling_4x4)(const int32_t* coeffLevel, int32_t startIdx, int32_t dc, const uint8_t* scan, const int32_t* LevelScale, int32_t qP, dctcoef* out_d) {
+    int32_t qP_div6 = qP / 6;
+    int32_t has_ac = 0;
+
+    memset(out_d, 0, 16 * sizeof(dctcoef));
+    out_d[0] = FUNC16(store_coeff)(dc);
+
+    for (int32_t k = startIdx; k < 16; k++) {
+        int32_t c = coeffLevel[k - startIdx];
+        if (!c) {
+            continue;
+        }
+
+        int32_t pos = scan[k];
+        int32_t d = qP_div6 >= 4 ? (c * LevelScale[pos]) << (qP_div6 - 4) : (c * LevelScale[pos] + (1 << (3 - qP_div6))) >> (4 - qP_div6);
+        out_d[pos] = FUNC16(store_coeff)(d);
+        has_ac |= pos != 0;
+    }
+
+    return has_ac ? 3 : (out_d[0] != 0);
+}
+
+/**
+ * @brief inverse scanning and scaling of one 8x8 block
+ * @see 8.5.13.1 Scaling process for residual 8x8 blocks
+ */
+static int32_t FUNC16(scaling_8x8)(const int32_t* coeffLevel, const uint8_t* scan, const int32_t* LevelScale, int32_t qP, dctcoef* out_d) {
+    int32_t qP_div6 = qP / 6;
+    int32_t has_ac = 0;
+
+    memset(out_d, 0, 64 * sizeof(dctcoef));
+
+    for (int32_t k = 0; k < 64; k++) {
+        int32_t c = coeffLevel[k];
+        if (!c) {
+            continue;
+        }
+
+        int32_t pos = scan[k];
+        int32_t d = qP_div6 >= 6 ? (c * LevelScale[pos]) << (qP_div6 - 6) : (c * LevelScale[pos] + (1 << (5 - qP_div6))) >> (6 - qP_div6);
+        out_d[pos] = FUNC16(store_coeff)(d);
+        has_ac |= pos != 0;
+    }
+
+    return has_ac ? 3 : (out_d[0] != 0);
+}
+
+
+/**
+ * @brief inverse scanning and scaling of the levels of residual_luma() of a colour component into the blocks of the luma layout
+ *
+ * @param iComp the colour component, 1 and 2 for the Cb and Cr levels of ChromaArrayType equal to 3
+ * @param qP qP of the colour component
+ * @param blocks output parameter. the 16 4x4 blocks or the 4 8x8 blocks
+ * @param out_nz output parameter. the blocks with non-zero coefficients
+ * @param out_ac output parameter. the blocks with a non-zero AC coefficient
+ */
+static void FUNC16(scaling_luma_blocks)(const PPS* pps, const MacroBlock* mb, const MacroBlockScratch* scratch, int32_t iComp, int32_t qP, int32_t is_field,
+                                        uint32_t coded_block_flags, dctcoef* blocks, uint16_t* out_nz, uint16_t* out_ac) {
+    int32_t is_intra = mb_is_intra(mb);
+    const uint8_t* scan4x4 = is_field ? g_field_scan_4x4 : g_zigzag_scan_4x4;
+    uint16_t nz = 0;
+    uint16_t ac = 0;
+
+    if (mb->transform_size_8x8_flag) {
+        const uint8_t* scan8x8 = is_field ? g_field_scan_8x8 : g_zigzag_scan_8x8;
+        /* the 8x8 lists are ordered Intra Y, Inter Y, Intra Cb, Inter Cb, Intra Cr and Inter Cr, see Table 7-2 */
+        const int32_t* LevelScale = pps->LevelScale8x8[iComp * 2 + (is_intra ? 0 : 1)][qP % 6];
+
+        for (int32_t luma8x8BlkIdx = 0; luma8x8BlkIdx < 4; luma8x8BlkIdx++) {
+            dctcoef* d = blocks + luma8x8BlkIdx * 64;
+            if (!(coded_block_flags & (0xFu << (luma8x8BlkIdx * 4)))) {
+                memset(d, 0, 64 * sizeof(dctcoef));
+                continue;
+            }
+
+            int32_t kind = FUNC16(scaling_8x8)(scratch->level8x8[iComp][luma8x8BlkIdx], scan8x8, LevelScale, qP, d);
+            nz |= (uint16_t)((kind & 1) << luma8x8BlkIdx);
+            ac |= (uint16_t)((kind >> 1) << luma8x8BlkIdx);
+        }
+    } else {
+        const int32_t(*LevelScale)[16] = pps->LevelScale4x4[(is_intra ? 0 : 3) + iComp];
+        int32_t is_intra_16x16 = mb->mb_pred_type == Intra_16x16;
+        int32_t dcY[16] = {0};
+
+        if (is_intra_16x16 && (mb->coded_block_flags_dc & (H264_CBF_DC_LUMA << iComp))) {
+            scaling_intra16x16_dc(scratch->i16x16DClevel[iComp], scan4x4, LevelScale[qP % 6][0], qP, dcY);
+        }
+
+        for (int32_t luma4x4BlkIdx = 0; luma4x4BlkIdx < 16; luma4x4BlkIdx++) {
+            int32_t blk = g_luma4x4_blk_raster[luma4x4BlkIdx];
+            dctcoef* d = blocks + blk * 16;
+            int32_t kind = 0;
+
+            if (coded_block_flags & (1u << luma4x4BlkIdx)) {
+                kind = is_intra_16x16 ? FUNC16(scaling_4x4)(scratch->i16x16AClevel[iComp][luma4x4BlkIdx], 1, dcY[blk], scan4x4, LevelScale[qP % 6], qP, d)
+                                      : FUNC16(scaling_4x4)(scratch->level4x4[iComp][luma4x4BlkIdx], 0, 0, scan4x4, LevelScale[qP % 6], qP, d);
+            } else {
+                /* the all-zero block of Intra16x16 keeps its DC coefficient */
+                memset(d, 0, 16 * sizeof(dctcoef));
+                d[0] = FUNC16(store_coeff)(dcY[blk]);
+                kind = d[0] != 0;
+            }
+
+            nz |= (uint16_t)((kind & 1) << blk);
+            ac |= (uint16_t)((kind >> 1) << blk);
+        }
+    }
+
+    *out_nz = nz;
+    *out_ac = ac;
+}
+
+static int FUNC16(scaling_for_residual_coeffs)(FrameOrField* picture, SliceHeader* header, int32_t CurrMbAddr, TransformCoeffsT* coeffs) {
+    SPS* sps = header->sps;
+    PPS* pps = header->pps;
+    MacroBlock* mb = &picture->mb_list[CurrMbAddr];
+    MacroBlockScratch* scratch = picture->mb_scratch;
+
+    coeffs->luma_nz = 0;
+    coeffs->luma_ac = 0;
+    coeffs->chroma_nz[0] = coeffs->chroma_nz[1] = 0;
+    coeffs->chroma_ac[0] = coeffs->chroma_ac[1] = 0;
+
+    /* the fast path of the macroblocks without residual, the coefficient buffers are not touched */
+    if (!mb->coded_block_flags && !mb->coded_block_flags_444 && !mb->coded_block_flags_dc) {
+        return ERR_OK;
+    }
+
+    int32_t is_intra = mb_is_intra(mb);
+    int32_t is_field = header->field_pic_flag || bitset_get(picture->mb_field_flags, CurrMbAddr);
+    const uint8_t* scan4x4 = is_field ? g_field_scan_4x4 : g_zigzag_scan_4x4;
+    int32_t qP = picture->mb_qps[CurrMbAddr] + (int32_t)sps->QpBdOffsetY;
+
+    FUNC16(scaling_luma_blocks)(pps, mb, scratch, 0, qP, is_field, mb->coded_block_flags & H264_CBF_LUMA_MASK, coeffs->luma, &coeffs->luma_nz, &coeffs->luma_ac);
+
+    /* 8.5.5: the Cb and Cr blocks of ChromaArrayType equal to 3 are scaled like the luma blocks with qP equal to QP'C */
+    if (sps->ChromaArrayType == 3) {
+        for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+            int32_t qPOffset = iCbCr ? pps->second_chroma_qp_index_offset : pps->chroma_qp_index_offset;
+            int32_t QPc = derivation_for_chroma_qp(picture->mb_qps[CurrMbAddr], qPOffset, (int32_t)sps->QpBdOffsetC);
+            FUNC16(scaling_luma_blocks)(pps, mb, scratch, 1 + iCbCr, QPc, is_field, (mb->coded_block_flags_444 >> (iCbCr * 16)) & H264_CBF_LUMA_MASK,
+                                        coeffs->chroma[iCbCr], &coeffs->chroma_nz[iCbCr], &coeffs->chroma_ac[iCbCr]);
+        }
+    }
+
+    if (sps->ChromaArrayType == 1 || sps->ChromaArrayType == 2) {
+        int32_t numBlocks = sps->ChromaArrayType == 1 ? 4 : 8;
+
+        for (int32_t iCbCr = 0; iCbCr < 2; iCbCr++) {
+            int32_t shift = iCbCr ? H264_CBF_CR_SHIFT : H264_CBF_CB_SHIFT;
+            int32_t qPOffset = iCbCr ? pps->second_chroma_qp_index_offset : pps->chroma_qp_index_offset;
+            int32_t QPc = derivation_for_chroma_qp(picture->mb_qps[CurrMbAddr], qPOffset, (int32_t)sps->QpBdOffsetC);
+            const int32_t(*LevelScale)[16] = pps->LevelScale4x4[(is_intra ? 1 : 4) + iCbCr];
+            int32_t dcC[8] = {0};
+
+            if (mb->coded_block_flags_dc & (H264_CBF_DC_CB << iCbCr)) {
+                scaling_chroma_dc(scratch->ChromaDCLevel[iCbCr], sps->ChromaArrayType, LevelScale, QPc, dcC);
+            }
+
+            for (int32_t chroma4x4BlkIdx = 0; chroma4x4BlkIdx < numBlocks; chroma4x4BlkIdx++) {
+                dctcoef* d = coeffs->chroma[iCbCr] + chroma4x4BlkIdx * 16;
+                int32_t kind = 0;
+
+                if (mb->coded_block_flags & (1u << (shift + chroma4x4BlkIdx))) {
+                    kind = FUNC16(scaling_4x4)(scratch->ChromaACLevel[iCbCr][chroma4x4BlkIdx], 1, dcC[chroma4x4BlkIdx], scan4x4, LevelScale[QPc % 6], QPc, d);
+                } else {
+                    memset(d, 0, 16 * sizeof(dctcoef));
+                    d[0] = FUNC16(store_coeff)(dcC[chroma4x4BlkIdx]);
+                    kind = d[0] != 0;
+                }
+
+                coeffs->chroma_nz[iCbCr] |= (uint16_t)((kind & 1) << chroma4x4BlkIdx);
+                coeffs->chroma_ac[iCbCr] |= (uint16_t)((kind >> 1) << chroma4x4BlkIdx);
+            }
+        }
+    }
+
+    return ERR_OK;
+}
+
+
+/**
+ * @brief add the residual of a row of 4x4 blocks, pairs of non-zero blocks and rows of 4 non-zero blocks are given to the multi-block kernels
+ *
+ * @param coeffs the coefficients of the first block of the row
+ * @param nz the non-zero blocks of the row
+ * @param ac the blocks of the row with non-zero AC coefficients
+ * @param num_blocks the number of blocks of the row, 2 or 4
+ */
+static void FUNC16(transform_add_row4x4)(const TransformFuncs* funcs, const dctcoef* coeffs, uint32_t nz, uint32_t ac, int32_t num_blocks, pixel* dst, int32_t stride) {
+    if (num_blocks == 4 && funcs->idct4x4_add4 && (ac & 0xF) && (nz & 0xF) == 0xF) {
+        funcs->idct4x4_add4((uint8_t*)dst, stride, (const int16_t*)coeffs);
+        return;
+    }
+
+    for (int32_t blk = 0; blk < num_blocks; blk += 2) {
+        uint32_t pair = (nz >> blk) & 3;
+        if (!pair) {
+            continue;
+        }
+
+        if (pair == 3 && funcs->idct4x4_add2 && ((ac >> blk) & 3)) {
+            funcs->idct4x4_add2((uint8_t*)(dst + blk * 4), stride, (const int16_t*)(coeffs + blk * 16));
+            continue;
+        }
+
+        for (int32_t i = blk; i < blk + 2; i++) {
+            if (ac & (1u << i)) {
+                funcs->idct4x4_add((uint8_t*)(dst + i * 4), stride, (const int16_t*)(coeffs + i * 16));
+            } else if (nz & (1u << i)) {
+                funcs->idct4x4_dc_add((uint8_t*)(dst + i * 4), stride, (const int16_t*)(coeffs + i * 16));
+            }
+        }
+    }
+}
+
+/**
+ * @brief the blocks and the masks of the colour component of the luma layout
+ */
+static inline const dctcoef* FUNC16(luma_layout_blocks)(const TransformCoeffsT* coeffs, int32_t iComp, uint32_t* nz, uint32_t* ac) {
+    if (iComp) {
+        *nz = coeffs->chroma_nz[iComp - 1];
+        *ac = coeffs->chroma_ac[iComp - 1];
+        return coeffs->chroma[iComp - 1];
+    }
+    *nz = coeffs->luma_nz;
+    *ac = coeffs->luma_ac;
+    return coeffs->luma;
+}
+
+void FUNC16(transform_add_luma)(const TransformFuncs* funcs, const TransformCoeffsT* coeffs, int32_t iComp, int32_t transform_size_8x8_flag, pixel* dst, int32_t stride) {
+    uint32_t nz_all;
+    uint32_t ac_all;
+    const dctcoef* blocks = FUNC16(luma_layout_blocks)(coeffs, iComp, &nz_all, &ac_all);
+    if (!nz_all) {
+        return;
+    }
+
+    if (transform_size_8x8_flag) {
+        for (int32_t row = 0; row < 2; row++) {
+            uint32_t nz = (nz_all >> (row * 2)) & 3;
+            uint32_t ac = (ac_all >> (row * 2)) & 3;
+            pixel* dst_row = dst + row * 8 * stride;
+            const dctcoef* coeffs_row = blocks + row * 128;
+
+            if (nz == 3 && ac && funcs->idct8x8_add2) {
+                funcs->idct8x8_add2((uint8_t*)dst_row, stride, (const int16_t*)coeffs_row);
+                continue;
+            }
+
+            for (int32_t i = 0; i < 2; i++) {
+                if (ac & (1u << i)) {
+                    funcs->idct8x8_add((uint8_t*)(dst_row + i * 8), stride, (const int16_t*)(coeffs_row + i * 64));
+                } else if (nz & (1u << i)) {
+                    funcs->idct8x8_dc_add((uint8_t*)(dst_row + i * 8), stride, (const int16_t*)(coeffs_row + i * 64));
+                }
+            }
+        }
+        return;
+    }
+
+    for (int32_t row = 0; row < 4; row++) {
+        uint32_t nz = (nz_all >> (row * 4)) & 0xF;
+        if (nz) {
+            FUNC16(transform_add_row4x4)(funcs, blocks + row * 64, nz, (ac_all >> (row * 4)) & 0xF, 4, dst + row * 4 * stride, stride);
+        }
+    }
+}
+
+void FUNC16(transform_add_luma4x4)(const TransformFuncs* funcs, const TransformCoeffsT* coeffs, int32_t iComp, int32_t blkIdx, pixel* dst, int32_t stride) {
+    uint32_t nz;
+    uint32_t ac;
+    const dctcoef* blocks = FUNC16(luma_layout_blocks)(coeffs, iComp, &nz, &ac);
+
+    if (ac & (1u << blkIdx)) {
+        funcs->idct4x4_add((uint8_t*)dst, stride, (const int16_t*)(blocks + blkIdx * 16));
+    } else if (nz & (1u << blkIdx)) {
+        funcs->idct4x4_dc_add((uint8_t*)dst, stride, (const int16_t*)(blocks + blkIdx * 16));
+    }
+}
+
+void FUNC16(transform_add_luma8x8)(const TransformFuncs* funcs, const TransformCoeffsT* coeffs, int32_t iComp, int32_t luma8x8BlkIdx, pixel* dst, int32_t stride) {
+    uint32_t nz;
+    uint32_t ac;
+    const dctcoef* blocks = FUNC16(luma_layout_blocks)(coeffs, iComp, &nz, &ac);
+
+    if (ac & (1u << luma8x8BlkIdx)) {
+        funcs->idct8x8_add((uint8_t*)dst, stride, (const int16_t*)(blocks + luma8x8BlkIdx * 64));
+    } else if (nz & (1u << luma8x8BlkIdx)) {
+        funcs->idct8x8_dc_add((uint8_t*)dst, stride, (const int16_t*)(blocks + luma8x8BlkIdx * 64));
+    }
+}
+
+void FUNC16(transform_add_chroma)(const TransformFuncs* funcs, const TransformCoeffsT* coeffs, int32_t iCbCr, int32_t MbHeightC, pixel* dst, int32_t stride) {
+    uint32_t nz_all = coeffs->chroma_nz[iCbCr];
+    if (!nz_all) {
+        return;
+    }
+
+    for (int32_t row = 0; row < MbHeightC / 4; row++) {
+        uint32_t nz = (nz_all >> (row * 2)) & 3;
+        if (nz) {
+            FUNC16(transform_add_row4x4)(funcs, coeffs->chroma[iCbCr] + row * 32, nz, (coeffs->chroma_ac[iCbCr] >> (row * 2)) & 3, 2, dst + row * 4 * stride, stride);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,388 @@
+#include "h264decoder/h264_transform.h"
+
+#include <string.h>
+
+#include "h264decoder/h264_cpu.h"
+
+/**
+ * the SSE2 and AVX2 inverse transform kernels. the coefficients are kept in 16-bit lanes, a conforming bitstream keeps the intermediate values of the transforms
+ * within 16 bits, see clauses 8.5.12.2 and 8.5.13.2.
+ *
+ * a 128-bit register holds a row of two 4x4 blocks or of one 8x8 block, the 256-bit registers hold the rows of four 4x4 blocks or of two 8x8 blocks in the two 128-bit
+ * lanes. the blocks are transposed, transformed horizontally, transposed back and transformed vertically, so every pass works on whole registers.
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+/**
+ * @brief transpose the 4x4 blocks of the low and high 64 bits, r[ i ] holds row i of the blocks and returns column i of the blocks
+ */
+static inline TARGET_SSE2 void transpose4x4x2_sse2(__m128i* r) {
+    __m128i t0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i t1 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i t2 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i t3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i u0 = _mm_unpacklo_epi32(t0, t1);
+    __m128i u1 = _mm_unpackhi_epi32(t0, t1);
+    __m128i u2 = _mm_unpacklo_epi32(t2, t3);
+    __m128i u3 = _mm_unpackhi_epi32(t2, t3);
+
+    r[0] = _mm_unpacklo_epi64(u0, u2);
+    r[1] = _mm_unpackhi_epi64(u0, u2);
+    r[2] = _mm_unpacklo_epi64(u1, u3);
+    r[3] = _mm_unpackhi_epi64(u1, u3);
+}
+
+/**
+ * @brief the 1-D 4-point inverse transform of the lanes
+ */
+static inline TARGET_SSE2 void idct4_sse2(__m128i* r) {
+    __m128i e0 = _mm_add_epi16(r[0], r[2]);
+    __m128i e1 = _mm_sub_epi16(r[0], r[2]);
+    __m128i e2 = _mm_sub_epi16(_mm_srai_epi16(r[1], 1), r[3]);
+    __m128i e3 = _mm_add_epi16(r[1], _mm_srai_epi16(r[3], 1));
+
+    r[0] = _mm_add_epi16(e0, e3);
+    r[1] = _mm_add_epi16(e1, e2);
+    r[2] = _mm_sub_epi16(e1, e2);
+    r[3] = _mm_sub_epi16(e0, e3);
+}
+
+/**
+ * @brief the 4x4 inverse transform of the blocks of the low and high 64 bits, r[ i ] holds row i of the coefficients and returns row i of the residual before
+ * the rounding shift
+ */
+static inline TARGET_SSE2 void idct4x4x2_sse2(__m128i* r) {
+    transpose4x4x2_sse2(r);
+    idct4_sse2(r);
+    transpose4x4x2_sse2(r);
+    idct4_sse2(r);
+}
+
+/**
+ * @brief add ( h + 32 ) >> 6 of the 8 lanes to the 8 predicted samples of the row
+ */
+static inline TARGET_SSE2 void add_row8_sse2(uint8_t* dst, __m128i h) {
+    __m128i r = _mm_srai_epi16(_mm_add_epi16(h, _mm_set1_epi16(32)), 6);
+    __m128i pred = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)dst), _mm_setzero_si128());
+    __m128i rec = _mm_add_epi16(pred, r);
+    _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(rec, rec));
+}
+
+static TARGET_SSE2 void idct4x4_add_sse2(uint8_t* dst, int32_t stride, const int16_t* coeffs) {
+    __m128i r[4];
+    __m128i rows01 = _mm_loadu_si128((const __m128i*)coeffs);
+    __m128i rows23 = _mm_loadu_si128((const __m128i*)(coeffs + 8));
+
+    /* the high 64 bits carry another row of the block, their results are discarded */
+    r[0] = rows01;
+    r[1] = _mm_srli_si128(rows01, 8);
+    r[2] = rows23;
+    r[3] = _mm_srli_si128(rows23, 8);
+    idct4x4x2_sse2(r);
+
+    for (int32_t i = 0; i < 4; i++) {
+        int32_t pred = 0;
+        memcpy(&pred, dst + i * stride, 4);
+
+        __m128i res = _mm_srai_epi16(_mm_add_epi16(r[i], _mm_set1_epi16(32)), 6);
+        __m128i rec = _mm_add_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pred), _mm_setzero_si128()), res);
+        pred = _mm_cvtsi128_si32(_mm_packus_epi16(rec, rec));
+        memcpy(dst + i * stride, &pred, 4);
+    }
+}
+
+static TARGET_SSE2 void idct4x4_add2_sse2(uint8_t* dst, int32_t stride, const int16_t* coeffs) {
+    __m128i r[4];
+    __m128i a01 = _mm_loadu_si128((const __m128i*)coeffs);
+    __m128i a23 = _mm_loadu_si128((const __m128i*)(coeffs + 8));
+    __m128i b01 = _mm_loadu_si128((const __m128i*)(coeffs + 16));
+    __m128i b23 = _mm_loadu_si128((const __m128i*)(coeffs + 24));
+
+    r[0] = _mm_unpacklo_epi64(a01, b01);
+    r[1] = _mm_unpackhi_epi64(a01, b01);
+    r[2] = _mm_unpacklo_epi64(a23, b23);
+    r[3] = _mm_unpackhi_epi64(a23, b23);
+    idct4x4x2_sse2(r);
+
+    for (int32_t i = 0; i < 4; i++) {
+        add_row8_sse2(dst + i * stride, r[i]);
+    }
+}
+
+/**
+ * @brief the saturated add of the DC residual to a row of N samples, N is 4 or 8
+ */
+static inline TARGET_SSE2 void dc_add_rows_sse2(uint8_t* dst, int32_t stride, int32_t dc, int32_t N) {
+    __m128i pos = _mm_set1_epi8((char)(dc > 0 ? (dc > 255 ? 255 : dc) : 0));
+    __m128i neg = _mm_set1_epi8((char)(dc < 0 ? (dc < -255 ? 255 : -dc) : 0));
+
+    for (int32_t i = 0; i < N; i++) {
+        if (N == 4) {
+            int32_t pred = 0;
+            memcpy(&pred, dst + i * stride, 4);
+            pred = _mm_cvtsi128_si32(_mm_subs_epu8(_mm_adds_epu8(_mm_cvtsi32_si128(pred), pos), neg));
+            memcpy(dst + i * stride, &pred, 4);
+        } else {
+            __m128i pred = _mm_loadl_epi64((const __m128i*)(dst + i * stride));
+            _mm_storel_epi64((__m128i*)(dst + i * stride), _mm_subs_epu8(_mm_adds_epu8(pred, pos), neg));
+        }
+    }
+}
+
+static TARGET_SSE2 void idct4x4_dc_add_sse2(uint8_t* dst, int32_t stride, const int16_t* coeffs) { dc_add_rows_sse2(dst, stride, (coeffs[0] + 32) >> 6, 4); }
+
+static TARGET_SSE2 void idct8x8_dc_add_sse2(uint8_t* dst, int32_t stride, const int16_t* coeffs) { dc_add_rows_sse2(dst, stride, (coeffs[0] + 32) >> 6, 8); }
+
+/**
+ * @brief transpose the 8x8 block
+ */
+static inline TARGET_SSE2 void transpose8x8_sse2(__m128i* r) {
+    __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    r[0] = _mm_unpacklo_epi64(b0, b4);
+    r[1] = _mm_unpackhi_epi64(b0, b4);
+    r[2] = _mm_unpacklo_epi64(b1, b5);
+    r[3] = _mm_unpackhi_epi64(b1, b5);
+    r[4] = _mm_unpacklo_epi64(b2, b6);
+    r[5] = _mm_unpackhi_epi64(b2, b6);
+    r[6] = _mm_unpacklo_epi64(b3, b7);
+    r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/**
+ * @brief the 1-D 8-point inverse transform of the lanes
+ */
+static inline TARGET_SSE2 void idct8_sse2(__m128i* d) {
+    __m128i e0 = _mm_add_epi16(d[0], d[4]);
+    __m128i e1 = _mm_sub_epi16(_mm_sub_epi16(_mm_sub_epi16(d[5], d[3]), d[7]), _mm_srai_epi16(d[7], 1));
+    __m128i e2 = _mm_sub_epi16(d[0], d[4]);
+    __m128i e3 = _mm_sub_epi16(_mm_sub_epi16(_mm_add_epi16(d[1], d[7]), d[3]), _mm_srai_epi16(d[3], 1));
+    __m128i e4 = _mm_sub_epi16(_mm_srai_epi16(d[2], 1), d[6]);
+    __m128i e5 = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(d[7], d[1]), d[5]), _mm_srai_epi16(d[5], 1));
+    __m128i e6 = _mm_add_epi16(d[2], _mm_srai_epi16(d[6], 1));
+    __m128i e7 = _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(d[3], d[5]), d[1]), _mm_srai_epi16(d[1], 1));
+
+    __m128i f0 = _mm_add_epi16(e0, e6);
+    __m128i f1 = _mm_add_epi16(e1, _mm_srai_epi16(e7, 2));
+    __m128i f2 = _mm_add_epi16(e2, e4);
+    __m128i f3 = _mm_add_epi16(e3, _mm_srai_epi16(e5, 2));
+    __m128i f4 = _mm_sub_epi16(e2, e4);
+    __m128i f5 = _mm_sub_epi16(_mm_srai_epi16(e3, 2), e5);
+    __m128i f6 = _mm_sub_epi16(e0, e6);
+    __m128i f7 = _mm_sub_epi16(e7, _mm_srai_epi16(e1, 2));
+
+    d[0] = _mm_add_epi16(f0, f7);
+    d[1] = _mm_add_epi16(f2, f5);
+    d[2] = _mm_add_epi16(f4, f3);
+    d[3] = _mm_add_epi16(f6, f1);
+    d[4] = _mm_sub_epi16(f6, f1);
+    d[5] = _mm_sub_epi16(f4, f3);
+    d[6] = _mm_sub_epi16(f2, f5);
+    d[7] = _mm_sub_epi16(f0, f7);
+}
+
+static TARGET_SSE2 void idct8x8_add_sse2(uint8_t* dst, int32_t stride, const int16_t* coeffs) {
+    __m128i r[8];
+    for (int32_t i = 0; i < 8; i++) {
+        r[i] = _mm_loadu_si128((const __m128i*)(coeffs + i * 8));
+    }
+
+    transpose8x8_sse2(r);
+    idct8_sse2(r);
+    transpose8x8_sse2(r);
+    idct8_sse2(r);
+
+    for (int32_t i = 0; i < 8; i++) {
+        add_row8_sse2(dst + i * stride, r[i]);
+    }
+}
+
+/**
+ * @brief load the rows of two blocks into the two 128-bit lanes
+ */
+static inline TARGET_AVX2 __m256i load2x128_avx2(const int16_t* lo, const int16_t* hi) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)lo)), _mm_loadu_si128((const __m128i*)hi), 1);
+}
+
+/**
+ * @brief add ( h + 32 ) >> 6 of the 16 lanes to the 16 predicted samples of the row
+ */
+static inline TARGET_AVX2 void add_row16_avx2(uint8_t* dst, __m256i h) {
+    __m256i r = _mm256_srai_epi16(_mm256_add_epi16(h, _mm256_set1_epi16(32)), 6);
+    __m256i pred = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)dst));
+    __m256i rec = _mm256_add_epi16(pred, r);
+    /* the packed bytes of the two 128-bit lanes are moved to the low lane */
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(rec, rec), 0x08);
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(packed));
+}
+
+static inline TARGET_AVX2 void transpose4x4x4_avx2(__m256i* r) {
+    __m256i t0 = _mm256_unpacklo_epi16(r[0], r[1]);
+    __m256i t1 = _mm256_unpacklo_epi16(r[2], r[3]);
+    __m256i t2 = _mm256_unpackhi_epi16(r[0], r[1]);
+    __m256i t3 = _mm256_unpackhi_epi16(r[2], r[3]);
+    __m256i u0 = _mm256_unpacklo_epi32(t0, t1);
+    __m256i u1 = _mm256_unpackhi_epi32(t0, t1);
+    __m256i u2 = _mm256_unpacklo_epi32(t2, t3);
+    __m256i u3 = _mm256_unpackhi_epi32(t2, t3);
+
+    r[0] = _mm256_unpacklo_epi64(u0, u2);
+    r[1] = _mm256_unpackhi_epi64(u0, u2);
+    r[2] = _mm256_unpacklo_epi64(u1, u3);
+    r[3] = _mm256_unpackhi_epi64(u1, u3);
+}
+
+static inline TARGET_AVX2 void idct4_avx2(__m256i* r) {
+    __m256i e0 = _mm256_add_epi16(r[0], r[2]);
+    __m256i e1 = _mm256_sub_epi16(r[0], r[2]);
+    __m256i e2 = _mm256_sub_epi16(_mm256_srai_epi16(r[1], 1), r[3]);
+    __m256i e3 = _mm256_add_epi16(r[1], _mm256_srai_epi16(r[3], 1));
+
+    r[0] = _mm256_add_epi16(e0, e3);
+    r[1] = _mm256_add_epi16(e1, e2);
+    r[2] = _mm256_sub_epi16(e1, e2);
+    r[3] = _mm256_sub_epi16(e0, e3);
+}
+
+static TARGET_AVX2 void idct4x4_add4_avx2(uint8_t* dst, int32_t stride, const int16_t* coeffs) {
+    /* the blocks A, B, C and D: the lanes hold [ A, B | C, D ] */
+    __m256i r[4];
+    __m256i ac01 = load2x128_avx2(coeffs, coeffs + 32);
+    __m256i ac23 = load2x128_avx2(coeffs + 8, coeffs + 40);
+    __m256i bd01 = load2x128_avx2(coeffs + 16, coeffs + 48);
+    __m256i bd23 = load2x128_avx2(coeffs + 24, coeffs + 56);
+
+    r[0] = _mm256_unpacklo_epi64(ac01, bd01);
+    r[1] = _mm256_unpackhi_epi64(ac01, bd01);
+    r[2] = _mm256_unpacklo_epi64(ac23, bd23);
+    r[3] = _mm256_unpackhi_epi64(ac23, bd23);
+
+    transpose4x4x4_avx2(r);
+    idct4_avx2(r);
+    transpose4x4x4_avx2(r);
+    idct4_avx2(r);
+
+    for (int32_t i = 0; i < 4; i++) {
+        add_row16_avx2(dst + i * stride, r[i]);
+    }
+}
+
+static inline TARGET_AVX2 void transpose8x8x2_avx2(__m256i* r) {
+    __m256i a0 = _mm256_unpacklo_epi16(r[0], r[1]);
+    __m256i a1 = _mm256_unpackhi_epi16(r[0], r[1]);
+    __m256i a2 = _mm256_unpacklo_epi16(r[2], r[3]);
+    __m256i a3 = _mm256_unpackhi_epi16(r[2], r[3]);
+    __m256i a4 = _mm256_unpacklo_epi16(r[4], r[5]);
+    __m256i a5 = _mm256_unpackhi_epi16(r[4], r[5]);
+    __m256i a6 = _mm256_unpacklo_epi16(r[6], r[7]);
+    __m256i a7 = _mm256_unpackhi_epi16(r[6], r[7]);
+
+    __m256i b0 = _mm256_unpacklo_epi32(a0, a2);
+    __m256i b1 = _mm256_unpackhi_epi32(a0, a2);
+    __m256i b2 = _mm256_unpacklo_epi32(a1, a3);
+    __m256i b3 = _mm256_unpackhi_epi32(a1, a3);
+    __m256i b4 = _mm256_unpacklo_epi32(a4, a6);
+    __m256i b5 = _mm256_unpackhi_epi32(a4, a6);
+    __m256i b6 = _mm256_unpacklo_epi32(a5, a7);
+    __m256i b7 = _mm256_unpackhi_epi32(a5, a7);
+
+    r[0] = _mm256_unpacklo_epi64(b0, b4);
+    r[1] = _mm256_unpackhi_epi64(b0, b4);
+    r[2] = _mm256_unpacklo_epi64(b1, b5);
+    r[3] = _mm256_unpackhi_epi64(b1, b5);
+    r[4] = _mm256_unpacklo_epi64(b2, b6);
+    r[5] = _mm256_unpackhi_epi64(b2, b6);
+    r[6] = _mm256_unpacklo_epi64(b3, b7);
+    r[7] = _mm256_unpackhi_epi64(b3, b7);
+}
+
+static inline TARGET_AVX2 void idct8_avx2(__m256i* d) {
+    __m256i e0 = _mm256_add_epi16(d[0], d[4]);
+    __m256i e1 = _mm256_sub_epi16(_mm256_sub_epi16(_mm256_sub_epi16(d[5], d[3]), d[7]), _mm256_srai_epi16(d[7], 1));
+    __m256i e2 = _mm256_sub_epi16(d[0], d[4]);
+    __m256i e3 = _mm256_sub_epi16(_mm256_sub_epi16(_mm256_add_epi16(d[1], d[7]), d[3]), _mm256_srai_epi16(d[3], 1));
+    __m256i e4 = _mm256_sub_epi16(_mm256_srai_epi16(d[2], 1), d[6]);
+    __m256i e5 = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(d[7], d[1]), d[5]), _mm256_srai_epi16(d[5], 1));
+    __m256i e6 = _mm256_add_epi16(d[2], _mm256_srai_epi16(d[6], 1));
+    __m256i e7 = _mm256_add_epi16(_mm256_add_epi16(_mm256_add_epi16(d[3], d[5]), d[1]), _mm256_srai_epi16(d[1], 1));
+
+    __m256i f0 = _mm256_add_epi16(e0, e6);
+    __m256i f1 = _mm256_add_epi16(e1, _mm256_srai_epi16(e7, 2));
+    __m256i f2 = _mm256_add_epi16(e2, e4);
+    __m256i f3 = _mm256_add_epi16(e3, _mm256_srai_epi16(e5, 2));
+    __m256i f4 = _mm256_sub_epi16(e2, e4);
+    __m256i f5 = _mm256_sub_epi16(_mm256_srai_epi16(e3, 2), e5);
+    __m256i f6 = _mm256_sub_epi16(e0, e6);
+    __m256i f7 = _mm256_sub_epi16(e7, _mm256_srai_epi16(e1, 2));
+
+    d[0] = _mm256_add_epi16(f0, f7);
+    d[1] = _mm256_add_epi16(f2, f5);
+    d[2] = _mm256_add_epi16(f4, f3);
+    d[3] = _mm256_add_epi16(f6, f1);
+    d[4] = _mm256_sub_epi16(f6, f1);
+    d[5] = _mm256_sub_epi16(f4, f3);
+    d[6] = _mm256_sub_epi16(f2, f5);
+    d[7] = _mm256_sub_epi16(f0, f7);
+}
+
+static TARGET_AVX2 void idct8x8_add2_avx2(uint8_t* dst, int32_t stride, const int16_t* coeffs) {
+    __m256i r[8];
+    for (int32_t i = 0; i < 8; i++) {
+        r[i] = load2x128_avx2(coeffs + i * 8, coeffs + 64 + i * 8);
+    }
+
+    transpose8x8x2_avx2(r);
+    idct8_avx2(r);
+    transpose8x8x2_avx2(r);
+    idct8_avx2(r);
+
+    for (int32_t i = 0; i < 8; i++) {
+        add_row16_avx2(dst + i * stride, r[i]);
+    }
+}
+
+void init_transform_funcs_x86(TransformFuncs* funcs, int32_t cpu_flags) {
+    if (cpu_flags & H264_CPU_SSE2) {
+        funcs->idct4x4_add = idct4x4_add_sse2;
+        funcs->idct4x4_dc_add = idct4x4_dc_add_sse2;
+        funcs->idct4x4_add2 = idct4x4_add2_sse2;
+        funcs->idct8x8_add = idct8x8_add_sse2;
+        funcs->idct8x8_dc_add = idct8x8_dc_add_sse2;
+    }
+
+    if (cpu_flags & H264_CPU_AVX2) {
+        funcs->idct4x4_add4 = idct4x4_add4_avx2;
+        funcs->idct8x8_add2 = idct8x8_add2_avx2;
+    }
+}
+
+#else
+
+void init_transform_funcs_x86(TransformFuncs* funcs, int32_t cpu_flags) {
+    (void)funcs;
+    (void)cpu_flags;
+}
+
+#endif
@@ -0,0 +1,261 @@
+#include "h264_test_stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int put_bit(BitWriter *w, uint32_t bit) {
+    if (w->bits / 8 >= w->capacity) {
+        size_t capacity = w->capacity * 2 + 4096;
+        uint8_t *buffer = (uint8_t *)realloc(w->buffer, capacity);
+        if (!buffer) {
+            return -1;
+        }
+        w->buffer = buffer;
+        w->capacity = capacity;
+    }
+    if (w->bits % 8 == 0) {
+        w->buffer[w->bits / 8] = 0;
+    }
+    if (bit) {
+        w->buffer[w->bits / 8] |= (uint8_t)(0x80 >> (w->bits % 8));
+    }
+    w->bits++;
+    return 0;
+}
+
+int put_u(BitWriter *w, uint32_t value, int32_t n) {
+    for (int32_t i = n - 1; i >= 0; --i) {
+        if (put_bit(w, (value >> i) & 1) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int put_ue(BitWriter *w, uint32_t value) {
+    uint32_t code = value + 1;
+    int32_t leading_zeros = 0;
+    while ((code >> leading_zeros) > 1) {
+        leading_zeros++;
+    }
+    return put_u(w, 0, leading_zeros) < 0 ? -1 : put_u(w, code, leading_zeros + 1);
+}
+
+int put_se(BitWriter *w, int32_t value) { return put_ue(w, value > 0 ? (uint32_t)(2 * value - 1) : (uint32_t)(-2 * value)); }
+
+int put_trailing_bits(BitWriter *w) {
+    if (put_bit(w, 1) < 0) {
+        return -1;
+    }
+    while (w->bits % 8) {
+        if (put_bit(w, 0) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int add_nalu(Stream *stream, uint8_t nalu_header, const BitWriter *w) {
+    size_t max_size = 4 + 1 + w->bits / 8 * 3 / 2 + 1;
+    if (stream->size + max_size > stream->capacity) {
+        size_t capacity = (stream->size + max_size) * 2;
+        uint8_t *data = (uint8_t *)realloc(stream->data, capacity);
+        if (!data) {
+            return -1;
+        }
+        stream->data = data;
+        stream->capacity = capacity;
+    }
+    if (stream->count + 1 >= stream->offsets_capacity) {
+        int32_t capacity = stream->offsets_capacity * 2 + 64;
+        size_t *offsets = (size_t *)realloc(stream->offsets, capacity * sizeof(size_t));
+        if (!offsets) {
+            return -1;
+        }
+        stream->offsets = offsets;
+        stream->offsets_capacity = capacity;
+    }
+
+    uint8_t *out = stream->data + stream->size;
+    size_t n = 0;
+    int32_t zeros = 0;
+    if (stream->has_start_codes) {
+        out[n++] = 0;
+        out[n++] = 0;
+        out[n++] = 0;
+        out[n++] = 1;
+    }
+    out[n++] = nalu_header;
+    for (size_t i = 0; i < w->bits / 8; ++i) {
+        if (zeros >= 2 && w->buffer[i] <= 3) {
+            out[n++] = 3;
+            zeros = 0;
+        }
+        out[n++] = w->buffer[i];
+        zeros = w->buffer[i] == 0 ? zeros + 1 : 0;
+    }
+
+    stream->offsets[stream->count++] = stream->size;
+    stream->size += n;
+    stream->offsets[stream->count] = stream->size;
+    return 0;
+}
+
+void get_stream_nalu(const Stream *stream, int32_t i, const uint8_t **nalu_start, const uint8_t **nalu_end) {
+    *nalu_start = stream->data + stream->offsets[i] + (stream->has_start_codes ? 4 : 0);
+    *nalu_end = stream->data + stream->offsets[i + 1];
+}
+
+void free_stream(Stream *stream) {
+    free(stream->data);
+    free(stream->offsets);
+    memset(stream, 0, sizeof(Stream));
+}
+
+int write_parameter_sets(Stream *stream, BitWriter *w, int32_t width_in_mbs, int32_t height_in_mbs) {
+    return write_format_parameter_sets(stream, w, width_in_mbs, height_in_mbs, 1, 8);
+}
+
+int write_format_parameter_sets(Stream *stream, BitWriter *w, int32_t width_in_mbs, int32_t height_in_mbs, int32_t chroma_format_idc, int32_t bit_depth) {
+    /* Main, High, High 10, High 4:2:2 or High 4:4:4 Predictive, see A.2 */
+    uint32_t profile_idc = chroma_format_idc == 3 ? 244 : chroma_format_idc == 2 ? 122 : bit_depth > 8 ? 110 : chroma_format_idc == 1 ? 77 : 100;
+
+    /* @see 7.3.2.1.1 Sequence parameter set data syntax */
+    w->bits = 0;
+    put_u(w, profile_idc, 8);
+    put_u(w, 0, 8);
+    put_u(w, 40, 8);
+    put_ue(w, 0); /* seq_parameter_set_id */
+    if (profile_idc != 77) {
+        put_ue(w, (uint32_t)chroma_format_idc);
+        if (chroma_format_idc == 3) {
+            put_u(w, 0, 1); /* separate_colour_plane_flag */
+        }
+        put_ue(w, (uint32_t)bit_depth - 8); /* bit_depth_luma_minus8 */
+        put_ue(w, (uint32_t)bit_depth - 8); /* bit_depth_chroma_minus8 */
+        put_u(w, 0, 1);                     /* qpprime_y_zero_transform_bypass_flag */
+        put_u(w, 0, 1);                     /* seq_scaling_matrix_present_flag */
+    }
+    put_ue(w, 0); /* log2_max_frame_num_minus4 */
+    put_ue(w, 0); /* pic_order_cnt_type */
+    put_ue(w, 2); /* log2_max_pic_order_cnt_lsb_minus4 */
+    put_ue(w, 2); /* max_num_ref_frames */
+    put_u(w, 0, 1);
+    put_ue(w, (uint32_t)width_in_mbs - 1);
+    put_ue(w, (uint32_t)height_in_mbs - 1);
+    put_u(w, 1, 1); /* frame_mbs_only_flag */
+    put_u(w, 1, 1); /* direct_8x8_inference_flag */
+    put_u(w, 0, 1);
+    put_u(w, 0, 1);
+    if (put_trailing_bits(w) < 0 || add_nalu(stream, 0x67, w) < 0) {
+        return -1;
+    }
+
+    /* @see 7.3.2.2 Picture parameter set RBSP syntax */
+    w->bits = 0;
+    put_ue(w, 0); /* pic_parameter_set_id */
+    put_ue(w, 0); /* seq_parameter_set_id */
+    put_u(w, 0, 1);
+    put_u(w, 0, 1);
+    put_ue(w, 0); /* num_slice_groups_minus1 */
+    put_ue(w, 0);
+    put_ue(w, 0);
+    put_u(w, 0, 1);
+    put_u(w, 0, 2);
+    put_se(w, 0);
+    put_se(w, 0);
+    put_se(w, 0);
+    put_u(w, 1, 1); /* deblocking_filter_control_present_flag */
+    put_u(w, 0, 1);
+    put_u(w, 0, 1);
+    if (put_trailing_bits(w) < 0 || add_nalu(stream, 0x68, w) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t hash_frame(const DecodedFrame *frame, uint32_t parts) {
+    const FrameOrField *ff = frame->picture->frame;
+    size_t mb_count = (size_t)ff->mb_list_len;
+
+    uint64_t hash = hash_bytes(14695981039346656037ULL, &frame->poc, sizeof(frame->poc));
+    if (parts & TEST_HASH_MB_TYPES) {
+        hash = hash_bytes(hash, ff->mb_type_names, mb_count * sizeof(ff->mb_type_names[0]));
+    }
+    if (parts & TEST_HASH_QPS) {
+        hash = hash_bytes(hash, ff->mb_qps, mb_count * sizeof(ff->mb_qps[0]));
+    }
+    for (int32_t list = 0; list < 2 && (parts & TEST_HASH_MOTION); ++list) {
+        hash = hash_bytes(hash, ff->ref_idxs[list], mb_count * 16 * sizeof(ff->ref_idxs[list][0]));
+        hash = hash_bytes(hash, ff->mvs[list], mb_count * 32 * sizeof(ff->mvs[list][0]));
+    }
+    for (int32_t i = 0; i < frame->plane_count && (parts & TEST_HASH_SAMPLES); ++i) {
+        const SamplePlane *plane = &frame->planes[i];
+        for (int32_t y = 0; y < plane->height; ++y) {
+            hash = hash_bytes(hash, plane->data + (size_t)y * plane->stride * plane->bytes_per_sample, (size_t)plane->width * plane->bytes_per_sample);
+        }
+    }
+    return hash;
+}
+
+int feed_nalu(H264Context *ctx, const uint8_t *nalu_start, const uint8_t *nalu_end) {
+    void *nalu = 0;
+    int err_code = parse_nalu(nalu_start, nalu_end, ctx, &nalu);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    uint8_t nal_unit_type = nalu_start[0] & 0x1F;
+    if (nal_unit_type == NALU_SPS) {
+        err_code = add_sps_to_context(ctx, (SPS *)nalu);
+    } else if (nal_unit_type == NALU_PPS) {
+        err_code = add_pps_to_context(ctx, (PPS *)nalu);
+    } else if (nalu) {
+        free_nalu(nalu);
+    }
+    return err_code;
+}
+
+int32_t decode_test_stream(H264Context *ctx, const Stream *stream, const char *name, uint32_t parts, uint64_t *hashes, int32_t max_frames, check_frame_p check_frame) {
+    int32_t output_count = 0;
+    DecodedFrame frame;
+
+    for (int32_t i = 0; i <= stream->count; ++i) {
+        if (i < stream->count) {
+            const uint8_t *nalu_start;
+            const uint8_t *nalu_end;
+            get_stream_nalu(stream, i, &nalu_start, &nalu_end);
+
+            int err_code = feed_nalu(ctx, nalu_start, nalu_end);
+            if (err_code < 0) {
+                fprintf(stderr, "%s: NALU %d failed, error code: %d\n", name, i, err_code);
+                return -1;
+            }
+        } else if (flush_context(ctx) < 0) {
+            fprintf(stderr, "%s: the stream failed at its end\n", name);
+            return -1;
+        }
+
+        while (receive_frame(ctx, &frame) == ERR_OK) {
+            if (check_frame && check_frame(&frame, output_count) < 0) {
+                release_frame(&frame);
+                return -1;
+            }
+            if (output_count < max_frames) {
+                hashes[output_count] = hash_frame(&frame, parts);
+            }
+            output_count++;
+            release_frame(&frame);
+        }
+    }
+    return output_count;
+}
@@ -0,0 +1,126 @@
+#ifndef _H_H264_TEST_STREAM_H_
+#define _H_H264_TEST_STREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "h264decoder/h264_context.h"
+#include "h264decoder/h264_frame.h"
+
+/*
+ * the synthetic streams of the decoding tests: a bit writer for the RBSP of a NALU, the NALUs of a stream written in memory with the emulation prevention bytes,
+ * the parameter sets of a CAVLC stream of a chroma format and a bit depth, the checksums of the output frames and the decoding of a stream NALU by NALU.
+ */
+
+/* the RBSP of a NALU being written */
+typedef struct {
+    uint8_t *buffer;
+    size_t capacity;
+    size_t bits;
+} BitWriter;
+
+/**
+ * the NALUs of the stream in the decoding order. the NALU i lies in [ offsets[ i ], offsets[ i + 1 ] ), after its start code for a byte stream, see
+ * get_stream_nalu()
+ */
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    size_t *offsets;
+    int32_t count;
+    int32_t offsets_capacity;
+    /* 1 to write every NALU after a 4-byte start code, see 7.3.2 and Annex B */
+    int32_t has_start_codes;
+} Stream;
+
+/* the parts of the output frame which hash_frame() covers */
+#define TEST_HASH_MB_TYPES 0x1u
+#define TEST_HASH_QPS 0x2u
+#define TEST_HASH_MOTION 0x4u
+#define TEST_HASH_SAMPLES 0x8u
+
+/**
+ * @brief check an output frame while the stream is decoded
+ *
+ * @param frame the output frame
+ * @param index the index of the frame in the output order
+ * @return int 0 on success, negative value on error
+ */
+typedef int (*check_frame_p)(const DecodedFrame *frame, int32_t index);
+
+int put_bit(BitWriter *w, uint32_t bit);
+
+int put_u(BitWriter *w, uint32_t value, int32_t n);
+
+/* @see 9.1 Parsing process for Exp-Golomb codes */
+int put_ue(BitWriter *w, uint32_t value);
+
+int put_se(BitWriter *w, int32_t value);
+
+/* @see 7.3.2.11 RBSP trailing bits syntax */
+int put_trailing_bits(BitWriter *w);
+
+/**
+ * @brief append the NALU of the RBSP to the stream, with the emulation prevention bytes
+ *
+ * @return int 0 on success, negative value on error
+ */
+int add_nalu(Stream *stream, uint8_t nalu_header, const BitWriter *w);
+
+/**
+ * @brief get the NALU i of the stream without its start code
+ */
+void get_stream_nalu(const Stream *stream, int32_t i, const uint8_t **nalu_start, const uint8_t **nalu_end);
+
+/**
+ * @brief free the buffers of the stream
+ */
+void free_stream(Stream *stream);
+
+/**
+ * @brief write the SPS of a Main profile stream with pic_order_cnt_type 0, and its PPS with CAVLC and one active reference index per list
+ *
+ * @return int 0 on success, negative value on error
+ */
+int write_parameter_sets(Stream *stream, BitWriter *w, int32_t width_in_mbs, int32_t height_in_mbs);
+
+/**
+ * @brief write_parameter_sets() of the chroma format and the bit depth, the SPS of the High profiles carries chroma_format_idc and equal luma and chroma bit depths
+ *
+ * @param chroma_format_idc 0 to 3, the separate colour planes are not used
+ * @param bit_depth the luma and chroma bit depth, 8 to 14
+ * @return int 0 on success, negative value on error
+ */
+int write_format_parameter_sets(Stream *stream, BitWriter *w, int32_t width_in_mbs, int32_t height_in_mbs, int32_t chroma_format_idc, int32_t bit_depth);
+
+/* @see FNV-1a */
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t size);
+
+/**
+ * @brief the checksum of the output frame: its picture order count and the parts of TEST_HASH_*
+ */
+uint64_t hash_frame(const DecodedFrame *frame, uint32_t parts);
+
+/**
+ * @brief parse the NALU with the context, and add it to the context if it is a parameter set
+ *
+ * @return int 0 on success, negative value on error
+ */
+int feed_nalu(H264Context *ctx, const uint8_t *nalu_start, const uint8_t *nalu_end);
+
+/**
+ * @brief decode the NALUs of the stream with the context and flush it, the checksums of the output frames are written in the output order
+ *
+ * @param ctx the context, configured by the test
+ * @param stream the stream
+ * @param name the name of the test in the error messages
+ * @param parts the parts of the frames hashed, see hash_frame()
+ * @param hashes output parameter. the checksums of the first max_frames frames
+ * @param max_frames the size of hashes
+ * @param check_frame the check of the output frames, 0 for none
+ * @return int32_t the number of the output frames, -1 on error
+ */
+int32_t decode_test_stream(H264Context *ctx, const Stream *stream, const char *name, uint32_t parts, uint64_t *hashes, int32_t max_frames, check_frame_p check_frame);
+
+#endif
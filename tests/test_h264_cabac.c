@@ -0,0 +1,585 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_cabac.h"
+#include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_picture.h"
+#include "h264decoder/h264_rbsp.h"
+
+/*
+ * CABAC mb_type test: encodes every mb_type of the I, P and B slices with the bin strings of Tables 9-36 and 9-37 and the ctxIdx of Tables 9-39 and 9-41 by the
+ * arithmetic encoder of clause 9.3.4.2, decodes them with cabac_mb_type and checks the decoded values, I_PCM ends the slices. then reports the mb_type values
+ * decoded per second.
+ *
+ * CABAC residual test: encodes random coefficient levels of the 4x4 luma blocks of frame and field macroblocks and of the 8x8 luma blocks of frame macroblocks with
+ * the ctxIdx of clause 9.3.3.1.3 and Table 9-43, decodes them with residual_luma and checks the levels, the non-zero block masks and the total coefficients.
+ *
+ * usage: test_h264_cabac [rounds]
+ */
+
+#define SLICE_QP 26
+#define MAX_BINS 16
+#define STREAM_CAPACITY 4096
+#define RESIDUAL_ROUNDS 300
+
+/* Table 9-44 – Specification of rangeTabLPS depending on pStateIdx and qCodIRangeIdx */
+static const uint8_t g_range_tab_lps[64][4] = {
+    {128, 176, 208, 240}, {128, 167, 197, 227}, {128, 158, 187, 216}, {123, 150, 178, 205}, {116, 142, 169, 195}, {111, 135, 160, 185}, {105, 128, 152, 175}, {100, 122, 144, 166},
+    {95, 116, 137, 158},  {90, 110, 130, 150},  {85, 104, 123, 142},  {81, 99, 117, 135},   {77, 94, 111, 128},   {73, 89, 105, 122},   {69, 85, 100, 116},   {66, 80, 95, 110},
+    {62, 76, 90, 104},    {59, 72, 86, 99},     {56, 69, 81, 94},     {53, 65, 77, 89},     {51, 62, 73, 85},     {48, 59, 69, 80},     {46, 56, 66, 76},     {43, 53, 63, 72},
+    {41, 50, 59, 69},     {39, 48, 56, 65},     {37, 45, 54, 62},     {35, 43, 51, 59},     {33, 41, 48, 56},     {32, 39, 46, 53},     {30, 37, 43, 50},     {29, 35, 41, 48},
+    {27, 33, 39, 45},     {26, 31, 37, 43},     {24, 30, 35, 41},     {23, 28, 33, 39},     {22, 27, 32, 37},     {21, 26, 30, 35},     {20, 24, 29, 33},     {19, 23, 27, 31},
+    {18, 22, 26, 30},     {17, 21, 25, 28},     {16, 20, 23, 27},     {15, 19, 22, 25},     {14, 18, 21, 24},     {14, 17, 20, 23},     {13, 16, 19, 22},     {12, 15, 18, 21},
+    {12, 14, 17, 20},     {11, 14, 16, 19},     {11, 13, 15, 18},     {10, 12, 15, 17},     {10, 12, 14, 16},     {9, 11, 13, 15},      {9, 11, 12, 14},      {8, 10, 12, 14},
+    {8, 9, 11, 13},       {7, 9, 11, 12},       {7, 9, 10, 12},       {7, 8, 10, 11},       {6, 8, 9, 11},        {6, 7, 9, 10},        {6, 7, 8, 9},         {2, 2, 2, 2},
+};
+
+/* Table 9-45 – State transition table */
+static const uint8_t g_trans_idx_lps[64] = {0,  0,  1,  2,  2,  4,  4,  5,  6,  7,  8,  9,  9,  11, 11, 12, 13, 13, 15, 15, 16, 16, 18, 18, 19, 19, 21, 21, 22, 22, 23, 24,
+                                            24, 25, 26, 26, 27, 27, 28, 29, 29, 30, 30, 30, 31, 32, 32, 33, 33, 33, 34, 34, 35, 35, 35, 36, 36, 36, 37, 37, 37, 38, 38, 63};
+
+/* Table 9-37, the bin strings of mb_type 0 to 22 in B slices and the prefix of the intra macroblock types */
+static const char *g_b_bin_strings[23] = {"0",       "100",     "101",     "110000",  "110001",  "110010",  "110011",  "110100",
+                                          "110101",  "110110",  "110111",  "111110",  "1110000", "1110001", "1110010", "1110011",
+                                          "1110100", "1110101", "1110110", "1110111", "1111000", "1111001", "111111"};
+static const char *g_b_intra_prefix = "111101";
+
+/* Table 9-37, the bin strings of mb_type 0 to 3 in P slices, the prefix of the intra macroblock types is 1 */
+static const char *g_p_bin_strings[4] = {"000", "011", "010", "001"};
+
+/* Table 9-43, significant_coeff_flag and last_significant_coeff_flag of the frame coded 8x8 blocks */
+static const uint8_t g_sig_8x8_frame[63] = {0,  1,  2,  3,  4,  5,  5,  4,  4,  3,  3,  4,  4,  4,  5,  5,  4,  4,  4,  4,  3,  3,  6,  7,  7,  7,  8,  9,  10, 9,  8,  7,
+                                            7,  6,  11, 12, 13, 11, 6,  7,  8,  9,  14, 10, 9,  8,  6,  11, 12, 13, 11, 6,  9,  14, 10, 9,  11, 12, 13, 11, 14, 10, 12};
+static const uint8_t g_last_8x8[63] = {0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+                                       3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7, 8, 8, 8};
+
+/* the arithmetic encoder of clause 9.3.4.2 */
+typedef struct {
+    uint8_t buffer[STREAM_CAPACITY];
+    int32_t bit_pos;
+    int32_t codILow;
+    int32_t codIRange;
+    int32_t firstBitFlag;
+    int32_t bitsOutstanding;
+    CABAC contexts;
+} Encoder;
+
+/* the ctxIdx of the bins of an mb_type */
+typedef struct {
+    int32_t ctxIdx[MAX_BINS];
+    int32_t bins[MAX_BINS];
+    int32_t count;
+} BinString;
+
+static void write_bit(Encoder *enc, int32_t bit) {
+    if (bit) {
+        enc->buffer[enc->bit_pos >> 3] |= (uint8_t)(0x80 >> (enc->bit_pos & 7));
+    }
+    ++enc->bit_pos;
+}
+
+/* 9.3.4.2 PutBit */
+static void put_bit(Encoder *enc, int32_t bit) {
+    if (enc->firstBitFlag) {
+        enc->firstBitFlag = 0;
+    } else {
+        write_bit(enc, bit);
+    }
+    for (; enc->bitsOutstanding > 0; --enc->bitsOutstanding) {
+        write_bit(enc, 1 - bit);
+    }
+}
+
+/* 9.3.4.2 RenormE */
+static void renorm_e(Encoder *enc) {
+    while (enc->codIRange < 256) {
+        if (enc->codILow < 256) {
+            put_bit(enc, 0);
+        } else if (enc->codILow >= 512) {
+            enc->codILow -= 512;
+            put_bit(enc, 1);
+        } else {
+            enc->codILow -= 256;
+            ++enc->bitsOutstanding;
+        }
+        enc->codIRange <<= 1;
+        enc->codILow <<= 1;
+    }
+}
+
+/* 9.3.4.2 EncodeDecision */
+static void encode_decision(Encoder *enc, int32_t ctxIdx, int32_t binVal) {
+    int32_t pStateIdx = enc->contexts.pStateIdx[ctxIdx];
+    int32_t codIRangeLPS = g_range_tab_lps[pStateIdx][(enc->codIRange >> 6) & 3];
+
+    enc->codIRange -= codIRangeLPS;
+    if (binVal != enc->contexts.valMPS[ctxIdx]) {
+        enc->codILow += enc->codIRange;
+        enc->codIRange = codIRangeLPS;
+        if (pStateIdx == 0) {
+            enc->contexts.valMPS[ctxIdx] = 1 - enc->contexts.valMPS[ctxIdx];
+        }
+        enc->contexts.pStateIdx[ctxIdx] = g_trans_idx_lps[pStateIdx];
+    } else {
+        enc->contexts.pStateIdx[ctxIdx] = pStateIdx < 62 ? pStateIdx + 1 : pStateIdx;
+    }
+    renorm_e(enc);
+}
+
+/* 9.3.4.4 EncodeBypass */
+static void encode_bypass(Encoder *enc, int32_t binVal) {
+    enc->codILow <<= 1;
+    if (binVal) {
+        enc->codILow += enc->codIRange;
+    }
+    if (enc->codILow >= 1024) {
+        put_bit(enc, 1);
+        enc->codILow -= 1024;
+    } else if (enc->codILow < 512) {
+        put_bit(enc, 0);
+    } else {
+        enc->codILow -= 512;
+        ++enc->bitsOutstanding;
+    }
+}
+
+/* 9.3.4.5 EncodeTerminate and EncodeFlush, the flush writes rbsp_stop_one_bit */
+static void encode_terminate(Encoder *enc, int32_t binVal) {
+    enc->codIRange -= 2;
+    if (binVal) {
+        enc->codILow += enc->codIRange;
+        enc->codIRange = 2;
+        renorm_e(enc);
+        put_bit(enc, (enc->codILow >> 9) & 1);
+        write_bit(enc, (enc->codILow >> 8) & 1);
+        write_bit(enc, 1);
+    } else {
+        renorm_e(enc);
+    }
+}
+
+static void init_encoder(Encoder *enc, uint32_t slice_type) {
+    memset(enc, 0, sizeof(Encoder));
+    enc->codIRange = 510;
+    enc->firstBitFlag = 1;
+    cabac_init_context_variables(&enc->contexts, slice_type, 0, SLICE_QP);
+}
+
+static void push_bin(BinString *bs, int32_t ctxIdx, int32_t bin) {
+    bs->ctxIdx[bs->count] = ctxIdx;
+    bs->bins[bs->count] = bin;
+    ++bs->count;
+}
+
+/**
+ * @brief the bins of mb_type value of Table 9-36 in I slices (ctxIdxOffset 3), or of the suffix in P and SP (17) and B (32) slices. the ctxIdxInc of the first bin in
+ * I slices is 0, the macroblock has no neighbours
+ */
+static void push_intra_bins(BinString *bs, int32_t ctxIdxOffset, int32_t value) {
+    int32_t is_prefix = ctxIdxOffset == 3;
+    push_bin(bs, ctxIdxOffset, value != 0);
+    if (value == 0) {
+        return;
+    }
+    push_bin(bs, 276, value == 25);
+    if (value == 25) {
+        return;
+    }
+
+    int32_t pred_mode = (value - 1) % 4;
+    int32_t chroma = ((value - 1) / 4) % 3;
+    int32_t luma = (value - 1) / 12;
+
+    /* Table 9-39 and 9-41: binIdx 2 to 6 use ctxIdxInc 3, 4, 5 or 6, 6 or 7, 7 in I slices and 1, 2, 2 or 3, 3, 3 in the suffixes */
+    push_bin(bs, ctxIdxOffset + (is_prefix ? 3 : 1), luma);
+    push_bin(bs, ctxIdxOffset + (is_prefix ? 4 : 2), chroma != 0);
+    if (chroma != 0) {
+        push_bin(bs, ctxIdxOffset + (is_prefix ? 5 : 2), chroma == 2);
+        push_bin(bs, ctxIdxOffset + (is_prefix ? 6 : 3), pred_mode >> 1);
+        push_bin(bs, ctxIdxOffset + (is_prefix ? 7 : 3), pred_mode & 1);
+    } else {
+        push_bin(bs, ctxIdxOffset + (is_prefix ? 6 : 3), pred_mode >> 1);
+        push_bin(bs, ctxIdxOffset + (is_prefix ? 7 : 3), pred_mode & 1);
+    }
+}
+
+/* the bins of an mb_type value of Table 9-37 in P and SP slices, ctxIdxOffset 14 */
+static void push_p_bins(BinString *bs, int32_t value) {
+    if (value >= 5) {
+        push_bin(bs, 14, 1);
+        push_intra_bins(bs, 17, value - 5);
+        return;
+    }
+
+    const char *bins = g_p_bin_strings[value];
+    push_bin(bs, 14, bins[0] - '0');
+    push_bin(bs, 15, bins[1] - '0');
+    push_bin(bs, bins[1] != '1' ? 16 : 17, bins[2] - '0');
+}
+
+/* the bins of an mb_type value of Table 9-37 in B slices, ctxIdxOffset 27, the ctxIdxInc of the first bin is 0 */
+static void push_b_bins(BinString *bs, int32_t value) {
+    const char *bins = value >= 23 ? g_b_intra_prefix : g_b_bin_strings[value];
+
+    for (int32_t binIdx = 0; bins[binIdx]; ++binIdx) {
+        int32_t ctxIdxInc = binIdx >= 3 ? 5 : (binIdx == 2 ? (bins[1] != '0' ? 5 : 4) : (binIdx == 1 ? 3 : 0));
+        push_bin(bs, 27 + ctxIdxInc, bins[binIdx] - '0');
+    }
+
+    if (value >= 23) {
+        push_intra_bins(bs, 32, value - 23);
+    }
+}
+
+/**
+ * @brief encode the mb_type values of a slice, the last value ends the slice by its terminating bin if it is I_PCM, or it is followed by end_of_slice_flag
+ *
+ * @return int the stream size in bytes
+ */
+static int encode_mb_types(Encoder *enc, uint32_t slice_type, const int32_t *values, int32_t count) {
+    init_encoder(enc, slice_type);
+
+    for (int32_t i = 0; i < count; ++i) {
+        BinString bs;
+        bs.count = 0;
+        if (slice_type == SLICE_TYPE_I) {
+            push_intra_bins(&bs, 3, values[i]);
+        } else if (slice_type == SLICE_TYPE_P) {
+            push_p_bins(&bs, values[i]);
+        } else {
+            push_b_bins(&bs, values[i]);
+        }
+
+        for (int32_t binIdx = 0; binIdx < bs.count; ++binIdx) {
+            if (bs.ctxIdx[binIdx] == 276) {
+                encode_terminate(enc, bs.bins[binIdx]);
+            } else {
+                encode_decision(enc, bs.ctxIdx[binIdx], bs.bins[binIdx]);
+            }
+        }
+    }
+
+    int32_t ends_with_pcm = (slice_type == SLICE_TYPE_I && values[count - 1] == 25) || (slice_type == SLICE_TYPE_P && values[count - 1] == 30) ||
+                            (slice_type == SLICE_TYPE_B && values[count - 1] == 48);
+    if (!ends_with_pcm) {
+        encode_terminate(enc, 1); /* end_of_slice_flag */
+    }
+
+    return (enc->bit_pos + 7) >> 3;
+}
+
+/* decode count mb_type values of the first macroblock of a slice, the macroblock has no neighbours */
+static int decode_mb_types(const Encoder *enc, int32_t size, FrameOrField *ff, SliceHeader *header, int32_t *values, int32_t count) {
+    RBSPReader reader;
+    CABAC cabac;
+    reader.start = (uint8_t *)enc->buffer;
+    reader.end = (uint8_t *)enc->buffer + size + 2;
+    reader.current = reader.start;
+    reader.bits_left = 8;
+
+    cabac_init_context_variables(&cabac, header->slice_type, 0, SLICE_QP);
+    cabac_init_arithmetic_decoding_engine(&reader, &cabac);
+
+    for (int32_t i = 0; i < count; ++i) {
+        int err_code = cabac_mb_type(&reader, &cabac, ff, header, 0, &values[i]);
+        if (err_code < 0) {
+            return err_code;
+        }
+    }
+    return 0;
+}
+
+static int check_slice_type(Encoder *enc, FrameOrField *ff, SliceHeader *header, uint32_t slice_type, int32_t max_value) {
+    int32_t values[64];
+    int32_t decoded[64];
+    int32_t count = 0;
+
+    /* every value once, then I_PCM, the last value of every slice type */
+    for (int32_t value = 0; value < max_value; ++value) {
+        if (slice_type == SLICE_TYPE_P && value == 4) {
+            continue; /* P_8x8ref0 is not coded */
+        }
+        values[count++] = value;
+    }
+    values[count++] = max_value;
+
+    header->slice_type = slice_type;
+    int size = encode_mb_types(enc, slice_type, values, count);
+    if (decode_mb_types(enc, size, ff, header, decoded, count) < 0) {
+        fprintf(stderr, "cabac: mb_type decoding of slice type %u failed\n", slice_type);
+        return -1;
+    }
+
+    for (int32_t i = 0; i < count; ++i) {
+        if (decoded[i] != values[i]) {
+            fprintf(stderr, "cabac: mb_type %d of slice type %u decoded as %d\n", values[i], slice_type, decoded[i]);
+            return -1;
+        }
+    }
+
+    printf("cabac: %d mb_type values of slice type %u verified\n", count, slice_type);
+    return 0;
+}
+
+/**
+ * @brief encode the bins of residual_block_cabac( ) of Table 9-34, 9.3.3.1.3 and Table 9-43 for the luma blocks of ctxBlockCat 2 and 5 of a macroblock without
+ * neighbours
+ *
+ * @param cbf_ctxIdxInc the ctxIdxInc of coded_block_flag, negative if coded_block_flag is inferred
+ */
+static void encode_residual_block(Encoder *enc, const int32_t *levels, int32_t maxNumCoeff, int32_t is_field, int32_t cbf_ctxIdxInc) {
+    int32_t is_8x8 = maxNumCoeff == 64;
+    int32_t last = -1;
+    for (int32_t i = 0; i < maxNumCoeff; ++i) {
+        if (levels[i]) {
+            last = i;
+        }
+    }
+
+    if (cbf_ctxIdxInc >= 0) {
+        encode_decision(enc, 85 + 8 + cbf_ctxIdxInc, last >= 0);
+    }
+    if (last < 0) {
+        return;
+    }
+
+    for (int32_t i = 0; i < maxNumCoeff - 1; ++i) {
+        int32_t sig_ctxIdx = is_8x8 ? 402 + g_sig_8x8_frame[i] : (is_field ? 277 : 105) + 29 + i;
+        int32_t last_ctxIdx = is_8x8 ? 417 + g_last_8x8[i] : (is_field ? 338 : 166) + 29 + i;
+        encode_decision(enc, sig_ctxIdx, levels[i] != 0);
+        if (levels[i]) {
+            encode_decision(enc, last_ctxIdx, i == last);
+            if (i == last) {
+                break;
+            }
+        }
+    }
+
+    /* coeff_abs_level_minus1 by UEG0 with uCoff 14 and coeff_sign_flag, in the reverse scanning order */
+    int32_t ctxIdxBase = is_8x8 ? 426 : 227 + 20;
+    int32_t numEq1 = 0;
+    int32_t numGt1 = 0;
+    for (int32_t i = last; i >= 0; --i) {
+        if (!levels[i]) {
+            continue;
+        }
+
+        int32_t value = abs(levels[i]) - 1;
+        encode_decision(enc, ctxIdxBase + (numGt1 ? 0 : (numEq1 + 1 < 4 ? numEq1 + 1 : 4)), value > 0);
+        for (int32_t binIdx = 1; binIdx < 14 && binIdx <= value; ++binIdx) {
+            encode_decision(enc, ctxIdxBase + 5 + (numGt1 < 4 ? numGt1 : 4), binIdx < value);
+        }
+        if (value >= 14) {
+            int32_t suffix = value - 14;
+            int32_t k = 0;
+            while (suffix >= (1 << k)) {
+                encode_bypass(enc, 1);
+                suffix -= 1 << k;
+                ++k;
+            }
+            encode_bypass(enc, 0);
+            while (k--) {
+                encode_bypass(enc, (suffix >> k) & 1);
+            }
+        }
+        encode_bypass(enc, levels[i] < 0);
+
+        if (value) {
+            ++numGt1;
+        } else {
+            ++numEq1;
+        }
+    }
+}
+
+/* a sparse random level, the magnitudes above 15 use the Exp-Golomb suffix of coeff_abs_level_minus1 */
+static int32_t random_level(uint32_t *seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    uint32_t r = *seed >> 8;
+    if (r % 8 < 5) {
+        return 0;
+    }
+    int32_t magnitude = (r >> 3) % 16 == 0 ? 1 + (int32_t)((r >> 7) % 300) : 1 + (int32_t)((r >> 7) % 3);
+    return (r >> 16) & 1 ? -magnitude : magnitude;
+}
+
+/**
+ * @brief encode random levels of the luma residual of an Intra_4x4 or Intra_8x8 macroblock with every CodedBlockPatternLuma bit set, decode them with residual_luma
+ * and check them
+ */
+static int check_residual(Encoder *enc, FrameOrField *ff, SliceHeader *header, MacroBlockScratch *scratch, int32_t is_8x8, uint32_t *seed) {
+    int32_t levels[16][64];
+    uint32_t expected_flags = 0;
+    uint64_t expected_total = 0;
+    int32_t maxNumCoeff = is_8x8 ? 64 : 16;
+    int32_t blocks = is_8x8 ? 4 : 16;
+
+    for (int32_t blk = 0; blk < blocks; ++blk) {
+        int32_t total = 0;
+        int32_t density = (int32_t)(*seed >> 28) % 4;
+        for (int32_t i = 0; i < maxNumCoeff; ++i) {
+            levels[blk][i] = density == 0 ? 0 : random_level(seed);
+            total += levels[blk][i] != 0;
+        }
+        /* the coded_block_flag of the 8x8 blocks is inferred to be 1 */
+        if (is_8x8 && !total) {
+            levels[blk][maxNumCoeff - 1] = -2;
+            total = 1;
+        }
+        if (total) {
+            expected_flags |= (is_8x8 ? 0xFu : 1u) << (is_8x8 ? blk * 4 : blk);
+        }
+        if (!is_8x8) {
+            expected_total |= (uint64_t)(total < 15 ? total : 15) << (blk * 4);
+        }
+    }
+
+    init_encoder(enc, SLICE_TYPE_I);
+    for (int32_t blk = 0; blk < blocks; ++blk) {
+        /* the left and upper 4x4 blocks inside the macroblock, the blocks outside it are not available and give condTermFlagN 1 in an intra macroblock */
+        int32_t cbf_ctxIdxInc = -1;
+        if (!is_8x8) {
+            int32_t x = ((blk >> 2) & 1) * 2 + (blk & 1);
+            int32_t y = (blk >> 3) * 2 + ((blk >> 1) & 1);
+            int32_t blkA = x > 0 ? ((y >> 1) * 8 + ((x - 1) >> 1) * 4 + (y & 1) * 2 + ((x - 1) & 1)) : -1;
+            int32_t blkB = y > 0 ? (((y - 1) >> 1) * 8 + (x >> 1) * 4 + ((y - 1) & 1) * 2 + (x & 1)) : -1;
+            int32_t condTermFlagA = blkA < 0 ? 1 : (int32_t)((expected_flags >> blkA) & 1);
+            int32_t condTermFlagB = blkB < 0 ? 1 : (int32_t)((expected_flags >> blkB) & 1);
+            cbf_ctxIdxInc = condTermFlagA + 2 * condTermFlagB;
+        }
+        encode_residual_block(enc, levels[blk], maxNumCoeff, header->field_pic_flag, cbf_ctxIdxInc);
+    }
+    encode_terminate(enc, 1); /* end_of_slice_flag */
+    int32_t size = (enc->bit_pos + 7) >> 3;
+
+    MacroBlock *mb = &ff->mb_list[0];
+    mb->mb_pred_type = Intra_4x4;
+    mb->transform_size_8x8_flag = (uint8_t)is_8x8;
+    mb->CodedBlockPatternLuma = 15;
+    mb->coded_block_flags = 0;
+    mb->coded_block_flags_444 = 0;
+    mb->coded_block_flags_dc = 0;
+    memset(mb->total_coeff, 0, sizeof(mb->total_coeff));
+    ff->mb_scratch = scratch;
+
+    RBSPReader reader;
+    CABAC cabac;
+    reader.start = enc->buffer;
+    reader.end = enc->buffer + size + 2;
+    reader.current = reader.start;
+    reader.bits_left = 8;
+    cabac_init_context_variables(&cabac, SLICE_TYPE_I, 0, SLICE_QP);
+    cabac_init_arithmetic_decoding_engine(&reader, &cabac);
+
+    int err_code = residual_luma(&reader, ff, mb, header, &cabac, 0, 0, 0, 15);
+    ff->mb_scratch = 0;
+    if (err_code < 0) {
+        fprintf(stderr, "cabac: residual decoding failed (%d)\n", err_code);
+        return -1;
+    }
+
+    for (int32_t blk = 0; blk < blocks; ++blk) {
+        const int32_t *decoded = is_8x8 ? scratch->level8x8[0][blk] : scratch->level4x4[0][blk];
+        if (memcmp(decoded, levels[blk], maxNumCoeff * sizeof(int32_t)) != 0) {
+            fprintf(stderr, "cabac: the levels of the %s block %d differ\n", is_8x8 ? "8x8" : "4x4", blk);
+            return -1;
+        }
+    }
+    if (mb->coded_block_flags != expected_flags || (!is_8x8 && mb->total_coeff[0] != expected_total)) {
+        fprintf(stderr, "cabac: coded_block_flags 0x%x, expected 0x%x\n", mb->coded_block_flags, expected_flags);
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t rounds = 200000;
+    Encoder *enc = 0;
+    FrameOrField *ff = 0;
+    SPS sps;
+    PPS pps;
+    SliceHeader header;
+    MacroBlockScratch *scratch = 0;
+    uint32_t seed = 1;
+
+    if (argc > 1) {
+        rounds = atoi(argv[1]);
+    }
+    if (rounds <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    enc = (Encoder *)malloc(sizeof(Encoder));
+    ff = create_frame_or_field();
+    scratch = (MacroBlockScratch *)malloc(sizeof(MacroBlockScratch));
+    if (!enc || !ff || !scratch || alloc_frame_or_field(ff, 1) < 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+
+    memset(&sps, 0, sizeof(sps));
+    memset(&pps, 0, sizeof(pps));
+    memset(&header, 0, sizeof(header));
+    sps.PicWidthInMbs = 1;
+    sps.MbWidthC = 8;
+    sps.MbHeightC = 8;
+    sps.ChromaArrayType = 1;
+    pps.entropy_coding_mode_flag = 1;
+    header.sps = &sps;
+    header.pps = &pps;
+    header.PicSizeInMbs = 1;
+
+    /* verify: I_PCM is 25 in I slices, 30 in P slices and 48 in B slices */
+    if (check_slice_type(enc, ff, &header, SLICE_TYPE_I, 25) < 0 || check_slice_type(enc, ff, &header, SLICE_TYPE_P, 30) < 0 ||
+        check_slice_type(enc, ff, &header, SLICE_TYPE_B, 48) < 0) {
+        goto exit_flag;
+    }
+
+    /* verify: the 4x4 blocks of frame and field macroblocks and the 8x8 blocks of frame macroblocks */
+    header.slice_type = SLICE_TYPE_I;
+    for (int32_t round = 0; round < RESIDUAL_ROUNDS; ++round) {
+        header.field_pic_flag = (uint8_t)(round % 3 == 1);
+        if (check_residual(enc, ff, &header, scratch, round % 3 == 2, &seed) < 0) {
+            fprintf(stderr, "cabac: residual round %d failed\n", round);
+            goto exit_flag;
+        }
+    }
+    header.field_pic_flag = 0;
+    printf("cabac: %d residual macroblocks verified\n", RESIDUAL_ROUNDS);
+
+    /* benchmark: the B slice of every mb_type value */
+    int32_t values[48];
+    int32_t decoded[48];
+    for (int32_t value = 0; value < 48; ++value) {
+        values[value] = value;
+    }
+    header.slice_type = SLICE_TYPE_B;
+    int size = encode_mb_types(enc, SLICE_TYPE_B, values, 48);
+
+    clock_t start = clock();
+    for (int32_t i = 0; i < rounds; ++i) {
+        if (decode_mb_types(enc, size, ff, &header, decoded, 48) < 0) {
+            fprintf(stderr, "benchmark: round %d failed\n", i);
+            goto exit_flag;
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    double count = (double)rounds * 48;
+
+    printf("cabac: %.0f mb_type values in %.3f s, %.2f M values/s\n", count, seconds, seconds > 0 ? count / seconds / 1e6 : 0.0);
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    free(enc);
+    free(scratch);
+    if (ff) {
+        free_frame_or_field(ff);
+    }
+    return exit_code;
+}
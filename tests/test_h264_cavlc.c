@@ -0,0 +1,551 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_cavlc.h"
+#include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_picture.h"
+#include "h264decoder/h264_rbsp.h"
+
+/*
+ * CAVLC benchmark: encodes synthetic residual blocks with the code tables of clause 9.2, decodes them with residual_block_cavlc,
+ * checks the decoded levels and reports the decoded symbols per second. the residual of a macroblock is parsed with the nC derived from its neighbours, and
+ * its non-zero block mask and TotalCoeff are checked.
+ *
+ * usage: test_h264_cavlc [block count] [rounds]
+ */
+
+/* Table 9-5, indexed by [nC range][TotalCoeff * 4 + TrailingOnes] */
+static const uint8_t g_coeff_token_len[6][68] = {
+    {1, 0, 0, 0, 6, 2, 0, 0, 8, 6, 3, 0, 9, 8, 7, 5, 10, 9, 8, 6, 11, 10, 9, 7, 13, 11, 10, 8, 13, 13, 11, 9, 13, 13, 13, 10, 14, 14, 13, 11, 14, 14, 14, 13, 15, 15, 14, 14, 15, 15, 15, 14, 16, 15, 15, 15, 16, 16, 16, 15, 16, 16, 16, 16, 16, 16, 16, 16},
+    {2, 0, 0, 0, 6, 2, 0, 0, 6, 5, 3, 0, 7, 6, 6, 4, 8, 6, 6, 4, 8, 7, 7, 5, 9, 8, 8, 6, 11, 9, 9, 6, 11, 11, 11, 7, 12, 11, 11, 9, 12, 12, 12, 11, 12, 12, 12, 11, 13, 13, 13, 12, 13, 13, 13, 13, 13, 14, 13, 13, 14, 14, 14, 13, 14, 14, 14, 14},
+    {4, 0, 0, 0, 6, 4, 0, 0, 6, 5, 4, 0, 6, 5, 5, 4, 7, 5, 5, 4, 7, 5, 5, 4, 7, 6, 6, 4, 7, 6, 6, 4, 8, 7, 7, 5, 8, 8, 7, 6, 9, 8, 8, 7, 9, 9, 8, 8, 9, 9, 9, 8, 10, 9, 9, 9, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10},
+    {6, 0, 0, 0, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6},
+    {2, 0, 0, 0, 6, 1, 0, 0, 6, 6, 3, 0, 6, 7, 7, 6, 6, 8, 8, 7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {1, 0, 0, 0, 7, 2, 0, 0, 7, 7, 3, 0, 9, 7, 7, 5, 9, 9, 7, 6, 10, 10, 9, 7, 11, 11, 10, 7, 12, 12, 11, 10, 13, 12, 12, 11, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+};
+
+static const uint8_t g_coeff_token_bits[6][68] = {
+    {1, 0, 0, 0, 5, 1, 0, 0, 7, 4, 1, 0, 7, 6, 5, 3, 7, 6, 5, 3, 7, 6, 5, 4, 15, 6, 5, 4, 11, 14, 5, 4, 8, 10, 13, 4, 15, 14, 9, 4, 11, 10, 13, 12, 15, 14, 9, 12, 11, 10, 13, 8, 15, 1, 9, 12, 11, 14, 13, 8, 7, 10, 9, 12, 4, 6, 5, 8},
+    {3, 0, 0, 0, 11, 2, 0, 0, 7, 7, 3, 0, 7, 10, 9, 5, 7, 6, 5, 4, 4, 6, 5, 6, 7, 6, 5, 8, 15, 6, 5, 4, 11, 14, 13, 4, 15, 10, 9, 4, 11, 14, 13, 12, 8, 10, 9, 8, 15, 14, 13, 12, 11, 10, 9, 12, 7, 11, 6, 8, 9, 8, 10, 1, 7, 6, 5, 4},
+    {15, 0, 0, 0, 15, 14, 0, 0, 11, 15, 13, 0, 8, 12, 14, 12, 15, 10, 11, 11, 11, 8, 9, 10, 9, 14, 13, 9, 8, 10, 9, 8, 15, 14, 13, 13, 11, 14, 10, 12, 15, 10, 13, 12, 11, 14, 9, 12, 8, 10, 13, 8, 13, 7, 9, 12, 9, 12, 11, 10, 5, 8, 7, 6, 1, 4, 3, 2},
+    {3, 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63},
+    {1, 0, 0, 0, 7, 1, 0, 0, 4, 6, 1, 0, 3, 3, 2, 5, 2, 3, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {1, 0, 0, 0, 15, 1, 0, 0, 14, 13, 1, 0, 7, 12, 11, 1, 6, 5, 10, 1, 7, 6, 4, 9, 7, 6, 5, 8, 7, 6, 5, 4, 7, 5, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+};
+
+/* Table 9-7, 9-8 and 9-9, indexed by [table][tzVlcIndex - 1][total_zeros] */
+static const uint8_t g_total_zeros_len_4x4[15][16] = {
+    {1, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 9},
+    {3, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 6, 6, 6, 6},
+    {4, 3, 3, 3, 4, 4, 3, 3, 4, 5, 5, 6, 5, 6},
+    {5, 3, 4, 4, 3, 3, 3, 4, 3, 4, 5, 5, 5},
+    {4, 4, 4, 3, 3, 3, 3, 3, 4, 5, 4, 5},
+    {6, 5, 3, 3, 3, 3, 3, 3, 4, 3, 6},
+    {6, 5, 3, 3, 3, 2, 3, 4, 3, 6},
+    {6, 4, 5, 3, 2, 2, 3, 3, 6},
+    {6, 6, 4, 2, 2, 3, 2, 5},
+    {5, 5, 3, 2, 2, 2, 4},
+    {4, 4, 3, 3, 1, 3},
+    {4, 4, 2, 1, 3},
+    {3, 3, 1, 2},
+    {2, 2, 1},
+    {1, 1},
+};
+static const uint8_t g_total_zeros_bits_4x4[15][16] = {
+    {1, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 1},
+    {7, 6, 5, 4, 3, 5, 4, 3, 2, 3, 2, 3, 2, 1, 0},
+    {5, 7, 6, 5, 4, 3, 4, 3, 2, 3, 2, 1, 1, 0},
+    {3, 7, 5, 4, 6, 5, 4, 3, 3, 2, 2, 1, 0},
+    {5, 4, 3, 7, 6, 5, 4, 3, 2, 1, 1, 0},
+    {1, 1, 7, 6, 5, 4, 3, 2, 1, 1, 0},
+    {1, 1, 5, 4, 3, 3, 2, 1, 1, 0},
+    {1, 1, 1, 3, 3, 2, 2, 1, 0},
+    {1, 0, 1, 3, 2, 1, 1, 1},
+    {1, 0, 1, 3, 2, 1, 1},
+    {0, 1, 1, 2, 1, 3},
+    {0, 1, 1, 1, 1},
+    {0, 1, 1, 1},
+    {0, 1, 1},
+    {0, 1},
+};
+static const uint8_t g_total_zeros_len_2x2[3][4] = {
+    {1, 2, 3, 3},
+    {1, 2, 2},
+    {1, 1},
+};
+static const uint8_t g_total_zeros_bits_2x2[3][4] = {
+    {1, 1, 1, 0},
+    {1, 1, 0},
+    {1, 0},
+};
+static const uint8_t g_total_zeros_len_2x4[7][8] = {
+    {1, 3, 3, 4, 4, 4, 5, 5},
+    {3, 2, 3, 3, 3, 3, 3},
+    {3, 3, 2, 2, 3, 3},
+    {3, 2, 2, 2, 3},
+    {2, 2, 2, 2},
+    {2, 2, 1},
+    {1, 1},
+};
+static const uint8_t g_total_zeros_bits_2x4[7][8] = {
+    {1, 2, 3, 2, 3, 1, 1, 0},
+    {0, 1, 1, 4, 5, 6, 7},
+    {0, 1, 1, 2, 6, 7},
+    {6, 0, 1, 2, 7},
+    {0, 1, 2, 3},
+    {0, 1, 1},
+    {0, 1},
+};
+/* Table 9-10, indexed by [Min( zerosLeft, 7 ) - 1][run_before] */
+static const uint8_t g_run_before_len[7][15] = {
+    {1, 1},
+    {1, 2, 2},
+    {2, 2, 2, 2},
+    {2, 2, 2, 3, 3},
+    {2, 2, 3, 3, 3, 3},
+    {2, 3, 3, 3, 3, 3, 3},
+    {3, 3, 3, 3, 3, 3, 3, 4, 5, 6, 7, 8, 9, 10, 11},
+};
+static const uint8_t g_run_before_bits[7][15] = {
+    {1, 0},
+    {1, 1, 0},
+    {3, 2, 1, 0},
+    {3, 2, 1, 1, 0},
+    {3, 2, 3, 2, 1, 0},
+    {3, 0, 1, 3, 2, 5, 4},
+    {7, 6, 5, 4, 3, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+};
+
+typedef struct {
+    uint8_t* buffer;
+    size_t capacity;
+    size_t bit_pos;
+} BitWriter;
+
+static void write_bits(BitWriter* writer, uint32_t value, int n) {
+    for (int i = n - 1; i >= 0; --i) {
+        size_t byte_pos = writer->bit_pos >> 3;
+        if (byte_pos >= writer->capacity) {
+            return;
+        }
+        if ((value >> i) & 0x01) {
+            writer->buffer[byte_pos] |= (uint8_t)(0x80 >> (writer->bit_pos & 0x07));
+        }
+        writer->bit_pos++;
+    }
+}
+
+typedef struct {
+    int32_t nC;
+    int32_t startIdx;
+    int32_t endIdx;
+    int32_t maxNumCoeff;
+    int32_t coeffLevel[16];
+} SyntheticBlock;
+
+static uint32_t g_random_state = 0x12345678;
+
+static uint32_t next_random() {
+    g_random_state = g_random_state * 1664525u + 1013904223u;
+    return g_random_state >> 8;
+}
+
+/* small levels are much more frequent than the large ones, as in the real streams */
+static int32_t random_level() {
+    uint32_t r = next_random() % 100;
+    int32_t magnitude = 0;
+
+    if (r < 60) {
+        magnitude = 1;
+    } else if (r < 85) {
+        magnitude = 2 + (int32_t)(next_random() % 3);
+    } else if (r < 98) {
+        magnitude = 5 + (int32_t)(next_random() % 60);
+    } else {
+        magnitude = 65 + (int32_t)(next_random() % 1900);
+    }
+
+    return (next_random() & 0x01) ? magnitude : -magnitude;
+}
+
+static void generate_block(SyntheticBlock* block) {
+    static const int32_t nC_values[] = {0, 1, 2, 3, 5, 9, -1, -2};
+    int32_t nC = nC_values[next_random() % 8];
+
+    memset(block, 0, sizeof(SyntheticBlock));
+    block->nC = nC;
+
+    if (nC == -1) {
+        block->maxNumCoeff = 4;
+        block->endIdx = 3;
+    } else if (nC == -2) {
+        block->maxNumCoeff = 8;
+        block->endIdx = 7;
+    } else if (next_random() % 4 == 0) {
+        /* AC block of Intra16x16 or chroma */
+        block->maxNumCoeff = 15;
+        block->endIdx = 14;
+    } else {
+        block->maxNumCoeff = 16;
+        block->endIdx = 15;
+    }
+
+    int32_t numCoeff = block->endIdx - block->startIdx + 1;
+    int32_t TotalCoeff = (int32_t)(next_random() % (numCoeff + 1));
+    if (nC >= 0 && nC < 2 && TotalCoeff > 8) {
+        TotalCoeff = (int32_t)(next_random() % 9);
+    }
+
+    /* the positions of the non-zero coefficients */
+    int32_t count = 0;
+    while (count < TotalCoeff) {
+        int32_t pos = (int32_t)(next_random() % numCoeff);
+        if (block->coeffLevel[block->startIdx + pos] == 0) {
+            block->coeffLevel[block->startIdx + pos] = random_level();
+            count++;
+        }
+    }
+}
+
+/* 9.2.2 level coding, the inverse of the level parsing */
+static void write_level(BitWriter* writer, int32_t level, int32_t levelCodeAdjust, int32_t suffixLength) {
+    int32_t levelCode = level > 0 ? 2 * level - 2 : -2 * level - 1;
+    levelCode -= levelCodeAdjust;
+
+    if (suffixLength == 0) {
+        if (levelCode < 14) {
+            write_bits(writer, 1, levelCode + 1);
+        } else if (levelCode < 30) {
+            write_bits(writer, 1, 15);
+            write_bits(writer, (uint32_t)(levelCode - 14), 4);
+        } else {
+            write_bits(writer, 1, 16);
+            write_bits(writer, (uint32_t)(levelCode - 30), 12);
+        }
+    } else {
+        if ((levelCode >> suffixLength) < 15) {
+            write_bits(writer, 1, (levelCode >> suffixLength) + 1);
+            write_bits(writer, (uint32_t)(levelCode & ((1 << suffixLength) - 1)), suffixLength);
+        } else {
+            write_bits(writer, 1, 16);
+            write_bits(writer, (uint32_t)(levelCode - (15 << suffixLength)), 12);
+        }
+    }
+}
+
+/* encode the block and return the number of syntax elements */
+static int32_t encode_block(BitWriter* writer, const SyntheticBlock* block) {
+    int32_t levelVal[16];
+    int32_t runVal[16];
+    int32_t TotalCoeff = 0;
+    int32_t TrailingOnes = 0;
+    int32_t total_zeros = 0;
+    int32_t symbols = 0;
+    int32_t table = 0;
+
+    /* the levels and runs in the reverse scanning order */
+    int32_t last = -1;
+    for (int32_t i = block->endIdx; i >= block->startIdx; --i) {
+        if (block->coeffLevel[i]) {
+            if (TotalCoeff > 0) {
+                runVal[TotalCoeff - 1] = last - i - 1;
+            }
+            levelVal[TotalCoeff++] = block->coeffLevel[i];
+            last = i;
+        }
+    }
+
+    if (TotalCoeff > 0) {
+        runVal[TotalCoeff - 1] = last - block->startIdx;
+    }
+
+    for (int32_t i = 0; i < TotalCoeff && i < 3; ++i) {
+        if (levelVal[i] != 1 && levelVal[i] != -1) {
+            break;
+        }
+        TrailingOnes++;
+    }
+
+    for (int32_t i = 0; i < TotalCoeff; ++i) {
+        total_zeros += runVal[i];
+    }
+
+    if (block->nC == -1) {
+        table = 4;
+    } else if (block->nC == -2) {
+        table = 5;
+    } else if (block->nC < 2) {
+        table = 0;
+    } else if (block->nC < 4) {
+        table = 1;
+    } else if (block->nC < 8) {
+        table = 2;
+    } else {
+        table = 3;
+    }
+
+    write_bits(writer, g_coeff_token_bits[table][TotalCoeff * 4 + TrailingOnes], g_coeff_token_len[table][TotalCoeff * 4 + TrailingOnes]);
+    symbols++;
+
+    if (TotalCoeff == 0) {
+        return symbols;
+    }
+
+    int32_t suffixLength = (TotalCoeff > 10 && TrailingOnes < 3) ? 1 : 0;
+    for (int32_t i = 0; i < TotalCoeff; ++i) {
+        if (i < TrailingOnes) {
+            write_bits(writer, levelVal[i] < 0, 1);
+        } else {
+            write_level(writer, levelVal[i], (i == TrailingOnes && TrailingOnes < 3) ? 2 : 0, suffixLength);
+
+            if (suffixLength == 0) {
+                suffixLength = 1;
+            }
+            if (abs(levelVal[i]) > (3 << (suffixLength - 1)) && suffixLength < 6) {
+                suffixLength++;
+            }
+        }
+        symbols++;
+    }
+
+    if (TotalCoeff < block->endIdx - block->startIdx + 1) {
+        if (block->maxNumCoeff == 4) {
+            write_bits(writer, g_total_zeros_bits_2x2[TotalCoeff - 1][total_zeros], g_total_zeros_len_2x2[TotalCoeff - 1][total_zeros]);
+        } else if (block->maxNumCoeff == 8) {
+            write_bits(writer, g_total_zeros_bits_2x4[TotalCoeff - 1][total_zeros], g_total_zeros_len_2x4[TotalCoeff - 1][total_zeros]);
+        } else {
+            write_bits(writer, g_total_zeros_bits_4x4[TotalCoeff - 1][total_zeros], g_total_zeros_len_4x4[TotalCoeff - 1][total_zeros]);
+        }
+        symbols++;
+    }
+
+    int32_t zerosLeft = total_zeros;
+    for (int32_t i = 0; i < TotalCoeff - 1 && zerosLeft > 0; ++i) {
+        int32_t table_index = (zerosLeft > 7 ? 7 : zerosLeft) - 1;
+        write_bits(writer, g_run_before_bits[table_index][runVal[i]], g_run_before_len[table_index][runVal[i]]);
+        zerosLeft -= runVal[i];
+        symbols++;
+    }
+
+    return symbols;
+}
+
+/* write a 4x4 block of a macroblock with the levels at the scanning positions pos, the block has no levels if count is 0 */
+static void write_mb_block(BitWriter *writer, int32_t nC, int32_t maxNumCoeff, const int32_t *pos, const int32_t *levels, int32_t count) {
+    SyntheticBlock block;
+    memset(&block, 0, sizeof(block));
+    block.nC = nC;
+    block.maxNumCoeff = maxNumCoeff;
+    block.endIdx = maxNumCoeff - 1;
+    for (int32_t i = 0; i < count; ++i) {
+        block.coeffLevel[pos[i]] = levels[i];
+    }
+    encode_block(writer, &block);
+}
+
+/**
+ * @brief parse the residual of an Intra_4x4 macroblock right of a macroblock whose luma block 5 has 4 coefficients. the nC of every block is computed by hand from
+ * clause 9.2.1, so a wrong nC desynchronizes the levels, then the non-zero block mask and TotalCoeff of the parsed blocks are checked
+ */
+static int check_macroblock_masks() {
+    static const int32_t pos0[2] = {0, 1};
+    static const int32_t levels0[2] = {3, -1};
+    static const int32_t pos2[1] = {0};
+    static const int32_t levels2[1] = {1};
+    static const int32_t pos3[3] = {0, 2, 5};
+    static const int32_t levels3[3] = {2, 1, -1};
+    static const int32_t pos_cb0[1] = {3};
+    static const int32_t levels_cb0[1] = {-2};
+
+    int ret = -1;
+    uint8_t buffer[256];
+    BitWriter writer = {buffer, sizeof(buffer), 0};
+    SPS sps;
+    PPS pps;
+    SliceHeader header;
+    MacroBlockScratch mb_scratch;
+    FrameOrField *ff = create_frame_or_field();
+
+    if (!ff || alloc_frame_or_field(ff, 2) < 0) {
+        fprintf(stderr, "CAVLC: frame allocation failed\n");
+        goto exit_flag;
+    }
+    /* the residual is parsed into the scratch of the test thread as slice_data() attaches the scratch of the decoding thread */
+    memset(&mb_scratch, 0, sizeof(mb_scratch));
+    ff->mb_scratch = &mb_scratch;
+
+    memset(buffer, 0, sizeof(buffer));
+    memset(&sps, 0, sizeof(sps));
+    memset(&pps, 0, sizeof(pps));
+    memset(&header, 0, sizeof(header));
+    sps.PicWidthInMbs = 2;
+    sps.ChromaArrayType = 1;
+    sps.SubWidthC = 2;
+    sps.SubHeightC = 2;
+    sps.MbWidthC = 8;
+    sps.MbHeightC = 8;
+    header.sps = &sps;
+    header.pps = &pps;
+
+    /* the left macroblock: block 5, in the right column, has 4 coefficients */
+    ff->mb_slice_ids[0] = 0;
+    ff->mb_slice_ids[1] = 0;
+    ff->mb_list[0].mb_pred_type = Intra_4x4;
+    ff->mb_list[0].total_coeff[0] = 4ull << (5 * 4);
+
+    MacroBlock *mb = &ff->mb_list[1];
+    mb->mb_pred_type = Intra_4x4;
+    mb->CodedBlockPatternLuma = 1;
+    mb->CodedBlockPatternChroma = 2;
+
+    /* luma blocks 0 to 3: nC = nA = 4, nA = 2, ( nA + nB + 1 ) >> 1 = ( 0 + 2 + 1 ) >> 1 = 1, ( 1 + 0 + 1 ) >> 1 = 1 */
+    write_mb_block(&writer, 4, 16, pos0, levels0, 2);
+    write_mb_block(&writer, 2, 16, 0, 0, 0);
+    write_mb_block(&writer, 1, 16, pos2, levels2, 1);
+    write_mb_block(&writer, 1, 16, pos3, levels3, 3);
+    /* the Cb and Cr DC blocks without levels, the Cb AC block 0 has one level: nC 0, 1, 1, 0 of the Cb blocks and 0 of the Cr blocks */
+    write_mb_block(&writer, -1, 4, 0, 0, 0);
+    write_mb_block(&writer, -1, 4, 0, 0, 0);
+    write_mb_block(&writer, 0, 15, pos_cb0, levels_cb0, 1);
+    write_mb_block(&writer, 1, 15, 0, 0, 0);
+    write_mb_block(&writer, 1, 15, 0, 0, 0);
+    write_mb_block(&writer, 0, 15, 0, 0, 0);
+    for (int32_t i = 0; i < 4; ++i) {
+        write_mb_block(&writer, 0, 15, 0, 0, 0);
+    }
+
+    RBSPReader reader;
+    reader.start = buffer;
+    reader.end = buffer + ((writer.bit_pos + 7) >> 3);
+    reader.current = reader.start;
+    reader.bits_left = 8;
+
+    int err_code = residual(&reader, ff, mb, &header, 0, 1, 0, 15);
+    if (err_code < 0) {
+        fprintf(stderr, "CAVLC: macroblock residual parsing failed, error code: %d\n", err_code);
+        goto exit_flag;
+    }
+
+    MacroBlockScratch *scratch = ff->mb_scratch;
+    if (scratch->level4x4[0][0][0] != 3 || scratch->level4x4[0][0][1] != -1 || scratch->level4x4[0][3][5] != -1 || scratch->ChromaACLevel[0][0][3] != -2 ||
+        (int32_t)(((writer.bit_pos + 7) >> 3) - (reader.current - reader.start)) > 1) {
+        fprintf(stderr, "CAVLC: macroblock levels mismatch\n");
+        goto exit_flag;
+    }
+
+    /* luma blocks 0, 2 and 3 and the Cb block 0 are non-zero, TotalCoeff is 2, 0, 1, 3 and 1 */
+    if (mb->coded_block_flags != (0xDu | (1u << H264_CBF_CB_SHIFT)) || mb->coded_block_flags_dc != 0 || mb->total_coeff[0] != 0x3102 || mb->total_coeff[1] != 0x1 ||
+        mb->total_coeff[2] != 0) {
+        fprintf(stderr, "CAVLC: coded_block_flags 0x%x total_coeff 0x%llx 0x%llx 0x%llx mismatch\n", mb->coded_block_flags, (unsigned long long)mb->total_coeff[0],
+                (unsigned long long)mb->total_coeff[1], (unsigned long long)mb->total_coeff[2]);
+        goto exit_flag;
+    }
+
+    if (!mb_luma4x4_has_coeff(mb, 0) || mb_luma4x4_has_coeff(mb, 1) || !mb_luma4x4_has_coeff(mb, 3) || mb_luma4x4_has_coeff(mb, 4) || mb_total_coeff(mb, 0, 3) != 3) {
+        fprintf(stderr, "CAVLC: non-zero block lookups mismatch\n");
+        goto exit_flag;
+    }
+
+    ret = 0;
+    printf("CAVLC: macroblock nC, non-zero block mask and TotalCoeff verified\n");
+
+exit_flag:
+    if (ff) {
+        free_frame_or_field(ff);
+    }
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t block_count = 100000;
+    int32_t rounds = 20;
+    SyntheticBlock *blocks = 0;
+    BitWriter writer = {0};
+    int64_t symbols = 0;
+
+    if (argc > 1) {
+        block_count = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        rounds = atoi(argv[2]);
+    }
+    if (block_count <= 0 || rounds <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    blocks = (SyntheticBlock *)malloc(sizeof(SyntheticBlock) * block_count);
+    writer.capacity = (size_t)block_count * 64 + 16;
+    writer.buffer = (uint8_t *)malloc(writer.capacity);
+    if (!blocks || !writer.buffer) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    memset(writer.buffer, 0, writer.capacity);
+
+    for (int32_t i = 0; i < block_count; ++i) {
+        generate_block(&blocks[i]);
+        symbols += encode_block(&writer, &blocks[i]);
+    }
+
+    if (check_macroblock_masks() < 0) {
+        goto exit_flag;
+    }
+
+    /* decode and verify */
+    RBSPReader reader;
+    reader.start = writer.buffer;
+    reader.end = writer.buffer + ((writer.bit_pos + 7) >> 3);
+    reader.current = reader.start;
+    reader.bits_left = 8;
+
+    for (int32_t i = 0; i < block_count; ++i) {
+        int32_t coeffLevel[16];
+        int32_t TotalCoeff = 0;
+        int err_code = residual_block_cavlc(&reader, blocks[i].nC, coeffLevel, blocks[i].startIdx, blocks[i].endIdx, blocks[i].maxNumCoeff, &TotalCoeff);
+        if (err_code < 0) {
+            fprintf(stderr, "block %d decoding failed, error code: %d\n", i, err_code);
+            goto exit_flag;
+        }
+
+        if (memcmp(coeffLevel, blocks[i].coeffLevel, sizeof(int32_t) * blocks[i].maxNumCoeff) != 0) {
+            fprintf(stderr, "block %d mismatch\n", i);
+            goto exit_flag;
+        }
+    }
+    printf("CAVLC: %d blocks, %lld symbols, %zu bytes verified\n", block_count, (long long)symbols, (writer.bit_pos + 7) >> 3);
+
+    /* benchmark */
+    clock_t begin = clock();
+    for (int32_t round = 0; round < rounds; ++round) {
+        reader.current = reader.start;
+        reader.bits_left = 8;
+
+        for (int32_t i = 0; i < block_count; ++i) {
+            int32_t coeffLevel[16];
+            int32_t TotalCoeff = 0;
+            residual_block_cavlc(&reader, blocks[i].nC, coeffLevel, blocks[i].startIdx, blocks[i].endIdx, blocks[i].maxNumCoeff, &TotalCoeff);
+        }
+    }
+    double seconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+
+    if (seconds > 0) {
+        printf("CAVLC: %.2f Msymbols/s, %.2f Mblocks/s\n", (double)symbols * rounds / seconds / 1e6, (double)block_count * rounds / seconds / 1e6);
+    }
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (blocks) {
+        free(blocks);
+    }
+    if (writer.buffer) {
+        free(writer.buffer);
+    }
+
+    return exit_code;
+}
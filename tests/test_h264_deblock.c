@@ -0,0 +1,464 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_cpu.h"
+#include "h264decoder/h264_deblock.h"
+#include "h264decoder/h264_deblock_thread.h"
+#include "h264decoder/h264_macroblock.h"
+
+/*
+ * deblocking filter test: filters random edges with the function table selected for each instruction set level supported by the CPU and compares the samples with the
+ * scalar reference kernels, checks the 10-bit kernels against the 8-bit kernels, and compares bS of random motion data. then deblocks a picture of random intra and inter macroblocks with both tables, compares the
+ * planes, then deblocks it on the worker thread while the macroblock rows are copied in one by one and checks the samples are identical, and reports the macroblocks
+ * per second.
+ *
+ * usage: test_h264_deblock [edge count] [rounds]
+ */
+
+#define EDGE_STRIDE 32
+#define PIC_WIDTH_IN_MBS 80
+#define PIC_HEIGHT_IN_MBS 45
+
+/**
+ * @brief fill a 32x32 block with a smooth gradient and small noise, so the thresholds pass for most lines, with a step across the edges at 16
+ */
+static void random_edge_block(uint8_t *block) {
+    int32_t base = rand() % 200 + 20;
+    int32_t step = rand() % 24 - 12;
+    int32_t noise = rand() % 6 + 1;
+
+    for (int32_t y = 0; y < 32; ++y) {
+        for (int32_t x = 0; x < 32; ++x) {
+            int32_t v = base + ((x >= 16) ^ (y >= 16) ? step : 0) + rand() % noise;
+            block[y * EDGE_STRIDE + x] = (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+        }
+    }
+}
+
+static int compare_edge(const char *name, int32_t dir, const uint8_t *ref, const uint8_t *test) {
+    if (memcmp(ref, test, 32 * EDGE_STRIDE)) {
+        fprintf(stderr, "%s %s edge mismatch\n", name, dir ? "horizontal" : "vertical");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief filter the vertical edge at x 16 and the horizontal edge at y 16 of random blocks with every kernel of both tables
+ */
+static int compare_kernels(const DeblockFuncs *ref, const DeblockFuncs *test) {
+    uint8_t src[32 * EDGE_STRIDE], a[32 * EDGE_STRIDE], b[32 * EDGE_STRIDE];
+
+    random_edge_block(src);
+    int32_t alpha = rand() % 64 + 1;
+    int32_t beta = rand() % 18 + 1;
+    int8_t tc0[4];
+    for (int32_t i = 0; i < 4; ++i) {
+        tc0[i] = (int8_t)(rand() % 27 - 1);
+    }
+
+    for (int32_t dir = 0; dir < 2; ++dir) {
+        /* q0 of the first line of the edge */
+        int32_t offset = dir ? 16 * EDGE_STRIDE + 8 : 8 * EDGE_STRIDE + 16;
+
+        memcpy(a, src, sizeof(src));
+        memcpy(b, src, sizeof(src));
+        ref->luma[dir](a + offset, EDGE_STRIDE, alpha, beta, tc0);
+        test->luma[dir](b + offset, EDGE_STRIDE, alpha, beta, tc0);
+        if (compare_edge("luma", dir, a, b) < 0) {
+            return -1;
+        }
+
+        memcpy(a, src, sizeof(src));
+        memcpy(b, src, sizeof(src));
+        ref->luma_intra[dir](a + offset, EDGE_STRIDE, alpha, beta);
+        test->luma_intra[dir](b + offset, EDGE_STRIDE, alpha, beta);
+        if (compare_edge("luma intra", dir, a, b) < 0) {
+            return -1;
+        }
+
+        memcpy(a, src, sizeof(src));
+        memcpy(b, src, sizeof(src));
+        ref->chroma[dir](a + offset, EDGE_STRIDE, alpha, beta, tc0);
+        test->chroma[dir](b + offset, EDGE_STRIDE, alpha, beta, tc0);
+        if (compare_edge("chroma", dir, a, b) < 0) {
+            return -1;
+        }
+
+        memcpy(a, src, sizeof(src));
+        memcpy(b, src, sizeof(src));
+        ref->chroma_intra[dir](a + offset, EDGE_STRIDE, alpha, beta);
+        test->chroma_intra[dir](b + offset, EDGE_STRIDE, alpha, beta);
+        if (compare_edge("chroma intra", dir, a, b) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief the 10-bit kernels filter the 8-bit samples like the 8-bit kernels if tC0 is 0, except the values which the 8-bit kernels clip to 255. the scaling of tC0
+ * by the 10-bit kernels gives the same values for 0
+ */
+static int compare_kernels_10bit(const DeblockFuncs *ref, const DeblockFuncs *test) {
+    uint8_t src[32 * EDGE_STRIDE], a[32 * EDGE_STRIDE];
+    uint16_t b[32 * EDGE_STRIDE];
+
+    random_edge_block(src);
+    int32_t alpha = rand() % 64 + 1;
+    int32_t beta = rand() % 18 + 1;
+    int8_t tc0[4];
+    for (int32_t i = 0; i < 4; ++i) {
+        tc0[i] = (int8_t)(rand() % 2 - 1);
+    }
+
+    for (int32_t dir = 0; dir < 2; ++dir) {
+        int32_t offset = dir ? 16 * EDGE_STRIDE + 8 : 8 * EDGE_STRIDE + 16;
+
+        for (int32_t kernel = 0; kernel < 4; ++kernel) {
+            memcpy(a, src, sizeof(src));
+            for (int32_t i = 0; i < 32 * EDGE_STRIDE; ++i) {
+                b[i] = src[i];
+            }
+
+            if (kernel == 0) {
+                ref->luma[dir](a + offset, EDGE_STRIDE, alpha, beta, tc0);
+                test->luma[dir]((uint8_t *)(b + offset), EDGE_STRIDE, alpha, beta, tc0);
+            } else if (kernel == 1) {
+                ref->luma_intra[dir](a + offset, EDGE_STRIDE, alpha, beta);
+                test->luma_intra[dir]((uint8_t *)(b + offset), EDGE_STRIDE, alpha, beta);
+            } else if (kernel == 2) {
+                ref->chroma[dir](a + offset, EDGE_STRIDE, alpha, beta, tc0);
+                test->chroma[dir]((uint8_t *)(b + offset), EDGE_STRIDE, alpha, beta, tc0);
+            } else {
+                ref->chroma_intra[dir](a + offset, EDGE_STRIDE, alpha, beta);
+                test->chroma_intra[dir]((uint8_t *)(b + offset), EDGE_STRIDE, alpha, beta);
+            }
+
+            for (int32_t i = 0; i < 32 * EDGE_STRIDE; ++i) {
+                if ((b[i] > 255 ? 255 : b[i]) != a[i]) {
+                    fprintf(stderr, "10-bit kernel %d %s edge mismatch at (%d, %d): %d != %d\n", kernel, dir ? "horizontal" : "vertical", i % EDGE_STRIDE, i / EDGE_STRIDE,
+                            b[i], a[i]);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief compare bS of random motion data, the values are drawn from small ranges so that the equal and the crossed reference pictures occur
+ */
+static int compare_boundary_strength(const DeblockFuncs *ref, const DeblockFuncs *test) {
+    DeblockCache cache;
+    uint8_t a[2][4][4], b[2][4][4];
+
+    memset(&cache, 0, sizeof(cache));
+    for (int32_t i = 0; i < H264_MV_CACHE_SIZE; ++i) {
+        cache.nnz[i] = (rand() % 5) == 0;
+        for (int32_t list = 0; list < 2; ++list) {
+            cache.ref[list][i] = (int8_t)(rand() % 3 - 1);
+            cache.mv[list][i][0] = (int16_t)(cache.ref[list][i] < 0 ? 0 : rand() % 9 - 4);
+            cache.mv[list][i][1] = (int16_t)(cache.ref[list][i] < 0 ? 0 : rand() % 9 - 4);
+        }
+    }
+
+    for (int32_t mvy_limit = 2; mvy_limit <= 4; mvy_limit += 2) {
+        ref->boundary_strength(&cache, mvy_limit, a);
+        test->boundary_strength(&cache, mvy_limit, b);
+        if (memcmp(a, b, sizeof(a))) {
+            fprintf(stderr, "bS mismatch, mvy_limit %d\n", mvy_limit);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+typedef struct {
+    FrameOrField *ff;
+    uint8_t *samples;
+    uint8_t *work;
+    DeblockPlanes planes;
+    size_t size;
+} TestPicture;
+
+/**
+ * @brief build a 4:2:0 frame of one slice with random macroblock types, coefficients, motion data and QPs
+ */
+static int create_test_picture(TestPicture *pic, int32_t disable_deblocking_filter_idc) {
+    int32_t PicSizeInMbs = PIC_WIDTH_IN_MBS * PIC_HEIGHT_IN_MBS;
+    int32_t width = PIC_WIDTH_IN_MBS * 16;
+    int32_t height = PIC_HEIGHT_IN_MBS * 16;
+
+    memset(pic, 0, sizeof(*pic));
+    pic->ff = create_frame_or_field();
+    if (!pic->ff || alloc_frame_or_field(pic->ff, PicSizeInMbs) < 0) {
+        return -1;
+    }
+
+    FrameOrField *ff = pic->ff;
+    ff->slice_ref_lists = (RefPicLists *)calloc(1, sizeof(RefPicLists));
+    ff->slice_deblock_params = (SliceDeblockParams *)calloc(1, sizeof(SliceDeblockParams));
+    if (!ff->slice_ref_lists || !ff->slice_deblock_params) {
+        return -1;
+    }
+    ff->slice_ref_lists_capacity = 1;
+    ff->slice_count = 1;
+    ff->slice_deblock_params[0].disable_deblocking_filter_idc = (uint8_t)disable_deblocking_filter_idc;
+    ff->slice_deblock_params[0].FilterOffsetA = 2;
+    ff->slice_deblock_params[0].chroma_qp_index_offset[1] = 2;
+
+    for (int32_t mbAddr = 0; mbAddr < PicSizeInMbs; ++mbAddr) {
+        MacroBlock *mb = &ff->mb_list[mbAddr];
+        int32_t intra = (rand() % 4) == 0;
+
+        ff->mb_slice_ids[mbAddr] = 0;
+        ff->mb_qps[mbAddr] = (int8_t)(rand() % 30 + 18);
+        ff->mb_type_names[mbAddr] = intra ? I_NxN : P_L0_16x16;
+        mb->mb_pred_type = intra ? Intra_4x4 : Pred_L0;
+        mb->transform_size_8x8_flag = (uint8_t)((rand() % 3) == 0);
+        mb->coded_block_flags = (uint32_t)rand() & (uint32_t)rand() & H264_CBF_LUMA_MASK;
+
+        for (int32_t blk = 0; blk < 16; ++blk) {
+            int32_t idx = mbAddr * 16 + blk;
+            ff->ref_idxs[0][idx] = (int8_t)(intra ? -1 : rand() % 2);
+            ff->ref_idxs[1][idx] = -1;
+            ff->mvs[0][idx * 2] = (int16_t)(intra ? 0 : rand() % 13 - 6);
+            ff->mvs[0][idx * 2 + 1] = (int16_t)(intra ? 0 : rand() % 13 - 6);
+            ff->mvs[1][idx * 2] = ff->mvs[1][idx * 2 + 1] = 0;
+        }
+    }
+
+    int32_t stride = width + 64;
+    size_t luma_size = (size_t)stride * (height + 8);
+    size_t chroma_size = (size_t)(stride / 2) * (height / 2 + 8);
+    pic->size = luma_size + 2 * chroma_size;
+    pic->samples = (uint8_t *)malloc(pic->size);
+    pic->work = (uint8_t *)malloc(pic->size);
+    if (!pic->samples || !pic->work) {
+        return -1;
+    }
+
+    /* blocky content, flat 4x4 blocks with random steps */
+    for (size_t i = 0; i < pic->size; ++i) {
+        pic->samples[i] = (uint8_t)(128 + (int32_t)((i / 4) % 7) * 3 + rand() % 3);
+    }
+
+    pic->planes.PicWidthInMbs = PIC_WIDTH_IN_MBS;
+    pic->planes.ChromaArrayType = 1;
+    pic->planes.BitDepthY = 8;
+    pic->planes.BitDepthC = 8;
+    pic->planes.strides[0] = stride;
+    pic->planes.strides[1] = pic->planes.strides[2] = stride / 2;
+    return 0;
+}
+
+static void set_test_planes(TestPicture *pic, uint8_t *buffer) {
+    size_t luma_size = (size_t)pic->planes.strides[0] * (PIC_HEIGHT_IN_MBS * 16 + 8);
+    size_t chroma_size = (size_t)pic->planes.strides[1] * (PIC_HEIGHT_IN_MBS * 8 + 8);
+    pic->planes.planes[0] = buffer + 4 * pic->planes.strides[0] + 32;
+    pic->planes.planes[1] = buffer + luma_size + 4 * pic->planes.strides[1] + 16;
+    pic->planes.planes[2] = buffer + luma_size + chroma_size + 4 * pic->planes.strides[1] + 16;
+}
+
+/**
+ * @brief copy the unfiltered samples of a macroblock row to the planes like the reconstruction of the row, or clear them
+ */
+static void reconstruct_test_row(TestPicture *pic, int32_t mb_row, int32_t clear) {
+    for (int32_t c = 0; c < 3; ++c) {
+        int32_t height = c ? 8 : 16;
+        int32_t stride = pic->planes.strides[c];
+        ptrdiff_t offset = pic->planes.planes[c] - pic->work + (ptrdiff_t)mb_row * height * stride;
+        if (clear) {
+            memset(pic->work + offset, 0, (size_t)height * stride);
+        } else {
+            memcpy(pic->work + offset, pic->samples + offset, (size_t)height * stride);
+        }
+    }
+}
+
+/**
+ * @brief deblock the picture on the worker thread, the rows are reported as soon as they are copied
+ */
+static int deblock_test_picture_threaded(TestPicture *pic, DeblockThread *thread) {
+    memcpy(pic->work, pic->samples, pic->size);
+    set_test_planes(pic, pic->work);
+    for (int32_t mb_row = 0; mb_row < PIC_HEIGHT_IN_MBS; ++mb_row) {
+        reconstruct_test_row(pic, mb_row, 1);
+    }
+    if (start_deblock_picture(thread, pic->ff, &pic->planes) < 0) {
+        return -1;
+    }
+
+    for (int32_t mb_row = 0; mb_row < PIC_HEIGHT_IN_MBS; ++mb_row) {
+        reconstruct_test_row(pic, mb_row, 0);
+        report_reconstructed_rows(thread, mb_row + 1);
+    }
+
+    return finish_deblock_picture(thread);
+}
+
+static void free_test_picture(TestPicture *pic) {
+    if (pic->ff) {
+        free_frame_or_field(pic->ff);
+    }
+    free(pic->samples);
+    free(pic->work);
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t edge_count = 20000;
+    int32_t rounds = 20;
+    uint8_t *expected = 0;
+    TestPicture pic;
+    const int32_t levels[1] = {H264_CPU_SSE2};
+    const char *level_names[1] = {"SSE2"};
+    int32_t cpu_flags = get_cpu_flags();
+
+    memset(&pic, 0, sizeof(pic));
+
+    if (argc > 1) {
+        edge_count = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        rounds = atoi(argv[2]);
+    }
+    if (edge_count <= 0 || rounds <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    srand(1234);
+
+    /* verify */
+    DeblockFuncs ref;
+    init_deblock_funcs(&ref, 8, 8, 0);
+
+    if (create_test_picture(&pic, 0) < 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    expected = (uint8_t *)malloc(pic.size);
+    if (!expected) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    memcpy(expected, pic.samples, pic.size);
+    set_test_planes(&pic, expected);
+    if (deblock_picture(&ref, pic.ff, &pic.planes) < 0) {
+        fprintf(stderr, "scalar: deblocking failed\n");
+        goto exit_flag;
+    }
+
+    for (int32_t level = 0; level < 1; ++level) {
+        if ((cpu_flags & levels[level]) != levels[level]) {
+            printf("deblock: %s not supported, skipped\n", level_names[level]);
+            continue;
+        }
+
+        DeblockFuncs test;
+        init_deblock_funcs(&test, 8, 8, levels[level]);
+        for (int32_t i = 0; i < edge_count; ++i) {
+            if (compare_kernels(&ref, &test) < 0 || compare_boundary_strength(&ref, &test) < 0) {
+                fprintf(stderr, "%s: edge %d mismatch\n", level_names[level], i);
+                goto exit_flag;
+            }
+        }
+
+        memcpy(pic.work, pic.samples, pic.size);
+        set_test_planes(&pic, pic.work);
+        if (deblock_picture(&test, pic.ff, &pic.planes) < 0 || memcmp(pic.work, expected, pic.size)) {
+            fprintf(stderr, "%s: picture mismatch\n", level_names[level]);
+            goto exit_flag;
+        }
+        printf("deblock: %s, %d edges and %d macroblocks verified\n", level_names[level], edge_count, PIC_WIDTH_IN_MBS * PIC_HEIGHT_IN_MBS);
+    }
+
+    DeblockFuncs funcs10;
+    init_deblock_funcs(&funcs10, 10, 10, cpu_flags);
+    for (int32_t i = 0; i < edge_count; ++i) {
+        if (compare_kernels_10bit(&ref, &funcs10) < 0) {
+            fprintf(stderr, "10-bit: edge %d mismatch\n", i);
+            goto exit_flag;
+        }
+    }
+    printf("deblock: 10-bit, %d edges verified\n", edge_count);
+
+    /* the Cb and Cr edges of ChromaArrayType equal to 3 are filtered by the luma kernels of the chroma bit depth */
+    DeblockFuncs funcs444;
+    init_deblock_funcs(&funcs444, 8, 10, cpu_flags);
+    for (int32_t dir = 0; dir < 2; ++dir) {
+        if (funcs444.luma[dir] != ref.luma[dir] || funcs444.luma_intra[dir] != ref.luma_intra[dir] || funcs444.chroma444[dir] != funcs10.luma[dir] ||
+            funcs444.chroma444_intra[dir] != funcs10.luma_intra[dir]) {
+            fprintf(stderr, "4:4:4: the kernels of the bit depths 8 and 10 are mixed up\n");
+            goto exit_flag;
+        }
+    }
+
+    /* the worker thread trailing the reconstruction gives the same samples */
+    DeblockThread *thread = create_deblock_thread(&ref);
+    if (!thread) {
+        fprintf(stderr, "deblocking thread creation failed\n");
+        goto exit_flag;
+    }
+    for (int32_t round = 0; round < 4; ++round) {
+        if (deblock_test_picture_threaded(&pic, thread) < 0 || get_deblocked_rows(thread) != PIC_HEIGHT_IN_MBS) {
+            fprintf(stderr, "threaded: deblocking failed\n");
+            free_deblock_thread(thread);
+            goto exit_flag;
+        }
+        if (memcmp(pic.work, expected, pic.size)) {
+            fprintf(stderr, "threaded: picture mismatch\n");
+            free_deblock_thread(thread);
+            goto exit_flag;
+        }
+    }
+    free_deblock_thread(thread);
+    printf("deblock: worker thread verified\n");
+
+    /* disable_deblocking_filter_idc equal to 1 leaves the picture unchanged */
+    pic.ff->slice_deblock_params[0].disable_deblocking_filter_idc = 1;
+    memcpy(pic.work, pic.samples, pic.size);
+    set_test_planes(&pic, pic.work);
+    if (deblock_picture(&ref, pic.ff, &pic.planes) < 0 || memcmp(pic.work, pic.samples, pic.size)) {
+        fprintf(stderr, "disable_deblocking_filter_idc 1: picture modified\n");
+        goto exit_flag;
+    }
+    pic.ff->slice_deblock_params[0].disable_deblocking_filter_idc = 0;
+
+    /* benchmark */
+    DeblockFuncs funcs;
+    init_deblock_funcs(&funcs, 8, 8, cpu_flags);
+
+    const DeblockFuncs *tables[2] = {&ref, &funcs};
+    double mbs_per_second[2] = {0, 0};
+    for (int32_t t = 0; t < 2; ++t) {
+        clock_t begin = clock();
+        for (int32_t round = 0; round < rounds; ++round) {
+            memcpy(pic.work, pic.samples, pic.size);
+            deblock_picture(tables[t], pic.ff, &pic.planes);
+        }
+        double seconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+        mbs_per_second[t] = seconds > 0 ? (double)PIC_WIDTH_IN_MBS * PIC_HEIGHT_IN_MBS * rounds / seconds / 1e6 : 0;
+    }
+    printf("deblock: scalar %.2f MMB/s, selected %.2f MMB/s\n", mbs_per_second[0], mbs_per_second[1]);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    free_test_picture(&pic);
+    if (expected) {
+        free(expected);
+    }
+
+    return exit_code;
+}
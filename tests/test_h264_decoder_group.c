@@ -0,0 +1,507 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_context.h"
+#include "h264decoder/h264_decoder_group.h"
+#include "h264decoder/h264_frame.h"
+#include "h264decoder/h264_stream.h"
+
+#include "h264_test_stream.h"
+
+/*
+ * decoder group test: encodes a synthetic CAVLC byte stream of 320x192 frames in memory for each of several cameras, an IDR picture of I_PCM macroblocks, a P
+ * picture of skipped macroblocks whose odd slices start with an Intra_16x16 macroblock, then P pictures, each camera with its own samples and motion. every
+ * stream is decoded alone by a context of its own first, then all the streams are decoded at once by a group of 4 workers, submitting one access unit per packet.
+ * the IDR picture must carry the PCM samples and the skipped picture must repeat them around the DC predicted macroblocks, and every output frame of the group is
+ * checked against the frame decoded alone: its picture order count, its macroblock types, QPY, reference indices and motion vectors, and its reconstructed
+ * samples. the streams are decoded twice by the group, so the second round takes the pictures which the first one left in the shared picture pool. a third round
+ * caps the memory of every stream at the smallest peak of the streams in the unlimited rounds and the group at the sum of the caps: a stream more than the group
+ * fits is refused when it is added, and the capped streams still output every frame without exceeding their limits. then reports the frames decoded per second of
+ * wall clock time.
+ *
+ * usage: test_h264_decoder_group [streams] [frames]
+ */
+
+#define WIDTH_IN_MBS 20
+#define HEIGHT_IN_MBS 12
+#define SLICES_PER_PICTURE 4
+#define GROUP_THREADS 4
+
+/* the frames of the group are checked against the frames decoded alone by their macroblocks and their samples */
+#define HASH_PARTS (TEST_HASH_MB_TYPES | TEST_HASH_QPS | TEST_HASH_MOTION | TEST_HASH_SAMPLES)
+
+#define MBS_PER_SLICE (WIDTH_IN_MBS * HEIGHT_IN_MBS / SLICES_PER_PICTURE)
+
+/* the camera whose stream is decoded alone */
+static int32_t g_camera;
+
+/* the PCM sample i of the macroblock mb of the IDR picture of the camera */
+static uint8_t pcm_sample(int32_t camera, int32_t mb, int32_t i) { return (uint8_t)(64 + (mb * (camera + 1) + i * (camera % 3 + 1)) % 128); }
+
+/**
+ * @brief write picture n of the stream of the camera: the IDR picture, then the P pictures referring to the previous picture. the first macroblocks of the odd
+ * slices of the second picture are the only ones coded, they are not deblocked
+ */
+static int write_picture(Stream *stream, BitWriter *w, int32_t n, int32_t camera) {
+    int is_idr = n == 0;
+
+    for (int32_t slice = 0; slice < SLICES_PER_PICTURE; ++slice) {
+        int32_t first_mb = slice * MBS_PER_SLICE;
+
+        /* @see 7.3.3 Slice header syntax */
+        w->bits = 0;
+        put_ue(w, (uint32_t)first_mb);
+        put_ue(w, is_idr ? 7 : 5);
+        put_ue(w, 0);
+        put_u(w, (uint32_t)n % 16, 4);
+        if (is_idr) {
+            put_ue(w, 0);
+        }
+        put_u(w, (uint32_t)(2 * n) % 64, 6);
+        if (!is_idr) {
+            put_u(w, 0, 1); /* num_ref_idx_active_override_flag */
+            put_u(w, 0, 1); /* ref_pic_list_modification_flag_l0 */
+        }
+        if (is_idr) {
+            put_u(w, 0, 1);
+            put_u(w, 0, 1);
+        } else {
+            put_u(w, 0, 1); /* adaptive_ref_pic_marking_mode_flag */
+        }
+        put_se(w, slice % 3 - 1);
+        /* disable_deblocking_filter_idc, the deblocking filter runs across the boundaries of the even slices */
+        put_ue(w, (uint32_t)slice % 2);
+        if (slice % 2 == 0) {
+            put_se(w, camera % 3 - 1); /* slice_alpha_c0_offset_div2 */
+            put_se(w, 0);
+        }
+
+        /* @see 7.3.4 Slice data syntax */
+        uint32_t skip_run = 0;
+        for (int32_t mb = first_mb; mb < first_mb + MBS_PER_SLICE; ++mb) {
+            if (is_idr) {
+                put_ue(w, 25); /* I_PCM */
+                while (w->bits % 8) {
+                    put_bit(w, 0);
+                }
+                for (int32_t i = 0; i < 384; ++i) {
+                    put_u(w, pcm_sample(camera, mb, i), 8);
+                }
+                continue;
+            }
+
+            if (n == 1 ? mb > first_mb || slice % 2 == 0 : (mb * 5 + n + camera) % 7 == 0) {
+                skip_run++;
+                continue;
+            }
+            put_ue(w, skip_run);
+            skip_run = 0;
+
+            if (n == 1 || (mb * 3 + n + camera) % 11 == 0) {
+                /* I_16x16_2_0_0 in a P slice: Intra_16x16 DC prediction without coded AC coefficients */
+                put_ue(w, 5 + 3);
+                put_ue(w, 0); /* intra_chroma_pred_mode */
+                put_se(w, (mb + n) % 5 - 2);
+                /* coeff_token of Intra16x16DCLevel with TotalCoeff 0, the neighbouring blocks have no coefficients so nC is 0 */
+                put_u(w, 1, 1);
+                continue;
+            }
+
+            put_ue(w, 0); /* P_L0_16x16 */
+            put_se(w, (mb * 7 + n + camera) % 33 - 16);
+            put_se(w, (mb * 13 + n * camera) % 17 - 8);
+            put_ue(w, 0); /* coded_block_pattern 0 */
+        }
+        if (skip_run) {
+            put_ue(w, skip_run);
+        }
+
+        if (put_trailing_bits(w) < 0 || add_nalu(stream, is_idr ? 0x65 : 0x41, w) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* the byte stream of a camera and its access units */
+typedef struct {
+    Stream stream;
+    /* the offset of every access unit in the byte stream, and the end of the stream */
+    size_t *au_offsets;
+    /* the checksums of the frames decoded alone, in the output order */
+    uint64_t *expected;
+
+    GroupStream *member;
+    /* the peak bytes of the context of the stream in the last round */
+    size_t memory_peak;
+    int32_t submitted;
+    int32_t received;
+    int32_t ended;
+} Camera;
+
+/**
+ * @brief write the byte stream of the camera, one access unit per picture, the parameter sets are in the access unit of the IDR picture
+ *
+ * @return int 0 on success, negative value on error
+ */
+static int write_camera(Camera *camera, BitWriter *writer, int32_t index, int32_t frames) {
+    camera->au_offsets = (size_t *)malloc((frames + 1) * sizeof(size_t));
+    camera->expected = (uint64_t *)malloc(frames * sizeof(uint64_t));
+    if (!camera->au_offsets || !camera->expected) {
+        return -1;
+    }
+
+    camera->stream.has_start_codes = 1;
+    for (int32_t n = 0; n < frames; ++n) {
+        camera->au_offsets[n] = camera->stream.size;
+        if (n == 0 && write_parameter_sets(&camera->stream, writer, WIDTH_IN_MBS, HEIGHT_IN_MBS) < 0) {
+            return -1;
+        }
+        if (write_picture(&camera->stream, writer, n, index) < 0) {
+            return -1;
+        }
+    }
+    camera->au_offsets[frames] = camera->stream.size;
+    return 0;
+}
+
+/**
+ * @brief the first two output frames of the camera carry the PCM samples of the IDR picture, except the first macroblocks of the odd slices of the second one.
+ * their neighbours lie in the previous slices, so the Intra_16x16 and chroma DC predictions are 128. the deblocking filter leaves the I_PCM macroblocks, whose QPY
+ * is 0, and the skipped macroblocks with the same motion
+ * @see 8.3.3.3 Specification of Intra_16x16_DC prediction mode
+ *
+ * @return int 0 on success, negative value on error
+ */
+static int check_camera_frame(int32_t camera, const DecodedFrame *frame, int32_t index) {
+    if (index >= 2) {
+        return 0;
+    }
+    if (frame->plane_count != 3) {
+        fprintf(stderr, "decoder group: %d planes output\n", frame->plane_count);
+        return -1;
+    }
+    for (int32_t mb = 0; mb < WIDTH_IN_MBS * HEIGHT_IN_MBS; ++mb) {
+        int32_t mb_x = mb % WIDTH_IN_MBS;
+        int32_t mb_y = mb / WIDTH_IN_MBS;
+        for (int32_t i = 0; i < 384; ++i) {
+            int32_t iCx = i < 256 ? 0 : 1 + (i - 256) / 64;
+            int32_t size = iCx ? 8 : 16;
+            int32_t k = iCx ? (i - 256) % 64 : i;
+            const SamplePlane *plane = &frame->planes[iCx];
+            int32_t expected = index == 1 && mb % MBS_PER_SLICE == 0 && mb / MBS_PER_SLICE % 2 ? 128 : pcm_sample(camera, mb, i);
+            if (plane->data[(size_t)(mb_y * size + k / size) * plane->stride + mb_x * size + k % size] != expected) {
+                fprintf(stderr, "decoder group: frame %d sample %d of macroblock %d of camera %d is not %d\n", index, i, mb, camera, expected);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief check_camera_frame() of the camera decoded alone
+ */
+static int check_alone_frame(const DecodedFrame *frame, int32_t index) { return check_camera_frame(g_camera, frame, index); }
+
+/**
+ * @brief decode the byte stream of the camera alone, the checksums of the frames are the reference of the group
+ *
+ * @return int 0 on success, negative value on error
+ */
+static int decode_camera_alone(Camera *camera, int32_t index, int32_t frames) {
+    int ret = -1;
+
+    H264Context *ctx = create_context();
+    if (!ctx) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    g_camera = index;
+    int32_t output_count = decode_test_stream(ctx, &camera->stream, "decoder group", HASH_PARTS, camera->expected, frames, check_alone_frame);
+    if (output_count != frames) {
+        fprintf(stderr, "decoder group: %d of %d frames output alone\n", output_count, frames);
+        goto exit_flag;
+    }
+    ret = 0;
+
+exit_flag:
+    free_context(ctx);
+    return ret;
+}
+
+/**
+ * @brief check the frame of the camera, and against the frame decoded alone
+ *
+ * @return int 0 on success, negative value on error
+ */
+static int check_group_frame(Camera *camera, int32_t index, DecodedFrame *frame, int32_t frames) {
+    int ret = 0;
+    if (check_camera_frame(index, frame, camera->received) < 0) {
+        ret = -1;
+    } else if (camera->received >= frames || hash_frame(frame, HASH_PARTS) != camera->expected[camera->received]) {
+        fprintf(stderr, "decoder group: frame %d of camera %d differs from the frame decoded alone\n", camera->received, index);
+        ret = -1;
+    }
+    camera->received++;
+    release_frame(frame);
+    return ret;
+}
+
+/**
+ * @brief decode the byte streams of all the cameras at once by the group, the application thread feeds the streams in turns and takes their frames
+ *
+ * @return int 0 on success, negative value on error
+ */
+static int decode_cameras_by_group(DecoderGroup *group, Camera *cameras, int32_t camera_count, int32_t frames) {
+    int ret = -1;
+    DecodedFrame frame;
+
+    for (int32_t i = 0; i < camera_count; ++i) {
+        cameras[i].submitted = cameras[i].received = cameras[i].ended = 0;
+        cameras[i].member = add_group_stream(group);
+        if (!cameras[i].member) {
+            fprintf(stderr, "decoder group: stream %d not added\n", i);
+            goto exit_flag;
+        }
+    }
+
+    int32_t finished = 0;
+    while (finished < camera_count) {
+        int32_t progress = 0;
+        finished = 0;
+
+        for (int32_t i = 0; i < camera_count; ++i) {
+            Camera *camera = &cameras[i];
+
+            /* one access unit per packet, until the input queue of the stream is full */
+            while (camera->submitted < frames) {
+                size_t offset = camera->au_offsets[camera->submitted];
+                int err_code = submit_group_packet(camera->member, camera->stream.data + offset, camera->au_offsets[camera->submitted + 1] - offset,
+                                                   camera->submitted, camera->submitted);
+                if (err_code == ERR_STREAM_QUEUE_FULL) {
+                    break;
+                }
+                if (err_code < 0) {
+                    fprintf(stderr, "decoder group: packet %d of camera %d not submitted, error code: %d\n", camera->submitted, i, err_code);
+                    goto exit_flag;
+                }
+                camera->submitted++;
+                progress = 1;
+            }
+            if (camera->submitted == frames && !camera->ended) {
+                end_group_stream(camera->member);
+                camera->ended = 1;
+            }
+
+            int err_code = ERR_OK;
+            while ((err_code = receive_group_frame(camera->member, &frame, 0)) == ERR_OK) {
+                if (check_group_frame(camera, i, &frame, frames) < 0) {
+                    goto exit_flag;
+                }
+                progress = 1;
+            }
+            if (err_code == ERR_EOS) {
+                finished++;
+            }
+        }
+
+        /* nothing to submit or receive, wait for a frame of the first stream whose packets are decoded */
+        for (int32_t i = 0; !progress && i < camera_count; ++i) {
+            int err_code = receive_group_frame(cameras[i].member, &frame, 1);
+            if (err_code == ERR_OK) {
+                if (check_group_frame(&cameras[i], i, &frame, frames) < 0) {
+                    goto exit_flag;
+                }
+                progress = 1;
+            }
+        }
+    }
+
+    for (int32_t i = 0; i < camera_count; ++i) {
+        if (cameras[i].received != frames || get_group_stream_error(cameras[i].member) < 0) {
+            fprintf(stderr, "decoder group: camera %d output %d of %d frames, error code: %d\n", i, cameras[i].received, frames,
+                    get_group_stream_error(cameras[i].member));
+            goto exit_flag;
+        }
+
+        MemoryUsage usage;
+        get_memory_usage(cameras[i].member->context, &usage);
+        cameras[i].memory_peak = usage.peak_total;
+        if (usage.limit && usage.peak_total > usage.limit) {
+            fprintf(stderr, "decoder group: camera %d took %zu bytes over its limit of %zu\n", i, usage.peak_total, usage.limit);
+            goto exit_flag;
+        }
+    }
+    ret = 0;
+
+exit_flag:
+    for (int32_t i = 0; i < camera_count; ++i) {
+        if (cameras[i].member) {
+            remove_group_stream(cameras[i].member);
+            cameras[i].member = 0;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief add one stream more than the memory limit of the group fits, the stream is refused and the streams added before are kept
+ *
+ * @return int 0 on success, negative value on error
+ */
+static int check_stream_admission(DecoderGroup *group, int32_t stream_count) {
+    int ret = -1;
+    GroupStream **streams = (GroupStream **)calloc(stream_count + 1, sizeof(GroupStream *));
+    if (!streams) {
+        return -1;
+    }
+
+    for (int32_t i = 0; i < stream_count; ++i) {
+        streams[i] = add_group_stream(group);
+        if (!streams[i]) {
+            fprintf(stderr, "decoder group: stream %d of %d refused by the memory limit of the group\n", i, stream_count);
+            goto exit_flag;
+        }
+    }
+    streams[stream_count] = add_group_stream(group);
+    if (streams[stream_count]) {
+        fprintf(stderr, "decoder group: stream %d added over the memory limit of the group\n", stream_count);
+        goto exit_flag;
+    }
+    ret = 0;
+
+exit_flag:
+    for (int32_t i = 0; i <= stream_count; ++i) {
+        if (streams[i]) {
+            remove_group_stream(streams[i]);
+        }
+    }
+    free(streams);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t camera_count = 12;
+    int32_t frames = 30;
+    BitWriter writer;
+    Camera *cameras = 0;
+    DecoderGroup *group = 0;
+
+    memset(&writer, 0, sizeof(BitWriter));
+
+    if (argc > 1) {
+        camera_count = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        frames = atoi(argv[2]);
+    }
+    if (camera_count <= 0 || frames <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    cameras = (Camera *)malloc(camera_count * sizeof(Camera));
+    if (!cameras) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    memset(cameras, 0, camera_count * sizeof(Camera));
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int32_t i = 0; i < camera_count; ++i) {
+        if (write_camera(&cameras[i], &writer, i, frames) < 0) {
+            fprintf(stderr, "Memory allocation failed\n");
+            goto exit_flag;
+        }
+        if (decode_camera_alone(&cameras[i], i, frames) < 0) {
+            goto exit_flag;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("decoder group: %d streams one by one, %.1f frames/s (%d frames of %dx%d each)\n", camera_count, seconds > 0 ? camera_count * frames / seconds : 0.0,
+           frames, WIDTH_IN_MBS * 16, HEIGHT_IN_MBS * 16);
+
+    group = create_decoder_group(GROUP_THREADS);
+    if (!group) {
+        fprintf(stderr, "decoder group: the workers not created\n");
+        goto exit_flag;
+    }
+
+    /* the second round takes the pictures freed by the streams of the first round from the shared picture pool */
+    for (int32_t round = 0; round < 2; ++round) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (decode_cameras_by_group(group, cameras, camera_count, frames) < 0) {
+            goto exit_flag;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("decoder group: %d streams on %d workers, round %d, %.1f frames/s, %d pictures in the shared pool\n", camera_count, GROUP_THREADS, round,
+               seconds > 0 ? camera_count * frames / seconds : 0.0, group->pictures.count);
+
+        if (group->pictures.count == 0) {
+            fprintf(stderr, "decoder group: the removed streams left no picture in the shared pool\n");
+            goto exit_flag;
+        }
+    }
+
+    /* the streams are decoded again with the smallest peak of the unlimited round as their limit, the group fits the limits of all the streams and no more */
+    size_t stream_limit = SIZE_MAX;
+    for (int32_t i = 0; i < camera_count; ++i) {
+        stream_limit = cameras[i].memory_peak < stream_limit ? cameras[i].memory_peak : stream_limit;
+    }
+    if (set_group_memory_limit(group, camera_count * stream_limit) < 0) {
+        fprintf(stderr, "decoder group: the memory limit of the group not set\n");
+        goto exit_flag;
+    }
+    set_group_stream_memory_limit(group, stream_limit);
+    if (check_stream_admission(group, camera_count) < 0) {
+        goto exit_flag;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (decode_cameras_by_group(group, cameras, camera_count, frames) < 0) {
+        goto exit_flag;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    MemoryUsage usage;
+    get_group_memory_usage(group, &usage);
+    if (usage.total > usage.limit) {
+        fprintf(stderr, "decoder group: the group keeps %zu bytes over its limit of %zu\n", usage.total, usage.limit);
+        goto exit_flag;
+    }
+    printf("decoder group: %d streams limited to %zu bytes each, %.1f frames/s, %u allocations refused\n", camera_count, stream_limit,
+           seconds > 0 ? camera_count * frames / seconds : 0.0, usage.refused);
+    printf("decoder group: %d streams verified\n", camera_count);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (group) {
+        free_decoder_group(group);
+    }
+    if (cameras) {
+        for (int32_t i = 0; i < camera_count; ++i) {
+            free_stream(&cameras[i].stream);
+            if (cameras[i].au_offsets) {
+                free(cameras[i].au_offsets);
+            }
+            if (cameras[i].expected) {
+                free(cameras[i].expected);
+            }
+        }
+        free(cameras);
+    }
+    if (writer.buffer) {
+        free(writer.buffer);
+    }
+    return exit_code;
+}
@@ -0,0 +1,344 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_context.h"
+#include "h264decoder/h264_dpb.h"
+
+/*
+ * decoded picture buffer test: starts the pictures of synthetic slice headers on a context and checks the reference marking of the DPB after every picture for
+ * the sliding window, the memory management control operations, the complementary field pairs, the gaps in frame_num and the IDR pictures. checks the pictures
+ * return to the pool as soon as they are unused and the pool allocates only the pictures the stream needs, then reports the pictures marked per second.
+ *
+ * usage: test_h264_dpb [pictures]
+ */
+
+#define MAX_FRAME_NUM 16
+
+/* an expected frame store of the DPB, the marking of the top and the bottom field */
+typedef struct {
+    int32_t FrameNum;
+    uint8_t top;
+    uint8_t bottom;
+} ExpectedRef;
+
+#define S REF_PIC_SHORT_TERM
+#define L REF_PIC_LONG_TERM
+#define U REF_PIC_UNUSED
+
+static void set_test_sps(SPS *sps, uint32_t max_num_ref_frames) {
+    memset(sps, 0, sizeof(SPS));
+    sps->PicWidthInMbs = 2;
+    sps->FrameHeightInMbs = 2;
+    sps->frame_mbs_only_flag = 0;
+    sps->MaxDpbFrames = H264_MAX_DPB_FRAMES;
+    sps->max_num_ref_frames = max_num_ref_frames;
+    sps->MaxFrameNum = MAX_FRAME_NUM;
+    sps->chroma_format_idc = 1;
+    sps->ChromaArrayType = 1;
+    sps->SubWidthC = 2;
+    sps->SubHeightC = 2;
+    sps->MbWidthC = 8;
+    sps->MbHeightC = 8;
+    sps->BitDepthY = 8;
+    sps->BitDepthC = 8;
+}
+
+/**
+ * @brief start a picture on the context as the first slice of it would, the previous picture is marked and stored. structure is 3 for a frame, 1 for a top
+ * field and 2 for a bottom field
+ */
+static int start_picture(H264Context *ctx, uint32_t frame_num, uint8_t nal_ref_idc, uint8_t idr, int32_t structure, const DecRefPicMark *marking) {
+    SliceHeader *header = 0;
+    Picture *pic = 0;
+
+    get_slice_header(ctx, &header);
+    header->nalu_header.nal_ref_idc = nal_ref_idc;
+    header->nalu_header.IdrPicFlag = idr;
+    header->frame_num = frame_num;
+    header->field_pic_flag = structure != 3;
+    header->bottom_field_flag = structure == 2;
+    header->sps = ctx->active_sps;
+    if (marking) {
+        header->dec_ref_pic_mark = *marking;
+    }
+
+    int err_code = get_picture_from_context(ctx, 1, &pic);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* the state set_picture_structure() sets */
+    pic->decoded_fields |= (uint8_t)structure;
+
+    /* the output pictures are returned at once, max_num_reorder_frames is 0 */
+    for (Picture *out = get_output_picture(ctx); out; out = get_output_picture(ctx)) {
+        release_output_picture(ctx, out);
+    }
+    return ERR_OK;
+}
+
+/**
+ * @brief compare the frame stores of the DPB with the expected frame stores in any order
+ */
+static int check_refs(const H264Context *ctx, const char *step, const ExpectedRef *expected, int32_t count) {
+    const DecodedPictureBuffer *dpb = &ctx->dpb;
+
+    if (dpb->size != count) {
+        fprintf(stderr, "%s: %d frame stores, expected %d\n", step, dpb->size, count);
+        return -1;
+    }
+
+    for (int32_t i = 0; i < count; ++i) {
+        int found = 0;
+        for (int32_t j = 0; j < dpb->size; ++j) {
+            const Picture *pic = dpb->frames[j];
+            if (pic->FrameNum == expected[i].FrameNum && pic->ref_marking[0] == expected[i].top && pic->ref_marking[1] == expected[i].bottom) {
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "%s: FrameNum %d with the marking %d/%d not found\n", step, expected[i].FrameNum, expected[i].top, expected[i].bottom);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief the number of the pictures the pool has allocated
+ */
+static int32_t allocated_pictures(const PicturePool *pool) {
+    int32_t count = 0;
+    for (int32_t i = 0; i < H264_MAX_POOL_PICTURES; ++i) {
+        count += pool->pictures[i] != 0;
+    }
+    return count;
+}
+
+static void add_mmco(DecRefPicMark *marking, uint32_t op, uint32_t value, uint32_t long_term_frame_idx) {
+    marking->adaptive_ref_pic_marking_mode_flag = 1;
+    marking->mmco[marking->mmco_len].memory_management_control_operation = op;
+    marking->mmco[marking->mmco_len].difference_of_pic_nums_minus1 = value;
+    marking->mmco[marking->mmco_len].long_term_pic_num = value;
+    marking->mmco[marking->mmco_len].max_long_term_frame_idx_plus1 = value;
+    marking->mmco[marking->mmco_len].long_term_frame_idx = long_term_frame_idx;
+    marking->mmco_len++;
+}
+
+#define CHECK(step, ...)                                                                              \
+    do {                                                                                              \
+        const ExpectedRef expected[] = {__VA_ARGS__};                                                 \
+        if (check_refs(ctx, step, expected, (int32_t)(sizeof(expected) / sizeof(expected[0]))) < 0) { \
+            return -1;                                                                                \
+        }                                                                                             \
+    } while (0)
+
+/**
+ * @brief the sliding window with 3 reference frames, the non-reference pictures and the memory use
+ */
+static int check_sliding_window(H264Context *ctx) {
+    set_test_sps(ctx->active_sps, 3);
+
+    if (start_picture(ctx, 0, 1, 1, 3, 0) < 0) {
+        return -1;
+    }
+    for (uint32_t n = 1; n <= 5; ++n) {
+        if (start_picture(ctx, n, 1, 0, 3, 0) < 0) {
+            return -1;
+        }
+    }
+    CHECK("sliding window", {2, S, S}, {3, S, S}, {4, S, S});
+
+    /* a non-reference picture is released when the next picture starts, frame_num of the following picture does not advance */
+    if (start_picture(ctx, 6, 0, 0, 3, 0) < 0 || start_picture(ctx, 6, 1, 0, 3, 0) < 0) {
+        return -1;
+    }
+    CHECK("non-reference picture", {3, S, S}, {4, S, S}, {5, S, S});
+
+    /* the 3 reference frames, the current picture and the non-reference picture output when the current picture starts, although MaxDpbFrames is 16 */
+    if (allocated_pictures(&ctx->picture_pool) != 5) {
+        fprintf(stderr, "sliding window: %d pictures allocated, expected 5\n", allocated_pictures(&ctx->picture_pool));
+        return -1;
+    }
+    for (int32_t i = 0; i < ctx->dpb.size; ++i) {
+        if (ctx->dpb.frames[i]->ref_count != 1) {
+            fprintf(stderr, "sliding window: a stored picture has %d holders\n", ctx->dpb.frames[i]->ref_count);
+            return -1;
+        }
+    }
+
+    printf("dpb: sliding window verified\n");
+    return 0;
+}
+
+/**
+ * @brief the memory management control operations of the frames, a gap in frame_num and frame_num wrapping around MAX_FRAME_NUM
+ */
+static int check_mmco_frames(H264Context *ctx) {
+    DecRefPicMark marking;
+    set_test_sps(ctx->active_sps, 4);
+
+    for (uint32_t n = 0; n <= 3; ++n) {
+        if (start_picture(ctx, n, 1, n == 0, 3, 0) < 0) {
+            return -1;
+        }
+    }
+
+    /* frame 4: PicNum 2 unused, MaxLongTermFrameIdx 1, PicNum 0 to LongTermFrameIdx 0, itself to LongTermFrameIdx 1 */
+    memset(&marking, 0, sizeof(marking));
+    add_mmco(&marking, 1, 1, 0);
+    add_mmco(&marking, 4, 2, 0);
+    add_mmco(&marking, 3, 3, 0);
+    add_mmco(&marking, 6, 0, 1);
+    if (start_picture(ctx, 4, 1, 0, 3, &marking) < 0 || start_picture(ctx, 5, 1, 0, 3, 0) < 0) {
+        return -1;
+    }
+    CHECK("mmco 1 3 4 6", {0, L, L}, {1, S, S}, {3, S, S}, {4, L, L});
+
+    /* frame 5 removes frame 1 by the sliding window, frame 6: LongTermPicNum 0 unused */
+    memset(&marking, 0, sizeof(marking));
+    add_mmco(&marking, 2, 0, 0);
+    if (start_picture(ctx, 6, 1, 0, 3, &marking) < 0 || start_picture(ctx, 7, 1, 0, 3, 0) < 0) {
+        return -1;
+    }
+    CHECK("mmco 2", {3, S, S}, {4, L, L}, {5, S, S}, {6, S, S});
+
+    /* frame 7 and the non-existing frames 8 to 11 of the gap push out the short-term frames, the long-term frame stays */
+    if (start_picture(ctx, 12, 1, 0, 3, 0) < 0 || start_picture(ctx, 13, 1, 0, 3, 0) < 0) {
+        return -1;
+    }
+    CHECK("frame_num gap", {4, L, L}, {10, S, S}, {11, S, S}, {12, S, S});
+    for (int32_t i = 0; i < ctx->dpb.size; ++i) {
+        const Picture *pic = ctx->dpb.frames[i];
+        if (pic->non_existing != (pic->FrameNum == 10 || pic->FrameNum == 11)) {
+            fprintf(stderr, "frame_num gap: FrameNum %d has non_existing %d\n", pic->FrameNum, pic->non_existing);
+            return -1;
+        }
+    }
+
+    /* frame 13: PicNum 12 unused, then frame_num wraps, the frames 14 and 15 precede frame 0 for the sliding window */
+    memset(&marking, 0, sizeof(marking));
+    add_mmco(&marking, 1, 0, 0);
+    if (start_picture(ctx, 14, 1, 0, 3, 0) < 0) {
+        return -1;
+    }
+    ctx->prev_slice_header->dec_ref_pic_mark = marking;
+    for (uint32_t n = 15; n <= 18; ++n) {
+        if (start_picture(ctx, n % MAX_FRAME_NUM, 1, 0, 3, 0) < 0) {
+            return -1;
+        }
+    }
+    CHECK("frame_num wrap", {4, L, L}, {15, S, S}, {0, S, S}, {1, S, S});
+
+    /* frame 2 has memory_management_control_operation 5, it is inferred to have frame_num 0 */
+    memset(&marking, 0, sizeof(marking));
+    add_mmco(&marking, 5, 0, 0);
+    if (start_picture(ctx, 2, 1, 0, 3, &marking) < 0 || start_picture(ctx, 1, 1, 0, 3, 0) < 0) {
+        return -1;
+    }
+    CHECK("mmco 5", {0, S, S});
+
+    /* an IDR picture releases all the frames */
+    if (start_picture(ctx, 0, 1, 1, 3, 0) < 0 || start_picture(ctx, 1, 1, 0, 3, 0) < 0) {
+        return -1;
+    }
+    CHECK("idr", {0, S, S});
+
+    printf("dpb: memory management control operations verified\n");
+    return 0;
+}
+
+/**
+ * @brief the complementary field pairs and the memory management control operations of the fields
+ */
+static int check_fields(H264Context *ctx) {
+    DecRefPicMark marking;
+    set_test_sps(ctx->active_sps, 2);
+
+    /* an IDR top field and its non-IDR bottom field share the frame store */
+    if (start_picture(ctx, 0, 1, 1, 1, 0) < 0) {
+        return -1;
+    }
+    Picture *first = ctx->current_picture;
+    if (start_picture(ctx, 0, 1, 0, 2, 0) < 0 || ctx->current_picture != first || start_picture(ctx, 1, 1, 0, 1, 0) < 0) {
+        fprintf(stderr, "field pair: the fields are not paired\n");
+        return -1;
+    }
+    CHECK("field pair", {0, S, S});
+
+    /* the bottom field of frame 1 is paired with its top field without the sliding window */
+    if (start_picture(ctx, 1, 1, 0, 2, 0) < 0 || start_picture(ctx, 2, 1, 0, 2, 0) < 0) {
+        return -1;
+    }
+    CHECK("field pairs", {0, S, S}, {1, S, S});
+
+    /* the bottom field of frame 2 removes frame 0 by the sliding window. the top field of frame 2: CurrPicNum 5, PicNum 3 is the top field and PicNum 2 the
+     * bottom field of frame 1 */
+    memset(&marking, 0, sizeof(marking));
+    add_mmco(&marking, 1, 1, 0);
+    add_mmco(&marking, 4, 1, 0);
+    add_mmco(&marking, 3, 2, 0);
+    if (start_picture(ctx, 2, 1, 0, 1, &marking) < 0 || start_picture(ctx, 3, 1, 0, 3, 0) < 0) {
+        return -1;
+    }
+    CHECK("field mmco", {1, U, L}, {2, S, S});
+
+    printf("dpb: complementary field pairs verified\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t pictures = 200000;
+    H264Context *ctx = 0;
+    SPS *sps = 0;
+
+    if (argc > 1) {
+        pictures = atoi(argv[1]);
+    }
+    if (pictures <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    ctx = create_context();
+    sps = (SPS *)malloc(sizeof(SPS));
+    if (!ctx || !sps) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    ctx->active_sps = sps;
+
+    /* verify */
+    if (check_sliding_window(ctx) < 0 || check_mmco_frames(ctx) < 0 || check_fields(ctx) < 0) {
+        goto exit_flag;
+    }
+
+    /* benchmark: 16 reference frames with the sliding window */
+    set_test_sps(sps, 16);
+    clock_t start = clock();
+    for (int32_t i = 0; i < pictures; ++i) {
+        if (start_picture(ctx, (uint32_t)(i % MAX_FRAME_NUM), 1, i == 0, 3, 0) < 0) {
+            fprintf(stderr, "benchmark: picture %d failed\n", i);
+            goto exit_flag;
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("dpb: %.0f pictures/s marked (%d pictures, 16 reference frames)\n", seconds > 0 ? pictures / seconds : 0.0, pictures);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (ctx) {
+        ctx->active_sps = 0;
+        free_context(ctx);
+    }
+    if (sps) {
+        free(sps);
+    }
+    return exit_code;
+}
@@ -0,0 +1,456 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_context.h"
+#include "h264decoder/h264_frame.h"
+
+/*
+ * frame delivery test: starts the pictures of synthetic slice headers on a context and receives the output frames. checks the frames point to the samples of
+ * the decoded pictures with the cropping rectangle, the picture order count and the timestamps of their access units, that a picture is not recycled while a
+ * handle of it is held, the fail, grow and block policies when the held frames exhaust the picture pool, and that the memory budget of the context stops the
+ * growth of the pool, and that the held frames stay valid after the context is freed. then reports the frames delivered per second.
+ *
+ * usage: test_h264_frame [frames]
+ */
+
+#define MAX_FRAME_NUM 16
+#define MAX_HELD 64
+
+/* the frames the application holds, released by the releaser thread of the block policy */
+typedef struct {
+    DecodedFrame frames[MAX_HELD];
+    int32_t count;
+} HeldFrames;
+
+static void set_test_sps(SPS *sps) {
+    memset(sps, 0, sizeof(SPS));
+    sps->PicWidthInMbs = 4;
+    sps->FrameHeightInMbs = 3;
+    sps->frame_mbs_only_flag = 1;
+    sps->MaxDpbFrames = 1;
+    sps->max_num_ref_frames = 1;
+    sps->MaxFrameNum = MAX_FRAME_NUM;
+    sps->chroma_format_idc = 1;
+    sps->ChromaArrayType = 1;
+    sps->SubWidthC = 2;
+    sps->SubHeightC = 2;
+    sps->MbWidthC = 8;
+    sps->MbHeightC = 8;
+    sps->BitDepthY = 8;
+    sps->BitDepthC = 8;
+
+    /* the output order is the decoding order, a frame is output when the next picture starts */
+    sps->pic_order_cnt_type = 2;
+
+    /* 64x48 cropped to 60x46 by the crop units of 4:2:0 frames */
+    sps->frame_cropping_flag = 1;
+    sps->frame_crop_right_offset = 2;
+    sps->frame_crop_bottom_offset = 1;
+}
+
+/**
+ * @brief start reference frame n of the stream on the context as its first slice would, with the timestamps of the access unit
+ */
+static int start_picture(H264Context *ctx, uint32_t n) {
+    SliceHeader *header = 0;
+    Picture *pic = 0;
+
+    set_access_unit_timestamps(ctx, 1000 + 40 * (int64_t)n, 40 * (int64_t)n);
+    get_slice_header(ctx, &header);
+    header->nalu_header.nal_ref_idc = 1;
+    header->nalu_header.IdrPicFlag = n == 0;
+    header->frame_num = n % MAX_FRAME_NUM;
+    header->sps = ctx->active_sps;
+
+    int err_code = get_picture_from_context(ctx, 1, &pic);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* the state set_picture_structure() sets */
+    pic->decoded_fields = 3;
+    return ERR_OK;
+}
+
+/**
+ * @brief receive the output frames into the held frames
+ */
+static void hold_frames(H264Context *ctx, HeldFrames *held) {
+    while (held->count < MAX_HELD && receive_frame(ctx, &held->frames[held->count]) == ERR_OK) {
+        held->count++;
+    }
+}
+
+static void release_held_frames(HeldFrames *held) {
+    for (int32_t i = 0; i < held->count; ++i) {
+        release_frame(&held->frames[i]);
+    }
+    held->count = 0;
+}
+
+/**
+ * @brief the frame points to the samples of the decoded picture and carries its cropping rectangle, picture order count and timestamps
+ */
+static int check_frame_handle(H264Context *ctx) {
+    DecodedFrame frame;
+    DecodedFrame copy;
+
+    set_test_sps(ctx->active_sps);
+    if (start_picture(ctx, 0) < 0) {
+        return -1;
+    }
+    const uint8_t *samples = ctx->current_picture->frame->planes[0].data;
+    if (receive_frame(ctx, &frame) != ERR_NO_FRAME || start_picture(ctx, 1) < 0 || receive_frame(ctx, &frame) < 0) {
+        fprintf(stderr, "frame handle: the first frame is not output when the second picture starts\n");
+        return -1;
+    }
+
+    if (frame.planes[0].data != samples || frame.plane_count != 3 || frame.planes[1].width != 32 || frame.BitDepthY != 8 || frame.chroma_format_idc != 1) {
+        fprintf(stderr, "frame handle: the planes are not the planes of the picture\n");
+        return -1;
+    }
+    if (frame.crop_left != 0 || frame.crop_top != 0 || frame.crop_width != 60 || frame.crop_height != 46) {
+        fprintf(stderr, "frame handle: crop %d,%d %dx%d, expected 0,0 60x46\n", frame.crop_left, frame.crop_top, frame.crop_width, frame.crop_height);
+        return -1;
+    }
+    if (frame.poc != 0 || frame.pts != 1000 || frame.dts != 0 || frame.decode_index != 0 || frame.output_latency != 0) {
+        fprintf(stderr, "frame handle: poc %d pts %lld dts %lld\n", frame.poc, (long long)frame.pts, (long long)frame.dts);
+        return -1;
+    }
+
+    /* the picture stays held by the copy after the frame is released */
+    if (ref_frame(&copy, &frame) < 0) {
+        return -1;
+    }
+    release_frame(&frame);
+    for (uint32_t n = 2; n < 8; ++n) {
+        if (start_picture(ctx, n) < 0 || ctx->current_picture->frame->planes[0].data == samples) {
+            fprintf(stderr, "frame handle: the held picture is recycled\n");
+            return -1;
+        }
+        while (receive_frame(ctx, &frame) == ERR_OK) {
+            release_frame(&frame);
+        }
+    }
+
+    /* the picture returns to the pool with its last handle */
+    int is_recycled = 0;
+    release_frame(&copy);
+    for (uint32_t n = 8; n < 12; ++n) {
+        if (start_picture(ctx, n) < 0) {
+            return -1;
+        }
+        is_recycled |= ctx->current_picture->frame->planes[0].data == samples;
+        while (receive_frame(ctx, &frame) == ERR_OK) {
+            release_frame(&frame);
+        }
+    }
+    if (!is_recycled || copy.picture) {
+        fprintf(stderr, "frame handle: the released picture is not recycled\n");
+        return -1;
+    }
+
+    printf("frame: zero-copy handle with crop, poc and timestamps verified\n");
+    return 0;
+}
+
+/**
+ * @brief start pictures until the held frames exhaust the pool, return the error of the picture which fails and its number in *failed
+ */
+static int exhaust_pool(H264Context *ctx, HeldFrames *held, uint32_t first, uint32_t *failed) {
+    for (uint32_t n = first; n < first + MAX_HELD; ++n) {
+        int err_code = start_picture(ctx, n);
+        if (err_code < 0) {
+            *failed = n;
+            return err_code;
+        }
+        hold_frames(ctx, held);
+    }
+    *failed = first + MAX_HELD;
+    return ERR_OK;
+}
+
+static void *release_later(void *arg) {
+    struct timespec delay = {0, 20 * 1000 * 1000};
+    nanosleep(&delay, 0);
+    release_held_frames((HeldFrames *)arg);
+    return 0;
+}
+
+/**
+ * @brief the fail, grow and block policies when the application holds the frames
+ */
+static int check_pool_policies(H264Context *ctx) {
+    HeldFrames *held = (HeldFrames *)malloc(sizeof(HeldFrames));
+    uint32_t failed = 0;
+    int ret = -1;
+
+    if (!held) {
+        return -1;
+    }
+    held->count = 0;
+    set_test_sps(ctx->active_sps);
+
+    /* fail: the DPB frame, the current picture and the output queue share 3 pictures, the held frames take the rest */
+    if (set_frame_pool_policy(ctx, FRAME_POOL_FAIL) < 0 || start_picture(ctx, 0) < 0) {
+        goto exit_flag;
+    }
+    if (exhaust_pool(ctx, held, 1, &failed) != ERR_PICTURE_POOL_EXHAUSTED || held->count == 0) {
+        fprintf(stderr, "pool policy fail: the held frames do not exhaust the pool\n");
+        goto exit_flag;
+    }
+    release_held_frames(held);
+    if (start_picture(ctx, failed) < 0) {
+        fprintf(stderr, "pool policy fail: the decoding does not resume after the frames are released\n");
+        goto exit_flag;
+    }
+
+    /* grow: the pool takes more pictures for the held frames */
+    if (set_frame_pool_policy(ctx, FRAME_POOL_GROW) < 0 || exhaust_pool(ctx, held, failed + 1, &failed) != ERR_PICTURE_POOL_EXHAUSTED ||
+        ctx->picture_pool.size != H264_MAX_POOL_PICTURES) {
+        fprintf(stderr, "pool policy grow: the pool has %d pictures, expected %d\n", ctx->picture_pool.size, H264_MAX_POOL_PICTURES);
+        goto exit_flag;
+    }
+
+    /* block: the decoder waits for the releaser thread */
+    pthread_t releaser;
+    if (set_frame_pool_policy(ctx, FRAME_POOL_BLOCK) < 0 || pthread_create(&releaser, 0, release_later, held)) {
+        goto exit_flag;
+    }
+    int err_code = start_picture(ctx, failed);
+    pthread_join(releaser, 0);
+    if (err_code < 0) {
+        fprintf(stderr, "pool policy block: the decoding fails with %d\n", err_code);
+        goto exit_flag;
+    }
+    if (set_frame_pool_policy(ctx, (FRAME_POOL_POLICY)3) == 0) {
+        fprintf(stderr, "pool policy: invalid policy accepted\n");
+        goto exit_flag;
+    }
+
+    printf("frame: pool policies fail, grow and block verified\n");
+    ret = 0;
+
+exit_flag:
+    release_held_frames(held);
+    set_frame_pool_policy(ctx, FRAME_POOL_FAIL);
+    free(held);
+    return ret;
+}
+
+/**
+ * @brief the pool grows for the held frames only as far as the memory budget of the context allows
+ */
+static int check_memory_budget() {
+    H264Context *ctx = create_context();
+    SPS *sps = (SPS *)malloc(sizeof(SPS));
+    HeldFrames *held = (HeldFrames *)malloc(sizeof(HeldFrames));
+    DecodedFrame frame;
+    MemoryUsage usage;
+    uint32_t failed = 0;
+    int ret = -1;
+
+    if (!ctx || !sps || !held) {
+        goto exit_flag;
+    }
+    held->count = 0;
+    ctx->active_sps = sps;
+    set_test_sps(sps);
+
+    /* the budget fits 5 and a half pictures, the held frames take the pictures beyond the DPB frame, the current picture and the output queue */
+    if (set_frame_pool_policy(ctx, FRAME_POOL_GROW) < 0 || start_picture(ctx, 0) < 0) {
+        goto exit_flag;
+    }
+    get_memory_usage(ctx, &usage);
+    size_t picture_size = usage.total;
+    size_t limit = 5 * picture_size + picture_size / 2;
+    /* the macroblock scratch belongs to the decoding threads, a picture which is not reconstructed yet has no scratch */
+    if (!usage.current[MEMORY_FRAME_BUFFERS] || !usage.current[MEMORY_MB_METADATA] || usage.current[MEMORY_SCRATCH] || set_memory_limit(ctx, limit) < 0 ||
+        set_memory_limit(ctx, picture_size / 2) != ERR_MEMORY_BUDGET_EXCEEDED) {
+        fprintf(stderr, "memory budget: the picture is not charged by category\n");
+        goto exit_flag;
+    }
+
+    int err_code = exhaust_pool(ctx, held, 1, &failed);
+    get_memory_usage(ctx, &usage);
+    if (err_code != ERR_MEMORY_BUDGET_EXCEEDED || ctx->picture_pool.size >= H264_MAX_POOL_PICTURES || usage.peak_total > limit ||
+        usage.total != 5 * picture_size || usage.refused == 0 || !is_waiting_for_frames(ctx)) {
+        fprintf(stderr, "memory budget: error %d with %d pictures, %zu of %zu bytes\n", err_code, ctx->picture_pool.size, usage.peak_total, limit);
+        goto exit_flag;
+    }
+
+    /* the released frames make room for the next picture */
+    release_held_frames(held);
+    if (is_waiting_for_frames(ctx) || start_picture(ctx, failed) < 0) {
+        fprintf(stderr, "memory budget: the decoding does not resume after the frames are released\n");
+        goto exit_flag;
+    }
+
+    printf("frame: pool growth capped by the memory budget at %zu bytes per picture\n", picture_size);
+    ret = 0;
+
+exit_flag:
+    if (held) {
+        release_held_frames(held);
+        free(held);
+    }
+    if (ctx) {
+        flush_context(ctx);
+        while (receive_frame(ctx, &frame) == ERR_OK) {
+            release_frame(&frame);
+        }
+        ctx->active_sps = 0;
+        free_context(ctx);
+    }
+    if (sps) {
+        free(sps);
+    }
+    return ret;
+}
+
+/**
+ * @brief the frames stay valid after the context is freed, their pictures are freed with their last handles, one of them on another thread
+ */
+static int check_frames_outlive_context() {
+    H264Context *ctx = create_context();
+    SPS *sps = (SPS *)malloc(sizeof(SPS));
+    HeldFrames *held = (HeldFrames *)malloc(sizeof(HeldFrames));
+    DecodedFrame copy;
+    pthread_t releaser;
+    int ret = -1;
+
+    memset(&copy, 0, sizeof(DecodedFrame));
+    if (!ctx || !sps || !held) {
+        goto exit_flag;
+    }
+    held->count = 0;
+    ctx->active_sps = sps;
+    set_test_sps(sps);
+
+    if (set_frame_pool_policy(ctx, FRAME_POOL_GROW) < 0) {
+        goto exit_flag;
+    }
+    for (uint32_t n = 0; n < 4; ++n) {
+        if (start_picture(ctx, n) < 0) {
+            fprintf(stderr, "frames outlive context: picture %u failed\n", n);
+            goto exit_flag;
+        }
+        hold_frames(ctx, held);
+    }
+    if (held->count != 3 || ref_frame(&copy, &held->frames[0]) < 0) {
+        fprintf(stderr, "frames outlive context: %d frames held, expected 3\n", held->count);
+        goto exit_flag;
+    }
+    for (int32_t i = 0; i < held->count; ++i) {
+        memset(held->frames[i].planes[0].data, 0x40 + i, held->frames[i].planes[0].width);
+    }
+
+    /* the pictures of the DPB and of the current picture are freed with the context, the held ones are not */
+    ctx->active_sps = 0;
+    free_context(ctx);
+    ctx = 0;
+
+    for (int32_t i = 0; i < held->count; ++i) {
+        const uint8_t *row = held->frames[i].planes[0].data;
+        if (row[0] != 0x40 + i || row[held->frames[i].planes[0].width - 1] != 0x40 + i || held->frames[i].poc != 2 * i) {
+            fprintf(stderr, "frames outlive context: frame %d changed after the context is freed\n", i);
+            goto exit_flag;
+        }
+    }
+
+    /* the copy holds the first picture after its frame is released, the last handles are released on another thread */
+    release_frame(&held->frames[0]);
+    if (copy.planes[0].data[0] != 0x40) {
+        fprintf(stderr, "frames outlive context: the copy lost its picture\n");
+        goto exit_flag;
+    }
+    held->frames[0] = copy;
+    memset(&copy, 0, sizeof(DecodedFrame));
+    if (pthread_create(&releaser, 0, release_later, held)) {
+        goto exit_flag;
+    }
+    pthread_join(releaser, 0);
+
+    printf("frame: frames held after the context is freed verified\n");
+    ret = 0;
+
+exit_flag:
+    release_frame(&copy);
+    if (held) {
+        release_held_frames(held);
+        free(held);
+    }
+    if (ctx) {
+        ctx->active_sps = 0;
+        free_context(ctx);
+    }
+    if (sps) {
+        free(sps);
+    }
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t frames = 200000;
+    H264Context *ctx = 0;
+    SPS *sps = 0;
+    DecodedFrame frame;
+
+    if (argc > 1) {
+        frames = atoi(argv[1]);
+    }
+    if (frames <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    ctx = create_context();
+    sps = (SPS *)malloc(sizeof(SPS));
+    if (!ctx || !sps) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    ctx->active_sps = sps;
+
+    /* verify */
+    if (check_frame_handle(ctx) < 0 || check_pool_policies(ctx) < 0 || check_memory_budget() < 0 || check_frames_outlive_context() < 0) {
+        goto exit_flag;
+    }
+
+    /* benchmark: every picture is received and released as a frame */
+    int32_t delivered = 0;
+    clock_t start = clock();
+    for (int32_t i = 0; i < frames; ++i) {
+        if (start_picture(ctx, (uint32_t)i) < 0) {
+            fprintf(stderr, "benchmark: picture %d failed\n", i);
+            goto exit_flag;
+        }
+        while (receive_frame(ctx, &frame) == ERR_OK) {
+            release_frame(&frame);
+            delivered++;
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("frame: %.0f frames/s delivered (%d frames)\n", seconds > 0 ? delivered / seconds : 0.0, delivered);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (ctx) {
+        flush_context(ctx);
+        while (receive_frame(ctx, &frame) == ERR_OK) {
+            release_frame(&frame);
+        }
+        ctx->active_sps = 0;
+        free_context(ctx);
+    }
+    if (sps) {
+        free(sps);
+    }
+    return exit_code;
+}
@@ -0,0 +1,243 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_context.h"
+#include "h264decoder/h264_frame.h"
+#include "h264decoder/h264_frame_thread.h"
+
+#include "h264_test_stream.h"
+
+/*
+ * frame threading test: encodes a synthetic CAVLC stream of 1920x1088 frames in memory, an IDR picture of I_PCM macroblocks followed by P pictures with
+ * varying motion vectors and non-reference B pictures with temporal direct prediction, two slices per picture. decodes it on the decoding thread and with 2 to
+ * 16 frame threads, and checks that every output frame carries the same picture order count, macroblock types, reference indices and motion vectors. then
+ * reports the frames decoded per second of wall clock time for each number of threads.
+ *
+ * the stream is then decoded with the reconstruction, the frame threads reconstruct and deblock the samples of their pictures while the motion compensation waits
+ * for the rows of the reference pictures. the output samples of 2 to 16 frame threads, with 1 and 4 reconstruction threads, are checked against the reconstruction
+ * on the decoding thread and the frames per second are reported again.
+ *
+ * usage: test_h264_frame_thread [frames]
+ */
+
+#define WIDTH_IN_MBS 120
+#define HEIGHT_IN_MBS 68
+#define SLICES_PER_PICTURE 2
+
+/**
+ * @brief write picture n of the stream: the IDR picture, then the P pictures of the even output positions each followed by the B picture preceding it in the
+ * output order. the B pictures refer to the P picture decoded just before as RefPicList1[0], the co-located picture of the temporal direct prediction
+ */
+static int write_picture(Stream *stream, BitWriter *w, int32_t n) {
+    int is_idr = n == 0;
+    int is_b = n > 0 && n % 2 == 0;
+    int32_t output_position = is_idr ? 0 : (is_b ? n - 1 : n + 1);
+    int32_t frame_num = (n + 1) / 2 % 16;
+    uint8_t nalu_header = is_idr ? 0x65 : (is_b ? 0x01 : 0x41);
+    int32_t mbs_per_slice = WIDTH_IN_MBS * HEIGHT_IN_MBS / SLICES_PER_PICTURE;
+
+    for (int32_t slice = 0; slice < SLICES_PER_PICTURE; ++slice) {
+        int32_t first_mb = slice * mbs_per_slice;
+
+        /* @see 7.3.3 Slice header syntax */
+        w->bits = 0;
+        put_ue(w, (uint32_t)first_mb);
+        put_ue(w, is_idr ? 7 : (is_b ? 6 : 5));
+        put_ue(w, 0);
+        put_u(w, (uint32_t)frame_num, 4);
+        if (is_idr) {
+            put_ue(w, 0);
+        }
+        put_u(w, (uint32_t)(2 * output_position) % 64, 6);
+        if (is_b) {
+            put_u(w, 0, 1); /* direct_spatial_mv_pred_flag */
+        }
+        if (!is_idr) {
+            put_u(w, 0, 1); /* num_ref_idx_active_override_flag */
+            put_u(w, 0, 1); /* ref_pic_list_modification_flag_l0 */
+        }
+        if (is_b) {
+            put_u(w, 0, 1);
+        }
+        if (is_idr) {
+            put_u(w, 0, 1);
+            put_u(w, 0, 1);
+        } else if (!is_b) {
+            put_u(w, 0, 1); /* adaptive_ref_pic_marking_mode_flag */
+        }
+        put_se(w, 0);
+        put_ue(w, 0); /* disable_deblocking_filter_idc */
+        put_se(w, 0);
+        put_se(w, 0);
+
+        /* @see 7.3.4 Slice data syntax */
+        uint32_t skip_run = 0;
+        for (int32_t mb = first_mb; mb < first_mb + mbs_per_slice; ++mb) {
+            if (is_idr) {
+                put_ue(w, 25); /* I_PCM */
+                while (w->bits % 8) {
+                    put_bit(w, 0);
+                }
+                for (int32_t i = 0; i < 384; ++i) {
+                    put_u(w, (uint32_t)(128 + (mb + i) % 64), 8);
+                }
+                continue;
+            }
+
+            if ((mb * 5 + n) % 7 == 0) {
+                skip_run++;
+                continue;
+            }
+            put_ue(w, skip_run);
+            skip_run = 0;
+
+            int32_t mvd_x = (mb * 7 + n) % 33 - 16;
+            int32_t mvd_y = (mb * 13 + n) % 17 - 8;
+            if (!is_b) {
+                put_ue(w, 0); /* P_L0_16x16 */
+                put_se(w, mvd_x);
+                put_se(w, mvd_y);
+            } else {
+                /* B_Direct_16x16, B_L0_16x16, B_L1_16x16 and B_Bi_16x16 */
+                uint32_t mb_type = (uint32_t)(mb + n) % 4;
+                put_ue(w, mb_type);
+                for (uint32_t list = 0; list < 2 && mb_type; ++list) {
+                    if (mb_type == 3 || mb_type == list + 1) {
+                        put_se(w, mvd_x);
+                        put_se(w, mvd_y);
+                    }
+                }
+            }
+            put_ue(w, 0); /* coded_block_pattern 0 */
+        }
+        if (skip_run) {
+            put_ue(w, skip_run);
+        }
+
+        if (put_trailing_bits(w) < 0 || add_nalu(stream, nalu_header, w) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief decode the stream with the frame threads, the checksums of the output frames are written in the output order
+ *
+ * @param reconstruction_threads the reconstruction threads, H264_RECONSTRUCT_PARSE_ONLY to decode the macroblock state only
+ * @return int32_t the number of the output frames, -1 on error
+ */
+static int32_t decode_stream(const Stream *stream, int32_t thread_count, int32_t reconstruction_threads, uint64_t *hashes, int32_t max_frames) {
+    int32_t count = -1;
+    uint32_t parts = TEST_HASH_MB_TYPES | TEST_HASH_MOTION | (reconstruction_threads != H264_RECONSTRUCT_PARSE_ONLY ? TEST_HASH_SAMPLES : 0);
+
+    H264Context *ctx = create_context();
+    if (!ctx) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    if (set_frame_threads(ctx, thread_count) < 0 || set_reconstruction_threads(ctx, reconstruction_threads) < 0) {
+        fprintf(stderr, "frame thread: %d threads not created\n", thread_count);
+        goto exit_flag;
+    }
+    count = decode_test_stream(ctx, stream, "frame thread", parts, hashes, max_frames, 0);
+
+exit_flag:
+    free_context(ctx);
+    return count;
+}
+
+/**
+ * @brief decode the stream with each number of frame threads and report the frames per second
+ *
+ * @param expected the checksums of the frames of the reference, the first decoding writes them unless has_expected is 1
+ * @param has_expected 1 if the checksums of the reference are given
+ * @return int 0 on success, -1 on error
+ */
+static int verify_thread_counts(const Stream *stream, int32_t reconstruction_threads, uint64_t *expected, int has_expected, uint64_t *hashes, int32_t frames) {
+    static const int32_t thread_counts[] = {1, 2, 4, 8, 12, 16};
+
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int32_t count = decode_stream(stream, thread_counts[i], reconstruction_threads, i || has_expected ? hashes : expected, frames);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (count != frames) {
+            fprintf(stderr, "frame thread: %d of %d frames output with %d threads\n", count, frames, thread_counts[i]);
+            return -1;
+        }
+        if ((i || has_expected) && memcmp(hashes, expected, frames * sizeof(uint64_t))) {
+            fprintf(stderr, "frame thread: the frames decoded with %d threads and %d reconstruction threads differ\n", thread_counts[i], reconstruction_threads);
+            return -1;
+        }
+
+        /* wall clock time, the CPU time of the process adds up the threads */
+        double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("frame thread: %2d threads, %d reconstruction threads, %.1f frames/s (%d frames of %dx%d)\n", thread_counts[i], reconstruction_threads,
+               seconds > 0 ? frames / seconds : 0.0, frames, WIDTH_IN_MBS * 16, HEIGHT_IN_MBS * 16);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t frames = 33;
+    Stream stream;
+    BitWriter writer;
+    uint64_t *expected = 0;
+    uint64_t *hashes = 0;
+
+    memset(&stream, 0, sizeof(Stream));
+    memset(&writer, 0, sizeof(BitWriter));
+
+    if (argc > 1) {
+        frames = atoi(argv[1]);
+    }
+    if (frames <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    expected = (uint64_t *)malloc(frames * sizeof(uint64_t));
+    hashes = (uint64_t *)malloc(frames * sizeof(uint64_t));
+    if (!expected || !hashes || write_parameter_sets(&stream, &writer, WIDTH_IN_MBS, HEIGHT_IN_MBS) < 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    for (int32_t n = 0; n < frames; ++n) {
+        if (write_picture(&stream, &writer, n) < 0) {
+            fprintf(stderr, "Memory allocation failed\n");
+            goto exit_flag;
+        }
+    }
+
+    /* verify and benchmark: the decoding thread first, its output frames are the reference of the frame threads */
+    if (verify_thread_counts(&stream, H264_RECONSTRUCT_PARSE_ONLY, expected, 0, hashes, frames) < 0) {
+        goto exit_flag;
+    }
+    printf("frame thread: P and temporal direct B pictures verified\n");
+
+    /* the frame threads reconstruct the samples, the reconstruction on the decoding thread is the reference of both numbers of reconstruction threads */
+    if (verify_thread_counts(&stream, 1, expected, 0, hashes, frames) < 0 || verify_thread_counts(&stream, 4, expected, 1, hashes, frames) < 0) {
+        goto exit_flag;
+    }
+    printf("frame thread: the samples reconstructed by the frame threads verified\n");
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (expected) {
+        free(expected);
+    }
+    if (hashes) {
+        free(hashes);
+    }
+    free_stream(&stream);
+    if (writer.buffer) {
+        free(writer.buffer);
+    }
+    return exit_code;
+}
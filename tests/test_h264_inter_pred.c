@@ -0,0 +1,454 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_cpu.h"
+#include "h264decoder/h264_inter_pred.h"
+
+/*
+ * motion compensation test: predicts blocks of every size at random motion vectors, also far outside of the picture, with the function table selected for each
+ * instruction set level supported by the CPU and compares the samples with the scalar reference kernels. the scalar kernels on the padded planes are checked against
+ * the interpolation of 8.4.2.2 with the clipped sample positions, on 8-bit planes padded in two line ranges and on 10-bit planes. the weighting kernels are compared
+ * with random weights and the implicit weights with known values. then reports the 16x16 luma blocks per second.
+ *
+ * usage: test_h264_inter_pred [block count] [rounds]
+ */
+
+#define PIC_WIDTH 176
+#define PIC_HEIGHT 144
+#define DST_STRIDE 16
+
+typedef struct {
+    uint8_t *buffer;
+    uint8_t *plane;
+    /* the samples of the 10-bit planes, 0 for the 8-bit planes */
+    uint16_t *buffer16;
+    uint16_t *plane16;
+    int32_t stride;
+    int32_t width;
+    int32_t height;
+} TestPlane;
+
+static int alloc_plane(TestPlane *p, int32_t width, int32_t height, int32_t border) {
+    p->stride = width + 2 * border;
+    p->width = width;
+    p->height = height;
+    p->buffer = (uint8_t*)malloc((size_t)p->stride * (height + 2 * border));
+    if (!p->buffer) {
+        return -1;
+    }
+    p->plane = p->buffer + border * p->stride + border;
+
+    for (int32_t y = 0; y < height; ++y) {
+        for (int32_t x = 0; x < width; ++x) {
+            p->plane[y * p->stride + x] = (uint8_t)(rand() & 255);
+        }
+    }
+    /* the upper and the lower half are padded one after the other as the frame threads pad the rows whose samples are final */
+    pad_reference_lines(p->plane, p->stride, width, height, border, 0, height / 2);
+    pad_reference_lines(p->plane, p->stride, width, height, border, height / 2, height);
+    return 0;
+}
+
+static int alloc_plane16(TestPlane *p, int32_t width, int32_t height, int32_t border) {
+    p->stride = width + 2 * border;
+    p->width = width;
+    p->height = height;
+    p->buffer16 = (uint16_t*)malloc(sizeof(uint16_t) * p->stride * (height + 2 * border));
+    if (!p->buffer16) {
+        return -1;
+    }
+    p->plane16 = p->buffer16 + border * p->stride + border;
+
+    for (int32_t y = 0; y < height; ++y) {
+        for (int32_t x = 0; x < width; ++x) {
+            p->plane16[y * p->stride + x] = (uint16_t)(rand() & 1023);
+        }
+    }
+    pad_reference_plane16(p->plane16, p->stride, width, height, border);
+    return 0;
+}
+
+static int32_t clip(int32_t v, int32_t lo, int32_t hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+static int32_t sample(const TestPlane *p, int32_t x, int32_t y) {
+    int32_t offset = clip(y, 0, p->height - 1) * p->stride + clip(x, 0, p->width - 1);
+    return p->plane16 ? p->plane16[offset] : p->plane[offset];
+}
+
+static int32_t tap6(int32_t a, int32_t b, int32_t c, int32_t d, int32_t e, int32_t f) { return a - 5 * b + 20 * c + 20 * d - 5 * e + f; }
+
+/* ( 1 << BitDepth ) - 1 of the planes being checked */
+static int32_t g_pixel_max = 255;
+
+static int32_t clip1(int32_t v) { return clip(v, 0, g_pixel_max); }
+
+/**
+ * @brief the luma sample of equations 8-241 to 8-261 with the clipping of equations 8-228 and 8-229
+ */
+static int32_t luma_sample(const TestPlane *p, int32_t xInt, int32_t yInt, int32_t xFrac, int32_t yFrac) {
+#define G(dx, dy) sample(p, xInt + (dx), yInt + (dy))
+#define B1(dy) tap6(G(-2, dy), G(-1, dy), G(0, dy), G(1, dy), G(2, dy), G(3, dy))
+#define H1(dx) tap6(G(dx, -2), G(dx, -1), G(dx, 0), G(dx, 1), G(dx, 2), G(dx, 3))
+    int32_t b = clip1((B1(0) + 16) >> 5);
+    int32_t h = clip1((H1(0) + 16) >> 5);
+    int32_t m = clip1((H1(1) + 16) >> 5);
+    int32_t s = clip1((B1(1) + 16) >> 5);
+    int32_t j = clip1((tap6(B1(-2), B1(-1), B1(0), B1(1), B1(2), B1(3)) + 512) >> 10);
+    int32_t Gs = G(0, 0);
+    int32_t Hs = G(1, 0);
+    int32_t Ms = G(0, 1);
+#undef G
+#undef B1
+#undef H1
+
+    switch (yFrac * 4 + xFrac) {
+    case 0: return Gs;
+    case 1: return (Gs + b + 1) >> 1;
+    case 2: return b;
+    case 3: return (b + Hs + 1) >> 1;
+    case 4: return (Gs + h + 1) >> 1;
+    case 5: return (b + h + 1) >> 1;
+    case 6: return (b + j + 1) >> 1;
+    case 7: return (b + m + 1) >> 1;
+    case 8: return h;
+    case 9: return (h + j + 1) >> 1;
+    case 10: return j;
+    case 11: return (j + m + 1) >> 1;
+    case 12: return (h + Ms + 1) >> 1;
+    case 13: return (h + s + 1) >> 1;
+    case 14: return (j + s + 1) >> 1;
+    default: return (m + s + 1) >> 1;
+    }
+}
+
+static int32_t chroma_sample(const TestPlane *p, int32_t xInt, int32_t yInt, int32_t xFrac, int32_t yFrac) {
+    return ((8 - xFrac) * (8 - yFrac) * sample(p, xInt, yInt) + xFrac * (8 - yFrac) * sample(p, xInt + 1, yInt) + (8 - xFrac) * yFrac * sample(p, xInt, yInt + 1) +
+            xFrac * yFrac * sample(p, xInt + 1, yInt + 1) + 32) >>
+           6;
+}
+
+static int16_t random_mv(int32_t range) { return (int16_t)(rand() % (2 * range + 1) - range); }
+
+static int compare_block(const char *name, const uint8_t *ref, const uint8_t *test, int32_t width, int32_t height, const int16_t mv[2]) {
+    for (int32_t y = 0; y < height; ++y) {
+        for (int32_t x = 0; x < width; ++x) {
+            if (ref[y * DST_STRIDE + x] != test[y * DST_STRIDE + x]) {
+                fprintf(stderr, "%s %dx%d mv (%d, %d) mismatch at (%d, %d): %d != %d\n", name, width, height, mv[0], mv[1], x, y, test[y * DST_STRIDE + x],
+                        ref[y * DST_STRIDE + x]);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief the scalar kernels on the padded planes give the samples of the clipped sample positions
+ */
+static int check_clipping(const InterPredFuncs *funcs, const TestPlane *luma, const TestPlane *chroma, int32_t count) {
+    uint8_t dst[16 * DST_STRIDE];
+    uint8_t expected[16 * DST_STRIDE];
+
+    for (int32_t i = 0; i < count; ++i) {
+        int32_t width = 16 >> (rand() % 3);
+        int32_t height = 16 >> (rand() % 3);
+        int32_t xAL = (rand() % (PIC_WIDTH / 4)) * 4;
+        int32_t yAL = (rand() % (PIC_HEIGHT / 4)) * 4;
+        int16_t mv[2] = {random_mv(4 * (PIC_WIDTH + 64)), random_mv(4 * (PIC_HEIGHT + 64))};
+
+        mc_luma(funcs, dst, DST_STRIDE, luma->plane, luma->stride, PIC_WIDTH, PIC_HEIGHT, xAL, yAL, mv, width, height);
+        for (int32_t y = 0; y < height; ++y) {
+            for (int32_t x = 0; x < width; ++x) {
+                expected[y * DST_STRIDE + x] = (uint8_t)luma_sample(luma, xAL + x + (mv[0] >> 2), yAL + y + (mv[1] >> 2), mv[0] & 3, mv[1] & 3);
+            }
+        }
+        if (compare_block("luma clipping", expected, dst, width, height, mv) < 0) {
+            return -1;
+        }
+
+        int32_t xAC = xAL / 2;
+        int32_t yAC = yAL / 2;
+        mc_chroma(funcs, dst, DST_STRIDE, chroma->plane, chroma->stride, PIC_WIDTH / 2, PIC_HEIGHT / 2, xAC, yAC, mv, 2, width / 2, height / 2);
+        for (int32_t y = 0; y < height / 2; ++y) {
+            for (int32_t x = 0; x < width / 2; ++x) {
+                expected[y * DST_STRIDE + x] = (uint8_t)chroma_sample(chroma, xAC + x + (mv[0] >> 3), yAC + y + (mv[1] >> 3), mv[0] & 7, mv[1] & 7);
+            }
+        }
+        if (compare_block("chroma clipping", expected, dst, width / 2, height / 2, mv) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int compare_tables(const InterPredFuncs *ref, const InterPredFuncs *test, const TestPlane *luma, const TestPlane *chroma, int32_t count) {
+    uint8_t ref_dst[16 * DST_STRIDE];
+    uint8_t test_dst[16 * DST_STRIDE];
+
+    for (int32_t i = 0; i < count; ++i) {
+        int32_t width = 16 >> (rand() % 3);
+        int32_t height = 16 >> (rand() % 3);
+        int32_t xAL = (rand() % (PIC_WIDTH / 4)) * 4;
+        int32_t yAL = (rand() % (PIC_HEIGHT / 4)) * 4;
+        /* most vectors point into the picture, some far outside */
+        int32_t range = (i & 7) ? 64 : 4 * (PIC_WIDTH + 64);
+        int16_t mv[2] = {random_mv(range), random_mv(range)};
+
+        memset(ref_dst, 0, sizeof(ref_dst));
+        memset(test_dst, 0, sizeof(test_dst));
+        mc_luma(ref, ref_dst, DST_STRIDE, luma->plane, luma->stride, PIC_WIDTH, PIC_HEIGHT, xAL, yAL, mv, width, height);
+        mc_luma(test, test_dst, DST_STRIDE, luma->plane, luma->stride, PIC_WIDTH, PIC_HEIGHT, xAL, yAL, mv, width, height);
+        if (compare_block("luma", ref_dst, test_dst, width, height, mv) < 0) {
+            return -1;
+        }
+
+        /* 4:2:0 and 4:2:2 */
+        for (int32_t SubHeightC = 1; SubHeightC <= 2; ++SubHeightC) {
+            int32_t height_c = height / SubHeightC;
+            mc_chroma(ref, ref_dst, DST_STRIDE, chroma->plane, chroma->stride, PIC_WIDTH / 2, PIC_HEIGHT / 2, xAL / 2, yAL / SubHeightC, mv, SubHeightC, width / 2,
+                      height_c);
+            mc_chroma(test, test_dst, DST_STRIDE, chroma->plane, chroma->stride, PIC_WIDTH / 2, PIC_HEIGHT / 2, xAL / 2, yAL / SubHeightC, mv, SubHeightC, width / 2,
+                      height_c);
+            if (compare_block("chroma", ref_dst, test_dst, width / 2, height_c, mv) < 0) {
+                return -1;
+            }
+        }
+
+        /* the weighting of one prediction and of two predictions, widths 16 to 2 */
+        uint8_t pred1[16 * DST_STRIDE];
+        int32_t weight_width = 16 >> (rand() % 4);
+        int32_t logWD = rand() % 8;
+        int32_t w0 = rand() % 256 - 128;
+        int32_t w1 = rand() % 256 - 128;
+        int32_t o = rand() % 256 - 128;
+        int32_t w = weight_width == 16 ? 0 : (weight_width == 8 ? 1 : (weight_width == 4 ? 2 : 3));
+        for (int32_t k = 0; k < 16 * DST_STRIDE; ++k) {
+            ref_dst[k] = test_dst[k] = (uint8_t)(rand() & 255);
+            pred1[k] = (uint8_t)(rand() & 255);
+        }
+        ref->weight[w](ref_dst, DST_STRIDE, height, logWD, w0, o);
+        test->weight[w](test_dst, DST_STRIDE, height, logWD, w0, o);
+        if (compare_block("weight", ref_dst, test_dst, weight_width, height, mv) < 0) {
+            return -1;
+        }
+        ref->biweight[w](ref_dst, DST_STRIDE, pred1, DST_STRIDE, height, logWD, w0, w1, o);
+        test->biweight[w](test_dst, DST_STRIDE, pred1, DST_STRIDE, height, logWD, w0, w1, o);
+        if (compare_block("biweight", ref_dst, test_dst, weight_width, height, mv) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief the 10-bit kernels on the padded 10-bit planes give the samples of the clipped sample positions, and the weighting gives the values of equation 8-270
+ */
+static int check_clipping_10bit(const InterPredFuncs *funcs, const TestPlane *luma, const TestPlane *chroma, int32_t count) {
+    uint16_t dst[16 * DST_STRIDE];
+    int32_t err_code = 0;
+
+    g_pixel_max = 1023;
+    for (int32_t i = 0; i < count && !err_code; ++i) {
+        int32_t width = 16 >> (rand() % 3);
+        int32_t height = 16 >> (rand() % 3);
+        int32_t xAL = (rand() % (PIC_WIDTH / 4)) * 4;
+        int32_t yAL = (rand() % (PIC_HEIGHT / 4)) * 4;
+        int16_t mv[2] = {random_mv(4 * (PIC_WIDTH + 64)), random_mv(4 * (PIC_HEIGHT + 64))};
+
+        mc_luma16(funcs, dst, DST_STRIDE, luma->plane16, luma->stride, PIC_WIDTH, PIC_HEIGHT, xAL, yAL, mv, width, height);
+        for (int32_t y = 0; y < height && !err_code; ++y) {
+            for (int32_t x = 0; x < width; ++x) {
+                int32_t expected = luma_sample(luma, xAL + x + (mv[0] >> 2), yAL + y + (mv[1] >> 2), mv[0] & 3, mv[1] & 3);
+                if (dst[y * DST_STRIDE + x] != expected) {
+                    fprintf(stderr, "10-bit luma %dx%d mv (%d, %d) mismatch at (%d, %d): %d != %d\n", width, height, mv[0], mv[1], x, y, dst[y * DST_STRIDE + x], expected);
+                    err_code = -1;
+                    break;
+                }
+            }
+        }
+
+        int32_t xAC = xAL / 2;
+        int32_t yAC = yAL / 2;
+        mc_chroma16(funcs, dst, DST_STRIDE, chroma->plane16, chroma->stride, PIC_WIDTH / 2, PIC_HEIGHT / 2, xAC, yAC, mv, 2, width / 2, height / 2);
+        for (int32_t y = 0; y < height / 2 && !err_code; ++y) {
+            for (int32_t x = 0; x < width / 2; ++x) {
+                int32_t expected = chroma_sample(chroma, xAC + x + (mv[0] >> 3), yAC + y + (mv[1] >> 3), mv[0] & 7, mv[1] & 7);
+                if (dst[y * DST_STRIDE + x] != expected) {
+                    fprintf(stderr, "10-bit chroma mv (%d, %d) mismatch at (%d, %d): %d != %d\n", mv[0], mv[1], x, y, dst[y * DST_STRIDE + x], expected);
+                    err_code = -1;
+                    break;
+                }
+            }
+        }
+
+        /* the offsets of the 10-bit samples are scaled by 4 */
+        int32_t logWD = rand() % 8;
+        int32_t w0 = rand() % 256 - 128;
+        int32_t o = (rand() % 256 - 128) * 4;
+        int32_t rounding = logWD >= 1 ? 1 << (logWD - 1) : 0;
+        uint16_t src[16];
+        for (int32_t x = 0; x < 16; ++x) {
+            src[x] = dst[x] = (uint16_t)(rand() & 1023);
+        }
+        funcs->weight[0]((uint8_t *)dst, DST_STRIDE, 1, logWD, w0, o);
+        for (int32_t x = 0; x < 16 && !err_code; ++x) {
+            int32_t expected = clip1(((src[x] * w0 + rounding) >> logWD) + o);
+            if (dst[x] != expected) {
+                fprintf(stderr, "10-bit weight mismatch at %d: %d != %d\n", x, dst[x], expected);
+                err_code = -1;
+            }
+        }
+    }
+    g_pixel_max = 255;
+
+    return err_code;
+}
+
+/**
+ * @brief the implicit weights of equations 8-293 to 8-295 for a few reference picture distances
+ */
+static int check_implicit_weights(void) {
+    static PredWeights weights;
+    const int32_t poc_l0[3] = {0, 0, 6};
+    const int32_t poc_l1[2] = {8, 0};
+    const uint8_t long_term_l0[3] = {0, 1, 0};
+    const uint8_t long_term_l1[2] = {0, 0};
+    /* currPicOrField 2: the distances 2 of 8 give w1 16, a long-term picture and equal POCs give 32, the extrapolation beyond w1 -64 gives 32 */
+    const int16_t expected[3][2] = {{16, 32}, {32, 32}, {32, 42}};
+
+    derivation_for_implicit_weights(&weights, 0, 2, poc_l0, long_term_l0, 3, poc_l1, long_term_l1, 2);
+    for (int32_t i = 0; i < 3; ++i) {
+        for (int32_t j = 0; j < 2; ++j) {
+            if (weights.implicit_w1[0][i][j] != expected[i][j]) {
+                fprintf(stderr, "implicit weight (%d, %d): %d != %d\n", i, j, weights.implicit_w1[0][i][j], expected[i][j]);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t block_count = 100000;
+    int32_t rounds = 20;
+    TestPlane luma = {0};
+    TestPlane chroma = {0};
+    TestPlane luma16 = {0};
+    TestPlane chroma16 = {0};
+    int16_t *mvs = 0;
+    uint8_t dst[16 * DST_STRIDE];
+    const int32_t levels[3] = {H264_CPU_SSE2, H264_CPU_SSE2 | H264_CPU_SSSE3, H264_CPU_SSE2 | H264_CPU_SSSE3 | H264_CPU_AVX2};
+    const char *level_names[3] = {"SSE2", "SSSE3", "AVX2"};
+    int32_t cpu_flags = get_cpu_flags();
+
+    if (argc > 1) {
+        block_count = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        rounds = atoi(argv[2]);
+    }
+    if (block_count <= 0 || rounds <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    srand(1234);
+    if (alloc_plane(&luma, PIC_WIDTH, PIC_HEIGHT, H264_MC_LUMA_BORDER) < 0 || alloc_plane(&chroma, PIC_WIDTH / 2, PIC_HEIGHT / 2, H264_MC_CHROMA_BORDER) < 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+
+    /* verify */
+    InterPredFuncs ref;
+    init_inter_pred_funcs(&ref, 8, 0);
+    if (check_implicit_weights() < 0) {
+        goto exit_flag;
+    }
+    if (check_clipping(&ref, &luma, &chroma, block_count / 10) < 0) {
+        fprintf(stderr, "scalar: interpolation mismatch\n");
+        goto exit_flag;
+    }
+
+    for (int32_t level = 0; level < 3; ++level) {
+        if ((cpu_flags & levels[level]) != levels[level]) {
+            printf("inter pred: %s not supported, skipped\n", level_names[level]);
+            continue;
+        }
+
+        InterPredFuncs test;
+        init_inter_pred_funcs(&test, 8, levels[level]);
+        if (compare_tables(&ref, &test, &luma, &chroma, block_count) < 0) {
+            fprintf(stderr, "%s: mismatch\n", level_names[level]);
+            goto exit_flag;
+        }
+        printf("inter pred: %s, %d blocks verified\n", level_names[level], block_count);
+    }
+
+    InterPredFuncs funcs10;
+    init_inter_pred_funcs(&funcs10, 10, cpu_flags);
+    if (alloc_plane16(&luma16, PIC_WIDTH, PIC_HEIGHT, H264_MC_LUMA_BORDER) < 0 || alloc_plane16(&chroma16, PIC_WIDTH / 2, PIC_HEIGHT / 2, H264_MC_CHROMA_BORDER) < 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    if (check_clipping_10bit(&funcs10, &luma16, &chroma16, block_count / 10) < 0) {
+        fprintf(stderr, "10-bit: interpolation mismatch\n");
+        goto exit_flag;
+    }
+    printf("inter pred: 10-bit, %d blocks verified\n", block_count / 10);
+
+    /* benchmark, 16x16 luma blocks at random quarter sample motion vectors */
+    mvs = (int16_t *)malloc(sizeof(int16_t) * 2 * block_count);
+    if (!mvs) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    for (int32_t i = 0; i < 2 * block_count; ++i) {
+        mvs[i] = random_mv(64);
+    }
+
+    InterPredFuncs funcs;
+    init_inter_pred_funcs(&funcs, 8, cpu_flags);
+
+    const InterPredFuncs *tables[2] = {&ref, &funcs};
+    double mbs_per_second[2] = {0, 0};
+    for (int32_t t = 0; t < 2; ++t) {
+        clock_t begin = clock();
+        for (int32_t round = 0; round < rounds; ++round) {
+            for (int32_t i = 0; i < block_count; ++i) {
+                int32_t xAL = (i % (PIC_WIDTH / 16)) * 16;
+                int32_t yAL = (i / (PIC_WIDTH / 16) % (PIC_HEIGHT / 16)) * 16;
+                mc_luma(tables[t], dst, DST_STRIDE, luma.plane, luma.stride, PIC_WIDTH, PIC_HEIGHT, xAL, yAL, mvs + 2 * i, 16, 16);
+            }
+        }
+        double seconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+        mbs_per_second[t] = seconds > 0 ? (double)block_count * rounds / seconds / 1e6 : 0;
+    }
+    printf("inter pred: luma 16x16 scalar %.2f MMB/s, selected %.2f MMB/s\n", mbs_per_second[0], mbs_per_second[1]);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (mvs) {
+        free(mvs);
+    }
+    if (luma.buffer) {
+        free(luma.buffer);
+    }
+    if (chroma.buffer) {
+        free(chroma.buffer);
+    }
+    if (luma16.buffer16) {
+        free(luma16.buffer16);
+    }
+    if (chroma16.buffer16) {
+        free(chroma16.buffer16);
+    }
+
+    return exit_code;
+}
@@ -0,0 +1,231 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_cpu.h"
+#include "h264decoder/h264_intra_pred.h"
+
+/*
+ * intra prediction test: compares every kernel of the function table selected for each instruction set level supported by the CPU with the scalar reference
+ * kernels on random neighbouring samples and availability flags, checks the 10-bit kernels against the 8-bit kernels on the 8-bit samples and on saturated samples,
+ * then reports the predicted 16x16 macroblocks per second of every Intra_16x16 mode.
+ *
+ * usage: test_h264_intra_pred [sample sets] [rounds]
+ */
+
+#define DST_STRIDE 32
+
+static void random_samples(IntraPredSamples *samples) {
+    /* a quarter of the sets are flat or extreme to exercise the clipping of the plane modes */
+    int32_t kind = rand() & 7;
+    for (int32_t i = 0; i < 16; ++i) {
+        samples->top[i] = (uint8_t)(kind == 0 ? 255 * (i & 1) : (kind == 1 ? 255 - i * 17 : rand() & 255));
+        samples->left[i] = (uint8_t)(kind == 0 ? 255 * (~i & 1) : (kind == 1 ? i * 17 : rand() & 255));
+    }
+    samples->top_left = (uint8_t)(rand() & 255);
+    samples->available = (uint8_t)(rand() & 15);
+}
+
+static int compare_kernel(const char *name, int32_t mode, intra_pred_func ref, intra_pred_func test, const IntraPredSamples *samples, int32_t width, int32_t height) {
+    uint8_t ref_dst[16 * DST_STRIDE];
+    uint8_t test_dst[16 * DST_STRIDE];
+
+    memset(ref_dst, 0xAA, sizeof(ref_dst));
+    memset(test_dst, 0xAA, sizeof(test_dst));
+    ref(ref_dst, DST_STRIDE, samples);
+    test(test_dst, DST_STRIDE, samples);
+
+    for (int32_t y = 0; y < height; ++y) {
+        for (int32_t x = 0; x < DST_STRIDE; ++x) {
+            if (ref_dst[y * DST_STRIDE + x] != test_dst[y * DST_STRIDE + x]) {
+                fprintf(stderr, "%s mode %d mismatch at (%d, %d): %d != %d, width %d\n", name, mode, x, y, test_dst[y * DST_STRIDE + x], ref_dst[y * DST_STRIDE + x], width);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int compare_funcs(const IntraPredFuncs *ref, const IntraPredFuncs *test, const IntraPredSamples *samples) {
+    for (int32_t mode = 0; mode < 9; ++mode) {
+        if (compare_kernel("Intra_4x4", mode, ref->pred4x4[mode], test->pred4x4[mode], samples, 4, 4) < 0 ||
+            compare_kernel("Intra_8x8", mode, ref->pred8x8[mode], test->pred8x8[mode], samples, 8, 8) < 0) {
+            return -1;
+        }
+    }
+    for (int32_t mode = 0; mode < 4; ++mode) {
+        if (compare_kernel("Intra_16x16", mode, ref->pred16x16[mode], test->pred16x16[mode], samples, 16, 16) < 0 ||
+            compare_kernel("Intra_Chroma 4:2:0", mode, ref->pred_chroma[0][mode], test->pred_chroma[0][mode], samples, 8, 8) < 0 ||
+            compare_kernel("Intra_Chroma 4:2:2", mode, ref->pred_chroma[1][mode], test->pred_chroma[1][mode], samples, 8, 16) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * the 10-bit kernels predict the same values as the 8-bit kernels from the 8-bit samples except the values which the 8-bit kernels clip to 255. every sample is
+ * available, the 8-bit and 10-bit kernels substitute different values for the missing samples
+ */
+static int compare_kernel_10bit(const char *name, int32_t mode, intra_pred_func ref, intra_pred_func test, const IntraPredSamples *samples, int32_t width, int32_t height) {
+    uint8_t ref_dst[16 * DST_STRIDE];
+    uint16_t test_dst[16 * DST_STRIDE];
+    IntraPredSamples samples8 = *samples;
+    IntraPredSamples16 samples16;
+
+    samples8.available = H264_INTRA_AVAIL_LEFT | H264_INTRA_AVAIL_TOP | H264_INTRA_AVAIL_TOP_RIGHT | H264_INTRA_AVAIL_TOP_LEFT;
+    for (int32_t i = 0; i < 16; ++i) {
+        samples16.top[i] = samples8.top[i];
+        samples16.left[i] = samples8.left[i];
+    }
+    samples16.top_left = samples8.top_left;
+    samples16.available = samples8.available;
+
+    ref(ref_dst, DST_STRIDE, &samples8);
+    test((uint8_t *)test_dst, DST_STRIDE, (const IntraPredSamples *)&samples16);
+
+    for (int32_t y = 0; y < height; ++y) {
+        for (int32_t x = 0; x < width; ++x) {
+            int32_t value = test_dst[y * DST_STRIDE + x];
+            if ((value > 255 ? 255 : value) != ref_dst[y * DST_STRIDE + x]) {
+                fprintf(stderr, "%s mode %d 10-bit mismatch at (%d, %d): %d != %d\n", name, mode, x, y, value, ref_dst[y * DST_STRIDE + x]);
+                return -1;
+            }
+        }
+    }
+
+    /* the saturated samples predict the saturated value in every mode */
+    for (int32_t i = 0; i < 16; ++i) {
+        samples16.top[i] = samples16.left[i] = 1023;
+    }
+    samples16.top_left = 1023;
+    test((uint8_t *)test_dst, DST_STRIDE, (const IntraPredSamples *)&samples16);
+
+    for (int32_t y = 0; y < height; ++y) {
+        for (int32_t x = 0; x < width; ++x) {
+            if (test_dst[y * DST_STRIDE + x] != 1023) {
+                fprintf(stderr, "%s mode %d 10-bit saturation at (%d, %d): %d\n", name, mode, x, y, test_dst[y * DST_STRIDE + x]);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int compare_funcs_10bit(const IntraPredFuncs *ref, const IntraPredFuncs *test, const IntraPredSamples *samples) {
+    for (int32_t mode = 0; mode < 9; ++mode) {
+        if (compare_kernel_10bit("Intra_4x4", mode, ref->pred4x4[mode], test->pred4x4[mode], samples, 4, 4) < 0 ||
+            compare_kernel_10bit("Intra_8x8", mode, ref->pred8x8[mode], test->pred8x8[mode], samples, 8, 8) < 0) {
+            return -1;
+        }
+    }
+    for (int32_t mode = 0; mode < 4; ++mode) {
+        if (compare_kernel_10bit("Intra_16x16", mode, ref->pred16x16[mode], test->pred16x16[mode], samples, 16, 16) < 0 ||
+            compare_kernel_10bit("Intra_Chroma 4:2:0", mode, ref->pred_chroma[0][mode], test->pred_chroma[0][mode], samples, 8, 8) < 0 ||
+            compare_kernel_10bit("Intra_Chroma 4:2:2", mode, ref->pred_chroma[1][mode], test->pred_chroma[1][mode], samples, 8, 16) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t set_count = 20000;
+    int32_t rounds = 200;
+    IntraPredSamples *sets = 0;
+    const int32_t levels[3] = {H264_CPU_SSE2, H264_CPU_SSE2 | H264_CPU_SSSE3, H264_CPU_SSE2 | H264_CPU_SSSE3 | H264_CPU_AVX2};
+    const char *level_names[3] = {"SSE2", "SSSE3", "AVX2"};
+    int32_t cpu_flags = get_cpu_flags();
+
+    if (argc > 1) {
+        set_count = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        rounds = atoi(argv[2]);
+    }
+    if (set_count <= 0 || rounds <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    sets = (IntraPredSamples *)malloc(sizeof(IntraPredSamples) * set_count);
+    if (!sets) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+
+    srand(1234);
+    for (int32_t i = 0; i < set_count; ++i) {
+        random_samples(&sets[i]);
+    }
+
+    /* verify */
+    IntraPredFuncs ref;
+    init_intra_pred_funcs(&ref, 8, 0);
+
+    for (int32_t level = 0; level < 3; ++level) {
+        if ((cpu_flags & levels[level]) != levels[level]) {
+            printf("intra prediction: %s not supported, skipped\n", level_names[level]);
+            continue;
+        }
+
+        IntraPredFuncs test;
+        init_intra_pred_funcs(&test, 8, levels[level]);
+        for (int32_t i = 0; i < set_count; ++i) {
+            if (compare_funcs(&ref, &test, &sets[i]) < 0) {
+                fprintf(stderr, "%s: sample set %d mismatch\n", level_names[level], i);
+                goto exit_flag;
+            }
+        }
+        printf("intra prediction: %s, %d sample sets verified\n", level_names[level], set_count);
+    }
+
+    IntraPredFuncs funcs10;
+    init_intra_pred_funcs(&funcs10, 10, cpu_flags);
+    for (int32_t i = 0; i < set_count; ++i) {
+        if (compare_funcs_10bit(&ref, &funcs10, &sets[i]) < 0) {
+            fprintf(stderr, "10-bit: sample set %d mismatch\n", i);
+            goto exit_flag;
+        }
+    }
+    printf("intra prediction: 10-bit, %d sample sets verified\n", set_count);
+
+    /* benchmark */
+    IntraPredFuncs funcs;
+    init_intra_pred_funcs(&funcs, 8, cpu_flags);
+
+    const char *mode_names[4] = {"Vertical", "Horizontal", "DC", "Plane"};
+    uint8_t dst[16 * DST_STRIDE];
+    for (int32_t mode = 0; mode < 4; ++mode) {
+        const IntraPredFuncs *tables[2] = {&ref, &funcs};
+        double mbs_per_second[2] = {0, 0};
+
+        for (int32_t t = 0; t < 2; ++t) {
+            clock_t begin = clock();
+            for (int32_t round = 0; round < rounds; ++round) {
+                for (int32_t i = 0; i < set_count; ++i) {
+                    tables[t]->pred16x16[mode](dst, DST_STRIDE, &sets[i]);
+                }
+            }
+            double seconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+            mbs_per_second[t] = seconds > 0 ? (double)set_count * rounds / seconds / 1e6 : 0;
+        }
+        printf("Intra_16x16_%s: scalar %.2f MMB/s, selected %.2f MMB/s\n", mode_names[mode], mbs_per_second[0], mbs_per_second[1]);
+    }
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (sets) {
+        free(sets);
+    }
+
+    return exit_code;
+}
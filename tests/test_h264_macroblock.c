@@ -0,0 +1,379 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_picture.h"
+#include "h264decoder/h264_rbsp.h"
+
+/*
+ * macroblock test: parses an I_PCM macroblock with macroblock_layer and checks that its samples land in the scratch area shared by the macroblocks while the
+ * compact record keeps TotalCoeff 16 saturated to 15 and every block marked as coded, then parses the residual of the macroblock to its right with the nC
+ * derived from the saturated TotalCoeff. checks the macroblock type table against the tables of clause 7.4.5. then parses rows of 64 I_PCM macroblocks and
+ * reports the macroblocks per second.
+ *
+ * usage: test_h264_macroblock [rounds]
+ */
+
+#define MB_PCM_BITS (9 + 7 + 384 * 8)
+
+typedef struct {
+    uint8_t *buffer;
+    size_t capacity;
+    size_t bit_pos;
+} BitWriter;
+
+/* the scratch which the macroblocks are parsed into, slice_data() attaches the one of the decoding thread instead */
+static MacroBlockScratch g_scratch;
+
+static void write_bits(BitWriter *writer, uint32_t value, int n) {
+    for (int i = n - 1; i >= 0; --i) {
+        size_t byte_pos = writer->bit_pos >> 3;
+        if (byte_pos >= writer->capacity) {
+            return;
+        }
+        if ((value >> i) & 0x01) {
+            writer->buffer[byte_pos] |= (uint8_t)(0x80 >> (writer->bit_pos & 0x07));
+        }
+        writer->bit_pos++;
+    }
+}
+
+static void init_reader(RBSPReader *reader, const BitWriter *writer) {
+    reader->start = writer->buffer;
+    reader->end = writer->buffer + ((writer->bit_pos + 7) >> 3);
+    reader->current = reader->start;
+    reader->bits_left = 8;
+}
+
+/**
+ * @brief write an I_PCM macroblock of an I slice, mb_type ue(v) 25, the alignment bits and the 384 samples of 4:2:0 8-bit, the sample i is i * 7 + seed
+ */
+static void write_pcm_macroblock(BitWriter *writer, uint32_t seed) {
+    write_bits(writer, 26, 9);
+    write_bits(writer, 0, 7);
+    for (uint32_t i = 0; i < 384; ++i) {
+        write_bits(writer, (i * 7 + seed) & 0xFF, 8);
+    }
+}
+
+/**
+ * @brief set the fields of the slice header, sps and pps which the macroblock parsing reads for a CAVLC I slice of 2x1 macroblocks
+ */
+static void set_test_header(SliceHeader *header, SPS *sps, PPS *pps) {
+    memset(sps, 0, sizeof(SPS));
+    memset(pps, 0, sizeof(PPS));
+    memset(header, 0, sizeof(SliceHeader));
+    sps->PicWidthInMbs = 2;
+    sps->FrameHeightInMbs = 1;
+    sps->ChromaArrayType = 1;
+    sps->chroma_format_idc = 1;
+    sps->BitDepthY = 8;
+    sps->BitDepthC = 8;
+    sps->SubWidthC = 2;
+    sps->SubHeightC = 2;
+    sps->MbWidthC = 8;
+    sps->MbHeightC = 8;
+    header->slice_type = SLICE_TYPE_I;
+    header->PicSizeInMbs = 2;
+    header->sps = sps;
+    header->pps = pps;
+}
+
+static int check_pcm_macroblock() {
+    int ret = -1;
+    uint8_t buffer[512];
+    BitWriter writer = {buffer, sizeof(buffer), 0};
+    SPS sps;
+    PPS pps;
+    SliceHeader header;
+    RBSPReader reader;
+    FrameOrField *ff = create_frame_or_field();
+
+    /* the record is read by every neighbour lookup, it is kept within a cache line */
+    if (sizeof(MacroBlock) > 64) {
+        fprintf(stderr, "macroblock: the record is %zu bytes\n", sizeof(MacroBlock));
+        goto exit_flag;
+    }
+
+    set_test_header(&header, &sps, &pps);
+    if (!ff || alloc_frame_or_field(ff, 2) < 0) {
+        fprintf(stderr, "macroblock: frame allocation failed\n");
+        goto exit_flag;
+    }
+    ff->mb_scratch = &g_scratch;
+    ff->mb_slice_ids[0] = 0;
+    ff->mb_slice_ids[1] = 0;
+
+    memset(buffer, 0, sizeof(buffer));
+    write_pcm_macroblock(&writer, 3);
+    init_reader(&reader, &writer);
+
+    int err_code = macroblock_layer(&reader, ff, &header, 0, 0);
+    if (err_code < 0 || reader.current - reader.start != MB_PCM_BITS / 8) {
+        fprintf(stderr, "macroblock: I_PCM parsing failed, error code: %d\n", err_code);
+        goto exit_flag;
+    }
+
+    MacroBlock *mb = &ff->mb_list[0];
+    MacroBlockScratch *scratch = ff->mb_scratch;
+    for (uint32_t i = 0; i < 384; ++i) {
+        uint32_t sample = i < 256 ? scratch->pcm_sample_luma[i] : scratch->pcm_sample_chroma[i - 256];
+        if (sample != ((i * 7 + 3) & 0xFF)) {
+            fprintf(stderr, "macroblock: pcm sample %u is %u\n", i, sample);
+            goto exit_flag;
+        }
+    }
+
+    /* 9.2.1: nN of I_PCM is 16, it is stored as 15 which selects the same table */
+    for (int32_t iComp = 0; iComp < 3; ++iComp) {
+        for (int32_t blkIdx = 0; blkIdx < 16; ++blkIdx) {
+            if (mb_total_coeff(mb, iComp, blkIdx) != 15) {
+                fprintf(stderr, "macroblock: TotalCoeff of the block %d of the component %d is %d\n", blkIdx, iComp, mb_total_coeff(mb, iComp, blkIdx));
+                goto exit_flag;
+            }
+        }
+    }
+    if (ff->mb_type_names[0] != I_PCM || mb->coded_block_flags != 0xFFFFFFFFu || mb->coded_block_flags_dc != (H264_CBF_DC_LUMA | H264_CBF_DC_CB | H264_CBF_DC_CR) ||
+        ff->ref_idxs[0][0] != -1 || ff->ref_idxs[1][15] != -1) {
+        fprintf(stderr, "macroblock: I_PCM record mismatch\n");
+        goto exit_flag;
+    }
+
+    /**
+     * the Intra_4x4 macroblock right of it codes the luma 8x8 block 0 only, with the blocks 0 to 3 all empty. the block 0 has nC = nA = 15 and the block 2 has
+     * nC = ( 15 + 0 + 1 ) >> 1 = 8, both read the 6-bit fixed length coeff_token 000011, the blocks 1 and 3 have nC 0 and read the 1-bit coeff_token 1
+     */
+    MacroBlock *right = &ff->mb_list[1];
+    right->mb_pred_type = Intra_4x4;
+    right->CodedBlockPatternLuma = 1;
+    right->CodedBlockPatternChroma = 0;
+
+    memset(buffer, 0, sizeof(buffer));
+    writer.bit_pos = 0;
+    write_bits(&writer, 3, 6);
+    write_bits(&writer, 1, 1);
+    write_bits(&writer, 3, 6);
+    write_bits(&writer, 1, 1);
+    write_bits(&writer, 0x5, 3);
+    init_reader(&reader, &writer);
+
+    err_code = residual(&reader, ff, right, &header, 0, 1, 0, 15);
+    if (err_code < 0 || read_u(&reader, 3) != 0x5 || right->coded_block_flags != 0 || right->total_coeff[0] != 0) {
+        fprintf(stderr, "macroblock: the residual right of I_PCM is misparsed, error code: %d\n", err_code);
+        goto exit_flag;
+    }
+
+    ret = 0;
+    printf("macroblock: %zu bytes record, I_PCM samples in the scratch and the saturated TotalCoeff verified\n", sizeof(MacroBlock));
+
+exit_flag:
+    if (ff) {
+        free_frame_or_field(ff);
+    }
+    return ret;
+}
+
+/* the prediction modes of the two partitions of the mb_type 4 to 21 of Table 7-14, the even mb_type is 16x8 and the odd one is 8x16 */
+static const uint8_t g_b_part_modes[9][2] = {
+    {Pred_L0, Pred_L0}, {Pred_L1, Pred_L1}, {Pred_L0, Pred_L1}, {Pred_L1, Pred_L0}, {Pred_L0, BiPred},
+    {Pred_L1, BiPred},  {BiPred, Pred_L0},  {BiPred, Pred_L1},  {BiPred, BiPred},
+};
+
+/**
+ * @brief check the entry of a macroblock or sub-macroblock type, its partition locations are InverseRasterScan( idx, width, height, 16 or 8, 0 or 1 )
+ */
+static int check_type_info(MB_TYPE_NAME name, int32_t mb_type, int32_t parts, int32_t width, int32_t height, int32_t mode0, int32_t mode1) {
+    const MB_TYPE_INFO *info = get_mb_type_info(name);
+    if (info->mb_type != mb_type || info->NumMbPart != parts || info->MbPartWidth != width || info->MbPartHeight != height || info->MbPartPredMode0 != mode0 ||
+        info->MbPartPredMode1 != mode1) {
+        fprintf(stderr, "macroblock: the type %d (mb_type %d) mismatches its table\n", name, mb_type);
+        return -1;
+    }
+
+    int32_t span = info->is_sub_mb_type ? 8 : 16;
+    for (int32_t idx = 0; width && idx < (parts > 0 ? parts : 4); ++idx) {
+        if (info->part_x[idx] != (idx % (span / width)) * width || info->part_y[idx] != (idx / (span / width)) * height) {
+            fprintf(stderr, "macroblock: the partition %d of the type %d is misplaced\n", idx, name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief check the macroblock types of the slice types against Table 7-11, Table 7-13 and Table 7-14, and the sub-macroblock types against Table 7-17 and
+ * Table 7-18
+ */
+static int check_mb_type_tables() {
+    MB_TYPE_NAME name;
+    H264_MB_PART_PRED_MODE mode;
+    int32_t luma;
+    int32_t chroma;
+    int32_t num;
+
+    /* Table 7-11: I_NxN, I_16x16_<Intra16x16PredMode>_<CodedBlockPatternChroma>_<CodedBlockPatternLuma> and I_PCM */
+    for (int32_t mb_type = 0; mb_type < 26; ++mb_type) {
+        if (get_mb_type_name(SLICE_TYPE_I, mb_type, &name) < 0 || (int32_t)name != I_NxN + mb_type) {
+            fprintf(stderr, "macroblock: I mb_type %d has no name\n", mb_type);
+            return -1;
+        }
+        const MB_TYPE_INFO *info = get_mb_type_info(name);
+        int32_t is_16x16 = mb_type >= 1 && mb_type <= 24;
+        int32_t pred_mode = is_16x16 ? Intra_16x16 : (mb_type == 0 ? Intra_4x4 : Intra_NA);
+        CodedBlockPatternLumaChroma(SLICE_TYPE_I, mb_type, &luma, &chroma);
+        NumMbPart(SLICE_TYPE_I, mb_type, &num);
+        if (check_type_info(name, mb_type, -1, 0, 0, pred_mode, Pred_NA) < 0 || info->Intra16x16PredMode != (is_16x16 ? (mb_type - 1) % 4 : -1) ||
+            chroma != (is_16x16 ? (mb_type - 1) / 4 % 3 : 0) || luma != (mb_type >= 13 && is_16x16 ? 15 : 0) || num != 0) {
+            fprintf(stderr, "macroblock: I mb_type %d mismatches Table 7-11\n", mb_type);
+            return -1;
+        }
+    }
+    if (MbPartPredMode(SLICE_TYPE_I, 1, 0, 0, &name, &mode) < 0 || mode != Intra_8x8 || MbPartPredMode(SLICE_TYPE_I, 1, 1, 0, &name, &mode) < 0 ||
+        mode != Intra_16x16 || get_mb_type_name(SLICE_TYPE_I, 26, &name) >= 0 || get_mb_type_name(SLICE_TYPE_SI, 0, &name) < 0 || name != SI_SI) {
+        fprintf(stderr, "macroblock: the I_NxN prediction mode or the I mb_type range mismatches\n");
+        return -1;
+    }
+
+    /* Table 7-13 and the inferred P_Skip */
+    static const int8_t p_types[6][5] = {
+        {1, 16, 16, Pred_L0, Pred_NA}, {2, 16, 8, Pred_L0, Pred_L0}, {2, 8, 16, Pred_L0, Pred_L0},
+        {4, 8, 8, Pred_NA, Pred_NA},   {4, 8, 8, Pred_NA, Pred_NA},  {1, 16, 16, Pred_L0, Pred_NA},
+    };
+    for (int32_t mb_type = 0; mb_type < 6; ++mb_type) {
+        const int8_t *p = p_types[mb_type];
+        NumMbPart(SLICE_TYPE_P, mb_type, &num);
+        if (get_mb_type_name(SLICE_TYPE_P + 5, mb_type, &name) < 0 || (int32_t)name != P_L0_16x16 + mb_type || num != p[0] ||
+            check_type_info(name, mb_type, p[0], p[1], p[2], p[3], p[4]) < 0) {
+            fprintf(stderr, "macroblock: P mb_type %d mismatches Table 7-13\n", mb_type);
+            return -1;
+        }
+    }
+    if (get_mb_type_name(SLICE_TYPE_P, 6, &name) >= 0 || get_mb_type_name(SLICE_TYPE_SP, 3, &name) < 0 || name != P_8x8) {
+        fprintf(stderr, "macroblock: the P mb_type range mismatches\n");
+        return -1;
+    }
+
+    /* Table 7-14: B_Direct_16x16 is predicted in 8x8 blocks, 3 types of one 16x16 partition, 18 types of two, B_8x8 and the inferred B_Skip */
+    for (int32_t mb_type = 0; mb_type < 24; ++mb_type) {
+        int32_t parts = 2;
+        int32_t width = mb_type & 1 ? 8 : 16;
+        int32_t height = mb_type & 1 ? 16 : 8;
+        int32_t mode0 = 0;
+        int32_t mode1 = 0;
+        if (mb_type == 0 || mb_type == 23) {
+            parts = -1;
+            width = 8;
+            height = 8;
+            mode0 = Direct;
+            mode1 = Pred_NA;
+        } else if (mb_type <= 3) {
+            parts = 1;
+            width = 16;
+            height = 16;
+            mode0 = mb_type == 1 ? Pred_L0 : (mb_type == 2 ? Pred_L1 : BiPred);
+            mode1 = Pred_NA;
+        } else if (mb_type <= 21) {
+            mode0 = g_b_part_modes[(mb_type - 4) / 2][0];
+            mode1 = g_b_part_modes[(mb_type - 4) / 2][1];
+        } else {
+            parts = 4;
+            width = 8;
+            height = 8;
+            mode0 = Pred_NA;
+            mode1 = Pred_NA;
+        }
+        if (get_mb_type_name(SLICE_TYPE_B, mb_type, &name) < 0 || (int32_t)name != B_Direct_16x16 + mb_type ||
+            check_type_info(name, mb_type, parts, width, height, mode0, mode1) < 0) {
+            fprintf(stderr, "macroblock: B mb_type %d mismatches Table 7-14\n", mb_type);
+            return -1;
+        }
+    }
+    if (get_mb_type_name(SLICE_TYPE_B, 24, &name) >= 0) {
+        fprintf(stderr, "macroblock: the B mb_type range mismatches\n");
+        return -1;
+    }
+
+    /* Table 7-17 and Table 7-18 */
+    static const int8_t sub_types[17][4] = {
+        {1, 8, 8, Pred_L0}, {2, 8, 4, Pred_L0}, {2, 4, 8, Pred_L0}, {4, 4, 4, Pred_L0}, {4, 4, 4, Direct}, {1, 8, 8, Pred_L0},
+        {1, 8, 8, Pred_L1}, {1, 8, 8, BiPred},  {2, 8, 4, Pred_L0}, {2, 4, 8, Pred_L0}, {2, 8, 4, Pred_L1}, {2, 4, 8, Pred_L1},
+        {2, 8, 4, BiPred},  {2, 4, 8, BiPred},  {4, 4, 4, Pred_L0}, {4, 4, 4, Pred_L1}, {4, 4, 4, BiPred},
+    };
+    for (int32_t i = 0; i < 17; ++i) {
+        const int8_t *p = sub_types[i];
+        int32_t sub_mb_type = i < 4 ? i : i - 4;
+        if (!get_mb_type_info((MB_TYPE_NAME)(P_L0_8x8 + i))->is_sub_mb_type ||
+            check_type_info((MB_TYPE_NAME)(P_L0_8x8 + i), sub_mb_type, p[0], p[1], p[2], p[3], Pred_NA) < 0) {
+            fprintf(stderr, "macroblock: sub_mb_type %d mismatches Table %s\n", sub_mb_type, i < 4 ? "7-17" : "7-18");
+            return -1;
+        }
+    }
+
+    printf("macroblock: mb_type of Table 7-11, 7-13, 7-14 and sub_mb_type of Table 7-17, 7-18 verified\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t rounds = 500;
+    uint8_t *buffer = 0;
+    FrameOrField *ff = 0;
+    SPS sps;
+    PPS pps;
+    SliceHeader header;
+
+    if (argc > 1) {
+        rounds = atoi(argv[1]);
+    }
+    if (rounds <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    if (check_pcm_macroblock() < 0 || check_mb_type_tables() < 0) {
+        goto exit_flag;
+    }
+
+    /* parse a row of I_PCM macroblocks */
+    BitWriter writer = {0};
+    writer.capacity = 64 * (MB_PCM_BITS / 8) + 16;
+    buffer = (uint8_t *)malloc(writer.capacity);
+    ff = create_frame_or_field();
+    if (!buffer || !ff || alloc_frame_or_field(ff, 2) < 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    ff->mb_scratch = &g_scratch;
+    writer.buffer = buffer;
+    memset(buffer, 0, writer.capacity);
+    for (uint32_t i = 0; i < 64; ++i) {
+        write_pcm_macroblock(&writer, i);
+    }
+    set_test_header(&header, &sps, &pps);
+
+    clock_t start = clock();
+    for (int32_t round = 0; round < rounds; ++round) {
+        RBSPReader reader;
+        init_reader(&reader, &writer);
+        for (int32_t i = 0; i < 64; ++i) {
+            if (macroblock_layer(&reader, ff, &header, 0, i & 1) < 0) {
+                fprintf(stderr, "macroblock: I_PCM parsing failed\n");
+                goto exit_flag;
+            }
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("macroblock: %.2f M I_PCM macroblocks/s\n", seconds > 0 ? rounds * 64.0 / seconds / 1e6 : 0.0);
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (ff) {
+        free_frame_or_field(ff);
+    }
+    free(buffer);
+    return exit_code;
+}
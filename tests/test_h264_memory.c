@@ -0,0 +1,255 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_memory.h"
+
+/*
+ * memory budget test: charges a tree of budgets as the pictures of the contexts of a decoder group would. checks the current and peak bytes by category, that a
+ * charge over the limit is refused without being counted, that the limits of the children are reserved from the limit of the parent and checked only by the
+ * children, that the children without a limit share the unreserved room with the parent, and that the counters stay consistent when threads charge the
+ * children concurrently. then reports the charges per second.
+ *
+ * usage: test_h264_memory [charges]
+ */
+
+#define KIB ((size_t)1024)
+#define THREAD_COUNT 4
+
+typedef struct {
+    MemoryBudget *budget;
+    int32_t charges;
+    int32_t refused;
+} ChargeJob;
+
+static int check_usage(MemoryBudget *budget, const char *name, size_t total, size_t peak_total, size_t frame_buffers, uint32_t refused) {
+    MemoryUsage usage;
+    get_memory_budget_usage(budget, &usage);
+    if (usage.total != total || usage.peak_total != peak_total || usage.current[MEMORY_FRAME_BUFFERS] != frame_buffers || usage.refused != refused) {
+        fprintf(stderr, "%s: total %zu peak %zu frame buffers %zu refused %u, expected %zu %zu %zu %u\n", name, usage.total, usage.peak_total,
+                usage.current[MEMORY_FRAME_BUFFERS], usage.refused, total, peak_total, frame_buffers, refused);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief the counters of a single budget by category, and the refusal at its limit
+ */
+static int check_single_budget() {
+    MemoryBudget budget;
+    int ret = -1;
+
+    if (init_memory_budget(&budget, 0) < 0) {
+        return -1;
+    }
+
+    if (charge_memory(&budget, MEMORY_FRAME_BUFFERS, 100 * KIB) < 0 || charge_memory(&budget, MEMORY_MB_METADATA, 20 * KIB) < 0 ||
+        charge_memory(&budget, MEMORY_SCRATCH, 4 * KIB) < 0 || get_memory_room(&budget) != SIZE_MAX) {
+        fprintf(stderr, "single budget: a charge without a limit is refused\n");
+        goto exit_flag;
+    }
+    uncharge_memory(&budget, MEMORY_FRAME_BUFFERS, 100 * KIB);
+    if (check_usage(&budget, "single budget", 24 * KIB, 124 * KIB, 0, 0) < 0) {
+        goto exit_flag;
+    }
+
+    /* the limit does not fit the bytes charged already */
+    if (set_memory_budget_limit(&budget, 16 * KIB) != ERR_MEMORY_BUDGET_EXCEEDED || set_memory_budget_limit(&budget, 64 * KIB) < 0) {
+        fprintf(stderr, "single budget: the limit is not checked against the charged bytes\n");
+        goto exit_flag;
+    }
+    if (get_memory_room(&budget) != 40 * KIB || charge_memory(&budget, MEMORY_FRAME_BUFFERS, 41 * KIB) != ERR_MEMORY_BUDGET_EXCEEDED ||
+        charge_memory(&budget, MEMORY_FRAME_BUFFERS, 40 * KIB) < 0 || charge_memory(&budget, MEMORY_SCRATCH, 1) != ERR_MEMORY_BUDGET_EXCEEDED) {
+        fprintf(stderr, "single budget: the charges are not capped by the limit\n");
+        goto exit_flag;
+    }
+    if (check_usage(&budget, "single budget", 64 * KIB, 124 * KIB, 40 * KIB, 2) < 0) {
+        goto exit_flag;
+    }
+
+    /* the budget 0 counts nothing */
+    if (charge_memory(0, MEMORY_SCRATCH, 1) < 0 || get_memory_room(0) != SIZE_MAX) {
+        goto exit_flag;
+    }
+
+    uncharge_memory(&budget, MEMORY_FRAME_BUFFERS, 40 * KIB);
+    uncharge_memory(&budget, MEMORY_MB_METADATA, 20 * KIB);
+    uncharge_memory(&budget, MEMORY_SCRATCH, 4 * KIB);
+    if (check_usage(&budget, "single budget", 0, 124 * KIB, 0, 2) < 0) {
+        goto exit_flag;
+    }
+
+    printf("memory: counters and limit of a budget verified\n");
+    ret = 0;
+
+exit_flag:
+    free_memory_budget(&budget);
+    return ret;
+}
+
+/**
+ * @brief a group budget with a child reserving its limit and a child without a limit
+ */
+static int check_budget_tree() {
+    MemoryBudget group;
+    MemoryBudget reserved;
+    MemoryBudget shared;
+    MemoryBudget refused;
+    int32_t is_reserved_freed = 0;
+    int ret = -1;
+
+    if (init_memory_budget(&group, 0) < 0) {
+        return -1;
+    }
+    init_memory_budget(&reserved, &group);
+    init_memory_budget(&shared, &group);
+    init_memory_budget(&refused, &group);
+
+    /* the child reserves 60 KiB of the 100 KiB, a child whose limit does not fit the rest is refused */
+    if (set_memory_budget_limit(&group, 100 * KIB) < 0 || set_memory_budget_limit(&reserved, 60 * KIB) < 0 ||
+        set_memory_budget_limit(&refused, 41 * KIB) != ERR_MEMORY_BUDGET_EXCEEDED || get_memory_room(&shared) != 40 * KIB) {
+        fprintf(stderr, "budget tree: the limit of the child is not reserved\n");
+        goto exit_flag;
+    }
+
+    /* the child without a limit and the group share the 40 KiB which are not reserved */
+    if (charge_memory(&shared, MEMORY_FRAME_BUFFERS, 30 * KIB) < 0 || charge_memory(&group, MEMORY_FRAME_BUFFERS, 10 * KIB) < 0 ||
+        charge_memory(&shared, MEMORY_SCRATCH, 1) != ERR_MEMORY_BUDGET_EXCEEDED) {
+        fprintf(stderr, "budget tree: the unreserved room is not shared\n");
+        goto exit_flag;
+    }
+
+    /* the reserved child is checked by its own limit only */
+    if (get_memory_room(&reserved) != 60 * KIB || charge_memory(&reserved, MEMORY_FRAME_BUFFERS, 60 * KIB) < 0 ||
+        charge_memory(&reserved, MEMORY_MB_METADATA, 1) != ERR_MEMORY_BUDGET_EXCEEDED) {
+        fprintf(stderr, "budget tree: the reserved child is not checked by its limit\n");
+        goto exit_flag;
+    }
+    if (check_usage(&group, "budget tree group", 100 * KIB, 100 * KIB, 100 * KIB, 2) < 0 ||
+        check_usage(&reserved, "budget tree child", 60 * KIB, 60 * KIB, 60 * KIB, 1) < 0) {
+        goto exit_flag;
+    }
+
+    /* the limit of the group does not drop below the reservations, and the child gives its reservation back when its limit is removed */
+    uncharge_memory(&shared, MEMORY_FRAME_BUFFERS, 30 * KIB);
+    if (set_memory_budget_limit(&group, 60 * KIB) != ERR_MEMORY_BUDGET_EXCEEDED || set_memory_budget_limit(&reserved, 0) < 0 ||
+        get_memory_room(&reserved) != 30 * KIB || set_memory_budget_limit(&reserved, 60 * KIB) < 0) {
+        fprintf(stderr, "budget tree: the reservation is not moved with the limit of the child\n");
+        goto exit_flag;
+    }
+
+    uncharge_memory(&reserved, MEMORY_FRAME_BUFFERS, 60 * KIB);
+    uncharge_memory(&group, MEMORY_FRAME_BUFFERS, 10 * KIB);
+    free_memory_budget(&reserved);
+    is_reserved_freed = 1;
+    if (set_memory_budget_limit(&refused, 100 * KIB) < 0 || check_usage(&group, "budget tree group", 0, 100 * KIB, 0, 2) < 0) {
+        fprintf(stderr, "budget tree: the freed child keeps its reservation\n");
+        goto exit_flag;
+    }
+
+    printf("memory: reservations of a budget tree verified\n");
+    ret = 0;
+
+exit_flag:
+    if (!is_reserved_freed) {
+        free_memory_budget(&reserved);
+    }
+    free_memory_budget(&shared);
+    free_memory_budget(&refused);
+    free_memory_budget(&group);
+    return ret;
+}
+
+static void *charge_main(void *arg) {
+    ChargeJob *job = (ChargeJob *)arg;
+
+    for (int32_t i = 0; i < job->charges; i++) {
+        MEMORY_CATEGORY category = (MEMORY_CATEGORY)(i % H264_MEMORY_CATEGORIES);
+        size_t size = (size_t)(i % 7 + 1) * KIB;
+        if (charge_memory(job->budget, category, size) < 0) {
+            job->refused++;
+            continue;
+        }
+        uncharge_memory(job->budget, category, size);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t charges = 200000;
+    MemoryBudget group;
+    MemoryBudget children[THREAD_COUNT];
+    ChargeJob jobs[THREAD_COUNT];
+    pthread_t threads[THREAD_COUNT];
+    int32_t thread_count = 0;
+
+    if (argc > 1) {
+        charges = atoi(argv[1]);
+    }
+    if (charges <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        return EXIT_FAILURE;
+    }
+
+    /* verify */
+    if (check_single_budget() < 0 || check_budget_tree() < 0) {
+        return EXIT_FAILURE;
+    }
+
+    /* benchmark: the children of a group charge and uncharge concurrently, half of them reserve a limit */
+    if (init_memory_budget(&group, 0) < 0 || set_memory_budget_limit(&group, 64 * KIB) < 0) {
+        return EXIT_FAILURE;
+    }
+    for (int32_t i = 0; i < THREAD_COUNT; i++) {
+        init_memory_budget(&children[i], &group);
+    }
+    for (int32_t i = 0; i < THREAD_COUNT; i++) {
+        if (i % 2 && set_memory_budget_limit(&children[i], 8 * KIB) < 0) {
+            goto exit_flag;
+        }
+        jobs[i].budget = &children[i];
+        jobs[i].charges = charges;
+        jobs[i].refused = 0;
+    }
+
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (; thread_count < THREAD_COUNT; thread_count++) {
+        if (pthread_create(&threads[thread_count], 0, charge_main, &jobs[thread_count])) {
+            goto exit_flag;
+        }
+    }
+    for (int32_t i = 0; i < THREAD_COUNT; i++) {
+        pthread_join(threads[i], 0);
+    }
+    thread_count = 0;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    MemoryUsage usage;
+    get_memory_budget_usage(&group, &usage);
+    if (usage.total != 0 || usage.peak_total > 64 * KIB || usage.current[MEMORY_SCRATCH] != 0) {
+        fprintf(stderr, "concurrent charges: total %zu peak %zu after the charges are returned\n", usage.total, usage.peak_total);
+        goto exit_flag;
+    }
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("memory: %.0f charges/s on %d threads, peak %zu bytes, %u refused\n", seconds > 0 ? THREAD_COUNT * (double)charges / seconds : 0.0, THREAD_COUNT,
+           usage.peak_total, usage.refused);
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    for (int32_t i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], 0);
+    }
+    for (int32_t i = 0; i < THREAD_COUNT; i++) {
+        free_memory_budget(&children[i]);
+    }
+    free_memory_budget(&group);
+    return exit_code;
+}
@@ -0,0 +1,475 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_macroblock.h"
+#include "h264decoder/h264_mv_pred.h"
+#include "h264decoder/h264_picture.h"
+
+/*
+ * motion vector prediction test: derives the motion vectors of the macroblock in the middle of a 3x3 macroblock frame from hand-set neighbours A (left),
+ * B (above), C (above-right) and D (above-left). checks the median prediction, the fallback of C to D, the single matching reference index, the 16x8 and 8x16
+ * directional predictions, P_Skip, the colZeroFlag of the spatial direct mode and the scaling of the temporal direct mode against vectors computed by hand from
+ * clause 8.4.1. then reports the P_L0_16x16 macroblocks derived per second.
+ *
+ * usage: test_h264_mv_pred [macroblocks]
+ */
+
+#define MB_A 3
+#define MB_B 1
+#define MB_C 2
+#define MB_D 0
+#define MB_CURR 4
+
+/* a 3x3 macroblock frame and the parameter sets of its slice, the current macroblock is 4 */
+typedef struct {
+    SPS sps;
+    PPS pps;
+    SliceHeader header;
+    Picture *pic;
+    FrameOrField *ff;
+    /* the scratch which the derivations read the mvd and the reference indices of the current macroblock from */
+    MacroBlockScratch scratch;
+} MvFixture;
+
+static MvFixture *create_fixture(uint32_t slice_type, const RefPicLists *lists, int32_t poc) {
+    MvFixture *fx = (MvFixture *)calloc(1, sizeof(MvFixture));
+    if (!fx) {
+        return 0;
+    }
+
+    fx->sps.PicWidthInMbs = 3;
+    fx->sps.FrameHeightInMbs = 3;
+    fx->sps.frame_mbs_only_flag = 1;
+    fx->sps.direct_8x8_inference_flag = 1;
+    fx->sps.chroma_format_idc = 1;
+    fx->sps.ChromaArrayType = 1;
+    fx->sps.MbWidthC = 8;
+    fx->sps.MbHeightC = 8;
+    fx->sps.BitDepthY = 8;
+    fx->sps.BitDepthC = 8;
+    fx->header.sps = &fx->sps;
+    fx->header.pps = &fx->pps;
+    fx->header.PicSizeInMbs = 9;
+    fx->header.slice_type = slice_type;
+
+    fx->pic = create_picture();
+    if (!fx->pic) {
+        free(fx);
+        return 0;
+    }
+    fx->pic->coded_type = PICTURE_CODED_FRAME;
+    fx->ff = fx->pic->frame;
+    fx->ff->poc = poc;
+    if (init_frame_or_field(fx->ff, &fx->header, lists) < 0) {
+        free_picture(fx->pic);
+        free(fx);
+        return 0;
+    }
+    fx->ff->mb_scratch = &fx->scratch;
+
+    return fx;
+}
+
+static void free_fixture(MvFixture *fx) {
+    if (fx) {
+        free_picture(fx->pic);
+        free(fx);
+    }
+}
+
+/* mark every macroblock as not decoded */
+static void clear_macroblocks(FrameOrField *ff) {
+    for (int32_t mbAddr = 0; mbAddr < 9; ++mbAddr) {
+        ff->mb_slice_ids[mbAddr] = -1;
+    }
+}
+
+/* set the motion data of the 4x4 block ( x4, y4 ) of a decoded macroblock, refIdx -1 if the list is not used */
+static void set_block(FrameOrField *ff, int32_t mbAddr, int32_t x4, int32_t y4, int32_t list, int32_t refIdx, int32_t mvx, int32_t mvy) {
+    int32_t blk = mbAddr * 16 + y4 * 4 + x4;
+    ff->ref_idxs[list][blk] = (int8_t)refIdx;
+    ff->mvs[list][2 * blk] = (int16_t)mvx;
+    ff->mvs[list][2 * blk + 1] = (int16_t)mvy;
+}
+
+/* decode a P_L0_16x16 neighbour of the slice slice_id with one motion vector in list 0 */
+static void set_p_neighbour(FrameOrField *ff, int32_t mbAddr, int32_t slice_id, int32_t refIdx, int32_t mvx, int32_t mvy) {
+    ff->mb_slice_ids[mbAddr] = slice_id;
+    ff->mb_type_names[mbAddr] = P_L0_16x16;
+    ff->mb_list[mbAddr].mb_pred_type = Pred_L0;
+    for (int32_t blk = 0; blk < 16; ++blk) {
+        set_block(ff, mbAddr, blk % 4, blk / 4, 0, refIdx, mvx, mvy);
+        set_block(ff, mbAddr, blk % 4, blk / 4, 1, -1, 0, 0);
+    }
+}
+
+/* the neighbours of the median cases: A (4, 0), B (8, -4), C (-2, 6) and D (10, 10), all of them refer to the reference index 0 */
+static void set_p_neighbours(FrameOrField *ff) {
+    clear_macroblocks(ff);
+    set_p_neighbour(ff, MB_D, 0, 0, 10, 10);
+    set_p_neighbour(ff, MB_B, 0, 0, 8, -4);
+    set_p_neighbour(ff, MB_C, 0, 0, -2, 6);
+    set_p_neighbour(ff, MB_A, 0, 0, 4, 0);
+}
+
+/* derive the current macroblock of the type mb_type_name with the reference index 0 and the mvd ( mvdx, mvdy ) in every partition */
+static int derive_current(MvFixture *fx, MB_TYPE_NAME mb_type_name, H264_MB_PART_PRED_MODE pred_mode, int32_t mvdx, int32_t mvdy) {
+    FrameOrField *ff = fx->ff;
+    MacroBlockScratch *scratch = ff->mb_scratch;
+
+    ff->mb_slice_ids[MB_CURR] = 0;
+    ff->mb_type_names[MB_CURR] = (uint8_t)mb_type_name;
+    ff->mb_list[MB_CURR].mb_pred_type = (uint8_t)pred_mode;
+    memset(scratch->ref_idx, 0, sizeof(scratch->ref_idx));
+    for (int32_t mbPartIdx = 0; mbPartIdx < 4; ++mbPartIdx) {
+        scratch->mvd[0][mbPartIdx][0][0] = mvdx;
+        scratch->mvd[0][mbPartIdx][0][1] = mvdy;
+    }
+
+    init_mv_cache(ff, &fx->header, MB_CURR);
+    return derivation_for_motion_vectors(ff, &fx->header, MB_CURR);
+}
+
+/* check the derived motion data of the 4x4 blocks ( x4, y4 ) with x4 in [x0, x1) and y4 in [y0, y1) of the current macroblock */
+static int check_blocks(const FrameOrField *ff, const char *name, int32_t list, int32_t x0, int32_t x1, int32_t y0, int32_t y1, int32_t refIdx, int32_t mvx, int32_t mvy) {
+    for (int32_t y4 = y0; y4 < y1; ++y4) {
+        for (int32_t x4 = x0; x4 < x1; ++x4) {
+            int32_t blk = MB_CURR * 16 + y4 * 4 + x4;
+            if (ff->ref_idxs[list][blk] != refIdx || ff->mvs[list][2 * blk] != mvx || ff->mvs[list][2 * blk + 1] != mvy) {
+                fprintf(stderr, "mv_pred: %s, block (%d, %d) of list %d has refIdx %d mv (%d, %d), expected refIdx %d mv (%d, %d)\n", name, x4, y4, list,
+                        ff->ref_idxs[list][blk], ff->mvs[list][2 * blk], ff->mvs[list][2 * blk + 1], refIdx, mvx, mvy);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int check_median_prediction(void) {
+    RefPicLists lists;
+    memset(&lists, 0, sizeof(lists));
+    MvFixture *fx = create_fixture(SLICE_TYPE_P, &lists, 0);
+    if (!fx) {
+        fprintf(stderr, "mv_pred: fixture creation failed\n");
+        return -1;
+    }
+
+    int ret = -1;
+    FrameOrField *ff = fx->ff;
+
+    /* median( 4, 8, -2 ) = 4, median( 0, -4, 6 ) = 0, plus the mvd ( 1, 1 ) */
+    set_p_neighbours(ff);
+    if (derive_current(fx, P_L0_16x16, Pred_L0, 1, 1) < 0 || check_blocks(ff, "median", 0, 0, 4, 0, 4, 0, 5, 1) < 0 ||
+        check_blocks(ff, "median", 1, 0, 4, 0, 4, -1, 0, 0) < 0) {
+        goto exit_flag;
+    }
+
+    /* C is in another slice, D replaces it: median( 4, 8, 10 ) = 8, median( 0, -4, 10 ) = 0 */
+    set_p_neighbours(ff);
+    ff->mb_slice_ids[MB_C] = 1;
+    if (derive_current(fx, P_L0_16x16, Pred_L0, 0, 0) < 0 || check_blocks(ff, "C to D", 0, 0, 4, 0, 4, 0, 8, 0) < 0) {
+        goto exit_flag;
+    }
+
+    /* only A refers to the reference index 0, its motion vector is the prediction */
+    set_p_neighbours(ff);
+    set_p_neighbour(ff, MB_B, 0, 1, 8, -4);
+    set_p_neighbour(ff, MB_C, 0, 1, -2, 6);
+    if (derive_current(fx, P_L0_16x16, Pred_L0, 0, 0) < 0 || check_blocks(ff, "single match", 0, 0, 4, 0, 4, 0, 4, 0) < 0) {
+        goto exit_flag;
+    }
+
+    /* B, C and D are not available, mvLXA replaces them */
+    set_p_neighbours(ff);
+    ff->mb_slice_ids[MB_B] = 1;
+    ff->mb_slice_ids[MB_C] = 1;
+    ff->mb_slice_ids[MB_D] = 1;
+    if (derive_current(fx, P_L0_16x16, Pred_L0, 0, 0) < 0 || check_blocks(ff, "only A", 0, 0, 4, 0, 4, 0, 4, 0) < 0) {
+        goto exit_flag;
+    }
+
+    ret = 0;
+    printf("mv_pred: median prediction, C to D fallback and single reference index match verified\n");
+
+exit_flag:
+    free_fixture(fx);
+    return ret;
+}
+
+static int check_directional_prediction(void) {
+    RefPicLists lists;
+    memset(&lists, 0, sizeof(lists));
+    MvFixture *fx = create_fixture(SLICE_TYPE_P, &lists, 0);
+    if (!fx) {
+        fprintf(stderr, "mv_pred: fixture creation failed\n");
+        return -1;
+    }
+
+    int ret = -1;
+    FrameOrField *ff = fx->ff;
+
+    /**
+     * the lower half of A is ( -6, 2 ). 16x8: the upper partition takes B ( 8, -4 ) where the median is ( 4, 0 ), the lower one takes the lower half of A where the
+     * median of A ( -6, 2 ), the upper partition B ( 8, -4 ) and D ( 4, 0 ) in place of C is ( 4, 0 )
+     */
+    set_p_neighbours(ff);
+    for (int32_t y4 = 2; y4 < 4; ++y4) {
+        for (int32_t x4 = 0; x4 < 4; ++x4) {
+            set_block(ff, MB_A, x4, y4, 0, 0, -6, 2);
+        }
+    }
+    if (derive_current(fx, P_L0_L0_16x8, Pred_L0, 0, 0) < 0 || check_blocks(ff, "16x8 upper", 0, 0, 4, 0, 2, 0, 8, -4) < 0 ||
+        check_blocks(ff, "16x8 lower", 0, 0, 4, 2, 4, 0, -6, 2) < 0) {
+        goto exit_flag;
+    }
+
+    /**
+     * 8x16: the left partition takes A ( 4, 0 ) where the median of A, B ( 8, -4 ) and the block of B above the right partition ( 8, -4 ) is ( 8, -4 ), the right one
+     * takes C ( -2, 6 ) where the median of the left partition ( 4, 0 ), B and C is ( 4, 0 )
+     */
+    set_p_neighbours(ff);
+    if (derive_current(fx, P_L0_L0_8x16, Pred_L0, 0, 0) < 0 || check_blocks(ff, "8x16 left", 0, 0, 2, 0, 4, 0, 4, 0) < 0 ||
+        check_blocks(ff, "8x16 right", 0, 2, 4, 0, 4, 0, -2, 6) < 0) {
+        goto exit_flag;
+    }
+
+    ret = 0;
+    printf("mv_pred: 16x8 and 8x16 directional prediction verified\n");
+
+exit_flag:
+    free_fixture(fx);
+    return ret;
+}
+
+static int check_p_skip(void) {
+    RefPicLists lists;
+    memset(&lists, 0, sizeof(lists));
+    MvFixture *fx = create_fixture(SLICE_TYPE_P, &lists, 0);
+    if (!fx) {
+        fprintf(stderr, "mv_pred: fixture creation failed\n");
+        return -1;
+    }
+
+    int ret = -1;
+    FrameOrField *ff = fx->ff;
+
+    /* the median ( 4, 0 ) of the neighbours */
+    set_p_neighbours(ff);
+    if (derive_current(fx, P_Skip, Pred_L0, 0, 0) < 0 || check_blocks(ff, "P_Skip median", 0, 0, 4, 0, 4, 0, 4, 0) < 0 ||
+        check_blocks(ff, "P_Skip median", 1, 0, 4, 0, 4, -1, 0, 0) < 0) {
+        goto exit_flag;
+    }
+
+    /* A refers to the reference index 0 with the motion vector 0, the median would be ( 8, 0 ) */
+    set_p_neighbours(ff);
+    set_p_neighbour(ff, MB_A, 0, 0, 0, 0);
+    set_p_neighbour(ff, MB_C, 0, 0, 10, 6);
+    if (derive_current(fx, P_Skip, Pred_L0, 0, 0) < 0 || check_blocks(ff, "P_Skip zero A", 0, 0, 4, 0, 4, 0, 0, 0) < 0) {
+        goto exit_flag;
+    }
+
+    /* A is not available */
+    set_p_neighbours(ff);
+    ff->mb_slice_ids[MB_A] = 1;
+    if (derive_current(fx, P_Skip, Pred_L0, 0, 0) < 0 || check_blocks(ff, "P_Skip no A", 0, 0, 4, 0, 4, 0, 0, 0) < 0) {
+        goto exit_flag;
+    }
+
+    ret = 0;
+    printf("mv_pred: P_Skip verified\n");
+
+exit_flag:
+    free_fixture(fx);
+    return ret;
+}
+
+/**
+ * @brief create the co-located frame of the direct modes, the list 0 of its slice refers to ref0 and the 16 blocks of the macroblock 4 refer to it with the motion
+ * vector ( mvx, mvy ) in the left half and ( mvx_right, mvy_right ) in the right half
+ */
+static MvFixture *create_colocated(Picture *ref0, int32_t poc, int32_t mvx, int32_t mvy, int32_t mvx_right, int32_t mvy_right) {
+    RefPicLists lists;
+    memset(&lists, 0, sizeof(lists));
+    lists.entries[0][0].ff = ref0->frame;
+    lists.num[0] = 1;
+
+    MvFixture *col = create_fixture(SLICE_TYPE_P, &lists, poc);
+    if (!col) {
+        return 0;
+    }
+
+    clear_macroblocks(col->ff);
+    set_p_neighbour(col->ff, MB_CURR, 0, 0, mvx, mvy);
+    for (int32_t y4 = 0; y4 < 4; ++y4) {
+        for (int32_t x4 = 2; x4 < 4; ++x4) {
+            set_block(col->ff, MB_CURR, x4, y4, 0, 0, mvx_right, mvy_right);
+        }
+    }
+    return col;
+}
+
+static int check_spatial_direct(void) {
+    int ret = -1;
+    MvFixture *fx = 0;
+    MvFixture *col = 0;
+    Picture *ref0 = create_picture();
+    if (!ref0) {
+        fprintf(stderr, "mv_pred: picture creation failed\n");
+        return -1;
+    }
+
+    /* the co-located left half moves by ( 1, -1 ), colZeroFlag is 1 there, the right half moves by ( 8, 8 ) */
+    col = create_colocated(ref0, 8, 1, -1, 8, 8);
+    RefPicLists lists;
+    memset(&lists, 0, sizeof(lists));
+    lists.entries[0][0].ff = ref0->frame;
+    lists.entries[1][0].ff = col ? col->ff : 0;
+    lists.num[0] = 1;
+    lists.num[1] = 1;
+    fx = col ? create_fixture(SLICE_TYPE_B, &lists, 4) : 0;
+    if (!fx) {
+        fprintf(stderr, "mv_pred: fixture creation failed\n");
+        goto exit_flag;
+    }
+    fx->header.direct_spatial_mv_pred_flag = 1;
+
+    /**
+     * list 0: A ( 4, 0 ), B ( 8, -4 ) and C ( -2, 6 ) refer to the index 0, refIdxL0 is 0 and mvpL0 the median ( 4, 0 ). list 1: only B refers to the index 0 with
+     * ( 2, 2 ), refIdxL1 is 0 and mvpL1 is ( 2, 2 )
+     */
+    FrameOrField *ff = fx->ff;
+    set_p_neighbours(ff);
+    for (int32_t blk = 0; blk < 16; ++blk) {
+        set_block(ff, MB_B, blk % 4, blk / 4, 1, 0, 2, 2);
+    }
+    ff->mb_list[MB_B].mb_pred_type = BiPred;
+
+    if (derive_current(fx, B_Skip, Direct, 0, 0) < 0 || check_blocks(ff, "spatial colZeroFlag", 0, 0, 2, 0, 4, 0, 0, 0) < 0 ||
+        check_blocks(ff, "spatial colZeroFlag", 1, 0, 2, 0, 4, 0, 0, 0) < 0 || check_blocks(ff, "spatial moving", 0, 2, 4, 0, 4, 0, 4, 0) < 0 ||
+        check_blocks(ff, "spatial moving", 1, 2, 4, 0, 4, 0, 2, 2) < 0) {
+        goto exit_flag;
+    }
+
+    /* the left half is moving when RefPicList1[ 0 ] is a long-term reference picture */
+    get_current_ref_lists(ff)->entries[1][0].long_term = 1;
+    if (derive_current(fx, B_Skip, Direct, 0, 0) < 0 || check_blocks(ff, "spatial long-term", 0, 0, 4, 0, 4, 0, 4, 0) < 0 ||
+        check_blocks(ff, "spatial long-term", 1, 0, 4, 0, 4, 0, 2, 2) < 0) {
+        goto exit_flag;
+    }
+
+    ret = 0;
+    printf("mv_pred: spatial direct colZeroFlag verified\n");
+
+exit_flag:
+    free_fixture(fx);
+    free_fixture(col);
+    free_picture(ref0);
+    return ret;
+}
+
+static int check_temporal_direct(void) {
+    int ret = -1;
+    MvFixture *fx = 0;
+    MvFixture *col = 0;
+    Picture *ref0 = create_picture();
+    Picture *other = create_picture();
+    if (!ref0 || !other) {
+        fprintf(stderr, "mv_pred: picture creation failed\n");
+        goto exit_flag;
+    }
+
+    /* the co-located macroblock of the picture with POC 8 moves by ( 16, -8 ) from the picture with POC 0 */
+    col = create_colocated(ref0, 8, 16, -8, 16, -8);
+    RefPicLists lists;
+    memset(&lists, 0, sizeof(lists));
+    lists.entries[0][0].ff = other->frame;
+    lists.entries[0][0].poc = 6;
+    lists.entries[0][1].ff = ref0->frame;
+    lists.entries[0][1].poc = 0;
+    lists.entries[1][0].ff = col ? col->ff : 0;
+    lists.entries[1][0].poc = 8;
+    lists.num[0] = 2;
+    lists.num[1] = 1;
+    fx = col ? create_fixture(SLICE_TYPE_B, &lists, 2) : 0;
+    if (!fx) {
+        fprintf(stderr, "mv_pred: fixture creation failed\n");
+        goto exit_flag;
+    }
+    fx->header.direct_spatial_mv_pred_flag = 0;
+
+    /**
+     * refIdxL0 is 1, the index of the picture with POC 0 in list 0. tb = 2, td = 8, tx = ( 16384 + 4 ) / 8 = 2048, DistScaleFactor = ( 2 * 2048 + 32 ) >> 6 = 64,
+     * mvL0 = ( ( 64 * 16 + 128 ) >> 8, ( 64 * -8 + 128 ) >> 8 ) = ( 4, -2 ), mvL1 = mvL0 - mvCol = ( -12, 6 )
+     */
+    FrameOrField *ff = fx->ff;
+    set_p_neighbours(ff);
+    if (derive_current(fx, B_Direct_16x16, Direct, 0, 0) < 0 || check_blocks(ff, "temporal", 0, 0, 4, 0, 4, 1, 4, -2) < 0 ||
+        check_blocks(ff, "temporal", 1, 0, 4, 0, 4, 0, -12, 6) < 0) {
+        goto exit_flag;
+    }
+
+    /* the picture with POC 0 is a long-term reference picture, mvL0 is mvCol and mvL1 is 0 */
+    get_current_ref_lists(ff)->entries[0][1].long_term = 1;
+    if (derive_current(fx, B_Direct_16x16, Direct, 0, 0) < 0 || check_blocks(ff, "temporal long-term", 0, 0, 4, 0, 4, 1, 16, -8) < 0 ||
+        check_blocks(ff, "temporal long-term", 1, 0, 4, 0, 4, 0, 0, 0) < 0) {
+        goto exit_flag;
+    }
+
+    ret = 0;
+    printf("mv_pred: temporal direct scaling verified\n");
+
+exit_flag:
+    free_fixture(fx);
+    free_fixture(col);
+    free_picture(ref0);
+    free_picture(other);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t macroblocks = 1000000;
+    MvFixture *fx = 0;
+
+    if (argc > 1) {
+        macroblocks = atoi(argv[1]);
+    }
+    if (macroblocks <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    /* verify */
+    if (check_median_prediction() < 0 || check_directional_prediction() < 0 || check_p_skip() < 0 || check_spatial_direct() < 0 || check_temporal_direct() < 0) {
+        goto exit_flag;
+    }
+
+    /* benchmark: the P_L0_16x16 macroblock with the median prediction */
+    RefPicLists lists;
+    memset(&lists, 0, sizeof(lists));
+    fx = create_fixture(SLICE_TYPE_P, &lists, 0);
+    if (!fx) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    set_p_neighbours(fx->ff);
+
+    clock_t start = clock();
+    for (int32_t i = 0; i < macroblocks; ++i) {
+        if (derive_current(fx, P_L0_16x16, Pred_L0, i & 7, 0) < 0) {
+            fprintf(stderr, "benchmark: macroblock %d failed\n", i);
+            goto exit_flag;
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("mv_pred: %d macroblocks in %.3f s, %.2f M macroblocks/s\n", macroblocks, seconds, seconds > 0 ? macroblocks / seconds / 1e6 : 0.0);
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    free_fixture(fx);
+    return exit_code;
+}
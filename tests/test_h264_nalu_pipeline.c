@@ -0,0 +1,349 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_context.h"
+#include "h264decoder/h264_frame.h"
+#include "h264decoder/h264_nalu_pipeline.h"
+#include "h264decoder/h264_stream.h"
+
+#include "h264_test_stream.h"
+
+/*
+ * NALU pipeline test: encodes a synthetic CAVLC byte stream of 1280x720 frames in memory with 8 slices per picture and the parameter sets repeated every 8
+ * pictures, an IDR picture of I_PCM macroblocks, a P picture of skipped macroblocks whose slices start with an Intra_16x16 macroblock, then P pictures, ended by
+ * an end of stream NALU. decodes it with read_next_nalu() and parse_nalu() on the decoding thread, then with the NALUs parsed ahead by the pipeline, alone and
+ * with the slice threads taking over the RBSP buffers of the ring, the samples reconstructed on the decoding thread. checks that the IDR picture carries the PCM
+ * samples, that the skipped picture repeats them around the DC predicted first macroblocks of its slices, and that every output frame carries the same picture
+ * order count, macroblock types, QPY, reference indices, motion vectors and samples. then reports the frames decoded per second of wall clock time for each way.
+ *
+ * usage: test_h264_nalu_pipeline [frames]
+ */
+
+#define WIDTH_IN_MBS 80
+#define HEIGHT_IN_MBS 45
+#define SLICES_PER_PICTURE 8
+#define PARAMETER_SET_PERIOD 8
+#define MBS_PER_SLICE (WIDTH_IN_MBS * HEIGHT_IN_MBS / SLICES_PER_PICTURE)
+
+/* the PCM sample i of the macroblock mb of the IDR picture */
+static uint8_t pcm_sample(int32_t mb, int32_t i) { return (uint8_t)(128 + (mb + i) % 64); }
+
+/**
+ * @brief write picture n of the stream: the IDR picture, then the P pictures referring to the previous picture. the slices split the macroblock rows, so the
+ * macroblocks next to a slice boundary predict their motion vectors and QPY without the neighbours of the other slice
+ */
+static int write_picture(Stream *stream, BitWriter *w, int32_t n) {
+    int is_idr = n == 0;
+
+    for (int32_t slice = 0; slice < SLICES_PER_PICTURE; ++slice) {
+        int32_t first_mb = slice * MBS_PER_SLICE;
+
+        /* @see 7.3.3 Slice header syntax */
+        w->bits = 0;
+        put_ue(w, (uint32_t)first_mb);
+        put_ue(w, is_idr ? 7 : 5);
+        put_ue(w, 0);
+        put_u(w, (uint32_t)n % 16, 4);
+        if (is_idr) {
+            put_ue(w, 0);
+        }
+        put_u(w, (uint32_t)(2 * n) % 64, 6);
+        if (!is_idr) {
+            put_u(w, 0, 1); /* num_ref_idx_active_override_flag */
+            put_u(w, 0, 1); /* ref_pic_list_modification_flag_l0 */
+        }
+        if (is_idr) {
+            put_u(w, 0, 1);
+            put_u(w, 0, 1);
+        } else {
+            put_u(w, 0, 1); /* adaptive_ref_pic_marking_mode_flag */
+        }
+        put_se(w, slice % 3 - 1);
+        put_ue(w, 1); /* disable_deblocking_filter_idc */
+
+        /* @see 7.3.4 Slice data syntax */
+        uint32_t skip_run = 0;
+        for (int32_t mb = first_mb; mb < first_mb + MBS_PER_SLICE; ++mb) {
+            if (is_idr) {
+                put_ue(w, 25); /* I_PCM */
+                while (w->bits % 8) {
+                    put_bit(w, 0);
+                }
+                for (int32_t i = 0; i < 384; ++i) {
+                    put_u(w, pcm_sample(mb, i), 8);
+                }
+                continue;
+            }
+
+            if (n == 1 ? mb > first_mb : (mb * 5 + n) % 7 == 0) {
+                skip_run++;
+                continue;
+            }
+            put_ue(w, skip_run);
+            skip_run = 0;
+
+            if (n == 1 || (mb * 3 + n) % 11 == 0) {
+                /* I_16x16_2_0_0 in a P slice: Intra_16x16 DC prediction without coded AC coefficients */
+                put_ue(w, 5 + 3);
+                put_ue(w, 0); /* intra_chroma_pred_mode */
+                put_se(w, (mb + n) % 5 - 2);
+                /* coeff_token of Intra16x16DCLevel with TotalCoeff 0, the neighbouring blocks have no coefficients so nC is 0 */
+                put_u(w, 1, 1);
+                continue;
+            }
+
+            put_ue(w, 0); /* P_L0_16x16 */
+            put_se(w, (mb * 7 + n) % 33 - 16);
+            put_se(w, (mb * 13 + n) % 17 - 8);
+            put_ue(w, 0); /* coded_block_pattern 0 */
+        }
+        if (skip_run) {
+            put_ue(w, skip_run);
+        }
+
+        if (put_trailing_bits(w) < 0 || add_nalu(stream, is_idr ? 0x65 : 0x41, w) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* the ways of decoding the stream */
+typedef enum {
+    DECODE_INLINE = 0,
+    DECODE_PIPELINE = 1,
+    DECODE_PIPELINE_SLICE_THREADS = 2,
+} DECODE_MODE;
+
+static const char *mode_names[] = {"parse_nalu()", "pipeline", "pipeline + 4 slice threads"};
+
+/**
+ * @brief the first two output frames carry the PCM samples of the IDR picture, except the first macroblocks of the slices of the second one. their neighbours lie
+ * in the previous slices, so the Intra_16x16 and chroma DC predictions are 128
+ * @see 8.3.3.3 Specification of Intra_16x16_DC prediction mode
+ */
+static int check_output_frame(const DecodedFrame *frame, int32_t index) {
+    if (index >= 2) {
+        return 0;
+    }
+    if (frame->plane_count != 3) {
+        fprintf(stderr, "nalu pipeline: %d planes output\n", frame->plane_count);
+        return -1;
+    }
+    for (int32_t mb = 0; mb < WIDTH_IN_MBS * HEIGHT_IN_MBS; ++mb) {
+        int32_t mb_x = mb % WIDTH_IN_MBS;
+        int32_t mb_y = mb / WIDTH_IN_MBS;
+        for (int32_t i = 0; i < 384; ++i) {
+            int32_t iCx = i < 256 ? 0 : 1 + (i - 256) / 64;
+            int32_t size = iCx ? 8 : 16;
+            int32_t k = iCx ? (i - 256) % 64 : i;
+            const SamplePlane *plane = &frame->planes[iCx];
+            int32_t expected = index == 1 && mb % MBS_PER_SLICE == 0 ? 128 : pcm_sample(mb, i);
+            if (plane->data[(size_t)(mb_y * size + k / size) * plane->stride + mb_x * size + k % size] != expected) {
+                fprintf(stderr, "nalu pipeline: frame %d sample %d of macroblock %d is not %d\n", index, i, mb, expected);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief check and hash the output frames of the context, the checksums are written in the output order
+ *
+ * @return int 0 on success, negative value on error
+ */
+static int take_output_frames(H264Context *ctx, uint64_t *hashes, int32_t max_frames, int32_t *output_count) {
+    DecodedFrame frame;
+    while (receive_frame(ctx, &frame) == ERR_OK) {
+        if (check_output_frame(&frame, *output_count) < 0) {
+            release_frame(&frame);
+            return -1;
+        }
+        if (*output_count < max_frames) {
+            hashes[*output_count] = hash_frame(&frame, TEST_HASH_MB_TYPES | TEST_HASH_QPS | TEST_HASH_MOTION | TEST_HASH_SAMPLES);
+        }
+        (*output_count)++;
+        release_frame(&frame);
+    }
+    return 0;
+}
+
+/**
+ * @brief parse and decode the NALUs of the byte stream on the decoding thread
+ *
+ * @return int 0 on success, negative value on error
+ */
+static int decode_inline(Stream *stream, H264Context *ctx, uint64_t *hashes, int32_t max_frames, int32_t *output_count) {
+    H264BitStream bit_stream;
+    memset(&bit_stream, 0, sizeof(H264BitStream));
+    bit_stream.start = stream->data;
+    bit_stream.end = stream->data + stream->size;
+    bit_stream.nalu_start = stream->data;
+
+    while (read_next_nalu(&bit_stream) == ERR_OK) {
+        int err_code = feed_nalu(ctx, bit_stream.nalu_start, bit_stream.nalu_end);
+        if (err_code < 0) {
+            fprintf(stderr, "nalu pipeline: NALU at %ld failed, error code: %d\n", (long)(bit_stream.nalu_start - stream->data), err_code);
+            return -1;
+        }
+        if (take_output_frames(ctx, hashes, max_frames, output_count) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief decode the NALUs parsed ahead by the pipeline
+ *
+ * @return int 0 on success, negative value on error
+ */
+static int decode_pipelined(Stream *stream, H264Context *ctx, uint64_t *hashes, int32_t max_frames, int32_t *output_count) {
+    NaluPipeline *pipeline = create_nalu_pipeline(stream->data, stream->size);
+    if (!pipeline) {
+        fprintf(stderr, "nalu pipeline: the parsing thread not created\n");
+        return -1;
+    }
+
+    int err_code = ERR_OK;
+    int32_t count = 0;
+    while ((err_code = decode_next_nalu(pipeline, ctx)) != ERR_EOS) {
+        if (err_code < 0) {
+            fprintf(stderr, "nalu pipeline: NALU %d failed, error code: %d\n", count, err_code);
+            break;
+        }
+        count++;
+        if (take_output_frames(ctx, hashes, max_frames, output_count) < 0) {
+            err_code = -1;
+            break;
+        }
+    }
+    free_nalu_pipeline(pipeline);
+
+    return err_code == ERR_EOS ? 0 : -1;
+}
+
+/**
+ * @brief decode the stream, the checksums of the output frames are written in the output order
+ *
+ * @return int32_t the number of the output frames, -1 on error
+ */
+static int32_t decode_stream(Stream *stream, DECODE_MODE mode, uint64_t *hashes, int32_t max_frames) {
+    int32_t output_count = 0;
+    int32_t count = -1;
+
+    H264Context *ctx = create_context();
+    if (!ctx) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    if (mode == DECODE_PIPELINE_SLICE_THREADS && set_slice_threads(ctx, 4) < 0) {
+        fprintf(stderr, "nalu pipeline: threads not created\n");
+        goto exit_flag;
+    }
+
+    int err_code = mode == DECODE_INLINE ? decode_inline(stream, ctx, hashes, max_frames, &output_count)
+                                         : decode_pipelined(stream, ctx, hashes, max_frames, &output_count);
+    if (err_code < 0) {
+        goto exit_flag;
+    }
+
+    /* the end of stream NALU has output every frame */
+    if (flush_context(ctx) < 0) {
+        fprintf(stderr, "nalu pipeline: the stream failed with the %s\n", mode_names[mode]);
+        goto exit_flag;
+    }
+    if (take_output_frames(ctx, hashes, max_frames, &output_count) < 0) {
+        goto exit_flag;
+    }
+    count = output_count;
+
+exit_flag:
+    free_context(ctx);
+    return count;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t frames = 33;
+    Stream stream;
+    BitWriter writer;
+    uint64_t *expected = 0;
+    uint64_t *hashes = 0;
+
+    memset(&stream, 0, sizeof(Stream));
+    memset(&writer, 0, sizeof(BitWriter));
+    stream.has_start_codes = 1;
+
+    if (argc > 1) {
+        frames = atoi(argv[1]);
+    }
+    if (frames <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    expected = (uint64_t *)malloc(frames * sizeof(uint64_t));
+    hashes = (uint64_t *)malloc(frames * sizeof(uint64_t));
+    if (!expected || !hashes) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    for (int32_t n = 0; n < frames; ++n) {
+        /* the repeated parameter sets replace the ones of the decoded slices */
+        if (n % PARAMETER_SET_PERIOD == 0 && write_parameter_sets(&stream, &writer, WIDTH_IN_MBS, HEIGHT_IN_MBS) < 0) {
+            fprintf(stderr, "Memory allocation failed\n");
+            goto exit_flag;
+        }
+        if (write_picture(&stream, &writer, n) < 0) {
+            fprintf(stderr, "Memory allocation failed\n");
+            goto exit_flag;
+        }
+    }
+    writer.bits = 0;
+    if (add_nalu(&stream, NALU_END_OF_STREAM, &writer) < 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+
+    /* verify and benchmark: parse_nalu() first, its output frames are the reference of the pipeline */
+    for (int32_t mode = DECODE_INLINE; mode <= DECODE_PIPELINE_SLICE_THREADS; ++mode) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int32_t count = decode_stream(&stream, (DECODE_MODE)mode, mode ? hashes : expected, frames);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (count != frames) {
+            fprintf(stderr, "nalu pipeline: %d of %d frames output with the %s\n", count, frames, mode_names[mode]);
+            goto exit_flag;
+        }
+        if (mode && memcmp(hashes, expected, frames * sizeof(uint64_t))) {
+            fprintf(stderr, "nalu pipeline: the frames decoded with the %s differ\n", mode_names[mode]);
+            goto exit_flag;
+        }
+
+        /* wall clock time, the CPU time of the process adds up the threads */
+        double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("nalu pipeline: %s, %.1f frames/s (%d frames of %dx%d)\n", mode_names[mode], seconds > 0 ? frames / seconds : 0.0, frames, WIDTH_IN_MBS * 16,
+               HEIGHT_IN_MBS * 16);
+    }
+    printf("nalu pipeline: %d descriptors verified\n", H264_NALU_PIPELINE_DEPTH);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (expected) {
+        free(expected);
+    }
+    if (hashes) {
+        free(hashes);
+    }
+    free_stream(&stream);
+    if (writer.buffer) {
+        free(writer.buffer);
+    }
+    return exit_code;
+}
@@ -0,0 +1,475 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_deblock.h"
+#include "h264decoder/h264_inter_pred.h"
+#include "h264decoder/h264_math.h"
+#include "h264decoder/h264_picture.h"
+
+/*
+ * picture planes test: allocates the picture pool for the sample formats, bit depths and borders, checks the planes of the frame and of the fields are aligned, lie
+ * within the sample buffer without overlapping and match the deblocking planes, fills the planes with random samples, pads them in the frame and in the field
+ * structure and checks every border sample repeats the nearest edge sample. checks the per-macroblock parallel arrays are disjoint, cleared and reset.
+ * checks the released pictures are reused without reallocation and a geometry change reallocates them. then reports the padded frames per second.
+ *
+ * usage: test_h264_picture [rounds]
+ */
+
+#define PIC_WIDTH_IN_MBS 80
+#define PIC_HEIGHT_IN_MBS 46
+
+typedef struct {
+    const char *name;
+    uint32_t chroma_format_idc;
+    uint8_t separate_colour_plane_flag;
+    uint32_t BitDepthY;
+    uint32_t BitDepthC;
+    uint8_t frame_mbs_only_flag;
+    int32_t border;
+} TestFormat;
+
+/**
+ * @brief set the fields of the sps which the picture allocation reads
+ */
+static void set_test_sps(SPS *sps, const TestFormat *format) {
+    memset(sps, 0, sizeof(SPS));
+    sps->PicWidthInMbs = PIC_WIDTH_IN_MBS;
+    sps->FrameHeightInMbs = PIC_HEIGHT_IN_MBS;
+    sps->frame_mbs_only_flag = format->frame_mbs_only_flag;
+    sps->MaxDpbFrames = 2;
+    sps->chroma_format_idc = format->chroma_format_idc;
+    sps->separate_colour_plane_flag = format->separate_colour_plane_flag;
+    sps->ChromaArrayType = format->separate_colour_plane_flag ? 0 : format->chroma_format_idc;
+    sps->BitDepthY = format->BitDepthY;
+    sps->BitDepthC = format->BitDepthC;
+
+    int32_t is_chroma_sampled = format->chroma_format_idc != 0 && !format->separate_colour_plane_flag;
+    sps->SubWidthC = format->chroma_format_idc == 3 ? 1 : 2;
+    sps->SubHeightC = format->chroma_format_idc == 1 ? 2 : 1;
+    sps->MbWidthC = is_chroma_sampled ? 16 / sps->SubWidthC : 0;
+    sps->MbHeightC = is_chroma_sampled ? 16 / sps->SubHeightC : 0;
+}
+
+static int32_t get_sample(const SamplePlane *plane, int32_t x, int32_t y) {
+    if (plane->bytes_per_sample == 2) {
+        return ((const uint16_t *)plane->data)[y * plane->stride + x];
+    }
+    return plane->data[y * plane->stride + x];
+}
+
+static void set_sample(SamplePlane *plane, int32_t x, int32_t y, int32_t value) {
+    if (plane->bytes_per_sample == 2) {
+        ((uint16_t *)plane->data)[y * plane->stride + x] = (uint16_t)value;
+    } else {
+        plane->data[y * plane->stride + x] = (uint8_t)value;
+    }
+}
+
+/**
+ * @brief check the plane with its border lies within [ *low, end ) of the sample buffer, then move *low past the plane
+ */
+static int check_plane_layout(const SamplePlane *plane, int32_t field_views, const uint8_t **low, const uint8_t *end) {
+    ptrdiff_t stride_bytes = (ptrdiff_t)plane->stride * plane->bytes_per_sample;
+    ptrdiff_t rows = (ptrdiff_t)plane->border * field_views;
+    const uint8_t *first = plane->data - rows * stride_bytes - plane->border * plane->bytes_per_sample;
+    const uint8_t *last = plane->data + (plane->height - 1 + rows) * stride_bytes + (plane->width + plane->border) * plane->bytes_per_sample;
+
+    if ((uintptr_t)plane->data % H264_PLANE_ALIGN || stride_bytes % H264_PLANE_ALIGN || stride_bytes < (plane->width + 2 * plane->border) * plane->bytes_per_sample) {
+        return -1;
+    }
+    if (first < *low || last > end) {
+        return -1;
+    }
+
+    *low = last;
+    return 0;
+}
+
+/**
+ * @brief check every sample of the border repeats the nearest sample of the plane
+ */
+static int check_padding(const SamplePlane *plane) {
+    for (int32_t y = -plane->border; y < plane->height + plane->border; ++y) {
+        int32_t yc = y < 0 ? 0 : (y >= plane->height ? plane->height - 1 : y);
+        for (int32_t x = -plane->border; x < plane->width + plane->border; ++x) {
+            int32_t xc = x < 0 ? 0 : (x >= plane->width ? plane->width - 1 : x);
+            if (get_sample(plane, x, y) != get_sample(plane, xc, yc)) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void fill_random_planes(FrameOrField *ff, const SPS *sps) {
+    for (int32_t i = 0; i < ff->plane_count; ++i) {
+        SamplePlane *plane = &ff->planes[i];
+        int32_t BitDepth = (i == 0 || sps->separate_colour_plane_flag) ? (int32_t)sps->BitDepthY : (int32_t)sps->BitDepthC;
+        for (int32_t y = 0; y < plane->height; ++y) {
+            for (int32_t x = 0; x < plane->width; ++x) {
+                set_sample(plane, x, y, rand() & ((1 << BitDepth) - 1));
+            }
+        }
+    }
+}
+
+/**
+ * @brief check the layout of the planes of the pictures of the pool, then pad the frame and the fields and check their borders
+ */
+static int check_format(const TestFormat *format, SPS *sps) {
+    int ret = -1;
+    PicturePool pool;
+
+    memset(&pool, 0, sizeof(pool));
+    set_test_sps(sps, format);
+
+    if (format->border && set_picture_pool_border(&pool, format->border) < 0) {
+        fprintf(stderr, "%s: border %d rejected\n", format->name, format->border);
+        return -1;
+    }
+    if (init_picture_pool(&pool, sps) < 0) {
+        fprintf(stderr, "%s: picture pool allocation failed\n", format->name);
+        return -1;
+    }
+
+    int32_t field_views = 2 - sps->frame_mbs_only_flag;
+    int32_t expected_planes = sps->chroma_format_idc ? 3 : 1;
+    int32_t border = format->border ? format->border : H264_PLANE_BORDER;
+
+    /* the pictures are allocated when they are taken from the pool, all of them are held until the pool is freed */
+    for (int32_t p = 0; p < pool.size; ++p) {
+        Picture *pic = 0;
+        if (get_picture_from_pool(&pool, sps, &pic) < 0) {
+            fprintf(stderr, "%s: picture allocation failed\n", format->name);
+            goto exit_flag;
+        }
+        FrameOrField *frame = pic->frame;
+        const uint8_t *low = pic->sample_buffer;
+
+        if (frame->plane_count != expected_planes) {
+            fprintf(stderr, "%s: %d planes, expected %d\n", format->name, frame->plane_count, expected_planes);
+            goto exit_flag;
+        }
+
+        for (int32_t i = 0; i < frame->plane_count; ++i) {
+            const SamplePlane *plane = &frame->planes[i];
+            int32_t is_luma = i == 0 || sps->separate_colour_plane_flag;
+            int32_t width = is_luma ? 16 * PIC_WIDTH_IN_MBS : (int32_t)(PIC_WIDTH_IN_MBS * sps->MbWidthC);
+            int32_t min_border = is_luma ? H264_MC_LUMA_BORDER : H264_MC_CHROMA_BORDER;
+
+            if (plane->width != width || plane->border < min_border || (is_luma && plane->border != border) ||
+                plane->bytes_per_sample != ((is_luma ? sps->BitDepthY : sps->BitDepthC) > 8 ? 2 : 1)) {
+                fprintf(stderr, "%s: plane %d has an invalid geometry\n", format->name, i);
+                goto exit_flag;
+            }
+            if (check_plane_layout(plane, field_views, &low, pic->sample_buffer + pic->sample_buffer_size) < 0) {
+                fprintf(stderr, "%s: plane %d is misaligned or out of the sample buffer\n", format->name, i);
+                goto exit_flag;
+            }
+        }
+
+        DeblockPlanes planes;
+        init_deblock_planes(&planes, frame, sps);
+        if (planes.planes[0] != frame->planes[0].data || planes.strides[0] != frame->planes[0].stride || planes.BitDepthC != (int32_t)sps->BitDepthC) {
+            fprintf(stderr, "%s: deblocking planes mismatch\n", format->name);
+            goto exit_flag;
+        }
+
+        fill_random_planes(frame, sps);
+        pad_frame_or_field(frame);
+        for (int32_t i = 0; i < frame->plane_count; ++i) {
+            if (check_padding(&frame->planes[i]) < 0) {
+                fprintf(stderr, "%s: frame plane %d padding mismatch\n", format->name, i);
+                goto exit_flag;
+            }
+        }
+
+        if (sps->frame_mbs_only_flag) {
+            continue;
+        }
+
+        /* the fields pad the alternate rows of the shared border, so both fields are padded before either is checked */
+        fill_random_planes(frame, sps);
+        pad_frame_or_field(pic->top_field);
+        pad_frame_or_field(pic->bottom_field);
+        for (int32_t i = 0; i < frame->plane_count; ++i) {
+            if (pic->top_field->planes[i].height * 2 != frame->planes[i].height || check_padding(&pic->top_field->planes[i]) < 0 ||
+                check_padding(&pic->bottom_field->planes[i]) < 0) {
+                fprintf(stderr, "%s: field plane %d padding mismatch\n", format->name, i);
+                goto exit_flag;
+            }
+        }
+    }
+
+    printf("picture: %s, %d pictures of %zu bytes verified\n", format->name, pool.size, pool.pictures[0]->sample_buffer_size);
+    ret = 0;
+
+exit_flag:
+    free_picture_pool(&pool);
+    return ret;
+}
+
+/**
+ * @brief check the array lies within [ low, high ) and does not overlap the arrays checked before it, which are recorded in ranges
+ */
+static int check_array_range(const void *array, size_t size, const uint8_t *low, const uint8_t *high, const uint8_t *ranges[][2], int32_t *range_count) {
+    const uint8_t *start = (const uint8_t *)array;
+    if (start < low || start + size > high) {
+        return -1;
+    }
+    for (int32_t i = 0; i < *range_count; ++i) {
+        if (start < ranges[i][1] && ranges[i][0] < start + size) {
+            return -1;
+        }
+    }
+    ranges[*range_count][0] = start;
+    ranges[*range_count][1] = start + size;
+    (*range_count)++;
+    return 0;
+}
+
+/**
+ * @brief check the per-macroblock parallel arrays of a frame: they are carved from their allocations without overlapping, they start with the macroblocks not
+ * decoded and cleared, a write to one array leaves the others unchanged, and a reset only marks the macroblocks as not decoded again
+ */
+static int check_mb_arrays() {
+    /* an odd count so the last word of the field flags bitset is partly used */
+    const int32_t mb_count = 37;
+    const uint8_t *ranges[16][2];
+    int32_t range_count = 0;
+    int ret = -1;
+    FrameOrField *ff = create_frame_or_field();
+
+    if (!ff || alloc_frame_or_field(ff, mb_count) < 0) {
+        fprintf(stderr, "picture: frame allocation failed\n");
+        goto exit_flag;
+    }
+
+    size_t field_flags_size = ((mb_count + 31) >> 5) * sizeof(uint32_t);
+    const uint8_t *meta_end = ff->mb_meta_buffer + mb_count * sizeof(int32_t) + field_flags_size + 3 * mb_count;
+    const uint8_t *mv_end = ff->mv_buffer + 2 * (mb_count * 32 * sizeof(int16_t) + mb_count * 16 + mb_count * 32);
+    if (check_array_range(ff->mb_slice_ids, mb_count * sizeof(int32_t), ff->mb_meta_buffer, meta_end, ranges, &range_count) < 0 ||
+        check_array_range(ff->mb_field_flags, field_flags_size, ff->mb_meta_buffer, meta_end, ranges, &range_count) < 0 ||
+        check_array_range(ff->mb_skip_flags, mb_count, ff->mb_meta_buffer, meta_end, ranges, &range_count) < 0 ||
+        check_array_range(ff->mb_type_names, mb_count, ff->mb_meta_buffer, meta_end, ranges, &range_count) < 0 ||
+        check_array_range(ff->mb_qps, mb_count, ff->mb_meta_buffer, meta_end, ranges, &range_count) < 0) {
+        fprintf(stderr, "picture: the macroblock metadata arrays overlap or lie out of their allocation\n");
+        goto exit_flag;
+    }
+    for (int32_t list = 0; list < 2; ++list) {
+        if (check_array_range(ff->mvs[list], mb_count * 32 * sizeof(int16_t), ff->mv_buffer, mv_end, ranges, &range_count) < 0 ||
+            check_array_range(ff->ref_idxs[list], mb_count * 16, ff->mv_buffer, mv_end, ranges, &range_count) < 0 ||
+            check_array_range(ff->mvds[list], mb_count * 32, ff->mv_buffer, mv_end, ranges, &range_count) < 0) {
+            fprintf(stderr, "picture: the motion arrays of the list %d overlap or lie out of their allocation\n", list);
+            goto exit_flag;
+        }
+    }
+
+    for (int32_t i = 0; i < mb_count; ++i) {
+        if (ff->mb_slice_ids[i] != -1 || bitset_get(ff->mb_field_flags, i) || ff->mb_skip_flags[i] || ff->mb_type_names[i] || ff->mb_qps[i]) {
+            fprintf(stderr, "picture: the macroblock %d is not cleared after the allocation\n", i);
+            goto exit_flag;
+        }
+    }
+
+    /* every array gets its own pattern, the field flags are set on the macroblocks whose address is a multiple of 3 */
+    for (int32_t i = 0; i < mb_count; ++i) {
+        ff->mb_slice_ids[i] = i / 8;
+        bitset_set(ff->mb_field_flags, i, i % 3 == 0);
+        ff->mb_skip_flags[i] = (uint8_t)(i & 1);
+        ff->mb_type_names[i] = (uint8_t)(i % MB_TYPE_NAME_NUM);
+        ff->mb_qps[i] = (int8_t)(51 - i);
+    }
+    bitset_set(ff->mb_field_flags, 33, 0);
+    for (int32_t i = 0; i < mb_count; ++i) {
+        if (ff->mb_slice_ids[i] != i / 8 || bitset_get(ff->mb_field_flags, i) != (i % 3 == 0 && i != 33) || ff->mb_skip_flags[i] != (i & 1) ||
+            ff->mb_type_names[i] != i % MB_TYPE_NAME_NUM || ff->mb_qps[i] != 51 - i) {
+            fprintf(stderr, "picture: the arrays of the macroblock %d mismatch\n", i);
+            goto exit_flag;
+        }
+    }
+    if (ff->mb_field_flags[1] >> (mb_count - 32)) {
+        fprintf(stderr, "picture: the field flags are set beyond the last macroblock\n");
+        goto exit_flag;
+    }
+
+    /* the state of the macroblocks not decoded is never read, so the reset marks them only */
+    reset_frame_or_field(ff);
+    for (int32_t i = 0; i < mb_count; ++i) {
+        if (ff->mb_slice_ids[i] != -1 || ff->mb_qps[i] != 51 - i) {
+            fprintf(stderr, "picture: the macroblock %d is not reset\n", i);
+            goto exit_flag;
+        }
+    }
+
+    printf("picture: the parallel arrays of %d macroblocks verified\n", mb_count);
+    ret = 0;
+
+exit_flag:
+    if (ff) {
+        free_frame_or_field(ff);
+    }
+    return ret;
+}
+
+/**
+ * @brief check the pictures released to the pool are reused with their allocations and only their slice ids reset, and that a geometry change frees the idle
+ * pictures and the pictures of the previous geometry once they are released
+ */
+static int check_pool_reuse(SPS *sps) {
+    const TestFormat format = {"4:2:0 8-bit progressive", 1, 0, 8, 8, 1, 0};
+    int ret = -1;
+    PicturePool pool;
+    Picture *first = 0;
+    Picture *second = 0;
+    Picture *pic = 0;
+
+    memset(&pool, 0, sizeof(pool));
+    set_test_sps(sps, &format);
+    if (init_picture_pool(&pool, sps) < 0 || get_picture_from_pool(&pool, sps, &first) < 0) {
+        fprintf(stderr, "picture pool: allocation failed\n");
+        goto exit_flag;
+    }
+
+    const MacroBlock *mb_list = first->frame->mb_list;
+    const uint8_t *mb_meta_buffer = first->frame->mb_meta_buffer;
+    const uint8_t *sample_buffer = first->sample_buffer;
+    first->frame->mb_slice_ids[5] = 3;
+    first->frame->slice_count = 2;
+    release_picture(&pool, first);
+
+    if (get_picture_from_pool(&pool, sps, &pic) < 0 || pic != first || pic->ref_count != 1 || pic->frame->mb_list != mb_list ||
+        pic->frame->mb_meta_buffer != mb_meta_buffer || pic->sample_buffer != sample_buffer || pic->frame->mb_slice_ids[5] != -1 || pic->frame->slice_count != 0) {
+        fprintf(stderr, "picture pool: the released picture is not reused as it is\n");
+        goto exit_flag;
+    }
+
+    /* a picture in use is never handed out again */
+    if (get_picture_from_pool(&pool, sps, &second) < 0 || second == first || second->pool_index == first->pool_index) {
+        fprintf(stderr, "picture pool: the held picture is handed out again\n");
+        goto exit_flag;
+    }
+
+    /* the same geometry keeps the pictures */
+    int32_t generation = pool.generation;
+    release_picture(&pool, second);
+    second = 0;
+    if (init_picture_pool(&pool, sps) < 0 || pool.generation != generation || !pool.pictures[1]) {
+        fprintf(stderr, "picture pool: the pictures are dropped for the same geometry\n");
+        goto exit_flag;
+    }
+
+    /* a new width frees the idle picture now and the held one when it is released, the next picture is allocated for the new width */
+    sps->PicWidthInMbs = PIC_WIDTH_IN_MBS / 2;
+    if (init_picture_pool(&pool, sps) < 0 || pool.generation != generation + 1 || pool.pictures[1] || pool.pictures[first->pool_index] != first) {
+        fprintf(stderr, "picture pool: the pictures of the previous geometry are not dropped\n");
+        goto exit_flag;
+    }
+    int32_t first_index = first->pool_index;
+    release_picture(&pool, first);
+    first = 0;
+    if (pool.pictures[first_index]) {
+        fprintf(stderr, "picture pool: the picture of the previous geometry is kept after its release\n");
+        goto exit_flag;
+    }
+
+    if (get_picture_from_pool(&pool, sps, &second) < 0 || second->frame->mb_list_len != PIC_WIDTH_IN_MBS / 2 * PIC_HEIGHT_IN_MBS ||
+        second->frame->planes[0].width != 8 * PIC_WIDTH_IN_MBS) {
+        fprintf(stderr, "picture pool: the picture is not allocated for the new geometry\n");
+        goto exit_flag;
+    }
+
+    printf("picture pool: reuse and reallocation on a geometry change verified\n");
+    ret = 0;
+
+exit_flag:
+    if (first) {
+        release_picture(&pool, first);
+    }
+    if (second) {
+        release_picture(&pool, second);
+    }
+    free_picture_pool(&pool);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t rounds = 200;
+    SPS *sps = 0;
+    PicturePool pool;
+    const TestFormat formats[] = {
+        {"4:2:0 8-bit progressive", 1, 0, 8, 8, 1, 0},
+        {"4:2:0 8-bit interlaced", 1, 0, 8, 8, 0, 0},
+        {"4:2:2 10-bit interlaced", 2, 0, 10, 10, 0, 0},
+        {"4:4:4 12-bit luma 8-bit chroma", 3, 0, 12, 8, 1, 48},
+        {"4:4:4 separate planes", 3, 1, 8, 8, 1, 0},
+        {"4:0:0 14-bit interlaced border 64", 0, 0, 14, 8, 0, 64},
+    };
+
+    memset(&pool, 0, sizeof(pool));
+
+    if (argc > 1) {
+        rounds = atoi(argv[1]);
+    }
+    if (rounds <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    srand(1234);
+
+    sps = (SPS *)malloc(sizeof(SPS));
+    if (!sps) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+
+    /* verify */
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+        if (check_format(&formats[i], sps) < 0) {
+            goto exit_flag;
+        }
+    }
+
+    if (check_mb_arrays() < 0 || check_pool_reuse(sps) < 0) {
+        goto exit_flag;
+    }
+
+    if (set_picture_pool_border(&pool, H264_MC_LUMA_BORDER - 1) == 0 || set_picture_pool_border(&pool, H264_PLANE_MAX_BORDER + 1) == 0) {
+        fprintf(stderr, "picture: invalid border accepted\n");
+        goto exit_flag;
+    }
+
+    /* benchmark */
+    set_test_sps(sps, &formats[0]);
+    Picture *pic = 0;
+    if (init_picture_pool(&pool, sps) < 0 || get_picture_from_pool(&pool, sps, &pic) < 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+
+    FrameOrField *frame = pic->frame;
+    fill_random_planes(frame, sps);
+
+    clock_t start = clock();
+    for (int32_t r = 0; r < rounds; ++r) {
+        pad_frame_or_field(frame);
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("picture: padding %.0f frames/s (%d frames of %dx%d, border %d)\n", seconds > 0 ? rounds / seconds : 0.0, rounds, frame->planes[0].width,
+           frame->planes[0].height, frame->planes[0].border);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    free_picture_pool(&pool);
+    if (sps) {
+        free(sps);
+    }
+    return exit_code;
+}
@@ -0,0 +1,407 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_context.h"
+#include "h264decoder/h264_poc.h"
+
+/*
+ * picture order count test: starts the pictures of synthetic slice headers on a context and checks the picture order counts of pic_order_cnt_type 0, 1 and 2,
+ * the wrapping of pic_order_cnt_lsb and frame_num, the field pairs and memory_management_control_operation equal to 5. checks the pictures are output in the
+ * order of their picture order counts as early as max_num_reorder_frames allows, with their decode-to-output latencies, and that an IDR picture with
+ * no_output_of_prior_pics_flag discards the waiting pictures. then reports the pictures decoded and output per second.
+ *
+ * usage: test_h264_poc [pictures]
+ */
+
+#define MAX_FRAME_NUM 16
+#define MAX_OUTPUT 64
+
+/* the slice header fields of a test picture. structure is 3 for a frame, 1 for a top field and 2 for a bottom field */
+typedef struct {
+    uint32_t frame_num;
+    uint8_t nal_ref_idc;
+    uint8_t idr;
+    int32_t structure;
+    uint32_t pic_order_cnt_lsb;
+    int32_t delta_pic_order_cnt_bottom;
+    int32_t delta_pic_order_cnt[2];
+} TestPicture;
+
+/* the pictures output so far */
+typedef struct {
+    int32_t poc[MAX_OUTPUT];
+    int32_t latency[MAX_OUTPUT];
+    int32_t count;
+} OutputLog;
+
+static void set_test_sps(SPS *sps, uint32_t pic_order_cnt_type, uint32_t max_num_reorder_frames) {
+    memset(sps, 0, sizeof(SPS));
+    sps->PicWidthInMbs = 2;
+    sps->FrameHeightInMbs = 2;
+    sps->frame_mbs_only_flag = 0;
+    sps->MaxDpbFrames = 4;
+    sps->max_num_ref_frames = 4;
+    sps->MaxFrameNum = MAX_FRAME_NUM;
+    sps->chroma_format_idc = 1;
+    sps->ChromaArrayType = 1;
+    sps->SubWidthC = 2;
+    sps->SubHeightC = 2;
+    sps->MbWidthC = 8;
+    sps->MbHeightC = 8;
+    sps->BitDepthY = 8;
+    sps->BitDepthC = 8;
+
+    sps->pic_order_cnt_type = pic_order_cnt_type;
+    sps->log2_max_pic_order_cnt_lsb_minus4 = 0;
+    sps->MaxPicOrderCntLsb = 16;
+    sps->vui_parameters_present_flag = 1;
+    sps->vui.bitstream_restriction_flag = 1;
+    sps->vui.max_num_reorder_frames = max_num_reorder_frames;
+}
+
+/**
+ * @brief take the output pictures of the context into the log
+ */
+static void collect_output(H264Context *ctx, OutputLog *log) {
+    for (Picture *out = get_output_picture(ctx); out; out = get_output_picture(ctx)) {
+        if (log && log->count < MAX_OUTPUT) {
+            log->poc[log->count] = out->frame->poc;
+            log->latency[log->count] = out->output_latency;
+            log->count++;
+        }
+        release_output_picture(ctx, out);
+    }
+}
+
+/**
+ * @brief start a picture on the context as the first slice of it would, then take the output pictures
+ */
+static int start_picture(H264Context *ctx, const TestPicture *test, const DecRefPicMark *marking, OutputLog *log, Picture **out_picture) {
+    SliceHeader *header = 0;
+    Picture *pic = 0;
+
+    get_slice_header(ctx, &header);
+    header->nalu_header.nal_ref_idc = test->nal_ref_idc;
+    header->nalu_header.IdrPicFlag = test->idr;
+    header->frame_num = test->frame_num;
+    header->field_pic_flag = test->structure != 3;
+    header->bottom_field_flag = test->structure == 2;
+    header->pic_order_cnt_lsb = test->pic_order_cnt_lsb;
+    header->delta_pic_order_cnt_bottom = test->delta_pic_order_cnt_bottom;
+    header->delta_pic_order_cnt[0] = test->delta_pic_order_cnt[0];
+    header->delta_pic_order_cnt[1] = test->delta_pic_order_cnt[1];
+    header->sps = ctx->active_sps;
+    if (marking) {
+        header->dec_ref_pic_mark = *marking;
+    }
+
+    int err_code = get_picture_from_context(ctx, 1, &pic);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* the state set_picture_structure() sets */
+    pic->decoded_fields |= (uint8_t)test->structure;
+    collect_output(ctx, log);
+
+    if (out_picture) {
+        *out_picture = pic;
+    }
+    return ERR_OK;
+}
+
+static int check_output(const char *step, const OutputLog *log, const int32_t *poc, const int32_t *latency, int32_t count) {
+    if (log->count != count) {
+        fprintf(stderr, "%s: %d pictures output, expected %d\n", step, log->count, count);
+        return -1;
+    }
+    for (int32_t i = 0; i < count; ++i) {
+        if (log->poc[i] != poc[i] || (latency && log->latency[i] != latency[i])) {
+            fprintf(stderr, "%s: output %d has poc %d latency %d, expected poc %d latency %d\n", step, i, log->poc[i], log->latency[i], poc[i],
+                    latency ? latency[i] : log->latency[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief pic_order_cnt_type 0: a P B P B pattern across the wrapping of pic_order_cnt_lsb with one reordered picture, then the fields
+ */
+static int check_poc_type0(H264Context *ctx) {
+    OutputLog log;
+    Picture *pic = 0;
+    const TestPicture pictures[] = {
+        {0, 1, 1, 3, 0, 0, {0, 0}},  {1, 1, 0, 3, 4, 0, {0, 0}}, {2, 0, 0, 3, 2, 0, {0, 0}},  {2, 1, 0, 3, 8, 0, {0, 0}}, {3, 0, 0, 3, 6, 0, {0, 0}},
+        {3, 1, 0, 3, 12, 0, {0, 0}}, {4, 0, 0, 3, 10, 0, {0, 0}}, {4, 1, 0, 3, 0, 0, {0, 0}}, {5, 0, 0, 3, 14, 0, {0, 0}},
+    };
+    const int32_t expected_poc[] = {0, 2, 4, 6, 8, 10, 12, 14, 16};
+    const int32_t expected_latency[] = {1, 0, 2, 0, 2, 0, 2, 0, 1};
+
+    memset(&log, 0, sizeof(log));
+    set_test_sps(ctx->active_sps, 0, 1);
+
+    for (size_t i = 0; i < sizeof(pictures) / sizeof(pictures[0]); ++i) {
+        if (start_picture(ctx, &pictures[i], 0, &log, 0) < 0) {
+            return -1;
+        }
+    }
+    if (flush_context(ctx) < 0) {
+        return -1;
+    }
+    collect_output(ctx, &log);
+    if (check_output("poc type 0", &log, expected_poc, expected_latency, 9) < 0) {
+        return -1;
+    }
+
+    /* an IDR top field with its bottom field, then a frame whose bottom field precedes its top field */
+    const TestPicture top = {0, 1, 1, 1, 0, 0, {0, 0}};
+    const TestPicture bottom = {0, 1, 0, 2, 1, 0, {0, 0}};
+    const TestPicture frame = {1, 1, 0, 3, 6, -1, {0, 0}};
+    if (start_picture(ctx, &top, 0, 0, &pic) < 0 || start_picture(ctx, &bottom, 0, 0, 0) < 0) {
+        return -1;
+    }
+    if (pic->top_field->poc != 0 || pic->bottom_field->poc != 1 || pic->frame->poc != 0) {
+        fprintf(stderr, "poc type 0: field pair has poc %d/%d frame %d\n", pic->top_field->poc, pic->bottom_field->poc, pic->frame->poc);
+        return -1;
+    }
+    if (start_picture(ctx, &frame, 0, 0, &pic) < 0) {
+        return -1;
+    }
+    if (pic->top_field->poc != 6 || pic->bottom_field->poc != 5 || pic->frame->poc != 5) {
+        fprintf(stderr, "poc type 0: frame has poc %d/%d frame %d\n", pic->top_field->poc, pic->bottom_field->poc, pic->frame->poc);
+        return -1;
+    }
+    if (flush_context(ctx) < 0) {
+        return -1;
+    }
+    collect_output(ctx, 0);
+
+    printf("poc: pic_order_cnt_type 0 verified\n");
+    return 0;
+}
+
+/**
+ * @brief pic_order_cnt_type 1: a cycle of 2 reference frames with the offsets 4 and 2, the non-reference pictures and the wrapping of frame_num
+ */
+static int check_poc_type1(H264Context *ctx) {
+    OutputLog log;
+    Picture *pic = 0;
+    SPS *sps = ctx->active_sps;
+
+    memset(&log, 0, sizeof(log));
+    set_test_sps(sps, 1, 1);
+    sps->num_ref_frames_in_pic_order_cnt_cycle = 2;
+    sps->offset_for_ref_frame[0] = 4;
+    sps->offset_for_ref_frame[1] = 2;
+    sps->ExpectedDeltaPerPicOrderCntCycle = 6;
+    sps->offset_for_non_ref_pic = -2;
+    sps->offset_for_top_to_bottom_field = 1;
+
+    /* IDR 0, reference frame 1, a non-reference frame between them, reference frame 2 */
+    const TestPicture pictures[] = {{0, 1, 1, 3, 0, 0, {0, 0}}, {1, 1, 0, 3, 0, 0, {0, 0}}, {2, 0, 0, 3, 0, 0, {0, 0}}, {2, 1, 0, 3, 0, 0, {0, 0}}};
+    const int32_t expected_top[] = {0, 4, 2, 6};
+    for (size_t i = 0; i < sizeof(pictures) / sizeof(pictures[0]); ++i) {
+        if (start_picture(ctx, &pictures[i], 0, &log, &pic) < 0) {
+            return -1;
+        }
+        if (pic->top_field->poc != expected_top[i] || pic->bottom_field->poc != expected_top[i] + 1) {
+            fprintf(stderr, "poc type 1: picture %zu has poc %d/%d, expected %d/%d\n", i, pic->top_field->poc, pic->bottom_field->poc, expected_top[i],
+                    expected_top[i] + 1);
+            return -1;
+        }
+    }
+
+    /* the reference frames 3 to 15, then frame_num wraps and FrameNumOffset grows by MaxFrameNum: absFrameNum 16 and 17 */
+    for (uint32_t n = 3; n <= 17; ++n) {
+        const TestPicture test = {n % MAX_FRAME_NUM, 1, 0, 3, 0, 0, {n == 17 ? 3 : 0, 0}};
+        if (start_picture(ctx, &test, 0, &log, &pic) < 0) {
+            return -1;
+        }
+    }
+    /* absFrameNum 17: 8 cycles of 6 and the offset 4 of the first frame of the cycle, delta_pic_order_cnt[ 0 ] 3 */
+    if (pic->frame->poc != 8 * 6 + 4 + 3) {
+        fprintf(stderr, "poc type 1: frame_num wrap has poc %d, expected %d\n", pic->frame->poc, 8 * 6 + 4 + 3);
+        return -1;
+    }
+
+    if (flush_context(ctx) < 0) {
+        return -1;
+    }
+    collect_output(ctx, &log);
+    /* the non-reference frame is reordered, the frames follow in the decoding order */
+    if (log.count != 19 || log.poc[0] != 0 || log.poc[1] != 2 || log.poc[2] != 4) {
+        fprintf(stderr, "poc type 1: %d pictures output, the first with poc %d %d %d\n", log.count, log.poc[0], log.poc[1], log.poc[2]);
+        return -1;
+    }
+    for (int32_t i = 1; i < log.count; ++i) {
+        if (log.poc[i] <= log.poc[i - 1]) {
+            fprintf(stderr, "poc type 1: poc %d is output after poc %d\n", log.poc[i], log.poc[i - 1]);
+            return -1;
+        }
+    }
+
+    printf("poc: pic_order_cnt_type 1 verified\n");
+    return 0;
+}
+
+/**
+ * @brief pic_order_cnt_type 2: the output order is the decoding order, every picture is output when the next one starts although max_num_reorder_frames is 4
+ */
+static int check_poc_type2(H264Context *ctx) {
+    OutputLog log;
+    const TestPicture pictures[] = {{0, 1, 1, 3, 0, 0, {0, 0}}, {1, 1, 0, 3, 0, 0, {0, 0}}, {2, 0, 0, 3, 0, 0, {0, 0}}, {2, 1, 0, 3, 0, 0, {0, 0}}};
+    const int32_t expected_poc[] = {0, 2, 3, 4};
+    const int32_t expected_latency[] = {0, 0, 0, 0};
+
+    memset(&log, 0, sizeof(log));
+    set_test_sps(ctx->active_sps, 2, 4);
+
+    for (size_t i = 0; i < sizeof(pictures) / sizeof(pictures[0]); ++i) {
+        if (start_picture(ctx, &pictures[i], 0, &log, 0) < 0) {
+            return -1;
+        }
+        if (log.count != (int32_t)i) {
+            fprintf(stderr, "poc type 2: %d pictures output after %zu pictures started\n", log.count, i + 1);
+            return -1;
+        }
+    }
+    if (flush_context(ctx) < 0) {
+        return -1;
+    }
+    collect_output(ctx, &log);
+    if (check_output("poc type 2", &log, expected_poc, expected_latency, 4) < 0) {
+        return -1;
+    }
+
+    printf("poc: pic_order_cnt_type 2 verified\n");
+    return 0;
+}
+
+/**
+ * @brief memory_management_control_operation 5 outputs the preceding pictures and restarts the picture order counts, an IDR picture with
+ * no_output_of_prior_pics_flag discards the waiting pictures
+ */
+static int check_mmco5_and_idr(H264Context *ctx) {
+    OutputLog log;
+    DecRefPicMark marking;
+    Picture *pic = 0;
+    const TestPicture pictures[] = {{0, 1, 1, 3, 0, 0, {0, 0}}, {1, 1, 0, 3, 8, 0, {0, 0}}, {2, 0, 0, 3, 4, 0, {0, 0}}};
+    const TestPicture mmco5 = {2, 1, 0, 3, 12, 0, {0, 0}};
+    const TestPicture next = {1, 1, 0, 3, 2, 0, {0, 0}};
+    const int32_t expected_poc[] = {0, 4, 8, 0, 2};
+
+    memset(&log, 0, sizeof(log));
+    set_test_sps(ctx->active_sps, 0, 2);
+
+    for (size_t i = 0; i < sizeof(pictures) / sizeof(pictures[0]); ++i) {
+        if (start_picture(ctx, &pictures[i], 0, &log, 0) < 0) {
+            return -1;
+        }
+    }
+
+    memset(&marking, 0, sizeof(marking));
+    marking.adaptive_ref_pic_marking_mode_flag = 1;
+    marking.mmco[0].memory_management_control_operation = 5;
+    marking.mmco_len = 1;
+    if (start_picture(ctx, &mmco5, &marking, &log, &pic) < 0 || start_picture(ctx, &next, 0, &log, 0) < 0) {
+        return -1;
+    }
+    if (pic->frame->poc != 0 || pic->top_field->poc != 0) {
+        fprintf(stderr, "mmco 5: poc %d after tempPicOrderCnt, expected 0\n", pic->frame->poc);
+        return -1;
+    }
+    if (flush_context(ctx) < 0) {
+        return -1;
+    }
+    collect_output(ctx, &log);
+    if (check_output("mmco 5", &log, expected_poc, 0, 5) < 0) {
+        return -1;
+    }
+
+    /* the pictures 0 and 4 wait for the output when the IDR picture discards them */
+    memset(&log, 0, sizeof(log));
+    const TestPicture idr = {0, 1, 1, 3, 0, 0, {0, 0}};
+    const TestPicture ref = {1, 1, 0, 3, 4, 0, {0, 0}};
+    memset(&marking, 0, sizeof(marking));
+    marking.no_output_of_prior_pics_flag = 1;
+    if (start_picture(ctx, &idr, 0, &log, 0) < 0 || start_picture(ctx, &ref, 0, &log, 0) < 0 || start_picture(ctx, &idr, &marking, &log, 0) < 0) {
+        return -1;
+    }
+    if (flush_context(ctx) < 0) {
+        return -1;
+    }
+    collect_output(ctx, &log);
+    if (check_output("no_output_of_prior_pics_flag", &log, expected_poc, 0, 1) < 0) {
+        return -1;
+    }
+
+    printf("poc: memory_management_control_operation 5 and no_output_of_prior_pics_flag verified\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t pictures = 200000;
+    H264Context *ctx = 0;
+    SPS *sps = 0;
+
+    if (argc > 1) {
+        pictures = atoi(argv[1]);
+    }
+    if (pictures <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    ctx = create_context();
+    sps = (SPS *)malloc(sizeof(SPS));
+    if (!ctx || !sps) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    ctx->active_sps = sps;
+
+    /* verify */
+    if (check_poc_type0(ctx) < 0 || check_poc_type1(ctx) < 0 || check_poc_type2(ctx) < 0 || check_mmco5_and_idr(ctx) < 0) {
+        goto exit_flag;
+    }
+
+    /* benchmark: a P B B pattern of pic_order_cnt_type 0 with 2 reordered pictures */
+    set_test_sps(sps, 0, 2);
+    sps->log2_max_pic_order_cnt_lsb_minus4 = 4;
+    sps->MaxPicOrderCntLsb = 256;
+    OutputLog log;
+    int32_t output = 0;
+    clock_t start = clock();
+    for (int32_t i = 0; i < pictures; ++i) {
+        int32_t group = i / 3;
+        int32_t is_p = i % 3 == 0;
+        TestPicture test = {(uint32_t)((group + !is_p) % MAX_FRAME_NUM), (uint8_t)is_p, i == 0, 3, 0, 0, {0, 0}};
+        test.pic_order_cnt_lsb = (uint32_t)(is_p ? 6 * group : 6 * group - 6 + 2 * (i % 3)) & 255;
+
+        log.count = 0;
+        if (start_picture(ctx, &test, 0, &log, 0) < 0) {
+            fprintf(stderr, "benchmark: picture %d failed\n", i);
+            goto exit_flag;
+        }
+        output += log.count;
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("poc: %.0f pictures/s decoded and output (%d pictures, %d output, 2 reordered)\n", seconds > 0 ? pictures / seconds : 0.0, pictures, output);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (ctx) {
+        ctx->active_sps = 0;
+        free_context(ctx);
+    }
+    if (sps) {
+        free(sps);
+    }
+    return exit_code;
+}
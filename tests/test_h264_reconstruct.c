@@ -0,0 +1,533 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_context.h"
+#include "h264decoder/h264_frame.h"
+#include "h264decoder/h264_reconstruct.h"
+
+#include "h264_test_stream.h"
+
+/*
+ * reconstruction test: encodes a synthetic CAVLC stream of 1920x1088 frames in memory with one slice per picture, an IDR picture of I_PCM macroblocks, a P picture
+ * of skipped macroblocks, then P pictures mixing skipped macroblocks, P_L0_16x16 macroblocks with fractional motion vectors, Intra_4x4 macroblocks and Intra_16x16
+ * macroblocks with a DC coefficient. decodes it with the samples reconstructed on the decoding thread and on 2 to 16 wavefront workers, with and without the
+ * deblocking worker. checks that the IDR picture carries the PCM samples, that the skipped picture repeats it, and that every output frame carries the same samples
+ * for every number of workers. then reports the frames decoded per second of wall clock time for each configuration. last, decodes small streams of every chroma
+ * format at the bit depths 8 to 14, 10-bit 4:2:2 included, and checks the PCM, skipped, P_L0_16x16 and Intra_16x16 samples in the 8-bit and 16-bit planes
+ * against the values computed by hand.
+ *
+ * usage: test_h264_reconstruct [frames]
+ */
+
+#define WIDTH_IN_MBS 120
+#define HEIGHT_IN_MBS 68
+
+/* the PCM sample i of the macroblock mb of the IDR picture */
+static uint8_t pcm_sample(int32_t mb, int32_t i) { return (uint8_t)(128 + (mb + i) % 64); }
+
+/**
+ * @brief write the residual of a P_L0_16x16 macroblock with coded_block_pattern 1: one AC coefficient in the first 4x4 block, the other blocks of the 8x8 block
+ * are empty. the neighbouring blocks of the other macroblocks have no coefficients, so nC is 0 or 1 for every block
+ */
+static void put_inter_residual(BitWriter *w, int32_t sign) {
+    put_ue(w, 2);   /* coded_block_pattern 1 */
+    put_se(w, 0);   /* mb_qp_delta */
+    put_u(w, 1, 2); /* coeff_token: TrailingOnes 1, TotalCoeff 1 */
+    put_u(w, (uint32_t)sign, 1);
+    put_u(w, 3, 3); /* total_zeros 1, the coefficient is the first AC coefficient */
+    put_u(w, 7, 3); /* coeff_token of the other 3 blocks: TotalCoeff 0 */
+}
+
+/**
+ * @brief write picture n of the stream as one slice: the IDR picture, then the P pictures referring to the previous picture. the intra macroblocks inside the
+ * picture use every prediction mode, the ones on the edges use the DC prediction
+ */
+static int write_picture(Stream *stream, BitWriter *w, int32_t n) {
+    int is_idr = n == 0;
+
+    /* @see 7.3.3 Slice header syntax */
+    w->bits = 0;
+    put_ue(w, 0);
+    put_ue(w, is_idr ? 7 : 5);
+    put_ue(w, 0);
+    put_u(w, (uint32_t)n % 16, 4);
+    if (is_idr) {
+        put_ue(w, 0);
+    }
+    put_u(w, (uint32_t)(2 * n) % 64, 6);
+    if (!is_idr) {
+        put_u(w, 0, 1); /* num_ref_idx_active_override_flag */
+        put_u(w, 0, 1); /* ref_pic_list_modification_flag_l0 */
+    }
+    if (is_idr) {
+        put_u(w, 0, 1);
+        put_u(w, 0, 1);
+    } else {
+        put_u(w, 0, 1); /* adaptive_ref_pic_marking_mode_flag */
+    }
+    put_se(w, n % 3 - 1);
+    /* the deblocking filter leaves the I_PCM macroblocks and the skipped macroblocks as they are */
+    put_ue(w, 0); /* disable_deblocking_filter_idc */
+    put_se(w, 0);
+    put_se(w, 0);
+
+    /* @see 7.3.4 Slice data syntax */
+    uint32_t skip_run = 0;
+    for (int32_t mb = 0; mb < WIDTH_IN_MBS * HEIGHT_IN_MBS; ++mb) {
+        int inside = mb % WIDTH_IN_MBS > 0 && mb / WIDTH_IN_MBS > 0;
+
+        if (is_idr) {
+            put_ue(w, 25); /* I_PCM */
+            while (w->bits % 8) {
+                put_bit(w, 0);
+            }
+            for (int32_t i = 0; i < 384; ++i) {
+                put_u(w, pcm_sample(mb, i), 8);
+            }
+            continue;
+        }
+
+        if (n == 1 || (mb * 5 + n) % 7 == 0) {
+            skip_run++;
+            continue;
+        }
+        put_ue(w, skip_run);
+        skip_run = 0;
+
+        if (inside && (mb * 3 + n) % 13 == 1) {
+            /* I_NxN in a P slice: Intra_4x4 with the predicted or a signalled mode per block, without coded coefficients */
+            put_ue(w, 5);
+            for (int32_t blk = 0; blk < 16; ++blk) {
+                if ((mb + blk + n) % 3 == 0) {
+                    put_u(w, 1, 1);
+                } else {
+                    put_u(w, 0, 1);
+                    put_u(w, (uint32_t)(mb * 5 + blk + n) % 8, 3);
+                }
+            }
+            put_ue(w, (uint32_t)mb % 4); /* intra_chroma_pred_mode */
+            put_ue(w, 3);                /* coded_block_pattern 0 */
+            continue;
+        }
+
+        if ((mb * 3 + n) % 11 == 0) {
+            /* I_16x16_<mode>_0_0 in a P slice with one DC coefficient: coeff_token TrailingOnes 1 and TotalCoeff 1, then total_zeros 0 */
+            put_ue(w, 5 + 1 + (inside ? (uint32_t)mb % 4 : 2));
+            put_ue(w, inside ? (uint32_t)(mb / 4) % 4 : 0); /* intra_chroma_pred_mode */
+            put_se(w, (mb + n) % 5 - 2);
+            put_u(w, 1, 2);
+            put_u(w, (uint32_t)(mb + n) & 1, 1);
+            put_u(w, 1, 1);
+            continue;
+        }
+
+        put_ue(w, 0); /* P_L0_16x16 */
+        put_se(w, (mb * 7 + n) % 33 - 16);
+        put_se(w, (mb * 13 + n) % 17 - 8);
+        if ((mb + n) % 4 == 0) {
+            put_inter_residual(w, (mb + n) / 4 & 1);
+        } else {
+            put_ue(w, 0); /* coded_block_pattern 0 */
+        }
+    }
+    if (skip_run) {
+        put_ue(w, skip_run);
+    }
+
+    if (put_trailing_bits(w) < 0 || add_nalu(stream, is_idr ? 0x65 : 0x41, w) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief the output frame n carries the PCM samples of the IDR picture, the first two frames in the output order
+ */
+static int check_pcm_frame(const DecodedFrame *frame, int32_t n) {
+    if (frame->plane_count != 3) {
+        return -1;
+    }
+    for (int32_t mb = 0; mb < WIDTH_IN_MBS * HEIGHT_IN_MBS; ++mb) {
+        int32_t mb_x = mb % WIDTH_IN_MBS;
+        int32_t mb_y = mb / WIDTH_IN_MBS;
+        for (int32_t i = 0; i < 384; ++i) {
+            int32_t iCx = i < 256 ? 0 : 1 + (i - 256) / 64;
+            int32_t size = iCx ? 8 : 16;
+            int32_t k = iCx ? (i - 256) % 64 : i;
+            const SamplePlane *plane = &frame->planes[iCx];
+            if (plane->data[(size_t)(mb_y * size + k / size) * plane->stride + mb_x * size + k % size] != pcm_sample(mb, i)) {
+                fprintf(stderr, "reconstruct: frame %d sample %d of macroblock %d is not the PCM sample\n", n, i, mb);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief check the output frame, the first two frames in the output order carry the PCM samples
+ */
+static int check_output_frame(const DecodedFrame *frame, int32_t index) { return index < 2 ? check_pcm_frame(frame, index) : 0; }
+
+/* the geometry of the streams of the chroma formats and bit depths */
+#define FORMAT_WIDTH_IN_MBS 3
+#define FORMAT_HEIGHT_IN_MBS 2
+
+/* the DC levels of the luma, Cb and Cr Intra_16x16 blocks and of the first luma, Cb and Cr 4x4 inter blocks of the first macroblock of the format streams, the Cb
+ * and Cr levels are coded for 4:4:4 only */
+static const int32_t g_format_dc_levels[3] = {3, -2, 1};
+
+/* the motion vector of the P_L0_16x16 macroblocks of the format streams in luma samples, an integer sample position of the chroma too */
+#define FORMAT_MV 4
+
+/* the chroma format and the bit depth of the format stream being checked */
+static int32_t g_format[2];
+
+/* the PCM sample of the colour component iCx at ( x, y ) of the format streams, the low bits are set for the bit depths greater than 8 */
+static int32_t format_pcm_sample(int32_t bit_depth, int32_t iCx, int32_t x, int32_t y) {
+    return (((iCx * 64 + x * 3 + y * 5) % 256) << (bit_depth - 8)) | ((x + y) & ((1 << (bit_depth - 8)) - 1));
+}
+
+/**
+ * @brief write the slice header of picture n of a format stream: the IDR picture, the two P pictures and the second IDR picture
+ */
+static void put_format_slice_header(BitWriter *w, int32_t n) {
+    int is_idr = n % 3 == 0;
+
+    /* @see 7.3.3 Slice header syntax */
+    w->bits = 0;
+    put_ue(w, 0);
+    put_ue(w, is_idr ? 7 : 5);
+    put_ue(w, 0);
+    put_u(w, (uint32_t)n % 3, 4);
+    if (is_idr) {
+        put_ue(w, (uint32_t)n / 3); /* idr_pic_id */
+    }
+    put_u(w, (uint32_t)(n % 3) * 2, 6);
+    if (!is_idr) {
+        put_u(w, 0, 1); /* num_ref_idx_active_override_flag */
+        put_u(w, 0, 1); /* ref_pic_list_modification_flag_l0 */
+        put_u(w, 0, 1); /* adaptive_ref_pic_marking_mode_flag */
+    } else {
+        put_u(w, 0, 1);
+        put_u(w, 0, 1);
+    }
+    put_se(w, 2);  /* slice_qp_delta, QPY is 28 */
+    put_ue(w, 1); /* disable_deblocking_filter_idc */
+}
+
+/**
+ * @brief write the coefficient of one Intra_16x16 DC block with nC equal to 0: no coefficient, or the DC level c as the only coefficient
+ * @see 9.2 CAVLC parsing process for transform coefficient levels
+ */
+static void put_dc_block(BitWriter *w, int32_t c) {
+    if (!c) {
+        put_u(w, 1, 1); /* coeff_token: TotalCoeff 0 */
+        return;
+    }
+    if (c == 1 || c == -1) {
+        put_u(w, 1, 2); /* coeff_token: TrailingOnes 1, TotalCoeff 1 */
+        put_u(w, c < 0, 1);
+    } else {
+        put_u(w, 5, 6); /* coeff_token: TrailingOnes 0, TotalCoeff 1 */
+        /* levelCode of suffixLength 0 less 2 for the first level after less than 3 trailing ones, coded by level_prefix */
+        put_u(w, 1, (c > 0 ? 2 * c - 2 : -2 * c - 1) - 2 + 1);
+    }
+    put_u(w, 1, 1); /* total_zeros 0 */
+}
+
+/**
+ * @brief write the P_L0_16x16 macroblock mb of the inter picture of a format stream, with the motion vector ( FORMAT_MV, FORMAT_MV ) of every macroblock. only the
+ * first macroblock codes a motion vector difference, the prediction of the others is the motion vector of their neighbours. the first macroblock has
+ * coded_block_pattern 1 and the levels of g_format_dc_levels as the DC coefficients of its first 4x4 blocks, the neighbouring blocks of the others are empty
+ * @see 8.4.1.3 Derivation process for luma motion vector prediction
+ */
+static void put_format_inter_macroblock(BitWriter *w, int32_t mb, int32_t chroma_format_idc) {
+    put_ue(w, 0); /* mb_skip_run */
+    put_ue(w, 0); /* P_L0_16x16 */
+    put_se(w, mb ? 0 : FORMAT_MV * 4);
+    put_se(w, mb ? 0 : FORMAT_MV * 4);
+    if (mb) {
+        put_ue(w, 0); /* coded_block_pattern 0 */
+        return;
+    }
+
+    /* coded_block_pattern 1, Table 9-4 */
+    put_ue(w, chroma_format_idc == 1 || chroma_format_idc == 2 ? 2 : 1);
+    put_se(w, 0); /* mb_qp_delta */
+    for (int32_t iCx = 0; iCx < (chroma_format_idc == 3 ? 3 : 1); ++iCx) {
+        /* the 4x4 block coded like an Intra_16x16 DC block, nC is 0. then nC is 1 or 0 for the other 3 blocks of the 8x8 block: TotalCoeff 0 */
+        put_dc_block(w, g_format_dc_levels[iCx]);
+        put_u(w, 7, 3);
+    }
+}
+
+/**
+ * @brief write the format stream of the chroma format and the bit depth: an IDR picture of I_PCM macroblocks, a P picture of skipped macroblocks, a P picture of
+ * P_L0_16x16 macroblocks, and an IDR picture of Intra_16x16 macroblocks with the DC prediction whose first macroblock has the levels of g_format_dc_levels,
+ * without the deblocking filter
+ */
+static int write_format_stream(Stream *stream, BitWriter *w, int32_t chroma_format_idc, int32_t bit_depth) {
+    static const int32_t mb_widths_c[4] = {0, 8, 8, 16};
+    static const int32_t mb_heights_c[4] = {0, 8, 16, 16};
+    int32_t MbWidthC = mb_widths_c[chroma_format_idc];
+    int32_t MbHeightC = mb_heights_c[chroma_format_idc];
+
+    if (write_format_parameter_sets(stream, w, FORMAT_WIDTH_IN_MBS, FORMAT_HEIGHT_IN_MBS, chroma_format_idc, bit_depth) < 0) {
+        return -1;
+    }
+
+    for (int32_t n = 0; n < 4; ++n) {
+        put_format_slice_header(w, n);
+
+        for (int32_t mb = 0; mb < FORMAT_WIDTH_IN_MBS * FORMAT_HEIGHT_IN_MBS; ++mb) {
+            int32_t mb_x = mb % FORMAT_WIDTH_IN_MBS;
+            int32_t mb_y = mb / FORMAT_WIDTH_IN_MBS;
+
+            if (n == 1) {
+                put_ue(w, FORMAT_WIDTH_IN_MBS * FORMAT_HEIGHT_IN_MBS); /* mb_skip_run */
+                break;
+            }
+            if (n == 2) {
+                put_format_inter_macroblock(w, mb, chroma_format_idc);
+                continue;
+            }
+            if (n == 3) {
+                put_ue(w, 3); /* I_16x16_2_0_0, Intra_16x16 DC without AC coefficients */
+                if (chroma_format_idc == 1 || chroma_format_idc == 2) {
+                    put_ue(w, 0); /* intra_chroma_pred_mode DC */
+                }
+                put_se(w, 0); /* mb_qp_delta */
+                for (int32_t iCx = 0; iCx < (chroma_format_idc == 3 ? 3 : 1); ++iCx) {
+                    put_dc_block(w, mb ? 0 : g_format_dc_levels[iCx]);
+                }
+                continue;
+            }
+
+            put_ue(w, 25); /* I_PCM */
+            while (w->bits % 8) {
+                put_bit(w, 0);
+            }
+            for (int32_t i = 0; i < 256; ++i) {
+                put_u(w, (uint32_t)format_pcm_sample(bit_depth, 0, mb_x * 16 + i % 16, mb_y * 16 + i / 16), bit_depth);
+            }
+            for (int32_t i = 0; i < 2 * MbWidthC * MbHeightC; ++i) {
+                int32_t k = i % (MbWidthC * MbHeightC);
+                put_u(w, (uint32_t)format_pcm_sample(bit_depth, 1 + i / (MbWidthC * MbHeightC), mb_x * MbWidthC + k % MbWidthC, mb_y * MbHeightC + k / MbWidthC),
+                      bit_depth);
+            }
+        }
+
+        if (put_trailing_bits(w) < 0 || add_nalu(stream, n % 3 ? 0x41 : 0x65, w) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief the first two output frames of a format stream carry the PCM samples. the third one carries the PCM samples at ( x + FORMAT_MV, y + FORMAT_MV ) in
+ * luma samples, clamped to the picture, and the DC level c of a first 4x4 block adds 4 * c << ( bit_depth - 8 ) to its 16 samples. in the fourth one, the DC
+ * level c of the first macroblock adds c << ( bit_depth - 8 ) to the samples 1 << ( bit_depth - 1 ) of the DC prediction, which the other macroblocks predict
+ * from it
+ * @see 8.5.10 Scaling and transformation process for DC transform coefficients for Intra_16x16 macroblock type, qP % 6 is 4 and LevelScale4x4( 4, 0, 0 ) is 256
+ * @see 8.5.12 Scaling and transformation process for residual 4x4 blocks, qP / 6 is 4 plus ( bit_depth - 8 ) and ( 256 * c + 32 ) >> 6 is 4 * c
+ */
+static int check_format_frame(const DecodedFrame *frame, int32_t index) {
+    int32_t chroma_format_idc = g_format[0];
+    int32_t bit_depth = g_format[1];
+    int32_t plane_count = chroma_format_idc ? 3 : 1;
+
+    if (frame->plane_count != plane_count) {
+        fprintf(stderr, "reconstruct: %d planes of chroma_format_idc %d\n", frame->plane_count, chroma_format_idc);
+        return -1;
+    }
+    for (int32_t iCx = 0; iCx < plane_count; ++iCx) {
+        const SamplePlane *plane = &frame->planes[iCx];
+        if (plane->bytes_per_sample != (bit_depth > 8 ? 2 : 1)) {
+            fprintf(stderr, "reconstruct: %d bytes per sample of the bit depth %d\n", plane->bytes_per_sample, bit_depth);
+            return -1;
+        }
+
+        for (int32_t y = 0; y < plane->height; ++y) {
+            for (int32_t x = 0; x < plane->width; ++x) {
+                size_t offset = (size_t)y * plane->stride + x;
+                int32_t sample = plane->bytes_per_sample == 2 ? ((const uint16_t *)plane->data)[offset] : plane->data[offset];
+                int32_t expected = format_pcm_sample(bit_depth, iCx, x, y);
+                if (index == 2) {
+                    /* the motion vector in the samples of the plane, 8.4.1.4 */
+                    int32_t mv_x = FORMAT_MV * plane->width / (FORMAT_WIDTH_IN_MBS * 16);
+                    int32_t mv_y = FORMAT_MV * plane->height / (FORMAT_HEIGHT_IN_MBS * 16);
+                    int32_t ref_x = x + mv_x < plane->width ? x + mv_x : plane->width - 1;
+                    int32_t ref_y = y + mv_y < plane->height ? y + mv_y : plane->height - 1;
+                    int32_t c = x < 4 && y < 4 && (iCx == 0 || chroma_format_idc == 3) ? g_format_dc_levels[iCx] : 0;
+                    expected = format_pcm_sample(bit_depth, iCx, ref_x, ref_y) + 4 * c * (1 << (bit_depth - 8));
+                    expected = expected < 0 ? 0 : expected > (1 << bit_depth) - 1 ? (1 << bit_depth) - 1 : expected;
+                }
+                if (index == 3) {
+                    int32_t c = iCx == 0 || chroma_format_idc == 3 ? g_format_dc_levels[iCx] : 0;
+                    expected = (1 << (bit_depth - 1)) + c * (1 << (bit_depth - 8));
+                }
+                if (sample != expected) {
+                    fprintf(stderr, "reconstruct: chroma_format_idc %d, bit depth %d: frame %d sample ( %d, %d ) of plane %d is %d, %d expected\n", chroma_format_idc,
+                            bit_depth, index, x, y, iCx, sample, expected);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief decode the format streams of the chroma formats and the bit depths on the decoding thread and on the wavefront workers, and check their samples
+ *
+ * @return int 0 on success, negative value on error
+ */
+static int check_formats(void) {
+    static const int32_t formats[][2] = {{1, 8}, {0, 8}, {2, 8}, {3, 8}, {1, 10}, {2, 10}, {3, 10}, {0, 12}, {2, 14}};
+    static const int32_t thread_counts[2] = {1, 4};
+
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+        Stream stream;
+        BitWriter writer;
+        memset(&stream, 0, sizeof(Stream));
+        memset(&writer, 0, sizeof(BitWriter));
+        g_format[0] = formats[i][0];
+        g_format[1] = formats[i][1];
+
+        int32_t count = write_format_stream(&stream, &writer, formats[i][0], formats[i][1]) < 0 ? -1 : 0;
+        for (int32_t t = 0; t < 2 && count >= 0; ++t) {
+            H264Context *ctx = create_context();
+            uint64_t hash;
+            if (!ctx || set_reconstruction_threads(ctx, thread_counts[t]) < 0) {
+                count = -1;
+            } else {
+                count = decode_test_stream(ctx, &stream, "reconstruct", TEST_HASH_SAMPLES, &hash, 1, check_format_frame);
+            }
+            if (ctx) {
+                free_context(ctx);
+            }
+            if (count != 4) {
+                fprintf(stderr, "reconstruct: chroma_format_idc %d, bit depth %d: %d frames output with %d threads\n", formats[i][0], formats[i][1], count,
+                        thread_counts[t]);
+                count = -1;
+            }
+        }
+
+        free_stream(&stream);
+        free(writer.buffer);
+        if (count < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief decode the stream with the reconstruction workers, the checksums of the output frames are written in the output order
+ *
+ * @return int32_t the number of the output frames, -1 on error
+ */
+static int32_t decode_stream(const Stream *stream, int32_t thread_count, int deblock_thread, uint64_t *hashes, int32_t max_frames) {
+    int32_t count = -1;
+
+    H264Context *ctx = create_context();
+    if (!ctx) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    if (set_reconstruction_threads(ctx, thread_count) < 0 || set_deblock_thread_enabled(ctx, deblock_thread) < 0) {
+        fprintf(stderr, "reconstruct: %d threads not created\n", thread_count);
+        goto exit_flag;
+    }
+    count = decode_test_stream(ctx, stream, "reconstruct", TEST_HASH_SAMPLES, hashes, max_frames, check_output_frame);
+
+exit_flag:
+    free_context(ctx);
+    return count;
+}
+
+int main(int argc, char **argv) {
+    /* the number of the reconstruction threads and whether the deblocking worker runs */
+    static const int32_t configs[][2] = {{1, 0}, {1, 1}, {2, 0}, {4, 1}, {8, 0}, {16, 1}};
+    int exit_code = EXIT_FAILURE;
+    int32_t frames = 17;
+    Stream stream;
+    BitWriter writer;
+    uint64_t *expected = 0;
+    uint64_t *hashes = 0;
+
+    memset(&stream, 0, sizeof(Stream));
+    memset(&writer, 0, sizeof(BitWriter));
+
+    if (argc > 1) {
+        frames = atoi(argv[1]);
+    }
+    if (frames < 3) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    expected = (uint64_t *)malloc(frames * sizeof(uint64_t));
+    hashes = (uint64_t *)malloc(frames * sizeof(uint64_t));
+    if (!expected || !hashes || write_parameter_sets(&stream, &writer, WIDTH_IN_MBS, HEIGHT_IN_MBS) < 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    for (int32_t n = 0; n < frames; ++n) {
+        if (write_picture(&stream, &writer, n) < 0) {
+            fprintf(stderr, "Memory allocation failed\n");
+            goto exit_flag;
+        }
+    }
+
+    /* verify and benchmark: the decoding thread first, its output frames are the reference of the workers */
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); ++i) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int32_t count = decode_stream(&stream, configs[i][0], configs[i][1], i ? hashes : expected, frames);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (count != frames) {
+            fprintf(stderr, "reconstruct: %d of %d frames output with %d threads\n", count, frames, configs[i][0]);
+            goto exit_flag;
+        }
+        if (!i && expected[2] == expected[1]) {
+            fprintf(stderr, "reconstruct: the P pictures are not reconstructed\n");
+            goto exit_flag;
+        }
+        if (i && memcmp(hashes, expected, frames * sizeof(uint64_t))) {
+            fprintf(stderr, "reconstruct: the frames reconstructed with %d threads differ\n", configs[i][0]);
+            goto exit_flag;
+        }
+
+        /* wall clock time, the CPU time of the process adds up the threads */
+        double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("reconstruct: %2d threads%s, %.1f frames/s (%d frames of %dx%d)\n", configs[i][0], configs[i][1] ? " + deblocking worker" : "",
+               seconds > 0 ? frames / seconds : 0.0, frames, WIDTH_IN_MBS * 16, HEIGHT_IN_MBS * 16);
+    }
+    printf("reconstruct: wavefront samples verified\n");
+
+    if (check_formats() < 0) {
+        goto exit_flag;
+    }
+    printf("reconstruct: the chroma formats 4:0:0 to 4:4:4 of the bit depths 8 to 14 verified\n");
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (expected) {
+        free(expected);
+    }
+    if (hashes) {
+        free(hashes);
+    }
+    free_stream(&stream);
+    if (writer.buffer) {
+        free(writer.buffer);
+    }
+    return exit_code;
+}
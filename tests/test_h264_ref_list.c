@@ -0,0 +1,389 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_context.h"
+#include "h264decoder/h264_ref_list.h"
+
+/*
+ * reference picture list test: starts the pictures of synthetic slice headers on a context and constructs the reference picture lists of their slices. checks the
+ * initial lists of the P and B slices in frames and fields, the truncation to num_ref_idx_lX_active_minus1 + 1 entries, the modification of the short-term and
+ * long-term entries and that the slices of a picture share the initial lists. then reports the slices constructed per second with the shared initial lists and
+ * with the lists built for every slice.
+ *
+ * usage: test_h264_ref_list [slices]
+ */
+
+#define MAX_FRAME_NUM 16
+#define SLICES_PER_PICTURE 68
+
+/* an expected entry of a reference picture list: FrameNum of the frame store, 3 for a frame, 1 for a top field and 2 for a bottom field, and the long-term flag */
+typedef struct {
+    int32_t FrameNum;
+    int32_t structure;
+    uint8_t long_term;
+} ExpectedEntry;
+
+static void set_test_sps(SPS *sps) {
+    memset(sps, 0, sizeof(SPS));
+    sps->PicWidthInMbs = 2;
+    sps->FrameHeightInMbs = 2;
+    sps->frame_mbs_only_flag = 0;
+    sps->MaxDpbFrames = 8;
+    sps->max_num_ref_frames = 5;
+    sps->MaxFrameNum = MAX_FRAME_NUM;
+    sps->chroma_format_idc = 1;
+    sps->ChromaArrayType = 1;
+    sps->SubWidthC = 2;
+    sps->SubHeightC = 2;
+    sps->MbWidthC = 8;
+    sps->MbHeightC = 8;
+    sps->BitDepthY = 8;
+    sps->BitDepthC = 8;
+
+    sps->pic_order_cnt_type = 0;
+    sps->MaxPicOrderCntLsb = 64;
+}
+
+/**
+ * @brief start a picture on the context as the first slice of it would, the previous picture is marked and stored. structure is 3 for a frame, 1 for a top
+ * field and 2 for a bottom field
+ */
+static int start_picture(H264Context *ctx, uint32_t frame_num, uint8_t nal_ref_idc, uint8_t idr, int32_t structure, uint32_t poc_lsb, SliceHeader **out_header,
+                         Picture **out_picture) {
+    SliceHeader *header = 0;
+    Picture *pic = 0;
+
+    get_slice_header(ctx, &header);
+    header->nalu_header.nal_ref_idc = nal_ref_idc;
+    header->nalu_header.IdrPicFlag = idr;
+    header->slice_type = idr ? SLICE_TYPE_I : SLICE_TYPE_P;
+    header->frame_num = frame_num;
+    header->field_pic_flag = structure != 3;
+    header->bottom_field_flag = structure == 2;
+    header->pic_order_cnt_lsb = poc_lsb;
+    header->sps = ctx->active_sps;
+
+    int err_code = get_picture_from_context(ctx, 1, &pic);
+    if (err_code < 0) {
+        return err_code;
+    }
+
+    /* the state set_picture_structure() sets */
+    pic->decoded_fields |= (uint8_t)structure;
+
+    for (Picture *out = get_output_picture(ctx); out; out = get_output_picture(ctx)) {
+        release_output_picture(ctx, out);
+    }
+    if (out_header) {
+        *out_header = header;
+    }
+    if (out_picture) {
+        *out_picture = pic;
+    }
+    return ERR_OK;
+}
+
+/**
+ * @brief compare a reference picture list with the expected entries, the entries beyond them MUST be empty
+ */
+static int check_list(const char *step, const RefPicLists *lists, int32_t list, const ExpectedEntry *expected, int32_t count) {
+    for (int32_t i = 0; i < lists->num[list]; ++i) {
+        const RefPicEntry *entry = &lists->entries[list][i];
+        if (i >= count) {
+            if (entry->ff) {
+                fprintf(stderr, "%s: RefPicList%d[%d] is set, expected no reference picture\n", step, list, i);
+                return -1;
+            }
+            continue;
+        }
+
+        const Picture *pic = entry->ff ? entry->ff->parent : 0;
+        int32_t structure = !pic ? 0 : (entry->ff == pic->frame ? 3 : (entry->ff == pic->top_field ? 1 : 2));
+        if (!pic || pic->FrameNum != expected[i].FrameNum || structure != expected[i].structure || entry->long_term != expected[i].long_term ||
+            entry->poc != entry->ff->poc) {
+            fprintf(stderr, "%s: RefPicList%d[%d] is FrameNum %d structure %d, expected FrameNum %d structure %d long-term %d\n", step, list, i,
+                    pic ? pic->FrameNum : -1, structure, expected[i].FrameNum, expected[i].structure, expected[i].long_term);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#define CHECK(step, lists, list, ...)                                                                              \
+    do {                                                                                                           \
+        const ExpectedEntry expected[] = {__VA_ARGS__};                                                            \
+        if (check_list(step, lists, list, expected, (int32_t)(sizeof(expected) / sizeof(expected[0]))) < 0) {      \
+            return -1;                                                                                             \
+        }                                                                                                          \
+    } while (0)
+
+static void add_modification(RPLM *rplm, int32_t list, uint32_t idc, uint32_t value) {
+    if (list == 0) {
+        rplm->ref_pic_list_modification_flag_l0 = 1;
+        rplm->rplm_l0[rplm->rplm_l0_len].modification_of_pic_nums_idc = idc;
+        rplm->rplm_l0[rplm->rplm_l0_len].abs_diff_pic_num_minus1 = value;
+        rplm->rplm_l0[rplm->rplm_l0_len].long_term_pic_num = value;
+        rplm->rplm_l0_len++;
+    } else {
+        rplm->ref_pic_list_modification_flag_l1 = 1;
+        rplm->rplm_l1[rplm->rplm_l1_len].modification_of_pic_nums_idc = idc;
+        rplm->rplm_l1[rplm->rplm_l1_len].abs_diff_pic_num_minus1 = value;
+        rplm->rplm_l1[rplm->rplm_l1_len].long_term_pic_num = value;
+        rplm->rplm_l1_len++;
+    }
+}
+
+/**
+ * @brief P frames: the short-term frames by descending PicNum then the long-term frames, truncation and padding, modification and the shared initial list
+ */
+static int check_p_frames(H264Context *ctx) {
+    SliceHeader *header = 0;
+    Picture *pic = 0;
+    RefPicLists lists;
+
+    /* the IDR frame becomes the long-term frame 0, the frames 1 to 4 are short-term */
+    if (start_picture(ctx, 0, 1, 1, 3, 0, &header, 0) < 0) {
+        return -1;
+    }
+    header->dec_ref_pic_mark.long_term_reference_flag = 1;
+    for (uint32_t n = 1; n <= 5; ++n) {
+        if (start_picture(ctx, n, 1, 0, 3, 2 * n, &header, &pic) < 0) {
+            return -1;
+        }
+    }
+
+    header->num_ref_idx_l0_active_minus1 = 4;
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+        return -1;
+    }
+    CHECK("p frames initial", &lists, 0, {4, 3, 0}, {3, 3, 0}, {2, 3, 0}, {1, 3, 0}, {0, 3, 1});
+
+    uint32_t init_count = ctx->ref_list_cache.init_count;
+
+    /* the later slices truncate the shared list or leave the entries beyond it empty */
+    header->num_ref_idx_l0_active_minus1 = 1;
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+        return -1;
+    }
+    CHECK("p frames truncated", &lists, 0, {4, 3, 0}, {3, 3, 0});
+
+    header->num_ref_idx_l0_active_minus1 = 6;
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+        return -1;
+    }
+    CHECK("p frames padded", &lists, 0, {4, 3, 0}, {3, 3, 0}, {2, 3, 0}, {1, 3, 0}, {0, 3, 1});
+
+    /* picNumL0 = 5 - 3 = 2 is moved to the front, then LongTermPicNum 0 follows it */
+    header->num_ref_idx_l0_active_minus1 = 4;
+    add_modification(&header->rplm, 0, 0, 2);
+    add_modification(&header->rplm, 0, 2, 0);
+    add_modification(&header->rplm, 0, 3, 0);
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+        return -1;
+    }
+    CHECK("p frames modified", &lists, 0, {2, 3, 0}, {0, 3, 1}, {4, 3, 0}, {3, 3, 0}, {1, 3, 0});
+
+    /* picNumL0Pred wraps: 5 + 12 wraps to PicNum 1, then 1 - 2 wraps to 15 which is PicNum -1 of no frame */
+    memset(&header->rplm, 0, sizeof(RPLM));
+    add_modification(&header->rplm, 0, 1, 11);
+    add_modification(&header->rplm, 0, 0, 1);
+    add_modification(&header->rplm, 0, 3, 0);
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) != ERR_INVALID_REF_PIC_LIST_PARAM) {
+        fprintf(stderr, "p frames: the modification to a missing picture is accepted\n");
+        return -1;
+    }
+    memset(&header->rplm, 0, sizeof(RPLM));
+
+    if (ctx->ref_list_cache.init_count != init_count) {
+        fprintf(stderr, "p frames: the initial list is built %u times for one picture\n", ctx->ref_list_cache.init_count);
+        return -1;
+    }
+
+    printf("ref list: P frames initial, truncated and modified lists verified\n");
+    return 0;
+}
+
+/**
+ * @brief B frames: the lists ordered by POC around the current picture and the switch of RefPicList1 identical to RefPicList0
+ */
+static int check_b_frames(H264Context *ctx) {
+    SliceHeader *header = 0;
+    Picture *pic = 0;
+    RefPicLists lists;
+
+    /* the reference frames with POC 0, 8 and 4 */
+    const uint32_t pocs[3] = {0, 8, 4};
+    for (uint32_t n = 0; n < 3; ++n) {
+        if (start_picture(ctx, n, 1, n == 0, 3, pocs[n], 0, 0) < 0) {
+            return -1;
+        }
+    }
+
+    /* POC 2 */
+    if (start_picture(ctx, 3, 0, 0, 3, 2, &header, &pic) < 0) {
+        return -1;
+    }
+    header->slice_type = SLICE_TYPE_B;
+    header->num_ref_idx_l0_active_minus1 = 2;
+    header->num_ref_idx_l1_active_minus1 = 2;
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+        return -1;
+    }
+    CHECK("b frames poc 2 list 0", &lists, 0, {0, 3, 0}, {2, 3, 0}, {1, 3, 0});
+    CHECK("b frames poc 2 list 1", &lists, 1, {2, 3, 0}, {1, 3, 0}, {0, 3, 0});
+
+    /* POC 6, RefPicList1 is modified on its own */
+    if (start_picture(ctx, 3, 0, 0, 3, 6, &header, &pic) < 0) {
+        return -1;
+    }
+    header->slice_type = SLICE_TYPE_B;
+    header->num_ref_idx_l0_active_minus1 = 2;
+    header->num_ref_idx_l1_active_minus1 = 1;
+    add_modification(&header->rplm, 1, 0, 2);
+    add_modification(&header->rplm, 1, 3, 0);
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+        return -1;
+    }
+    CHECK("b frames poc 6 list 0", &lists, 0, {2, 3, 0}, {0, 3, 0}, {1, 3, 0});
+    CHECK("b frames poc 6 list 1", &lists, 1, {0, 3, 0}, {1, 3, 0});
+
+    /* POC 10 follows all the reference frames, RefPicList1 would equal RefPicList0 */
+    if (start_picture(ctx, 3, 0, 0, 3, 10, &header, &pic) < 0) {
+        return -1;
+    }
+    header->slice_type = SLICE_TYPE_B;
+    header->num_ref_idx_l0_active_minus1 = 2;
+    header->num_ref_idx_l1_active_minus1 = 2;
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+        return -1;
+    }
+    CHECK("b frames poc 10 list 0", &lists, 0, {1, 3, 0}, {2, 3, 0}, {0, 3, 0});
+    CHECK("b frames poc 10 list 1", &lists, 1, {2, 3, 0}, {1, 3, 0}, {0, 3, 0});
+
+    printf("ref list: B frames POC order and list 1 switch verified\n");
+    return 0;
+}
+
+/**
+ * @brief P fields: the fields alternate from the parity of the current field, the first field of the current frame is a reference of the second field
+ */
+static int check_p_fields(H264Context *ctx) {
+    SliceHeader *header = 0;
+    Picture *pic = 0;
+    RefPicLists lists;
+
+    /* the field pairs with frame_num 0 and 1 */
+    if (start_picture(ctx, 0, 1, 1, 1, 0, 0, 0) < 0 || start_picture(ctx, 0, 1, 0, 2, 1, 0, 0) < 0 || start_picture(ctx, 1, 1, 0, 1, 4, 0, 0) < 0 ||
+        start_picture(ctx, 1, 1, 0, 2, 5, 0, 0) < 0) {
+        return -1;
+    }
+
+    if (start_picture(ctx, 2, 1, 0, 1, 8, &header, &pic) < 0) {
+        return -1;
+    }
+    header->num_ref_idx_l0_active_minus1 = 3;
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+        return -1;
+    }
+    CHECK("p fields top", &lists, 0, {1, 1, 0}, {1, 2, 0}, {0, 1, 0}, {0, 2, 0});
+
+    if (start_picture(ctx, 2, 1, 0, 2, 9, &header, &pic) < 0) {
+        return -1;
+    }
+    header->num_ref_idx_l0_active_minus1 = 4;
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+        return -1;
+    }
+    CHECK("p fields bottom", &lists, 0, {1, 2, 0}, {2, 1, 0}, {0, 2, 0}, {1, 1, 0}, {0, 1, 0});
+
+    /* CurrPicNum is 5, the top field of the current frame has PicNum 4 */
+    add_modification(&header->rplm, 0, 0, 0);
+    add_modification(&header->rplm, 0, 3, 0);
+    if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+        return -1;
+    }
+    CHECK("p fields modified", &lists, 0, {2, 1, 0}, {1, 2, 0}, {0, 2, 0}, {1, 1, 0}, {0, 1, 0});
+
+    printf("ref list: P fields alternating parities and modification verified\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t slices = 1000000;
+    H264Context *ctx = 0;
+    SPS *sps = 0;
+
+    if (argc > 1) {
+        slices = atoi(argv[1]);
+    }
+    if (slices <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    ctx = create_context();
+    sps = (SPS *)malloc(sizeof(SPS));
+    if (!ctx || !sps) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    set_test_sps(sps);
+    ctx->active_sps = sps;
+
+    /* verify */
+    if (check_p_frames(ctx) < 0 || check_b_frames(ctx) < 0 || check_p_fields(ctx) < 0) {
+        goto exit_flag;
+    }
+
+    /* benchmark: the B slices of one row each on a picture with 4 past and 4 future reference frames, the lists are shared or built for every slice */
+    SliceHeader *header = 0;
+    Picture *pic = 0;
+    RefPicLists lists;
+    const uint32_t pocs[8] = {0, 32, 16, 8, 24, 4, 12, 20};
+    sps->max_num_ref_frames = 8;
+    for (uint32_t n = 0; n < 8; ++n) {
+        if (start_picture(ctx, n, 1, n == 0, 3, pocs[n], 0, 0) < 0) {
+            goto exit_flag;
+        }
+    }
+    if (start_picture(ctx, 8, 0, 0, 3, 14, &header, &pic) < 0) {
+        goto exit_flag;
+    }
+    header->slice_type = SLICE_TYPE_B;
+    header->num_ref_idx_l0_active_minus1 = 3;
+    header->num_ref_idx_l1_active_minus1 = 3;
+
+    double rates[2];
+    for (int32_t shared = 1; shared >= 0; --shared) {
+        clock_t start = clock();
+        for (int32_t i = 0; i < slices; ++i) {
+            if (!shared || i % SLICES_PER_PICTURE == 0) {
+                reset_ref_pic_list_cache(&ctx->ref_list_cache);
+            }
+            if (construct_ref_pic_lists(&ctx->ref_list_cache, &ctx->dpb, pic, header, &lists) < 0) {
+                fprintf(stderr, "benchmark: slice %d failed\n", i);
+                goto exit_flag;
+            }
+        }
+        double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        rates[shared] = seconds > 0 ? slices / seconds : 0.0;
+    }
+    printf("ref list: %.0f slices/s with the lists shared by %d slices, %.0f slices/s with the lists built per slice\n", rates[1], SLICES_PER_PICTURE,
+           rates[0]);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (ctx) {
+        ctx->active_sps = 0;
+        free_context(ctx);
+    }
+    if (sps) {
+        free(sps);
+    }
+    return exit_code;
+}
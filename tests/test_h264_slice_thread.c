@@ -0,0 +1,237 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_context.h"
+#include "h264decoder/h264_frame.h"
+#include "h264decoder/h264_slice_thread.h"
+
+#include "h264_test_stream.h"
+
+/*
+ * slice threading test: encodes a synthetic CAVLC stream of 1920x1088 frames in memory with 8 slices per picture which start in the middle of the macroblock rows,
+ * an IDR picture of I_PCM macroblocks, a P picture of skipped macroblocks whose slices start with an Intra_16x16 macroblock, then P pictures mixing skipped
+ * macroblocks, P_L0_16x16 macroblocks with varying motion vectors and Intra_16x16 macroblocks with varying mb_qp_delta. decodes it on the decoding thread and
+ * with 2 to 16 slice threads, the samples reconstructed on the decoding thread. checks that the IDR picture carries the PCM samples, that the skipped picture
+ * repeats them around the DC predicted first macroblocks of its slices, and that every output frame carries the same picture order count, macroblock types, QPY,
+ * reference indices, motion vectors and samples. then reports the frames decoded per second of wall clock time for each number of threads.
+ *
+ * usage: test_h264_slice_thread [frames]
+ */
+
+#define WIDTH_IN_MBS 120
+#define HEIGHT_IN_MBS 68
+#define SLICES_PER_PICTURE 8
+#define MBS_PER_SLICE (WIDTH_IN_MBS * HEIGHT_IN_MBS / SLICES_PER_PICTURE)
+
+/* the PCM sample i of the macroblock mb of the IDR picture */
+static uint8_t pcm_sample(int32_t mb, int32_t i) { return (uint8_t)(128 + (mb + i) % 64); }
+
+/**
+ * @brief write picture n of the stream: the IDR picture, then the P pictures referring to the previous picture. the slices split the macroblock rows, so the
+ * macroblocks next to a slice boundary predict their motion vectors and QPY without the neighbours of the other slice
+ */
+static int write_picture(Stream *stream, BitWriter *w, int32_t n) {
+    int is_idr = n == 0;
+
+    for (int32_t slice = 0; slice < SLICES_PER_PICTURE; ++slice) {
+        int32_t first_mb = slice * MBS_PER_SLICE;
+
+        /* @see 7.3.3 Slice header syntax */
+        w->bits = 0;
+        put_ue(w, (uint32_t)first_mb);
+        put_ue(w, is_idr ? 7 : 5);
+        put_ue(w, 0);
+        put_u(w, (uint32_t)n % 16, 4);
+        if (is_idr) {
+            put_ue(w, 0);
+        }
+        put_u(w, (uint32_t)(2 * n) % 64, 6);
+        if (!is_idr) {
+            put_u(w, 0, 1); /* num_ref_idx_active_override_flag */
+            put_u(w, 0, 1); /* ref_pic_list_modification_flag_l0 */
+        }
+        if (is_idr) {
+            put_u(w, 0, 1);
+            put_u(w, 0, 1);
+        } else {
+            put_u(w, 0, 1); /* adaptive_ref_pic_marking_mode_flag */
+        }
+        put_se(w, slice % 3 - 1);
+        put_ue(w, 1); /* disable_deblocking_filter_idc */
+
+        /* @see 7.3.4 Slice data syntax */
+        uint32_t skip_run = 0;
+        for (int32_t mb = first_mb; mb < first_mb + MBS_PER_SLICE; ++mb) {
+            if (is_idr) {
+                put_ue(w, 25); /* I_PCM */
+                while (w->bits % 8) {
+                    put_bit(w, 0);
+                }
+                for (int32_t i = 0; i < 384; ++i) {
+                    put_u(w, pcm_sample(mb, i), 8);
+                }
+                continue;
+            }
+
+            if (n == 1 ? mb > first_mb : (mb * 5 + n) % 7 == 0) {
+                skip_run++;
+                continue;
+            }
+            put_ue(w, skip_run);
+            skip_run = 0;
+
+            if (n == 1 || (mb * 3 + n) % 11 == 0) {
+                /* I_16x16_2_0_0 in a P slice: Intra_16x16 DC prediction without coded AC coefficients */
+                put_ue(w, 5 + 3);
+                put_ue(w, 0); /* intra_chroma_pred_mode */
+                put_se(w, (mb + n) % 5 - 2);
+                /* coeff_token of Intra16x16DCLevel with TotalCoeff 0, the neighbouring blocks have no coefficients so nC is 0 */
+                put_u(w, 1, 1);
+                continue;
+            }
+
+            put_ue(w, 0); /* P_L0_16x16 */
+            put_se(w, (mb * 7 + n) % 33 - 16);
+            put_se(w, (mb * 13 + n) % 17 - 8);
+            put_ue(w, 0); /* coded_block_pattern 0 */
+        }
+        if (skip_run) {
+            put_ue(w, skip_run);
+        }
+
+        if (put_trailing_bits(w) < 0 || add_nalu(stream, is_idr ? 0x65 : 0x41, w) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief the first two output frames carry the PCM samples of the IDR picture, except the first macroblocks of the slices of the second one. their neighbours lie
+ * in the previous slices, so the Intra_16x16 and chroma DC predictions are 128
+ * @see 8.3.3.3 Specification of Intra_16x16_DC prediction mode
+ */
+static int check_output_frame(const DecodedFrame *frame, int32_t index) {
+    if (index >= 2) {
+        return 0;
+    }
+    if (frame->plane_count != 3) {
+        fprintf(stderr, "slice thread: %d planes output\n", frame->plane_count);
+        return -1;
+    }
+    for (int32_t mb = 0; mb < WIDTH_IN_MBS * HEIGHT_IN_MBS; ++mb) {
+        int32_t mb_x = mb % WIDTH_IN_MBS;
+        int32_t mb_y = mb / WIDTH_IN_MBS;
+        for (int32_t i = 0; i < 384; ++i) {
+            int32_t iCx = i < 256 ? 0 : 1 + (i - 256) / 64;
+            int32_t size = iCx ? 8 : 16;
+            int32_t k = iCx ? (i - 256) % 64 : i;
+            const SamplePlane *plane = &frame->planes[iCx];
+            int32_t expected = index == 1 && mb % MBS_PER_SLICE == 0 ? 128 : pcm_sample(mb, i);
+            if (plane->data[(size_t)(mb_y * size + k / size) * plane->stride + mb_x * size + k % size] != expected) {
+                fprintf(stderr, "slice thread: frame %d sample %d of macroblock %d is not %d\n", index, i, mb, expected);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief decode the stream with the slice threads, the checksums of the output frames are written in the output order
+ *
+ * @return int32_t the number of the output frames, -1 on error
+ */
+static int32_t decode_stream(const Stream *stream, int32_t thread_count, uint64_t *hashes, int32_t max_frames) {
+    int32_t count = -1;
+
+    H264Context *ctx = create_context();
+    if (!ctx) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    if (set_slice_threads(ctx, thread_count) < 0) {
+        fprintf(stderr, "slice thread: %d threads not created\n", thread_count);
+        goto exit_flag;
+    }
+    count = decode_test_stream(ctx, stream, "slice thread", TEST_HASH_MB_TYPES | TEST_HASH_QPS | TEST_HASH_MOTION | TEST_HASH_SAMPLES, hashes, max_frames,
+                               check_output_frame);
+
+exit_flag:
+    free_context(ctx);
+    return count;
+}
+
+int main(int argc, char **argv) {
+    static const int32_t thread_counts[] = {1, 2, 4, 8, 16};
+    int exit_code = EXIT_FAILURE;
+    int32_t frames = 33;
+    Stream stream;
+    BitWriter writer;
+    uint64_t *expected = 0;
+    uint64_t *hashes = 0;
+
+    memset(&stream, 0, sizeof(Stream));
+    memset(&writer, 0, sizeof(BitWriter));
+
+    if (argc > 1) {
+        frames = atoi(argv[1]);
+    }
+    if (frames <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    expected = (uint64_t *)malloc(frames * sizeof(uint64_t));
+    hashes = (uint64_t *)malloc(frames * sizeof(uint64_t));
+    if (!expected || !hashes || write_parameter_sets(&stream, &writer, WIDTH_IN_MBS, HEIGHT_IN_MBS) < 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+    for (int32_t n = 0; n < frames; ++n) {
+        if (write_picture(&stream, &writer, n) < 0) {
+            fprintf(stderr, "Memory allocation failed\n");
+            goto exit_flag;
+        }
+    }
+
+    /* verify and benchmark: the decoding thread first, its output frames are the reference of the slice threads */
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); ++i) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int32_t count = decode_stream(&stream, thread_counts[i], i ? hashes : expected, frames);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (count != frames) {
+            fprintf(stderr, "slice thread: %d of %d frames output with %d threads\n", count, frames, thread_counts[i]);
+            goto exit_flag;
+        }
+        if (i && memcmp(hashes, expected, frames * sizeof(uint64_t))) {
+            fprintf(stderr, "slice thread: the frames decoded with %d threads differ\n", thread_counts[i]);
+            goto exit_flag;
+        }
+
+        /* wall clock time, the CPU time of the process adds up the threads */
+        double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("slice thread: %2d threads, %.1f frames/s (%d frames of %dx%d)\n", thread_counts[i], seconds > 0 ? frames / seconds : 0.0, frames,
+               WIDTH_IN_MBS * 16, HEIGHT_IN_MBS * 16);
+    }
+    printf("slice thread: %d slices per picture verified\n", SLICES_PER_PICTURE);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (expected) {
+        free(expected);
+    }
+    if (hashes) {
+        free(hashes);
+    }
+    free_stream(&stream);
+    if (writer.buffer) {
+        free(writer.buffer);
+    }
+    return exit_code;
+}
@@ -0,0 +1,324 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "h264decoder/h264_cpu.h"
+#include "h264decoder/h264_transform.h"
+
+/*
+ * inverse transform test: adds the residual of random macroblocks with the function table selected for each instruction set level supported by the CPU and compares
+ * the samples with the scalar reference kernels, the DC-only kernels are checked against the full transforms and the 10-bit kernels against the 8-bit kernels. then
+ * reports the luma macroblocks per second.
+ *
+ * usage: test_h264_transform [macroblock count] [rounds]
+ */
+
+#define DST_STRIDE 32
+
+/* the coefficient magnitudes keep the intermediate values of the transforms within 16 bits as required for a conforming bitstream */
+static int16_t random_coeff(int32_t limit) { return (rand() & 3) ? 0 : (int16_t)(rand() % (2 * limit + 1) - limit); }
+
+/**
+ * @brief fill the coefficients of a macroblock, every block is all-zero, DC only or random, the masks describe the blocks
+ */
+static void random_coeffs(TransformCoeffs *coeffs, int32_t transform_size_8x8_flag) {
+    int32_t num_blocks = transform_size_8x8_flag ? 4 : 16;
+    int32_t block_size = transform_size_8x8_flag ? 64 : 16;
+    int32_t limit = transform_size_8x8_flag ? 128 : 1024;
+
+    memset(coeffs, 0, sizeof(*coeffs));
+    for (int32_t blk = 0; blk < num_blocks; ++blk) {
+        int16_t *d = coeffs->luma + blk * block_size;
+        int32_t kind = rand() % 4;
+
+        if (kind == 1) {
+            d[0] = (int16_t)(rand() % 4096 - 2048);
+        } else if (kind >= 2) {
+            for (int32_t i = 0; i < block_size; ++i) {
+                d[i] = random_coeff(limit);
+            }
+        }
+
+        int32_t has_ac = 0;
+        for (int32_t i = 1; i < block_size; ++i) {
+            has_ac |= d[i] != 0;
+        }
+        coeffs->luma_nz |= (uint16_t)((has_ac || d[0]) << blk);
+        coeffs->luma_ac |= (uint16_t)(has_ac << blk);
+    }
+
+    for (int32_t iCbCr = 0; iCbCr < 2; ++iCbCr) {
+        for (int32_t blk = 0; blk < 8; ++blk) {
+            int16_t *d = coeffs->chroma[iCbCr] + blk * 16;
+            int32_t has_ac = 0;
+            if (rand() & 1) {
+                for (int32_t i = 0; i < 16; ++i) {
+                    d[i] = random_coeff(1024);
+                    has_ac |= i && d[i];
+                }
+            }
+            coeffs->chroma_nz[iCbCr] |= (uint16_t)((has_ac || d[0]) << blk);
+            coeffs->chroma_ac[iCbCr] |= (uint16_t)(has_ac << blk);
+        }
+    }
+}
+
+static void random_pred(uint8_t *pred) {
+    for (int32_t i = 0; i < 16 * DST_STRIDE; ++i) {
+        pred[i] = (uint8_t)(rand() & 255);
+    }
+}
+
+static int compare_samples(const char *name, const uint8_t *ref, const uint8_t *test) {
+    for (int32_t i = 0; i < 16 * DST_STRIDE; ++i) {
+        if (ref[i] != test[i]) {
+            fprintf(stderr, "%s mismatch at (%d, %d): %d != %d\n", name, i % DST_STRIDE, i / DST_STRIDE, test[i], ref[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int compare_macroblock(const TransformFuncs *ref, const TransformFuncs *test, const TransformCoeffs *coeffs, const uint8_t *pred, int32_t transform_size_8x8_flag) {
+    uint8_t ref_dst[16 * DST_STRIDE];
+    uint8_t test_dst[16 * DST_STRIDE];
+
+    memcpy(ref_dst, pred, sizeof(ref_dst));
+    memcpy(test_dst, pred, sizeof(test_dst));
+    transform_add_luma(ref, coeffs, 0, transform_size_8x8_flag, ref_dst, DST_STRIDE);
+    transform_add_luma(test, coeffs, 0, transform_size_8x8_flag, test_dst, DST_STRIDE);
+    if (compare_samples(transform_size_8x8_flag ? "luma 8x8" : "luma 4x4", ref_dst, test_dst) < 0) {
+        return -1;
+    }
+
+    for (int32_t iCbCr = 0; iCbCr < 2; ++iCbCr) {
+        memcpy(ref_dst, pred, sizeof(ref_dst));
+        memcpy(test_dst, pred, sizeof(test_dst));
+        transform_add_chroma(ref, coeffs, iCbCr, 16, ref_dst, DST_STRIDE);
+        transform_add_chroma(test, coeffs, iCbCr, 16, test_dst, DST_STRIDE);
+        if (compare_samples("chroma", ref_dst, test_dst) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief the DC-only kernels give the same samples as the full transforms of a block with the DC coefficient only
+ */
+static int check_dc_kernels(const TransformFuncs *funcs) {
+    uint8_t pred[16 * DST_STRIDE];
+    uint8_t ref_dst[16 * DST_STRIDE];
+    uint8_t test_dst[16 * DST_STRIDE];
+    int16_t block[64] = {0};
+
+    for (int32_t dc = -4096; dc < 4096; dc += 7) {
+        block[0] = (int16_t)dc;
+        random_pred(pred);
+
+        memcpy(ref_dst, pred, sizeof(ref_dst));
+        memcpy(test_dst, pred, sizeof(test_dst));
+        funcs->idct4x4_add(ref_dst, DST_STRIDE, block);
+        funcs->idct4x4_dc_add(test_dst, DST_STRIDE, block);
+        if (compare_samples("4x4 DC", ref_dst, test_dst) < 0) {
+            return -1;
+        }
+
+        memcpy(ref_dst, pred, sizeof(ref_dst));
+        memcpy(test_dst, pred, sizeof(test_dst));
+        funcs->idct8x8_add(ref_dst, DST_STRIDE, block);
+        funcs->idct8x8_dc_add(test_dst, DST_STRIDE, block);
+        if (compare_samples("8x8 DC", ref_dst, test_dst) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief the 10-bit kernels give the samples of the 8-bit kernels except the samples which the 8-bit kernels clip to 255
+ */
+static int compare_macroblock_10bit(const TransformFuncs *ref, const TransformFuncs *test, const TransformCoeffs *coeffs, const uint8_t *pred, int32_t transform_size_8x8_flag) {
+    uint8_t ref_dst[16 * DST_STRIDE];
+    uint16_t test_dst[16 * DST_STRIDE];
+    TransformCoeffs16 coeffs16;
+
+    for (int32_t i = 0; i < 256; ++i) {
+        coeffs16.luma[i] = coeffs->luma[i];
+        coeffs16.chroma[0][i & 127] = coeffs->chroma[0][i & 127];
+        coeffs16.chroma[1][i & 127] = coeffs->chroma[1][i & 127];
+    }
+    coeffs16.luma_nz = coeffs->luma_nz;
+    coeffs16.luma_ac = coeffs->luma_ac;
+    memcpy(coeffs16.chroma_nz, coeffs->chroma_nz, sizeof(coeffs16.chroma_nz));
+    memcpy(coeffs16.chroma_ac, coeffs->chroma_ac, sizeof(coeffs16.chroma_ac));
+
+    for (int32_t iCx = 0; iCx < 3; ++iCx) {
+        memcpy(ref_dst, pred, sizeof(ref_dst));
+        for (int32_t i = 0; i < 16 * DST_STRIDE; ++i) {
+            test_dst[i] = pred[i];
+        }
+
+        if (iCx == 0) {
+            transform_add_luma(ref, coeffs, 0, transform_size_8x8_flag, ref_dst, DST_STRIDE);
+            transform_add_luma16(test, &coeffs16, 0, transform_size_8x8_flag, test_dst, DST_STRIDE);
+        } else {
+            transform_add_chroma(ref, coeffs, iCx - 1, 16, ref_dst, DST_STRIDE);
+            transform_add_chroma16(test, &coeffs16, iCx - 1, 16, test_dst, DST_STRIDE);
+        }
+
+        for (int32_t i = 0; i < 16 * DST_STRIDE; ++i) {
+            if ((test_dst[i] > 255 ? 255 : test_dst[i]) != ref_dst[i]) {
+                fprintf(stderr, "10-bit component %d mismatch at (%d, %d): %d != %d\n", iCx, i % DST_STRIDE, i / DST_STRIDE, test_dst[i], ref_dst[i]);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief the 10-bit residual of the coefficients beyond 16 bits is added without overflow and clipped to 1023
+ */
+static int check_10bit_range(const TransformFuncs *funcs) {
+    uint16_t dst[16 * DST_STRIDE];
+    int32_t block[64] = {0};
+
+    for (int32_t i = 0; i < 16 * DST_STRIDE; ++i) {
+        dst[i] = 1000;
+    }
+
+    /* ( 65536 + 32 ) >> 6 is 1024 */
+    block[0] = 65536;
+    funcs->idct4x4_add((uint8_t *)dst, DST_STRIDE, (const int16_t *)block);
+    funcs->idct8x8_dc_add((uint8_t *)(dst + 8), DST_STRIDE, (const int16_t *)block);
+    for (int32_t y = 0; y < 4; ++y) {
+        for (int32_t x = 0; x < 4; ++x) {
+            if (dst[y * DST_STRIDE + x] != 1023 || dst[y * DST_STRIDE + 8 + x] != 1023) {
+                fprintf(stderr, "10-bit clipping mismatch at (%d, %d)\n", x, y);
+                return -1;
+            }
+        }
+    }
+
+    block[0] = -65536;
+    funcs->idct4x4_dc_add((uint8_t *)dst, DST_STRIDE, (const int16_t *)block);
+    if (dst[0] != 0) {
+        fprintf(stderr, "10-bit clipping mismatch: %d != 0\n", dst[0]);
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int exit_code = EXIT_FAILURE;
+    int32_t mb_count = 5000;
+    int32_t rounds = 200;
+    TransformCoeffs *mbs = 0;
+    uint8_t pred[16 * DST_STRIDE];
+    const int32_t levels[2] = {H264_CPU_SSE2, H264_CPU_SSE2 | H264_CPU_SSSE3 | H264_CPU_AVX2};
+    const char *level_names[2] = {"SSE2", "AVX2"};
+    int32_t cpu_flags = get_cpu_flags();
+
+    if (argc > 1) {
+        mb_count = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        rounds = atoi(argv[2]);
+    }
+    if (mb_count <= 0 || rounds <= 0) {
+        fprintf(stderr, "invalid parameters\n");
+        goto exit_flag;
+    }
+
+    /* the even macroblocks use the 4x4 transform and the odd ones the 8x8 transform */
+    mbs = (TransformCoeffs *)malloc(sizeof(TransformCoeffs) * mb_count);
+    if (!mbs) {
+        fprintf(stderr, "Memory allocation failed\n");
+        goto exit_flag;
+    }
+
+    srand(1234);
+    for (int32_t i = 0; i < mb_count; ++i) {
+        random_coeffs(&mbs[i], i & 1);
+    }
+
+    /* verify */
+    TransformFuncs ref;
+    init_transform_funcs(&ref, 8, 0);
+    if (check_dc_kernels(&ref) < 0) {
+        fprintf(stderr, "scalar: DC kernel mismatch\n");
+        goto exit_flag;
+    }
+
+    for (int32_t level = 0; level < 2; ++level) {
+        if ((cpu_flags & levels[level]) != levels[level]) {
+            printf("transform: %s not supported, skipped\n", level_names[level]);
+            continue;
+        }
+
+        TransformFuncs test;
+        init_transform_funcs(&test, 8, levels[level]);
+        if (check_dc_kernels(&test) < 0) {
+            fprintf(stderr, "%s: DC kernel mismatch\n", level_names[level]);
+            goto exit_flag;
+        }
+
+        for (int32_t i = 0; i < mb_count; ++i) {
+            random_pred(pred);
+            if (compare_macroblock(&ref, &test, &mbs[i], pred, i & 1) < 0) {
+                fprintf(stderr, "%s: macroblock %d mismatch\n", level_names[level], i);
+                goto exit_flag;
+            }
+        }
+        printf("transform: %s, %d macroblocks verified\n", level_names[level], mb_count);
+    }
+
+    TransformFuncs funcs10;
+    init_transform_funcs(&funcs10, 10, cpu_flags);
+    if (check_10bit_range(&funcs10) < 0) {
+        goto exit_flag;
+    }
+    for (int32_t i = 0; i < mb_count; ++i) {
+        random_pred(pred);
+        if (compare_macroblock_10bit(&ref, &funcs10, &mbs[i], pred, i & 1) < 0) {
+            fprintf(stderr, "10-bit: macroblock %d mismatch\n", i);
+            goto exit_flag;
+        }
+    }
+    printf("transform: 10-bit, %d macroblocks verified\n", mb_count);
+
+    /* benchmark */
+    TransformFuncs funcs;
+    init_transform_funcs(&funcs, 8, cpu_flags);
+
+    const TransformFuncs *tables[2] = {&ref, &funcs};
+    double mbs_per_second[2] = {0, 0};
+    random_pred(pred);
+    for (int32_t t = 0; t < 2; ++t) {
+        clock_t begin = clock();
+        for (int32_t round = 0; round < rounds; ++round) {
+            for (int32_t i = 0; i < mb_count; ++i) {
+                transform_add_luma(tables[t], &mbs[i], 0, i & 1, pred, DST_STRIDE);
+            }
+        }
+        double seconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+        mbs_per_second[t] = seconds > 0 ? (double)mb_count * rounds / seconds / 1e6 : 0;
+    }
+    printf("transform: scalar %.2f MMB/s, selected %.2f MMB/s\n", mbs_per_second[0], mbs_per_second[1]);
+
+    exit_code = EXIT_SUCCESS;
+
+exit_flag:
+    if (mbs) {
+        free(mbs);
+    }
+
+    return exit_code;
+}